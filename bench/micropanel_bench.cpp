@@ -0,0 +1,453 @@
+// Microbenchmarks for the render, protocol and parsing hot paths
+//
+//   micropanel_bench [-t SECONDS] [-c SCREEN_JSON] [FILTER]
+//
+// Each benchmark runs in growing batches until one batch takes at least
+// SECONDS (default 0.5) and reports that batch as ns/op, heap allocations/op
+// (all threads) and bytes/op. Bytes are protocol bytes sent to the device
+// for display benchmarks and input bytes consumed for parsers. Only names
+// containing FILTER are run.
+
+#include "Config.h"
+#include "DeviceInterfaces.h"
+#include "Logger.h"
+#include "MenuSystem.h"
+#include "MetricsSampler.h"
+#include "MicroPanel.h"
+#include "ScreenModules.h"
+#include <atomic>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <fcntl.h>
+#include <fstream>
+#include <functional>
+#include <new>
+#include <string>
+#include <thread>
+#include <unistd.h>
+#include <vector>
+#include <sys/stat.h>
+
+namespace {
+
+std::atomic<size_t> g_allocations{0};
+
+// Out of line so GCC does not pair an inlined free() with new as a mismatch
+__attribute__((noinline)) void release(void* p) noexcept { std::free(p); }
+
+} // namespace
+
+void* operator new(size_t size)
+{
+    g_allocations.fetch_add(1, std::memory_order_relaxed);
+    if (void* p = std::malloc(size ? size : 1)) {
+        return p;
+    }
+    throw std::bad_alloc();
+}
+
+void operator delete(void* p) noexcept { release(p); }
+void operator delete(void* p, size_t) noexcept { release(p); }
+
+/**
+ * Reaches the private hot paths the benchmarks time; declared a friend by
+ * MicroPanel, ThroughputClientScreen and MetricsSampler
+ */
+struct BenchAccess {
+    static bool loadScreenConfig(MicroPanel& app) {
+        app.m_mainMenu->clear();
+        return app.loadConfigModel() && app.loadConfigFromJson();
+    }
+
+    static void parseTestResults(ThroughputClientScreen& screen, const std::string& output,
+                                 const std::string& protocol) {
+        screen.m_testOutput = output;
+        screen.m_protocol = protocol;
+        screen.parseTestResults();
+    }
+
+    static void openMetrics(MetricsSampler& sampler) { sampler.openSources(); }
+    static void sampleMetrics(MetricsSampler& sampler) { sampler.sample(); }
+};
+
+namespace {
+
+using Clock = std::chrono::steady_clock;
+
+struct Batch {
+    size_t iterations = 0;
+    size_t bytes = 0;
+
+    // Call once the measured work is done to leave teardown untimed
+    void stop() {
+        end = Clock::now();
+        allocations = g_allocations.load();
+    }
+
+    Clock::time_point end;
+    size_t allocations = 0;
+};
+
+using Body = std::function<void(Batch&)>;
+
+void runBenchmark(const std::string& name, const Body& body, double minSeconds)
+{
+    size_t iterations = 1;
+    for (;;) {
+        Batch batch;
+        batch.iterations = iterations;
+
+        size_t allocationsBefore = g_allocations.load();
+        Clock::time_point start = Clock::now();
+        body(batch);
+        if (batch.end == Clock::time_point()) {
+            batch.stop();
+        }
+
+        double seconds = std::chrono::duration<double>(batch.end - start).count();
+        if (seconds >= minSeconds || iterations >= (size_t(1) << 30)) {
+            double n = static_cast<double>(iterations);
+            printf("%-32s %10zu %12.1f %10.2f %10.1f\n", name.c_str(), iterations,
+                   seconds * 1e9 / n, (batch.allocations - allocationsBefore) / n, batch.bytes / n);
+            fflush(stdout);
+            return;
+        }
+
+        // Aim a little past the target, growing at most 100x per step
+        size_t next = seconds > 0 ? static_cast<size_t>(iterations * minSeconds * 1.2 / seconds) : iterations * 100;
+        if (next > iterations * 100) next = iterations * 100;
+        if (next <= iterations) next = iterations * 2;
+        iterations = next;
+    }
+}
+
+/**
+ * Display that only counts direct-mode serial protocol bytes, so menu
+ * benchmarks time the menu and not a device
+ */
+class CountingDisplayDevice : public BaseDisplayDevice {
+public:
+    CountingDisplayDevice() : BaseDisplayDevice("bench") {}
+
+    bool open() override { return true; }
+    void close() override {}
+    bool isOpen() const override { return true; }
+    bool checkConnection() const override { return true; }
+
+    void clear() override { bytes += 1; }
+    using BaseDisplayDevice::drawText;
+    void drawText(int x, int y, const char* text, size_t length) override {
+        (void)x; (void)y; (void)text;
+        bytes += 3 + length;
+    }
+    void setCursor(int x, int y) override { (void)x; (void)y; bytes += 3; }
+    void setInverted(bool inverted) override { (void)inverted; bytes += 2; }
+    void setBrightness(int brightness) override { (void)brightness; bytes += 2; }
+    void drawProgressBar(int x, int y, int width, int height, int percentage) override {
+        (void)x; (void)y; (void)width; (void)height; (void)percentage;
+        bytes += 6;
+    }
+    void setPower(bool on) override { (void)on; bytes += 2; }
+
+    // Frame-buffered, so the menu does not pace its commands
+    bool isFrameBufferEnabled() const override { return true; }
+
+    size_t bytes = 0;
+};
+
+// I2C driver writing into a regular file instead of /dev/i2c-N
+class FileI2CDisplayDevice : public I2CDisplayDevice {
+public:
+    explicit FileI2CDisplayDevice(int fd) { m_fd = fd; }
+
+    // Bytes written so far; rewinds now and then so the file stays small
+    size_t takeBytes() {
+        off_t offset = lseek(m_fd, 0, SEEK_CUR);
+        lseek(m_fd, 0, SEEK_SET);
+        return offset > 0 ? static_cast<size_t>(offset) : 0;
+    }
+};
+
+std::shared_ptr<Menu> makeMenu(std::shared_ptr<Display> display)
+{
+    auto menu = std::make_shared<Menu>(display);
+    for (int i = 0; i < 12; i++) {
+        menu->addItem(std::make_shared<ActionMenuItem>("Menu item " + std::to_string(i), []() {}));
+    }
+    return menu;
+}
+
+std::string makeIperfOutput(bool udp)
+{
+    // Same shape as iperf3 --json: start, ten intervals, end summary
+    std::string sum = udp
+        ? "{\"start\":0,\"end\":10.0,\"seconds\":10.0,\"bytes\":1310720,\"bits_per_second\":1048576.5,"
+          "\"jitter_ms\":0.0345,\"lost_packets\":2,\"packets\":905,\"lost_percent\":0.22,\"sender\":true}"
+        : "{\"start\":0,\"end\":10.0,\"seconds\":10.0,\"bytes\":1172000000,\"bits_per_second\":937600000.0,"
+          "\"retransmits\":12,\"sender\":true}";
+
+    std::string output = "{\"start\":{\"connected\":[{\"socket\":5,\"local_host\":\"192.168.1.20\","
+                         "\"local_port\":40112,\"remote_host\":\"192.168.1.1\",\"remote_port\":5201}],"
+                         "\"version\":\"iperf 3.12\",\"test_start\":{\"protocol\":\"" +
+                         std::string(udp ? "UDP" : "TCP") + "\",\"num_streams\":1,\"duration\":10}},"
+                         "\"intervals\":[";
+    for (int i = 0; i < 10; i++) {
+        if (i > 0) output += ",";
+        output += "{\"streams\":[" + sum + "],\"sum\":" + sum + "}";
+    }
+    output += "],\"end\":{\"streams\":[{\"sender\":" + sum + "}],";
+    output += udp ? "\"sum\":" + sum : "\"sum_sent\":" + sum + ",\"sum_received\":" + sum;
+    output += "}}";
+    return output;
+}
+
+// Drains a pty master on its own thread and counts what arrives
+class PtyCounter {
+public:
+    bool open() {
+        m_master = posix_openpt(O_RDWR | O_NOCTTY);
+        if (m_master < 0 || grantpt(m_master) < 0 || unlockpt(m_master) < 0) {
+            return false;
+        }
+        m_slavePath = ptsname(m_master);
+        m_thread = std::thread([this]() {
+            char buffer[4096];
+            while (!m_stop.load()) {
+                ssize_t n = read(m_master, buffer, sizeof(buffer));
+                if (n > 0) {
+                    m_bytes.fetch_add(static_cast<size_t>(n));
+                } else if (n < 0 && errno != EINTR && errno != EAGAIN) {
+                    break;
+                }
+            }
+        });
+        return true;
+    }
+
+    ~PtyCounter() {
+        m_stop.store(true);
+        if (m_master >= 0) {
+            ::close(m_master);     // Unblocks the read once the slave is gone too
+        }
+        if (m_thread.joinable()) {
+            m_thread.join();
+        }
+    }
+
+    // Wait until nothing has arrived for a while, then return and reset the count
+    size_t settle() {
+        size_t last = m_bytes.load();
+        for (;;) {
+            std::this_thread::sleep_for(std::chrono::milliseconds(50));
+            size_t now = m_bytes.load();
+            if (now == last) {
+                return m_bytes.exchange(0);
+            }
+            last = now;
+        }
+    }
+
+    const std::string& slavePath() const { return m_slavePath; }
+
+private:
+    int m_master = -1;
+    std::string m_slavePath;
+    std::thread m_thread;
+    std::atomic<bool> m_stop{false};
+    std::atomic<size_t> m_bytes{0};
+};
+
+bool copyFile(const std::string& from, const std::string& to)
+{
+    std::ifstream in(from, std::ios::binary);
+    std::ofstream out(to, std::ios::binary);
+    out << in.rdbuf();
+    return in && out;
+}
+
+} // namespace
+
+int main(int argc, char* argv[])
+{
+    double minSeconds = 0.5;
+    std::string screenConfig = "screens/config-debian.json";
+    std::string filter;
+    for (int i = 1; i < argc; i++) {
+        std::string arg = argv[i];
+        if (arg == "-t" && i + 1 < argc) {
+            minSeconds = atof(argv[++i]);
+        } else if (arg == "-c" && i + 1 < argc) {
+            screenConfig = argv[++i];
+        } else if (arg == "-h") {
+            printf("Usage: %s [-t SECONDS] [-c SCREEN_JSON] [FILTER]\n", argv[0]);
+            return EXIT_SUCCESS;
+        } else {
+            filter = arg;
+        }
+    }
+
+    // Scratch space for the config copy, its data file, the log and the I2C sink
+    char scratch[] = "/tmp/micropanel-bench-XXXXXX";
+    if (!mkdtemp(scratch)) {
+        perror("mkdtemp");
+        return EXIT_FAILURE;
+    }
+    std::string dir = scratch;
+    Logger::startAsync(Logger::Sink::FILE, dir + "/bench.log");
+
+    auto selected = [&filter](const std::string& name) {
+        return filter.empty() || name.find(filter) != std::string::npos;
+    };
+    auto run = [&](const std::string& name, const Body& body) {
+        if (selected(name)) {
+            runBenchmark(name, body, minSeconds);
+        }
+    };
+
+    printf("%-32s %10s %12s %10s %10s\n", "benchmark", "iterations", "ns/op", "allocs/op", "bytes/op");
+
+    // Menu rendering against a counting device
+    {
+        auto device = std::make_shared<CountingDisplayDevice>();
+        auto display = std::make_shared<Display>(device);
+        auto menu = makeMenu(display);
+
+        run("menu.render", [&](Batch& batch) {
+            device->bytes = 0;
+            for (size_t i = 0; i < batch.iterations; i++) {
+                menu->refresh();
+            }
+            batch.bytes = device->bytes;
+        });
+
+        run("menu.updateSelection", [&](Batch& batch) {
+            device->bytes = 0;
+            for (size_t i = 0; i < batch.iterations; i++) {
+                menu->updateSelection(static_cast<int>(i & 1), static_cast<int>((i + 1) & 1));
+            }
+            batch.bytes = device->bytes;
+        });
+    }
+
+    // SSD1306 flushes through the write() fallback into a file
+    if (selected("i2c.")) {
+        std::string sinkPath = dir + "/i2c.bin";
+        int fd = ::open(sinkPath.c_str(), O_RDWR | O_CREAT | O_TRUNC | O_CLOEXEC, 0644);
+        auto i2c = std::make_shared<FileI2CDisplayDevice>(fd);
+        i2c->setFrameBufferEnabled(true);
+
+        run("i2c.flush.line", [&](Batch& batch) {
+            i2c->takeBytes();
+            for (size_t i = 0; i < batch.iterations; i++) {
+                i2c->drawText(0, static_cast<int>(i % 8) * 8, "Line value " + std::to_string(i % 1000));
+                i2c->flushBuffer();
+                if ((i & 1023) == 1023) batch.bytes += i2c->takeBytes();
+            }
+            batch.bytes += i2c->takeBytes();
+        });
+
+        run("i2c.flush.full", [&](Batch& batch) {
+            i2c->takeBytes();
+            for (size_t i = 0; i < batch.iterations; i++) {
+                i2c->clear();
+                for (int line = 0; line < 8; line++) {
+                    i2c->drawText(0, line * 8, "Full frame line " + std::to_string(line));
+                }
+                i2c->flushBuffer();
+                if ((i & 255) == 255) batch.bytes += i2c->takeBytes();
+            }
+            batch.bytes += i2c->takeBytes();
+        });
+    }
+
+    // Serial command buffering through the writer thread into a pty
+    if (selected("serial.")) {
+        PtyCounter pty;
+        if (!pty.open()) {
+            perror("pty");
+        } else {
+            auto serial = std::make_shared<DisplayDevice>(pty.slavePath());
+            if (serial->open()) {
+                pty.settle();
+
+                std::string text = "Menu item 7";
+                std::vector<uint8_t> command(3 + text.size());
+                command[0] = Config::CMD_DRAW_TEXT;
+                command[1] = 0;
+                command[2] = 16;
+                memcpy(command.data() + 3, text.data(), text.size());
+
+                run("serial.bufferCommand", [&](Batch& batch) {
+                    for (size_t i = 0; i < batch.iterations; i++) {
+                        command[2] = static_cast<uint8_t>((i % 6) * 8 + 16);
+                        serial->bufferCommand(command.data(), command.size());
+                    }
+                    serial->flushBuffer();
+                    batch.stop();
+                    batch.bytes = pty.settle();
+                });
+                serial->close();
+            }
+        }
+    }
+
+    // Screen JSON loading as done at startup, headless
+    if (selected("config.load")) {
+        std::string configCopy = dir + "/screens.json";
+        std::string emptyScript = dir + "/empty.replay";
+        std::ofstream(emptyScript).close();
+        struct stat info;
+        if (!copyFile(screenConfig, configCopy) || stat(configCopy.c_str(), &info) < 0) {
+            fprintf(stderr, "Cannot read %s\n", screenConfig.c_str());
+        } else {
+            std::string logPath = dir + "/bench.log";
+            const char* args[] = {"micropanel_bench", "-s", Config::VIRTUAL_DISPLAY_PREFIX, "-R", emptyScript.c_str(),
+                                  "-c", configCopy.c_str(), "-F", "-l", logPath.c_str()};
+            optind = 1;
+            MicroPanel app(static_cast<int>(sizeof(args) / sizeof(args[0])), const_cast<char**>(args));
+            if (app.initialize()) {
+                run("config.load", [&](Batch& batch) {
+                    for (size_t i = 0; i < batch.iterations; i++) {
+                        BenchAccess::loadScreenConfig(app);
+                    }
+                    batch.bytes = batch.iterations * static_cast<size_t>(info.st_size);
+                });
+            }
+        }
+    }
+
+    // iperf3 result parsing
+    if (selected("throughput.")) {
+        auto display = std::make_shared<Display>(std::make_shared<CountingDisplayDevice>());
+        ThroughputClientScreen screen(display, std::make_shared<InputDevice>());
+        for (bool udp : {false, true}) {
+            std::string output = makeIperfOutput(udp);
+            run(udp ? "throughput.parseTestResults.udp" : "throughput.parseTestResults.tcp", [&](Batch& batch) {
+                for (size_t i = 0; i < batch.iterations; i++) {
+                    BenchAccess::parseTestResults(screen, output, udp ? "UDP" : "TCP");
+                }
+                batch.bytes = batch.iterations * output.size();
+            });
+        }
+    }
+
+    // The /proc sampling behind the system stats screen
+    if (selected("metrics.sample")) {
+        MetricsSampler& sampler = MetricsSampler::getInstance();
+        BenchAccess::openMetrics(sampler);
+        run("metrics.sample", [&](Batch& batch) {
+            for (size_t i = 0; i < batch.iterations; i++) {
+                BenchAccess::sampleMetrics(sampler);
+            }
+        });
+    }
+
+    Logger::stopAsync();
+    std::string cleanup = "rm -rf '" + dir + "'";
+    if (system(cleanup.c_str()) != 0) {
+        fprintf(stderr, "Could not remove %s\n", dir.c_str());
+    }
+    return EXIT_SUCCESS;
+}
@@ -0,0 +1,11 @@
+# Module selection for the minimal images (screens/config-pi-buildroot-minimal.json):
+# only the screens that config opens, with the heavy ones as plugins.
+#   cmake -C cmake/modules-minimal.cmake -S . -B build
+set(MODULE_DEMO OFF CACHE BOOL "")
+set(MODULE_NETWORK OFF CACHE BOOL "")
+set(MODULE_DIAGNOSTICS OFF CACHE BOOL "")
+set(MODULE_INTERNET OFF CACHE BOOL "")
+set(MODULE_SWEEP OFF CACHE BOOL "")
+set(MODULE_THROUGHPUTMESH OFF CACHE BOOL "")
+set(MODULE_TRENDS OFF CACHE BOOL "")
+set(MODULE_PLUGINS ON CACHE BOOL "")
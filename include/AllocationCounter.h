@@ -0,0 +1,38 @@
+#pragma once
+
+#include <cstdint>
+
+/**
+ * Debug heap allocation counter for the render paths
+ *
+ * Built with -DCOUNT_ALLOCATIONS=ON (MICROPANEL_COUNT_ALLOCATIONS), the
+ * global operator new counts the allocations of each thread, and an
+ * AllocationGuard around a steady-state redraw asserts that nothing in its
+ * scope allocated. Worker threads allocate freely without affecting the
+ * count. In normal builds the guard is empty and threadCount() is 0.
+ */
+namespace AllocationCounter {
+    // operator new calls made by the calling thread so far
+    uint64_t threadCount();
+}
+
+class AllocationGuard {
+public:
+#ifdef MICROPANEL_COUNT_ALLOCATIONS
+    // steady = false for frames that are allowed to allocate (first draw, layout changes)
+    explicit AllocationGuard(const char* scope, bool steady = true);
+    ~AllocationGuard();
+#else
+    explicit AllocationGuard(const char* scope, bool steady = true) { (void)scope; (void)steady; }
+#endif
+
+    AllocationGuard(const AllocationGuard&) = delete;
+    AllocationGuard& operator=(const AllocationGuard&) = delete;
+
+#ifdef MICROPANEL_COUNT_ALLOCATIONS
+private:
+    const char* m_scope;
+    bool m_steady;
+    uint64_t m_start;
+#endif
+};
@@ -0,0 +1,32 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+#include "MonoFrame.h"
+
+/**
+ * Encoder for the CMD_BLIT serial command
+ *
+ * Payloads are either raw window bytes, PackBits runs of the window bytes, or
+ * PackBits runs of the XOR between the new and the previously sent contents
+ * (mostly zeros for small changes). PackBits: a control byte n < 128 is
+ * followed by n + 1 literal bytes, n >= 128 repeats the next byte n - 125
+ * times (3..130). unpackBits() is the reference decoder for the firmware.
+ */
+class BlitCodec {
+public:
+    // Largest payload ever produced: raw bytes are used when nothing is smaller
+    static constexpr size_t MAX_PAYLOAD = MonoFrame::SIZE;
+    static constexpr size_t MAX_COMMAND = Config::BLIT_HEADER_SIZE + MAX_PAYLOAD;
+
+    // Build a complete CMD_BLIT command for the window. current and previous
+    // hold window bytes in send order; previous may be null when the device
+    // contents are unknown. Returns the command length.
+    static size_t encode(const MonoFrame::Window& window, const uint8_t* current,
+                         const uint8_t* previous, uint8_t* out);
+
+    // Compress into out (capacity limit); returns 0 if the output would not fit
+    static size_t packBits(const uint8_t* in, size_t length, uint8_t* out, size_t limit);
+    static size_t unpackBits(const uint8_t* in, size_t length, uint8_t* out, size_t limit);
+};
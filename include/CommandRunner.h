@@ -0,0 +1,111 @@
+#pragma once
+
+#include <cstdint>
+#include <functional>
+#include <map>
+#include <memory>
+#include <string>
+#include <sys/types.h>
+
+/**
+ * @class CommandRunner
+ * @brief Shared non-blocking shell command runner with a keyed output cache
+ *
+ * Commands run under /bin/sh via posix_spawn with stdout on a pipe. All
+ * pipes sit on one epoll instance whose fd the main EventLoop watches, so
+ * output is drained as it arrives instead of the UI thread blocking in
+ * popen()/fgets(). Each command has a timeout after which its process group
+ * is killed.
+ *
+ * Finished output is cached per command string. request() returns the last
+ * output straight away (stale-while-revalidate) and starts a refresh when it
+ * is older than the caller's TTL; screens redraw when the generation changes.
+ *
+ * Streams are long-lived children (tail -f, dmesg -w) on the same epoll set
+ * whose stdout is handed over line by line from poll() instead of cached.
+ *
+ * Commands of the form "launcher:IP:PORT command [arg]" spawn nothing: the
+ * line goes to that server over LauncherClient's persistent connection and
+ * the reply line is the output, cached and timed out like any other.
+ *
+ * Not thread-safe: use from the UI thread only.
+ */
+class CommandRunner {
+public:
+    struct Result {
+        bool available = false;         // output holds a finished run
+        bool running = false;           // A run is in progress
+        bool stale = false;             // Older than the requested TTL
+        bool failed = false;            // Could not be started
+        bool timedOut = false;
+        int exitStatus = -1;
+        std::string output;
+        uint64_t generation = 0;        // Changes whenever a run finishes
+    };
+
+    static CommandRunner& getInstance();
+
+    CommandRunner(const CommandRunner&) = delete;
+    CommandRunner& operator=(const CommandRunner&) = delete;
+
+    // epoll fd that turns readable when a child has output or exited
+    int getFd() const { return m_epollFd; }
+
+    // Drain pipes, reap children and enforce timeouts without blocking
+    void poll();
+
+    // Cached result, refreshed in the background when older than ttlMs
+    Result request(const std::string& command, int ttlMs, int timeoutMs);
+
+    // Cached result without starting anything
+    Result peek(const std::string& command);
+
+    // Run to completion (or timeout) and return the fresh result
+    Result runSync(const std::string& command, int timeoutMs);
+
+    // Forget the cached output so the next request() runs the command
+    void invalidate(const std::string& command);
+
+    // Called from poll() with each complete line, without the newline
+    using LineHandler = std::function<void(const std::string& line)>;
+
+    // Start a stream with no timeout; returns its id, or -1 if it could not be started
+    int openStream(const std::string& command, LineHandler onLine);
+
+    // Kill the stream's process group; its handler is not called again
+    void closeStream(int id);
+
+    // False once the child has exited and its output is drained
+    bool isStreamRunning(int id) const;
+
+private:
+    struct Job;
+
+    struct Entry {
+        Result result;                  // Last finished run
+        int64_t finishedMs = 0;
+        int64_t usedMs = 0;             // For eviction
+        bool invalidated = false;
+        std::unique_ptr<Job> job;
+    };
+
+    CommandRunner();
+    ~CommandRunner();
+
+    std::unique_ptr<Job> spawn(const std::string& command);
+    std::unique_ptr<Job> submit(const std::string& command, int timeoutMs);
+    bool start(const std::string& command, Entry& entry, int timeoutMs);
+    void readOutput(Job& job);
+    void deliverLines(Job& job, const char* data, size_t length);
+    void finishRequest(const std::string& command, Entry& entry, int64_t now);
+    void reapStreams();
+    void finish(Entry& entry, bool timedOut);
+    Result snapshot(const Entry& entry, int ttlMs) const;
+    void evict();
+
+    int m_epollFd = -1;
+    uint64_t m_generation = 0;
+    std::map<std::string, Entry> m_entries;
+    std::map<int, std::unique_ptr<Job>> m_streams;
+    int m_nextStreamId = 1;
+};
@@ -35,6 +35,13 @@ namespace Config {
     constexpr uint8_t CMD_BRIGHTNESS = 0x05;
     constexpr uint8_t CMD_PROGRESS_BAR = 0x06;
     constexpr uint8_t CMD_POWER_MODE = 0x07;
+    // NEW: Raw 1bpp region blit in SSD1306 page layout:
+    // [CMD_BLIT, firstPage, lastPage, firstColumn, lastColumn, encoding, lenLo, lenHi, payload...]
+    constexpr uint8_t CMD_BLIT = 0x08;
+    constexpr uint8_t BLIT_ENCODING_RAW = 0x00;        // Window bytes as-is
+    constexpr uint8_t BLIT_ENCODING_RLE = 0x01;        // PackBits-compressed window bytes
+    constexpr uint8_t BLIT_ENCODING_DELTA_RLE = 0x02;  // PackBits-compressed XOR against current contents
+    constexpr int BLIT_HEADER_SIZE = 8;
     // Timing constants
     constexpr int DISPLAY_CMD_DELAY = 10000;       // 10ms delay between display commands
     constexpr int DISPLAY_CLEAR_DELAY = 50000;     // 50ms delay after clear
@@ -45,15 +52,155 @@ namespace Config {
     constexpr int MAIN_LOOP_DELAY = 5000;          // 5ms delay in main loop
     constexpr int STARTUP_DELAY = 1000000;         // 1s delay at startup
     constexpr int CMD_BUFFER_FLUSH_INTERVAL = 50;  // 50ms between buffer flushes
+    constexpr int MODULE_REFRESH_INTERVAL = 100;   // 100ms module update tick when idle
     // NEW: Keyboard event synthesis timing (16ms to match RP2040 behavior)
     constexpr int KEYBOARD_SECOND_EVENT_DELAY_MS = 16;
     // Power save constants
     constexpr int POWER_SAVE_TIMEOUT_SEC = 10;     // Default timeout in seconds for power save
     // Serial command buffer
     constexpr int CMD_BUFFER_SIZE = 256;
+    // NEW: Subnet sweep probe pool (ICMP echo + ARP per target)
+    constexpr int SWEEP_MAX_IN_FLIGHT = 256;       // Probes outstanding at once
+    constexpr int SWEEP_PROBE_TIMEOUT_MS = 500;    // Per attempt
+    constexpr int SWEEP_PROBE_ATTEMPTS = 2;
+    constexpr int SWEEP_MAX_HOSTS = 1024;          // Largest sweep: a /22
+    // NEW: HTTP speed test (parallel libcurl transfers)
+    constexpr int SPEEDTEST_CONNECTIONS = 4;       // Default parallel connections
+    constexpr int SPEEDTEST_MAX_CONNECTIONS = 16;
+    constexpr int SPEEDTEST_WARMUP_MS = 2000;      // Discarded: connect, TLS, slow start
+    constexpr int SPEEDTEST_DURATION_MS = 10000;   // Measured window after warm-up
+    constexpr int SPEEDTEST_SAMPLE_MS = 250;       // Live graph resolution
+    // NEW: Built-in iperf3-compatible server
+    constexpr int IPERF_SERVER_MAX_TESTS = 16;     // Concurrent clients; more get ACCESS_DENIED
+    constexpr int IPERF_SERVER_MAX_STREAMS = 128;  // Per test (-P)
+    constexpr int IPERF_SERVER_SETUP_TIMEOUT_MS = 10000;
+    // NEW: Built-in mDNS/DNS-SD browser
+    constexpr int MDNS_BROWSE_MS = 800;            // Queries go out at 0, 250 and 750ms
+    constexpr int MDNS_MAX_RECORDS = 256;          // Cache entries kept across browses
+    // NEW: Shared command runner (list/textbox scripts)
+    constexpr int COMMAND_TIMEOUT_MS = 10000;      // Default per-command timeout
+    constexpr int COMMAND_CACHE_MAX_ENTRIES = 64;
+    constexpr int COMMAND_MAX_OUTPUT = 1024 * 1024; // Bytes kept per run
+    // NEW: Persistent storage writer
+    constexpr int STORAGE_SAVE_DELAY_MS = 2000;    // Changes within this window share one snapshot write
+    constexpr int STORAGE_JOURNAL_MAX_BYTES = 64 * 1024; // Journal size that triggers a compaction
+    // NEW: Background metrics sampler (SystemStatsScreen sparklines)
+    constexpr int METRICS_INTERVAL_MS = 1000;
+    constexpr int METRICS_HISTORY = 64;            // Samples per series: ~1 minute, 2px each across the display
+    // NEW: rtnetlink network state cache
+    constexpr int NETLINK_RCVBUF_BYTES = 256 * 1024; // Room for event bursts on VLAN/bridge-heavy boxes
+    constexpr int NETLINK_DUMP_TIMEOUT_MS = 2000;
+    // NEW: Asynchronous logger
+    constexpr int LOG_RING_CAPACITY = 256;         // Records; a full ring drops instead of blocking
+    constexpr int LOG_RECORD_BYTES = 256;          // Longer messages are truncated
+    constexpr int LOG_FLUSH_INTERVAL_MS = 50;
+    constexpr int LOG_RATE_LIMIT_PER_SEC = 20;     // Messages per call site per second
+    // NEW: Unified input events
+    constexpr int LONG_PRESS_MS = 800;             // Hold time before release that adds a LONG_PRESS
+    // NEW: Config hot reload
+    constexpr int CONFIG_RELOAD_DELAY_MS = 100;    // Quiet time after the last write before reloading
+    // NEW: Headless display and input replay
+    constexpr const char* VIRTUAL_DISPLAY_PREFIX = "virtual";  // -s virtual[:DIR]
+    constexpr int VIRTUAL_FRAME_HISTORY = 256;     // Rendered frames kept in memory
+    constexpr int REPLAY_PRESS_MS = 50;            // Button hold for a scripted 'press'
+    constexpr int REPLAY_DETENT_MS = 20;           // Spacing of the detents of one scripted rotate
+    constexpr int REPLAY_EXIT_DELAY_MS = 500;      // Time for the last frame before exiting
+    constexpr int REPLAY_RETRY_MS = 10;            // Wait before rewriting an event into a full replay pipe
+    // NEW: Performance counters and stats socket
+    constexpr const char* STATS_SOCKET_PATH = "/tmp/micropanel-stats.sock";  // -S overrides
+    constexpr int STATS_TEXTFILE_INTERVAL_MS = 15000;  // -P Prometheus textfile rewrite period
+    constexpr int PERF_MAX_INPUT_LATENCY_MS = 10000;   // Longer spans are clock steps, not latency
+    constexpr int DIAGNOSTICS_REFRESH_MS = 1000;       // Diagnostics screen redraw period
+    // NEW: Push display socket
+    constexpr const char* PUSH_SOCKET_PATH = "/tmp/micropanel-push.sock";  // -U overrides
+    constexpr int PUSH_MAX_DATAGRAM = 2048;        // Room for a 1024-byte frame and its header
+    constexpr int PUSH_MAX_DATAGRAMS_PER_POLL = 32;    // The rest waits in the receive queue
+    constexpr int PUSH_MAX_SCREENS = 32;           // Distinct screen names kept
+    constexpr int PUSH_MAX_LINES = 6;              // Body rows below the title
+    constexpr int PUSH_MAX_ITEMS = 64;
+    constexpr int PUSH_MAX_TEXT = 64;              // Characters per title, line or item
+    // NEW: Streaming textbox
+    constexpr int TEXTBOX_SCROLLBACK_LINES = 200;  // Default "scrollback" of a streaming textbox
+    constexpr int TEXTBOX_SCROLLBACK_MAX = 5000;
+    constexpr int STREAM_MAX_LINE = 256;           // Longer stream lines are split
+    constexpr int STREAM_MAX_READ_PER_POLL = 64 * 1024;  // Bytes per stream before poll() moves on
+    // NEW: Incremental log tailing (GenericList async actions)
+    constexpr int LOG_TAIL_MAX_LINE = 1024;        // Longer log lines are split
+    constexpr int LOG_TAIL_MAX_READ_PER_POLL = 256 * 1024;  // The rest is read on later updates
+    // NEW: Virtualized lists (GenericList dynamic items)
+    constexpr int LIST_PREFETCH_ITEMS = 16;        // Rows materialized beyond each edge of the view
+    constexpr int LIST_SEARCH_MIN_ITEMS = 20;      // Dynamic lists this long get a "Find..." row
+    constexpr int LIST_SEARCH_MAX_CHOICES = 40;    // Next characters offered at once
+    // NEW: Encoder acceleration
+    constexpr const char* ENCODER_ACCEL_CURVE = "10:1,25:2,50:4";  // Detents/s:gain points, -A overrides
+    constexpr int ENCODER_ACCEL_IDLE_MS = 150;     // A longer pause starts over at 1:1
+    constexpr int ENCODER_ACCEL_MIN_INTERVAL_US = 2000;    // Caps the rate of detents reported together
+    constexpr double ENCODER_ACCEL_SMOOTHING = 0.4;        // Weight of the newest interval
+    constexpr int ENCODER_ACCEL_MAX_GAIN = 16;
+    // NEW: Reachability probe (Internet test)
+    constexpr const char* INTERNET_TEST_TARGETS = "8.8.8.8,1.1.1.1,9.9.9.9";  // ICMP targets, IPv4
+    constexpr int INTERNET_TEST_MAX_TARGETS = 3;
+    constexpr const char* INTERNET_TEST_DNS_NAME = "www.google.com";     // Resolved, then TCP-connected
+    constexpr int INTERNET_TEST_TCP_PORT = 443;
+    constexpr int INTERNET_TEST_TIMEOUT_MS = 2000;         // Whole run; stages go in parallel
+    constexpr int HAPPY_EYEBALLS_RESOLUTION_DELAY_MS = 50; // Wait for AAAA after A (RFC 8305)
+    constexpr int HAPPY_EYEBALLS_CONNECT_DELAY_MS = 250;   // Head start of the IPv6 connect
+    // NEW: Switch port discovery (LLDP/CDP)
+    constexpr unsigned int LLDP_RING_BLOCK_SIZE = 16384;   // TPACKET_V3 block, a page multiple
+    constexpr unsigned int LLDP_RING_BLOCKS = 4;
+    constexpr unsigned int LLDP_RING_FRAME_SIZE = 2048;
+    constexpr unsigned int LLDP_RING_RETIRE_MS = 100;      // Partly filled block handed over after this
+    constexpr int NETINFO_COUNTERS_REFRESH_MS = 1000;      // Details page: speed, errors, advertisement age
+    // NEW: Latency under load (bufferbloat test)
+    constexpr int LATENCY_PROBE_INTERVAL_MS = 15;          // ICMP probe period during the whole test
+    constexpr int LATENCY_PROBE_TIMEOUT_MS = 900;          // Below IcmpPinger's 64 slots x interval
+    constexpr int LATENCY_IDLE_MS = 3000;                  // Baseline before any load
+    constexpr int LATENCY_WARMUP_MS = 1000;                // Start of each load not counted
+    constexpr int LATENCY_LOAD_MIN_STREAMS = 4;            // TCP streams needed to saturate
+    // NEW: Scheduler for periodic work
+    constexpr int SCHEDULER_TICK_MS = 50;                  // Wakeup grid shared by all deadlines
+    constexpr int SCHEDULER_COALESCE_MS = 100;             // Light jobs this close to a wakeup run on it
+    constexpr int SCHEDULER_HIDDEN_SLOWDOWN = 4;           // Heavy jobs run this much less often while hidden
+    // NEW: Plugin modules (CMake MODULE_PLUGINS)
+#ifdef MICROPANEL_PLUGIN_DIR
+    constexpr const char* PLUGIN_DIR = MICROPANEL_PLUGIN_DIR;  // Set by CMake from the install prefix
+#else
+    constexpr const char* PLUGIN_DIR = "/usr/lib/micropanel";  // -M overrides
+#endif
+    // NEW: Throughput mesh (MeshAgent/MeshCoordinator)
+    constexpr int MESH_CONTROL_PORT = 5299;                // UDP, JSON requests from the coordinator
+    constexpr int MESH_IPERF_PORT = 5211;                  // Node's own iperf3 server, clear of 5201
+    constexpr const char* MESH_SERVICE_TYPE = "_micropanel-mesh._udp";
+    constexpr int MESH_DISCOVERY_MS = 3000;
+    constexpr int MESH_START_LEAD_MS = 1500;               // Schedule push before round 0 starts
+    constexpr int MESH_ROUND_GAP_MS = 1000;                // Covers test setup and teardown
+    constexpr int MESH_RETRY_MS = 250;
+    constexpr int MESH_RETRIES = 8;
+    constexpr int MESH_RESULT_GRACE_MS = 5000;             // After a round should have ended
+    constexpr int MESH_MAX_NODES = 8;
+    constexpr int MESH_MAX_TESTS = 64;                     // 8 nodes full mesh is 56
+    constexpr const char* MESH_EXPORT_PATH = "/tmp/micropanel-mesh.json";
+    // NEW: Measurement history (HistoryLog)
+    constexpr int HISTORY_CAPACITY = 16384;                // 16-byte records, 256 KiB ring
+    constexpr int TREND_WINDOWS[] = {128, 512, 2048, 16384};   // Newest results per graph, rotation cycles
+    // NEW: IP suggestions (IPSuggestions, IPSelector)
+    constexpr int IP_SUGGEST_MAX = 16;             // Candidates one press of the selector offers
+    constexpr int IP_SUGGEST_RECENT = 8;           // Used targets kept in persistent storage
+    constexpr int IP_SUGGEST_SWEEP_MAX = 64;       // Hosts remembered from subnet sweeps
+    // NEW: Launcher client (LauncherClient, "launcher:" commands)
+    constexpr int LAUNCHER_TIMEOUT_MS = 2000;      // Per request unless command_timeout is set, as launcher-client
+    constexpr int LAUNCHER_MAX_QUEUED = 32;        // Unfinished requests per server
+    constexpr int LAUNCHER_MAX_LINE = 4096;        // Longer replies are cut
+    // NEW: Wi-Fi scan and link monitor (WirelessState, WiFiSettingsScreen)
+    constexpr int WIFI_STATION_POLL_MS = 250;      // Signal/bitrate request interval while a link is shown
+    constexpr int WIFI_REQUEST_TIMEOUT_MS = 1000;  // One nl80211 request or dump
+    constexpr int WIFI_SCAN_TIMEOUT_MS = 15000;    // Scan considered over without its completion event
+    constexpr int WIFI_SCAN_RETRY_MS = 2000;       // After a refused or aborted scan
+    constexpr int WIFI_SCAN_MAX_AGE_MS = 30000;    // Older BSS entries are dropped from the list
+    constexpr int WIFI_SCAN_MAX_NETWORKS = 64;
+    constexpr int WIFI_REFRESH_MS = 100;           // Screen checks the snapshot generation this often
     // Input event handling limits
-    constexpr int MAX_EVENTS_PER_ITERATION = 5;
-    constexpr int MAX_ACCELERATION_STEPS = 3;
+    constexpr int INPUT_READ_BATCH = 64;           // input_events per read(); reads repeat until drained
     // Version
     constexpr const char* VERSION = "2.0.0";
 }
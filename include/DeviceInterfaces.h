@@ -7,7 +7,13 @@
 #include <vector>
 #include <sys/time.h>
 #include <thread>  // Add missing include for std::thread
+#include <memory>
 #include "Config.h"
+#include "FrameBuffer.h"
+#include "InputEvent.h"
+#include "EncoderAcceleration.h"
+#include "SerialWriter.h"
+#include "MonoFrame.h"
 
 /**
  * Base device interface for all hardware devices
@@ -37,6 +43,11 @@ public:
         return m_devicePath;
     }
 
+    // Takes effect on the next open(); hotplug reuses device objects across replugs
+    void setDevicePath(const std::string& devicePath) {
+        m_devicePath = devicePath;
+    }
+
 protected:
     std::string m_devicePath;
     int m_fd;
@@ -52,7 +63,8 @@ public:
 
     // Pure virtual display commands that both serial and I2C must implement
     virtual void clear() = 0;
-    virtual void drawText(int x, int y, const std::string& text) = 0;
+    virtual void drawText(int x, int y, const char* text, size_t length) = 0;
+    void drawText(int x, int y, const std::string& text) { drawText(x, y, text.data(), text.size()); }
     virtual void setCursor(int x, int y) = 0;
     virtual void setInverted(bool inverted) = 0;
     virtual void setBrightness(int brightness) = 0;
@@ -65,6 +77,25 @@ public:
     virtual void flushBuffer() {}
 
     virtual bool isDisconnected() const { return false; }
+
+    // Optional host-side shadow framebuffer: drawing calls compose a frame and
+    // present() sends only what changed since the last presented frame
+    virtual void setFrameBufferEnabled(bool enabled) {
+        m_frameBuffer.reset(enabled ? new FrameBuffer() : nullptr);
+    }
+    virtual bool isFrameBufferEnabled() const { return m_frameBuffer != nullptr; }
+    virtual void present() {}
+
+    // Resend the last frame after the device was reopened (hotplug)
+    virtual void repaint() { present(); }
+
+    // Optional raw 1bpp transfer of a page/column window in MonoFrame layout,
+    // so one local renderer can drive every device that supports it
+    virtual bool supportsBlit() const { return false; }
+    virtual void blit(const MonoFrame::Window& window, const uint8_t* pixels) {(void)window; (void)pixels;}
+
+protected:
+    std::unique_ptr<FrameBuffer> m_frameBuffer;
 };
 
 /**
@@ -84,19 +115,46 @@ public:
     void flushBuffer() override;
 
     // Display specific commands
+    using BaseDisplayDevice::drawText;
     void clear() override;
-    void drawText(int x, int y, const std::string& text) override;
+    void drawText(int x, int y, const char* text, size_t length) override;
     void setCursor(int x, int y) override;
     void setInverted(bool inverted) override;
     void setBrightness(int brightness) override;
     void drawProgressBar(int x, int y, int width, int height, int percentage) override;
     void setPower(bool on) override;
 
+    // Send the shadow framebuffer diff (framebuffer mode only)
+    void present() override;
+    void repaint() override;
+
+    // Bitmap mode: render locally with the shared 1bpp renderer and send
+    // changed windows as CMD_BLIT (needs firmware with CMD_BLIT support)
+    void setBlitMode(bool enabled);
+    bool isBlitMode() const { return m_blitFrame != nullptr; }
+    bool isFrameBufferEnabled() const override { return m_frameBuffer != nullptr || m_blitFrame != nullptr; }
+    bool supportsBlit() const override { return isBlitMode(); }
+    void blit(const MonoFrame::Window& window, const uint8_t* pixels) override;
+
     bool isDisconnected() const override {
         return m_disconnected;
     }
 
 private:
+    // Immediate protocol encoders, bypassing the shadow framebuffer; gapUs is
+    // the link idle time required after the command
+    void sendClear(int gapUs = 0);
+    void sendText(int x, int y, const char* text, size_t length, int gapUs = 0);
+    void sendProgressBar(int x, int y, int width, int height, int percentage, int gapUs = 0);
+    void sendUpdate(const FrameBuffer::Update& update);
+
+    // Queue a frame on the writer thread, or write it synchronously if the
+    // writer could not be started
+    void sendFrame(const uint8_t* data, size_t length, int gapUs);
+    void presentBlit();
+    void sendBlit(const MonoFrame::Window& window, const uint8_t* pixels);
+    void invalidateShown();
+
     struct {
         uint8_t buffer[Config::CMD_BUFFER_SIZE];
         size_t used;
@@ -105,6 +163,16 @@ private:
 
     std::mutex m_mutex;
     std::atomic<bool> m_disconnected{false};
+    SerialWriter m_writer;
+
+    // Direct mode: what was drawn since the last clear, replayed by repaint()
+    FrameBuffer m_replay;
+    FrameBuffer::Update m_update;           // Reused by present() and repaint()
+
+    // Bitmap mode state: local frame plus what the device was last sent
+    std::unique_ptr<MonoFrame> m_blitFrame;
+    std::vector<uint8_t> m_blitShown;       // Empty while device contents are unknown
+    std::mutex m_blitMutex;
 };
 
 /**
@@ -128,14 +196,27 @@ public:
     bool checkConnection() const override;
 
     // Display commands
+    using BaseDisplayDevice::drawText;
     void clear() override;
-    void drawText(int x, int y, const std::string& text) override;
+    void drawText(int x, int y, const char* text, size_t length) override;
     void setCursor(int x, int y) override;
     void setInverted(bool inverted) override;
     void setBrightness(int brightness) override;
     void drawProgressBar(int x, int y, int width, int height, int percentage) override;
     void setPower(bool on) override;
 
+    // Deferred commit: draw calls only mark pages/columns dirty in the local
+    // buffer, and flushBuffer() (or present()) sends the dirty spans at once.
+    // The local buffer already is the framebuffer, so no display list is kept.
+    void setFrameBufferEnabled(bool enabled) override { m_deferredCommit = enabled; }
+    bool isFrameBufferEnabled() const override { return m_deferredCommit; }
+    void present() override { flushBuffer(); }
+    void flushBuffer() override;
+
+    // The local buffer is the SSD1306 RAM image, so blits land in it directly
+    bool supportsBlit() const override { return true; }
+    void blit(const MonoFrame::Window& window, const uint8_t* pixels) override;
+
     bool isDisconnected() const override {
         return m_disconnected.load();
     }
@@ -172,17 +253,25 @@ private:
     bool writeData(const uint8_t* data, size_t length);
     bool initializeDisplay();
 
-    // Display buffer and cursor management
-    uint8_t m_displayBuffer[DISPLAY_WIDTH * DISPLAY_HEIGHT / 8];
-    uint8_t m_cursorX = 0;
-    uint8_t m_cursorY = 0;
+    // One I2C write (control byte included); several are combined per ioctl
+    struct Segment {
+        const uint8_t* data;
+        size_t length;
+    };
+    bool transferSegments(const Segment* segments, size_t count);
+
+    // Local frame and cursor, rendered with the shared 1bpp renderer
+    MonoFrame m_frame;
     bool m_inverted = false;
     std::atomic<bool> m_disconnected{false};
     std::mutex m_mutex;
 
-    // Font rendering
-    void drawCharacter(char c);
-    void updateDisplay(int startPage, int endPage, int startCol, int endCol);
+    bool m_deferredCommit = false;
+    bool m_rdwrSupported = true;    // Cleared if the adapter rejects I2C_RDWR
+
+    // Staging for flushes: per-page address commands and control-byte-prefixed data
+    uint8_t m_txCommands[DISPLAY_PAGES][7];
+    uint8_t m_txData[DISPLAY_PAGES + DISPLAY_WIDTH * DISPLAY_HEIGHT / 8];
 };
 
 /**
@@ -199,7 +288,8 @@ public:
 
     void setNonBlocking();
 
-    // Input processing
+    // Input processing; the two-callback form drops LONG_PRESS and key identity
+    bool processEvents(const InputHandler& onEvent);
     bool processEvents(std::function<void(int)> onRotation, std::function<void()> onButtonPress);
     int waitForEvents(int timeoutMs);
 
@@ -209,14 +299,13 @@ public:
 private:
     // EXISTING: Rotary encoder state tracking
     struct {
-        struct timeval lastKeyTime = {0, 0};
-        int consecutiveSameKey = 0;
-        int lastDirection = 0;
         struct timeval lastEventTime = {0, 0};
         int pairedEventCount = 0;
         int totalRelX = 0;
         int totalRelY = 0;  // Added to track vertical movement
+        struct timeval pressTime = {0, 0};      // Enter button down, zero when released
     } m_state;
+    EncoderAcceleration m_acceleration;
 
     // NEW: Keyboard synthesis state tracking
     struct {
@@ -231,14 +320,28 @@ private:
     } m_keyboardState;
 
     // NEW: Process pending keyboard synthesis events
-    void processKeyboardSynthesis(std::function<void(int)> onRotation);
+    void processKeyboardSynthesis(const InputHandler& onEvent);
 };
 
+struct udev;
+struct udev_device;
+struct udev_monitor;
+
 /**
  * Device detection and monitoring
+ *
+ * One udev monitor socket (input, tty and usb subsystems) stays open for the
+ * life of the process and is watched by the main event loop. Events are
+ * matched against the HMI VID:PID from their own properties; once both the
+ * input and the tty node of a plugged-in HMI are ready the pair is reported
+ * through the connect callback, and removal of the attached one through the
+ * disconnect callback. Callbacks run on the thread calling
+ * processHotplugEvents().
  */
 class DeviceManager {
 public:
+    using ConnectCallback = std::function<void(const std::string& inputDevice, const std::string& serialDevice)>;
+
     DeviceManager();
     ~DeviceManager();
 
@@ -248,18 +351,35 @@ public:
     bool checkDevicePresent() const;
     bool monitorDeviceUntilConnected(std::atomic<bool>& runningFlag);
 
-    // Disconnection monitoring
-    void startDisconnectionMonitor();
-    void stopDisconnectionMonitor();
+    // Hotplug monitoring
+    bool startHotplugMonitor();
+    int getMonitorFd() const { return m_monitorFd; }
+    void processHotplugEvents();
+    // Look for the HMI without waiting for an event (no udevd, missed events)
+    void rescan();
+    // Treat the attached HMI as gone, e.g. after a write error
+    void forgetDevice();
     bool isDeviceDisconnected() const;
+    void setHotplugCallbacks(ConnectCallback onConnect, std::function<void()> onDisconnect) {
+        m_connectCallback = onConnect;
+        m_disconnectCallback = onDisconnect;
+    }
 
 private:
     std::string findHmiInputDevice() const;
     std::string findHmiSerialDevice() const;
-    bool checkDevicePresentSilent() const;
-    void disconnectionMonitorThread();
-
+    bool findHmiNodes(std::string& inputDevice, std::string& serialDevice) const;
+    bool findHmiNodes(struct udev_device* usbDevice, std::string& inputDevice, std::string& serialDevice) const;
+    bool isHmiEvent(struct udev_device* device) const;
+    void handleHotplugEvent(struct udev_device* device);
+    void attach(const std::string& inputDevice, const std::string& serialDevice);
+
+    struct udev* m_udev = nullptr;
+    struct udev_monitor* m_monitor = nullptr;
+    int m_monitorFd = -1;
+    std::string m_inputNode;            // Attached HMI nodes, empty while unplugged
+    std::string m_serialNode;
     std::atomic<bool> m_deviceDisconnected{false};
-    std::atomic<bool> m_monitorThreadRunning{false};
-    std::thread m_monitorThread;
+    ConnectCallback m_connectCallback;
+    std::function<void()> m_disconnectCallback;
 };
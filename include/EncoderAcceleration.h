@@ -0,0 +1,47 @@
+#pragma once
+
+#include <string>
+#include <vector>
+#include <sys/time.h>
+
+/**
+ * Velocity-based rotary encoder acceleration
+ *
+ * Each detent is timed with the kernel timestamp of its input_event, so the
+ * estimate does not depend on when the main loop got around to reading it.
+ * The rate (detents per second) is smoothed over consecutive detents and
+ * mapped to a gain through a piecewise-linear curve shared by InputDevice and
+ * MultiInputDevice; fractional steps carry over to the next detent.
+ *
+ * Slow turns stay 1:1. Reversing direction or pausing for
+ * ENCODER_ACCEL_IDLE_MS starts again at 1:1 without any carry, so a
+ * correction after a fast spin never overshoots.
+ */
+class EncoderAcceleration {
+public:
+    struct Point {
+        double rate;    // Detents per second
+        double gain;    // Steps per detent at that rate
+    };
+
+    // "RATE:GAIN,RATE:GAIN,..." with ascending rates, or "off"
+    static bool parseCurve(const std::string& text, std::vector<Point>& curve);
+
+    // Curve used by every encoder; empty = no acceleration
+    static void setCurve(const std::vector<Point>& curve);
+    static const std::vector<Point>& curve();
+
+    // Signed steps for a detent reported at the given kernel time
+    int step(int direction, const struct timeval& time);
+    void reset();
+
+    double rate() const { return m_rate; }
+
+private:
+    static double gainAt(double rate);
+
+    long long m_lastUs = 0;
+    int m_direction = 0;
+    double m_rate = 0.0;
+    double m_carry = 0.0;
+};
@@ -0,0 +1,66 @@
+#pragma once
+
+#include <functional>
+#include <map>
+
+/**
+ * epoll-based reactor for the main and module loops
+ *
+ * Owns an epoll instance that watches input file descriptors, timerfd-backed
+ * deadlines (buffer flush, power save, module refresh) and an eventfd that
+ * other threads can signal through wake(). The loop thread blocks in runOnce()
+ * until one of those becomes ready, so an idle panel does not wake up at all.
+ *
+ * Handlers run on the thread calling runOnce() and may register or remove
+ * sources, or call runOnce() again (modules run nested inside menu actions).
+ */
+class EventLoop {
+public:
+    using Handler = std::function<void()>;
+
+    EventLoop();
+    ~EventLoop();
+
+    EventLoop(const EventLoop&) = delete;
+    EventLoop& operator=(const EventLoop&) = delete;
+
+    bool isValid() const { return m_epollFd >= 0 && m_wakeFd >= 0; }
+
+    // Readable file descriptors (level-triggered); re-adding an fd replaces its handler
+    bool addFd(int fd, Handler onReadable);
+    void removeFd(int fd);
+
+    // Timers start disarmed; the returned id is valid until removeTimer()
+    int addTimer(Handler onExpire);
+    void armTimer(int id, int delayMs, int intervalMs = 0);
+    void disarmTimer(int id);
+    bool isTimerArmed(int id) const;
+    void removeTimer(int id);
+
+    // Thread-safe: make the loop run the wake handler on its own thread
+    void wake();
+    void setWakeHandler(Handler onWake) { m_wakeHandler = onWake; }
+
+    // Wait up to timeoutMs (-1 = forever) and dispatch ready sources.
+    // Returns the number of sources dispatched, 0 on timeout or signal.
+    int runOnce(int timeoutMs = -1);
+
+private:
+    enum class SourceType {
+        FD,
+        TIMER
+    };
+
+    struct Source {
+        SourceType type;
+        Handler handler;
+        bool armed = false;
+    };
+
+    static constexpr int MAX_EVENTS = 16;
+
+    int m_epollFd = -1;
+    int m_wakeFd = -1;
+    Handler m_wakeHandler;
+    std::map<int, Source> m_sources;
+};
@@ -0,0 +1,33 @@
+#pragma once
+
+#include <string>
+
+/**
+ * inotify watch on a single file
+ *
+ * The containing directory is watched rather than the file, so tools that
+ * write a temporary file and rename() it into place are seen as well as
+ * in-place writes, and the watch survives the file being replaced. The fd is
+ * meant for the event loop; consumeEvents() drains it.
+ */
+class FileWatcher {
+public:
+    FileWatcher() = default;
+    ~FileWatcher();
+
+    FileWatcher(const FileWatcher&) = delete;
+    FileWatcher& operator=(const FileWatcher&) = delete;
+
+    bool watch(const std::string& path);
+    void stop();
+
+    int getFd() const { return m_fd; }
+
+    // Drain pending events; true if one of them finished a write to the file
+    bool consumeEvents();
+
+private:
+    int m_fd = -1;
+    int m_watch = -1;
+    std::string m_name;     // File name within the watched directory
+};
@@ -0,0 +1,30 @@
+#pragma once
+
+#include <cstdint>
+
+/**
+ * Glyph tables pre-rotated into SSD1306 page/column order
+ *
+ * Built at compile time from Font8x8, so drawing a glyph is a plain copy of
+ * column bytes (bit 0 = top pixel) into a page-layout buffer. A glyph
+ * occupies `pages` consecutive pages of `width` columns each, stored top
+ * page first; `width` is also the advance, spacing included.
+ */
+struct GlyphFace {
+    int width;
+    int pages;
+    const uint8_t* data;    // 128 glyphs of width * pages bytes
+
+    // Column bytes of one page of a glyph; non-ASCII renders as '?'
+    const uint8_t* glyph(char c, int page = 0) const {
+        unsigned char index = static_cast<unsigned char>(c);
+        if (index > 127) index = '?';
+        return data + (index * pages + page) * width;
+    }
+};
+
+namespace Fonts {
+    extern const GlyphFace NORMAL;      // 8x8, the font the rest of the UI uses
+    extern const GlyphFace CONDENSED;   // 6x8, Config::CHAR_WIDTH advance
+    extern const GlyphFace LARGE;       // 16x16, NORMAL pixel-doubled for readouts
+}
@@ -0,0 +1,110 @@
+#pragma once
+
+#include <string>
+#include <vector>
+#include <mutex>
+#include "Config.h"
+#include "TextLine.h"
+
+/**
+ * Host-side shadow framebuffer for displays driven over the serial protocol
+ *
+ * Drawing calls are recorded into a pending frame (a display list of text and
+ * progress bar operations) instead of being sent immediately. present() diffs
+ * the pending frame against the frame the device is already showing and returns
+ * the minimal set of protocol operations that bring the device up to date:
+ * changed character spans of text, erasures for removed items and repaints of
+ * items damaged by those erasures. clear() only starts a new pending frame, so
+ * the device never sees CMD_CLEAR unless a full redraw is cheaper.
+ *
+ * Op text is stored inline and the diff works in member scratch buffers, so
+ * once those have grown to a frame's size neither drawing nor present()
+ * touches the heap.
+ */
+class FrameBuffer {
+public:
+    enum class OpType {
+        TEXT,
+        PROGRESS_BAR
+    };
+
+    // Longer text is cut; that is several rows past the right edge
+    static constexpr size_t MAX_TEXT = 64;
+    using Text = BasicTextLine<MAX_TEXT>;
+
+    struct Op {
+        OpType type = OpType::TEXT;
+        int x = 0;
+        int y = 0;
+        Text text;              // TEXT only
+        int width = 0;          // PROGRESS_BAR only
+        int height = 0;         // PROGRESS_BAR only
+        int percentage = 0;     // PROGRESS_BAR only
+    };
+
+    // Operations needed to bring the device in line with the pending frame
+    struct Update {
+        bool fullRedraw = false;    // Send CMD_CLEAR before the ops
+        std::vector<Op> ops;        // In send order
+        size_t bytes = 0;           // Estimated protocol bytes
+    };
+
+    FrameBuffer();
+
+    // Frame composition
+    void beginFrame();
+    void drawText(int x, int y, const char* text, size_t length);
+    void drawText(int x, int y, const std::string& text) { drawText(x, y, text.data(), text.size()); }
+    void drawProgressBar(int x, int y, int width, int height, int percentage);
+
+    // Diff pending against shown into update (its storage is reused); the
+    // pending frame becomes the shown frame
+    void present(Update& update);
+
+    // Device contents are unknown (reconnect, external clear); next present is a full redraw
+    void invalidate();
+
+    bool isDirty() const;
+
+    // Protocol size of a single operation
+    static size_t opBytes(const Op& op);
+
+private:
+    struct Rect {
+        int x0, y0, x1, y1;     // Half-open [x0, x1) x [y0, y1)
+        bool intersects(const Rect& other) const {
+            return x0 < other.x1 && other.x0 < x1 && y0 < other.y1 && other.y0 < y1;
+        }
+        bool contains(const Rect& other) const {
+            return x0 <= other.x0 && y0 <= other.y0 && x1 >= other.x1 && y1 >= other.y1;
+        }
+    };
+
+    static Rect bounds(const Op& op);
+    static bool sameSlot(const Op& a, const Op& b);
+    static bool sameContent(const Op& a, const Op& b);
+    static Op textOp(int x, int y, const char* text, size_t length);
+    static bool isBlank(const Text& text);
+    void addOp(const Op& op);
+    void appendEraseOps(const Op& op, std::vector<Op>& out) const;
+
+    // Upper bound on retained operations before the frame is rebuilt from scratch
+    static constexpr size_t MAX_FRAME_OPS = 128;
+
+    std::vector<Op> m_pending;
+    std::vector<Op> m_shown;
+
+    // present() scratch, kept for its capacity
+    struct Damage {
+        int owner;              // Index of the pending op that caused it, -1 for erasures
+        Rect area;
+    };
+    std::vector<uint8_t> m_modes;
+    std::vector<Op> m_spans;
+    std::vector<uint8_t> m_matched;
+    std::vector<Damage> m_damage;
+    std::vector<Op> m_erasures;
+    bool m_dirty = false;
+    bool m_forceFull = true;    // Device contents unknown until the first present
+    mutable std::mutex m_mutex;
+};
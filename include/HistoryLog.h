@@ -0,0 +1,116 @@
+#pragma once
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <string>
+
+/**
+ * Measurement history: a fixed-size ring of 16-byte records in a
+ * memory-mapped file
+ *
+ * append() claims the next sequence number with one atomic add and copies
+ * the record into the shared mapping, so screens log results from the UI
+ * thread without a syscall, lock or allocation; the kernel writes the pages
+ * back. Record n lives in slot n % capacity. Every record carries its own
+ * sequence number and a checksum, so there is no head pointer to keep
+ * consistent: open() scans the ring for the newest valid record, and a
+ * record torn by a crash or power cut fails its checksum and is skipped.
+ *
+ * Readers (TrendScreen, exports) walk the mapping directly; another
+ * process can open the same file read-only while micropanel appends.
+ */
+class HistoryLog {
+public:
+    enum class Kind : uint8_t {
+        PING_RTT = 1,           // ms; failed = timed out
+        SPEED_DOWN,             // Mbps (SpeedTestScreen)
+        SPEED_UP,
+        THROUGHPUT_UP,          // Mbps (ThroughputClientScreen, we send)
+        THROUGHPUT_DOWN,        // Reverse mode, the server sends
+        INTERNET_RTT,           // TCP connect ms (InternetTestScreen); failed = no TCP
+    };
+    static constexpr int KIND_COUNT = 6;
+
+    enum Flags : uint8_t {
+        FLAG_FAILED = 1
+    };
+
+    struct Record {
+        uint32_t time;          // Unix seconds
+        uint32_t sequence;      // Low 32 bits of the record number; 0 = never written
+        float value;
+        uint8_t kind;
+        uint8_t flags;
+        uint16_t check;
+
+        bool failed() const { return (flags & FLAG_FAILED) != 0; }
+    };
+    static_assert(sizeof(Record) == 16, "HistoryLog::Record is an on-disk format");
+
+    static HistoryLog& getInstance();
+
+    HistoryLog(const HistoryLog&) = delete;
+    HistoryLog& operator=(const HistoryLog&) = delete;
+
+    // Map path, creating it with `capacity` records if missing or unusable;
+    // an existing ring keeps its own capacity
+    bool open(const std::string& path, size_t capacity, bool readOnly = false);
+    void close();
+    bool isOpen() const { return m_records != nullptr; }
+
+    // No-op while closed
+    void append(Kind kind, double value, bool failed = false);
+
+    // Record number after the newest one; records run from
+    // max(1, end() - capacity()) up to end() - 1
+    uint64_t end() const { return m_next.load(std::memory_order_acquire); }
+    size_t capacity() const { return m_capacity; }
+
+    // Copy of record `number` if its slot still holds it intact
+    bool load(uint64_t number, Record& record) const;
+
+    // Visit up to `limit` valid records of a kind, newest first; visit()
+    // returns false to stop. Returns the number visited.
+    template <typename Visitor>
+    size_t forEachNewest(Kind kind, size_t limit, Visitor visit) const;
+
+    // CSV, or JSON when path ends in ".json"; oldest first
+    bool exportTo(const std::string& path) const;
+
+    static const char* kindName(Kind kind);     // "ping_rtt_ms", ...
+    static const char* kindLabel(Kind kind);    // "Ping ms", ...
+
+private:
+    struct Header;
+
+    HistoryLog() = default;
+    ~HistoryLog();
+
+    static uint16_t checksum(const Record& record);
+
+    void* m_map = nullptr;
+    size_t m_mapSize = 0;
+    Record* m_records = nullptr;
+    size_t m_capacity = 0;
+    std::atomic<uint64_t> m_next{1};
+};
+
+template <typename Visitor>
+size_t HistoryLog::forEachNewest(Kind kind, size_t limit, Visitor visit) const
+{
+    size_t visited = 0;
+    uint64_t last = end();
+    uint64_t first = last > m_capacity ? last - m_capacity : 1;
+    Record record;
+    for (uint64_t number = last; number-- > first && visited < limit;) {
+        if (!load(number, record) || record.kind != static_cast<uint8_t>(kind)) {
+            continue;
+        }
+        visited++;
+        if (!visit(record)) {
+            break;
+        }
+    }
+    return visited;
+}
@@ -0,0 +1,88 @@
+#pragma once
+
+#include <atomic>
+#include <cstdint>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+/**
+ * @class HttpSpeedTest
+ * @brief Parallel-connection HTTP download/upload throughput probe
+ *
+ * Runs N concurrent libcurl transfers on one multi handle from a background
+ * thread. A transfer that finishes early is restarted, so every connection
+ * stays busy for the whole test. Bytes are counted from each transfer's
+ * CURLOPT_XFERINFOFUNCTION callback and sampled at a fixed period for a
+ * live graph; bytes moved during the warm-up window (connect, TLS, TCP slow
+ * start) are excluded from the final rate.
+ */
+class HttpSpeedTest {
+public:
+    enum class Direction { DOWNLOAD, UPLOAD };
+
+    struct Options {
+        std::string url;
+        Direction direction = Direction::DOWNLOAD;
+        int connections = 4;
+        int warmupMs = 2000;
+        int durationMs = 10000;         // Measured window after warm-up
+        int sampleMs = 250;
+    };
+
+    struct Sample {
+        double seconds = 0.0;           // End of the sample since start
+        double mbps = 0.0;
+        bool warmup = false;            // Excluded from the result
+    };
+
+    struct Result {
+        bool valid = false;
+        bool cancelled = false;
+        std::string error;
+        double mbps = 0.0;
+        uint64_t bytes = 0;             // Measured window only
+        double seconds = 0.0;
+        int connections = 0;            // Connections that moved data
+    };
+
+    HttpSpeedTest();
+    ~HttpSpeedTest();
+
+    HttpSpeedTest(const HttpSpeedTest&) = delete;
+    HttpSpeedTest& operator=(const HttpSpeedTest&) = delete;
+
+    // Start a test in the background; false if one is already running
+    bool start(const Options& options);
+
+    // Abort a running test and wait for the worker thread
+    void cancel();
+
+    bool isRunning() const { return m_running.load(); }
+
+    // 0.0 - 1.0 of the planned warm-up + measurement time
+    double getProgress() const;
+
+    // Append samples from index `from` onwards; returns the new total
+    size_t getSamples(std::vector<Sample>& out, size_t from) const;
+
+    // Valid once isRunning() turns false
+    Result getResult() const;
+
+private:
+    void run();
+    void finish(const Result& result);
+
+    Options m_options;
+    std::vector<char> m_uploadBlock;    // Shared payload for upload reads
+
+    std::thread m_thread;
+    std::atomic<bool> m_running{false};
+    std::atomic<bool> m_cancel{false};
+    std::atomic<double> m_progress{0.0};
+
+    mutable std::mutex m_resultMutex;
+    std::vector<Sample> m_samples;
+    Result m_result;
+};
@@ -2,6 +2,8 @@
 
 #include <string>
 #include <functional>
+#include <vector>
+#include "IPSuggestions.h"
 
 /**
  * @class IPSelector
@@ -9,6 +11,11 @@
  *
  * This class provides a UI element for selecting and editing an IP address.
  * It supports cursor navigation and digit editing modes.
+ *
+ * With suggestions enabled the first press offers IPSuggestions instead:
+ * rotation spins through them (the address line previews each, newest
+ * first) and a press takes one. Position 0 is the current address, where a
+ * press goes on to digit editing as before.
  */
 class IPSelector {
 public:
@@ -74,12 +81,19 @@ public:
      */
     bool isEditing() const;
 
+    /**
+     * @brief Offer IPSuggestions on the first press (targets, not own settings)
+     */
+    void enableSuggestions(bool enabled = true) { m_suggestionsEnabled = enabled; }
+
 private:
-    // Increment the digit at cursor position
-    void incrementDigit();
+    // Spin position 0 = current address, 1.. = m_suggestions
+    bool handleSuggestButton();
+    void previewSuggestion();
+
 
-    // Decrement the digit at cursor position
-    void decrementDigit();
+    // Change the digit at cursor position by steps, wrapping between 9 and 0
+    void stepDigit(int steps);
 
     // Move cursor left, skipping dots
     void moveCursorLeft();
@@ -92,6 +106,11 @@ private:
     bool m_cursorMode = false;                            // Whether cursor positioning mode is active
     bool m_digitEditMode = false;                         // Whether digit edit mode is active
     int m_yPosition = 0;                                  // Y position on the display
+    bool m_suggestionsEnabled = false;
+    bool m_suggestMode = false;                           // Spinning through suggestions
+    int m_suggestIndex = 0;
+    std::vector<IPSuggestions::Candidate> m_suggestions;  // Snapshot taken on entering
+    std::string m_shownIp;                                // Address line while spinning
     std::function<void(const std::string&)> m_onIpChanged; // Callback when IP is changed
     std::function<void()> m_onRedraw;                     // Callback to trigger redraw
 };
@@ -0,0 +1,58 @@
+#pragma once
+
+#include <cstdint>
+#include <map>
+#include <mutex>
+#include <string>
+#include <vector>
+
+/**
+ * @class IPSuggestions
+ * @brief Addresses worth offering in an IPSelector, newest first
+ *
+ * Merges three sources by address, keeping the most recent sighting:
+ *
+ *   NEIGHBOR - the kernel's IPv4 neighbour table as NetworkState follows it
+ *              over rtnetlink, so a device that just came up and ARPed is
+ *              at the top
+ *   RECENT   - targets the user pinged or tested, kept in PersistentStorage
+ *   SWEEP    - hosts found by the last subnet sweeps (this run only)
+ *
+ * This unit's own addresses are never suggested.
+ */
+class IPSuggestions {
+public:
+    enum class Source { NEIGHBOR, RECENT, SWEEP };
+
+    struct Candidate {
+        std::string ip;                 // Dotted, without leading zeros
+        Source source = Source::NEIGHBOR;
+        int64_t seen = 0;               // Unix seconds
+    };
+
+    static IPSuggestions& getInstance();
+
+    IPSuggestions(const IPSuggestions&) = delete;
+    IPSuggestions& operator=(const IPSuggestions&) = delete;
+
+    // Up to `limit` candidates ranked by recency, without `exclude`
+    std::vector<Candidate> candidates(size_t limit, const std::string& exclude = "") const;
+
+    // A target the user just used; persisted
+    void remember(const std::string& ip);
+    // A host a sweep found
+    void addSweepHost(const std::string& ip);
+
+    // Four-character tag for the selector's second row
+    static const char* sourceTag(Source source);
+
+private:
+    IPSuggestions() = default;
+
+    void loadRecent() const;
+
+    mutable std::mutex m_mutex;
+    mutable bool m_recentLoaded = false;
+    mutable std::vector<Candidate> m_recent;    // Newest first
+    std::map<std::string, int64_t> m_sweep;     // Address -> when found
+};
@@ -0,0 +1,121 @@
+#pragma once
+
+#include <atomic>
+#include <cstdint>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+#include <netinet/in.h>
+
+/**
+ * @class IcmpPinger
+ * @brief In-process continuous ICMP echo engine
+ *
+ * Sends echo requests from a worker thread and tracks RTT statistics without
+ * spawning ping. Uses an unprivileged ICMP datagram socket
+ * (net.ipv4.ping_group_range) and falls back to a raw socket when that is
+ * not permitted. Send and receive times are taken on CLOCK_MONOTONIC in
+ * microseconds; the receive side prefers the kernel SO_TIMESTAMPNS stamp
+ * (paired with a CLOCK_REALTIME send stamp) so scheduling delay on slow
+ * boards does not inflate the RTT.
+ */
+class IcmpPinger {
+public:
+    struct Stats {
+        unsigned int sent = 0;
+        unsigned int received = 0;
+        unsigned int lost = 0;       // Requests whose reply timed out
+        double lastMs = 0.0;
+        double minMs = 0.0;
+        double avgMs = 0.0;
+        double maxMs = 0.0;
+        double jitterMs = 0.0;       // Smoothed |RTT(n) - RTT(n-1)|, RFC 3550 style
+        unsigned int generation = 0; // Bumped on every change
+        bool error = false;          // Socket or send failure, see errorMessage
+        std::string errorMessage;
+
+        // Loss over completed requests (replied or timed out)
+        int lossPercent() const {
+            unsigned int completed = received + lost;
+            return completed ? static_cast<int>((lost * 100 + completed / 2) / completed) : 0;
+        }
+    };
+
+    IcmpPinger();
+    ~IcmpPinger();
+
+    IcmpPinger(const IcmpPinger&) = delete;
+    IcmpPinger& operator=(const IcmpPinger&) = delete;
+
+    /**
+     * @brief Start pinging a dotted IPv4 address (leading zeros allowed)
+     *
+     * @param address Target address, e.g. "192.168.001.001"
+     * @param intervalMs Time between requests
+     * @param timeoutMs Time after which a request counts as lost
+     * @param keepSamples Also keep every RTT for getSamples() (bounded runs only)
+     * @return false if the address is invalid or no ICMP socket could be opened
+     */
+    bool start(const std::string& address, int intervalMs = 1000, int timeoutMs = 2000,
+               bool keepSamples = false);
+
+    void stop();
+
+    // Stop and forget the statistics of the last run
+    void reset();
+
+    bool isRunning() const { return m_running.load(); }
+
+    Stats getStats() const;
+
+    // Append RTTs (ms, in arrival order) from index `from` onwards; returns the new total
+    size_t getSamples(std::vector<double>& out, size_t from) const;
+
+    // Parse an IPv4 address whose octets may carry leading zeros (decimal)
+    static bool parseAddress(const std::string& address, in_addr& out);
+
+    // Non-blocking ICMP socket, datagram if permitted else raw (raw set true);
+    // returns -1 with errno from the datagram attempt on failure
+    static int openIcmpSocket(bool& raw);
+
+    // Internet checksum in network byte order
+    static uint16_t checksum(const uint8_t* data, size_t length);
+
+private:
+    static constexpr int SEQ_SLOTS = 64;    // Outstanding requests tracked
+
+    struct Pending {
+        uint16_t seq = 0;
+        bool active = false;
+        int64_t sentMonoUs = 0;
+        int64_t sentRealUs = 0;
+    };
+
+    bool openSocket();
+    void run();
+    bool sendRequest();
+    void receiveReplies();
+    void expireRequests(int64_t nowUs);
+    void recordReply(double rttMs);
+    void setError(const std::string& message);
+
+    int m_fd = -1;
+    bool m_raw = false;
+    uint16_t m_ident = 0;
+    uint16_t m_nextSeq = 0;
+    sockaddr_in m_target{};
+    int m_intervalMs = 1000;
+    int m_timeoutMs = 2000;
+    Pending m_pending[SEQ_SLOTS];
+
+    std::thread m_thread;
+    std::atomic<bool> m_running{false};
+    int m_wakeFd = -1;
+
+    mutable std::mutex m_statsMutex;
+    Stats m_stats;
+    double m_sumMs = 0.0;
+    bool m_keepSamples = false;
+    std::vector<double> m_samples;
+};
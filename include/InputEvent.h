@@ -0,0 +1,46 @@
+#pragma once
+
+#include <functional>
+#include <sys/time.h>
+
+/**
+ * One user input, as produced by InputDevice (USB HMI) and MultiInputDevice
+ * (GPIO buttons and rotary encoders) alike
+ *
+ * ROTATE comes from relative axes, KEY from directional buttons. A ROTATE
+ * delta counts steps after encoder acceleration (one per detent when turned
+ * slowly); a KEY delta is ±5 per press. steps() gives both as the number of
+ * positions to move, which is what the handlers receive. PRESS is sent
+ * when the enter button goes down; LONG_PRESS follows on release when it was
+ * held for Config::LONG_PRESS_MS or more. The timestamp is the kernel's, not
+ * the time the event was read.
+ */
+struct InputEvent {
+    enum class Type {
+        ROTATE,
+        PRESS,
+        LONG_PRESS,
+        KEY
+    };
+
+    enum class Key {
+        NONE,
+        UP,
+        DOWN,
+        LEFT,
+        RIGHT
+    };
+
+    Type type = Type::PRESS;
+    Key key = Key::NONE;
+    int delta = 0;
+    struct timeval time = {0, 0};
+
+    // Rotation and directional keys both move the selection
+    bool isMovement() const { return type == Type::ROTATE || type == Type::KEY; }
+
+    // Signed positions to move: accelerated detents, or one per key press
+    int steps() const { return type == Type::KEY ? (delta > 0) - (delta < 0) : delta; }
+};
+
+using InputHandler = std::function<void(const InputEvent&)>;
@@ -0,0 +1,138 @@
+#pragma once
+
+#include <atomic>
+#include <cstdint>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+/**
+ * @class Iperf3Client
+ * @brief In-process iperf3-compatible TCP/UDP load generator
+ *
+ * Speaks the iperf3 control protocol, so any iperf3 server (and
+ * ThroughputServerScreen) can be tested against without the iperf3 binary.
+ * A control thread drives the test; every stream gets its own thread,
+ * pinned round-robin to the online cores. TCP payload is sent with
+ * sendfile() from a preallocated memfd, so the kernel never copies it from
+ * userspace; received TCP data is discarded in the kernel with MSG_TRUNC.
+ * UDP uses sendmmsg/recvmmsg batches with iperf3's packet header.
+ *
+ * Per-second intervals are published as they complete, the final result
+ * combines local counters with the server's results exchange.
+ */
+class Iperf3Client {
+public:
+    struct Options {
+        std::string host;
+        int port = 5201;
+        bool udp = false;
+        bool reverse = false;           // Server sends, we receive
+        int durationSec = 10;
+        uint64_t bitrate = 0;           // Per stream, bits/s; 0 = unlimited TCP, 1 Mbit/s UDP
+        int parallel = 1;
+        size_t blockSize = 0;           // 0 = 128 KiB TCP, 1460 bytes UDP
+        size_t window = 0;              // Socket buffer size, 0 = system default
+    };
+
+    struct Interval {
+        double start = 0.0;             // Seconds since the test started
+        double end = 0.0;
+        double bitsPerSecond = 0.0;
+        int retransmits = 0;            // TCP sender only
+        double jitterMs = 0.0;          // UDP receiver only
+        double lostPercent = 0.0;       // UDP receiver only
+    };
+
+    struct Result {
+        bool valid = false;
+        bool cancelled = false;
+        std::string error;
+        double seconds = 0.0;
+        double senderBitsPerSecond = 0.0;
+        double receiverBitsPerSecond = 0.0;
+        int retransmits = 0;
+        double jitterMs = 0.0;
+        long lostPackets = 0;
+        long totalPackets = 0;
+        double lostPercent = 0.0;
+    };
+
+    Iperf3Client();
+    ~Iperf3Client();
+
+    Iperf3Client(const Iperf3Client&) = delete;
+    Iperf3Client& operator=(const Iperf3Client&) = delete;
+
+    // Start a test in the background; false if one is already running
+    bool start(const Options& options);
+
+    // Abort a running test (sends CLIENT_TERMINATE) and wait for it
+    void cancel();
+
+    bool isRunning() const { return m_running.load(); }
+
+    // Elapsed test time, 0 until the server starts the test
+    double getElapsed() const;
+
+    // Append intervals from index `from` onwards; returns the new total
+    size_t getIntervals(std::vector<Interval>& out, size_t from) const;
+
+    // Valid once isRunning() turns false
+    Result getResult() const;
+
+private:
+    struct Stream;
+
+    void run();
+    bool connectControl();
+    bool createStreams();
+    bool connectTcpStream(Stream& stream);
+    bool connectUdpStream(Stream& stream);
+    void startStreamThreads();
+    void stopStreamThreads();
+    bool runTest();
+    bool exchangeResults();
+    bool waitState(int8_t& state, int timeoutMs);
+    bool waitForState(int8_t expected, int timeoutMs);
+    void sampleInterval(double now);
+    int readRetransmits(const Stream& stream) const;
+    std::string buildParameters() const;
+    std::string buildResults() const;
+    void applyServerResults(const std::string& json);
+    void fail(const std::string& message);
+    int connectSocket(int type, int timeoutMs);
+
+    void tcpSender(Stream& stream);
+    void tcpReceiver(Stream& stream);
+    void udpSender(Stream& stream);
+    void udpReceiver(Stream& stream);
+
+    Options m_options;
+    std::string m_cookie;
+    int m_controlFd = -1;
+    int m_wakeFd = -1;
+    int m_payloadFd = -1;               // memfd with one block of payload
+    std::vector<uint8_t> m_payload;
+    std::vector<std::unique_ptr<Stream>> m_streams;
+
+    std::thread m_thread;
+    std::atomic<bool> m_running{false};
+    std::atomic<bool> m_cancel{false};
+    std::atomic<bool> m_streamsActive{false};
+    std::atomic<int64_t> m_startUs{0};
+    double m_duration = 0.0;
+
+    // Interval sampling state (control thread only)
+    uint64_t m_lastBytes = 0;
+    int m_lastRetransmits = 0;
+    uint64_t m_lastPackets = 0;
+    uint64_t m_lastErrors = 0;
+    double m_lastSample = 0.0;
+
+    mutable std::mutex m_resultMutex;
+    std::vector<Interval> m_intervals;
+    Result m_result;
+};
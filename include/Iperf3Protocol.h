@@ -0,0 +1,58 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+
+/**
+ * iperf3 control protocol helpers
+ *
+ * The control connection carries one signed state byte per transition and
+ * length-prefixed JSON (4-byte network order length, no terminator) for the
+ * test parameters and results. Data connections start with the same 37-byte
+ * cookie as the control connection (TCP) or a 4-byte connect datagram (UDP).
+ * UDP data packets start with sec/usec/sequence, all 32-bit network order.
+ */
+namespace Iperf3Protocol {
+    // Control states
+    constexpr int8_t TEST_START = 1;
+    constexpr int8_t TEST_RUNNING = 2;
+    constexpr int8_t TEST_END = 4;
+    constexpr int8_t PARAM_EXCHANGE = 9;
+    constexpr int8_t CREATE_STREAMS = 10;
+    constexpr int8_t SERVER_TERMINATE = 11;
+    constexpr int8_t CLIENT_TERMINATE = 12;
+    constexpr int8_t EXCHANGE_RESULTS = 13;
+    constexpr int8_t DISPLAY_RESULTS = 14;
+    constexpr int8_t IPERF_START = 15;
+    constexpr int8_t IPERF_DONE = 16;
+    constexpr int8_t ACCESS_DENIED = -1;
+    constexpr int8_t SERVER_ERROR = -2;
+
+    constexpr size_t COOKIE_SIZE = 37;              // 36 characters + NUL
+    constexpr int DEFAULT_PORT = 5201;
+    constexpr size_t DEFAULT_TCP_BLOCK = 128 * 1024;
+    constexpr size_t UDP_HEADER_SIZE = 12;          // sec, usec, 32-bit sequence
+    constexpr size_t MAX_JSON_SIZE = 1024 * 1024;
+
+    // UDP stream setup datagrams, written in host byte order like iperf3
+    constexpr uint32_t UDP_CONNECT_MSG = 0x36373839;
+    constexpr uint32_t UDP_CONNECT_REPLY = 0x39383736;
+    constexpr uint32_t LEGACY_UDP_CONNECT_MSG = 123456789;
+    constexpr uint32_t LEGACY_UDP_CONNECT_REPLY = 987654321;
+
+    // Random cookie identifying one test on every connection
+    std::string makeCookie();
+
+    // Blocking-style I/O on non-blocking sockets; each call fails after
+    // timeoutMs without progress or when the peer closes
+    bool writeAll(int fd, const void* data, size_t length, int timeoutMs);
+    bool readAll(int fd, void* data, size_t length, int timeoutMs);
+
+    bool writeState(int fd, int8_t state, int timeoutMs);
+    bool writeJson(int fd, const std::string& json, int timeoutMs);
+    bool readJson(int fd, std::string& json, int timeoutMs);
+
+    // Human-readable name for log messages
+    const char* stateName(int8_t state);
+}
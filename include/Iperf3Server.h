@@ -0,0 +1,121 @@
+#pragma once
+
+#include <atomic>
+#include <cstdint>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+/**
+ * @class Iperf3Server
+ * @brief In-process iperf3-compatible server for many concurrent clients
+ *
+ * One epoll thread accepts control and data connections on a single port
+ * and runs any number of tests side by side (stock iperf3 serves one at a
+ * time). Received TCP payload is spliced from the socket through a pipe
+ * into /dev/null so it never reaches userspace; UDP streams are drained
+ * with recvmmsg, copying only the 12/16-byte iperf3 header. Reverse (-R)
+ * tests are sent with sendfile() from a memfd and paced sendmmsg batches.
+ *
+ * Live per-client state is published once a second for the panel.
+ */
+class Iperf3Server {
+public:
+    struct ClientInfo {
+        std::string address;
+        bool udp = false;
+        bool reverse = false;           // We send, the client receives
+        int streams = 0;
+        int durationSec = 0;
+        double elapsed = 0.0;
+        double mbps = 0.0;              // Last second
+        double averageMbps = 0.0;       // Since the test started
+        double jitterMs = 0.0;          // UDP, we receive
+        double lostPercent = 0.0;       // UDP, we receive
+        bool finished = false;          // Kept briefly after the test ends
+    };
+
+    Iperf3Server();
+    ~Iperf3Server();
+
+    Iperf3Server(const Iperf3Server&) = delete;
+    Iperf3Server& operator=(const Iperf3Server&) = delete;
+
+    // Listen on port (IPv6 dual-stack, IPv4 fallback); false if bind fails
+    bool start(int port);
+    void stop();
+    bool isRunning() const { return m_running.load(); }
+    int getPort() const { return m_port; }
+
+    // Tests in progress plus recently finished ones
+    std::vector<ClientInfo> getClients() const;
+
+    // Tests completed since start()
+    int getCompletedTests() const { return m_completed.load(); }
+
+private:
+    struct Endpoint;
+    struct Stream;
+    struct Test;
+    struct Pending;
+
+    void run();
+    bool openListeners();
+    int openUdpListener();
+    void handleEvent(Endpoint* endpoint, uint32_t events);
+    void acceptConnections();
+    void readPending(Pending& pending);
+    void startTest(std::unique_ptr<Pending> pending);
+    void attachTcpStream(Test& test, int fd);
+    void acceptUdpStream();
+    void readControl(Test& test);
+    bool processControl(Test& test);
+    bool parseParameters(Test& test, const std::string& json);
+    void beginTest(Test& test);
+    void endTest(Test& test);
+    std::string buildResults(const Test& test) const;
+    void closeTest(Test& test, const std::string& reason);
+    void closeStream(Stream& stream);
+    void receiveTcp(Stream& stream);
+    void receiveUdp(Stream& stream);
+    void sendTcp(Stream& stream);
+    void sendUdp(Stream& stream);
+    void onTimer();
+    void updateTimer();
+    void housekeeping();
+    void publishClients();
+    void removeDead();
+    bool setEvents(int fd, Endpoint* endpoint, uint32_t events, bool add);
+
+    int m_port = 5201;
+    int m_family = 0;                   // AF_INET6 (dual-stack) or AF_INET
+    int m_epollFd = -1;
+    int m_wakeFd = -1;
+    int m_timerFd = -1;                 // 1 ms pacing tick for reverse tests
+    bool m_timerArmed = false;
+    int m_tcpListenFd = -1;
+    int m_udpListenFd = -1;
+    int m_devNullFd = -1;
+    int m_payloadFd = -1;               // memfd holding one TCP send block
+    size_t m_payloadSize = 0;
+    std::vector<uint8_t> m_payload;
+    std::unique_ptr<Endpoint> m_tcpListenEndpoint;
+    std::unique_ptr<Endpoint> m_udpListenEndpoint;
+    std::unique_ptr<Endpoint> m_wakeEndpoint;
+    std::unique_ptr<Endpoint> m_timerEndpoint;
+
+    std::vector<std::unique_ptr<Pending>> m_pending;
+    std::vector<std::unique_ptr<Test>> m_tests;
+    std::vector<ClientInfo> m_finished;
+    std::vector<int64_t> m_finishedAt;
+
+    std::thread m_thread;
+    std::atomic<bool> m_running{false};
+    std::atomic<bool> m_stop{false};
+    std::atomic<int> m_completed{0};
+
+    mutable std::mutex m_clientsMutex;
+    std::vector<ClientInfo> m_clients;
+};
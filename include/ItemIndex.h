@@ -0,0 +1,59 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <vector>
+
+/**
+ * Compact store for long lists of item titles
+ *
+ * Titles are appended to one text arena with a 32-bit offset each, so ten
+ * thousand entries cost their characters plus 8 bytes apiece instead of a
+ * full ListItem. A case-insensitive sorted index is built lazily, on the
+ * first prefix query after an append, and serves prefix ranges, next
+ * character sets for encoder-driven search and title lookups in O(log n).
+ */
+class ItemIndex {
+public:
+    static constexpr size_t npos = static_cast<size_t>(-1);
+
+    // Positions [begin, end) in sorted order
+    struct Range {
+        size_t begin = 0;
+        size_t end = 0;
+        size_t size() const { return end - begin; }
+    };
+
+    void clear();
+    void append(const std::string& title);
+
+    size_t size() const { return m_starts.size(); }
+    bool empty() const { return m_starts.empty(); }
+
+    // Title in insertion order
+    std::string at(size_t index) const;
+
+    // Insertion index of the item at a sorted position
+    size_t sortedAt(size_t position);
+
+    // Items whose title starts with prefix, ignoring case
+    Range prefixRange(const std::string& prefix);
+
+    // Distinct lowercase characters that follow prefix within range, ascending
+    std::string nextCharacters(const std::string& prefix, const Range& range, size_t limit);
+
+    // Sorted position of an exact title, or npos
+    size_t findSorted(const std::string& title);
+
+private:
+    void ensureSorted();
+    size_t length(size_t index) const;
+    // Compare the first prefix.size() folded characters of a title with prefix
+    int comparePrefix(size_t index, const std::string& prefix) const;
+
+    std::string m_text;
+    std::vector<uint32_t> m_starts;
+    std::vector<uint32_t> m_sorted;
+    bool m_sortedValid = true;
+};
@@ -0,0 +1,118 @@
+#pragma once
+
+#include "IcmpPinger.h"
+#include "Iperf3Client.h"
+#include <atomic>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+/**
+ * @class LatencyUnderLoad
+ * @brief Bufferbloat test: RTT while idle, then while saturating each direction
+ *
+ * An IcmpPinger probes the server every LATENCY_PROBE_INTERVAL_MS for the
+ * whole run. A control thread first measures idle RTT, then drives the
+ * native iperf3 client with several TCP streams as a download (reverse) and
+ * as an upload. Each loaded phase ignores its first LATENCY_WARMUP_MS, while
+ * TCP is still ramping up.
+ *
+ * The report gives per-phase percentiles, a responsiveness score in round
+ * trips per minute (RPM) at the worse loaded median, and a letter grade
+ * for the added latency.
+ */
+class LatencyUnderLoad {
+public:
+    enum class Phase {
+        IDLE,
+        DOWNLOAD,
+        UPLOAD,
+        DONE
+    };
+
+    struct Options {
+        std::string host;
+        int port = 5201;
+        int durationSec = 10;           // Per loaded phase
+        int parallel = 4;
+        bool download = true;
+        bool upload = true;
+    };
+
+    struct Latency {
+        bool valid = false;             // At least one reply in the phase
+        double p50Ms = 0.0;
+        double p90Ms = 0.0;
+        size_t samples = 0;
+        int lossPercent = 0;
+    };
+
+    struct Result {
+        bool valid = false;
+        bool cancelled = false;
+        std::string error;
+        Latency idle;
+        Latency download;
+        Latency upload;
+        double downloadBitsPerSecond = 0.0;
+        double uploadBitsPerSecond = 0.0;
+        int rpm = 0;                    // 60000 / worse loaded median
+        std::string grade;              // A+ .. F by added latency
+    };
+
+    struct Progress {
+        Phase phase = Phase::IDLE;
+        double elapsed = 0.0;           // Seconds into the phase
+        double lastRttMs = 0.0;
+        double bitsPerSecond = 0.0;     // Last interval of the load
+    };
+
+    LatencyUnderLoad();
+    ~LatencyUnderLoad();
+
+    LatencyUnderLoad(const LatencyUnderLoad&) = delete;
+    LatencyUnderLoad& operator=(const LatencyUnderLoad&) = delete;
+
+    // Start in the background; false if running or the probe cannot start
+    bool start(const Options& options);
+
+    // Abort and wait for the control thread
+    void cancel();
+
+    bool isRunning() const { return m_running.load(); }
+    Progress getProgress() const;
+
+    // Valid once isRunning() turns false
+    Result getResult() const;
+
+    // Nearest-rank percentile, fraction in [0, 1]
+    static double percentile(std::vector<double> samples, double fraction);
+
+    // Letter grade for the latency added under load
+    static std::string grade(double addedMs);
+
+private:
+    void run();
+    bool runLoad(bool reverse, Latency& latency, double& bitsPerSecond);
+    bool waitMs(int ms);
+    void collectSamples();
+    Latency measure(size_t from, size_t to, const IcmpPinger::Stats& before, const IcmpPinger::Stats& after) const;
+    void setPhase(Phase phase);
+
+    Options m_options;
+    IcmpPinger m_pinger;
+    Iperf3Client m_engine;
+
+    std::thread m_thread;
+    std::atomic<bool> m_running{false};
+    std::atomic<bool> m_cancel{false};
+
+    // Control thread only
+    std::vector<double> m_samples;
+    int64_t m_phaseStartUs = 0;
+
+    mutable std::mutex m_mutex;
+    Progress m_progress;
+    Result m_result;
+};
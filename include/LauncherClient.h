@@ -0,0 +1,115 @@
+#pragma once
+
+#include <atomic>
+#include <cstdint>
+#include <deque>
+#include <map>
+#include <mutex>
+#include <set>
+#include <string>
+#include <thread>
+#include <netinet/in.h>
+
+/**
+ * @class LauncherClient
+ * @brief Persistent, pipelined connection to a launcher-style line server
+ *
+ * Speaks the utils/launcher-client protocol ("command [arg]\n" answered by
+ * one line) without a process per request. There is one client per
+ * "IP:PORT", each with a background thread and a non-blocking socket that
+ * stays open across requests and is reopened when the server drops it.
+ * The wire protocol has no request ids, so ids are handed out here and
+ * replies are matched to requests in the order they were written.
+ *
+ * Requests are pipelined once a connection has shown it serves more than
+ * one request; until then (and for good after a server closes right after
+ * its first reply) one request is on the wire at a time, so a server that
+ * answers one command per connection never sees two in one read. A request
+ * whose connection closes before answering is resent on a new connection.
+ * A reply overdue past its deadline fails the request and drops the
+ * connection, since later replies could no longer be matched.
+ *
+ * Finished requests are collected with take(); completionFd() turns
+ * readable whenever any client finishes one (CommandRunner watches it).
+ */
+class LauncherClient {
+public:
+    struct Response {
+        bool ok = false;                // A reply arrived; line is the reply
+        bool timedOut = false;
+        std::string line;               // Without the newline, or why it failed
+    };
+
+    // Shared client for "IP:PORT", nullptr if the address does not parse
+    static LauncherClient* forServer(const std::string& address);
+
+    // "launcher:IP:PORT command [arg]" into address and request line
+    static bool isCommand(const std::string& text);
+    static bool parseCommand(const std::string& text, std::string& address, std::string& line);
+
+    // eventfd shared by all clients, readable after a request finishes
+    static int completionFd();
+
+    ~LauncherClient();
+
+    LauncherClient(const LauncherClient&) = delete;
+    LauncherClient& operator=(const LauncherClient&) = delete;
+
+    // Queue one request line (no newline); its id, or 0 when too many are queued
+    uint64_t submit(const std::string& line, int timeoutMs);
+
+    // Response of a finished request; removes it
+    bool take(uint64_t id, Response& response);
+
+    // Forget a request; its reply is discarded when it arrives
+    void cancel(uint64_t id);
+
+private:
+    struct Request {
+        uint64_t id = 0;
+        std::string line;
+        int64_t deadlineMs = 0;
+        int attempts = 0;               // Connections that closed without answering it
+    };
+
+    LauncherClient(const std::string& address, const sockaddr_in& server);
+
+    void run();
+    void takeQueued();
+    void connectSocket();
+    void closeSocket();
+    void flushRequests();
+    void readReplies();
+    void reply(const std::string& line);
+    void expire(int64_t now);
+    void complete(const Request& request, const Response& response);
+    void failAll(const std::string& why);
+    int pollTimeoutMs(int64_t now) const;
+
+    const std::string m_address;
+    const sockaddr_in m_server;
+    int m_wakeFd = -1;
+    std::thread m_thread;
+    std::atomic<bool> m_stop{false};
+
+    // Shared with the UI thread
+    std::mutex m_mutex;
+    uint64_t m_nextId = 1;
+    std::deque<Request> m_queued;
+    std::map<uint64_t, Response> m_done;
+    std::set<uint64_t> m_cancelled;
+    size_t m_outstanding = 0;           // Submitted and not yet finished
+
+    // Client thread only
+    std::deque<Request> m_pending;      // The first m_inFlight are on the wire
+    size_t m_inFlight = 0;
+    int m_fd = -1;
+    bool m_connecting = false;
+    std::string m_out;                  // Bytes not yet written
+    std::string m_in;                   // Unfinished reply line
+    bool m_inTruncated = false;
+    int m_answered = 0;                 // Replies on this connection
+    bool m_pipelined = false;           // The server keeps connections open
+    bool m_oneShot = false;             // It closed after a single reply before
+    bool m_warm = false;                // Reopen straight after a close
+};
@@ -0,0 +1,58 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <vector>
+
+/**
+ * Fixed-capacity scrollback of text lines
+ *
+ * Once full, each push overwrites the oldest line in place, so a long-running
+ * stream costs a bounded amount of memory and, after the first lap, no
+ * allocations for lines that fit the strings already there.
+ */
+class LineRing {
+public:
+    explicit LineRing(size_t capacity = 0) { reset(capacity); }
+
+    // Drop every line and resize
+    void reset(size_t capacity)
+    {
+        m_lines.assign(capacity, std::string());
+        m_head = 0;
+        m_size = 0;
+        m_total = 0;
+    }
+
+    void push(const std::string& line)
+    {
+        if (m_lines.empty()) {
+            return;
+        }
+        if (m_size < m_lines.size()) {
+            m_lines[(m_head + m_size) % m_lines.size()] = line;
+            m_size++;
+        } else {
+            m_lines[m_head] = line;
+            m_head = (m_head + 1) % m_lines.size();
+        }
+        m_total++;
+    }
+
+    size_t size() const { return m_size; }
+    size_t capacity() const { return m_lines.size(); }
+    bool empty() const { return m_size == 0; }
+
+    // 0 is the oldest line kept
+    const std::string& at(size_t index) const { return m_lines[(m_head + index) % m_lines.size()]; }
+
+    // Lines pushed since reset(), including those already overwritten
+    uint64_t total() const { return m_total; }
+
+private:
+    std::vector<std::string> m_lines;
+    size_t m_head = 0;
+    size_t m_size = 0;
+    uint64_t m_total = 0;
+};
@@ -0,0 +1,54 @@
+#pragma once
+
+#include <cstddef>
+#include <functional>
+#include <string>
+#include <sys/types.h>
+
+/**
+ * Follows a log file another process appends to
+ *
+ * The file stays open with a read offset, so each poll() reads only what was
+ * written since the previous one. An inotify IN_MODIFY watch on the file
+ * tells whether there is anything to read: polling a quiet log costs one
+ * non-blocking read of the inotify fd. Without inotify every poll() reads
+ * from the offset, which is still incremental.
+ *
+ * Lines end at '\n' or '\r' (progress meters redraw with '\r'); lines longer
+ * than LOG_TAIL_MAX_LINE are split. A file truncated underneath is read from
+ * the start again.
+ */
+class LogTail {
+public:
+    using LineHandler = std::function<void(const std::string& line)>;
+
+    LogTail() = default;
+    ~LogTail();
+
+    LogTail(const LogTail&) = delete;
+    LogTail& operator=(const LogTail&) = delete;
+
+    // Follow path from its beginning
+    bool open(const std::string& path);
+    void close();
+    bool isOpen() const { return m_fd >= 0; }
+
+    // Readable after the file was written; -1 without inotify
+    int getFd() const { return m_watchFd; }
+
+    // Hand over the complete lines appended since the last call
+    void poll(const LineHandler& onLine);
+
+    // Read what is left and hand over the unfinished last line too
+    void finish(const LineHandler& onLine);
+
+private:
+    bool consumeEvents();
+    void deliver(const char* data, size_t length, const LineHandler& onLine);
+
+    int m_fd = -1;
+    int m_watchFd = -1;
+    off_t m_offset = 0;
+    bool m_pending = false;     // Unread data left by the per-poll read cap
+    std::string m_partial;      // Line still being written
+};
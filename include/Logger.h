@@ -1,10 +1,21 @@
 #pragma once
 
+#include <atomic>
+#include <cstdint>
 #include <string>
 #include <iostream>
+#include "Config.h"
 
 /**
  * Simple logging utility for MicroPanel
+ *
+ * Until startAsync() is called messages are written synchronously. After it,
+ * log() only copies the preformatted message into a lock-free ring and a
+ * background thread writes batches to stdout/stderr, the systemd journal or a
+ * file, so logging never blocks the UI thread; when the ring is full messages
+ * are dropped and counted. Prefer the LOG_* macros in frequently run code:
+ * they skip evaluating the message when the level is off and rate limit each
+ * call site to LOG_RATE_LIMIT_PER_SEC messages per second.
  */
 class Logger {
 public:
@@ -14,6 +25,29 @@ public:
         WARNING, // Warnings
         ERROR    // Errors
     };
+
+    enum class Sink {
+        STDOUT,     // DEBUG/INFO to stdout, WARNING/ERROR to stderr
+        JOURNAL,    // systemd journal native protocol
+        FILE        // Appended, with timestamps
+    };
+
+    /**
+     * Per-call-site token bucket used by the LOG_* macros. Constant
+     * initialized, so a function-local static costs no guard.
+     */
+    class RateLimit {
+    public:
+        constexpr RateLimit() {}
+
+        // False when over the limit; suppressed counts messages dropped in the previous second
+        bool allow(uint32_t& suppressed);
+
+    private:
+        std::atomic<int64_t> m_window{-1};
+        std::atomic<uint32_t> m_count{0};
+        std::atomic<uint32_t> m_suppressed{0};
+    };
     
     // Set verbose mode
     static void setVerbose(bool verbose) {
@@ -24,29 +58,23 @@ public:
     static bool isVerbose() {
         return m_verbose;
     }
+
+    static bool enabled(Level level) {
+        return level != Level::DEBUG || m_verbose;
+    }
+
+    // Start the background writer; path is the log file for Sink::FILE
+    static bool startAsync(Sink sink, const std::string& path = "");
+
+    // Write out queued messages and go back to synchronous logging
+    static void stopAsync();
     
     // Log with specified level
     static void log(Level level, const std::string& message) {
-        // Skip debug messages in non-verbose mode
-        if (level == Level::DEBUG && !m_verbose) {
-            return;
-        }
-        
-        switch (level) {
-            case Level::DEBUG:
-                std::cout << "[DEBUG] " << message << std::endl;
-                break;
-            case Level::INFO:
-                std::cout << message << std::endl;
-                break;
-            case Level::WARNING:
-                std::cerr << "[WARNING] " << message << std::endl;
-                break;
-            case Level::ERROR:
-                std::cerr << "[ERROR] " << message << std::endl;
-                break;
-        }
+        log(level, message, 0);
     }
+
+    static void log(Level level, const std::string& message, uint32_t suppressed);
     
     // Convenience methods
     static void debug(const std::string& message) {
@@ -68,3 +96,20 @@ public:
 private:
     static bool m_verbose;
 };
+
+// Message is only evaluated when the level is enabled and the call site is under its rate limit
+#define MICROPANEL_LOG(level, message)                                          \
+    do {                                                                        \
+        if (Logger::enabled(level)) {                                           \
+            static Logger::RateLimit micropanelLogLimit_;                       \
+            uint32_t micropanelLogSuppressed_ = 0;                              \
+            if (micropanelLogLimit_.allow(micropanelLogSuppressed_)) {          \
+                Logger::log(level, (message), micropanelLogSuppressed_);        \
+            }                                                                   \
+        }                                                                       \
+    } while (0)
+
+#define LOG_DEBUG(message) MICROPANEL_LOG(Logger::Level::DEBUG, message)
+#define LOG_INFO(message) MICROPANEL_LOG(Logger::Level::INFO, message)
+#define LOG_WARNING(message) MICROPANEL_LOG(Logger::Level::WARNING, message)
+#define LOG_ERROR(message) MICROPANEL_LOG(Logger::Level::ERROR, message)
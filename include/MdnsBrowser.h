@@ -0,0 +1,83 @@
+#pragma once
+
+#include <atomic>
+#include <cstdint>
+#include <map>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+/**
+ * @class MdnsBrowser
+ * @brief Minimal multicast DNS-SD browser with a process-wide record cache
+ *
+ * Sends PTR queries for the requested service types to 224.0.0.251:5353 from
+ * one UDP socket and follows up with SRV/TXT/A questions for anything still
+ * unresolved. Records from every response (answers and additional section)
+ * go into a cache that honours their TTLs and goodbye packets, so a second
+ * screen browsing the same type sees known services immediately.
+ *
+ * The socket shares port 5353 with avahi-daemon when one is running, and
+ * falls back to an ephemeral port (legacy unicast answers) otherwise.
+ */
+class MdnsBrowser {
+public:
+    struct Service {
+        std::string instance;           // Unescaped first label, e.g. "MicroPanel iperf3 10.0.0.5"
+        std::string type;               // e.g. "_iperf3._tcp"
+        std::string host;               // SRV target
+        std::string address;            // IPv4 dotted quad
+        int port = 0;
+        std::vector<std::string> txt;
+    };
+
+    static MdnsBrowser& getInstance();
+
+    MdnsBrowser(const MdnsBrowser&) = delete;
+    MdnsBrowser& operator=(const MdnsBrowser&) = delete;
+
+    // Query in the background for durationMs; false if no socket could be opened.
+    // Already browsing: the running browse continues and true is returned.
+    bool browse(const std::vector<std::string>& types, int durationMs);
+    void cancel();
+    bool isBrowsing() const { return m_browsing.load(); }
+
+    // Cached, fully resolved instances of a type (address and port known)
+    std::vector<Service> getServices(const std::string& type) const;
+
+private:
+    struct Question {
+        std::vector<std::string> labels;
+        uint16_t type;
+    };
+
+    struct Record {
+        int64_t expiresMs = 0;
+        std::string target;             // PTR instance / SRV host / A address
+        int port = 0;                   // SRV
+        std::vector<std::string> labels;    // PTR: instance name labels, for follow-up queries
+        std::vector<std::string> txt;
+    };
+
+    MdnsBrowser();
+    ~MdnsBrowser();
+
+    void run(std::vector<std::string> types, int durationMs);
+    int openSocket(bool& shared);
+    std::vector<Question> pendingQuestions(const std::vector<std::string>& types);
+    void sendQuery(int fd, const std::vector<Question>& questions, bool legacy);
+    void handlePacket(const uint8_t* data, size_t length);
+    void expireLocked(int64_t nowMs);
+
+    std::thread m_thread;
+    std::atomic<bool> m_browsing{false};
+    std::atomic<bool> m_cancel{false};
+
+    // Keyed by lowercased owner name; PTR entries by type + '\n' + instance
+    mutable std::mutex m_cacheMutex;
+    std::map<std::string, Record> m_pointers;
+    std::map<std::string, Record> m_services;
+    std::map<std::string, Record> m_texts;
+    std::map<std::string, Record> m_addresses;
+};
@@ -2,6 +2,7 @@
 
 #include "ScreenModules.h"
 #include "MenuSystem.h"
+#include "ModuleRegistry.h"
 #include <vector>
 #include <memory>
 #include <string>
@@ -26,9 +27,11 @@ public:
 
     // MenuScreenModule specific methods
     void addSubmenuItem(const std::string& moduleId, const std::string& title);
-    void setModuleRegistry(const std::map<std::string, std::shared_ptr<ScreenModule>>* registry);
+    void setModuleRegistry(ModuleRegistry* registry);
     void setParentMenu(MenuScreenModule* parent) { m_parentMenu = parent; }
     bool hasSubmenuItems() const { return !m_submenuItems.empty(); }
+    void clearSubmenuItems() { m_submenuItems.clear(); }
+    void setTitle(const std::string& title) { m_title = title; }
     void navigateToMainMenu();
     void setAsTopLevelMenu(bool isTopLevel) { m_isTopLevelMenu = isTopLevel; }
     bool isExitingToMainMenu() const { return m_exitToMainMenu; }
@@ -36,8 +39,8 @@ public:
     void onScreenAction(const std::string& screenId,
                       const std::string& action,
                       const std::string& value) override;
-    void handleGPIORotation(int direction);
-    bool handleGPIOButtonPress();
+    void handleGPIORotation(int direction) override;
+    bool handleGPIOButtonPress() override;
     void setGPIOHandler(std::function<void(std::shared_ptr<ScreenModule>)> gpioHandler);
     void setUseGPIOMode(bool useGPIO) { m_useGPIOMode = useGPIO; }
     void handleModuleLaunch(const std::string& sourceModuleId, const std::string& value);
@@ -52,7 +55,7 @@ private:
     std::string m_title;
     std::shared_ptr<Menu> m_menu;
     std::vector<SubmenuItem> m_submenuItems;
-    const std::map<std::string, std::shared_ptr<ScreenModule>>* m_moduleRegistry = nullptr;
+    ModuleRegistry* m_moduleRegistry = nullptr;
     MenuScreenModule* m_parentMenu = nullptr;
     bool m_exitToParent = false;
     bool m_exitToMainMenu = false;
@@ -6,6 +6,8 @@
 #include <functional>
 #include <sys/time.h>
 #include "Config.h"
+#include "MonoFrame.h"
+#include "TextLine.h"
 
 // Forward declarations
 class BaseDisplayDevice;
@@ -84,11 +86,37 @@ public:
     // Pass-through display commands
     void clear();
     void drawText(int x, int y, const std::string& text);
+    // Without a temporary std::string: literals, TextLine rows, other char spans
+    void drawText(int x, int y, const char* text);
+    void drawText(int x, int y, const char* text, size_t length);
+    template <size_t N>
+    void drawText(int x, int y, const BasicTextLine<N>& line) { drawText(x, y, line.data(), line.size()); }
     void setCursor(int x, int y);
     void setInverted(bool inverted);
     void setBrightness(int brightness);
     void drawProgressBar(int x, int y, int width, int height, int percentage);
     void setPower(bool on);
+
+    // Framebuffer mode: send the composed frame (no-op otherwise)
+    void present();
+    bool isFrameBuffered() const;
+
+    // Direct mode: send the commands a serial device has buffered
+    void flush();
+
+    // Redraw the last frame on a reopened device, restoring power/brightness/inversion
+    void repaint();
+
+    // Raw 1bpp region drawing, for devices that render bitmaps
+    bool supportsBlit() const;
+    void blit(const MonoFrame::Window& window, const uint8_t* pixels);
+
+    // Thread-safe: ask the main loop to redraw after worker state changes
+    void setRedrawNotifier(std::function<void()> notifier) { m_redrawNotifier = notifier; }
+    void requestRedraw();
+
+    // Called after the panel is switched on or off
+    void setPowerNotifier(std::function<void(bool)> notifier) { m_powerNotifier = notifier; }
     
     // State accessors
     bool isInverted() const { return m_inverted; }
@@ -100,6 +128,7 @@ public:
     void enablePowerSave(bool enable);
     void updateActivityTimestamp();
     void checkPowerSaveTimeout();
+    int getPowerSaveRemainingMs() const;
     bool isPowerSaveActivated() const { return m_powerSaveActivated; }
     void resetPowerSaveActivated() { m_powerSaveActivated = false; }
     
@@ -114,6 +143,13 @@ private:
     bool m_powerSaveEnabled = false;
     bool m_powerSaveActivated = false;
     struct timeval m_lastActivityTime = {0, 0};
+    std::function<void()> m_redrawNotifier;
+    std::function<void(bool)> m_powerNotifier;
+
+    // Frame timing for PerfCounters: first draw since the last present()
+    void beginFrame();
+    int64_t m_frameStartUs = 0;
+    bool m_flushPending = false;    // Direct mode: composed, waiting for flush()
 };
 
 /**
@@ -132,10 +168,11 @@ public:
     
     // Selection state
     int getCurrentSelection() const { return m_currentItem; }
-    void setCurrentSelection(int selection);
+    void setCurrentSelection(int selection, bool redraw = true);
     
     // Rendering
     void render();
+    void refresh();     // Full redraw without the debounce, for changed items
     void updateSelection(int oldSelection, int newSelection);
     
     // Navigation
@@ -154,6 +191,12 @@ public:
     std::shared_ptr<Menu> getParent() const { return m_parent.lock(); }
     
 private:
+    // Inter-command delay, skipped when the display composes frames host-side
+    void pace(int usec) const;
+
+    // One row with its selection indicator, built without allocating
+    void drawItem(int index, int y);
+
     std::string m_title = "MAIN MENU";
     std::shared_ptr<Display> m_display;
     std::vector<std::shared_ptr<MenuItem>> m_items;
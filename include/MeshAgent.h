@@ -0,0 +1,97 @@
+#pragma once
+
+#include "Iperf3Client.h"
+#include "Iperf3Server.h"
+#include <atomic>
+#include <cstdint>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+#include <netinet/in.h>
+#include <sys/types.h>
+
+/**
+ * @class MeshAgent
+ * @brief One node of a coordinated throughput mesh
+ *
+ * Runs the native iperf3 server on MESH_IPERF_PORT, announces itself as
+ * MESH_SERVICE_TYPE through avahi-publish and answers JSON datagrams from a
+ * MeshCoordinator on the control port:
+ *
+ *   hello              -> hello with the node name and iperf3 port
+ *   run (session/test) -> ack; starts an Iperf3Client to host:port after
+ *                         delay_ms, measured from when the request arrived
+ *   result             -> state (scheduled/running/done/failed) and figures
+ *   abort (session)    -> ack; cancels every test of the session
+ *
+ * Requests are idempotent, so the coordinator simply resends until it gets
+ * an answer. A node can run several scheduled tests at once.
+ */
+class MeshAgent {
+public:
+    struct Status {
+        bool running = false;
+        std::string name;
+        int controlPort = 0;
+        int iperfPort = 0;
+        bool announced = false;         // avahi-publish is running
+        int testsRun = 0;               // Finished as client since start()
+        int testsActive = 0;
+        std::string activity;           // Target of the newest running test
+        int serverClients = 0;          // Tests against our iperf3 server now
+    };
+
+    MeshAgent();
+    ~MeshAgent();
+
+    MeshAgent(const MeshAgent&) = delete;
+    MeshAgent& operator=(const MeshAgent&) = delete;
+
+    // false if the control socket or the iperf3 server cannot be bound
+    bool start(const std::string& name, int controlPort, int iperfPort);
+    void stop();
+    bool isRunning() const { return m_running.load(); }
+
+    Status getStatus() const;
+
+private:
+    struct Test {
+        std::string session;
+        int id = 0;
+        std::string target;
+        Iperf3Client::Options options;
+        int64_t startUs = 0;            // CLOCK_MONOTONIC
+        std::unique_ptr<Iperf3Client> client;
+        bool started = false;
+        bool finished = false;
+        Iperf3Client::Result result;
+    };
+
+    void run();
+    void handleMessage(const char* data, size_t length, const sockaddr_in& from);
+    void reply(const std::string& payload, const sockaddr_in& to);
+    Test* findTest(const std::string& session, int id);
+    void serviceTests(int64_t now);
+    int pollTimeoutMs(int64_t now) const;
+    void announce();
+    void stopAnnouncement();
+
+    std::string m_name;
+    int m_controlPort = 0;
+    int m_iperfPort = 0;
+    int m_fd = -1;
+    int m_wakeFd = -1;
+    pid_t m_announcePid = -1;
+    Iperf3Server m_server;
+
+    std::thread m_thread;
+    std::atomic<bool> m_running{false};
+    std::atomic<bool> m_stop{false};
+
+    // Agent thread only, except under m_mutex for getStatus()
+    mutable std::mutex m_mutex;
+    std::vector<std::unique_ptr<Test>> m_tests;
+    int m_testsRun = 0;
+};
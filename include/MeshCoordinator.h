@@ -0,0 +1,126 @@
+#pragma once
+
+#include <atomic>
+#include <cstdint>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+/**
+ * @class MeshCoordinator
+ * @brief Runs a throughput test schedule across several MeshAgent nodes
+ *
+ * Node 0 is the coordinating unit itself (its own MeshAgent). The schedule
+ * is pushed to every client node up front as "run" requests whose delay is
+ * computed from this unit's monotonic clock minus half the measured round
+ * trip, so the nodes need no synchronised clocks. Tests of one round start
+ * together; rounds are MESH_ROUND_GAP_MS apart.
+ *
+ *   HUB  - every peer sends to node 0 (access ports against a core box)
+ *   FULL - every ordered pair of nodes
+ *
+ *   STAGGERED  - rounds in which each node is in at most one test, so no
+ *                link carries two of our streams at once
+ *   CONCURRENT - everything in round 0, for aggregate load
+ *
+ * Results are collected from the client nodes after each round and written
+ * as JSON to Options::exportPath when the run ends.
+ */
+class MeshCoordinator {
+public:
+    enum class Pattern { HUB, FULL };
+    enum class Order { STAGGERED, CONCURRENT };
+
+    struct Node {
+        std::string name;
+        std::string address;            // IPv4, also the iperf3 target
+        int controlPort = 0;
+        int iperfPort = 0;
+    };
+
+    struct Options {
+        Pattern pattern = Pattern::HUB;
+        Order order = Order::STAGGERED;
+        int durationSec = 10;
+        int parallel = 1;
+        std::string exportPath;         // Empty: no export
+    };
+
+    struct Pair {
+        int from = 0;                   // Client node, sends
+        int to = 0;                     // Server node, receives
+        int round = 0;                  // -1: a node never answered, not run
+    };
+
+    enum class State { PENDING, SCHEDULED, RUNNING, DONE, FAILED };
+
+    struct Result {
+        Pair pair;
+        State state = State::PENDING;
+        double mbps = 0.0;              // Received by the server node
+        int retransmits = 0;
+        std::string error;
+    };
+
+    struct Progress {
+        bool running = false;
+        std::string phase;              // "Contacting", "Scheduling", "Round 2/4", "Done", ...
+        int round = 0;
+        int rounds = 0;
+        int finished = 0;               // Tests done or failed
+        int total = 0;
+        double secondsLeft = 0.0;       // Until the last round should end
+    };
+
+    MeshCoordinator();
+    ~MeshCoordinator();
+
+    MeshCoordinator(const MeshCoordinator&) = delete;
+    MeshCoordinator& operator=(const MeshCoordinator&) = delete;
+
+    // Pairs in round order; rounds are numbered from 0
+    static std::vector<Pair> buildSchedule(size_t nodes, Pattern pattern, Order order);
+
+    // false if a run is in progress, there is nothing to test or no socket
+    bool start(const std::vector<Node>& nodes, const Options& options);
+    // Aborts the session on every node; returns once the thread has ended
+    void cancel();
+    bool isRunning() const { return m_running.load(); }
+
+    Progress getProgress() const;
+    std::vector<Node> getNodes() const;
+    std::vector<Result> getResults() const;
+
+private:
+    struct Request;
+
+    void run();
+    bool contactNodes();
+    bool pushSchedule();
+    void collectRound(int round);
+    void abortSession();
+    // Sends each request until answered, MESH_RETRIES times or deadlineUs
+    void exchange(std::vector<Request>& requests, int64_t deadlineUs, bool stopOnCancel);
+    std::string runRequest(size_t index) const;
+    bool writeExport() const;
+    void setPhase(const std::string& phase);
+
+    Options m_options;
+    std::string m_session;
+    int m_fd = -1;
+    int64_t m_firstStartUs = 0;         // CLOCK_MONOTONIC start of round 0
+    int m_rounds = 0;
+
+    std::thread m_thread;
+    std::atomic<bool> m_running{false};
+    std::atomic<bool> m_cancel{false};
+
+    // Written by the coordinator thread, read by the screen
+    mutable std::mutex m_mutex;
+    std::vector<Node> m_nodes;
+    std::vector<int64_t> m_rttUs;       // Per node, -1 if it never answered
+    std::vector<Result> m_results;
+    std::string m_phase;
+    int m_round = 0;
+};
@@ -0,0 +1,114 @@
+#pragma once
+
+#include <array>
+#include <atomic>
+#include <cstdint>
+#include <vector>
+#include <sys/types.h>
+#include "Config.h"
+
+/**
+ * @class MetricsSampler
+ * @brief Background system metrics sampler with fixed-size history
+ *
+ * A Scheduler job samples /proc/stat (aggregate and per core),
+ * /proc/meminfo, /proc/loadavg, the thermal zones and /proc/net/dev every
+ * METRICS_INTERVAL_MS on the UI thread, parked while the display is off
+ * (the first sample after waking spans the gap). The files stay open and
+ * are re-read with pread() at offset 0 and parsed by hand, so a sample
+ * costs a handful of syscalls and no allocation. Each series keeps the last
+ * METRICS_HISTORY values in a ring buffer that screens draw as sparklines.
+ */
+class MetricsSampler {
+public:
+    enum class Metric {
+        CPU,            // Busy percent; per core or aggregate (core -1)
+        MEMORY,         // Used percent, from MemAvailable
+        LOAD,           // 1-minute load average x100
+        TEMPERATURE,    // Hottest thermal zone, millidegrees C
+        NET_RX,         // Bytes/s received, all non-loopback interfaces
+        NET_TX          // Bytes/s sent
+    };
+
+    static MetricsSampler& getInstance();
+
+    MetricsSampler(const MetricsSampler&) = delete;
+    MetricsSampler& operator=(const MetricsSampler&) = delete;
+
+    // Sample now and then periodically; later calls do nothing
+    void start();
+
+    // Samples oldest first, at most METRICS_HISTORY of them
+    std::vector<int32_t> history(Metric metric, int core = -1) const;
+
+    // Most recent sample, false if none has been taken (or the source is missing)
+    bool latest(Metric metric, int32_t& value, int core = -1) const;
+
+    int coreCount() const;
+
+    // Bumped after every sample
+    uint64_t getGeneration() const { return m_generation.load(); }
+
+private:
+    friend struct BenchAccess;      // bench/ times sample() without the scheduler
+
+    static constexpr int HISTORY = Config::METRICS_HISTORY;
+    static constexpr int MAX_THERMAL_ZONES = 8;
+
+    class Ring {
+    public:
+        void push(int32_t value);
+        size_t size() const { return m_count; }
+        int32_t newest() const { return m_values[(m_head + HISTORY - 1) % HISTORY]; }
+        void copyTo(std::vector<int32_t>& out) const;
+
+    private:
+        std::array<int32_t, HISTORY> m_values{};
+        size_t m_head = 0;              // Next slot to write
+        size_t m_count = 0;
+    };
+
+    struct CpuCounters {
+        uint64_t busy = 0;
+        uint64_t total = 0;
+    };
+
+    MetricsSampler();
+    ~MetricsSampler();
+
+    void openSources();
+    void sample();
+    void sampleCpu();
+    void sampleMemory();
+    void sampleLoad();
+    void sampleTemperature();
+    void sampleNetwork(int64_t elapsedMs);
+    const Ring* ring(Metric metric, int core) const;
+    ssize_t readSource(int fd);
+
+    int m_statFd = -1;
+    int m_meminfoFd = -1;
+    int m_loadavgFd = -1;
+    int m_netDevFd = -1;
+    int m_thermalFds[MAX_THERMAL_ZONES];
+    int m_thermalCount = 0;
+
+    // Sampler state
+    char m_buffer[16384];
+    std::vector<CpuCounters> m_previousCpu;     // [0] aggregate, [1 + n] core n
+    std::vector<CpuCounters> m_currentCpu;      // Reused between samples
+    uint64_t m_previousRx = 0;
+    uint64_t m_previousTx = 0;
+    bool m_haveNetwork = false;
+    int64_t m_lastSampleMs = 0;
+
+    std::vector<Ring> m_cpu;                    // Same indexing as m_previousCpu
+    Ring m_memory;
+    Ring m_load;
+    Ring m_temperature;
+    Ring m_netRx;
+    Ring m_netTx;
+
+    int m_job = -1;                             // Scheduler job once started
+    std::atomic<uint64_t> m_generation{0};
+};
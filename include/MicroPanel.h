@@ -9,6 +9,12 @@
 #include <thread>
 #include <vector>
 #include <sys/time.h>
+#include <nlohmann/json_fwd.hpp>
+#include "Config.h"
+#include "FileWatcher.h"
+#include "InputEvent.h"
+#include "ModuleRegistry.h"
+#include "StatsServer.h"
 
 // Forward declarations
 class BaseDisplayDevice;
@@ -20,6 +26,7 @@ class DeviceManager;
 class Menu;
 class MenuItem;
 class ScreenModule;
+class EventLoop;
 
 /**
  * Main application class
@@ -34,33 +41,65 @@ public:
     void shutdown();
 
 private:
+    friend struct BenchAccess;      // bench/ times the config loader
+
     void parseCommandLine(int argc, char* argv[]);
     void setupSignalHandlers();
     void initializeModules();
+    void showStartupScreen(const std::string& status);
     void setupMenu();
     bool detectAndOpenDevices();
     void mainEventLoop();
 
     // For auto-detect mode
     void detectAndRun();
+    bool loadConfigModel();
     bool loadConfigFromJson();
+    void registerConfigModule(const nlohmann::json& module);
+    void configureMenuModule(const nlohmann::json& module);
+    void buildMainMenu(const nlohmann::json& config);
+    // Config hot reload: only changed modules and menus are rebuilt
+    void reloadConfig();
     void registerModuleInMenu(const std::string& moduleName, const std::string& menuTitle);
     // New methods for persistence and dependencies
     bool initPersistentStorage();
     bool loadModuleDependencies();
     void runModuleWithGPIOInput(std::shared_ptr<ScreenModule> module);
-    void simulateRotationForModule(std::shared_ptr<ScreenModule> module, int direction);
-    void simulateButtonPressForModule(std::shared_ptr<ScreenModule> module,bool& moduleRunning);
+    // Event loop plumbing
+    void watchInputDevices();
+    void onInputActivity();
+    void scheduleFlush();
+    void schedulePowerSave();
+    void updateVisibility();                    // Scheduler parks display-bound jobs while dark
+    // USB HMI hotplug: devices are reopened in place, Display/Menu/modules stay
+    void onDeviceConnected(const std::string& inputDevice, const std::string& serialDevice);
+    void onDeviceDisconnected();
+    bool waitForDevices();
 
     struct {
         std::string inputDevice;
         std::string serialDevice;
         std::string configFile;
         std::string persistentDataFile;  // Path to store persistent data
+        bool persistentFsync = false;    // fsync persistent data after each write
+        bool persistentJournal = false;  // Append changes to a journal between snapshots
+        std::string historyFile;         // -H: measurement history ring (HistoryLog)
+        std::string historyExport;       // -E: write the history as CSV/JSON and exit
+        std::string logTarget;           // -l: "stdout", "journal" or a log file path
         bool verboseMode = false;
         bool autoDetect = false;
         bool powerSaveEnabled = false;
         bool useGPIOMode = false;
+        bool frameBufferMode = false;    // Host-side shadow framebuffer for serial displays
+        bool blitMode = false;           // Serial frames rendered locally and sent as CMD_BLIT
+        bool fastBoot = false;           // -F: splash on open, skip the startup delays
+        std::string replayScript;        // -R: scripted input instead of evdev
+        bool headless = false;           // Virtual display or scripted input: no detection, no hotplug
+        std::string statsSocket;         // -S: PerfCounters report socket, empty = off
+        std::string statsTextfile;       // -P: Prometheus textfile, rewritten periodically
+        std::string pushSocket;          // -U: PushServer datagram socket, empty = off
+        std::string accelCurve;          // -A: encoder acceleration curve, "off" = 1:1
+        std::string pluginDir = Config::PLUGIN_DIR;  // -M: plugin modules, loaded on first use
     } m_config;
 
     std::shared_ptr<DisplayDevice> m_displayDevice;
@@ -73,8 +112,24 @@ private:
     // Application state
     std::atomic<bool> m_running{false};
 
+    // Reactor for input, timers and worker wake-ups
+    std::unique_ptr<EventLoop> m_eventLoop;
+    int m_flushTimer = -1;
+    int m_powerSaveTimer = -1;
+    int m_rescanTimer = -1;                     // Armed while the HMI is unplugged
+    int m_reloadTimer = -1;                     // Armed after the config file was written
+    bool m_reloadPending = false;               // Applied by the top-level loop, never inside a module
+    FileWatcher m_configWatcher;
+    StatsServer m_statsServer;
+    int m_textfileJob = -1;                     // Scheduler job rewriting the -P textfile
+    int m_moduleDepth = 0;                      // Nested GPIO module loops
+    InputHandler m_onInput;                     // Current input target: menu or running module
+
+    // Screen config, parsed once and shared read-only with lazily built modules
+    std::shared_ptr<const nlohmann::json> m_configModel;
+
     // Module registry
-    std::map<std::string, std::shared_ptr<ScreenModule>> m_modules;
+    ModuleRegistry m_modules;
 
     // Signal handling
     static MicroPanel* s_instance;
@@ -0,0 +1,66 @@
+#pragma once
+
+#include <functional>
+#include <map>
+#include <memory>
+#include <string>
+#include <vector>
+
+class Display;
+class InputDevice;
+class ScreenModule;
+
+/**
+ * Screen modules this build knows about, by id
+ *
+ * Each screen registers itself from its own translation unit with
+ * MICROPANEL_REGISTER_MODULE, so a module left out of the build (CMake
+ * MODULE_<NAME>=OFF) leaves no trace: no factory, no menu entry, no code.
+ *
+ * Modules built as plugins (MODULE_PLUGINS) live in "<id>.so" files in the
+ * plugin directory. scanPlugins() only notes the files; the first factory()
+ * call for such an id dlopen()s it, and the registration inside the plugin
+ * adds the factory. A module that is never opened costs neither the load nor
+ * its libraries (libcurl for the speed test).
+ */
+class ModuleCatalog {
+public:
+    using Factory = std::function<std::shared_ptr<ScreenModule>(const std::shared_ptr<Display>&,
+                                                                const std::shared_ptr<InputDevice>&)>;
+
+    // Static registration, see MICROPANEL_REGISTER_MODULE
+    struct Registration {
+        Registration(const char* id, Factory factory);
+    };
+
+    static ModuleCatalog& getInstance();
+
+    ModuleCatalog(const ModuleCatalog&) = delete;
+    ModuleCatalog& operator=(const ModuleCatalog&) = delete;
+
+    void add(const std::string& id, Factory factory);
+
+    // Note the plugins in dir; compiled-in modules win over a plugin of the same id
+    size_t scanPlugins(const std::string& dir);
+
+    // Compiled-in and plugin ids, sorted
+    std::vector<std::string> ids() const;
+    bool contains(const std::string& id) const;
+
+    // Loads the module's plugin on first use; empty if it cannot be had
+    Factory factory(const std::string& id);
+
+private:
+    ModuleCatalog() = default;
+
+    bool load(const std::string& id, const std::string& path);
+
+    std::map<std::string, Factory> m_factories;
+    std::map<std::string, std::string> m_plugins;   // Not loaded yet: id -> path
+};
+
+// One screen class under one id, registered before main() runs
+#define MICROPANEL_REGISTER_MODULE(id, Screen) \
+    static const ModuleCatalog::Registration registration##Screen(id, \
+        [](const std::shared_ptr<Display>& display, const std::shared_ptr<InputDevice>& input) \
+            -> std::shared_ptr<ScreenModule> { return std::make_shared<Screen>(display, input); })
@@ -0,0 +1,45 @@
+#pragma once
+
+#include <functional>
+#include <map>
+#include <memory>
+#include <string>
+
+class ScreenModule;
+
+/**
+ * Screen modules by id, constructed on first use
+ *
+ * Modules are registered as factories; get() runs the factory the first time
+ * a module is asked for and keeps the instance, so startup only pays for the
+ * screens that are actually opened. Menus, which the config wires together
+ * before anything runs, are added as ready-made instances.
+ */
+class ModuleRegistry {
+public:
+    using Factory = std::function<std::shared_ptr<ScreenModule>()>;
+
+    void add(const std::string& id, Factory factory);
+    void add(const std::string& id, std::shared_ptr<ScreenModule> module);
+
+    void remove(const std::string& id) { m_entries.erase(id); }
+
+    bool contains(const std::string& id) const { return m_entries.count(id) > 0; }
+
+    // Constructs the module if needed; nullptr for unknown ids
+    std::shared_ptr<ScreenModule> get(const std::string& id);
+
+    // The instance if already constructed; never runs the factory
+    std::shared_ptr<ScreenModule> find(const std::string& id) const;
+
+    size_t size() const { return m_entries.size(); }
+    void clear() { m_entries.clear(); }
+
+private:
+    struct Entry {
+        Factory factory;
+        std::shared_ptr<ScreenModule> module;
+    };
+
+    std::map<std::string, Entry> m_entries;
+};
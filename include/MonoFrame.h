@@ -0,0 +1,80 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <vector>
+#include "Config.h"
+#include "FontTables.h"
+
+/**
+ * 128x64 1bpp frame in SSD1306 page layout (one byte = 8 vertical pixels)
+ *
+ * Shared renderer for the I2C SSD1306 driver and the serial blit protocol.
+ * Text is copied from the pre-rotated FontTables glyphs one page row at a
+ * time (Fonts::NORMAL, 8-pixel advance, unless another face is given) and
+ * snaps to the page containing y. Drawing only touches the local buffer and
+ * grows a dirty column span per page; takeDirtyWindows() turns those spans
+ * into the page/column windows a device has to be sent.
+ */
+class MonoFrame {
+public:
+    static constexpr int WIDTH = Config::DISPLAY_WIDTH;
+    static constexpr int HEIGHT = Config::DISPLAY_HEIGHT;
+    static constexpr int PAGES = HEIGHT / 8;
+    static constexpr size_t SIZE = WIDTH * PAGES;
+
+    // Inclusive page/column rectangle, sent in horizontal addressing order
+    struct Window {
+        int firstPage;
+        int lastPage;
+        int firstColumn;
+        int lastColumn;
+
+        size_t bytes() const {
+            return static_cast<size_t>(lastPage - firstPage + 1) * (lastColumn - firstColumn + 1);
+        }
+    };
+
+    MonoFrame();
+
+    // Rendering
+    void clear();
+    void setCursor(int x, int y);
+    void drawText(int x, int y, const std::string& text);
+    void drawText(int x, int y, const std::string& text, const GlyphFace& face);
+    void drawText(int x, int y, const char* text, size_t length);
+    void drawCharacter(char c);
+    void drawProgressBar(int x, int y, int width, int height, int percentage);
+
+    // Dirty tracking
+    void markDirty(int startPage, int endPage, int startCol, int endCol);
+    void markAllDirty() { markDirty(0, PAGES - 1, 0, WIDTH - 1); }
+    bool isDirty() const;
+
+    // Return the dirty region as either one bounding window or one window per
+    // page, whichever moves fewer bytes given the per-window overhead, and
+    // reset the dirty spans
+    std::vector<Window> takeDirtyWindows(size_t windowOverhead);
+
+    // Copy a window's bytes in send order; returns the number of bytes copied
+    size_t copyWindow(const Window& window, uint8_t* dest) const;
+
+    // Overwrite a window with bytes in send order and mark it dirty
+    void writeWindow(const Window& window, const uint8_t* src);
+
+    const uint8_t* data() const { return m_buffer; }
+
+private:
+    void resetDirty();
+
+    // Draw at the cursor, advancing and wrapping it like single characters
+    void drawRun(const char* text, size_t length, const GlyphFace& face);
+    void blitGlyphs(int page, int col, const char* text, size_t count, const GlyphFace& face);
+
+    uint8_t m_buffer[SIZE];
+    int m_dirtyStart[PAGES];    // Empty span when start > end
+    int m_dirtyEnd[PAGES];
+    uint8_t m_cursorX = 0;
+    uint8_t m_cursorY = 0;
+};
@@ -6,6 +6,8 @@
 #include <poll.h>
 #include "DeviceInterfaces.h"
 
+struct input_event;
+
 /**
  * Handles input from multiple GPIO button devices and rotary encoders simultaneously
  * Auto-detects and manages GPIO button devices (button@X) and rotary encoders (rotary@X)
@@ -18,8 +20,11 @@ public:
     void close() override;
     bool checkConnection() const override;
     // Input processing (same interface as InputDevice)
+    bool processEvents(const InputHandler& onEvent);
     bool processEvents(std::function<void(int)> onRotation, std::function<void()> onButtonPress);
     int waitForEvents(int timeoutMs);
+    // File descriptors of all open devices, for registering with an event loop
+    std::vector<int> getFds() const;
     // Auto-detection and device management
     static std::vector<std::string> detectGPIOButtonDevices();
     bool addDevice(const std::string& devicePath);
@@ -38,10 +43,12 @@ private:
         int keycode;        // For button devices
         DeviceType type;    // NEW: Device type
         int lastRotaryValue; // NEW: For rotary encoder state tracking
+        struct timeval pressTime; // Enter button down, zero when released
+        EncoderAcceleration acceleration;
         bool isOpen;
         
         GPIODevice(const std::string& p) : path(p), fd(-1), keycode(-1), 
-                                          type(DeviceType::BUTTON), lastRotaryValue(0), isOpen(false) {}
+                                          type(DeviceType::BUTTON), lastRotaryValue(0), pressTime{0, 0}, isOpen(false) {}
     };
 
     std::vector<GPIODevice> m_devices;
@@ -55,10 +62,9 @@ private:
     DeviceType detectDeviceType(const std::string& devicePath); // NEW: Device type detection
 
     // Event processing helpers
-    bool processDeviceEvents(GPIODevice& device, std::function<void(int)> onRotation,
-                           std::function<void()> onButtonPress);
-    void synthesizeMovementEvent(int keycode, std::function<void(int)> onRotation);
-    void processRotaryEncoderEvent(GPIODevice& device, int relativeValue, std::function<void(int)> onRotation); // NEW
+    bool processDeviceEvents(GPIODevice& device, const InputHandler& onEvent);
+    void synthesizeMovementEvent(const struct input_event& ev, const InputHandler& onEvent);
+    void processRotaryEncoderEvent(GPIODevice& device, int steps, const struct timeval& time, const InputHandler& onEvent);
 
     // Debug/logging
     void logDeviceInfo() const;
@@ -0,0 +1,58 @@
+#pragma once
+
+#include <cstdint>
+#include <functional>
+#include <string>
+
+/**
+ * @class NetlinkConfigurator
+ * @brief Synchronous rtnetlink writer for link state, IPv4 addresses and routes
+ *
+ * Every request is sent with NLM_F_ACK and waits for the kernel's answer, so
+ * callers learn immediately whether a change took effect; lastError() holds
+ * the kernel's reason when it did not. Needs CAP_NET_ADMIN for changes. Only
+ * runtime state is touched: persisting settings and driving a DHCP client
+ * stays with the distribution scripts.
+ */
+class NetlinkConfigurator {
+public:
+    NetlinkConfigurator();
+    ~NetlinkConfigurator();
+
+    NetlinkConfigurator(const NetlinkConfigurator&) = delete;
+    NetlinkConfigurator& operator=(const NetlinkConfigurator&) = delete;
+
+    bool setLinkUp(const std::string& interfaceName, bool up);
+
+    /**
+     * @brief Make ip/netmask the only IPv4 address and gateway the default route
+     *
+     * Brings the link up, removes other IPv4 addresses and default routes of
+     * the interface, then adds the address and (unless gateway is empty or
+     * 0.0.0.0) a static default route through it.
+     */
+    bool setStaticIpv4(const std::string& interfaceName, const std::string& ip,
+                       const std::string& netmask, const std::string& gateway);
+
+    // IPv4 default route gateway through the interface, empty when there is none
+    bool getDefaultGateway(const std::string& interfaceName, std::string& gateway);
+
+    const std::string& lastError() const { return m_lastError; }
+
+    // Prefix length of a contiguous dotted netmask, -1 if invalid
+    static int prefixFromNetmask(const std::string& netmask);
+
+private:
+    bool open();
+    bool transact(void* request, uint32_t length);
+    bool dump(void* request, uint32_t length, const std::function<void(const void*, size_t)>& handler);
+    bool removeAddress(int index, uint32_t address, int prefixLength);
+    bool removeDefaultRoute(int index, uint32_t gateway, uint32_t priority);
+    int interfaceIndex(const std::string& interfaceName);
+    bool fail(const std::string& message);
+
+    int m_fd = -1;
+    uint32_t m_seq = 0;
+    int m_lastErrno = 0;                // Kernel error of the last request
+    std::string m_lastError;
+};
@@ -0,0 +1,112 @@
+#pragma once
+
+#include <atomic>
+#include <cstdint>
+#include <map>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+/**
+ * @class NetworkState
+ * @brief Process-wide snapshot of network interfaces kept current by rtnetlink
+ *
+ * One NETLINK_ROUTE socket subscribed to link and IPv4/IPv6 address groups is
+ * read on a background thread. The initial state comes from a link and address
+ * dump; after that the snapshot only changes when the kernel reports a change,
+ * so screens read interfaces, addresses, MACs and carrier state without
+ * getifaddrs(), ioctls or sysfs reads. A lost event (receive buffer overrun)
+ * triggers a fresh dump.
+ *
+ * The generation counter increases whenever the snapshot actually changes;
+ * screens compare it to decide whether to redraw.
+ *
+ * The IPv4 neighbour table (ARP cache) is followed the same way, with its
+ * own generation so neighbour churn does not redraw interface screens.
+ */
+class NetworkState {
+public:
+    struct Address {
+        int family = 0;                 // AF_INET or AF_INET6
+        std::string address;            // Numeric form
+        int prefixLength = 0;
+        bool dynamic = false;           // Has a lifetime (DHCP/SLAAC) rather than being permanent
+    };
+
+    struct Interface {
+        int index = 0;
+        std::string name;
+        unsigned int flags = 0;         // IFF_* from the kernel
+        bool operUp = false;            // Operational state "up" (carrier and ready)
+        bool hasMac = false;
+        uint8_t mac[6] = {0, 0, 0, 0, 0, 0};
+        std::vector<Address> addresses;
+
+        bool isLoopback() const;
+        // First address of a family, nullptr if none
+        const Address* firstAddress(int family) const;
+        // "AABBCCDDEEFF", or with ':' between bytes when separator is set
+        std::string macString(bool separator) const;
+    };
+
+    struct Neighbor {
+        int interfaceIndex = 0;
+        std::string address;            // Dotted IPv4
+        bool hasMac = false;
+        uint8_t mac[6] = {0, 0, 0, 0, 0, 0};
+        uint16_t state = 0;             // NUD_* from the kernel
+        int64_t seen = 0;               // Unix seconds of the last kernel update or confirmation
+    };
+
+    static NetworkState& getInstance();
+
+    NetworkState(const NetworkState&) = delete;
+    NetworkState& operator=(const NetworkState&) = delete;
+
+    // Interfaces ordered by kernel index
+    std::vector<Interface> getInterfaces() const;
+    bool getInterface(const std::string& name, Interface& interface) const;
+    uint64_t getGeneration() const { return m_generation.load(); }
+
+    // Usable entries (reachable, stale, delay, probe or permanent)
+    std::vector<Neighbor> getNeighbors() const;
+    uint64_t getNeighborGeneration() const { return m_neighborGeneration.load(); }
+
+    // Dotted IPv4 netmask for a prefix length
+    static std::string netmaskFromPrefix(int prefixLength);
+
+private:
+    NetworkState();
+    ~NetworkState();
+
+    bool openSocket();
+    bool dump(int type);
+    bool receive(int timeoutMs, uint32_t dumpSeq, bool& dumpDone);
+    void handleMessage(const void* message, size_t length);
+    void handleLink(const void* message, size_t length, bool removed);
+    void handleAddress(const void* message, size_t length, bool removed);
+    void handleNeighbor(const void* message, size_t length, bool removed);
+    void publish();
+    void resync();
+    void run();
+
+    int m_fd = -1;
+    uint32_t m_seq = 0;
+    bool m_changed = false;             // Set while parsing, published after a batch
+    bool m_neighborsChanged = false;
+    bool m_resyncing = false;
+    std::thread m_thread;
+    std::atomic<bool> m_stop{false};
+    std::atomic<uint64_t> m_generation{0};
+    std::atomic<uint64_t> m_neighborGeneration{0};
+
+    // Working copy, touched only by the netlink thread (and the constructor)
+    std::map<int, Interface> m_interfaces;
+    std::map<std::pair<int, std::string>, Neighbor> m_neighbors;   // By interface and address
+
+    // What readers see, replaced as a whole after each batch of changes
+    mutable std::mutex m_mutex;
+    std::map<int, Interface> m_snapshot;
+    std::vector<Neighbor> m_neighborSnapshot;
+};
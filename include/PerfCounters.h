@@ -0,0 +1,139 @@
+#pragma once
+
+#include <atomic>
+#include <cstdint>
+#include <string>
+#include <sys/time.h>
+
+/**
+ * Log-linear latency histogram in the style of HdrHistogram
+ *
+ * Values below SUB_BUCKETS are counted exactly; above that every power of two
+ * is split into SUB_BUCKETS equal buckets, so a percentile is within 12.5% of
+ * the true value from 1 up to 2^MAX_BITS. Recording is two relaxed atomic
+ * adds and a compare-and-swap for the maximum; it never locks or allocates.
+ * The count is the sum of the buckets, so percentiles always agree with it.
+ */
+class LatencyHistogram {
+public:
+    static constexpr int SUB_BITS = 3;
+    static constexpr int SUB_BUCKETS = 1 << SUB_BITS;
+    static constexpr int MAX_BITS = 32;             // Microseconds: about 71 minutes
+    static constexpr int BUCKETS = (MAX_BITS - SUB_BITS + 1) * SUB_BUCKETS;
+
+    struct Snapshot {
+        uint64_t count = 0;
+        uint64_t sum = 0;
+        uint64_t max = 0;
+        uint64_t buckets[BUCKETS] = {};
+
+        // Upper bound of the bucket holding the p-quantile, capped at max
+        uint64_t percentile(double p) const;
+        double mean() const { return count ? static_cast<double>(sum) / count : 0.0; }
+    };
+
+    LatencyHistogram();
+
+    void record(uint64_t value);
+
+    // Not atomic as a whole: fields may be a few records apart
+    Snapshot snapshot() const;
+
+    static int bucketFor(uint64_t value);
+    static uint64_t bucketUpperBound(int bucket);
+
+private:
+    std::atomic<uint64_t> m_buckets[BUCKETS];
+    std::atomic<uint64_t> m_sum;
+    std::atomic<uint64_t> m_max;
+};
+
+/**
+ * Process-wide counters and latency histograms for production diagnostics
+ *
+ * Updates are relaxed atomics, so the display drivers, the serial writer
+ * thread, module workers and the UI thread all count without locks. The
+ * stats socket (StatsServer), the Prometheus textfile and the hidden
+ * "diagnostics" screen read snapshots through report() and prometheus().
+ *
+ * Input latency is measured from the kernel timestamp of the oldest input
+ * not yet answered to the next frame that reaches the device (frameFlushed()).
+ */
+class PerfCounters {
+public:
+    enum class Counter {
+        INPUT_EVENTS,
+        FRAMES,
+        SERIAL_BYTES,
+        SERIAL_WRITES,
+        SERIAL_PARTIAL_WRITES,      // write() accepted less than the rest of a frame
+        SERIAL_DROPPED_FRAMES,      // Writer ring full
+        SERIAL_MERGED_FRAMES,       // Superseded while the link was backed up
+        I2C_TRANSACTIONS,           // ioctl(I2C_RDWR) or write() calls
+        I2C_BYTES,
+        I2C_ERRORS,
+        CHILD_PROCESSES,
+        STORAGE_SAVES,              // Snapshot writes and journal appends
+        STORAGE_SAVE_FAILURES,
+        PUSH_MESSAGES,              // Datagrams applied by PushServer
+        PUSH_REJECTED,              // Malformed, oversized or over the screen limit
+        COUNT
+    };
+
+    enum class Histogram {
+        INPUT_TO_FLUSH,             // Kernel input timestamp to the answering frame
+        FRAME_RENDER,               // First draw call of a frame to the end of present()
+        SERIAL_WRITE,               // One protocol frame written and drained
+        STORAGE_SAVE,
+        COUNT
+    };
+
+    static PerfCounters& getInstance();
+
+    PerfCounters(const PerfCounters&) = delete;
+    PerfCounters& operator=(const PerfCounters&) = delete;
+
+    void add(Counter counter, uint64_t value = 1) {
+        m_counters[static_cast<int>(counter)].fetch_add(value, std::memory_order_relaxed);
+    }
+    uint64_t get(Counter counter) const {
+        return m_counters[static_cast<int>(counter)].load(std::memory_order_relaxed);
+    }
+
+    // Values in microseconds
+    void record(Histogram histogram, uint64_t us) { m_histograms[static_cast<int>(histogram)].record(us); }
+    LatencyHistogram::Snapshot snapshot(Histogram histogram) const {
+        return m_histograms[static_cast<int>(histogram)].snapshot();
+    }
+
+    // An input was read; only the oldest unanswered one is timed
+    void markInput(const struct timeval& kernelTime);
+
+    // A frame reached the device: answers the pending input, if any
+    void frameFlushed();
+
+    static const char* name(Counter counter);
+    static const char* name(Histogram histogram);
+
+    // CLOCK_MONOTONIC, for timing spans
+    static int64_t nowUs();
+
+    // One "key=value" per line; histograms as _count/_p50/_p90/_p99/_max/_mean in us
+    std::string report() const;
+
+    // Prometheus text exposition: counters as *_total, histograms as summaries in seconds
+    std::string prometheus() const;
+
+    // For the node_exporter textfile collector: written to a temporary file, then renamed
+    bool writeTextfile(const std::string& path) const;
+
+private:
+    PerfCounters();
+
+    static int64_t wallUs(const struct timeval& time);
+
+    int64_t m_startUs;
+    std::atomic<uint64_t> m_counters[static_cast<int>(Counter::COUNT)];
+    LatencyHistogram m_histograms[static_cast<int>(Histogram::COUNT)];
+    std::atomic<int64_t> m_pendingInputUs{0};      // Wall clock, like input_event; 0 = none
+};
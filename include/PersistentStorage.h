@@ -4,14 +4,29 @@
 #include <map>
 #include <memory>
 #include <mutex>
+#include <condition_variable>
+#include <thread>
 #include <nlohmann/json.hpp>
 
 /**
  * Centralized persistent storage manager for screen modules
  * Handles reading/writing JSON data for all modules
+ *
+ * Changes are written by one long-lived writer thread. Bursts of setValue()
+ * calls are coalesced into a single snapshot written to a temporary file and
+ * rename()d into place, so the file is always either the old or the new
+ * version. With the journal enabled each change is appended to
+ * "<file>.journal" as one compact JSON line instead, and the full snapshot is
+ * only rewritten when the journal grows large, at startup (after replaying
+ * it) and at shutdown.
  */
 class PersistentStorage {
 public:
+    struct Options {
+        bool fsync = false;     // fsync file and directory after each write
+        bool journal = false;   // Append-only change log, compacted on startup
+    };
+
     // Singleton access
     static PersistentStorage& getInstance();
 
@@ -21,6 +36,7 @@ public:
 
     // Initialize with storage file path
     bool initialize(const std::string& filePath = "");
+    bool initialize(const std::string& filePath, const Options& options);
 
     // Set and get string values
     bool setValue(const std::string& moduleId, const std::string& key, const std::string& value);
@@ -41,9 +57,12 @@ public:
     // Check if a value exists
     bool hasValue(const std::string& moduleId, const std::string& key);
 
-    // Save data to file (can be called explicitly, but also called by setValue methods)
+    // Write the full snapshot now, on the calling thread (setValue saves in the background)
     bool saveToFile();
 
+    // Flush pending changes and stop the writer thread; initialize() again to reuse
+    void shutdown();
+
     // Get the current storage file path
     std::string getStorageFilePath() const { return m_storageFilePath; }
 
@@ -57,18 +76,35 @@ private:
 
     // Load data from file
     bool loadFromFile();
+    size_t replayJournal();
+
+    // Common part of the setValue overloads
+    bool storeValue(const std::string& moduleId, const std::string& key, nlohmann::json value);
+
+    // Writer thread
+    void startWriter();
+    void stopWriter();
+    void writerLoop();
+    bool writeSnapshot(std::unique_lock<std::mutex>& lock);
+    bool appendJournal(const std::string& records, bool& compact);
+    void closeJournal();
 
     // Internal data storage
     nlohmann::json m_data;
     std::string m_storageFilePath;
+    Options m_options;
     bool m_initialized = false;
-    bool m_isDirty = false;
-    
+    bool m_isDirty = false;             // Snapshot on disk is older than m_data
+
     // Thread safety
     std::mutex m_mutex;
-    
-    // Delay save mechanism
-    void scheduleSave();
-    void cancelScheduledSave();
-    bool m_savePending = false;
+    std::mutex m_fileMutex;             // Orders snapshot writes and journal appends
+
+    // Coalescing writer
+    std::thread m_writer;
+    std::condition_variable m_writerWake;
+    bool m_writerStop = false;
+    std::string m_pendingJournal;       // Records not yet appended
+    int m_journalFd = -1;               // Guarded by m_fileMutex
+    size_t m_journalBytes = 0;
 };
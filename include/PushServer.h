@@ -0,0 +1,70 @@
+#pragma once
+
+#include <cstdint>
+#include <map>
+#include <string>
+#include <vector>
+
+/**
+ * Unix datagram socket through which other services push content into
+ * "push" screens, instead of the panel polling their scripts
+ *
+ * Each datagram is one message: a header line "SCREEN COMMAND [ARGS]" and,
+ * for some commands, a payload after the first newline:
+ *   title TEXT              Screen title (default: the module's title)
+ *   line N TEXT             Body line N, 0-based, below PUSH_MAX_LINES
+ *   lines                   Payload lines replace the body
+ *   items                   Payload lines replace the list, scrolled with the encoder
+ *   progress PCT [LABEL]    Progress bar 0-100; -1 hides it
+ *   frame                   Payload is one whole 1bpp frame in MonoFrame layout
+ *   clear                   Forget everything pushed to SCREEN
+ *
+ * poll() drains at most PUSH_MAX_DATAGRAMS_PER_POLL datagrams and only
+ * updates the content kept per screen; screens draw whatever is latest when
+ * they next update, so a burst of pushes costs one redraw. Datagrams not yet
+ * drained wait in the socket's receive queue, and once it is full senders
+ * block (or get EAGAIN): the kernel provides the backpressure.
+ *
+ * Not thread-safe: use from the UI thread only.
+ */
+class PushServer {
+public:
+    struct Content {
+        std::string title;
+        std::vector<std::string> lines;
+        std::vector<std::string> items;
+        int progress = -1;
+        std::string progressLabel;
+        std::vector<uint8_t> frame;     // MonoFrame::SIZE bytes, or empty
+        bool showFrame = false;         // The latest push was a frame
+        uint64_t generation = 0;        // Changes with every applied push
+    };
+
+    static PushServer& getInstance();
+
+    PushServer(const PushServer&) = delete;
+    PushServer& operator=(const PushServer&) = delete;
+
+    bool listen(const std::string& path);
+    void stop();
+
+    // Readable while datagrams are queued
+    int getFd() const { return m_fd; }
+
+    // Apply queued datagrams without blocking; returns how many were applied
+    int poll();
+
+    // nullptr until something is pushed to screen
+    const Content* find(const std::string& screen) const;
+
+private:
+    PushServer() = default;
+    ~PushServer();
+
+    bool apply(const char* data, size_t length);
+
+    int m_fd = -1;
+    std::string m_path;
+    uint64_t m_generation = 0;
+    std::map<std::string, Content> m_screens;
+};
@@ -0,0 +1,96 @@
+#pragma once
+
+#include <atomic>
+#include <cstdint>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+#include <sys/socket.h>
+
+/**
+ * @class ReachabilityProbe
+ * @brief One-shot layered connectivity check with all stages in flight at once
+ *
+ * A worker thread drives every stage from one poll() loop, so a broken
+ * network costs one timeout instead of a timeout per stage:
+ *
+ * - GW: ICMP echo to the IPv4 default gateway, then its neighbor entry, so a
+ *   gateway that drops pings still shows whether L2 works
+ * - DNS: A and AAAA queries sent together over UDP to the first resolv.conf
+ *   nameserver; the first answer gives the latency
+ * - TCP: happy-eyeballs connect (RFC 8305) to the resolved name, IPv6 first
+ *   and IPv4 after HAPPY_EYEBALLS_CONNECT_DELAY_MS, first one to connect wins
+ * - one ICMP echo per target, all on the same socket
+ *
+ * Latencies are taken on CLOCK_MONOTONIC in microseconds. Results are
+ * published under a mutex with a generation counter for the screen to poll.
+ */
+class ReachabilityProbe {
+public:
+    enum class Status {
+        PENDING,
+        OK,
+        FAILED,
+        SKIPPED     // Not needed (IP literal) or a stage it depends on failed
+    };
+
+    struct Result {
+        std::string label;      // "GW", "DNS", "TCP" or the target address
+        Status status = Status::PENDING;
+        double ms = 0.0;
+        std::string detail;     // Short reason or qualifier, e.g. "arp", "v6", "NXDOMAIN"
+    };
+
+    struct Options {
+        std::string dnsName;
+        int tcpPort = 443;
+        std::vector<std::string> targets;   // IPv4 addresses
+        int timeoutMs = 2000;
+    };
+
+    // Result rows in display order
+    enum Row { ROW_GATEWAY = 0, ROW_DNS = 1, ROW_TCP = 2, ROW_FIRST_TARGET = 3 };
+
+    ReachabilityProbe();
+    ~ReachabilityProbe();
+
+    ReachabilityProbe(const ReachabilityProbe&) = delete;
+    ReachabilityProbe& operator=(const ReachabilityProbe&) = delete;
+
+    // Start a run in the background; a running one is stopped first
+    void start(const Options& options);
+
+    // Abort and wait for the worker; unfinished stages stay PENDING
+    void stop();
+
+    bool isFinished() const { return m_finished.load(); }
+    unsigned int getGeneration() const { return m_generation.load(); }
+    std::vector<Result> getResults() const;
+
+    // IPv4 default gateway of the main table (lowest metric), empty when none
+    static std::string defaultGateway();
+
+    // Whether the kernel holds a resolved neighbor entry for an IPv4 address
+    static bool hasNeighbor(const std::string& address);
+
+    // First nameserver in resolv.conf, port 53
+    static bool nameserver(struct sockaddr_storage& server, socklen_t& length);
+
+    // Recursive DNS query for name; empty if the name cannot be encoded
+    static std::vector<uint8_t> buildQuery(const std::string& name, uint16_t id, uint16_t type);
+
+private:
+    void run(Options options);
+    void publish(int row, Status status, double ms, const std::string& detail);
+    bool pending(int row) const;
+
+    std::thread m_thread;
+    std::atomic<bool> m_stop{false};
+    std::atomic<bool> m_finished{false};
+    std::atomic<unsigned int> m_generation{0};
+    int m_wakeFd = -1;
+
+    mutable std::mutex m_mutex;
+    std::vector<Result> m_results;
+};
@@ -0,0 +1,31 @@
+#pragma once
+
+#include <memory>
+#include <string>
+#include "Config.h"
+
+class Display;
+
+/**
+ * What each text row of the display currently shows
+ *
+ * For screens that redraw by full rows: draw() pads the text to the display
+ * width so stale characters are overwritten, and skips rows that already
+ * show it, so a periodic refresh only sends the rows that changed.
+ * invalidate() forgets everything, for when the screen is cleared or
+ * re-entered.
+ */
+class RowCache {
+public:
+    static constexpr int ROWS = Config::DISPLAY_HEIGHT / 8;
+    static constexpr size_t COLUMNS = 16;
+
+    explicit RowCache(std::shared_ptr<Display> display) : m_display(std::move(display)) {}
+
+    void draw(int row, const std::string& text);
+    void invalidate();
+
+private:
+    std::shared_ptr<Display> m_display;
+    std::string m_lines[ROWS];
+};
@@ -0,0 +1,83 @@
+#pragma once
+
+#include <cstdint>
+#include <functional>
+#include <map>
+#include <string>
+
+class EventLoop;
+
+/**
+ * @class Scheduler
+ * @brief Deadline scheduler for periodic module and service work
+ *
+ * Jobs register a period, a cost class and whether they only matter while
+ * the panel is visible. One timerfd on the main EventLoop is armed for the
+ * earliest deadline, rounded up to a SCHEDULER_TICK_MS grid so jobs with
+ * nearby deadlines share a wakeup; LIGHT jobs due within
+ * SCHEDULER_COALESCE_MS of a wakeup run on it early instead of waking the
+ * loop again. At most one HEAVY job (script runs, scans) starts per wakeup,
+ * the rest move to the next tick.
+ *
+ * While the display is powered off or unplugged, visibility-bound jobs are
+ * parked and cost nothing; other HEAVY jobs run SCHEDULER_HIDDEN_SLOWDOWN
+ * times less often. Becoming visible runs every parked job once, together in
+ * one wakeup, before they resume their normal cadence.
+ *
+ * Jobs run on the loop thread. Loops that do not go through the EventLoop
+ * (ScreenModule::run) call runDue() themselves. Not thread-safe.
+ */
+class Scheduler {
+public:
+    enum class Cost {
+        LIGHT,      // A few syscalls: may run early to share a wakeup
+        HEAVY       // Spawns or scans: spread out, slowed while hidden
+    };
+
+    using Job = std::function<void()>;
+
+    static Scheduler& getInstance();
+
+    Scheduler(const Scheduler&) = delete;
+    Scheduler& operator=(const Scheduler&) = delete;
+
+    // Deadlines go through a timer on this loop; without one only runDue() runs jobs
+    void attach(EventLoop* loop);
+    void detach();
+
+    // First run one period from now; the id stays valid until remove()
+    int add(const std::string& name, int periodMs, Cost cost, bool visibleOnly, Job job);
+    void remove(int id);
+
+    // Display powered and connected; false parks visibility-bound jobs
+    void setVisible(bool visible);
+    bool isVisible() const { return m_visible; }
+
+    // Run whatever is due and rearm the timer
+    void runDue();
+
+private:
+    struct Entry {
+        std::string name;
+        int periodMs = 0;
+        Cost cost = Cost::LIGHT;
+        bool visibleOnly = false;
+        bool parked = false;        // Missed a run while hidden
+        int64_t dueMs = 0;          // CLOCK_MONOTONIC
+        Job job;
+    };
+
+    Scheduler() = default;
+
+    int64_t periodFor(const Entry& entry) const;
+    void rearm(int64_t now);
+
+    EventLoop* m_loop = nullptr;
+    int m_timer = -1;
+    bool m_visible = true;
+    bool m_catchUp = false;         // Next pass runs the parked jobs
+    bool m_running = false;         // Inside runDue(): rearm on the way out
+    int64_t m_nextDueMs = 0;        // Earliest active deadline, unrounded
+    int m_nextId = 1;
+    std::map<int, Entry> m_jobs;
+};
@@ -2,6 +2,7 @@
 
 #include <string>
 #include <memory>
+#include <functional>
 #include <thread>
 #include <atomic>
 #include <vector>
@@ -9,6 +10,25 @@
 #include <chrono>
 #include <sys/time.h>
 #include "IPSelector.h"
+#include "IcmpPinger.h"
+#include "SubnetScanner.h"
+#include "Iperf3Client.h"
+#include "Iperf3Server.h"
+#include "MdnsBrowser.h"
+#include "HttpSpeedTest.h"
+#include "InputEvent.h"
+#include "LineRing.h"
+#include "LogTail.h"
+#include "ItemIndex.h"
+#include "PushServer.h"
+#include "ReachabilityProbe.h"
+#include "LatencyUnderLoad.h"
+#include "MeshAgent.h"
+#include "MeshCoordinator.h"
+#include "HistoryLog.h"
+#include "LauncherClient.h"
+#include "WirelessState.h"
+#include "RowCache.h"
 #include <nlohmann/json.hpp>
 using json = nlohmann::json;
 
@@ -35,6 +55,13 @@ public:
     // Input handling
     virtual bool handleInput() = 0;
 
+    // One input event from either input backend; false ends the module. The
+    // default sends movement to handleGPIORotation() and a press to
+    // handleGPIOButtonPress(), so most screens only override those two
+    virtual bool handleInputEvent(const InputEvent& event);
+    virtual void handleGPIORotation(int direction) { (void)direction; }
+    virtual bool handleGPIOButtonPress() { return false; }  // Press exits by default
+
     // Main run loop
     void run();
 
@@ -45,10 +72,17 @@ public:
     // Added for module identification
     virtual std::string getModuleId() const = 0;
 
+    // Checked by run() every iteration instead of the display's disconnect
+    // flag; may block until a replugged device is back, false ends the module
+    static void setDeviceGuard(std::function<bool()> guard) { s_deviceGuard = guard; }
+
 protected:
     std::shared_ptr<Display> m_display;
     std::shared_ptr<InputDevice> m_input;
     std::atomic<bool> m_running{false};
+
+private:
+    static std::function<bool()> s_deviceGuard;
 };
 
 // Forward declarations
@@ -69,7 +103,10 @@ public:
     std::string getModuleId() const override { return "network"; }
 
 private:
+    void render();
     void getNetworkInfo(std::string& ip, std::string& mac, std::string& iface);
+
+    uint64_t m_networkGeneration = 0;   // NetworkState generation last drawn
 };
 
 /**
@@ -85,15 +122,91 @@ public:
     bool handleInput() override;
     std::string getModuleId() const override { return "system"; }
 
+    // GPIO support: rotation cycles between all CPUs and single cores
+    void handleGPIORotation(int direction) override;
+
+private:
+    void selectCore(int direction);
+    void drawBars();
+    void drawSparklines();
+    void drawSparkline(const std::vector<int32_t>& values, int32_t scale, int firstPage, int pages);
+
+    uint64_t m_drawnGeneration = 0;     // MetricsSampler generation on screen
+    bool m_redrawNeeded = true;
+    bool m_graphEnabled = false;        // Sparklines need a blit-capable display
+    int m_core = -1;                    // -1: all CPUs
+};
+
+/**
+ * Hidden diagnostics screen showing PerfCounters latencies and counters
+ *
+ * No shipped menu lists it; add a "diagnostics" module to the screen config
+ * to reach it. Rotation switches between the latency and the counter page.
+ */
+class DiagnosticsScreen : public ScreenModule {
+public:
+    DiagnosticsScreen(std::shared_ptr<Display> display, std::shared_ptr<InputDevice> input);
+
+    void enter() override;
+    void update() override;
+    void exit() override;
+    bool handleInput() override;
+    std::string getModuleId() const override { return "diagnostics"; }
+
+    void handleGPIORotation(int direction) override;
+
 private:
-    void getSystemInfo(std::string& cpu, std::string& memTotal, std::string& memFree,
-                       int& cpuPercentage, int& memPercentage);
+    void drawLatencies();
+    void drawCounters();
 
-    struct timeval m_lastUpdate = {0, 0};
+    int m_page = 0;
+    bool m_redrawNeeded = true;
+    std::chrono::steady_clock::time_point m_lastDraw;
+};
+
+/**
+ * Push Screen
+ * Shows content other services push over the PushServer socket (config type
+ * "push"); redraws only when the channel's content changed
+ */
+class PushScreen : public ScreenModule {
+public:
+    PushScreen(std::shared_ptr<Display> display, std::shared_ptr<InputDevice> input);
+
+    void enter() override;
+    void update() override;
+    void exit() override;
+    bool handleInput() override;
+    std::string getModuleId() const override { return m_id; }
+
+    void handleGPIORotation(int direction) override;
+
+    void setId(const std::string& id) { m_id = id; }
+    void setTitle(const std::string& title) { m_title = title; }
+    // Screen name senders address; defaults to the module id
+    void setChannel(const std::string& channel) { m_channel = channel; }
+
+private:
+    void drawFrame(const std::vector<uint8_t>& frame);
+    void drawText(const PushServer::Content* content);
+
+    std::string m_id;
+    std::string m_title;
+    std::string m_channel;
+    uint64_t m_drawnGeneration = 0;
+    bool m_drawn = false;
+    bool m_frameShown = false;
+    int m_scroll = 0;
+    std::vector<std::string> m_drawnRows;   // Title and body rows as last drawn
+    int m_drawnProgress = -1;
 };
 
 /**
  * Generic text display screen that executes a script and shows output
+ *
+ * With "stream" set the script is started once and kept running (tail -f,
+ * dmesg -w); its lines collect in a fixed-size scrollback that follows the
+ * newest line until the encoder scrolls back.
  */
 class TextBoxScreen : public ScreenModule {
 public:
@@ -105,9 +218,9 @@ public:
     bool handleInput() override;
     std::string getModuleId() const override { return m_moduleId; }
 
-    // GPIO support methods
-    void handleGPIORotation(int direction);
-    bool handleGPIOButtonPress();
+    // Any input leaves the screen; in stream mode rotation scrolls
+    bool handleInputEvent(const InputEvent& event) override;
+    void handleGPIORotation(int direction) override;
 
     // Dynamic ID support (like GenericListScreen)
     void setId(const std::string& id);
@@ -122,17 +235,36 @@ private:
     void updateSingleLine(size_t lineIndex, const std::string& content, int yPosition);
     std::string replaceUnicodeChars(const std::string& input);
     std::string substituteParameters(const std::string& input);
-    std::vector<std::string> executeScript();
+    std::vector<std::string> executeScript(int ttlMs, bool& loading);
+    std::vector<std::string> outputLines(const std::string& output) const;
     virtual std::string getScriptPath();
     virtual std::string getTitle();
     virtual double getRefreshSeconds();
+    int getMillisecondsSetting(const std::string& key);
+    void enterStream();
+    void updateStream();
+    void drawStream();
 
     bool m_shouldExit;
     double m_refreshSeconds;
-    std::chrono::steady_clock::time_point m_lastExecutionTime;
+    int m_refreshJob = -1;             // Scheduler job while refresh_sec is set
     std::string m_moduleId;
     std::vector<std::string> m_previousContent;
     std::map<std::string, std::string> m_runtimeParams;
+    std::string m_scriptPath;          // Resolved on enter()
+    int m_cacheTtlMs = 0;              // Cached output younger than this is shown without rerunning
+    int m_commandTimeoutMs = 0;        // 0 = CommandRunner default
+    uint64_t m_outputGeneration = 0;   // Last CommandRunner result drawn
+
+    // Stream mode
+    bool m_streamMode = false;
+    int m_streamId = -1;               // CommandRunner stream, -1 when none
+    bool m_streamEnded = false;
+    LineRing m_scrollback;
+    uint64_t m_drawnTotal = 0;         // m_scrollback.total() on screen
+    size_t m_scrollOffset = 0;         // Lines above the newest; 0 follows
+    bool m_streamRedraw = false;
+    std::vector<std::string> m_streamRows;  // Rows as last drawn
 };
 
 /**
@@ -148,6 +280,8 @@ public:
     bool handleInput() override;
     std::string getModuleId() const override { return "brightness"; }
 
+    void handleGPIORotation(int direction) override;
+
 private:
     void updateBrightnessValue(int brightness);
     void setupScreen();
@@ -157,6 +291,10 @@ private:
 
 /**
  * Internet connectivity test screen
+ *
+ * Runs a ReachabilityProbe and shows one row per stage (gateway, DNS, TCP,
+ * each ICMP target) with its latency as results come in, then a verdict
+ * naming the first layer that failed. Pressing while it runs stops the probe.
  */
 class InternetTestScreen : public ScreenModule {
 public:
@@ -169,23 +307,20 @@ public:
     std::string getModuleId() const override { return "internet"; }
 
 private:
-    static int pingServer(const std::string& server, int timeoutSec);
-    void startTest();
-
-    std::thread m_testThread;
-    std::atomic<bool> m_testCompleted{false};
-    std::atomic<int> m_testResult{-1};
-    std::atomic<int> m_progress{0};
-    std::chrono::steady_clock::time_point m_startTime;
-    int64_t m_progressLastUpdated = 0;
-    int64_t m_animationLastUpdated = 0;
-    bool m_resultDisplayed = false;
-    const int m_timeoutSec = 5;
-    const std::string m_testServer = "8.8.8.8";
+    ReachabilityProbe::Options loadOptions() const;
+    std::string verdict(const std::vector<ReachabilityProbe::Result>& results) const;
+    void render();
+
+    ReachabilityProbe m_probe;
+    unsigned int m_generation = 0;
+    bool m_interrupted = false;
+    bool m_recorded = false;            // This run's TCP result is in the HistoryLog
+    std::vector<std::string> m_lastRows;
 };
 
 /**
- * WiFi settings screen
+ * WiFi screen: scan results by signal, the current link's live signal and
+ * bitrate, and the radio's rfkill switch, all from WirelessState (nl80211)
  */
 class WiFiSettingsScreen : public ScreenModule {
 public:
@@ -198,17 +333,33 @@ public:
     std::string getModuleId() const override { return "wifi"; }
 
     // GPIO support methods
-    void handleGPIORotation(int direction);
-    bool handleGPIOButtonPress();
+    void handleGPIORotation(int direction) override;
+    bool handleGPIOButtonPress() override;
 
 private:
-    void setWiFiStatus(bool enabled);
-    bool getWiFiStatus() const;
-    void renderOptions();
-
-    std::vector<std::string> m_options = {"Turn On", "Turn Off", "Back"};
-    int m_selectedOption = 0;
-    mutable bool m_currentWiFiState = false;
+    enum class View { MENU, NETWORKS, DETAIL, LINK };
+    enum { MENU_OPTIONS = 4, VISIBLE_ROWS = 6 };
+
+    void handleRotation(int direction);
+    bool handleButton();
+    void showView(View view);
+    void render();
+    void renderMenu();
+    void renderNetworks();
+    void renderDetail();
+    void renderLink();
+
+    View m_view = View::MENU;
+    int m_selected = 0;                     // MENU: option; NETWORKS: network index, size() = Back
+    int m_scrollOffset = 0;
+    std::string m_selectedBssid;            // NETWORKS/DETAIL: keeps the selection as the list resorts
+    std::vector<WirelessState::Network> m_networks;
+    WirelessState::Radio m_radio = WirelessState::Radio::UNKNOWN;
+    uint64_t m_shownGeneration = 0;
+    int64_t m_renderedMs = 0;
+    int m_refreshJob = -1;
+    RowCache m_rows;
+    bool m_shouldExit = false;
 };
 
 // Simple example screens for demo menu items
@@ -259,6 +410,7 @@ enum class IPPingMenuState {
 
 /**
  * IP Ping Test screen
+ * Pings continuously in-process and shows live RTT and loss statistics
  */
 class IPPingScreen : public ScreenModule {
 public:
@@ -271,29 +423,81 @@ public:
     std::string getModuleId() const override { return "ping"; }
     const std::string& getSelectedIp() const;
     //GPIO input handling methods
-    void handleGPIORotation(int direction);
-    bool handleGPIOButtonPress();
+    void handleGPIORotation(int direction) override;
+    bool handleGPIOButtonPress() override;
 private:
     void showIpSelector();
     void startPing();
+    void stopPing();
     void renderMenu(bool fullRedraw);
     void updateStatusLine();
-    void checkPingStatus();
 
     std::string m_targetIp;
     std::unique_ptr<IPSelector> m_ipSelector;
-    std::atomic<pid_t> m_pingPid{-1};
-    std::atomic<bool> m_pingInProgress{false};
-    std::atomic<int> m_pingResult{-1};
-    std::string m_statusMessage;
+    IcmpPinger m_pinger;
+    unsigned int m_statsGeneration = 0;
+    unsigned int m_recordedReplies = 0;     // Already in the HistoryLog
+    unsigned int m_recordedLost = 0;
     std::string m_lastStatusText;
+    std::string m_lastDetailText;
     bool m_statusChanged = false;
-    double m_pingTimeMs = 0.0;
 
     IPPingMenuState m_state{IPPingMenuState::MENU_STATE_IP};
     bool m_shouldExit{false};
 };
 
+enum class SweepMenuState {
+    MENU_STATE_IFACE,    // Interface to sweep from
+    MENU_STATE_RANGE,    // Prefix length of the swept range
+    MENU_STATE_SWEEP,    // Start sweep / show results
+    MENU_STATE_EXIT      // Exit menu
+};
+
+/**
+ * Subnet sweep screen
+ * Discovers hosts on a local subnet and lists them as they answer
+ */
+class SubnetSweepScreen : public ScreenModule {
+public:
+    SubnetSweepScreen(std::shared_ptr<Display> display, std::shared_ptr<InputDevice> input);
+
+    void enter() override;
+    void update() override;
+    void exit() override;
+    bool handleInput() override;
+    std::string getModuleId() const override { return "sweep"; }
+    //GPIO input handling methods
+    void handleGPIORotation(int direction) override;
+    bool handleGPIOButtonPress() override;
+private:
+    enum class View { MENU, RESULTS, DETAILS };
+    enum { VISIBLE_ROWS = 6 };
+
+    void handleRotation(int direction);
+    bool handleButton();
+    void startSweep();
+    void selectDefaultRange();
+    void renderMenu();
+    void renderResults();
+    void renderDetails();
+    void render();
+
+    SubnetScanner m_scanner;
+    std::vector<SubnetScanner::Subnet> m_subnets;
+    std::vector<SubnetScanner::Host> m_hosts;
+    size_t m_subnetIndex = 0;
+    int m_prefix = 24;
+    unsigned int m_generation = 0;
+    bool m_hostsShared = true;  // This sweep's finds are in IPSuggestions
+
+    View m_view = View::MENU;
+    SweepMenuState m_state{SweepMenuState::MENU_STATE_IFACE};
+    int m_selectedHost = 0;     // Index into m_hosts; m_hosts.size() is "Back"
+    int m_scrollOffset = 0;
+    RowCache m_rows;            // What each text row currently shows
+    bool m_shouldExit{false};
+};
+
 /**
  * Network interfaces screen
  * Shows a list of all network interfaces and details
@@ -308,8 +512,8 @@ public:
     void exit() override;
     bool handleInput() override;
     std::string getModuleId() const override { return "netinfo"; }
-    void handleGPIORotation(int direction);
-    bool handleGPIOButtonPress();
+    void handleGPIORotation(int direction) override;
+    bool handleGPIOButtonPress() override;
 
     // Callback support (same pattern as GenericListScreen)
     void setCallback(ScreenCallback* callback) { m_callback = callback; }
@@ -338,8 +542,8 @@ public:
     std::string getModuleId() const override { return "netsettings"; }
 
     // GPIO support methods
-    void handleGPIORotation(int direction);
-    bool handleGPIOButtonPress();
+    void handleGPIORotation(int direction) override;
+    bool handleGPIOButtonPress() override;
 
 private:
     // Internal implementation
@@ -362,9 +566,11 @@ public:
     std::string getModuleId() const override { return "speedtest"; }
 
 private:
-    static double calculateSpeed(size_t bytes, std::chrono::milliseconds duration);
     void startDownloadTest();
     void startUploadTest();
+    void startProbe(HttpSpeedTest::Direction direction, const std::string& url);
+    void pollProbe();
+    void drawGraph();
     void renderScreen();
     void updateStatusLine();
     bool checkConfiguration();
@@ -373,7 +579,11 @@ private:
     // Configuration
     std::string m_downloadUrl;
     std::string m_uploadScript;
+    std::string m_uploadUrl;                // Preferred over the script when set
     bool m_uploadEnabled;
+    int m_connections = 0;                  // Set by checkConfiguration()
+    int m_warmupMs = 0;
+    int m_durationMs = 0;
 
     // Test state
     std::thread m_testThread;
@@ -384,6 +594,12 @@ private:
     std::atomic<double> m_downloadSpeed{0.0};
     std::atomic<double> m_uploadSpeed{0.0};
     std::atomic<int> m_testResult{-1};  // -1: not started, 0: success, 1: failure
+    HttpSpeedTest m_probe;
+    bool m_probeActive = false;
+    bool m_graphEnabled = false;        // Display takes bitmaps: live graph instead of bar
+    std::vector<HttpSpeedTest::Sample> m_graph;
+    size_t m_graphSlots = 0;
+    size_t m_sampleCount = 0;
     std::chrono::steady_clock::time_point m_startTime;
     int64_t m_progressLastUpdated = 0;
     int64_t m_animationLastUpdated = 0;
@@ -409,8 +625,8 @@ public:
     std::string getModuleId() const override { return "throughputserver"; }
 
     // GPIO support methods
-    void handleGPIORotation(int direction);
-    bool handleGPIOButtonPress();
+    void handleGPIORotation(int direction) override;
+    bool handleGPIOButtonPress() override;
 
 private:
     void renderOptions();
@@ -421,6 +637,8 @@ private:
     std::string getIperf3Path();
     void getLocalIpAddress();
     void refreshSettings();
+    void drawClientStatus(bool force);
+    void startAnnouncement();
     inline bool isAvahiAvailable() const {
         return (system("which avahi-publish > /dev/null 2>&1") == 0);
     };
@@ -428,9 +646,15 @@ private:
     int m_selectedOption = 0;
     int m_port = 5201;             // Default port
     std::string m_localIp;         // Local IP address
+    uint64_t m_networkGeneration = 0;  // NetworkState generation m_localIp came from
     pid_t m_serverPid = -1;        // PID of the iperf3 server process
     std::thread m_serverThread;    // Thread for server operation
     pid_t m_avahiPid = -1;  // PID for the Avahi announcement process
+    Iperf3Server m_server;         // Built-in server (default engine)
+    bool m_useNativeEngine = true; // false: fork the iperf3 binary
+    std::string m_statusLines[2];  // Last text drawn at y=48/56
+    time_t m_lastStatusUpdate = 0;
+    size_t m_clientIndex = 0;      // Client shown when several are connected
 };
 // Add these enum declarations:
 
@@ -438,6 +662,7 @@ private:
 enum class ThroughputClientState {
     MENU_STATE_START,
     MENU_STATE_START_REVERSE,
+    MENU_STATE_START_LATENCY,
     MENU_STATE_PROTOCOL,
     MENU_STATE_DURATION,
     MENU_STATE_BANDWIDTH,
@@ -481,10 +706,12 @@ public:
     std::string getModuleId() const override { return "throughputclient"; }
 
     // GPIO support methods
-    void handleGPIORotation(int direction);
-    bool handleGPIOButtonPress();
+    void handleGPIORotation(int direction) override;
+    bool handleGPIOButtonPress() override;
 
 private:
+    friend struct BenchAccess;      // bench/ times parseTestResults()
+
     // Menu state and rendering
     ThroughputClientState m_state;
     int m_submenuSelection;
@@ -506,6 +733,13 @@ private:
     // Test execution
     bool m_testInProgress;
     pid_t m_testPid;
+    int m_testPipe = -1;                    // iperf3 stdout, read incrementally
+    bool m_jsonStream = false;              // iperf3 --json-stream, else text lines
+    bool m_haveSummary = false;             // The run printed its end-of-test figures
+    std::string m_probedIperf3;             // iperf3 binary the two flags below describe
+    bool m_iperf3JsonStream = false;
+    bool m_iperf3ForceFlush = false;
+    std::string m_testLineBuffer;
     int m_testResult;
     std::string m_testOutput;
     double m_bandwidth_result = 0.0;
@@ -513,12 +747,20 @@ private:
     double m_loss_result = 0.0;
     int m_retransmits_result = 0;
     bool m_waitingForButtonPress = false;
+    Iperf3Client m_engine;                  // Native client, used unless client_engine is "iperf3"
+    bool m_useNativeEngine = true;
+    size_t m_intervalCount = 0;
+
+    // Latency under load, always on the native engine
+    LatencyUnderLoad m_latencyTest;
+    bool m_latencyMode = false;
+    std::string m_latencyLine;              // Last live line drawn
 
     // Auto-discovery
     bool m_discoveryInProgress;
-    pid_t m_discoveryPid;
     std::vector<std::pair<std::string, int>> m_discoveredServers;  // IP and port pairs
     std::vector<std::string> m_discoveredServerNames;              // Service names
+    std::vector<std::string> m_discoveryServiceTypes;              // DNS-SD types to browse
 
     // UI Components
     std::unique_ptr<IPSelector> m_ipSelector;
@@ -545,23 +787,136 @@ private:
 
     // Action methods
     void startTest();
+    void startNativeTest();
     void checkTestStatus();
+    void checkNativeTestStatus();
+    void stopTest();
     void startDiscovery();
     void checkDiscoveryStatus();
-    void parseDiscoveryResults();
+    bool collectDiscoveredServers();
     void parseTestResults();
+    void readTestOutput();
+    void closeTestPipe();
+    void parseJsonStreamLine(const std::string& line);
+    void parseTextLine(const std::string& line);
+    void drawLiveProgress(double seconds, double bitsPerSecond, int retransmits, double jitterMs);
     void selectServer(int index);
 
     // Helper methods
     std::string getIperf3Path() const;
     bool isIperf3Available() const;
-    bool isAvahiAvailable() const;
+    void probeIperf3Options();
     void refreshSettings();
     std::string getBandwidthString(int value) const;
     std::string formatBandwidth(double value) const;
     std::string normalizeIp(const std::string& ip);
     UDPTestResult parseUDPTestResults(const std::string& output);
     void showResultsScreen();
+    void recordResult(bool failed);     // HistoryLog, by direction
+    void startLatencyTest();
+    void checkLatencyTestStatus();
+    void renderLatencyTestingScreen();
+    void showLatencyResults(const LatencyUnderLoad::Result& result);
+};
+
+/**
+ * Throughput mesh screen
+ * Runs this unit's MeshAgent while open and coordinates tests across the
+ * discovered peers, with the results as a from/to matrix
+ */
+class ThroughputMeshScreen : public ScreenModule {
+public:
+    ThroughputMeshScreen(std::shared_ptr<Display> display, std::shared_ptr<InputDevice> input);
+
+    void enter() override;
+    void update() override;
+    void exit() override;
+    bool handleInput() override;
+    std::string getModuleId() const override { return "throughputmesh"; }
+    void handleGPIORotation(int direction) override;
+    bool handleGPIOButtonPress() override;
+
+private:
+    enum class View { MENU, PEERS, RUNNING, MATRIX, STATUS };
+    enum class Item { COORDINATE, STATUS, PATTERN, ORDER, DURATION, BACK, COUNT };
+    enum { VISIBLE_ROWS = 6, MATRIX_ROWS = 5, MATRIX_COLUMNS = 3 };
+
+    struct Peer {
+        MeshCoordinator::Node node;
+        bool selected = true;
+    };
+
+    void refreshSettings();
+    void startAgent();
+    void startDiscovery();
+    void mergeDiscovered();
+    void startRun();
+    void handleRotation(int direction);
+    bool handleButton();
+    void render();
+    void renderMenu();
+    void renderPeers();
+    void renderRunning();
+    void renderMatrix();
+    void renderStatus();
+
+    MeshAgent m_agent;
+    MeshCoordinator m_coordinator;
+    MeshCoordinator::Options m_options;
+    std::string m_nodeName;
+    std::string m_selfAddress;
+    std::vector<Peer> m_peers;              // Discovered, without this unit
+    std::vector<MeshCoordinator::Node> m_nodes;     // Of the last run; [0] is this unit
+    std::vector<MeshCoordinator::Result> m_results;
+
+    View m_view = View::MENU;
+    Item m_item = Item::COORDINATE;
+    int m_selected = 0;                     // PEERS: row; MATRIX: cursor over rows and column pages
+    int m_scrollOffset = 0;
+    int m_refreshJob = -1;                  // Scheduler job while the screen is open
+    std::string m_message;                  // PEERS header when a run could not start
+    RowCache m_rows;
+    bool m_shouldExit = false;
+};
+
+/**
+ * Measurement trend screen
+ * Lists the result kinds in the HistoryLog and graphs the newest results of
+ * one, read straight from the mapping; rotation picks how many
+ */
+class TrendScreen : public ScreenModule {
+public:
+    TrendScreen(std::shared_ptr<Display> display, std::shared_ptr<InputDevice> input);
+
+    void enter() override;
+    void update() override;
+    void exit() override;
+    bool handleInput() override;
+    std::string getModuleId() const override { return "trends"; }
+    void handleGPIORotation(int direction) override;
+    bool handleGPIOButtonPress() override;
+
+private:
+    enum class View { LIST, GRAPH };
+    enum { VISIBLE_ROWS = 6 };
+
+    void countRecords();
+    void handleRotation(int direction);
+    bool handleButton();
+    void render();
+    void renderList();
+    void renderGraph();
+    void drawGraph(const std::vector<HistoryLog::Record>& records, double peak);
+
+    View m_view = View::LIST;
+    int m_selected = 0;                     // LIST: kind index, KIND_COUNT = Back
+    int m_scrollOffset = 0;
+    int m_window = 0;                       // Index into Config::TREND_WINDOWS
+    size_t m_counts[HistoryLog::KIND_COUNT] = {0};
+    uint64_t m_shownEnd = 0;                // HistoryLog::end() when last drawn
+    int m_refreshJob = -1;
+    RowCache m_rows;
+    bool m_shouldExit = false;
 };
 
 /**
@@ -627,8 +982,8 @@ public:
     int calculateProgressPercentage();
     std::string formatElapsedTime();
     int parseProgressFromLog();
-    void handleGPIORotation(int direction);
-    bool handleGPIOButtonPress();
+    void handleGPIORotation(int direction) override;
+    bool handleGPIOButtonPress() override;
 
     //callback
     void setCallback(ScreenCallback* callback) { m_callback = callback; }
@@ -644,6 +999,34 @@ private:
     void executeAction(const std::string& action);
     std::string executeCommand(const std::string& command) const;
     void launchModule(const std::string& moduleType, const std::string& parameter);
+    std::string itemsCommand() const;
+    void applyDynamicItems(const std::string& result, bool loading);
+    void applySelectionState(const std::string& output);
+    void refreshFromCommands();
+    void scanLogLine(const std::string& line);
+
+    // Rows of the list; dynamic ones are materialized around the view on demand
+    int itemCount();
+    const ListItem& itemAt(int index);
+    const ListItem& dynamicItemAt(int position);
+    int dynamicCount();
+    int dynamicFirstRow() const;
+    int findRow(const std::string& title);
+    bool streamItems() const { return m_cacheTtlMs == 0 && !LauncherClient::isCommand(m_itemsSource); }
+    void startItemsStream();
+    void appendDynamicItem(const std::string& title);
+    void clampSelection();
+
+    // Encoder-driven prefix search over the dynamic items
+    bool searchable() const;
+    bool isSearchRow(int index) const { return index == 0 && searchable(); }
+    void updateFilter();
+    void buildSearchChoices();
+    int searchChoiceCount() const;
+    std::string searchChoiceLabel(int choice) const;
+    std::string searchRowTitle() const;
+    void handleSearchRotation(int direction);
+    void handleSearchPress();
     // Configuration
     std::string m_id = "genericlist";
     std::string m_title = "Generic List";
@@ -662,6 +1045,10 @@ private:
     std::string m_itemsSource;  // Script to generate list items
     std::string m_itemsPath;    // Path parameter for the items source
     std::string m_itemsAction;  // Action template for dynamic items
+    int m_cacheTtlMs = 0;       // Script output older than this is refreshed in the background
+    int m_commandTimeoutMs = 0; // 0 = CommandRunner default
+    uint64_t m_itemsGeneration = 0;
+    uint64_t m_selectionGeneration = 0;
 
     ScreenCallback* m_callback = nullptr;
     // Flag to track if callback should be called when exiting
@@ -687,4 +1074,29 @@ private:
     std::string m_resultString;  // Store result information from async command (e.g., detected FPGA)
     std::string m_asyncResultPattern;  // Pattern to search for in log file
     std::string m_asyncResultPrefix;   // Prefix to add to extracted result
+    LogTail m_asyncLog;                // Read incrementally while the action runs
+    bool m_logSuccess = false;         // Success marker seen in the log so far
+    bool m_logError = false;
+    int m_logPercentage = -1;          // Last "NN%" in the log
+
+    // Dynamic items: titles live in the index, ListItems only for the rows near the view
+    std::vector<ListItem> m_staticItems;   // Back/Stop-Playback kept around the dynamic rows
+    ItemIndex m_dynamicItems;
+    std::vector<ListItem> m_window;
+    int m_windowStart = 0;                 // Dynamic position of m_window[0]
+    bool m_windowValid = false;
+    ListItem m_extraItem;                  // Search row or placeholder being shown
+    bool m_loading = false;
+    int m_streamId = -1;
+    bool m_itemsArrived = false;
+    bool m_layoutShifted = false;          // The search row appeared while streaming
+    int m_renderedCount = 0;
+    std::string m_currentState;            // Last output of the selection script
+
+    std::string m_filter;                  // Lowercase prefix, empty = unfiltered
+    ItemIndex::Range m_filterRange;
+    bool m_filterValid = false;
+    bool m_searching = false;
+    std::string m_searchCharacters;        // Characters that extend the filter
+    int m_searchChoice = 0;                // 0 = OK, then "<" when filtered, then characters
 };
@@ -0,0 +1,70 @@
+#pragma once
+
+#include <chrono>
+#include <condition_variable>
+#include <functional>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+#include "DeviceInterfaces.h"
+
+/**
+ * InputDevice that replays a script instead of reading evdev
+ *
+ * The script has one step per line, "<time_ms> <action> [value]". The time
+ * is an offset from start(), and times may not go backwards. '#' starts a
+ * comment. The actions are:
+ *   rotate N              N encoder detents, negative turns the other way
+ *   press                 Enter down, then up after REPLAY_PRESS_MS
+ *   hold MS               Enter held for MS (LONG_PRESS past LONG_PRESS_MS)
+ *   up|down|left|right    One key press
+ *   quit                  End the replay here
+ *
+ * open() creates a pipe and uses its read end as the device fd. From
+ * start(), a thread writes the same input_event records the HMI would send
+ * into the pipe, so InputDevice::processEvents() and the modules' own fd
+ * reads cannot tell the difference. The thread calls onInput for each step
+ * and onFinished after the last one.
+ */
+class ScriptedInputDevice : public InputDevice {
+public:
+    explicit ScriptedInputDevice(const std::string& scriptPath);
+    ~ScriptedInputDevice();
+
+    bool open() override;
+    void close() override;
+    bool checkConnection() const override { return isOpen(); }
+
+    // Begin replaying; both callbacks run on the replay thread
+    void start(std::function<void()> onInput, std::function<void()> onFinished);
+
+    size_t getStepCount() const { return m_steps.size(); }
+
+private:
+    enum class Action {
+        ROTATE,
+        PRESS,
+        KEY,
+        QUIT
+    };
+
+    struct Step {
+        long timeMs;
+        Action action;
+        int value;          // Detents, hold time or key code
+    };
+
+    bool loadScript();
+    void replayLoop(std::function<void()> onInput, std::function<void()> onFinished);
+    bool waitUntil(std::chrono::steady_clock::time_point deadline);
+    void writeEvent(uint16_t type, uint16_t code, int32_t value);
+
+    std::vector<Step> m_steps;
+    int m_writeFd = -1;
+
+    std::thread m_thread;
+    std::mutex m_mutex;
+    std::condition_variable m_wake;
+    bool m_stop = false;
+};
@@ -0,0 +1,85 @@
+#pragma once
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+#include <mutex>
+#include <thread>
+
+/**
+ * Asynchronous writer for the serial display link
+ *
+ * Protocol frames are queued in a lock-free single-producer/single-consumer
+ * ring and written by a dedicated thread, so drawing never blocks on the
+ * USB CDC endpoint. The writer uses a non-blocking fd with poll(POLLOUT),
+ * retries partial writes and drains each frame before starting the next:
+ * the protocol has no framing, so the device relies on one command per
+ * transfer. Adjacent frames where the later one fully supersedes the earlier
+ * one (same brightness/invert/power command, same text slot, same bar) are
+ * merged by dropping the earlier frame while the link is backed up.
+ *
+ * Producers from several threads are serialized by a short enqueue mutex that
+ * the writer thread never takes.
+ */
+class SerialWriter {
+public:
+    SerialWriter();
+    ~SerialWriter();
+
+    SerialWriter(const SerialWriter&) = delete;
+    SerialWriter& operator=(const SerialWriter&) = delete;
+
+    // fd must already be O_NONBLOCK; onDisconnect is called from the writer thread
+    bool start(int fd, std::function<void()> onDisconnect);
+
+    // Stop the thread, first draining queued frames for up to drainTimeoutMs
+    void stop(int drainTimeoutMs);
+
+    bool isRunning() const { return m_running.load(); }
+
+    // Queue one protocol frame; gapUs is the minimum idle time on the link
+    // after this frame before the next one is written. Returns false if the
+    // ring is full and the frame was dropped.
+    bool enqueue(const uint8_t* data, size_t length, int gapUs = 0);
+
+    // Thread-safe statistics
+    size_t getDroppedFrames() const { return m_dropped.load(); }
+    size_t getMergedFrames() const { return m_merged.load(); }
+
+private:
+    // Ring layout per frame: 2-byte length, 4-byte gap, payload
+    static constexpr size_t HEADER_SIZE = 6;
+    static constexpr size_t RING_SIZE = 8192;       // Power of two
+    static constexpr size_t MAX_FRAME_SIZE = 2048;  // Fits a full-frame CMD_BLIT
+
+    struct FrameHeader {
+        size_t length = 0;
+        int gapUs = 0;
+    };
+
+    void writerThread();
+    bool peekHeader(size_t offset, FrameHeader& header) const;
+    void copyOut(size_t offset, uint8_t* dest, size_t length) const;
+    void copyIn(size_t offset, const uint8_t* src, size_t length);
+    bool writeFrame(const uint8_t* data, size_t length, int& error);
+    bool waitWritable(int timeoutMs);
+    static bool supersedes(const uint8_t* later, size_t laterLength,
+                           const uint8_t* earlier, size_t earlierLength);
+
+    uint8_t m_ring[RING_SIZE];
+    std::atomic<size_t> m_head{0};    // Next byte to write (producer)
+    std::atomic<size_t> m_tail{0};    // Next byte to read (consumer)
+    std::mutex m_producerMutex;
+
+    int m_fd = -1;
+    int m_wakeFd = -1;
+    std::thread m_thread;
+    std::atomic<bool> m_running{false};
+    std::atomic<bool> m_stopping{false};
+    std::atomic<long> m_drainDeadlineMs{0};
+    std::function<void()> m_onDisconnect;
+
+    std::atomic<size_t> m_dropped{0};
+    std::atomic<size_t> m_merged{0};
+};
@@ -0,0 +1,34 @@
+#pragma once
+
+#include <string>
+
+/**
+ * Unix-domain socket that answers each connection with
+ * PerfCounters::report() and closes it ("socat - UNIX-CONNECT:PATH")
+ *
+ * The listening fd is non-blocking and belongs in the main event loop, so a
+ * client costs one accept() and one non-blocking send on the UI thread; a
+ * client that does not read gets a truncated report instead of stalling the
+ * loop. A socket file left behind by a crash is replaced, one that another
+ * running instance still answers on is left alone.
+ */
+class StatsServer {
+public:
+    StatsServer() = default;
+    ~StatsServer();
+
+    StatsServer(const StatsServer&) = delete;
+    StatsServer& operator=(const StatsServer&) = delete;
+
+    bool listen(const std::string& path);
+    void stop();
+
+    int getFd() const { return m_fd; }
+
+    // Answer every pending connection
+    void acceptClients();
+
+private:
+    int m_fd = -1;
+    std::string m_path;
+};
@@ -0,0 +1,124 @@
+#pragma once
+
+#include <atomic>
+#include <cstdint>
+#include <map>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+/**
+ * @class SubnetScanner
+ * @brief Concurrent IPv4 host discovery over ICMP echo and ARP
+ *
+ * A worker thread keeps a bounded window of probes in flight and multiplexes
+ * one ICMP socket, an optional ARP packet socket (needs CAP_NET_RAW) and a
+ * stop eventfd on epoll. Hosts are reported as soon as either probe answers,
+ * so a /24 finishes in about two probe timeouts instead of one ping per host.
+ * ARP also finds on-link hosts that drop ICMP.
+ */
+class SubnetScanner {
+public:
+    // IPv4 address of a local interface, host byte order
+    struct Subnet {
+        std::string interfaceName;
+        uint32_t address = 0;
+        int prefix = 0;
+    };
+
+    struct Host {
+        uint32_t address = 0;       // Host byte order
+        std::string ip;
+        std::string mac;            // Empty unless ARP answered
+        double rttMs = 0.0;         // First reply
+        bool icmp = false;
+        bool arp = false;
+    };
+
+    struct Progress {
+        unsigned int total = 0;
+        unsigned int completed = 0; // Targets answered or out of attempts
+        unsigned int found = 0;
+        bool running = false;
+        bool arpEnabled = false;
+        bool error = false;
+        std::string errorMessage;
+        unsigned int generation = 0;
+
+        int percent() const {
+            return total ? static_cast<int>(completed * 100 / total) : 0;
+        }
+    };
+
+    SubnetScanner();
+    ~SubnetScanner();
+
+    SubnetScanner(const SubnetScanner&) = delete;
+    SubnetScanner& operator=(const SubnetScanner&) = delete;
+
+    // Up, non-loopback interfaces with an IPv4 address
+    static std::vector<Subnet> localSubnets();
+
+    // Usable host range of address/prefix, inclusive; false if empty
+    static bool hostRange(uint32_t address, int prefix, uint32_t& first, uint32_t& last);
+
+    static std::string formatAddress(uint32_t address);
+
+    /**
+     * @brief Sweep first..last (host byte order, inclusive) from an interface
+     *
+     * The interface's own address is skipped. Ranges larger than
+     * Config::SWEEP_MAX_HOSTS are refused.
+     */
+    bool start(const Subnet& subnet, uint32_t first, uint32_t last);
+
+    void stop();
+
+    bool isRunning() const { return m_running.load(); }
+
+    // Discovered hosts in address order
+    std::vector<Host> getHosts() const;
+    Progress getProgress() const;
+
+private:
+    struct Target {
+        uint32_t address = 0;
+        int attempts = 0;
+        int64_t lastSentUs = 0;
+        int64_t firstSentUs = 0;
+        bool inFlight = false;
+        bool done = false;
+    };
+
+    bool openArpSocket(const std::string& interfaceName);
+    void run();
+    void sendProbes(Target& target, size_t index, int64_t nowUs);
+    void receiveIcmp(int64_t nowUs);
+    void receiveArp(int64_t nowUs);
+    void hostAnswered(uint32_t address, int64_t nowUs, bool viaArp, const uint8_t* mac);
+    void finishTarget(Target& target);
+    void setError(const std::string& message);
+
+    int m_icmpFd = -1;
+    bool m_icmpRaw = false;
+    int m_arpFd = -1;
+    int m_ifIndex = 0;
+    uint8_t m_localMac[6] = {0};
+    int m_epollFd = -1;
+    int m_wakeFd = -1;
+    uint16_t m_ident = 0;
+    uint32_t m_localAddress = 0;
+
+    std::vector<Target> m_targets;
+    std::map<uint32_t, size_t> m_targetIndex;   // Address -> m_targets slot
+    size_t m_nextTarget = 0;
+    int m_inFlight = 0;
+
+    std::thread m_thread;
+    std::atomic<bool> m_running{false};
+
+    mutable std::mutex m_resultsMutex;
+    std::map<uint32_t, Host> m_hosts;
+    Progress m_progress;
+};
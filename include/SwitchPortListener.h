@@ -0,0 +1,102 @@
+#pragma once
+
+#include <atomic>
+#include <cstdint>
+#include <map>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+/**
+ * @class SwitchPortListener
+ * @brief Passive LLDP/CDP capture telling which switch port a cable ends on
+ *
+ * Each interface gets an AF_PACKET socket whose classic BPF filter accepts
+ * only LLDP (EtherType 0x88cc) and CDP (01:00:0c:cc:cc:cc, SNAP) frames, so
+ * the kernel drops all other traffic before it is copied anywhere. Accepted
+ * frames land in a memory-mapped TPACKET_V3 ring; one worker thread sleeps
+ * in poll() until the kernel retires a block, so an idle or saturated link
+ * costs no wakeups.
+ *
+ * The latest advertisement per interface is published under a mutex with a
+ * generation counter. Capture needs CAP_NET_RAW; without it the interface
+ * reports UNAVAILABLE.
+ *
+ * The static helpers read the port's ethtool link settings and kernel
+ * error/drop counters for the same screen.
+ */
+class SwitchPortListener {
+public:
+    enum class State {
+        LISTENING,      // Capturing, nothing heard yet
+        HEARD,
+        UNAVAILABLE     // Socket or ring setup failed
+    };
+
+    struct Neighbor {
+        std::string protocol;       // "LLDP" or "CDP"
+        std::string switchName;     // System name / device ID, else chassis ID
+        std::string portId;         // Interface name when given, else description or MAC
+        int vlan = -1;              // Port/native VLAN, -1 if not advertised
+        int ttlSec = 0;             // How long the advertisement stays valid
+        int64_t receivedMs = 0;     // CLOCK_MONOTONIC
+    };
+
+    struct LinkSettings {
+        int speedMbps = -1;         // -1 unknown (no carrier, virtual interface)
+        bool fullDuplex = false;
+    };
+
+    struct LinkCounters {
+        uint64_t rxErrors = 0;
+        uint64_t txErrors = 0;
+        uint64_t rxDropped = 0;
+        uint64_t txDropped = 0;
+    };
+
+    SwitchPortListener();
+    ~SwitchPortListener();
+
+    SwitchPortListener(const SwitchPortListener&) = delete;
+    SwitchPortListener& operator=(const SwitchPortListener&) = delete;
+
+    // Capture on these interfaces; a running capture is replaced
+    void start(const std::vector<std::string>& interfaces);
+    void stop();
+
+    State getNeighbor(const std::string& interface, Neighbor& neighbor) const;
+    unsigned int getGeneration() const { return m_generation.load(); }
+
+    // LLDPDU or CDP frame starting at the Ethernet header
+    static bool parseLldp(const uint8_t* frame, size_t length, Neighbor& neighbor);
+    static bool parseCdp(const uint8_t* frame, size_t length, Neighbor& neighbor);
+
+    // SIOCETHTOOL speed/duplex and /sys statistics of an interface
+    static bool readLinkSettings(const std::string& interface, LinkSettings& settings);
+    static bool readLinkCounters(const std::string& interface, LinkCounters& counters);
+
+private:
+    struct Ring {
+        std::string interface;
+        int fd = -1;
+        uint8_t* map = nullptr;
+        size_t mapSize = 0;
+        unsigned int block = 0;     // Next block to read
+    };
+
+    bool openRing(Ring& ring);
+    void closeRing(Ring& ring);
+    void run();
+    void drainRing(Ring& ring);
+
+    std::vector<Ring> m_rings;
+    std::thread m_thread;
+    std::atomic<bool> m_stop{false};
+    std::atomic<unsigned int> m_generation{0};
+    int m_wakeFd = -1;
+
+    mutable std::mutex m_mutex;
+    std::map<std::string, State> m_states;
+    std::map<std::string, Neighbor> m_neighbors;
+};
@@ -0,0 +1,122 @@
+#pragma once
+
+#include <cstdarg>
+#include <cstddef>
+#include <cstdio>
+#include <cstring>
+#include <string>
+#include "Config.h"
+
+/**
+ * Fixed-capacity text kept inline, for render paths that must not allocate
+ *
+ * Appends and printf-style formats that do not fit are cut at the capacity,
+ * so building a row costs no heap traffic at all. TextLine is one display
+ * row (DISPLAY_WIDTH / CHAR_WIDTH columns) and goes straight to
+ * Display::drawText() as a char span.
+ */
+template <size_t N>
+class BasicTextLine {
+public:
+    static constexpr size_t CAPACITY = N;
+
+    BasicTextLine() { m_text[0] = '\0'; }
+    explicit BasicTextLine(const char* text) { assign(text, std::strlen(text)); }
+    BasicTextLine(const char* text, size_t length) { assign(text, length); }
+
+    BasicTextLine& clear()
+    {
+        m_length = 0;
+        m_text[0] = '\0';
+        return *this;
+    }
+
+    BasicTextLine& assign(const char* text, size_t length)
+    {
+        clear();
+        return append(text, length);
+    }
+
+    BasicTextLine& append(const char* text, size_t length)
+    {
+        if (length > N - m_length) {
+            length = N - m_length;
+        }
+        std::memcpy(m_text + m_length, text, length);
+        m_length += length;
+        m_text[m_length] = '\0';
+        return *this;
+    }
+
+    BasicTextLine& append(const char* text) { return append(text, std::strlen(text)); }
+    BasicTextLine& append(const std::string& text) { return append(text.data(), text.size()); }
+    BasicTextLine& append(char c) { return append(&c, 1); }
+
+    // printf-style; output past the capacity is dropped
+    BasicTextLine& format(const char* fmt, ...) __attribute__((format(printf, 2, 3)))
+    {
+        clear();
+        va_list args;
+        va_start(args, fmt);
+        appendv(fmt, args);
+        va_end(args);
+        return *this;
+    }
+
+    BasicTextLine& appendf(const char* fmt, ...) __attribute__((format(printf, 2, 3)))
+    {
+        va_list args;
+        va_start(args, fmt);
+        appendv(fmt, args);
+        va_end(args);
+        return *this;
+    }
+
+    // Exactly width characters: padded with fill or cut
+    BasicTextLine& resize(size_t width, char fill = ' ')
+    {
+        if (width > N) {
+            width = N;
+        }
+        while (m_length < width) {
+            m_text[m_length++] = fill;
+        }
+        m_length = width;
+        m_text[m_length] = '\0';
+        return *this;
+    }
+
+    const char* c_str() const { return m_text; }
+    const char* data() const { return m_text; }
+    size_t size() const { return m_length; }
+    bool empty() const { return m_length == 0; }
+    char operator[](size_t index) const { return m_text[index]; }
+
+    // Allocates: for logging and std::string APIs outside the render path
+    std::string str() const { return std::string(m_text, m_length); }
+
+    bool operator==(const BasicTextLine& other) const
+    {
+        return m_length == other.m_length && std::memcmp(m_text, other.m_text, m_length) == 0;
+    }
+    bool operator!=(const BasicTextLine& other) const { return !(*this == other); }
+
+private:
+    void appendv(const char* fmt, va_list args)
+    {
+        int written = vsnprintf(m_text + m_length, N - m_length + 1, fmt, args);
+        if (written > 0) {
+            m_length += static_cast<size_t>(written) < N - m_length ? static_cast<size_t>(written) : N - m_length;
+        }
+        m_text[m_length] = '\0';
+    }
+
+    char m_text[N + 1];
+    size_t m_length = 0;
+};
+
+template <size_t N>
+constexpr size_t BasicTextLine<N>::CAPACITY;
+
+// One row of the 6x8 font across the panel
+using TextLine = BasicTextLine<Config::DISPLAY_WIDTH / Config::CHAR_WIDTH>;
@@ -0,0 +1,102 @@
+#pragma once
+
+#include <chrono>
+#include <deque>
+#include <mutex>
+#include <string>
+#include <vector>
+#include "DeviceInterfaces.h"
+
+/**
+ * Display without hardware, for benchmarks and CI
+ *
+ * Drawing is rendered into a MonoFrame like the I2C driver. Each present()
+ * or flushBuffer() that follows drawing ends a frame. A frame record holds
+ * the serial protocol bytes the same calls would have sent in direct mode,
+ * the bytes of a raw CMD_BLIT update, the process CPU time used since the
+ * previous frame, and the latency from the last input (markInput()). The
+ * last VIRTUAL_FRAME_HISTORY frames are kept in memory. With a directory
+ * ("virtual:DIR") every frame is also written as DIR/frame-NNNNN.pbm, and
+ * close() writes the records to DIR/frames.csv. close() prints a summary
+ * in either case.
+ */
+class VirtualDisplayDevice : public BaseDisplayDevice {
+public:
+    struct FrameStats {
+        int index = 0;
+        double timeMs = 0;          // Since open()
+        int drawCalls = 0;
+        size_t serialBytes = 0;     // Direct-mode protocol bytes
+        size_t blitBytes = 0;       // Dirty windows plus CMD_BLIT headers
+        double cpuMs = 0;           // Process CPU time since the previous frame
+        double latencyMs = -1;      // From the input it answers; -1 if none
+    };
+
+    // devicePath is "virtual" or "virtual:DIR"
+    explicit VirtualDisplayDevice(const std::string& devicePath = Config::VIRTUAL_DISPLAY_PREFIX);
+    ~VirtualDisplayDevice();
+
+    static bool isVirtualPath(const std::string& devicePath);
+
+    bool open() override;
+    void close() override;
+    bool isOpen() const override { return m_open; }
+    bool checkConnection() const override { return m_open; }
+
+    // Display commands
+    using BaseDisplayDevice::drawText;
+    void clear() override;
+    void drawText(int x, int y, const char* text, size_t length) override;
+    void setCursor(int x, int y) override;
+    void setInverted(bool inverted) override;
+    void setBrightness(int brightness) override;
+    void drawProgressBar(int x, int y, int width, int height, int percentage) override;
+    void setPower(bool on) override;
+
+    // The frame is always composed locally; both calls end one
+    void setFrameBufferEnabled(bool enabled) override { (void)enabled; }
+    bool isFrameBufferEnabled() const override { return true; }
+    void present() override { endFrame(); }
+    void flushBuffer() override { endFrame(); }
+    void repaint() override { m_frame.markAllDirty(); endFrame(); }
+
+    bool supportsBlit() const override { return true; }
+    void blit(const MonoFrame::Window& window, const uint8_t* pixels) override;
+
+    // Thread-safe: the next frame is the answer to an input sent now
+    void markInput();
+
+    // Frame records and the most recent frames, oldest first
+    std::vector<FrameStats> getStats() const;
+    std::deque<std::vector<uint8_t>> getFrames() const;
+
+    // Totals over all frames, one "key=value" per line
+    std::string summary() const;
+
+private:
+    using Clock = std::chrono::steady_clock;
+
+    void countCommand(size_t bytes);
+    void endFrame();
+    bool writePbm(const std::string& path) const;
+    bool writeCsv(const std::string& path) const;
+    static double cpuTimeMs();
+
+    std::string m_outputDir;        // Empty: keep frames in memory only
+    bool m_open = false;
+    bool m_inverted = false;
+    bool m_poweredOn = true;
+
+    MonoFrame m_frame;
+    int m_drawCalls = 0;            // In the frame being drawn
+    size_t m_serialBytes = 0;
+
+    mutable std::mutex m_mutex;     // Guards the records and m_inputPending
+    Clock::time_point m_openTime;
+    Clock::time_point m_inputTime;
+    bool m_inputPending = false;
+    int m_inputs = 0;
+    double m_lastCpuMs = 0;
+    std::vector<FrameStats> m_stats;
+    std::deque<std::vector<uint8_t>> m_frames;
+};
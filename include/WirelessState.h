@@ -0,0 +1,141 @@
+#pragma once
+
+#include <atomic>
+#include <cstdint>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+/**
+ * @class WirelessState
+ * @brief Wi-Fi scan results and the current association, from nl80211
+ *
+ * Talks nl80211 over generic netlink directly, with no iw/nmcli children.
+ * One socket joined to the "config", "scan" and "mlme" multicast groups is
+ * read on a background thread. Scans (ours or anyone else's, e.g.
+ * wpa_supplicant's) are fetched as soon as the kernel reports them done,
+ * and connect, disconnect and roam events refresh the association at once.
+ * Requests go out on a second socket so their replies never mix with events.
+ *
+ * nl80211 does not push per-frame signal or bitrate, so while monitoring is
+ * on the station entry is requested every WIFI_STATION_POLL_MS, still over
+ * netlink and without a process. In survey mode a new scan is triggered as soon as the
+ * previous one finishes.
+ *
+ * The generation counter increases whenever the snapshot changes.
+ */
+class WirelessState {
+public:
+    struct Network {
+        std::string ssid;               // Empty for hidden networks
+        uint8_t bssid[6] = {0, 0, 0, 0, 0, 0};
+        int frequency = 0;              // MHz
+        int channel = 0;
+        int signalDbm = 0;
+        bool associated = false;
+        int64_t seenMs = 0;             // Monotonic ms of the last beacon/probe response
+    };
+
+    struct Link {
+        bool connected = false;
+        std::string ssid;
+        uint8_t bssid[6] = {0, 0, 0, 0, 0, 0};
+        int frequency = 0;
+        int channel = 0;
+        bool hasStation = false;        // The fields below are filled in
+        int signalDbm = 0;
+        int signalAvgDbm = 0;
+        int txBitrate = 0;              // 100 kbit/s units, as nl80211
+        int rxBitrate = 0;
+        int64_t updatedMs = 0;
+    };
+
+    enum class Radio { UNKNOWN, ON, SOFT_BLOCKED, HARD_BLOCKED };
+
+    static WirelessState& getInstance();
+
+    WirelessState(const WirelessState&) = delete;
+    WirelessState& operator=(const WirelessState&) = delete;
+
+    // nl80211 is present and a station interface was found
+    bool isAvailable() const { return m_ifindex.load() > 0; }
+    std::string getInterfaceName() const;
+
+    // Prefer this interface over the first station interface
+    void setInterface(const std::string& name);
+
+    // Scan back to back while on
+    void setSurvey(bool enabled);
+    // Request station signal/bitrate periodically while on
+    void setMonitoring(bool enabled);
+
+    // Strongest first
+    std::vector<Network> getNetworks() const;
+    Link getLink() const;
+    bool isScanning() const { return m_scanning.load(); }
+    int64_t getLastScanMs() const { return m_lastScanMs.load(); }
+    uint64_t getGeneration() const { return m_generation.load(); }
+
+    // Wi-Fi radios via /dev/rfkill
+    static Radio getRadio();
+    static bool setRadio(bool enabled);
+
+    static int channelFromFrequency(int frequency);
+    static int64_t nowMs();
+
+private:
+    WirelessState();
+    ~WirelessState();
+
+    using Handler = void (WirelessState::*)(const void* message, size_t length);
+
+    bool resolveFamily();
+    bool joinGroup(const std::string& name, uint32_t id);
+    int transact(uint16_t family, uint8_t command, bool dump, const std::vector<char>& attributes, Handler handler);
+    void findInterface();
+    void triggerScan();
+    void fetchScan();
+    void fetchStation();
+    void handleEvent(const void* message, size_t length);
+    void handleFamily(const void* message, size_t length);
+    void handleInterface(const void* message, size_t length);
+    void handleBss(const void* message, size_t length);
+    void handleStation(const void* message, size_t length);
+    void publish();
+    void wake();
+    void run();
+
+    int m_eventFd = -1;
+    int m_requestFd = -1;
+    int m_wakeFd = -1;
+    uint16_t m_family = 0;
+    std::vector<std::pair<std::string, uint32_t>> m_groups;     // Multicast groups of the family
+    uint32_t m_seq = 0;
+    std::thread m_thread;
+    std::atomic<bool> m_stop{false};
+    std::atomic<bool> m_survey{false};
+    std::atomic<bool> m_monitoring{false};
+    std::atomic<bool> m_needInterface{true};
+    std::atomic<int> m_ifindex{0};
+    std::atomic<bool> m_scanning{false};
+    std::atomic<int64_t> m_lastScanMs{0};
+    std::atomic<uint64_t> m_generation{0};
+
+    // Netlink thread only
+    std::vector<Network> m_scan;        // Being filled by a scan dump
+    Link m_link;
+    bool m_stationSeen = false;
+    bool m_needFetch = true;            // Scan results or the association changed
+    bool m_scanErrorLogged = false;
+    int64_t m_scanStartedMs = 0;
+    int64_t m_nextScanMs = 0;
+    int64_t m_nextStationMs = 0;
+    std::vector<std::pair<int, std::string>> m_stations;        // Station interfaces found by a dump
+
+    mutable std::mutex m_mutex;
+    std::string m_preferred;
+    std::string m_ifname;
+    std::vector<Network> m_networks;
+    Link m_linkSnapshot;
+};
@@ -10,6 +10,8 @@ USB_MOUNTED_BY_SCRIPT=0
 
 # Paths
 MICROPANEL_HOME="${MICROPANEL_HOME:-/home/pi/micropanel}"
+# Screen config of the running instance; its measurement history sits next to it
+MICROPANEL_CONFIG="${MICROPANEL_CONFIG:-/etc/micropanel/config.json}"
 
 # Check if we're running as root - if so, don't use sudo
 SUDO_CMD=""
@@ -259,6 +261,20 @@ main() {
         esac
     done < "$LOG_FILE_LIST"
 
+    # Measurement history as CSV and JSON; micropanel reads the ring without
+    # disturbing the running instance
+    if command -v micropanel >/dev/null 2>&1; then
+        for format in csv json; do
+            export_file="/tmp/micropanel-history.$format"
+            total_count=$((total_count + 1))
+            if micropanel -c "$MICROPANEL_CONFIG" -E "$export_file" >/dev/null 2>&1 &&
+               $SUDO_CMD cp -f "$export_file" "$log_folder/" 2>/dev/null; then
+                copied_count=$((copied_count + 1))
+            fi
+            rm -f "$export_file"
+        done
+    fi
+
     # Ensure all data is flushed to USB
     sync
 
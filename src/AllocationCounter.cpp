@@ -0,0 +1,73 @@
+#include "AllocationCounter.h"
+
+#ifdef MICROPANEL_COUNT_ALLOCATIONS
+
+#include "Logger.h"
+#include <cassert>
+#include <cstdlib>
+#include <new>
+#include <string>
+
+namespace {
+    // Plain thread_local integer: no constructor, safe inside operator new
+    thread_local uint64_t t_allocations = 0;
+
+    void* allocate(std::size_t size)
+    {
+        t_allocations++;
+        void* pointer = std::malloc(size ? size : 1);
+        if (!pointer) {
+            throw std::bad_alloc();
+        }
+        return pointer;
+    }
+}
+
+void* operator new(std::size_t size) { return allocate(size); }
+void* operator new[](std::size_t size) { return allocate(size); }
+
+void* operator new(std::size_t size, const std::nothrow_t&) noexcept
+{
+    t_allocations++;
+    return std::malloc(size ? size : 1);
+}
+
+void* operator new[](std::size_t size, const std::nothrow_t&) noexcept
+{
+    t_allocations++;
+    return std::malloc(size ? size : 1);
+}
+
+void operator delete(void* pointer) noexcept { std::free(pointer); }
+void operator delete[](void* pointer) noexcept { std::free(pointer); }
+void operator delete(void* pointer, std::size_t) noexcept { std::free(pointer); }
+void operator delete[](void* pointer, std::size_t) noexcept { std::free(pointer); }
+
+uint64_t AllocationCounter::threadCount()
+{
+    return t_allocations;
+}
+
+AllocationGuard::AllocationGuard(const char* scope, bool steady)
+    : m_scope(scope), m_steady(steady), m_start(t_allocations)
+{
+}
+
+AllocationGuard::~AllocationGuard()
+{
+    uint64_t allocations = t_allocations - m_start;
+    if (m_steady && allocations > 0) {
+        Logger::error(std::string("AllocationGuard: ") + m_scope + " made " + std::to_string(allocations) +
+                      " heap allocations in a steady-state frame");
+        assert(allocations == 0);
+    }
+}
+
+#else
+
+uint64_t AllocationCounter::threadCount()
+{
+    return 0;
+}
+
+#endif
@@ -0,0 +1,524 @@
+#include "CommandRunner.h"
+#include "Config.h"
+#include "LauncherClient.h"
+#include "Logger.h"
+#include "PerfCounters.h"
+#include <algorithm>
+#include <cerrno>
+#include <csignal>
+#include <cstring>
+#include <ctime>
+#include <fcntl.h>
+#include <poll.h>
+#include <spawn.h>
+#include <unistd.h>
+#include <sys/epoll.h>
+#include <sys/wait.h>
+
+extern char** environ;
+
+namespace {
+    constexpr int MAX_EVENTS = 16;
+    constexpr int SYNC_POLL_MS = 10;
+    constexpr int LAUNCHER_GRACE_MS = 1000;         // LauncherClient times requests out itself
+
+    int64_t nowMs() {
+        struct timespec ts;
+        clock_gettime(CLOCK_MONOTONIC, &ts);
+        return static_cast<int64_t>(ts.tv_sec) * 1000 + ts.tv_nsec / 1000000;
+    }
+}
+
+// One running child, or a request to a launcher server
+struct CommandRunner::Job {
+    pid_t pid = -1;
+    int fd = -1;                        // Read end of the child's stdout
+    std::string output;                 // Whole output, or a stream's unfinished line
+    int64_t startMs = 0;
+    int64_t deadlineMs = 0;
+    LineHandler onLine;                 // Set for streams
+    bool exited = false;                // Stream child reaped
+    LauncherClient* launcher = nullptr; // Set for "launcher:" commands, which have no child
+    uint64_t requestId = 0;
+    int exitStatus = -1;
+};
+
+CommandRunner& CommandRunner::getInstance()
+{
+    static CommandRunner instance;
+    return instance;
+}
+
+CommandRunner::CommandRunner()
+{
+    m_epollFd = epoll_create1(EPOLL_CLOEXEC);
+    if (m_epollFd < 0) {
+        Logger::error(std::string("CommandRunner: epoll_create1: ") + strerror(errno));
+        return;
+    }
+
+    // Finished launcher requests wake the same loop as child output
+    int launcherFd = LauncherClient::completionFd();
+    if (launcherFd >= 0) {
+        struct epoll_event event;
+        std::memset(&event, 0, sizeof(event));
+        event.events = EPOLLIN;
+        event.data.ptr = nullptr;
+        epoll_ctl(m_epollFd, EPOLL_CTL_ADD, launcherFd, &event);
+    }
+}
+
+CommandRunner::~CommandRunner()
+{
+    for (auto& item : m_entries) {
+        Job* job = item.second.job.get();
+        if (job && job->launcher) {
+            job->launcher->cancel(job->requestId);
+        } else if (job) {
+            kill(-job->pid, SIGKILL);
+            waitpid(job->pid, nullptr, 0);
+            if (job->fd >= 0) close(job->fd);
+        }
+    }
+    while (!m_streams.empty()) {
+        closeStream(m_streams.begin()->first);
+    }
+    if (m_epollFd >= 0) {
+        close(m_epollFd);
+    }
+}
+
+std::unique_ptr<CommandRunner::Job> CommandRunner::spawn(const std::string& command)
+{
+    int fds[2];
+    if (pipe2(fds, O_CLOEXEC) != 0) {
+        Logger::error(std::string("CommandRunner: pipe: ") + strerror(errno));
+        return nullptr;
+    }
+    // Only our end is non-blocking; the script writes normally
+    fcntl(fds[0], F_SETFL, fcntl(fds[0], F_GETFL) | O_NONBLOCK);
+
+    posix_spawn_file_actions_t actions;
+    posix_spawn_file_actions_init(&actions);
+    posix_spawn_file_actions_adddup2(&actions, fds[1], STDOUT_FILENO);
+
+    // Own process group so a timeout takes the whole pipeline down; default
+    // signal handling in case the panel ignores SIGPIPE
+    posix_spawnattr_t attributes;
+    posix_spawnattr_init(&attributes);
+    sigset_t mask, defaults;
+    sigemptyset(&mask);
+    sigemptyset(&defaults);
+    sigaddset(&defaults, SIGPIPE);
+    sigaddset(&defaults, SIGCHLD);
+    posix_spawnattr_setsigmask(&attributes, &mask);
+    posix_spawnattr_setsigdefault(&attributes, &defaults);
+    posix_spawnattr_setpgroup(&attributes, 0);
+    posix_spawnattr_setflags(&attributes, POSIX_SPAWN_SETPGROUP | POSIX_SPAWN_SETSIGMASK | POSIX_SPAWN_SETSIGDEF);
+
+    const char* argv[] = {"sh", "-c", command.c_str(), nullptr};
+    pid_t pid = -1;
+    int error = posix_spawn(&pid, "/bin/sh", &actions, &attributes, const_cast<char* const*>(argv), environ);
+
+    posix_spawn_file_actions_destroy(&actions);
+    posix_spawnattr_destroy(&attributes);
+    close(fds[1]);
+
+    if (error != 0) {
+        Logger::error("CommandRunner: failed to start '" + command + "': " + strerror(error));
+        close(fds[0]);
+        return nullptr;
+    }
+    PerfCounters::getInstance().add(PerfCounters::Counter::CHILD_PROCESSES);
+
+    std::unique_ptr<Job> job(new Job());
+    job->pid = pid;
+    job->fd = fds[0];
+    job->startMs = nowMs();
+
+    struct epoll_event event;
+    std::memset(&event, 0, sizeof(event));
+    event.events = EPOLLIN;
+    event.data.ptr = job.get();
+    epoll_ctl(m_epollFd, EPOLL_CTL_ADD, job->fd, &event);
+
+    LOG_DEBUG("CommandRunner: started '" + command + "' (pid " + std::to_string(pid) + ")");
+    return job;
+}
+
+std::unique_ptr<CommandRunner::Job> CommandRunner::submit(const std::string& command, int timeoutMs)
+{
+    std::string address, line;
+    if (!LauncherClient::parseCommand(command, address, line)) {
+        Logger::error("CommandRunner: expected 'launcher:IP:PORT command [arg]', got '" + command + "'");
+        return nullptr;
+    }
+    LauncherClient* client = LauncherClient::forServer(address);
+    int timeout = timeoutMs > 0 ? timeoutMs : Config::LAUNCHER_TIMEOUT_MS;
+    uint64_t id = client ? client->submit(line, timeout) : 0;
+    if (id == 0) {
+        return nullptr;
+    }
+
+    std::unique_ptr<Job> job(new Job());
+    job->launcher = client;
+    job->requestId = id;
+    job->startMs = nowMs();
+    job->deadlineMs = job->startMs + timeout + LAUNCHER_GRACE_MS;
+    LOG_DEBUG("CommandRunner: sent '" + line + "' to " + address);
+    return job;
+}
+
+bool CommandRunner::start(const std::string& command, Entry& entry, int timeoutMs)
+{
+    // No shell for launcher requests; the deadline is the client's
+    if (LauncherClient::isCommand(command)) {
+        entry.job = submit(command, timeoutMs);
+        return entry.job != nullptr;
+    }
+
+    std::unique_ptr<Job> job = spawn(command);
+    if (!job) {
+        return false;
+    }
+    job->deadlineMs = job->startMs + (timeoutMs > 0 ? timeoutMs : Config::COMMAND_TIMEOUT_MS);
+    entry.job = std::move(job);
+    return true;
+}
+
+void CommandRunner::readOutput(Job& job)
+{
+    char buffer[4096];
+    size_t streamed = 0;
+    while (job.fd >= 0) {
+        // A chatty stream yields after a while; epoll reports the rest next time
+        if (job.onLine && streamed >= static_cast<size_t>(Config::STREAM_MAX_READ_PER_POLL)) {
+            return;
+        }
+        ssize_t n = read(job.fd, buffer, sizeof(buffer));
+        if (n > 0 && job.onLine) {
+            deliverLines(job, buffer, static_cast<size_t>(n));
+            streamed += static_cast<size_t>(n);
+            continue;
+        }
+        if (n > 0) {
+            // Keep draining past the cap so the child never blocks on a full pipe
+            const size_t limit = static_cast<size_t>(Config::COMMAND_MAX_OUTPUT);
+            size_t room = job.output.size() < limit ? limit - job.output.size() : 0;
+            job.output.append(buffer, std::min(static_cast<size_t>(n), room));
+            continue;
+        }
+        if (n < 0 && errno == EINTR) continue;
+        if (n < 0 && (errno == EAGAIN || errno == EWOULDBLOCK)) return;
+
+        // EOF: every writer is gone; the child is reaped in poll()
+        epoll_ctl(m_epollFd, EPOLL_CTL_DEL, job.fd, nullptr);
+        close(job.fd);
+        job.fd = -1;
+        if (job.onLine && !job.output.empty()) {
+            job.onLine(job.output);
+            job.output.clear();
+        }
+    }
+}
+
+void CommandRunner::deliverLines(Job& job, const char* data, size_t length)
+{
+    const size_t limit = static_cast<size_t>(Config::STREAM_MAX_LINE);
+    while (length > 0) {
+        const char* newline = static_cast<const char*>(memchr(data, '\n', length));
+        size_t chunk = newline ? static_cast<size_t>(newline - data) : length;
+
+        // Overlong lines are split rather than buffered without bound
+        size_t room = limit - std::min(limit, job.output.size());
+        if (chunk > room) {
+            job.output.append(data, room);
+            job.onLine(job.output);
+            job.output.clear();
+            data += room;
+            length -= room;
+            continue;
+        }
+
+        job.output.append(data, chunk);
+        if (!newline) {
+            return;
+        }
+        if (!job.output.empty() && job.output.back() == '\r') {
+            job.output.pop_back();
+        }
+        job.onLine(job.output);
+        job.output.clear();
+        data += chunk + 1;
+        length -= chunk + 1;
+    }
+}
+
+void CommandRunner::finish(Entry& entry, bool timedOut)
+{
+    Job& job = *entry.job;
+    if (job.fd >= 0) {
+        epoll_ctl(m_epollFd, EPOLL_CTL_DEL, job.fd, nullptr);
+        close(job.fd);
+        job.fd = -1;
+    }
+
+    int exitStatus = job.exitStatus;
+    if (!job.launcher) {
+        int status = 0;
+        pid_t reaped;
+        do {
+            reaped = waitpid(job.pid, &status, timedOut ? 0 : WNOHANG);
+        } while (reaped < 0 && errno == EINTR);
+        // SIGCHLD ignored means the child was reaped for us; nothing to report
+        exitStatus = (reaped == job.pid && WIFEXITED(status)) ? WEXITSTATUS(status) : -1;
+    }
+
+    Result& result = entry.result;
+    result.available = true;
+    result.failed = false;
+    result.timedOut = timedOut;
+    result.exitStatus = exitStatus;
+    result.output = std::move(job.output);
+    result.generation = ++m_generation;
+
+    int64_t now = nowMs();
+    entry.finishedMs = now;
+    entry.invalidated = false;
+    LOG_DEBUG("CommandRunner: " + (job.launcher ? std::string("request ") + std::to_string(job.requestId)
+                                                : std::string("pid ") + std::to_string(job.pid)) +
+                  (timedOut ? " timed out" : " finished") +
+                  " after " + std::to_string(now - job.startMs) + "ms, status " +
+                  std::to_string(result.exitStatus));
+    entry.job.reset();
+}
+
+void CommandRunner::poll()
+{
+    if (m_epollFd < 0) {
+        return;
+    }
+
+    struct epoll_event events[MAX_EVENTS];
+    int count;
+    while ((count = epoll_wait(m_epollFd, events, MAX_EVENTS, 0)) > 0) {
+        for (int i = 0; i < count; i++) {
+            if (!events[i].data.ptr) {
+                // Launcher completions are collected below
+                uint64_t value;
+                while (read(LauncherClient::completionFd(), &value, sizeof(value)) > 0) {
+                }
+                continue;
+            }
+            readOutput(*static_cast<Job*>(events[i].data.ptr));
+        }
+        if (count < MAX_EVENTS) break;
+    }
+
+    int64_t now = nowMs();
+    for (auto& item : m_entries) {
+        Entry& entry = item.second;
+        if (!entry.job) continue;
+        Job& job = *entry.job;
+
+        if (job.launcher) {
+            finishRequest(item.first, entry, now);
+            continue;
+        }
+        if (job.fd < 0) {
+            // Output closed; done once the process has exited
+            siginfo_t info;
+            std::memset(&info, 0, sizeof(info));
+            int rc = waitid(P_PID, static_cast<id_t>(job.pid), &info, WEXITED | WNOHANG | WNOWAIT);
+            if ((rc == 0 && info.si_pid == job.pid) || (rc < 0 && errno == ECHILD)) {
+                finish(entry, false);
+                continue;
+            }
+        }
+        if (now >= job.deadlineMs) {
+            Logger::warning("CommandRunner: '" + item.first + "' timed out, killing it");
+            kill(-job.pid, SIGKILL);
+            kill(job.pid, SIGKILL);
+            finish(entry, true);
+        }
+    }
+
+    reapStreams();
+}
+
+void CommandRunner::finishRequest(const std::string& command, Entry& entry, int64_t now)
+{
+    Job& job = *entry.job;
+    LauncherClient::Response response;
+    if (!job.launcher->take(job.requestId, response)) {
+        if (now >= job.deadlineMs) {
+            Logger::warning("CommandRunner: '" + command + "' got no answer from the launcher client");
+            job.launcher->cancel(job.requestId);
+            finish(entry, true);
+        }
+        return;
+    }
+
+    // Same output and status as the launcher-client tool with 2>&1
+    job.exitStatus = response.ok ? 0 : 1;
+    job.output = response.line + "\n";
+    finish(entry, response.timedOut);
+}
+
+void CommandRunner::reapStreams()
+{
+    for (auto& item : m_streams) {
+        Job& job = *item.second;
+        if (job.exited || job.fd >= 0) {
+            continue;
+        }
+        int status = 0;
+        pid_t reaped = waitpid(job.pid, &status, WNOHANG);
+        if (reaped == job.pid || (reaped < 0 && errno == ECHILD)) {
+            job.exited = true;
+            LOG_DEBUG("CommandRunner: stream " + std::to_string(item.first) + " (pid " +
+                          std::to_string(job.pid) + ") ended");
+        }
+    }
+}
+
+CommandRunner::Result CommandRunner::snapshot(const Entry& entry, int ttlMs) const
+{
+    Result result = entry.result;
+    result.running = entry.job != nullptr;
+    result.stale = result.available &&
+                   (entry.invalidated || (ttlMs >= 0 && nowMs() - entry.finishedMs >= ttlMs));
+    return result;
+}
+
+CommandRunner::Result CommandRunner::request(const std::string& command, int ttlMs, int timeoutMs)
+{
+    poll();
+
+    Entry& entry = m_entries[command];
+    int64_t now = nowMs();
+    entry.usedMs = now;
+
+    bool fresh = entry.result.available && !entry.result.failed && !entry.invalidated &&
+                 (ttlMs < 0 || now - entry.finishedMs < ttlMs);
+    if (!entry.job && !fresh && m_epollFd >= 0) {
+        if (!start(command, entry, timeoutMs)) {
+            entry.result.available = true;
+            entry.result.failed = true;
+            entry.result.generation = ++m_generation;
+            entry.finishedMs = now;
+        }
+    }
+
+    Result result = snapshot(entry, ttlMs);
+    evict();
+    return result;
+}
+
+CommandRunner::Result CommandRunner::peek(const std::string& command)
+{
+    poll();
+
+    auto it = m_entries.find(command);
+    if (it == m_entries.end()) {
+        return Result();
+    }
+    return snapshot(it->second, -1);
+}
+
+CommandRunner::Result CommandRunner::runSync(const std::string& command, int timeoutMs)
+{
+    poll();
+
+    Entry& entry = m_entries[command];
+    entry.usedMs = nowMs();
+    if (!entry.job && (m_epollFd < 0 || !start(command, entry, timeoutMs))) {
+        Result result;
+        result.available = true;
+        result.failed = true;
+        return result;
+    }
+
+    // A run already in flight for the same command counts as ours
+    while (entry.job) {
+        struct pollfd pfd = {m_epollFd, POLLIN, 0};
+        ::poll(&pfd, 1, SYNC_POLL_MS);
+        poll();
+    }
+
+    Result result = snapshot(entry, -1);
+    evict();
+    return result;
+}
+
+void CommandRunner::invalidate(const std::string& command)
+{
+    auto it = m_entries.find(command);
+    if (it != m_entries.end()) {
+        it->second.invalidated = true;
+    }
+}
+
+int CommandRunner::openStream(const std::string& command, LineHandler onLine)
+{
+    if (m_epollFd < 0 || !onLine) {
+        return -1;
+    }
+    if (LauncherClient::isCommand(command)) {
+        Logger::warning("CommandRunner: '" + command + "' answers once and cannot be streamed");
+        return -1;
+    }
+    std::unique_ptr<Job> job = spawn(command);
+    if (!job) {
+        return -1;
+    }
+    job->onLine = onLine;
+
+    int id = m_nextStreamId++;
+    m_streams[id] = std::move(job);
+    return id;
+}
+
+void CommandRunner::closeStream(int id)
+{
+    auto it = m_streams.find(id);
+    if (it == m_streams.end()) {
+        return;
+    }
+    Job& job = *it->second;
+    if (job.fd >= 0) {
+        epoll_ctl(m_epollFd, EPOLL_CTL_DEL, job.fd, nullptr);
+        close(job.fd);
+    }
+    if (!job.exited) {
+        kill(-job.pid, SIGKILL);
+        kill(job.pid, SIGKILL);
+        while (waitpid(job.pid, nullptr, 0) < 0 && errno == EINTR) {
+        }
+    }
+    LOG_DEBUG("CommandRunner: closed stream " + std::to_string(id));
+    m_streams.erase(it);
+}
+
+bool CommandRunner::isStreamRunning(int id) const
+{
+    auto it = m_streams.find(id);
+    return it != m_streams.end() && (it->second->fd >= 0 || !it->second->exited);
+}
+
+void CommandRunner::evict()
+{
+    // Drop the least recently used idle entries beyond the cap
+    while (m_entries.size() > static_cast<size_t>(Config::COMMAND_CACHE_MAX_ENTRIES)) {
+        auto oldest = m_entries.end();
+        for (auto it = m_entries.begin(); it != m_entries.end(); ++it) {
+            if (!it->second.job && (oldest == m_entries.end() || it->second.usedMs < oldest->second.usedMs)) {
+                oldest = it;
+            }
+        }
+        if (oldest == m_entries.end()) {
+            return;
+        }
+        m_entries.erase(oldest);
+    }
+}
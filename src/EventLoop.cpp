@@ -0,0 +1,261 @@
+#include "EventLoop.h"
+#include "Logger.h"
+#include <cerrno>
+#include <cstdint>
+#include <cstring>
+#include <unistd.h>
+#include <sys/epoll.h>
+#include <sys/eventfd.h>
+#include <sys/timerfd.h>
+
+EventLoop::EventLoop()
+{
+    m_epollFd = epoll_create1(EPOLL_CLOEXEC);
+    if (m_epollFd < 0) {
+        Logger::error("Failed to create epoll instance: " + std::string(strerror(errno)));
+        return;
+    }
+
+    m_wakeFd = eventfd(0, EFD_NONBLOCK | EFD_CLOEXEC);
+    if (m_wakeFd < 0) {
+        Logger::error("Failed to create wake eventfd: " + std::string(strerror(errno)));
+        return;
+    }
+
+    struct epoll_event ev;
+    std::memset(&ev, 0, sizeof(ev));
+    ev.events = EPOLLIN;
+    ev.data.fd = m_wakeFd;
+    if (epoll_ctl(m_epollFd, EPOLL_CTL_ADD, m_wakeFd, &ev) < 0) {
+        Logger::error("Failed to watch wake eventfd: " + std::string(strerror(errno)));
+        ::close(m_wakeFd);
+        m_wakeFd = -1;
+    }
+}
+
+EventLoop::~EventLoop()
+{
+    for (auto& entry : m_sources) {
+        if (entry.second.type == SourceType::TIMER) {
+            ::close(entry.first);
+        }
+    }
+    m_sources.clear();
+
+    if (m_wakeFd >= 0) {
+        ::close(m_wakeFd);
+    }
+    if (m_epollFd >= 0) {
+        ::close(m_epollFd);
+    }
+}
+
+bool EventLoop::addFd(int fd, Handler onReadable)
+{
+    if (m_epollFd < 0 || fd < 0) {
+        return false;
+    }
+
+    struct epoll_event ev;
+    std::memset(&ev, 0, sizeof(ev));
+    ev.events = EPOLLIN;
+    ev.data.fd = fd;
+
+    if (epoll_ctl(m_epollFd, EPOLL_CTL_ADD, fd, &ev) < 0) {
+        // Already watched: just swap the handler
+        if (errno != EEXIST || epoll_ctl(m_epollFd, EPOLL_CTL_MOD, fd, &ev) < 0) {
+            Logger::error("Failed to watch fd " + std::to_string(fd) + ": " + std::string(strerror(errno)));
+            return false;
+        }
+    }
+
+    Source source;
+    source.type = SourceType::FD;
+    source.handler = onReadable;
+    m_sources[fd] = source;
+    return true;
+}
+
+void EventLoop::removeFd(int fd)
+{
+    auto it = m_sources.find(fd);
+    if (it == m_sources.end() || it->second.type != SourceType::FD) {
+        return;
+    }
+
+    // The fd may already be closed, in which case epoll dropped it on its own
+    epoll_ctl(m_epollFd, EPOLL_CTL_DEL, fd, nullptr);
+    m_sources.erase(it);
+}
+
+int EventLoop::addTimer(Handler onExpire)
+{
+    if (m_epollFd < 0) {
+        return -1;
+    }
+
+    int fd = timerfd_create(CLOCK_MONOTONIC, TFD_NONBLOCK | TFD_CLOEXEC);
+    if (fd < 0) {
+        Logger::error("Failed to create timerfd: " + std::string(strerror(errno)));
+        return -1;
+    }
+
+    struct epoll_event ev;
+    std::memset(&ev, 0, sizeof(ev));
+    ev.events = EPOLLIN;
+    ev.data.fd = fd;
+    if (epoll_ctl(m_epollFd, EPOLL_CTL_ADD, fd, &ev) < 0) {
+        Logger::error("Failed to watch timerfd: " + std::string(strerror(errno)));
+        ::close(fd);
+        return -1;
+    }
+
+    Source source;
+    source.type = SourceType::TIMER;
+    source.handler = onExpire;
+    m_sources[fd] = source;
+    return fd;
+}
+
+void EventLoop::armTimer(int id, int delayMs, int intervalMs)
+{
+    auto it = m_sources.find(id);
+    if (it == m_sources.end() || it->second.type != SourceType::TIMER) {
+        return;
+    }
+
+    // A zero it_value would disarm the timer, so round "now" up to 1ns
+    struct itimerspec spec;
+    std::memset(&spec, 0, sizeof(spec));
+    if (delayMs > 0) {
+        spec.it_value.tv_sec = delayMs / 1000;
+        spec.it_value.tv_nsec = static_cast<long>(delayMs % 1000) * 1000000L;
+    } else {
+        spec.it_value.tv_nsec = 1;
+    }
+    spec.it_interval.tv_sec = intervalMs / 1000;
+    spec.it_interval.tv_nsec = static_cast<long>(intervalMs % 1000) * 1000000L;
+
+    if (timerfd_settime(id, 0, &spec, nullptr) < 0) {
+        Logger::error("Failed to arm timer: " + std::string(strerror(errno)));
+        return;
+    }
+    it->second.armed = true;
+}
+
+void EventLoop::disarmTimer(int id)
+{
+    auto it = m_sources.find(id);
+    if (it == m_sources.end() || it->second.type != SourceType::TIMER) {
+        return;
+    }
+
+    struct itimerspec spec;
+    std::memset(&spec, 0, sizeof(spec));
+    timerfd_settime(id, 0, &spec, nullptr);
+
+    // Drop an expiry that is already queued
+    uint64_t expirations;
+    while (read(id, &expirations, sizeof(expirations)) > 0) {
+    }
+    it->second.armed = false;
+}
+
+bool EventLoop::isTimerArmed(int id) const
+{
+    auto it = m_sources.find(id);
+    return it != m_sources.end() && it->second.armed;
+}
+
+void EventLoop::removeTimer(int id)
+{
+    auto it = m_sources.find(id);
+    if (it == m_sources.end() || it->second.type != SourceType::TIMER) {
+        return;
+    }
+
+    epoll_ctl(m_epollFd, EPOLL_CTL_DEL, id, nullptr);
+    ::close(id);
+    m_sources.erase(it);
+}
+
+void EventLoop::wake()
+{
+    if (m_wakeFd < 0) {
+        return;
+    }
+
+    uint64_t one = 1;
+    ssize_t result = write(m_wakeFd, &one, sizeof(one));
+    (void)result; // EAGAIN means a wake-up is already pending
+}
+
+int EventLoop::runOnce(int timeoutMs)
+{
+    if (m_epollFd < 0) {
+        return -1;
+    }
+
+    struct epoll_event events[MAX_EVENTS];
+    int ready = epoll_wait(m_epollFd, events, MAX_EVENTS, timeoutMs);
+    if (ready < 0) {
+        if (errno != EINTR) {
+            Logger::error("epoll_wait failed: " + std::string(strerror(errno)));
+        }
+        return 0;
+    }
+
+    int dispatched = 0;
+    for (int i = 0; i < ready; i++) {
+        int fd = events[i].data.fd;
+
+        if (fd == m_wakeFd) {
+            uint64_t count;
+            if (read(m_wakeFd, &count, sizeof(count)) > 0 && m_wakeHandler) {
+                Handler handler = m_wakeHandler;
+                handler();
+                dispatched++;
+            }
+            continue;
+        }
+
+        // An earlier handler in this batch may have removed the source
+        auto it = m_sources.find(fd);
+        if (it == m_sources.end()) {
+            continue;
+        }
+
+        if (it->second.type == SourceType::TIMER) {
+            uint64_t expirations;
+            if (read(fd, &expirations, sizeof(expirations)) <= 0) {
+                continue; // Disarmed after the event was queued
+            }
+
+            // One-shot timers disarm themselves on expiry
+            struct itimerspec spec;
+            if (timerfd_gettime(fd, &spec) == 0 &&
+                spec.it_interval.tv_sec == 0 && spec.it_interval.tv_nsec == 0) {
+                it->second.armed = false;
+            }
+        } else if (events[i].events & (EPOLLERR | EPOLLHUP)) {
+            // Device went away; stop watching so the loop doesn't spin on it
+            Logger::warning("Stopped watching fd " + std::to_string(fd) + " after hangup");
+            Handler handler = it->second.handler;
+            removeFd(fd);
+            if (handler) {
+                handler();
+            }
+            dispatched++;
+            continue;
+        }
+
+        // Copy: the handler may replace or remove its own source
+        Handler handler = it->second.handler;
+        if (handler) {
+            handler();
+        }
+        dispatched++;
+    }
+
+    return dispatched;
+}
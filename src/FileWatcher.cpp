@@ -0,0 +1,67 @@
+#include "FileWatcher.h"
+#include "Logger.h"
+#include <cerrno>
+#include <cstring>
+#include <unistd.h>
+#include <sys/inotify.h>
+
+FileWatcher::~FileWatcher()
+{
+    stop();
+}
+
+bool FileWatcher::watch(const std::string& path)
+{
+    stop();
+
+    size_t slash = path.find_last_of('/');
+    std::string directory = slash == std::string::npos ? "." : (slash == 0 ? "/" : path.substr(0, slash));
+    m_name = slash == std::string::npos ? path : path.substr(slash + 1);
+
+    m_fd = inotify_init1(IN_NONBLOCK | IN_CLOEXEC);
+    if (m_fd < 0) {
+        Logger::warning("inotify unavailable: " + std::string(strerror(errno)));
+        return false;
+    }
+
+    // Close after writing covers in-place edits, moved-to covers rename()
+    m_watch = inotify_add_watch(m_fd, directory.c_str(), IN_CLOSE_WRITE | IN_MOVED_TO);
+    if (m_watch < 0) {
+        Logger::warning("Cannot watch " + directory + ": " + std::string(strerror(errno)));
+        stop();
+        return false;
+    }
+
+    LOG_DEBUG("Watching " + path + " for changes");
+    return true;
+}
+
+void FileWatcher::stop()
+{
+    if (m_fd >= 0) {
+        ::close(m_fd);
+    }
+    m_fd = -1;
+    m_watch = -1;
+}
+
+bool FileWatcher::consumeEvents()
+{
+    if (m_fd < 0) {
+        return false;
+    }
+
+    bool changed = false;
+    alignas(struct inotify_event) char buffer[4096];
+    ssize_t length;
+    while ((length = read(m_fd, buffer, sizeof(buffer))) > 0) {
+        for (char* p = buffer; p < buffer + length; ) {
+            const struct inotify_event* event = reinterpret_cast<const struct inotify_event*>(p);
+            if (event->len > 0 && m_name == event->name) {
+                changed = true;
+            }
+            p += sizeof(struct inotify_event) + event->len;
+        }
+    }
+    return changed;
+}
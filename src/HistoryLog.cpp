@@ -0,0 +1,255 @@
+#include "HistoryLog.h"
+#include "Logger.h"
+#include <algorithm>
+#include <cerrno>
+#include <cstddef>
+#include <cstdio>
+#include <cstring>
+#include <ctime>
+#include <fstream>
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+namespace {
+    constexpr char MAGIC[8] = {'M', 'P', 'H', 'I', 'S', 'T', 0, 0};
+    constexpr uint32_t VERSION = 1;
+
+    struct KindInfo {
+        const char* name;
+        const char* label;
+    };
+
+    const KindInfo KINDS[HistoryLog::KIND_COUNT] = {
+        {"ping_rtt_ms", "Ping ms"},
+        {"speed_down_mbps", "Speed down"},
+        {"speed_up_mbps", "Speed up"},
+        {"throughput_up_mbps", "Iperf up"},
+        {"throughput_down_mbps", "Iperf down"},
+        {"internet_rtt_ms", "Internet ms"},
+    };
+
+    bool endsWith(const std::string& text, const char* suffix) {
+        size_t length = strlen(suffix);
+        return text.size() >= length && text.compare(text.size() - length, length, suffix) == 0;
+    }
+}
+
+// One page at the start of the file; the record array follows it
+struct HistoryLog::Header {
+    char magic[8];
+    uint32_t version;
+    uint32_t recordSize;
+    uint64_t capacity;
+    uint8_t reserved[4096 - 24];
+};
+
+HistoryLog& HistoryLog::getInstance()
+{
+    static HistoryLog instance;
+    return instance;
+}
+
+HistoryLog::~HistoryLog()
+{
+    close();
+}
+
+const char* HistoryLog::kindName(Kind kind)
+{
+    int index = static_cast<int>(kind) - 1;
+    return index >= 0 && index < KIND_COUNT ? KINDS[index].name : "unknown";
+}
+
+const char* HistoryLog::kindLabel(Kind kind)
+{
+    int index = static_cast<int>(kind) - 1;
+    return index >= 0 && index < KIND_COUNT ? KINDS[index].label : "?";
+}
+
+uint16_t HistoryLog::checksum(const Record& record)
+{
+    // FNV-1a over everything before the check field, folded to 16 bits;
+    // never 0, so an all-zero slot is never valid
+    const uint8_t* bytes = reinterpret_cast<const uint8_t*>(&record);
+    uint32_t hash = 2166136261u;
+    for (size_t i = 0; i < offsetof(Record, check); i++) {
+        hash = (hash ^ bytes[i]) * 16777619u;
+    }
+    uint16_t folded = static_cast<uint16_t>(hash ^ (hash >> 16));
+    return folded ? folded : 1;
+}
+
+bool HistoryLog::open(const std::string& path, size_t capacity, bool readOnly)
+{
+    static_assert(sizeof(Header) == 4096, "HistoryLog::Header is one page");
+    close();
+
+    int fd = ::open(path.c_str(), (readOnly ? O_RDONLY : O_RDWR | O_CREAT) | O_CLOEXEC, 0644);
+    if (fd < 0) {
+        Logger::warning("HistoryLog: cannot open " + path + ": " + strerror(errno));
+        return false;
+    }
+
+    struct stat info;
+    if (fstat(fd, &info) != 0) {
+        ::close(fd);
+        return false;
+    }
+
+    // An existing ring keeps its capacity; anything else is started over
+    Header header;
+    bool valid = false;
+    if (static_cast<size_t>(info.st_size) >= sizeof(Header) &&
+        pread(fd, &header, sizeof(header), 0) == static_cast<ssize_t>(sizeof(header))) {
+        valid = memcmp(header.magic, MAGIC, sizeof(MAGIC)) == 0 && header.version == VERSION &&
+                header.recordSize == sizeof(Record) && header.capacity > 0 &&
+                static_cast<uint64_t>(info.st_size) == sizeof(Header) + header.capacity * sizeof(Record);
+    }
+    if (!valid) {
+        if (readOnly || capacity == 0) {
+            Logger::warning("HistoryLog: " + path + " is not a history file");
+            ::close(fd);
+            return false;
+        }
+        if (info.st_size > 0) {
+            Logger::warning("HistoryLog: " + path + " has an unknown layout, starting a new history");
+        }
+        memset(&header, 0, sizeof(header));
+        memcpy(header.magic, MAGIC, sizeof(MAGIC));
+        header.version = VERSION;
+        header.recordSize = sizeof(Record);
+        header.capacity = capacity;
+        // Truncating to 0 first zeroes every old slot
+        if (ftruncate(fd, 0) != 0 ||
+            ftruncate(fd, static_cast<off_t>(sizeof(Header) + capacity * sizeof(Record))) != 0 ||
+            pwrite(fd, &header, sizeof(header), 0) != static_cast<ssize_t>(sizeof(header))) {
+            Logger::warning("HistoryLog: cannot size " + path + ": " + strerror(errno));
+            ::close(fd);
+            return false;
+        }
+    }
+
+    size_t size = sizeof(Header) + header.capacity * sizeof(Record);
+    void* map = mmap(nullptr, size, readOnly ? PROT_READ : PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+    ::close(fd);
+    if (map == MAP_FAILED) {
+        Logger::warning("HistoryLog: cannot map " + path + ": " + strerror(errno));
+        return false;
+    }
+
+    m_map = map;
+    m_mapSize = size;
+    m_records = reinterpret_cast<Record*>(static_cast<uint8_t*>(map) + sizeof(Header));
+    m_capacity = header.capacity;
+
+    // The newest intact record continues the sequence (slots hold 32 bits
+    // of the record number, plenty for a result every second)
+    uint64_t newest = 0;
+    size_t intact = 0;
+    for (size_t slot = 0; slot < m_capacity; slot++) {
+        Record record = m_records[slot];
+        if (record.sequence == 0 || record.check != checksum(record) || record.sequence % m_capacity != slot) {
+            continue;
+        }
+        intact++;
+        newest = std::max<uint64_t>(newest, record.sequence);
+    }
+    m_next.store(newest + 1, std::memory_order_release);
+
+    LOG_DEBUG("HistoryLog: " + path + ", " + std::to_string(intact) + "/" + std::to_string(m_capacity) +
+              " records");
+    return true;
+}
+
+void HistoryLog::close()
+{
+    if (m_map) {
+        munmap(m_map, m_mapSize);
+    }
+    m_map = nullptr;
+    m_mapSize = 0;
+    m_records = nullptr;
+    m_capacity = 0;
+    m_next.store(1, std::memory_order_release);
+}
+
+void HistoryLog::append(Kind kind, double value, bool failed)
+{
+    if (!m_records) {
+        return;
+    }
+
+    uint64_t number = m_next.fetch_add(1, std::memory_order_acq_rel);
+    Record record;
+    record.time = static_cast<uint32_t>(time(nullptr));
+    record.sequence = static_cast<uint32_t>(number);
+    record.value = static_cast<float>(value);
+    record.kind = static_cast<uint8_t>(kind);
+    record.flags = failed ? FLAG_FAILED : 0;
+    record.check = checksum(record);
+
+    // Sequence 0 marks an empty slot; 2^32 records in, skip it
+    if (record.sequence == 0) {
+        return;
+    }
+    m_records[number % m_capacity] = record;
+}
+
+bool HistoryLog::load(uint64_t number, Record& record) const
+{
+    if (!m_records || number == 0) {
+        return false;
+    }
+    record = m_records[number % m_capacity];
+    return record.sequence == static_cast<uint32_t>(number) && record.check == checksum(record);
+}
+
+bool HistoryLog::exportTo(const std::string& path) const
+{
+    bool json = endsWith(path, ".json");
+    std::string temporary = path + ".tmp";
+    {
+        std::ofstream file(temporary);
+        if (!file) {
+            return false;
+        }
+
+        file << (json ? "[\n" : "time,kind,value,failed\n");
+        uint64_t last = end();
+        uint64_t first = last > m_capacity ? last - m_capacity : 1;
+        bool firstRow = true;
+        Record record;
+        char row[160];
+        for (uint64_t number = first; number < last; number++) {
+            if (!load(number, record)) {
+                continue;
+            }
+            time_t seconds = record.time;
+            struct tm utc;
+            gmtime_r(&seconds, &utc);
+            char stamp[32];
+            strftime(stamp, sizeof(stamp), "%Y-%m-%dT%H:%M:%SZ", &utc);
+
+            const char* name = kindName(static_cast<Kind>(record.kind));
+            if (json) {
+                snprintf(row, sizeof(row), "%s  {\"time\": \"%s\", \"kind\": \"%s\", \"value\": %g, \"failed\": %s}",
+                         firstRow ? "" : ",\n", stamp, name, record.value, record.failed() ? "true" : "false");
+            } else {
+                snprintf(row, sizeof(row), "%s,%s,%g,%d\n", stamp, name, record.value, record.failed() ? 1 : 0);
+            }
+            file << row;
+            firstRow = false;
+        }
+        file << (json ? (firstRow ? "]\n" : "\n]\n") : "");
+        if (!file) {
+            return false;
+        }
+    }
+    if (std::rename(temporary.c_str(), path.c_str()) != 0) {
+        std::remove(temporary.c_str());
+        return false;
+    }
+    return true;
+}
@@ -0,0 +1,153 @@
+#include "ItemIndex.h"
+#include <algorithm>
+#include <cctype>
+#include <cstring>
+
+namespace {
+    inline char fold(char c)
+    {
+        return static_cast<char>(std::tolower(static_cast<unsigned char>(c)));
+    }
+
+    std::string folded(const std::string& text)
+    {
+        std::string result(text);
+        std::transform(result.begin(), result.end(), result.begin(), fold);
+        return result;
+    }
+}
+
+void ItemIndex::clear()
+{
+    m_text.clear();
+    m_starts.clear();
+    m_sorted.clear();
+    m_sortedValid = true;
+}
+
+void ItemIndex::append(const std::string& title)
+{
+    m_starts.push_back(static_cast<uint32_t>(m_text.size()));
+    m_text.append(title);
+    m_sortedValid = false;
+}
+
+size_t ItemIndex::length(size_t index) const
+{
+    size_t end = index + 1 < m_starts.size() ? m_starts[index + 1] : m_text.size();
+    return end - m_starts[index];
+}
+
+std::string ItemIndex::at(size_t index) const
+{
+    return m_text.substr(m_starts[index], length(index));
+}
+
+void ItemIndex::ensureSorted()
+{
+    if (m_sortedValid) {
+        return;
+    }
+    m_sorted.resize(m_starts.size());
+    for (size_t i = 0; i < m_sorted.size(); i++) {
+        m_sorted[i] = static_cast<uint32_t>(i);
+    }
+
+    // Folded lexicographic order; equal keys keep their insertion order
+    const char* text = m_text.data();
+    std::sort(m_sorted.begin(), m_sorted.end(), [this, text](uint32_t a, uint32_t b) {
+        const char* left = text + m_starts[a];
+        const char* right = text + m_starts[b];
+        size_t leftLength = length(a);
+        size_t rightLength = length(b);
+        size_t common = std::min(leftLength, rightLength);
+        for (size_t i = 0; i < common; i++) {
+            char l = fold(left[i]);
+            char r = fold(right[i]);
+            if (l != r) {
+                return static_cast<unsigned char>(l) < static_cast<unsigned char>(r);
+            }
+        }
+        return leftLength != rightLength ? leftLength < rightLength : a < b;
+    });
+    m_sortedValid = true;
+}
+
+size_t ItemIndex::sortedAt(size_t position)
+{
+    ensureSorted();
+    return m_sorted[position];
+}
+
+int ItemIndex::comparePrefix(size_t index, const std::string& prefix) const
+{
+    const char* title = m_text.data() + m_starts[index];
+    size_t titleLength = length(index);
+    for (size_t i = 0; i < prefix.size(); i++) {
+        if (i >= titleLength) {
+            return -1;      // A shorter title sorts first
+        }
+        unsigned char c = static_cast<unsigned char>(fold(title[i]));
+        unsigned char p = static_cast<unsigned char>(prefix[i]);
+        if (c != p) {
+            return c < p ? -1 : 1;
+        }
+    }
+    return 0;
+}
+
+ItemIndex::Range ItemIndex::prefixRange(const std::string& prefix)
+{
+    ensureSorted();
+    std::string key = folded(prefix);
+    auto first = std::partition_point(m_sorted.begin(), m_sorted.end(),
+                                      [this, &key](uint32_t index) { return comparePrefix(index, key) < 0; });
+    auto last = std::partition_point(first, m_sorted.end(),
+                                     [this, &key](uint32_t index) { return comparePrefix(index, key) == 0; });
+    Range range;
+    range.begin = static_cast<size_t>(first - m_sorted.begin());
+    range.end = static_cast<size_t>(last - m_sorted.begin());
+    return range;
+}
+
+std::string ItemIndex::nextCharacters(const std::string& prefix, const Range& range, size_t limit)
+{
+    ensureSorted();
+    std::string key = folded(prefix);
+    std::string characters;
+    size_t position = range.begin;
+    while (position < range.end && characters.size() < limit) {
+        uint32_t index = m_sorted[position];
+        if (length(index) <= key.size()) {
+            position++;     // The prefix itself
+            continue;
+        }
+        char next = fold(m_text[m_starts[index] + key.size()]);
+        characters += next;
+
+        // Skip every title sharing prefix + next
+        std::string extended = key + next;
+        auto end = m_sorted.begin() + static_cast<std::ptrdiff_t>(range.end);
+        auto skip = std::partition_point(m_sorted.begin() + static_cast<std::ptrdiff_t>(position), end,
+                                         [this, &extended](uint32_t i) { return comparePrefix(i, extended) <= 0; });
+        position = static_cast<size_t>(skip - m_sorted.begin());
+    }
+    return characters;
+}
+
+size_t ItemIndex::findSorted(const std::string& title)
+{
+    // Titles equal to it when folded form the front of its prefix range
+    Range range = prefixRange(title);
+    for (size_t position = range.begin; position < range.end; position++) {
+        uint32_t index = m_sorted[position];
+        size_t titleLength = length(index);
+        if (titleLength > title.size()) {
+            break;
+        }
+        if (titleLength == title.size() && std::memcmp(m_text.data() + m_starts[index], title.data(), titleLength) == 0) {
+            return position;
+        }
+    }
+    return npos;
+}
@@ -0,0 +1,496 @@
+#include "LauncherClient.h"
+#include "Config.h"
+#include "Logger.h"
+#include <algorithm>
+#include <cerrno>
+#include <cstring>
+#include <ctime>
+#include <memory>
+#include <arpa/inet.h>
+#include <netinet/tcp.h>
+#include <poll.h>
+#include <sys/eventfd.h>
+#include <sys/socket.h>
+#include <unistd.h>
+
+namespace {
+    constexpr const char* PREFIX = "launcher:";
+    constexpr size_t PREFIX_LENGTH = 9;
+
+    int64_t nowMs() {
+        struct timespec ts;
+        clock_gettime(CLOCK_MONOTONIC, &ts);
+        return static_cast<int64_t>(ts.tv_sec) * 1000 + ts.tv_nsec / 1000000;
+    }
+
+    void signal(int fd) {
+        uint64_t one = 1;
+        if (fd >= 0 && write(fd, &one, sizeof(one)) < 0 && errno != EAGAIN) {
+            Logger::warning(std::string("LauncherClient: eventfd write: ") + strerror(errno));
+        }
+    }
+
+    bool parseAddress(const std::string& address, sockaddr_in& server) {
+        size_t colon = address.rfind(':');
+        if (colon == std::string::npos || colon == 0) {
+            return false;
+        }
+        int port = 0;
+        try {
+            size_t used = 0;
+            port = std::stoi(address.substr(colon + 1), &used);
+            if (used != address.size() - colon - 1) {
+                return false;
+            }
+        } catch (...) {
+            return false;
+        }
+        if (port <= 0 || port > 65535) {
+            return false;
+        }
+
+        std::memset(&server, 0, sizeof(server));
+        server.sin_family = AF_INET;
+        server.sin_port = htons(static_cast<uint16_t>(port));
+        return inet_pton(AF_INET, address.substr(0, colon).c_str(), &server.sin_addr) == 1;
+    }
+}
+
+LauncherClient* LauncherClient::forServer(const std::string& address)
+{
+    static std::mutex clientsMutex;
+    static std::map<std::string, std::unique_ptr<LauncherClient>> clients;
+
+    std::lock_guard<std::mutex> lock(clientsMutex);
+    auto it = clients.find(address);
+    if (it != clients.end()) {
+        return it->second.get();
+    }
+
+    sockaddr_in server;
+    if (!parseAddress(address, server)) {
+        Logger::error("LauncherClient: invalid server address '" + address + "', expected IP:PORT");
+        return nullptr;
+    }
+    LauncherClient* client = new LauncherClient(address, server);
+    clients[address].reset(client);
+    return client;
+}
+
+bool LauncherClient::isCommand(const std::string& text)
+{
+    return text.compare(0, PREFIX_LENGTH, PREFIX) == 0;
+}
+
+bool LauncherClient::parseCommand(const std::string& text, std::string& address, std::string& line)
+{
+    if (!isCommand(text)) {
+        return false;
+    }
+    size_t space = text.find(' ', PREFIX_LENGTH);
+    size_t start = text.find_first_not_of(' ', space);
+    if (space == std::string::npos || start == std::string::npos) {
+        return false;
+    }
+    address = text.substr(PREFIX_LENGTH, space - PREFIX_LENGTH);
+    line = text.substr(start);
+    return !address.empty() && line.find('\n') == std::string::npos;
+}
+
+int LauncherClient::completionFd()
+{
+    static int fd = eventfd(0, EFD_NONBLOCK | EFD_CLOEXEC);
+    return fd;
+}
+
+LauncherClient::LauncherClient(const std::string& address, const sockaddr_in& server)
+    : m_address(address), m_server(server)
+{
+    m_wakeFd = eventfd(0, EFD_NONBLOCK | EFD_CLOEXEC);
+    if (m_wakeFd < 0) {
+        Logger::error(std::string("LauncherClient: eventfd: ") + strerror(errno));
+        return;
+    }
+    m_thread = std::thread(&LauncherClient::run, this);
+}
+
+LauncherClient::~LauncherClient()
+{
+    m_stop = true;
+    signal(m_wakeFd);
+    if (m_thread.joinable()) {
+        m_thread.join();
+    }
+    if (m_wakeFd >= 0) {
+        close(m_wakeFd);
+    }
+}
+
+uint64_t LauncherClient::submit(const std::string& line, int timeoutMs)
+{
+    if (m_wakeFd < 0) {
+        return 0;
+    }
+
+    uint64_t id;
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        if (m_outstanding >= static_cast<size_t>(Config::LAUNCHER_MAX_QUEUED)) {
+            Logger::warning("LauncherClient: " + m_address + " has too many requests queued");
+            return 0;
+        }
+        Request request;
+        request.id = id = m_nextId++;
+        request.line = line;
+        request.deadlineMs = nowMs() + (timeoutMs > 0 ? timeoutMs : Config::LAUNCHER_TIMEOUT_MS);
+        m_queued.push_back(request);
+        m_outstanding++;
+    }
+    signal(m_wakeFd);
+    return id;
+}
+
+bool LauncherClient::take(uint64_t id, Response& response)
+{
+    std::lock_guard<std::mutex> lock(m_mutex);
+    auto it = m_done.find(id);
+    if (it == m_done.end()) {
+        return false;
+    }
+    response = std::move(it->second);
+    m_done.erase(it);
+    return true;
+}
+
+void LauncherClient::cancel(uint64_t id)
+{
+    std::lock_guard<std::mutex> lock(m_mutex);
+    if (m_done.erase(id) == 0) {
+        m_cancelled.insert(id);
+    }
+}
+
+void LauncherClient::run()
+{
+    while (!m_stop) {
+        takeQueued();
+        expire(nowMs());
+
+        // Connect for work, or ahead of it after a connection that served some
+        if (m_fd < 0 && (!m_pending.empty() || m_warm)) {
+            connectSocket();
+        }
+        if (m_fd >= 0 && !m_connecting) {
+            flushRequests();
+        }
+
+        struct pollfd fds[2];
+        fds[0] = {m_wakeFd, POLLIN, 0};
+        nfds_t count = 1;
+        if (m_fd >= 0) {
+            short events = POLLIN;
+            if (m_connecting || !m_out.empty()) {
+                events |= POLLOUT;
+            }
+            fds[1] = {m_fd, events, 0};
+            count = 2;
+        }
+        if (::poll(fds, count, pollTimeoutMs(nowMs())) < 0) {
+            if (errno != EINTR) {
+                Logger::error(std::string("LauncherClient: poll: ") + strerror(errno));
+                break;
+            }
+            continue;
+        }
+
+        if (fds[0].revents & POLLIN) {
+            uint64_t value;
+            while (read(m_wakeFd, &value, sizeof(value)) > 0) {
+            }
+        }
+        if (count < 2 || fds[1].revents == 0) {
+            continue;
+        }
+
+        if (m_connecting) {
+            int error = 0;
+            socklen_t length = sizeof(error);
+            getsockopt(m_fd, SOL_SOCKET, SO_ERROR, &error, &length);
+            if (error != 0) {
+                close(m_fd);
+                m_fd = -1;
+                m_connecting = false;
+                m_warm = false;
+                failAll("Error: Failed to connect to " + m_address + ": " + strerror(error));
+                continue;
+            }
+            m_connecting = false;
+            LOG_DEBUG("LauncherClient: connected to " + m_address);
+            continue;
+        }
+        if (fds[1].revents & POLLOUT) {
+            flushRequests();
+        }
+        if (m_fd >= 0 && (fds[1].revents & (POLLIN | POLLERR | POLLHUP))) {
+            readReplies();
+        }
+    }
+
+    if (m_fd >= 0) {
+        close(m_fd);
+        m_fd = -1;
+    }
+}
+
+void LauncherClient::takeQueued()
+{
+    std::lock_guard<std::mutex> lock(m_mutex);
+    while (!m_queued.empty()) {
+        m_pending.push_back(std::move(m_queued.front()));
+        m_queued.pop_front();
+    }
+}
+
+void LauncherClient::connectSocket()
+{
+    m_fd = socket(AF_INET, SOCK_STREAM | SOCK_NONBLOCK | SOCK_CLOEXEC, 0);
+    if (m_fd < 0) {
+        failAll(std::string("Error: Failed to create socket: ") + strerror(errno));
+        return;
+    }
+    // Requests are single short lines; don't hold them back for coalescing
+    int one = 1;
+    setsockopt(m_fd, IPPROTO_TCP, TCP_NODELAY, &one, sizeof(one));
+
+    m_answered = 0;
+    m_connecting = false;
+    int rc = connect(m_fd, reinterpret_cast<const sockaddr*>(&m_server), sizeof(m_server));
+    if (rc == 0) {
+        LOG_DEBUG("LauncherClient: connected to " + m_address);
+        return;
+    }
+    if (errno == EINPROGRESS) {
+        m_connecting = true;
+        return;
+    }
+
+    int error = errno;
+    close(m_fd);
+    m_fd = -1;
+    m_warm = false;
+    failAll("Error: Failed to connect to " + m_address + ": " + strerror(error));
+}
+
+void LauncherClient::closeSocket()
+{
+    if (m_fd >= 0) {
+        close(m_fd);
+        m_fd = -1;
+    }
+    m_connecting = false;
+    m_out.clear();
+    m_in.clear();
+    m_inTruncated = false;
+
+    // Unanswered requests go out again on the next connection, unless this
+    // is already the second one to close on them without a word
+    if (m_inFlight > 0) {
+        if (m_answered == 1 && !m_pipelined) {
+            m_oneShot = true;
+            LOG_DEBUG("LauncherClient: " + m_address + " answers one request per connection");
+        }
+        for (size_t i = 0; i < m_inFlight;) {
+            if (m_answered == 0 && ++m_pending[i].attempts >= 2) {
+                Request request = m_pending[i];
+                m_pending.erase(m_pending.begin() + static_cast<std::ptrdiff_t>(i));
+                m_inFlight--;
+                Response response;
+                response.line = "Error: Server closed connection without response";
+                complete(request, response);
+                continue;
+            }
+            i++;
+        }
+    }
+    m_inFlight = 0;
+
+    // A connection that served something is reopened at once so the next
+    // request finds it ready; one that closed idle waits for a request
+    m_warm = m_answered > 0;
+    m_answered = 0;
+}
+
+void LauncherClient::flushRequests()
+{
+    // One at a time until the server has shown it keeps the connection, and
+    // a single request per connection for servers that close after replying
+    size_t depth = m_pipelined ? m_pending.size() : 1;
+    if (m_oneShot && m_answered > 0) {
+        depth = 0;
+    }
+    while (m_inFlight < std::min(depth, m_pending.size())) {
+        m_out += m_pending[m_inFlight].line + "\n";
+        m_inFlight++;
+    }
+
+    while (!m_out.empty()) {
+        ssize_t sent = send(m_fd, m_out.data(), m_out.size(), MSG_NOSIGNAL);
+        if (sent > 0) {
+            m_out.erase(0, static_cast<size_t>(sent));
+            continue;
+        }
+        if (sent < 0 && errno == EINTR) continue;
+        if (sent < 0 && (errno == EAGAIN || errno == EWOULDBLOCK)) return;
+
+        LOG_DEBUG("LauncherClient: send to " + m_address + ": " + strerror(errno));
+        closeSocket();
+        return;
+    }
+}
+
+void LauncherClient::readReplies()
+{
+    const size_t limit = static_cast<size_t>(Config::LAUNCHER_MAX_LINE);
+    char buffer[4096];
+    while (m_fd >= 0) {
+        ssize_t n = recv(m_fd, buffer, sizeof(buffer), 0);
+        if (n < 0 && errno == EINTR) continue;
+        if (n < 0 && (errno == EAGAIN || errno == EWOULDBLOCK)) return;
+        if (n <= 0) {
+            // Like launcher-client, whatever arrived before the close is the reply
+            if (n < 0) {
+                LOG_DEBUG("LauncherClient: recv from " + m_address + ": " + strerror(errno));
+            } else if (!m_in.empty() && m_inFlight > 0) {
+                reply(m_in);
+            }
+            closeSocket();
+            return;
+        }
+
+        const char* data = buffer;
+        size_t length = static_cast<size_t>(n);
+        while (length > 0 && m_fd >= 0) {
+            const char* newline = static_cast<const char*>(memchr(data, '\n', length));
+            size_t chunk = newline ? static_cast<size_t>(newline - data) : length;
+
+            // The rest of an overlong reply is dropped up to its newline
+            size_t room = limit - std::min(limit, m_in.size());
+            if (!m_inTruncated) {
+                m_in.append(data, std::min(chunk, room));
+                m_inTruncated = chunk > room;
+            }
+            if (!newline) {
+                break;
+            }
+
+            if (!m_in.empty() && m_in.back() == '\r') {
+                m_in.pop_back();
+            }
+            std::string line;
+            line.swap(m_in);
+            m_inTruncated = false;
+            reply(line);
+            data += chunk + 1;
+            length -= chunk + 1;
+        }
+    }
+}
+
+void LauncherClient::reply(const std::string& line)
+{
+    if (m_inFlight == 0) {
+        LOG_DEBUG("LauncherClient: unexpected line from " + m_address + ": " + line);
+        return;
+    }
+
+    Request request = m_pending.front();
+    m_pending.pop_front();
+    m_inFlight--;
+    m_answered++;
+    if (m_answered >= 2 && !m_pipelined) {
+        m_pipelined = true;
+        LOG_DEBUG("LauncherClient: " + m_address + " keeps connections open, pipelining");
+    }
+
+    Response response;
+    response.ok = true;
+    response.line = line;
+    complete(request, response);
+
+    // The server is about to hang up; open the next connection now
+    if (m_oneShot && m_inFlight == 0) {
+        closeSocket();
+    }
+}
+
+void LauncherClient::expire(int64_t now)
+{
+    // An overdue reply can't be told apart from the next one any more, so
+    // the connection goes with it and the rest are resent
+    if (m_inFlight > 0 && now >= m_pending.front().deadlineMs) {
+        Request request = m_pending.front();
+        m_pending.pop_front();
+        m_inFlight--;
+        Logger::warning("LauncherClient: " + m_address + " did not answer '" + request.line + "' in time");
+
+        Response response;
+        response.timedOut = true;
+        response.line = "Error: Timeout waiting for response";
+        complete(request, response);
+        closeSocket();
+        m_warm = false;
+    }
+
+    for (size_t i = m_inFlight; i < m_pending.size();) {
+        if (now < m_pending[i].deadlineMs) {
+            i++;
+            continue;
+        }
+        Request request = m_pending[i];
+        m_pending.erase(m_pending.begin() + static_cast<std::ptrdiff_t>(i));
+        Response response;
+        response.timedOut = true;
+        response.line = "Error: Timeout waiting for response";
+        complete(request, response);
+    }
+}
+
+void LauncherClient::complete(const Request& request, const Response& response)
+{
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        m_outstanding--;
+        if (m_cancelled.erase(request.id) == 0) {
+            m_done[request.id] = response;
+        }
+    }
+    signal(completionFd());
+}
+
+void LauncherClient::failAll(const std::string& why)
+{
+    // Only called between connections, when nothing is on the wire
+    Response response;
+    response.line = why;
+    while (!m_pending.empty()) {
+        Request request = m_pending.front();
+        m_pending.pop_front();
+        complete(request, response);
+    }
+    m_inFlight = 0;
+    if (!why.empty()) {
+        LOG_DEBUG("LauncherClient: " + why);
+    }
+}
+
+int LauncherClient::pollTimeoutMs(int64_t now) const
+{
+    if (m_pending.empty()) {
+        return -1;
+    }
+    int64_t nearest = m_pending.front().deadlineMs;
+    for (const auto& request : m_pending) {
+        nearest = std::min(nearest, request.deadlineMs);
+    }
+    return static_cast<int>(std::max<int64_t>(0, nearest - now));
+}
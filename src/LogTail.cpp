@@ -0,0 +1,148 @@
+#include "LogTail.h"
+#include "Config.h"
+#include "Logger.h"
+#include <algorithm>
+#include <cerrno>
+#include <cstring>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/inotify.h>
+#include <sys/stat.h>
+
+LogTail::~LogTail()
+{
+    close();
+}
+
+bool LogTail::open(const std::string& path)
+{
+    close();
+
+    m_fd = ::open(path.c_str(), O_RDONLY | O_CLOEXEC);
+    if (m_fd < 0) {
+        LOG_DEBUG("Cannot open log " + path + ": " + strerror(errno));
+        return false;
+    }
+
+    m_watchFd = inotify_init1(IN_NONBLOCK | IN_CLOEXEC);
+    if (m_watchFd >= 0 && inotify_add_watch(m_watchFd, path.c_str(), IN_MODIFY) < 0) {
+        ::close(m_watchFd);
+        m_watchFd = -1;
+    }
+    if (m_watchFd < 0) {
+        LOG_DEBUG("No inotify watch on " + path + ", reading it on every poll");
+    }
+
+    m_offset = 0;
+    m_pending = true;       // Whatever is there already
+    m_partial.clear();
+    return true;
+}
+
+void LogTail::close()
+{
+    if (m_watchFd >= 0) {
+        ::close(m_watchFd);
+    }
+    if (m_fd >= 0) {
+        ::close(m_fd);
+    }
+    m_watchFd = -1;
+    m_fd = -1;
+    m_partial.clear();
+}
+
+bool LogTail::consumeEvents()
+{
+    bool modified = false;
+    alignas(struct inotify_event) char buffer[1024];
+    while (read(m_watchFd, buffer, sizeof(buffer)) > 0) {
+        modified = true;
+    }
+    return modified;
+}
+
+void LogTail::poll(const LineHandler& onLine)
+{
+    if (m_fd < 0) {
+        return;
+    }
+    bool modified = m_watchFd < 0 || consumeEvents();
+    if (!modified && !m_pending) {
+        return;
+    }
+    m_pending = false;
+
+    struct stat info;
+    if (fstat(m_fd, &info) == 0 && info.st_size < m_offset) {
+        LOG_DEBUG("Log truncated, reading it from the start");
+        m_offset = 0;
+        m_partial.clear();
+    }
+
+    char buffer[16 * 1024];
+    size_t total = 0;
+    while (true) {
+        // A log growing faster than we parse is finished on later polls
+        if (total >= static_cast<size_t>(Config::LOG_TAIL_MAX_READ_PER_POLL)) {
+            m_pending = true;
+            return;
+        }
+        ssize_t n = pread(m_fd, buffer, sizeof(buffer), m_offset);
+        if (n < 0 && errno == EINTR) {
+            continue;
+        }
+        if (n <= 0) {
+            return;
+        }
+        m_offset += n;
+        total += static_cast<size_t>(n);
+        deliver(buffer, static_cast<size_t>(n), onLine);
+    }
+}
+
+void LogTail::finish(const LineHandler& onLine)
+{
+    if (m_fd < 0) {
+        return;
+    }
+    do {
+        m_pending = true;
+        poll(onLine);
+    } while (m_pending);
+
+    if (!m_partial.empty()) {
+        onLine(m_partial);
+        m_partial.clear();
+    }
+}
+
+void LogTail::deliver(const char* data, size_t length, const LineHandler& onLine)
+{
+    const size_t limit = static_cast<size_t>(Config::LOG_TAIL_MAX_LINE);
+    const char* end = data + length;
+    while (data < end) {
+        const char* separator = std::find_if(data, end, [](char c) { return c == '\n' || c == '\r'; });
+        size_t chunk = static_cast<size_t>(separator - data);
+
+        size_t room = limit - std::min(limit, m_partial.size());
+        if (chunk > room) {
+            m_partial.append(data, room);
+            onLine(m_partial);
+            m_partial.clear();
+            data += room;
+            continue;
+        }
+
+        m_partial.append(data, chunk);
+        if (separator == end) {
+            return;
+        }
+        // "\r\n" and blank lines give no empty lines
+        if (!m_partial.empty()) {
+            onLine(m_partial);
+            m_partial.clear();
+        }
+        data = separator + 1;
+    }
+}
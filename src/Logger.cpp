@@ -1,4 +1,378 @@
 #include "Logger.h"
 
+#include <algorithm>
+#include <chrono>
+#include <condition_variable>
+#include <cstdlib>
+#include <cstring>
+#include <ctime>
+#include <mutex>
+#include <thread>
+#include <cerrno>
+#include <fcntl.h>
+#include <sys/socket.h>
+#include <sys/uio.h>
+#include <sys/un.h>
+#include <unistd.h>
+
 // Initialize static member
 bool Logger::m_verbose = false;
+
+namespace {
+
+constexpr size_t RING_CAPACITY = Config::LOG_RING_CAPACITY;
+constexpr size_t RECORD_BYTES = Config::LOG_RECORD_BYTES;
+constexpr const char* JOURNAL_SOCKET = "/run/systemd/journal/socket";
+
+const char* levelPrefix(Logger::Level level) {
+    switch (level) {
+        case Logger::Level::DEBUG: return "[DEBUG] ";
+        case Logger::Level::INFO: return "";
+        case Logger::Level::WARNING: return "[WARNING] ";
+        case Logger::Level::ERROR: return "[ERROR] ";
+    }
+    return "";
+}
+
+// syslog(3) priorities
+int journalPriority(Logger::Level level) {
+    switch (level) {
+        case Logger::Level::DEBUG: return 7;
+        case Logger::Level::INFO: return 6;
+        case Logger::Level::WARNING: return 4;
+        case Logger::Level::ERROR: return 3;
+    }
+    return 6;
+}
+
+bool isStderrLevel(Logger::Level level) {
+    return level == Logger::Level::WARNING || level == Logger::Level::ERROR;
+}
+
+std::string suppressedNote(uint32_t suppressed) {
+    return " (" + std::to_string(suppressed) + " similar messages suppressed)";
+}
+
+bool writeAll(int fd, const char* data, size_t length) {
+    while (length > 0) {
+        ssize_t n = write(fd, data, length);
+        if (n < 0) {
+            if (errno == EINTR) continue;
+            return false;
+        }
+        data += n;
+        length -= static_cast<size_t>(n);
+    }
+    return true;
+}
+
+/**
+ * Bounded multi-producer single-consumer ring (Vyukov's sequence-per-slot
+ * queue). Producers claim a slot with one CAS and never wait; the flusher
+ * thread is the only consumer.
+ */
+struct AsyncLogger {
+    struct Slot {
+        std::atomic<size_t> sequence{0};
+        Logger::Level level = Logger::Level::INFO;
+        uint16_t length = 0;
+        struct timespec time = {0, 0};
+        char text[RECORD_BYTES];
+    };
+
+    Slot slots[RING_CAPACITY];
+    std::atomic<size_t> enqueuePos{0};
+    size_t dequeuePos = 0;                  // Flusher only
+    std::atomic<uint64_t> dropped{0};
+    std::atomic<bool> active{false};
+
+    Logger::Sink sink = Logger::Sink::STDOUT;
+    int fileFd = -1;
+    int journalFd = -1;
+
+    std::thread thread;
+    std::mutex mutex;
+    std::condition_variable wake;
+    bool stop = false;
+
+    // Flusher batches, reused between rounds
+    std::string batch;
+    int batchFd = -1;
+
+    AsyncLogger() {
+        for (size_t i = 0; i < RING_CAPACITY; i++) {
+            slots[i].sequence.store(i, std::memory_order_relaxed);
+        }
+    }
+
+    // False when the flusher should be woken before its next tick
+    bool push(Logger::Level level, const std::string& message, uint32_t suppressed) {
+        size_t pos = enqueuePos.load(std::memory_order_relaxed);
+        Slot* slot;
+        for (;;) {
+            slot = &slots[pos % RING_CAPACITY];
+            size_t sequence = slot->sequence.load(std::memory_order_acquire);
+            intptr_t diff = static_cast<intptr_t>(sequence) - static_cast<intptr_t>(pos);
+            if (diff == 0) {
+                if (enqueuePos.compare_exchange_weak(pos, pos + 1, std::memory_order_relaxed)) {
+                    break;
+                }
+            } else if (diff < 0) {
+                // Full: dropping keeps the caller's timing unchanged
+                dropped.fetch_add(1, std::memory_order_relaxed);
+                return true;
+            } else {
+                pos = enqueuePos.load(std::memory_order_relaxed);
+            }
+        }
+
+        slot->level = level;
+        clock_gettime(CLOCK_REALTIME, &slot->time);
+        size_t length = std::min(message.size(), RECORD_BYTES);
+        memcpy(slot->text, message.data(), length);
+        if (suppressed > 0 && length < RECORD_BYTES) {
+            std::string note = suppressedNote(suppressed);
+            size_t extra = std::min(note.size(), RECORD_BYTES - length);
+            memcpy(slot->text + length, note.data(), extra);
+            length += extra;
+        }
+        slot->length = static_cast<uint16_t>(length);
+        slot->sequence.store(pos + 1, std::memory_order_release);
+
+        // Bursts: don't wait for the tick once half the ring is used
+        return (pos + 1) % (RING_CAPACITY / 2) != 0;
+    }
+
+    bool pop(Slot*& slot) {
+        slot = &slots[dequeuePos % RING_CAPACITY];
+        return slot->sequence.load(std::memory_order_acquire) == dequeuePos + 1;
+    }
+
+    void release(Slot* slot) {
+        slot->sequence.store(dequeuePos + RING_CAPACITY, std::memory_order_release);
+        dequeuePos++;
+    }
+
+    void flushBatch() {
+        if (!batch.empty() && batchFd >= 0) {
+            writeAll(batchFd, batch.data(), batch.size());
+        }
+        batch.clear();
+    }
+
+    void appendLine(int fd, const char* prefix, const char* text, size_t length, const struct timespec* time) {
+        if (fd != batchFd) {
+            flushBatch();
+            batchFd = fd;
+        }
+        if (time) {
+            struct tm local;
+            localtime_r(&time->tv_sec, &local);
+            char stamp[32];
+            size_t n = strftime(stamp, sizeof(stamp), "%Y-%m-%d %H:%M:%S", &local);
+            snprintf(stamp + n, sizeof(stamp) - n, ".%03ld ", time->tv_nsec / 1000000);
+            batch += stamp;
+        }
+        batch += prefix;
+        batch.append(text, length);
+        batch += '\n';
+    }
+
+    void sendJournal(Logger::Level level, const char* text, size_t length) {
+        // Binary MESSAGE field so embedded newlines survive
+        char header[64];
+        int headerLength = snprintf(header, sizeof(header), "PRIORITY=%d\nSYSLOG_IDENTIFIER=micropanel\nMESSAGE\n",
+                                    journalPriority(level));
+        uint64_t size = length;
+        unsigned char sizeBytes[8];
+        for (int i = 0; i < 8; i++) {
+            sizeBytes[i] = static_cast<unsigned char>(size >> (8 * i));
+        }
+        struct iovec iov[4];
+        iov[0].iov_base = header;
+        iov[0].iov_len = static_cast<size_t>(headerLength);
+        iov[1].iov_base = sizeBytes;
+        iov[1].iov_len = sizeof(sizeBytes);
+        iov[2].iov_base = const_cast<char*>(text);
+        iov[2].iov_len = length;
+        iov[3].iov_base = const_cast<char*>("\n");
+        iov[3].iov_len = 1;
+        struct msghdr message;
+        memset(&message, 0, sizeof(message));
+        message.msg_iov = iov;
+        message.msg_iovlen = 4;
+        sendmsg(journalFd, &message, MSG_NOSIGNAL);
+    }
+
+    void emit(Logger::Level level, const char* text, size_t length, const struct timespec& time) {
+        switch (sink) {
+            case Logger::Sink::STDOUT:
+                appendLine(isStderrLevel(level) ? STDERR_FILENO : STDOUT_FILENO, levelPrefix(level), text, length, nullptr);
+                break;
+            case Logger::Sink::FILE:
+                appendLine(fileFd, levelPrefix(level), text, length, &time);
+                break;
+            case Logger::Sink::JOURNAL:
+                sendJournal(level, text, length);
+                break;
+        }
+    }
+
+    void drain() {
+        Slot* slot;
+        while (pop(slot)) {
+            emit(slot->level, slot->text, slot->length, slot->time);
+            release(slot);
+        }
+
+        uint64_t lost = dropped.exchange(0, std::memory_order_relaxed);
+        if (lost > 0) {
+            std::string note = std::to_string(lost) + " log messages dropped (ring full)";
+            struct timespec now;
+            clock_gettime(CLOCK_REALTIME, &now);
+            emit(Logger::Level::WARNING, note.data(), note.size(), now);
+        }
+        flushBatch();
+    }
+
+    void run() {
+        std::unique_lock<std::mutex> lock(mutex);
+        for (;;) {
+            lock.unlock();
+            drain();
+            lock.lock();
+            if (stop) {
+                break;
+            }
+            wake.wait_for(lock, std::chrono::milliseconds(Config::LOG_FLUSH_INTERVAL_MS));
+        }
+        lock.unlock();
+        // Records that raced with stop
+        drain();
+    }
+};
+
+// Created by the first startAsync() and never destroyed: code running
+// during static destruction may still log
+std::atomic<AsyncLogger*> g_async{nullptr};
+
+void closeSinks(AsyncLogger& async) {
+    if (async.fileFd >= 0) {
+        close(async.fileFd);
+        async.fileFd = -1;
+    }
+    if (async.journalFd >= 0) {
+        close(async.journalFd);
+        async.journalFd = -1;
+    }
+}
+
+int64_t monotonicSeconds() {
+    struct timespec now;
+    clock_gettime(CLOCK_MONOTONIC_COARSE, &now);
+    return now.tv_sec;
+}
+
+} // namespace
+
+bool Logger::RateLimit::allow(uint32_t& suppressed) {
+    int64_t second = monotonicSeconds();
+    int64_t window = m_window.load(std::memory_order_relaxed);
+    if (window != second && m_window.compare_exchange_strong(window, second, std::memory_order_relaxed)) {
+        // First message of a new second reports what the last one lost
+        suppressed = m_suppressed.exchange(0, std::memory_order_relaxed);
+        m_count.store(1, std::memory_order_relaxed);
+        return true;
+    }
+    if (m_count.fetch_add(1, std::memory_order_relaxed) < static_cast<uint32_t>(Config::LOG_RATE_LIMIT_PER_SEC)) {
+        return true;
+    }
+    m_suppressed.fetch_add(1, std::memory_order_relaxed);
+    return false;
+}
+
+bool Logger::startAsync(Sink sink, const std::string& path) {
+    if (!g_async.load()) {
+        g_async.store(new AsyncLogger());
+    }
+    AsyncLogger& async = *g_async.load();
+    if (async.active.load()) {
+        return true;
+    }
+
+    if (sink == Sink::FILE) {
+        async.fileFd = open(path.c_str(), O_WRONLY | O_CREAT | O_APPEND | O_CLOEXEC, 0644);
+        if (async.fileFd < 0) {
+            error("Cannot open log file " + path + ": " + strerror(errno));
+            return false;
+        }
+    } else if (sink == Sink::JOURNAL) {
+        async.journalFd = socket(AF_UNIX, SOCK_DGRAM | SOCK_CLOEXEC, 0);
+        struct sockaddr_un address;
+        memset(&address, 0, sizeof(address));
+        address.sun_family = AF_UNIX;
+        strncpy(address.sun_path, JOURNAL_SOCKET, sizeof(address.sun_path) - 1);
+        if (async.journalFd < 0 ||
+            connect(async.journalFd, reinterpret_cast<struct sockaddr*>(&address), sizeof(address)) != 0) {
+            error("Cannot connect to the systemd journal: " + std::string(strerror(errno)));
+            closeSinks(async);
+            return false;
+        }
+    }
+
+    // Anything already buffered by iostreams goes out before the flusher's writes
+    std::cout.flush();
+    std::cerr.flush();
+
+    async.sink = sink;
+    async.stop = false;
+    async.thread = std::thread(&AsyncLogger::run, &async);
+    async.active.store(true);
+
+    static bool exitHookInstalled = false;
+    if (!exitHookInstalled) {
+        exitHookInstalled = true;
+        atexit(&Logger::stopAsync);
+    }
+    return true;
+}
+
+void Logger::stopAsync() {
+    if (!g_async.load() || !g_async.load()->active.exchange(false)) {
+        return;
+    }
+    AsyncLogger& async = *g_async.load();
+    {
+        std::lock_guard<std::mutex> lock(async.mutex);
+        async.stop = true;
+    }
+    async.wake.notify_one();
+    if (async.thread.joinable()) {
+        async.thread.join();
+    }
+    closeSinks(async);
+}
+
+void Logger::log(Level level, const std::string& message, uint32_t suppressed) {
+    // Skip debug messages in non-verbose mode
+    if (!enabled(level)) {
+        return;
+    }
+
+    AsyncLogger* async = g_async.load(std::memory_order_acquire);
+    if (async && async->active.load(std::memory_order_acquire)) {
+        bool canWait = async->push(level, message, suppressed);
+        if (!canWait || isStderrLevel(level)) {
+            // A waiting flusher is woken at once; otherwise the next tick picks it up
+            async->wake.notify_one();
+        }
+        return;
+    }
+
+    std::ostream& out = isStderrLevel(level) ? std::cerr : std::cout;
+    out << levelPrefix(level) << message;
+    if (suppressed > 0) {
+        out << suppressedNote(suppressed);
+    }
+    out << std::endl;
+}
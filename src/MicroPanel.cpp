@@ -2,17 +2,29 @@
 #include "Config.h"
 #include "DeviceInterfaces.h"
 #include "MultiInputDevice.h"
+#include "VirtualDisplayDevice.h"
+#include "ScriptedInputDevice.h"
 #include "MenuSystem.h"
 #include "ScreenModules.h"
 #include "MenuScreenModule.h"
 #include "PersistentStorage.h"
+#include "HistoryLog.h"
 #include "ModuleDependency.h"
 #include "Logger.h"
+#include "EventLoop.h"
+#include "Scheduler.h"
+#include "CommandRunner.h"
+#include "PerfCounters.h"
+#include "PushServer.h"
+#include "ModuleRegistry.h"
+#include "ModuleCatalog.h"
 #include <iostream>
 #include <signal.h>
 #include <unistd.h>
 #include <getopt.h>
 #include <fstream>
+#include <algorithm>
+#include <chrono>
 #include <nlohmann/json.hpp>
 using json = nlohmann::json;
 
@@ -28,7 +40,7 @@ void MicroPanel::signalHandler(int signal)
         s_instance->m_running = false;
     }
    g_signalReceived.store(true);
-   Logger::debug("Signal received, initiating shutdown...");
+   LOG_DEBUG("Signal received, initiating shutdown...");
 }
 
 MicroPanel::MicroPanel(int argc, char* argv[])
@@ -46,6 +58,8 @@ MicroPanel::MicroPanel(int argc, char* argv[])
 
     // Parse command line arguments
     parseCommandLine(argc, argv);
+
+    m_eventLoop = std::make_unique<EventLoop>();
 }
 
 MicroPanel::~MicroPanel()
@@ -59,8 +73,12 @@ void MicroPanel::parseCommandLine(int argc, char* argv[])
     // Default configuration - now with auto-detect enabled by default
     m_config.autoDetect = true;  // Enable auto-detection by default
 
+    bool statsSocketGiven = false;
+    bool pushSocketGiven = false;
+    bool accelCurveGiven = false;
+
     int opt;
-    while ((opt = getopt(argc, argv, "i:s:c:vahp")) != -1) {
+    while ((opt = getopt(argc, argv, "i:s:c:l:vahpfbFR:S:P:U:A:M:H:E:")) != -1) {
         switch (opt) {
             case 'i':
                 m_config.inputDevice = optarg;
@@ -85,13 +103,23 @@ void MicroPanel::parseCommandLine(int argc, char* argv[])
                         m_config.persistentDataFile = configPath + "_data.json";
                     }
                 }
+                // Measurement history next to it
+                if (m_config.historyFile.empty()) {
+                    std::string configPath = optarg;
+                    size_t lastDot = configPath.find_last_of('.');
+                    m_config.historyFile = (lastDot != std::string::npos ? configPath.substr(0, lastDot) : configPath) +
+                                           "_history.bin";
+                }
                 Logger::info("Using configuration file: " + std::string(optarg));
                 Logger::info("Using persistent data file: " + m_config.persistentDataFile);
                 break;
+            case 'l':
+                m_config.logTarget = optarg;
+                break;
             case 'v':
                 m_config.verboseMode = true;
                 Logger::setVerbose(true);
-                Logger::debug("Verbose mode enabled");
+                LOG_DEBUG("Verbose mode enabled");
                 break;
             case 'a':
                 m_config.autoDetect = true;
@@ -102,6 +130,46 @@ void MicroPanel::parseCommandLine(int argc, char* argv[])
                 Logger::info("Power save mode enabled (timeout: " +
                           std::to_string(Config::POWER_SAVE_TIMEOUT_SEC) + " seconds)");
                 break;
+            case 'f':
+                m_config.frameBufferMode = true;
+                Logger::info("Framebuffer display mode enabled (serial displays)");
+                break;
+            case 'b':
+                m_config.blitMode = true;
+                Logger::info("Bitmap blit display mode enabled (serial displays)");
+                break;
+            case 'F':
+                m_config.fastBoot = true;
+                Logger::info("Fast boot enabled");
+                break;
+            case 'R':
+                m_config.replayScript = optarg;
+                Logger::info("Replaying input from: " + std::string(optarg));
+                break;
+            case 'S':
+                m_config.statsSocket = std::string(optarg) == "off" ? "" : optarg;
+                statsSocketGiven = true;
+                break;
+            case 'P':
+                m_config.statsTextfile = optarg;
+                break;
+            case 'U':
+                m_config.pushSocket = std::string(optarg) == "off" ? "" : optarg;
+                pushSocketGiven = true;
+                break;
+            case 'A':
+                m_config.accelCurve = optarg;
+                accelCurveGiven = true;
+                break;
+            case 'M':
+                m_config.pluginDir = optarg;
+                break;
+            case 'H':
+                m_config.historyFile = optarg;
+                break;
+            case 'E':
+                m_config.historyExport = optarg;
+                break;
             case 'h':
                 std::cout << "OLED Menu Control Daemon v" << Config::VERSION << std::endl;
                 std::cout << "Usage: " << argv[0] << " [OPTIONS]\n\n";
@@ -109,11 +177,28 @@ void MicroPanel::parseCommandLine(int argc, char* argv[])
                 std::cout << "  -i DEVICE   Specify input device (default: auto-detect)\n";
                 std::cout << "              Use 'gpio' for GPIO button auto-detection\n";
                 std::cout << "  -s DEVICE   Specify serial device for display (default: auto-detect)\n";
+                std::cout << "              Use 'virtual[:DIR]' for a headless display (PBM frames in DIR)\n";
                 std::cout << "  -c FILE     Specify JSON configuration file for screen modules\n";
                 std::cout << "  -a          Auto-detect HMI device (enabled by default)\n";
                 std::cout << "  -p          Enable power save mode (display turns off after "
                         << Config::POWER_SAVE_TIMEOUT_SEC << " seconds of inactivity)\n";
+                std::cout << "  -f          Compose frames host-side and send only changes per frame\n";
+                std::cout << "  -b          Render serial frames locally and send CMD_BLIT bitmaps (firmware support required)\n";
+                std::cout << "  -F          Fast boot: splash as soon as the display opens, no startup delays\n";
+                std::cout << "  -R FILE     Replay scripted input from FILE instead of the input device, then exit\n";
+                std::cout << "  -S PATH     Serve performance counters on Unix socket PATH (default: "
+                        << Config::STATS_SOCKET_PATH << ", 'off' disables)\n";
+                std::cout << "  -P FILE     Write performance counters to FILE in Prometheus text format\n";
+                std::cout << "  -U PATH     Accept pushed screen content on Unix datagram socket PATH (default: "
+                        << Config::PUSH_SOCKET_PATH << ", 'off' disables)\n";
+                std::cout << "  -A CURVE    Encoder acceleration as RATE:GAIN points in detents/s (default: "
+                        << Config::ENCODER_ACCEL_CURVE << ", 'off' disables)\n";
+                std::cout << "  -M DIR      Load plugin modules from DIR on first use (default: "
+                        << Config::PLUGIN_DIR << ")\n";
+                std::cout << "  -H FILE     Measurement history ring (default: next to the -c config, *_history.bin)\n";
+                std::cout << "  -E FILE     Export the measurement history as CSV (or JSON for *.json) and exit\n";
                 std::cout << "  -v          Enable verbose debug output\n";
+                std::cout << "  -l TARGET   Log to 'stdout' (default), 'journal' or a file path\n";
                 std::cout << "  -h          Display this help message\n\n";
                 std::cout << "Example:\n";
                 std::cout << "  " << argv[0] << " -i /dev/input/event11 -s /dev/ttyACM0 -c /etc/screens.json -v\n\n";
@@ -129,7 +214,67 @@ void MicroPanel::parseCommandLine(int argc, char* argv[])
         }
     }
 
-    Logger::debug("Auto-detection: " + std::string(m_config.autoDetect ? "ENABLED" : "DISABLED"));
+    // An export reads the ring and leaves; the running instance may keep appending
+    if (!m_config.historyExport.empty()) {
+        HistoryLog& history = HistoryLog::getInstance();
+        if (m_config.historyFile.empty() || !history.open(m_config.historyFile, 0, true)) {
+            std::cerr << "No measurement history" << (m_config.historyFile.empty() ? "" : " in " + m_config.historyFile)
+                      << std::endl;
+            exit(EXIT_FAILURE);
+        }
+        bool written = history.exportTo(m_config.historyExport);
+        history.close();
+        if (!written) {
+            std::cerr << "Cannot write " << m_config.historyExport << std::endl;
+            exit(EXIT_FAILURE);
+        }
+        exit(EXIT_SUCCESS);
+    }
+
+    // Headless runs neither wait for nor pick up real hardware
+    if (!m_config.replayScript.empty() || VirtualDisplayDevice::isVirtualPath(m_config.serialDevice)) {
+        m_config.headless = true;
+        m_config.autoDetect = false;
+        if (!m_config.replayScript.empty()) {
+            m_config.useGPIOMode = false;
+        }
+    }
+
+    // Headless runs (benchmarks, CI) only get a stats socket when asked for one
+    if (!statsSocketGiven && !m_config.headless) {
+        m_config.statsSocket = Config::STATS_SOCKET_PATH;
+    }
+    if (!pushSocketGiven && !m_config.headless) {
+        m_config.pushSocket = Config::PUSH_SOCKET_PATH;
+    }
+
+    // One curve for the HMI and GPIO encoders; a replayed "rotate N" stays N steps unless -A is given
+    if (!accelCurveGiven) {
+        m_config.accelCurve = m_config.replayScript.empty() ? Config::ENCODER_ACCEL_CURVE : "off";
+    }
+    std::vector<EncoderAcceleration::Point> curve;
+    if (!EncoderAcceleration::parseCurve(m_config.accelCurve, curve)) {
+        Logger::warning("Invalid acceleration curve '" + m_config.accelCurve + "', using " +
+                        Config::ENCODER_ACCEL_CURVE);
+        EncoderAcceleration::parseCurve(Config::ENCODER_ACCEL_CURVE, curve);
+    }
+    EncoderAcceleration::setCurve(curve);
+
+    LOG_DEBUG("Auto-detection: " + std::string(m_config.autoDetect ? "ENABLED" : "DISABLED"));
+
+    // From here on log calls only queue; a background thread does the writing
+    bool logging;
+    if (m_config.logTarget.empty() || m_config.logTarget == "stdout") {
+        logging = Logger::startAsync(Logger::Sink::STDOUT);
+    } else if (m_config.logTarget == "journal") {
+        logging = Logger::startAsync(Logger::Sink::JOURNAL);
+    } else {
+        logging = Logger::startAsync(Logger::Sink::FILE, m_config.logTarget);
+    }
+    if (!logging) {
+        Logger::warning("Logging to stdout instead of " + m_config.logTarget);
+        Logger::startAsync(Logger::Sink::STDOUT);
+    }
 }
 
 void MicroPanel::setupSignalHandlers()
@@ -255,9 +400,13 @@ bool MicroPanel::initialize()
     }
     } else {
     // Traditional mode
-    m_inputDevice = std::make_shared<InputDevice>(m_config.inputDevice);
+    if (!m_config.replayScript.empty()) {
+        m_inputDevice = std::make_shared<ScriptedInputDevice>(m_config.replayScript);
+    } else {
+        m_inputDevice = std::make_shared<InputDevice>(m_config.inputDevice);
+    }
     if (!m_inputDevice->open()) {
-        std::cerr << "Failed to open input device: " << m_config.inputDevice << std::endl;
+        std::cerr << "Failed to open input device: " << m_inputDevice->getDevicePath() << std::endl;
         return false;
     }
     }
@@ -279,6 +428,15 @@ bool MicroPanel::initialize()
         m_display->enablePowerSave(true);
     }
 
+    // Fast boot: something on the panel before the config is read
+    if (m_config.fastBoot) {
+        m_display->clear();
+        m_display->drawText(0, 0, "Menu System");
+        m_display->drawText(0, 10, "Starting...");
+        m_display->present();
+        m_display->flush();
+    }
+
     // Initialize main menu
     m_mainMenu = std::make_shared<Menu>(m_display);
 
@@ -287,11 +445,20 @@ bool MicroPanel::initialize()
 
     // Initialize persistent storage if config file is provided
     if (!m_config.configFile.empty()) {
+        // Parsed once; storage, dependencies and menus all read this model
+        loadConfigModel();
+
         if (!initPersistentStorage()) {
             Logger::warning("Failed to initialize persistent storage");
             // Continue anyway, persistent storage will be unavailable
         }
 
+        // Results are simply not recorded without it
+        if (!m_config.historyFile.empty() &&
+            !HistoryLog::getInstance().open(m_config.historyFile, Config::HISTORY_CAPACITY)) {
+            Logger::warning("Measurement history unavailable");
+        }
+
         // Load module dependencies
         if (!loadModuleDependencies()) {
             Logger::warning("Failed to load module dependencies");
@@ -314,9 +481,9 @@ bool MicroPanel::initialize()
     return true;
 }
 
-bool MicroPanel::loadConfigFromJson() {
+bool MicroPanel::loadConfigModel() {
     try {
-        Logger::debug("Loading configuration from: " + m_config.configFile);
+        LOG_DEBUG("Loading configuration from: " + m_config.configFile);
 
         // Open the file
         std::ifstream configFile(m_config.configFile);
@@ -326,39 +493,43 @@ bool MicroPanel::loadConfigFromJson() {
         }
 
         // Parse JSON
-        json config = json::parse(configFile);
-
-        // Check for persistent_data section
-        if (config.contains("persistent_data") && config["persistent_data"].is_object()) {
-            if (config["persistent_data"].contains("file_path") &&
-                config["persistent_data"]["file_path"].is_string()) {
-                // Override default persistent data file path
-                m_config.persistentDataFile = config["persistent_data"]["file_path"].get<std::string>();
-                Logger::debug("Using persistent data file from config: " + m_config.persistentDataFile);
-
-                // Initialize persistent storage with the new path
-                initPersistentStorage();
-            }
-        }
-
-        // Initial startup delay to make sure device is fully initialized
-        usleep(Config::STARTUP_DELAY);
-        Logger::debug("Initializing display...");
+        m_configModel = std::make_shared<const json>(json::parse(configFile));
+    } catch (const std::exception& e) {
+        Logger::error("Error parsing JSON config: " + std::string(e.what()));
+        return false;
+    }
 
-        // Clear the display
-        m_display->clear();
-        usleep(Config::DISPLAY_CMD_DELAY * 15);
+    // Check for persistent_data section
+    const json& config = *m_configModel;
+    if (config.contains("persistent_data") && config["persistent_data"].is_object()) {
+        const json& persistentData = config["persistent_data"];
+        if (persistentData.contains("fsync") && persistentData["fsync"].is_boolean()) {
+            m_config.persistentFsync = persistentData["fsync"].get<bool>();
+        }
+        if (persistentData.contains("journal") && persistentData["journal"].is_boolean()) {
+            m_config.persistentJournal = persistentData["journal"].get<bool>();
+        }
+        if (persistentData.contains("file_path") && persistentData["file_path"].is_string()) {
+            // Override default persistent data file path
+            m_config.persistentDataFile = persistentData["file_path"].get<std::string>();
+            LOG_DEBUG("Using persistent data file from config: " + m_config.persistentDataFile);
+        }
+        if (persistentData.contains("history_file") && persistentData["history_file"].is_string()) {
+            m_config.historyFile = persistentData["history_file"].get<std::string>();
+        }
+    }
+    return true;
+}
 
-        // Draw startup message
-        m_display->drawText(0, 0, "Menu System");
-        usleep(Config::DISPLAY_CMD_DELAY * 10);
+bool MicroPanel::loadConfigFromJson() {
+    if (!m_configModel) {
+        return false;
+    }
 
-        m_display->drawText(0, 10, "Loading Config...");
-        usleep(Config::DISPLAY_CMD_DELAY * 10);
+    try {
+        const json& config = *m_configModel;
 
-        // Clear before showing menu
-        m_display->clear();
-        usleep(Config::DISPLAY_CMD_DELAY * 15);
+        showStartupScreen("Loading Config...");
 
         // Check if "modules" field exists and is an array
         if (!config.contains("modules") || !config["modules"].is_array()) {
@@ -366,204 +537,354 @@ bool MicroPanel::loadConfigFromJson() {
             return false;
         }
 
-        Logger::debug("Starting menu configuration processing");
-        Logger::debug("Found " + std::to_string(config["modules"].size()) + " modules in config");
+        LOG_DEBUG("Starting menu configuration processing");
+        LOG_DEBUG("Found " + std::to_string(config["modules"].size()) + " modules in config");
 
         // First pass: Create all menu modules
         for (const auto& module : config["modules"]) {
-            // Check for required fields
-            if (!module.contains("id") || !module.contains("title")) {
-                Logger::warning("Skipping module with missing required field");
-                continue;
-            }
+            registerConfigModule(module);
+        }
 
-            // Get module properties
-            std::string id = module["id"].get<std::string>();
-            std::string title = module["title"].get<std::string>();
-            bool enabled = module.contains("enabled") ? module["enabled"].get<bool>() : false;
+        // Second pass: Configure menu hierarchies
+        for (const auto& module : config["modules"]) {
+            configureMenuModule(module);
+        }
 
-            // Get the module type if specified
-            std::string moduleType = module.contains("type") ? module["type"].get<std::string>() : "";
+        buildMainMenu(config);
 
-            // Check if this is a menu type module
-            bool isMenu = moduleType == "menu";
+        // Debug the menu state
+        LOG_DEBUG("Menu setup complete, about to render");
 
-            // Check if this is a special action type module
-            bool isAction = moduleType == "action";
-            // Check if this is a GenericList type module
-            bool isGenericList = moduleType == "GenericList";
-            // Check if this is a textbox type module
-            bool isTextBox = moduleType == "textbox";
+        // Force a display test
+        if (!m_config.fastBoot) {
+            m_display->clear();
+            usleep(Config::DISPLAY_CMD_DELAY * 5);
+            m_display->drawText(0, 20, "TESTING DISPLAY");
+            usleep(Config::DISPLAY_CMD_DELAY * 20);
+        }
 
-            // Always create menu modules, regardless of enabled status
-            if (isMenu) {
-                Logger::debug("Creating menu module: " + id);
-                auto menuModule = std::make_shared<MenuScreenModule>(m_display, m_inputDevice, id, title);
+        // Initially render the menu
+        m_mainMenu->render();
+        LOG_DEBUG("Menu render called");
 
-                // Add to module registry
-                m_modules[id] = menuModule;
+        return true;
+    } catch (const std::exception& e) {
+        Logger::error("Error reading JSON config: " + std::string(e.what()));
+        return false;
+    }
+}
 
-                // CRITICAL: Set GPIO handler for ALL menu modules, not just enabled ones
-                if (m_config.useGPIOMode) {
-                    menuModule->setUseGPIOMode(true);
-                    menuModule->setGPIOHandler([this](std::shared_ptr<ScreenModule> submodule) {
-                    this->runModuleWithGPIOInput(submodule);
-                    });
-                    Logger::debug("Set GPIO handler for menu module: " + id);
-                }
+void MicroPanel::registerConfigModule(const json& module)
+{
+    // Check for required fields
+    if (!module.contains("id") || !module.contains("title")) {
+        Logger::warning("Skipping module with missing required field");
+        return;
+    }
 
-                // Add to main menu only if enabled
-                if (enabled) {
-                    registerModuleInMenu(id, title);
-                    Logger::debug("Added menu module to main menu: " + id);
-                }
-            }
-            // Handle action modules
-            else if (isAction) {
-                if (id == "invert_display" && enabled) {
-                    m_mainMenu->addItem(std::make_shared<ActionMenuItem>(title, [this]() {
-                        m_display->setInverted(!m_display->isInverted());
-                    }));
-                    Logger::debug("Added invert display action to main menu: " + title);
-                }
-            }
-            // Handle GenericList modules
-            else if (isGenericList) {
-                Logger::debug("Creating GenericList module: " + id);
-                // Create a new GenericListScreen instance for this module
-                auto genericListModule = std::make_shared<GenericListScreen>(m_display, m_inputDevice);
-                genericListModule->setId(id);
-                genericListModule->setConfig(module);
-                // Add to module registry
-                m_modules[id] = genericListModule;
-                // Add to main menu only if enabled
-                if (enabled) {
-                    registerModuleInMenu(id, title);
-                    Logger::debug("Added GenericList module to main menu: " + id);
-                }
-            }
-            // Handle textbox modules
-            else if (isTextBox) {
-                Logger::debug("Creating textbox module: " + id);
-                // Create a new TextBoxScreen instance for this module
-                auto textboxModule = std::make_shared<TextBoxScreen>(m_display, m_inputDevice);
-                textboxModule->setId(id);
-                // Add to module registry
-                m_modules[id] = textboxModule;
-                // Add to main menu only if enabled
-                if (enabled) {
-                    registerModuleInMenu(id, title);
-                    Logger::debug("Added textbox module to main menu: " + id);
-                }
-            }
-            // For regular modules, only add to main menu if enabled
-            else if (enabled && m_modules.find(id) != m_modules.end()) {
-                // Only add to menu if dependencies are satisfied (for non-menu modules)
-                auto& dependencies = ModuleDependency::getInstance();
-                if (dependencies.shouldSkipDependencyCheck(id) || dependencies.checkDependencies(id)) {
-                    registerModuleInMenu(id, title);
-                    Logger::debug("Registered module: " + id + " with title: " + title);
-                } else {
-                    Logger::warning("Module dependencies not satisfied: " + id);
-                }
+    // Get module properties
+    std::string id = module["id"].get<std::string>();
+    std::string title = module["title"].get<std::string>();
+    bool enabled = module.contains("enabled") ? module["enabled"].get<bool>() : false;
+
+    // Get the module type if specified
+    std::string moduleType = module.contains("type") ? module["type"].get<std::string>() : "";
+
+    // Always create menu modules, regardless of enabled status
+    if (moduleType == "menu") {
+        LOG_DEBUG("Creating menu module: " + id);
+        auto menuModule = std::make_shared<MenuScreenModule>(m_display, m_inputDevice, id, title);
+
+        // Add to module registry; menus are wired up below, so they are built now
+        m_modules.add(id, menuModule);
+
+        // CRITICAL: Set GPIO handler for ALL menu modules, not just enabled ones
+        if (m_config.useGPIOMode) {
+            menuModule->setUseGPIOMode(true);
+            menuModule->setGPIOHandler([this](std::shared_ptr<ScreenModule> submodule) {
+            this->runModuleWithGPIOInput(submodule);
+            });
+            LOG_DEBUG("Set GPIO handler for menu module: " + id);
+        }
+
+        // Enabled menus sit in the main menu
+        menuModule->setAsTopLevelMenu(enabled);
+    }
+    // Handle GenericList modules
+    else if (moduleType == "GenericList") {
+        LOG_DEBUG("Registering GenericList module: " + id);
+        // Built on first entry; the factory holds the model its config lives in
+        std::shared_ptr<const json> model = m_configModel;
+        const json* moduleConfig = &module;
+        m_modules.add(id, [this, id, model, moduleConfig]() {
+            auto genericListModule = std::make_shared<GenericListScreen>(m_display, m_inputDevice);
+            genericListModule->setId(id);
+            genericListModule->setConfig(*moduleConfig);
+            return genericListModule;
+        });
+    }
+    // Handle textbox modules
+    else if (moduleType == "textbox") {
+        LOG_DEBUG("Registering textbox module: " + id);
+        // Built on first entry
+        m_modules.add(id, [this, id]() {
+            auto textboxModule = std::make_shared<TextBoxScreen>(m_display, m_inputDevice);
+            textboxModule->setId(id);
+            return textboxModule;
+        });
+    }
+    // Handle push modules: content arrives on the push socket
+    else if (moduleType == "push") {
+        LOG_DEBUG("Registering push module: " + id);
+        std::string channel = module.contains("channel") && module["channel"].is_string() ?
+                              module["channel"].get<std::string>() : id;
+        m_modules.add(id, [this, id, title, channel]() {
+            auto pushModule = std::make_shared<PushScreen>(m_display, m_inputDevice);
+            pushModule->setId(id);
+            pushModule->setTitle(title);
+            pushModule->setChannel(channel);
+            return pushModule;
+        });
+    }
+}
+
+void MicroPanel::configureMenuModule(const json& module)
+{
+    // Check if this module has an ID and is a menu type
+    if (!module.contains("id") || !module.contains("type") ||
+        module["type"].get<std::string>() != "menu") {
+        return;
+    }
+
+    std::string menuId = module["id"].get<std::string>();
+
+    // Get the menu module from our registry
+    auto menuModule = std::dynamic_pointer_cast<MenuScreenModule>(m_modules.get(menuId));
+    if (!menuModule) {
+        Logger::warning("Menu module not found: " + menuId);
+        return;
+    }
+
+    // Set the module registry so the menu can look up modules
+    menuModule->setModuleRegistry(&m_modules);
+
+    // Check if this menu has submenus
+    menuModule->clearSubmenuItems();
+    if (module.contains("submenus") && module["submenus"].is_array()) {
+        // Add each submenu item
+        for (const auto& submenu : module["submenus"]) {
+            // Check for required fields
+            if (!submenu.contains("id") || !submenu.contains("title")) {
+                Logger::warning("Skipping submenu with missing required field");
+                continue;
             }
+
+            // Get submenu properties
+            std::string submenuId = submenu["id"].get<std::string>();
+            std::string submenuTitle = submenu["title"].get<std::string>();
+
+            // Add to the menu without checking dependencies
+            menuModule->addSubmenuItem(submenuId, submenuTitle);
+            LOG_DEBUG("Added submenu item " + submenuId + " to menu " + menuId);
         }
+    }
+}
 
-        // Second pass: Configure menu hierarchies
-        for (const auto& module : config["modules"]) {
-            // Check if this module has an ID and is a menu type
-            if (module.contains("id") &&
-                module.contains("type") &&
-                module["type"].get<std::string>() == "menu") {
-
-                std::string menuId = module["id"].get<std::string>();
-
-                // Check if the menu module exists in our registry
-                auto it = m_modules.find(menuId);
-                if (it == m_modules.end() || !std::dynamic_pointer_cast<MenuScreenModule>(it->second)) {
-                    Logger::warning("Menu module not found: " + menuId);
-                    continue;
-                }
+void MicroPanel::buildMainMenu(const json& config)
+{
+    for (const auto& module : config["modules"]) {
+        if (!module.contains("id") || !module.contains("title")) {
+            continue;
+        }
 
-                // Get the menu module
-                auto menuModule = std::dynamic_pointer_cast<MenuScreenModule>(it->second);
-
-                // Set the module registry so the menu can look up modules
-                menuModule->setModuleRegistry(&m_modules);
-
-                // Check if this menu has submenus
-                if (module.contains("submenus") && module["submenus"].is_array()) {
-                    // Add each submenu item
-                    for (const auto& submenu : module["submenus"]) {
-                        // Check for required fields
-                        if (!submenu.contains("id") || !submenu.contains("title")) {
-                            Logger::warning("Skipping submenu with missing required field");
-                            continue;
-                        }
-
-                        // Get submenu properties
-                        std::string submenuId = submenu["id"].get<std::string>();
-                        std::string submenuTitle = submenu["title"].get<std::string>();
-
-                        // Add to the menu without checking dependencies
-                        menuModule->addSubmenuItem(submenuId, submenuTitle);
-                        Logger::debug("Added submenu item " + submenuId + " to menu " + menuId);
-                    }
-                }
+        std::string id = module["id"].get<std::string>();
+        std::string title = module["title"].get<std::string>();
+        bool enabled = module.contains("enabled") ? module["enabled"].get<bool>() : false;
+        std::string moduleType = module.contains("type") ? module["type"].get<std::string>() : "";
+        if (!enabled) {
+            continue;
+        }
+
+        if (moduleType == "menu" || moduleType == "GenericList" || moduleType == "textbox" ||
+            moduleType == "push") {
+            registerModuleInMenu(id, title);
+            LOG_DEBUG("Added " + moduleType + " module to main menu: " + id);
+        }
+        // Handle action modules
+        else if (moduleType == "action") {
+            if (id == "invert_display") {
+                m_mainMenu->addItem(std::make_shared<ActionMenuItem>(title, [this]() {
+                    m_display->setInverted(!m_display->isInverted());
+                }));
+                LOG_DEBUG("Added invert display action to main menu: " + title);
+            }
+        }
+        // For regular modules, only add to main menu if enabled
+        else if (m_modules.contains(id)) {
+            // Only add to menu if dependencies are satisfied (for non-menu modules)
+            auto& dependencies = ModuleDependency::getInstance();
+            if (dependencies.shouldSkipDependencyCheck(id) || dependencies.checkDependencies(id)) {
+                registerModuleInMenu(id, title);
+                LOG_DEBUG("Registered module: " + id + " with title: " + title);
+            } else {
+                Logger::warning("Module dependencies not satisfied: " + id);
             }
         }
+    }
 
-        // Special case for Invert Display option if it's in the options section
-        if (config.contains("options") && config["options"].is_object()) {
-            auto options = config["options"];
-            if (options.contains("invert_display") && options["invert_display"].is_object()) {
-                auto invertOpt = options["invert_display"];
-                if (invertOpt.contains("enabled") && invertOpt["enabled"].get<bool>() &&
-                    invertOpt.contains("title") && invertOpt["title"].is_string()) {
-                    // Add the invert display option with custom title
-                    std::string title = invertOpt["title"].get<std::string>();
-                    m_mainMenu->addItem(std::make_shared<ActionMenuItem>(title, [this]() {
-                        m_display->setInverted(!m_display->isInverted());
-                    }));
-                    Logger::debug("Added invert display option: " + title);
-                }
+    // Special case for Invert Display option if it's in the options section
+    if (config.contains("options") && config["options"].is_object()) {
+        auto options = config["options"];
+        if (options.contains("invert_display") && options["invert_display"].is_object()) {
+            auto invertOpt = options["invert_display"];
+            if (invertOpt.contains("enabled") && invertOpt["enabled"].get<bool>() &&
+                invertOpt.contains("title") && invertOpt["title"].is_string()) {
+                // Add the invert display option with custom title
+                std::string title = invertOpt["title"].get<std::string>();
+                m_mainMenu->addItem(std::make_shared<ActionMenuItem>(title, [this]() {
+                    m_display->setInverted(!m_display->isInverted());
+                }));
+                LOG_DEBUG("Added invert display option: " + title);
             }
         }
+    }
+}
 
-        // Debug the menu state
-        Logger::debug("Menu setup complete, about to render");
+namespace {
 
-        // Force a display test
-        m_display->clear();
-        usleep(Config::DISPLAY_CMD_DELAY * 5);
-        m_display->drawText(0, 20, "TESTING DISPLAY");
-        usleep(Config::DISPLAY_CMD_DELAY * 20);
+std::string moduleType(const json& module)
+{
+    return module.contains("type") && module["type"].is_string() ? module["type"].get<std::string>() : "";
+}
 
-        // Initially render the menu
-        m_mainMenu->render();
-        Logger::debug("Menu render called");
+// Modules whose instances come from the config rather than initializeModules()
+bool isConfigDefined(const json& module)
+{
+    std::string type = moduleType(module);
+    return type == "menu" || type == "GenericList" || type == "textbox" || type == "push";
+}
 
-        // Mark top-level menu modules
-        for (const auto& modulePair : m_modules) {
-        auto menuModule = std::dynamic_pointer_cast<MenuScreenModule>(modulePair.second);
-        if (menuModule) {
-        // Check if this is a top-level menu (enabled and in the main menu)
+std::map<std::string, const json*> modulesById(const json& config)
+{
+    std::map<std::string, const json*> modules;
+    if (config.contains("modules") && config["modules"].is_array()) {
         for (const auto& module : config["modules"]) {
-            if (module.contains("id") && module["id"].get<std::string>() == modulePair.first &&
-                module.contains("enabled") && module["enabled"].get<bool>()) {
-                menuModule->setAsTopLevelMenu(true);
-                Logger::debug("Marked " + modulePair.first + " as top-level menu");
-                break;
+            if (module.contains("id") && module["id"].is_string()) {
+                modules[module["id"].get<std::string>()] = &module;
             }
-          }
         }
+    }
+    return modules;
+}
+
+// Everything buildMainMenu() reads; submenu contents and list settings are not part of it
+json mainMenuInputs(const json& config)
+{
+    json inputs = json::array();
+    if (config.contains("modules") && config["modules"].is_array()) {
+        for (const auto& module : config["modules"]) {
+            inputs.push_back({module.value("id", json()), module.value("title", json()),
+                              module.value("enabled", json()), module.value("type", json()),
+                              module.value("depends", json())});
         }
+    }
+    inputs.push_back(config.value("options", json()));
+    return inputs;
+}
 
-        return true;
+} // namespace
+
+void MicroPanel::reloadConfig()
+{
+    m_reloadPending = false;
+    auto started = std::chrono::steady_clock::now();
+
+    std::shared_ptr<const json> next;
+    try {
+        std::ifstream configFile(m_config.configFile);
+        if (!configFile.is_open()) {
+            Logger::warning("Config reload: could not open " + m_config.configFile);
+            return;
+        }
+        next = std::make_shared<const json>(json::parse(configFile));
     } catch (const std::exception& e) {
-        Logger::error("Error parsing JSON config: " + std::string(e.what()));
-        return false;
+        // A broken push keeps the running config; the next write retries
+        Logger::warning("Config reload: " + std::string(e.what()) + " - keeping the current config");
+        return;
+    }
+    if (!next->contains("modules") || !(*next)["modules"].is_array()) {
+        Logger::warning("Config reload: no valid 'modules' array - keeping the current config");
+        return;
+    }
+
+    std::shared_ptr<const json> previous = m_configModel;
+    if (previous && *previous == *next) {
+        LOG_DEBUG("Config reload: no changes");
+        return;
+    }
+    static const json noConfig = json::object();
+    const json& before = previous ? *previous : noConfig;
+    if (before.value("persistent_data", json()) != next->value("persistent_data", json())) {
+        Logger::warning("Config reload: persistent_data changes take effect after a restart");
+    }
+
+    // Dependency paths can change without any module changing
+    ModuleDependency::getInstance().loadDependencies(*next);
+
+    // Unchanged modules keep their instances (and still unbuilt factories
+    // keep the old model alive through their own reference)
+    m_configModel = next;
+    std::map<std::string, const json*> oldModules = modulesById(before);
+    std::map<std::string, const json*> newModules = modulesById(*next);
+    int rebuilt = 0;
+
+    for (const auto& entry : oldModules) {
+        if (!newModules.count(entry.first) && isConfigDefined(*entry.second)) {
+            m_modules.remove(entry.first);
+            rebuilt++;
+        }
+    }
+
+    for (const auto& entry : newModules) {
+        const std::string& id = entry.first;
+        const json& module = *entry.second;
+        auto old = oldModules.find(id);
+        if (old != oldModules.end() && *old->second == module) {
+            continue;
+        }
+
+        // Menus are registered as instances, so find() sees them without
+        // constructing (or dlopen-ing) whatever else sits unbuilt under this id
+        auto menuModule = std::dynamic_pointer_cast<MenuScreenModule>(m_modules.find(id));
+        if (menuModule && moduleType(module) == "menu") {
+            // Keep the instance: submenus may still point at it as their parent
+            menuModule->setTitle(module.value("title", id));
+            menuModule->setAsTopLevelMenu(module.value("enabled", false));
+        } else {
+            if (old != oldModules.end() && isConfigDefined(*old->second)) {
+                m_modules.remove(id);
+            }
+            registerConfigModule(module);
+        }
+        configureMenuModule(module);
+        rebuilt++;
+    }
+
+    // The main menu is only rebuilt when one of its entries changed
+    bool mainMenuChanged = !previous || mainMenuInputs(before) != mainMenuInputs(*next);
+    if (mainMenuChanged) {
+        int selection = m_mainMenu->getCurrentSelection();
+        m_mainMenu->clear();
+        buildMainMenu(*next);
+        int last = static_cast<int>(m_mainMenu->getItemCount()) - 1;
+        m_mainMenu->setCurrentSelection(std::min(selection, last), false);
+        m_mainMenu->refresh();
     }
+
+    long elapsed = std::chrono::duration_cast<std::chrono::milliseconds>(
+        std::chrono::steady_clock::now() - started).count();
+    Logger::info("Config reloaded in " + std::to_string(elapsed) + " ms: " + std::to_string(rebuilt) +
+                 " modules rebuilt" + (mainMenuChanged ? ", main menu rebuilt" : ""));
 }
 
 void MicroPanel::initializeModules()
@@ -571,34 +892,38 @@ void MicroPanel::initializeModules()
     // Clear any existing modules
     m_modules.clear();
 
-    // Create screen modules
-    m_modules["hello"] = std::make_shared<HelloWorldScreen>(m_display, m_inputDevice);
-    m_modules["counter"] = std::make_shared<CounterScreen>(m_display, m_inputDevice);
-    m_modules["brightness"] = std::make_shared<BrightnessScreen>(m_display, m_inputDevice);
-    m_modules["network"] = std::make_shared<NetworkInfoScreen>(m_display, m_inputDevice);
-    m_modules["system"] = std::make_shared<SystemStatsScreen>(m_display, m_inputDevice);
-    m_modules["textbox"] = std::make_shared<TextBoxScreen>(m_display, m_inputDevice);
-    m_modules["internet"] = std::make_shared<InternetTestScreen>(m_display, m_inputDevice);
-    m_modules["wifi"] = std::make_shared<WiFiSettingsScreen>(m_display, m_inputDevice);
-    m_modules["ping"] = std::make_shared<IPPingScreen>(m_display, m_inputDevice);
-    m_modules["netinfo"] = std::make_shared<NetInfoScreen>(m_display, m_inputDevice);
-    m_modules["netsettings"] = std::make_shared<NetSettingsScreen>(m_display, m_inputDevice);
-    m_modules["speedtest"] = std::make_shared<SpeedTestScreen>(m_display, m_inputDevice);
-    //m_modules["throughputtest"] = std::make_shared<ThroughputTestScreen>(m_display, m_inputDevice);
-    m_modules["throughputserver"] = std::make_shared<ThroughputServerScreen>(m_display, m_inputDevice);
-    m_modules["throughputclient"] = std::make_shared<ThroughputClientScreen>(m_display, m_inputDevice);
-    Logger::debug("Module initialization complete - " + std::to_string(m_modules.size()) + " modules available");
+    // Screens compiled into this build registered themselves; plugins are
+    // only noted here and loaded when first opened
+    ModuleCatalog& catalog = ModuleCatalog::getInstance();
+    catalog.scanPlugins(m_config.pluginDir);
+
+    // Each is constructed the first time it is opened, with the display and
+    // input of that moment
+    for (const std::string& id : catalog.ids()) {
+        m_modules.add(id, [this, id]() -> std::shared_ptr<ScreenModule> {
+            ModuleCatalog::Factory factory = ModuleCatalog::getInstance().factory(id);
+            return factory ? factory(m_display, m_inputDevice) : nullptr;
+        });
+    }
+    LOG_DEBUG("Module initialization complete - " + std::to_string(m_modules.size()) + " modules available");
 }
 
 void MicroPanel::registerModuleInMenu(const std::string& moduleName, const std::string& menuTitle) {
+    // Left out of this build
+    if (!m_modules.contains(moduleName)) {
+        LOG_DEBUG("Module not available, no menu entry: " + moduleName);
+        return;
+    }
+
     m_mainMenu->addItem(std::make_shared<ActionMenuItem>(menuTitle, [this, moduleName]() {
-        Logger::debug("Executing action for module: " + moduleName);
-        auto module = std::dynamic_pointer_cast<ScreenModule>(m_modules[moduleName]);
+        LOG_DEBUG("Executing action for module: " + moduleName);
+        auto module = m_modules.get(moduleName);
         if (module) {
             // Clear main menu flag if this is a menu module
             auto menuModule = std::dynamic_pointer_cast<MenuScreenModule>(module);
             if (menuModule) {
                 menuModule->clearMainMenuFlag();
+                menuModule->setParentMenu(nullptr);
 
                 // NEW: Configure menu module for GPIO mode
                 if (m_config.useGPIOMode) {
@@ -626,11 +951,16 @@ void MicroPanel::registerModuleInMenu(const std::string& moduleName, const std::
     }));
 }
 
-void MicroPanel::setupMenu()
+void MicroPanel::showStartupScreen(const std::string& status)
 {
+    // Fast boot already has its splash up; the menu render replaces it
+    if (m_config.fastBoot) {
+        return;
+    }
+
     // Initial startup delay to make sure device is fully initialized
     usleep(Config::STARTUP_DELAY);
-    std::cout << "Initializing display..." << std::endl;
+    LOG_DEBUG("Initializing display...");
 
     // Clear the display
     m_display->clear();
@@ -640,12 +970,17 @@ void MicroPanel::setupMenu()
     m_display->drawText(0, 0, "Menu System");
     usleep(Config::DISPLAY_CMD_DELAY * 10);
 
-    m_display->drawText(0, 10, "Initializing...");
+    m_display->drawText(0, 10, status);
     usleep(Config::DISPLAY_CMD_DELAY * 10);
 
     // Clear before showing menu
     m_display->clear();
     usleep(Config::DISPLAY_CMD_DELAY * 15);
+}
+
+void MicroPanel::setupMenu()
+{
+    showStartupScreen("Initializing...");
 
     registerModuleInMenu("brightness", "Brightness");
     registerModuleInMenu("network", "Net Settings");
@@ -653,6 +988,7 @@ void MicroPanel::setupMenu()
     registerModuleInMenu("internet", "Test Internet");
     registerModuleInMenu("wifi", "WiFi Settings");
     registerModuleInMenu("ping", "IP Ping");
+    registerModuleInMenu("sweep", "Host Sweep");
     registerModuleInMenu("netinfo", "Net Info");
     registerModuleInMenu("netsettings", "Net Settings");
 
@@ -670,161 +1006,320 @@ void MicroPanel::run()
     // Check if we're using I2C mode
     bool isI2CMode = (m_config.serialDevice.find("/dev/i2c-") == 0);
 
-    // Only start disconnection monitor for USB/serial devices, not I2C
-    if (!isI2CMode) {
-        std::cout << "Starting USB device disconnection monitor" << std::endl;
-        m_deviceManager->startDisconnectionMonitor();
+    if (!m_eventLoop->isValid()) {
+        Logger::error("Event loop unavailable - cannot run main loop");
+        return;
+    }
+
+    // Worker threads only poke the event loop; everything they trigger runs
+    // on this thread
+    m_eventLoop->setWakeHandler([this]() { scheduleFlush(); });
+    m_display->setRedrawNotifier([this]() { m_eventLoop->wake(); });
+
+    // Periodic work shares one timer and pauses while nobody can see the panel
+    Scheduler::getInstance().attach(m_eventLoop.get());
+    m_display->setPowerNotifier([this](bool) { updateVisibility(); });
+    updateVisibility();
+
+    // USB devices come and go through one udev monitor; I2C and headless displays don't
+    bool hotplug = !isI2CMode && !m_config.headless && m_deviceManager->startHotplugMonitor();
+    if (hotplug) {
+        m_deviceManager->setHotplugCallbacks(
+            [this](const std::string& inputDevice, const std::string& serialDevice) {
+                onDeviceConnected(inputDevice, serialDevice);
+            },
+            [this]() { onDeviceDisconnected(); });
+        m_eventLoop->addFd(m_deviceManager->getMonitorFd(), [this]() {
+            m_deviceManager->processHotplugEvents();
+        });
+        m_rescanTimer = m_eventLoop->addTimer([this]() { m_deviceManager->rescan(); });
+        ScreenModule::setDeviceGuard([this]() { return waitForDevices(); });
     } else {
-        Logger::debug("I2C mode detected - skipping USB disconnection monitoring");
+        LOG_DEBUG("I2C mode detected - skipping USB hotplug monitoring");
     }
 
     // Set running flag
     m_running = true;
 
-    // Main event loop
-    struct timeval lastBufferFlush = {0, 0};
-    struct timeval now;
-
-    while (m_running) {
-        // Check if device was disconnected - ONLY for non-I2C devices
-        if (!isI2CMode && (m_deviceManager->isDeviceDisconnected() ||
-            (m_baseDisplayDevice && m_baseDisplayDevice->isDisconnected()))) {
-            std::cout << "USB device disconnection detected!" << std::endl;
-
-            if (m_config.autoDetect) {
-                // For auto-detect mode, try to reconnect
-                std::cout << "Attempting to reconnect..." << std::endl;
-
-                // Clean up current devices
-                if (m_inputDevice) {
-                    m_inputDevice->close();
+    // Input goes to the main menu until a module takes over
+    m_onInput = [this](const InputEvent& event) {
+        if (event.isMovement()) {
+            m_mainMenu->handleRotation(event.steps());
+        } else if (event.type == InputEvent::Type::PRESS) {
+            m_mainMenu->handleButtonPress();
+        }
+    };
+    watchInputDevices();
+
+    // A replay starts with the loop, so its timeline is the one on screen;
+    // the end of the script ends the run like a signal
+    if (auto script = std::dynamic_pointer_cast<ScriptedInputDevice>(m_inputDevice)) {
+        auto virtualDisplay = std::dynamic_pointer_cast<VirtualDisplayDevice>(m_baseDisplayDevice);
+        script->start(
+            [virtualDisplay]() {
+                if (virtualDisplay) {
+                    virtualDisplay->markInput();
                 }
+            },
+            [this]() {
+                m_running = false;
+                g_signalReceived.store(true);
+                m_eventLoop->wake();
+            });
+    }
 
-                if (m_baseDisplayDevice) {
-                    m_baseDisplayDevice->close();
-                }
+    // Output of list/textbox scripts is drained as it arrives
+    CommandRunner& commands = CommandRunner::getInstance();
+    if (commands.getFd() >= 0) {
+        m_eventLoop->addFd(commands.getFd(), [&commands]() { commands.poll(); });
+    }
 
-                // Stop the disconnection monitor while we wait for reconnection
-                m_deviceManager->stopDisconnectionMonitor();
+    // Counters for production units: a socket to query, optionally a textfile to scrape
+    if (!m_config.statsSocket.empty() && m_statsServer.listen(m_config.statsSocket)) {
+        m_eventLoop->addFd(m_statsServer.getFd(), [this]() { m_statsServer.acceptClients(); });
+    }
 
-                // Wait for device to reconnect with a timeout
-                bool reconnected = m_deviceManager->monitorDeviceUntilConnected(m_running);
+    // Other services push screen content; push screens redraw from what was received
+    PushServer& push = PushServer::getInstance();
+    if (!m_config.pushSocket.empty() && push.listen(m_config.pushSocket)) {
+        m_eventLoop->addFd(push.getFd(), [&push]() { push.poll(); });
+    }
+    if (!m_config.statsTextfile.empty()) {
+        auto writeTextfile = [this]() {
+            if (!PerfCounters::getInstance().writeTextfile(m_config.statsTextfile)) {
+                LOG_DEBUG("Could not write " + m_config.statsTextfile);
+            }
+        };
+        writeTextfile();
+        // The scraper reads it whether or not the display is on
+        m_textfileJob = Scheduler::getInstance().add("textfile", Config::STATS_TEXTFILE_INTERVAL_MS,
+                                                     Scheduler::Cost::LIGHT, false, writeTextfile);
+    }
 
-                if (reconnected) {
-                    std::cout << "Successfully reconnected to device!" << std::endl;
+    // Deferred frames and buffered commands are sent shortly after activity
+    // instead of on a fixed tick
+    m_flushTimer = m_eventLoop->addTimer([this, isI2CMode]() {
+        // Commit any deferred frame; only serial devices buffer commands
+        if (m_baseDisplayDevice) {
+            m_display->present();
+            if (!isI2CMode) {
+                m_display->flush();
+            }
+        }
+    });
+
+    // Config edits are picked up once the writes settle
+    if (!m_config.configFile.empty() && m_configWatcher.watch(m_config.configFile)) {
+        m_reloadTimer = m_eventLoop->addTimer([this]() { m_reloadPending = true; });
+        m_eventLoop->addFd(m_configWatcher.getFd(), [this]() {
+            if (m_configWatcher.consumeEvents()) {
+                m_eventLoop->armTimer(m_reloadTimer, Config::CONFIG_RELOAD_DELAY_MS);
+            }
+        });
+    }
 
-                    // Get new device paths
-                    auto devices = m_deviceManager->detectDevices();
-                    if (!devices.first.empty() && !devices.second.empty()) {
-                        // Update device paths
-                        m_config.inputDevice = devices.first;
-                        m_config.serialDevice = devices.second;
+    if (m_config.powerSaveEnabled) {
+        m_powerSaveTimer = m_eventLoop->addTimer([this]() {
+            if (m_moduleDepth == 0) {
+                m_display->checkPowerSaveTimeout();
+            }
+            schedulePowerSave();
+        });
+        schedulePowerSave();
+    }
 
-                        // Create and open new devices
-                        m_inputDevice = std::make_shared<InputDevice>(m_config.inputDevice);
-                        m_baseDisplayDevice = createDisplayDevice(m_config.serialDevice);
+    // Main event loop
+    while (m_running) {
+        // A failed write can precede the udev remove event
+        if (!isI2CMode && m_baseDisplayDevice && m_baseDisplayDevice->isOpen() &&
+            m_baseDisplayDevice->isDisconnected()) {
+            m_deviceManager->forgetDevice();
+            onDeviceDisconnected();
+            continue;
+        }
 
-                        if (m_inputDevice->open() && m_baseDisplayDevice->open()) {
-                            std::cout << "Successfully opened reconnected devices" << std::endl;
+        // Sleep until input, a timer deadline or a wake-up; signals interrupt the wait
+        m_eventLoop->runOnce(-1);
 
-                            // Update display and redraw menu
-                            m_display = std::make_shared<Display>(m_baseDisplayDevice);
-                            if (m_config.powerSaveEnabled) {
-                                m_display->enablePowerSave(true);
-                            }
+        // Modules run nested inside runOnce(), so here the main menu is showing
+        if (m_reloadPending) {
+            reloadConfig();
+        }
+    }
 
-                            // Reinitialize modules with new device handles
-                            initializeModules();
+    if (hotplug) {
+        m_eventLoop->removeFd(m_deviceManager->getMonitorFd());
+        m_eventLoop->removeTimer(m_rescanTimer);
+        m_rescanTimer = -1;
+        m_deviceManager->setHotplugCallbacks(nullptr, nullptr);
+        ScreenModule::setDeviceGuard(nullptr);
+    }
+    if (commands.getFd() >= 0) {
+        m_eventLoop->removeFd(commands.getFd());
+    }
+    m_eventLoop->removeTimer(m_flushTimer);
+    m_flushTimer = -1;
+    if (m_reloadTimer >= 0) {
+        m_eventLoop->removeFd(m_configWatcher.getFd());
+        m_eventLoop->removeTimer(m_reloadTimer);
+        m_reloadTimer = -1;
+        m_configWatcher.stop();
+    }
+    if (m_powerSaveTimer >= 0) {
+        m_eventLoop->removeTimer(m_powerSaveTimer);
+        m_powerSaveTimer = -1;
+    }
+    if (m_statsServer.getFd() >= 0) {
+        m_eventLoop->removeFd(m_statsServer.getFd());
+        m_statsServer.stop();
+    }
+    if (PushServer::getInstance().getFd() >= 0) {
+        m_eventLoop->removeFd(PushServer::getInstance().getFd());
+        PushServer::getInstance().stop();
+    }
+    if (m_textfileJob >= 0) {
+        Scheduler::getInstance().remove(m_textfileJob);
+        m_textfileJob = -1;
+        PerfCounters::getInstance().writeTextfile(m_config.statsTextfile);
+    }
+    m_display->setPowerNotifier(nullptr);
+    Scheduler::getInstance().detach();
+}
 
-                            // Reinitialize menu
-                            m_mainMenu = std::make_shared<Menu>(m_display);
-                            setupMenu();
+void MicroPanel::watchInputDevices()
+{
+    if (m_config.useGPIOMode) {
+        if (!m_multiInputDevice) {
+            return;
+        }
+        for (int fd : m_multiInputDevice->getFds()) {
+            m_eventLoop->addFd(fd, [this]() {
+                // A zero-timeout poll marks which devices are readable
+                if (m_multiInputDevice->waitForEvents(0) > 0) {
+                    m_multiInputDevice->processEvents(m_onInput);
+                }
+                onInputActivity();
+            });
+        }
+    } else if (m_inputDevice && m_inputDevice->isOpen()) {
+        m_eventLoop->addFd(m_inputDevice->getFd(), [this]() {
+            m_inputDevice->processEvents(m_onInput);
+            onInputActivity();
+        });
+    }
+}
 
-                            // Restart the disconnection monitor
-                            m_deviceManager->startDisconnectionMonitor();
+void MicroPanel::onDeviceDisconnected()
+{
+    std::cout << "USB device disconnection detected!" << std::endl;
 
-                            // Continue with the main loop
-                            continue;
-                        } else {
-                            std::cerr << "Failed to open reconnected devices" << std::endl;
-                        }
-                    } else {
-                        std::cerr << "Failed to get device paths after reconnection" << std::endl;
-                    }
-                } else {
-                    std::cerr << "Failed to reconnect to device" << std::endl;
-                }
-            }
+    if (!m_config.autoDetect) {
+        // Fixed device paths: nothing to wait for
+        m_running = false;
+        return;
+    }
 
-            // Exit the loop if reconnection failed or is not enabled
-            break;
-        }
+    if (m_inputDevice && m_inputDevice->isOpen()) {
+        m_eventLoop->removeFd(m_inputDevice->getFd());
+        m_inputDevice->close();
+    }
+    if (m_baseDisplayDevice) {
+        m_baseDisplayDevice->close();
+    }
+    updateVisibility();
 
-        // Process input (handle GPIO vs traditional mode)
-        if (m_config.useGPIOMode) {
-            // Use MultiInputDevice for GPIO mode
-            if (m_multiInputDevice && m_multiInputDevice->waitForEvents(100) > 0) {
-                m_multiInputDevice->processEvents(
-                    [this](int direction) {
-                        // Handle rotation
-                        m_mainMenu->handleRotation(direction);
-                    },
-                    [this]() {
-                        // Handle button press
-                        m_mainMenu->handleButtonPress();
-                    }
-                );
-            }
-        } else {
-            // Use traditional InputDevice
-            if (m_inputDevice->waitForEvents(100) > 0) {
-                m_inputDevice->processEvents(
-                    [this](int direction) {
-                        // Handle rotation
-                        m_mainMenu->handleRotation(direction);
-                    },
-                    [this]() {
-                        // Handle button press
-                        m_mainMenu->handleButtonPress();
-                    }
-                );
-            }
-        }
+    // The add event normally arrives first; the rescan covers systems without udevd
+    m_eventLoop->armTimer(m_rescanTimer, Config::DETECTION_POLL_INTERVAL, Config::DETECTION_POLL_INTERVAL);
+    std::cout << "Waiting for the HMI device to be reconnected..." << std::endl;
+}
 
-        // Check for power save timeout
-        if (m_config.powerSaveEnabled) {
-            m_display->checkPowerSaveTimeout();
-        }
+bool MicroPanel::waitForDevices()
+{
+    // Modules run their own input loop, so hotplug events queue up meanwhile
+    m_deviceManager->processHotplugEvents();
+    if (m_baseDisplayDevice->isOpen() && m_baseDisplayDevice->isDisconnected()) {
+        m_deviceManager->forgetDevice();
+        onDeviceDisconnected();
+    }
+
+    // Unplugged: keep serving hotplug, the rescan timer and command output
+    // until the device is back
+    while (m_running && !(m_inputDevice->isOpen() && m_baseDisplayDevice->isOpen())) {
+        m_eventLoop->runOnce(-1);
+    }
+    return m_running;
+}
 
-        // Update timestamp for periodic operations
-        gettimeofday(&now, nullptr);
+void MicroPanel::onDeviceConnected(const std::string& inputDevice, const std::string& serialDevice)
+{
+    if (!m_config.autoDetect || !m_inputDevice || !m_baseDisplayDevice ||
+        (m_inputDevice->isOpen() && m_baseDisplayDevice->isOpen())) {
+        return;
+    }
 
-        // Calculate time since last buffer flush
-        long timeSinceFlush = (now.tv_sec - lastBufferFlush.tv_sec) * 1000 +
-                             (now.tv_usec - lastBufferFlush.tv_usec) / 1000;
+    // Same objects, new nodes: Display, menu and modules keep their handles
+    m_config.inputDevice = inputDevice;
+    m_config.serialDevice = serialDevice;
+    m_inputDevice->setDevicePath(inputDevice);
+    m_baseDisplayDevice->setDevicePath(serialDevice);
 
-        // Flush command buffer at regular intervals - only for devices that support buffering
-        if (timeSinceFlush > Config::CMD_BUFFER_FLUSH_INTERVAL) {
-            // Only flush buffer for serial devices, I2C doesn't use buffering
-            if (m_baseDisplayDevice && !isI2CMode) {
-                m_baseDisplayDevice->flushBuffer();
-            }
-            lastBufferFlush = now;
-        }
+    if (!m_inputDevice->open() || !m_baseDisplayDevice->open()) {
+        std::cerr << "Failed to open reconnected devices" << std::endl;
+        m_inputDevice->close();
+        m_baseDisplayDevice->close();
+        m_deviceManager->forgetDevice();
+        return;
+    }
+    m_eventLoop->disarmTimer(m_rescanTimer);
+    std::cout << "Successfully reconnected to device!" << std::endl;
+
+    // Whatever screen is current (menu or a running module) comes back as it was
+    m_display->repaint();
+    updateVisibility();
+
+    watchInputDevices();
+    scheduleFlush();
+    schedulePowerSave();
+}
 
-        // Short delay to reduce CPU usage
-        usleep(Config::MAIN_LOOP_DELAY);
+void MicroPanel::onInputActivity()
+{
+    scheduleFlush();
+    schedulePowerSave();
+}
+
+void MicroPanel::scheduleFlush()
+{
+    if (m_flushTimer >= 0 && !m_eventLoop->isTimerArmed(m_flushTimer)) {
+        m_eventLoop->armTimer(m_flushTimer, Config::CMD_BUFFER_FLUSH_INTERVAL);
     }
 }
 
-void MicroPanel::shutdown()
+void MicroPanel::updateVisibility()
 {
-    // Stop disconnection monitor - only if it was started
-    bool isI2CMode = (m_config.serialDevice.find("/dev/i2c-") == 0);
-    if (!isI2CMode) {
-        m_deviceManager->stopDisconnectionMonitor();
+    // Unplugged counts as dark: nothing drawn now would reach the panel
+    bool connected = m_baseDisplayDevice && m_baseDisplayDevice->isOpen() && !m_baseDisplayDevice->isDisconnected();
+    Scheduler::getInstance().setVisible(connected && m_display->isPoweredOn());
+}
+
+void MicroPanel::schedulePowerSave()
+{
+    if (m_powerSaveTimer < 0) {
+        return;
+    }
+
+    // Nothing to time out while a module runs or the display is already off;
+    // the next input rearms the deadline
+    if (m_moduleDepth > 0 || !m_display->isPoweredOn()) {
+        m_eventLoop->disarmTimer(m_powerSaveTimer);
+        return;
     }
 
+    m_eventLoop->armTimer(m_powerSaveTimer, m_display->getPowerSaveRemainingMs());
+}
+
+void MicroPanel::shutdown()
+{
     // Display shutdown message
     if (m_display && m_baseDisplayDevice && m_baseDisplayDevice->isOpen()) {
         m_display->clear();
@@ -845,6 +1340,10 @@ void MicroPanel::shutdown()
     // Clear module registry
     m_modules.clear();
 
+    // Write out anything the modules saved on the way down
+    PersistentStorage::getInstance().shutdown();
+    HistoryLog::getInstance().close();
+
     // Clear menu
     if (m_mainMenu) {
         m_mainMenu->clear();
@@ -853,22 +1352,6 @@ void MicroPanel::shutdown()
     std::cout << "MicroPanel shutdown complete" << std::endl;
 }
 
-// Main entry point
-int main(int argc, char* argv[])
-{
-    MicroPanel app(argc, argv);
-
-    if (!app.initialize()) {
-        return EXIT_FAILURE;
-    }
-
-    app.run();
-    app.shutdown();
-
-    return EXIT_SUCCESS;
-}
-
-
 // Initialize persistent storage
 bool MicroPanel::initPersistentStorage() {
     if (m_config.persistentDataFile.empty()) {
@@ -876,26 +1359,24 @@ bool MicroPanel::initPersistentStorage() {
         return false;
     }
 
+    PersistentStorage::Options options;
+    options.fsync = m_config.persistentFsync;
+    options.journal = m_config.persistentJournal;
+
     auto& storage = PersistentStorage::getInstance();
-    return storage.initialize(m_config.persistentDataFile);
+    return storage.initialize(m_config.persistentDataFile, options);
 }
 
 // Load module dependencies from JSON configuration
 bool MicroPanel::loadModuleDependencies() {
-    try {
-        // Open the file
-        std::ifstream configFile(m_config.configFile);
-        if (!configFile.is_open()) {
-            Logger::error("Could not open config file: " + m_config.configFile);
-            return false;
-        }
-
-        // Parse JSON
-        json config = json::parse(configFile);
+    if (!m_configModel) {
+        return false;
+    }
 
+    try {
         // Load dependencies
         auto& dependencies = ModuleDependency::getInstance();
-        return dependencies.loadDependencies(config);
+        return dependencies.loadDependencies(*m_configModel);
     } catch (const std::exception& e) {
         Logger::error("Error loading module dependencies: " + std::string(e.what()));
         return false;
@@ -904,127 +1385,43 @@ bool MicroPanel::loadModuleDependencies() {
 
 
 void MicroPanel::runModuleWithGPIOInput(std::shared_ptr<ScreenModule> module) {
-    Logger::debug("Running module with GPIO input...");
-
-    // Check what type of module this is
-    auto menuModule = std::dynamic_pointer_cast<MenuScreenModule>(module);
-    auto brightnessModule = std::dynamic_pointer_cast<BrightnessScreen>(module);
-    auto netInfoModule = std::dynamic_pointer_cast<NetInfoScreen>(module);
-    auto pingModule = std::dynamic_pointer_cast<IPPingScreen>(module);
-    auto netSettingsModule = std::dynamic_pointer_cast<NetSettingsScreen>(module);
-    auto wifiSettingsModule = std::dynamic_pointer_cast<WiFiSettingsScreen>(module);
-    auto textboxModule = std::dynamic_pointer_cast<TextBoxScreen>(module);
-
-    if (menuModule) {
-        Logger::debug("Module type: MenuScreenModule (ID: " + menuModule->getModuleId() + ")");
-    } else if (brightnessModule) {
-        Logger::debug("Module type: BrightnessScreen");
-    } else if (netInfoModule) {
-        Logger::debug("Module type: NetInfoScreen");
-    } else if (pingModule) {
-        Logger::debug("Module type: IPPingScreen");
-    } else if (netSettingsModule) {
-        Logger::debug("Module type: NetSettingsScreen");
-    } else if (wifiSettingsModule) {
-        Logger::debug("Module type: WiFiSettingsScreen");
-    } else if (textboxModule) {
-        Logger::debug("Module type: TextBoxScreen (ID: " + textboxModule->getModuleId() + ")");
-    } else {
-        Logger::debug("Module type: Generic ScreenModule");
-    }
+    LOG_DEBUG("Running module with GPIO input: " + module->getModuleId());
 
     // Enter the module
-    Logger::debug("Entering module...");
+    LOG_DEBUG("Entering module...");
     module->enter();
-    Logger::debug("Module entered successfully");
+    LOG_DEBUG("Module entered successfully");
 
     bool moduleRunning = true;
     int loopCount = 0;
 
+    // Route input to this module until it exits; nested modules save and
+    // restore the same way
+    InputHandler savedInput = m_onInput;
+    m_moduleDepth++;
+    schedulePowerSave();
+
+    m_onInput = [&](const InputEvent& event) {
+        if (moduleRunning && !module->handleInputEvent(event)) {
+            LOG_DEBUG("Module " + module->getModuleId() + " finished on input");
+            moduleRunning = false;
+        }
+    };
+
+    // Modules keep their own refresh timing, so give them a regular tick
+    // while nothing else is happening; the run itself is the wakeup
+    Scheduler& scheduler = Scheduler::getInstance();
+    int refreshJob = scheduler.add("module " + module->getModuleId(), Config::MODULE_REFRESH_INTERVAL,
+                                   Scheduler::Cost::LIGHT, true, []() {});
+
     while (moduleRunning && m_running) {
         loopCount++;
         if (loopCount % 100 == 0) {  // Log every 100 loops to avoid spam
-            Logger::debug("Module loop: " + std::to_string(loopCount));
+            LOG_DEBUG("Module loop: " + std::to_string(loopCount));
         }
 
-        // Process GPIO input
-        if (m_multiInputDevice && m_multiInputDevice->waitForEvents(100) > 0) {
-            m_multiInputDevice->processEvents(
-                [&](int direction) {
-                    Logger::debug("GPIO rotation in module: " + std::to_string(direction));
-                    simulateRotationForModule(module, direction);
-                },
-                [&]() {
-                    Logger::debug("GPIO button press in module");
-
-                    // Handle button press differently for different module types
-                    if (menuModule) {
-                        // For menu modules, simulate button press to trigger menu selection
-                        Logger::debug("Processing menu button press");
-                        simulateButtonPressForModule(module, moduleRunning);
-                    } else if (netInfoModule) {
-                        // For NetInfoScreen, use its GPIO button handler
-                        Logger::debug("Processing NetInfoScreen button press");
-                        if (!netInfoModule->handleGPIOButtonPress()) {
-                            moduleRunning = false;
-                        }
-                    } else if (pingModule) {
-                        Logger::debug("Processing IPPingScreen button press");
-                        if (!pingModule->handleGPIOButtonPress()) {
-                            moduleRunning = false;
-                        }
-                    } else if (netSettingsModule) {
-                        Logger::debug("Processing NetSettingsScreen button press");
-                        if (!netSettingsModule->handleGPIOButtonPress()) {
-                            moduleRunning = false;
-                        }
-                    } else if (wifiSettingsModule) {
-                        Logger::debug("Processing WiFiSettingsScreen button press");
-                        if (!wifiSettingsModule->handleGPIOButtonPress()) {
-                            moduleRunning = false;
-                        }
-                    } else if (textboxModule) {
-                        Logger::debug("Processing TextBoxScreen button press");
-                        if (!textboxModule->handleGPIOButtonPress()) {
-                            moduleRunning = false;
-                        }
-                    } else {
-                        // Check for ThroughputServerScreen
-                        auto throughputServerModule = std::dynamic_pointer_cast<ThroughputServerScreen>(module);
-                        if (throughputServerModule) {
-                            Logger::debug("Processing ThroughputServerScreen button press");
-                            if (!throughputServerModule->handleGPIOButtonPress()) {
-                                moduleRunning = false;
-                            }
-                        }
-                        // Check for ThroughputClientScreen
-                        else {
-                            auto throughputClientModule = std::dynamic_pointer_cast<ThroughputClientScreen>(module);
-                            if (throughputClientModule) {
-                                Logger::debug("Processing ThroughputClientScreen button press");
-                                if (!throughputClientModule->handleGPIOButtonPress()) {
-                                    moduleRunning = false;
-                                }
-                            }
-                            // For non-menu modules, check if it's GenericListScreen
-                            else {
-                                auto genericListModule = std::dynamic_pointer_cast<GenericListScreen>(module);
-                                if (genericListModule) {
-                                    Logger::debug("Processing GenericListScreen button press");
-                                    if (!genericListModule->handleGPIOButtonPress()) {
-                                        moduleRunning = false;
-                                    }
-                                } else {
-                                    // For other non-menu modules, button press exits
-                                    Logger::debug("Exiting non-menu module");
-                                    moduleRunning = false;
-                                }
-                            }
-                        }
-                    }
-                }
-            );
-        }
+        // Sleep until GPIO input, the refresh tick or a redraw request
+        m_eventLoop->runOnce(-1);
 
         // Update the module (this is important for display updates)
         try {
@@ -1034,169 +1431,29 @@ void MicroPanel::runModuleWithGPIOInput(std::shared_ptr<ScreenModule> module) {
             moduleRunning = false;
         }
 
-        // For TextBoxScreen, also call handleInput() to enable periodic refresh
-        if (textboxModule) {
-            try {
-                if (!textboxModule->handleInput()) {
-                    moduleRunning = false;
-                }
-            } catch (const std::exception& e) {
-                std::cout << "Exception in TextBoxScreen handleInput: " << e.what() << std::endl;
-                moduleRunning = false;
-            }
-        }
-
-        // Small delay
-        usleep(Config::MAIN_LOOP_DELAY);
+        // Send the composed frame in framebuffer mode
+        m_display->present();
     }
 
+    scheduler.remove(refreshJob);
+    m_onInput = savedInput;
+    m_moduleDepth--;
+    schedulePowerSave();
+
     // Exit the module
-    Logger::debug("Exiting module...");
+    LOG_DEBUG("Exiting module...");
     module->exit();
-    Logger::debug("Module exited successfully");
+    LOG_DEBUG("Module exited successfully");
 }
 
-// NEW: Helper method to simulate rotation for different module types
-void MicroPanel::simulateRotationForModule(std::shared_ptr<ScreenModule> module, int direction) {
-    // Check for IPPingScreen
-    auto pingModule = std::dynamic_pointer_cast<IPPingScreen>(module);
-    if (pingModule) {
-       Logger::debug("SUCCESS: IPPingScreen - calling handleGPIORotation");
-       pingModule->handleGPIORotation(direction);
-       return;
-    }
-
-    // Check for NetInfoScreen
-    auto netInfoModule = std::dynamic_pointer_cast<NetInfoScreen>(module);
-    if (netInfoModule) {
-       Logger::debug("SUCCESS: NetInfoScreen - calling handleGPIORotation");
-       netInfoModule->handleGPIORotation(direction);
-       return;
-    }
-
-    // Handle MenuScreenModule - this covers ALL menu-type modules!
-    auto menuModule = std::dynamic_pointer_cast<MenuScreenModule>(module);
-    if (menuModule) {
-        Logger::debug("Navigating menu: " + std::to_string(direction));
-        menuModule->handleGPIORotation(direction);  // This will actually work now!
-        return;
-    }
-
-    // For BrightnessScreen - adjust brightness directly
-    auto brightnessModule = std::dynamic_pointer_cast<BrightnessScreen>(module);
-    if (brightnessModule) {
-        Logger::debug("Adjusting brightness: " + std::to_string(direction));
-        int currentBrightness = m_display->getBrightness();
-
-        if (direction < 0) {
-            // Decrease brightness (UP button)
-            currentBrightness -= 10;
-            if (currentBrightness < 0) currentBrightness = 0;
-        } else {
-            // Increase brightness (DOWN button)
-            currentBrightness += 10;
-            if (currentBrightness > 255) currentBrightness = 255;
-        }
-
-        // Calculate percentage (0-255 -> 0-100%)
-        int percentage = (currentBrightness * 100) / 255;
-
-        // Clear the previous text area first
-        m_display->drawText(50, 20, "    ");
-        usleep(Config::DISPLAY_CMD_DELAY);
-
-        // Format and draw new value
-        char text[16];
-        snprintf(text, sizeof(text), "%d%%", percentage);
-        m_display->drawText(50, 20, text);
-        usleep(Config::DISPLAY_CMD_DELAY);
-
-        // Update progress bar
-        m_display->drawProgressBar(10, 30, 108, 15, percentage);
-
-        // Set the actual display brightness
-        m_display->setBrightness(currentBrightness);
-
-        return;
-    }
-
-    // Add support for ThroughputServerScreen
-    auto throughputServerModule = std::dynamic_pointer_cast<ThroughputServerScreen>(module);
-    if (throughputServerModule) {
-        Logger::debug("SUCCESS: ThroughputServerScreen - calling handleGPIORotation");
-        throughputServerModule->handleGPIORotation(direction);
-        return;
-    }
-
-    // Add support for ThroughputClientScreen
-    auto throughputClientModule = std::dynamic_pointer_cast<ThroughputClientScreen>(module);
-    if (throughputClientModule) {
-        Logger::debug("SUCCESS: ThroughputClientScreen - calling handleGPIORotation");
-        throughputClientModule->handleGPIORotation(direction);
-        return;
-    }
-
-    // Add support for NetSettingsScreen
-    auto netSettingsModule = std::dynamic_pointer_cast<NetSettingsScreen>(module);
-    if (netSettingsModule) {
-        Logger::debug("SUCCESS: NetSettingsScreen - calling handleGPIORotation");
-        netSettingsModule->handleGPIORotation(direction);
-        return;
-    }
-
-    // Add support for WiFiSettingsScreen
-    auto wifiSettingsModule = std::dynamic_pointer_cast<WiFiSettingsScreen>(module);
-    if (wifiSettingsModule) {
-        Logger::debug("SUCCESS: WiFiSettingsScreen - calling handleGPIORotation");
-        wifiSettingsModule->handleGPIORotation(direction);
-        return;
-    }
-
-    // Add support for GenericListScreen modules (insert before the default case)
-    auto genericListModule = std::dynamic_pointer_cast<GenericListScreen>(module);
-    if (genericListModule) {
-       Logger::debug("Navigating GenericListScreen: " + std::to_string(direction));
-       genericListModule->handleGPIORotation(direction);
-       return;
-    }
-}
-void MicroPanel::simulateButtonPressForModule(std::shared_ptr<ScreenModule> module, bool& moduleRunning) {
-    // Check for NetInfoScreen first
-    auto netInfoModule = std::dynamic_pointer_cast<NetInfoScreen>(module);
-    if (netInfoModule) {
-        std::cout << "NetInfoScreen button press - handling selection" << std::endl;
-        if (!netInfoModule->handleGPIOButtonPress()) {
-            moduleRunning = false; // Exit if method returns false
-        }
-        return;
-    }
-
-    auto menuModule = std::dynamic_pointer_cast<MenuScreenModule>(module);
-    if (menuModule) {
-        Logger::debug("Simulating menu button press - selecting menu item");
-        if (!menuModule->handleGPIOButtonPress()) {
-            moduleRunning = false; // Exit if menu returns false
-        }
-        return;
-    }
-
-    auto genericListModule = std::dynamic_pointer_cast<GenericListScreen>(module);
-    if (genericListModule) {
-        std::cout << "GenericListScreen button press - selecting item" << std::endl;
-        if (!genericListModule->handleGPIOButtonPress()) {
-            // If the method returns false, exit the module
-            moduleRunning = false;
-        }
-        return;
-    }
-
-    // For other module types, button press typically exits
-    std::cout << "Button press for non-menu module" << std::endl;
-    moduleRunning = false;
-}
 std::shared_ptr<BaseDisplayDevice> MicroPanel::createDisplayDevice(const std::string& devicePath) {
     std::cout << "Creating display device for: " << devicePath << std::endl;
 
+    if (VirtualDisplayDevice::isVirtualPath(devicePath)) {
+        std::cout << "Using virtual display device" << std::endl;
+        return std::make_shared<VirtualDisplayDevice>(devicePath);
+    }
+
     // Detect device type based on path
     if (devicePath.find("/dev/i2c-") == 0) {
         //std::cout << "I2C display detected but not yet implemented: " << devicePath << std::endl;
@@ -1205,16 +1462,26 @@ std::shared_ptr<BaseDisplayDevice> MicroPanel::createDisplayDevice(const std::st
 
         // I2C device path detected
         std::cout << "Detected I2C display device: " << devicePath << std::endl;
-        return std::make_shared<I2CDisplayDevice>(devicePath);
+        auto i2cDevice = std::make_shared<I2CDisplayDevice>(devicePath);
+        if (m_config.frameBufferMode) {
+            i2cDevice->setFrameBufferEnabled(true);
+        }
+        return i2cDevice;
     }
     else if (devicePath.find("/dev/ttyACM") == 0 || devicePath.find("/dev/ttyUSB") == 0) {
         // Serial device path detected
         std::cout << "Detected serial display device: " << devicePath << std::endl;
-        return std::make_shared<DisplayDevice>(devicePath);
     }
     else {
         // Default to serial for backward compatibility
         std::cout << "Unknown device type, defaulting to serial: " << devicePath << std::endl;
-        return std::make_shared<DisplayDevice>(devicePath);
     }
+
+    auto device = std::make_shared<DisplayDevice>(devicePath);
+    if (m_config.blitMode) {
+        device->setBlitMode(true);
+    } else if (m_config.frameBufferMode) {
+        device->setFrameBufferEnabled(true);
+    }
+    return device;
 }
@@ -0,0 +1,109 @@
+#include "ModuleCatalog.h"
+#include "Logger.h"
+#include <algorithm>
+#include <dirent.h>
+#include <dlfcn.h>
+
+namespace {
+    constexpr const char* PLUGIN_SUFFIX = ".so";
+}
+
+ModuleCatalog::Registration::Registration(const char* id, Factory factory)
+{
+    // Runs during static initialization (or dlopen()): no logging here
+    ModuleCatalog::getInstance().add(id, std::move(factory));
+}
+
+ModuleCatalog& ModuleCatalog::getInstance()
+{
+    static ModuleCatalog instance;
+    return instance;
+}
+
+void ModuleCatalog::add(const std::string& id, Factory factory)
+{
+    m_factories[id] = std::move(factory);
+    m_plugins.erase(id);
+}
+
+size_t ModuleCatalog::scanPlugins(const std::string& dir)
+{
+    DIR* handle = opendir(dir.c_str());
+    if (!handle) {
+        return 0;
+    }
+
+    size_t found = 0;
+    const std::string suffix = PLUGIN_SUFFIX;
+    while (struct dirent* entry = readdir(handle)) {
+        std::string name = entry->d_name;
+        if (name.size() <= suffix.size() || name.compare(name.size() - suffix.size(), suffix.size(), suffix) != 0) {
+            continue;
+        }
+        std::string id = name.substr(0, name.size() - suffix.size());
+        if (m_factories.count(id)) {
+            LOG_DEBUG("ModuleCatalog: " + id + " is built in, ignoring " + dir + "/" + name);
+            continue;
+        }
+        m_plugins[id] = dir + "/" + name;
+        found++;
+    }
+    closedir(handle);
+
+    if (found) {
+        LOG_DEBUG("ModuleCatalog: " + std::to_string(found) + " plugins in " + dir);
+    }
+    return found;
+}
+
+std::vector<std::string> ModuleCatalog::ids() const
+{
+    std::vector<std::string> ids;
+    ids.reserve(m_factories.size() + m_plugins.size());
+    for (const auto& entry : m_factories) {
+        ids.push_back(entry.first);
+    }
+    for (const auto& entry : m_plugins) {
+        ids.push_back(entry.first);
+    }
+    std::sort(ids.begin(), ids.end());
+    return ids;
+}
+
+bool ModuleCatalog::contains(const std::string& id) const
+{
+    return m_factories.count(id) > 0 || m_plugins.count(id) > 0;
+}
+
+ModuleCatalog::Factory ModuleCatalog::factory(const std::string& id)
+{
+    auto plugin = m_plugins.find(id);
+    if (plugin != m_plugins.end()) {
+        std::string path = plugin->second;
+        if (!load(id, path)) {
+            return nullptr;
+        }
+    }
+
+    auto it = m_factories.find(id);
+    return it != m_factories.end() ? it->second : nullptr;
+}
+
+bool ModuleCatalog::load(const std::string& id, const std::string& path)
+{
+    // Stays loaded: screens built from it live as long as the registry
+    void* handle = dlopen(path.c_str(), RTLD_NOW | RTLD_LOCAL);
+    if (!handle) {
+        const char* error = dlerror();
+        Logger::error("ModuleCatalog: cannot load " + path + ": " + (error ? error : "unknown error"));
+        return false;
+    }
+    if (!m_factories.count(id)) {
+        Logger::error("ModuleCatalog: " + path + " does not register module " + id);
+        dlclose(handle);
+        m_plugins.erase(id);
+        return false;
+    }
+    Logger::info("ModuleCatalog: loaded plugin " + path);
+    return true;
+}
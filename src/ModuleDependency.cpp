@@ -45,7 +45,7 @@ bool ModuleDependency::loadDependencies(const nlohmann::json& config) {
                         
                         // Store dependency
                         m_dependencies[moduleId][key] = path;
-                        Logger::debug("Registered dependency for " + moduleId + ": " + key + " -> " + path);
+                        LOG_DEBUG("Registered dependency for " + moduleId + ": " + key + " -> " + path);
                     } else {
                         Logger::warning("Ignoring non-string dependency '" + key + "' for module " + moduleId);
                     }
@@ -53,7 +53,7 @@ bool ModuleDependency::loadDependencies(const nlohmann::json& config) {
             }
         }
         
-        Logger::debug("Module dependencies loaded successfully");
+        LOG_DEBUG("Module dependencies loaded successfully");
         return true;
     } catch (const std::exception& e) {
         Logger::error("Error loading module dependencies: " + std::string(e.what()));
@@ -119,7 +119,7 @@ bool ModuleDependency::checkDependencies(const std::string& moduleId) {
 
         // Skip URL dependencies (http:// or https://)
         if (path.substr(0, 7) == "http://" || path.substr(0, 8) == "https://") {
-            Logger::debug("Skipping URL dependency check for: " + path);
+            LOG_DEBUG("Skipping URL dependency check for: " + path);
             continue;
         }
 
@@ -140,5 +140,5 @@ bool ModuleDependency::shouldSkipDependencyCheck(const std::string& moduleId) {
 
 void ModuleDependency::addDependency(const std::string& moduleId, const std::string& dependencyKey, const std::string& dependencyPath) {
     m_dependencies[moduleId][dependencyKey] = dependencyPath;
-    Logger::debug("Added dynamic dependency for " + moduleId + ": " + dependencyKey + " -> " + dependencyPath);
+    LOG_DEBUG("Added dynamic dependency for " + moduleId + ": " + dependencyKey + " -> " + dependencyPath);
 }
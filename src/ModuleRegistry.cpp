@@ -0,0 +1,38 @@
+#include "ModuleRegistry.h"
+#include "ScreenModules.h"
+#include "Logger.h"
+
+void ModuleRegistry::add(const std::string& id, Factory factory)
+{
+    Entry& entry = m_entries[id];
+    entry.factory = std::move(factory);
+    entry.module.reset();
+}
+
+void ModuleRegistry::add(const std::string& id, std::shared_ptr<ScreenModule> module)
+{
+    Entry& entry = m_entries[id];
+    entry.factory = nullptr;
+    entry.module = std::move(module);
+}
+
+std::shared_ptr<ScreenModule> ModuleRegistry::get(const std::string& id)
+{
+    auto it = m_entries.find(id);
+    if (it == m_entries.end()) {
+        return nullptr;
+    }
+
+    Entry& entry = it->second;
+    if (!entry.module && entry.factory) {
+        LOG_DEBUG("Constructing module on first use: " + id);
+        entry.module = entry.factory();
+    }
+    return entry.module;
+}
+
+std::shared_ptr<ScreenModule> ModuleRegistry::find(const std::string& id) const
+{
+    auto it = m_entries.find(id);
+    return it == m_entries.end() ? nullptr : it->second.module;
+}
@@ -0,0 +1,246 @@
+#include "PerfCounters.h"
+#include "Config.h"
+#include <cmath>
+#include <cstdio>
+#include <ctime>
+#include <fstream>
+#include <sstream>
+
+namespace {
+    const char* const COUNTER_NAMES[] = {
+        "input_events",
+        "frames",
+        "serial_bytes",
+        "serial_writes",
+        "serial_partial_writes",
+        "serial_dropped_frames",
+        "serial_merged_frames",
+        "i2c_transactions",
+        "i2c_bytes",
+        "i2c_errors",
+        "child_processes",
+        "storage_saves",
+        "storage_save_failures",
+        "push_messages",
+        "push_rejected",
+    };
+    static_assert(sizeof(COUNTER_NAMES) / sizeof(COUNTER_NAMES[0]) ==
+                  static_cast<size_t>(PerfCounters::Counter::COUNT), "counter names");
+
+    const char* const HISTOGRAM_NAMES[] = {
+        "input_to_flush",
+        "frame_render",
+        "serial_write",
+        "storage_save",
+    };
+    static_assert(sizeof(HISTOGRAM_NAMES) / sizeof(HISTOGRAM_NAMES[0]) ==
+                  static_cast<size_t>(PerfCounters::Histogram::COUNT), "histogram names");
+
+    const double QUANTILES[] = {0.5, 0.9, 0.99};
+}
+
+LatencyHistogram::LatencyHistogram()
+{
+    for (auto& bucket : m_buckets) {
+        bucket.store(0, std::memory_order_relaxed);
+    }
+    m_sum.store(0, std::memory_order_relaxed);
+    m_max.store(0, std::memory_order_relaxed);
+}
+
+int LatencyHistogram::bucketFor(uint64_t value)
+{
+    if (value >= (uint64_t(1) << MAX_BITS)) {
+        value = (uint64_t(1) << MAX_BITS) - 1;
+    }
+    if (value < SUB_BUCKETS) {
+        return static_cast<int>(value);
+    }
+
+    // The top SUB_BITS bits below the leading one pick the sub-bucket
+    int msb = 63 - __builtin_clzll(value);
+    int shift = msb - SUB_BITS;
+    return (shift + 1) * SUB_BUCKETS + static_cast<int>((value >> shift) & (SUB_BUCKETS - 1));
+}
+
+uint64_t LatencyHistogram::bucketUpperBound(int bucket)
+{
+    if (bucket < SUB_BUCKETS) {
+        return static_cast<uint64_t>(bucket);
+    }
+    int shift = bucket / SUB_BUCKETS - 1;
+    uint64_t lower = static_cast<uint64_t>(SUB_BUCKETS + bucket % SUB_BUCKETS) << shift;
+    return lower + (uint64_t(1) << shift) - 1;
+}
+
+void LatencyHistogram::record(uint64_t value)
+{
+    m_buckets[bucketFor(value)].fetch_add(1, std::memory_order_relaxed);
+    m_sum.fetch_add(value, std::memory_order_relaxed);
+
+    uint64_t max = m_max.load(std::memory_order_relaxed);
+    while (value > max && !m_max.compare_exchange_weak(max, value, std::memory_order_relaxed)) {
+    }
+}
+
+LatencyHistogram::Snapshot LatencyHistogram::snapshot() const
+{
+    Snapshot snapshot;
+    for (int i = 0; i < BUCKETS; i++) {
+        snapshot.buckets[i] = m_buckets[i].load(std::memory_order_relaxed);
+        snapshot.count += snapshot.buckets[i];
+    }
+    snapshot.sum = m_sum.load(std::memory_order_relaxed);
+    snapshot.max = m_max.load(std::memory_order_relaxed);
+    return snapshot;
+}
+
+uint64_t LatencyHistogram::Snapshot::percentile(double p) const
+{
+    if (count == 0) {
+        return 0;
+    }
+
+    uint64_t rank = static_cast<uint64_t>(std::ceil(p * count));
+    if (rank == 0) {
+        rank = 1;
+    }
+    uint64_t seen = 0;
+    for (int i = 0; i < BUCKETS; i++) {
+        seen += buckets[i];
+        if (seen >= rank) {
+            uint64_t bound = bucketUpperBound(i);
+            return bound < max ? bound : max;
+        }
+    }
+    return max;
+}
+
+PerfCounters& PerfCounters::getInstance()
+{
+    static PerfCounters instance;
+    return instance;
+}
+
+PerfCounters::PerfCounters()
+    : m_startUs(nowUs())
+{
+    for (auto& counter : m_counters) {
+        counter.store(0, std::memory_order_relaxed);
+    }
+}
+
+int64_t PerfCounters::nowUs()
+{
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec * 1000000LL + ts.tv_nsec / 1000;
+}
+
+int64_t PerfCounters::wallUs(const struct timeval& time)
+{
+    return time.tv_sec * 1000000LL + time.tv_usec;
+}
+
+const char* PerfCounters::name(Counter counter)
+{
+    return COUNTER_NAMES[static_cast<int>(counter)];
+}
+
+const char* PerfCounters::name(Histogram histogram)
+{
+    return HISTOGRAM_NAMES[static_cast<int>(histogram)];
+}
+
+void PerfCounters::markInput(const struct timeval& kernelTime)
+{
+    add(Counter::INPUT_EVENTS);
+
+    int64_t none = 0;
+    m_pendingInputUs.compare_exchange_strong(none, wallUs(kernelTime), std::memory_order_relaxed);
+}
+
+void PerfCounters::frameFlushed()
+{
+    add(Counter::FRAMES);
+
+    int64_t inputUs = m_pendingInputUs.exchange(0, std::memory_order_relaxed);
+    if (inputUs == 0) {
+        return;
+    }
+
+    // Input timestamps are wall clock; skip spans broken by a clock step
+    struct timeval now;
+    gettimeofday(&now, nullptr);
+    int64_t latencyUs = wallUs(now) - inputUs;
+    if (latencyUs >= 0 && latencyUs <= Config::PERF_MAX_INPUT_LATENCY_MS * 1000LL) {
+        record(Histogram::INPUT_TO_FLUSH, static_cast<uint64_t>(latencyUs));
+    }
+}
+
+std::string PerfCounters::report() const
+{
+    std::ostringstream out;
+    out << "uptime_s=" << (nowUs() - m_startUs) / 1000000 << "\n";
+    for (int i = 0; i < static_cast<int>(Counter::COUNT); i++) {
+        out << COUNTER_NAMES[i] << "=" << m_counters[i].load(std::memory_order_relaxed) << "\n";
+    }
+
+    for (int i = 0; i < static_cast<int>(Histogram::COUNT); i++) {
+        LatencyHistogram::Snapshot histogram = m_histograms[i].snapshot();
+        std::string prefix = std::string(HISTOGRAM_NAMES[i]) + "_us_";
+        out << prefix << "count=" << histogram.count << "\n"
+            << prefix << "p50=" << histogram.percentile(0.5) << "\n"
+            << prefix << "p90=" << histogram.percentile(0.9) << "\n"
+            << prefix << "p99=" << histogram.percentile(0.99) << "\n"
+            << prefix << "max=" << histogram.max << "\n"
+            << prefix << "mean=" << static_cast<uint64_t>(histogram.mean()) << "\n";
+    }
+    return out.str();
+}
+
+std::string PerfCounters::prometheus() const
+{
+    std::ostringstream out;
+    out << "# TYPE micropanel_uptime_seconds gauge\n"
+        << "micropanel_uptime_seconds " << (nowUs() - m_startUs) / 1000000 << "\n";
+
+    for (int i = 0; i < static_cast<int>(Counter::COUNT); i++) {
+        std::string metric = std::string("micropanel_") + COUNTER_NAMES[i] + "_total";
+        out << "# TYPE " << metric << " counter\n"
+            << metric << " " << m_counters[i].load(std::memory_order_relaxed) << "\n";
+    }
+
+    for (int i = 0; i < static_cast<int>(Histogram::COUNT); i++) {
+        LatencyHistogram::Snapshot histogram = m_histograms[i].snapshot();
+        std::string metric = std::string("micropanel_") + HISTOGRAM_NAMES[i] + "_seconds";
+        out << "# TYPE " << metric << " summary\n";
+        for (double quantile : QUANTILES) {
+            out << metric << "{quantile=\"" << quantile << "\"} " << histogram.percentile(quantile) / 1e6 << "\n";
+        }
+        out << metric << "_sum " << histogram.sum / 1e6 << "\n"
+            << metric << "_count " << histogram.count << "\n";
+    }
+    return out.str();
+}
+
+bool PerfCounters::writeTextfile(const std::string& path) const
+{
+    // The collector may read at any time, so never expose a partial file
+    std::string temporary = path + ".tmp";
+    {
+        std::ofstream file(temporary);
+        if (!file) {
+            return false;
+        }
+        file << prometheus();
+        if (!file) {
+            return false;
+        }
+    }
+    if (std::rename(temporary.c_str(), path.c_str()) != 0) {
+        std::remove(temporary.c_str());
+        return false;
+    }
+    return true;
+}
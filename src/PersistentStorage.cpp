@@ -1,9 +1,13 @@
 #include "PersistentStorage.h"
 #include "Logger.h"
+#include "Config.h"
+#include "PerfCounters.h"
 #include <fstream>
 #include <iostream>
-#include <thread>
+#include <sstream>
 #include <chrono>
+#include <cerrno>
+#include <fcntl.h>
 #include <sys/stat.h>
 #include <unistd.h>
 #include <string.h>
@@ -40,6 +44,29 @@ bool renameFile(const std::string& oldPath, const std::string& newPath) {
     return rename(oldPath.c_str(), newPath.c_str()) == 0;
 }
 
+// Helper function to write a whole buffer to a descriptor
+bool writeAll(int fd, const std::string& data) {
+    size_t written = 0;
+    while (written < data.size()) {
+        ssize_t n = write(fd, data.data() + written, data.size() - written);
+        if (n < 0) {
+            if (errno == EINTR) continue;
+            return false;
+        }
+        written += static_cast<size_t>(n);
+    }
+    return true;
+}
+
+// Helper function to make a rename durable
+void syncDirectory(const std::string& path) {
+    int fd = open(getParentPath(path).c_str(), O_RDONLY | O_DIRECTORY | O_CLOEXEC);
+    if (fd >= 0) {
+        fsync(fd);
+        close(fd);
+    }
+}
+
 // Static instance for singleton
 PersistentStorage& PersistentStorage::getInstance() {
     static PersistentStorage instance;
@@ -47,19 +74,28 @@ PersistentStorage& PersistentStorage::getInstance() {
 }
 
 PersistentStorage::PersistentStorage() 
-    : m_initialized(false), m_isDirty(false), m_savePending(false) {
+    : m_initialized(false), m_isDirty(false) {
     // Nothing to do in constructor
 }
 
 PersistentStorage::~PersistentStorage() {
     // Ensure pending changes are saved when object is destroyed
-    if (m_isDirty && m_initialized) {
-        saveToFile();
-    }
+    shutdown();
 }
 
 bool PersistentStorage::initialize(const std::string& filePath) {
-    std::lock_guard<std::mutex> lock(m_mutex);
+    // Keep the current write options when re-initializing
+    return initialize(filePath, m_initialized ? m_options : Options());
+}
+
+bool PersistentStorage::initialize(const std::string& filePath, const Options& options) {
+    // Moving to a different file or mode: finish writing the old one first
+    bool sameOptions = m_options.fsync == options.fsync && m_options.journal == options.journal;
+    if (m_initialized && !filePath.empty() && (m_storageFilePath != filePath || !sameOptions)) {
+        shutdown();
+    }
+
+    std::unique_lock<std::mutex> lock(m_mutex);
     
     // If already initialized with the same path, just return success
     if (m_initialized && m_storageFilePath == filePath) {
@@ -79,6 +115,9 @@ bool PersistentStorage::initialize(const std::string& filePath) {
     
     // Set the new file path
     m_storageFilePath = filePath;
+    m_options = options;
+    m_isDirty = false;
+    m_pendingJournal.clear();
     
     // Create parent directory if it doesn't exist
     try {
@@ -100,13 +139,70 @@ bool PersistentStorage::initialize(const std::string& filePath) {
         m_data = nlohmann::json::object();
         
         // This is not an error - it could be the first run
-        Logger::debug("Starting with empty persistent storage (file not found or invalid)");
+        LOG_DEBUG("Starting with empty persistent storage (file not found or invalid)");
+    }
+
+    // Changes logged since the last snapshot are newer than the file
+    size_t replayed = replayJournal();
+    if (m_options.journal) {
+        std::lock_guard<std::mutex> fileLock(m_fileMutex);
+        std::string journalPath = m_storageFilePath + ".journal";
+        m_journalFd = open(journalPath.c_str(), O_WRONLY | O_CREAT | O_APPEND | O_CLOEXEC, 0644);
+        m_journalBytes = 0;
+        if (m_journalFd < 0) {
+            Logger::warning("Cannot open storage journal " + journalPath + ", saving snapshots only");
+        }
     }
     
     m_initialized = true;
+
+    // Compact: fold the replayed records into the snapshot and empty the journal
+    if (replayed > 0) {
+        Logger::info("Replayed " + std::to_string(replayed) + " journal records from " + m_storageFilePath + ".journal");
+        m_isDirty = true;
+        if (writeSnapshot(lock) && !m_options.journal) {
+            // Journal left over from a run with journaling on
+            unlink((m_storageFilePath + ".journal").c_str());
+        }
+    }
+    lock.unlock();
+
+    startWriter();
     return true;
 }
 
+size_t PersistentStorage::replayJournal() {
+    std::ifstream journal(m_storageFilePath + ".journal");
+    if (!journal.is_open()) {
+        return 0;
+    }
+
+    // One {"m":module,"k":key,"v":value} object per line; a torn last line is skipped
+    size_t replayed = 0;
+    std::string line;
+    while (std::getline(journal, line)) {
+        if (line.empty()) {
+            continue;
+        }
+        try {
+            nlohmann::json record = nlohmann::json::parse(line);
+            if (!record.is_object() || !record.contains("m") || !record.contains("k") || !record.contains("v") ||
+                !record["m"].is_string() || !record["k"].is_string()) {
+                continue;
+            }
+            std::string moduleId = record["m"].get<std::string>();
+            if (!m_data.contains(moduleId) || !m_data[moduleId].is_object()) {
+                m_data[moduleId] = nlohmann::json::object();
+            }
+            m_data[moduleId][record["k"].get<std::string>()] = record["v"];
+            replayed++;
+        } catch (const nlohmann::json::parse_error&) {
+            Logger::warning("Skipping damaged storage journal record");
+        }
+    }
+    return replayed;
+}
+
 bool PersistentStorage::loadFromFile() {
     try {
         // Check if file exists
@@ -144,7 +240,7 @@ bool PersistentStorage::loadFromFile() {
             return false;
         }
 
-        Logger::debug("Successfully loaded persistent storage from " + m_storageFilePath);
+        LOG_DEBUG("Successfully loaded persistent storage from " + m_storageFilePath);
         return true;
     } catch (const std::exception& e) {
         Logger::error("Error loading storage file: " + std::string(e.what()));
@@ -153,76 +249,179 @@ bool PersistentStorage::loadFromFile() {
 }
 
 bool PersistentStorage::saveToFile() {
-    std::lock_guard<std::mutex> lock(m_mutex);
+    std::unique_lock<std::mutex> lock(m_mutex);
     
     // If not initialized or no changes to save, return early
     if (!m_initialized || !m_isDirty) {
         return m_initialized;
     }
-    
+
+    return writeSnapshot(lock);
+}
+
+bool PersistentStorage::writeSnapshot(std::unique_lock<std::mutex>& lock) {
+    // Called with m_mutex held; the file work itself runs without it. Taking
+    // the file lock first keeps a journal append from landing between the
+    // snapshot and the journal truncation below
+    std::unique_lock<std::mutex> fileLock(m_fileMutex);
+    int64_t startUs = PerfCounters::nowUs();
+    std::string text;
     try {
-        // Create a temporary filename
-        std::string tempFile = m_storageFilePath + ".tmp";
-        
-        // Write to temporary file first
-        std::ofstream file(tempFile);
-        if (!file.is_open()) {
-            Logger::error("Failed to open temporary storage file for writing: " + tempFile);
-            return false;
-        }
-        
-        // Write formatted JSON
-        file << m_data.dump(2);
-        file.close();
-        
-        // Check for write errors
-        if (!file) {
-            Logger::error("Error writing to temporary storage file");
-            return false;
+        text = m_data.dump(2);
+    } catch (const std::exception& e) {
+        Logger::error("Error serializing storage: " + std::string(e.what()));
+        return false;
+    }
+    std::string path = m_storageFilePath;
+    bool durable = m_options.fsync;
+    m_isDirty = false;
+    lock.unlock();
+
+    // Write to temporary file first
+    std::string tempFile = path + ".tmp";
+    bool success = false;
+    int fd = open(tempFile.c_str(), O_WRONLY | O_CREAT | O_TRUNC | O_CLOEXEC, 0644);
+    if (fd < 0) {
+        Logger::error("Failed to open temporary storage file for writing: " + tempFile);
+    } else {
+        bool written = writeAll(fd, text) && (!durable || fsync(fd) == 0);
+        if (close(fd) != 0) {
+            written = false;
         }
-        
+
         // Rename temporary file to actual file (atomic operation)
-        if (!renameFile(tempFile, m_storageFilePath)) {
+        if (!written) {
+            Logger::error("Error writing to temporary storage file");
+            unlink(tempFile.c_str());
+        } else if (!renameFile(tempFile, path)) {
             Logger::error("Failed to rename temporary file to target file");
-            return false;
+        } else {
+            if (durable) {
+                syncDirectory(path);
+            }
+            success = true;
         }
-        
-        Logger::debug("Successfully saved persistent storage to " + m_storageFilePath);
-        m_isDirty = false;
-        m_savePending = false;
-        return true;
-    } catch (const std::exception& e) {
-        Logger::error("Error saving storage file: " + std::string(e.what()));
+    }
+
+    // Everything journaled so far is in the snapshot now
+    if (success && m_journalFd >= 0) {
+        if (ftruncate(m_journalFd, 0) == 0) {
+            m_journalBytes = 0;
+        }
+    }
+    fileLock.unlock();
+
+    PerfCounters& perf = PerfCounters::getInstance();
+    perf.add(success ? PerfCounters::Counter::STORAGE_SAVES : PerfCounters::Counter::STORAGE_SAVE_FAILURES);
+    perf.record(PerfCounters::Histogram::STORAGE_SAVE, static_cast<uint64_t>(PerfCounters::nowUs() - startUs));
+
+    lock.lock();
+    if (success) {
+        LOG_DEBUG("Successfully saved persistent storage to " + path);
+    } else {
+        m_isDirty = true;
+    }
+    return success;
+}
+
+bool PersistentStorage::appendJournal(const std::string& records, bool& compact) {
+    std::lock_guard<std::mutex> fileLock(m_fileMutex);
+    if (m_journalFd < 0) {
         return false;
     }
+
+    PerfCounters& perf = PerfCounters::getInstance();
+    int64_t startUs = PerfCounters::nowUs();
+    if (!writeAll(m_journalFd, records)) {
+        perf.add(PerfCounters::Counter::STORAGE_SAVE_FAILURES);
+        return false;
+    }
+    if (m_options.fsync) {
+        fdatasync(m_journalFd);
+    }
+    perf.add(PerfCounters::Counter::STORAGE_SAVES);
+    perf.record(PerfCounters::Histogram::STORAGE_SAVE, static_cast<uint64_t>(PerfCounters::nowUs() - startUs));
+    m_journalBytes += records.size();
+    compact = m_journalBytes >= static_cast<size_t>(Config::STORAGE_JOURNAL_MAX_BYTES);
+    return true;
 }
 
-void PersistentStorage::scheduleSave() {
-    // If a save is already pending, don't schedule another one
-    if (m_savePending) {
-        return;
+void PersistentStorage::closeJournal() {
+    std::lock_guard<std::mutex> fileLock(m_fileMutex);
+    if (m_journalFd >= 0) {
+        close(m_journalFd);
+        m_journalFd = -1;
     }
-    
-    m_savePending = true;
-    
-    // Start a thread that waits a bit then saves
-    std::thread([this]() {
-        // Wait 2 seconds before saving
-        std::this_thread::sleep_for(std::chrono::seconds(2));
-        
-        // Check if save is still pending (could have been canceled)
-        if (m_savePending) {
-            saveToFile();
+}
+
+void PersistentStorage::startWriter() {
+    if (!m_writer.joinable()) {
+        m_writerStop = false;
+        m_writer = std::thread(&PersistentStorage::writerLoop, this);
+    }
+}
+
+void PersistentStorage::stopWriter() {
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        m_writerStop = true;
+    }
+    m_writerWake.notify_all();
+    if (m_writer.joinable()) {
+        m_writer.join();
+    }
+}
+
+void PersistentStorage::writerLoop() {
+    std::unique_lock<std::mutex> lock(m_mutex);
+    for (;;) {
+        // Journal mode keeps the snapshot dirty on purpose; only records wake it
+        m_writerWake.wait(lock, [this]() {
+            return m_writerStop || !m_pendingJournal.empty() || (m_isDirty && !m_options.journal);
+        });
+
+        if (!m_pendingJournal.empty()) {
+            std::string records;
+            records.swap(m_pendingJournal);
+            lock.unlock();
+            bool compact = false;
+            bool appended = appendJournal(records, compact);
+            lock.lock();
+
+            // Journal unusable or long enough: fold it into a fresh snapshot
+            if (!appended || compact) {
+                writeSnapshot(lock);
+            }
+            continue;
+        }
+
+        if (m_writerStop) {
+            break;
+        }
+
+        // Let a burst of changes settle so it costs a single write
+        m_writerWake.wait_for(lock, std::chrono::milliseconds(Config::STORAGE_SAVE_DELAY_MS),
+                              [this]() { return m_writerStop; });
+        if (m_isDirty) {
+            writeSnapshot(lock);
         }
-    }).detach();
+    }
 }
 
-void PersistentStorage::cancelScheduledSave() {
-    m_savePending = false;
+void PersistentStorage::shutdown() {
+    // Stops after appending whatever is queued; then one final snapshot
+    stopWriter();
+
+    std::unique_lock<std::mutex> lock(m_mutex);
+    if (m_initialized && m_isDirty) {
+        writeSnapshot(lock);
+    }
+    m_initialized = false;
+    lock.unlock();
+    closeJournal();
 }
 
-// String values
-bool PersistentStorage::setValue(const std::string& moduleId, const std::string& key, const std::string& value) {
+bool PersistentStorage::storeValue(const std::string& moduleId, const std::string& key, nlohmann::json value) {
     std::lock_guard<std::mutex> lock(m_mutex);
     
     if (!m_initialized) {
@@ -234,17 +433,32 @@ bool PersistentStorage::setValue(const std::string& moduleId, const std::string&
     if (!m_data.contains(moduleId) || !m_data[moduleId].is_object()) {
         m_data[moduleId] = nlohmann::json::object();
     }
-    
+
+    // Journal record first, while value is still ours to move
+    if (m_options.journal) {
+        nlohmann::json record = nlohmann::json::object();
+        record["m"] = moduleId;
+        record["k"] = key;
+        record["v"] = value;
+        m_pendingJournal += record.dump();
+        m_pendingJournal += '\n';
+    }
+
     // Set the value
-    m_data[moduleId][key] = value;
+    m_data[moduleId][key] = std::move(value);
     m_isDirty = true;
     
-    // Schedule a delayed save
-    scheduleSave();
+    // Hand the change to the writer thread
+    m_writerWake.notify_one();
     
     return true;
 }
 
+// String values
+bool PersistentStorage::setValue(const std::string& moduleId, const std::string& key, const std::string& value) {
+    return storeValue(moduleId, key, value);
+}
+
 std::string PersistentStorage::getValue(const std::string& moduleId, const std::string& key, const std::string& defaultValue) {
     std::lock_guard<std::mutex> lock(m_mutex);
     
@@ -264,26 +478,7 @@ std::string PersistentStorage::getValue(const std::string& moduleId, const std::
 
 // Integer values
 bool PersistentStorage::setValue(const std::string& moduleId, const std::string& key, int value) {
-    std::lock_guard<std::mutex> lock(m_mutex);
-    
-    if (!m_initialized) {
-        Logger::warning("Attempted to set value before initializing storage");
-        return false;
-    }
-    
-    // Ensure module section exists
-    if (!m_data.contains(moduleId) || !m_data[moduleId].is_object()) {
-        m_data[moduleId] = nlohmann::json::object();
-    }
-    
-    // Set the value
-    m_data[moduleId][key] = value;
-    m_isDirty = true;
-    
-    // Schedule a delayed save
-    scheduleSave();
-    
-    return true;
+    return storeValue(moduleId, key, value);
 }
 
 int PersistentStorage::getValue(const std::string& moduleId, const std::string& key, int defaultValue) {
@@ -305,26 +500,7 @@ int PersistentStorage::getValue(const std::string& moduleId, const std::string&
 
 // Boolean values
 bool PersistentStorage::setValue(const std::string& moduleId, const std::string& key, bool value) {
-    std::lock_guard<std::mutex> lock(m_mutex);
-    
-    if (!m_initialized) {
-        Logger::warning("Attempted to set value before initializing storage");
-        return false;
-    }
-    
-    // Ensure module section exists
-    if (!m_data.contains(moduleId) || !m_data[moduleId].is_object()) {
-        m_data[moduleId] = nlohmann::json::object();
-    }
-    
-    // Set the value
-    m_data[moduleId][key] = value;
-    m_isDirty = true;
-    
-    // Schedule a delayed save
-    scheduleSave();
-    
-    return true;
+    return storeValue(moduleId, key, value);
 }
 
 bool PersistentStorage::getValue(const std::string& moduleId, const std::string& key, bool defaultValue) {
@@ -346,26 +522,7 @@ bool PersistentStorage::getValue(const std::string& moduleId, const std::string&
 
 // Double values
 bool PersistentStorage::setValue(const std::string& moduleId, const std::string& key, double value) {
-    std::lock_guard<std::mutex> lock(m_mutex);
-    
-    if (!m_initialized) {
-        Logger::warning("Attempted to set value before initializing storage");
-        return false;
-    }
-    
-    // Ensure module section exists
-    if (!m_data.contains(moduleId) || !m_data[moduleId].is_object()) {
-        m_data[moduleId] = nlohmann::json::object();
-    }
-    
-    // Set the value
-    m_data[moduleId][key] = value;
-    m_isDirty = true;
-    
-    // Schedule a delayed save
-    scheduleSave();
-    
-    return true;
+    return storeValue(moduleId, key, value);
 }
 
 double PersistentStorage::getValue(const std::string& moduleId, const std::string& key, double defaultValue) {
@@ -0,0 +1,251 @@
+#include "PushServer.h"
+#include "Config.h"
+#include "Logger.h"
+#include "MonoFrame.h"
+#include "PerfCounters.h"
+#include <cerrno>
+#include <cstdlib>
+#include <cstring>
+#include <sstream>
+#include <unistd.h>
+#include <sys/socket.h>
+#include <sys/un.h>
+
+namespace {
+    bool makeAddress(const std::string& path, struct sockaddr_un& address)
+    {
+        memset(&address, 0, sizeof(address));
+        address.sun_family = AF_UNIX;
+        if (path.empty() || path.size() >= sizeof(address.sun_path)) {
+            return false;
+        }
+        memcpy(address.sun_path, path.c_str(), path.size());
+        return true;
+    }
+
+    // True if a live process is bound to path
+    bool isBound(const struct sockaddr_un& address)
+    {
+        int fd = socket(AF_UNIX, SOCK_DGRAM | SOCK_CLOEXEC, 0);
+        if (fd < 0) {
+            return false;
+        }
+        bool bound = connect(fd, reinterpret_cast<const struct sockaddr*>(&address), sizeof(address)) == 0;
+        close(fd);
+        return bound;
+    }
+
+    bool isValidName(const std::string& name)
+    {
+        if (name.empty() || name.size() > 32) {
+            return false;
+        }
+        for (char c : name) {
+            if (!isalnum(static_cast<unsigned char>(c)) && c != '_' && c != '-' && c != '.') {
+                return false;
+            }
+        }
+        return true;
+    }
+
+    std::string clip(std::string text)
+    {
+        if (!text.empty() && text.back() == '\r') {
+            text.pop_back();
+        }
+        if (text.size() > static_cast<size_t>(Config::PUSH_MAX_TEXT)) {
+            text.resize(Config::PUSH_MAX_TEXT);
+        }
+        return text;
+    }
+
+    std::vector<std::string> splitLines(const std::string& payload, int maxLines)
+    {
+        std::vector<std::string> lines;
+        std::istringstream stream(payload);
+        std::string line;
+        while (static_cast<int>(lines.size()) < maxLines && std::getline(stream, line)) {
+            lines.push_back(clip(line));
+        }
+        return lines;
+    }
+
+    bool parseInt(const std::string& text, int& value)
+    {
+        char* end = nullptr;
+        long parsed = strtol(text.c_str(), &end, 10);
+        if (text.empty() || *end != '\0') {
+            return false;
+        }
+        value = static_cast<int>(parsed);
+        return true;
+    }
+}
+
+PushServer& PushServer::getInstance()
+{
+    static PushServer instance;
+    return instance;
+}
+
+PushServer::~PushServer()
+{
+    stop();
+}
+
+bool PushServer::listen(const std::string& path)
+{
+    stop();
+
+    struct sockaddr_un address;
+    if (!makeAddress(path, address)) {
+        Logger::warning("Invalid push socket path: " + path);
+        return false;
+    }
+    if (isBound(address)) {
+        Logger::warning("Push socket " + path + " is in use by another instance");
+        return false;
+    }
+    unlink(path.c_str());
+
+    m_fd = socket(AF_UNIX, SOCK_DGRAM | SOCK_NONBLOCK | SOCK_CLOEXEC, 0);
+    if (m_fd < 0) {
+        Logger::warning("Cannot create push socket: " + std::string(strerror(errno)));
+        return false;
+    }
+    if (bind(m_fd, reinterpret_cast<struct sockaddr*>(&address), sizeof(address)) < 0) {
+        Logger::warning("Cannot bind push socket " + path + ": " + strerror(errno));
+        close(m_fd);
+        m_fd = -1;
+        return false;
+    }
+
+    m_path = path;
+    Logger::info("Accepting pushed screen content on " + path);
+    return true;
+}
+
+void PushServer::stop()
+{
+    if (m_fd < 0) {
+        return;
+    }
+    close(m_fd);
+    m_fd = -1;
+    unlink(m_path.c_str());
+    m_path.clear();
+}
+
+int PushServer::poll()
+{
+    if (m_fd < 0) {
+        return 0;
+    }
+
+    // One byte more than allowed, so MSG_TRUNC tells an oversized datagram apart
+    char buffer[Config::PUSH_MAX_DATAGRAM + 1];
+    PerfCounters& perf = PerfCounters::getInstance();
+    int applied = 0;
+
+    for (int i = 0; i < Config::PUSH_MAX_DATAGRAMS_PER_POLL; i++) {
+        ssize_t length = recv(m_fd, buffer, sizeof(buffer), MSG_DONTWAIT | MSG_TRUNC);
+        if (length < 0) {
+            if (errno == EINTR) {
+                continue;
+            }
+            break;  // EAGAIN: queue empty
+        }
+
+        if (length <= Config::PUSH_MAX_DATAGRAM && apply(buffer, static_cast<size_t>(length))) {
+            perf.add(PerfCounters::Counter::PUSH_MESSAGES);
+            applied++;
+        } else {
+            perf.add(PerfCounters::Counter::PUSH_REJECTED);
+            if (Logger::isVerbose()) {
+                LOG_DEBUG("Rejected push message of " + std::to_string(length) + " bytes");
+            }
+        }
+    }
+    return applied;
+}
+
+bool PushServer::apply(const char* data, size_t length)
+{
+    const char* newline = static_cast<const char*>(memchr(data, '\n', length));
+    std::string header(data, newline ? static_cast<size_t>(newline - data) : length);
+    std::string payload = newline ? std::string(newline + 1, data + length) : std::string();
+
+    std::istringstream fields(header);
+    std::string screen;
+    std::string command;
+    if (!(fields >> screen >> command) || !isValidName(screen)) {
+        return false;
+    }
+    std::string args;
+    std::getline(fields >> std::ws, args);
+    args = clip(args);
+
+    auto it = m_screens.find(screen);
+    if (it == m_screens.end()) {
+        if (m_screens.size() >= static_cast<size_t>(Config::PUSH_MAX_SCREENS)) {
+            return false;
+        }
+        it = m_screens.emplace(screen, Content()).first;
+    }
+    Content& content = it->second;
+
+    if (command == "title") {
+        content.title = args;
+    } else if (command == "line") {
+        std::istringstream lineFields(args);
+        std::string number;
+        std::string text;
+        int index = 0;
+        lineFields >> number;
+        std::getline(lineFields >> std::ws, text);
+        if (!parseInt(number, index) || index < 0 || index >= Config::PUSH_MAX_LINES) {
+            return false;
+        }
+        if (content.lines.size() <= static_cast<size_t>(index)) {
+            content.lines.resize(index + 1);
+        }
+        content.lines[index] = text;
+        content.showFrame = false;
+    } else if (command == "lines") {
+        content.lines = splitLines(payload, Config::PUSH_MAX_LINES);
+        content.showFrame = false;
+    } else if (command == "items") {
+        content.items = splitLines(payload, Config::PUSH_MAX_ITEMS);
+        content.showFrame = false;
+    } else if (command == "progress") {
+        std::istringstream progressFields(args);
+        std::string value;
+        int percentage = 0;
+        progressFields >> value;
+        if (!parseInt(value, percentage) || percentage < -1 || percentage > 100) {
+            return false;
+        }
+        content.progress = percentage;
+        std::getline(progressFields >> std::ws, content.progressLabel);
+        content.showFrame = false;
+    } else if (command == "frame") {
+        if (payload.size() != MonoFrame::SIZE) {
+            return false;
+        }
+        content.frame.assign(payload.begin(), payload.end());
+        content.showFrame = true;
+    } else if (command == "clear") {
+        content = Content();
+    } else {
+        return false;
+    }
+
+    content.generation = ++m_generation;
+    return true;
+}
+
+const PushServer::Content* PushServer::find(const std::string& screen) const
+{
+    auto it = m_screens.find(screen);
+    return it != m_screens.end() ? &it->second : nullptr;
+}
@@ -0,0 +1,204 @@
+#include "Scheduler.h"
+#include "Config.h"
+#include "EventLoop.h"
+#include "Logger.h"
+#include <ctime>
+#include <limits>
+#include <vector>
+
+namespace {
+    int64_t nowMs() {
+        struct timespec ts;
+        clock_gettime(CLOCK_MONOTONIC, &ts);
+        return static_cast<int64_t>(ts.tv_sec) * 1000 + ts.tv_nsec / 1000000;
+    }
+
+    constexpr int64_t NEVER = std::numeric_limits<int64_t>::max();
+}
+
+Scheduler& Scheduler::getInstance()
+{
+    static Scheduler instance;
+    return instance;
+}
+
+void Scheduler::attach(EventLoop* loop)
+{
+    detach();
+    if (!loop) {
+        return;
+    }
+    m_loop = loop;
+    m_timer = m_loop->addTimer([this]() { runDue(); });
+    rearm(nowMs());
+}
+
+void Scheduler::detach()
+{
+    if (m_loop && m_timer >= 0) {
+        m_loop->removeTimer(m_timer);
+    }
+    m_loop = nullptr;
+    m_timer = -1;
+}
+
+int Scheduler::add(const std::string& name, int periodMs, Cost cost, bool visibleOnly, Job job)
+{
+    if (periodMs <= 0 || !job) {
+        return -1;
+    }
+
+    int id = m_nextId++;
+    Entry& entry = m_jobs[id];
+    entry.name = name;
+    entry.periodMs = periodMs;
+    entry.cost = cost;
+    entry.visibleOnly = visibleOnly;
+    entry.dueMs = nowMs() + periodMs;
+    entry.job = job;
+    LOG_DEBUG("Scheduler: added " + name + " every " + std::to_string(periodMs) + "ms");
+
+    if (!m_running) {
+        rearm(nowMs());
+    }
+    return id;
+}
+
+void Scheduler::remove(int id)
+{
+    if (m_jobs.erase(id) && !m_running) {
+        rearm(nowMs());
+    }
+}
+
+void Scheduler::setVisible(bool visible)
+{
+    if (visible == m_visible) {
+        return;
+    }
+    m_visible = visible;
+    LOG_DEBUG(std::string("Scheduler: panel ") + (visible ? "visible, catching up" : "hidden, parking jobs"));
+
+    int64_t now = nowMs();
+    if (visible) {
+        // Parked jobs and those that fell due while hidden refresh together
+        for (auto& item : m_jobs) {
+            Entry& entry = item.second;
+            if (entry.visibleOnly && entry.dueMs <= now) {
+                entry.parked = true;
+            }
+        }
+        m_catchUp = true;
+    }
+    if (!m_running) {
+        rearm(now);
+    }
+}
+
+int64_t Scheduler::periodFor(const Entry& entry) const
+{
+    int64_t period = entry.periodMs;
+    if (!m_visible && entry.cost == Cost::HEAVY) {
+        period *= Config::SCHEDULER_HIDDEN_SLOWDOWN;
+    }
+    return period;
+}
+
+void Scheduler::runDue()
+{
+    if (m_running) {
+        return;     // A job ran a nested loop
+    }
+    int64_t now = nowMs();
+    if (!m_catchUp && m_nextDueMs > now) {
+        return;     // Polled early, e.g. from ScreenModule::run()
+    }
+
+    m_running = true;
+    bool catchUp = m_catchUp;
+    m_catchUp = false;
+    bool heavyStarted = false;
+
+    // Jobs may add or remove jobs, including themselves
+    std::vector<int> ids;
+    ids.reserve(m_jobs.size());
+    for (const auto& item : m_jobs) {
+        ids.push_back(item.first);
+    }
+
+    for (int id : ids) {
+        auto it = m_jobs.find(id);
+        if (it == m_jobs.end()) {
+            continue;
+        }
+        Entry& entry = it->second;
+
+        if (entry.visibleOnly && !m_visible) {
+            if (entry.dueMs <= now) {
+                entry.parked = true;
+            }
+            continue;
+        }
+
+        bool catchingUp = catchUp && entry.parked;
+        int64_t window = entry.cost == Cost::LIGHT ? Config::SCHEDULER_COALESCE_MS : 0;
+        if (!catchingUp && entry.dueMs > now + window) {
+            continue;
+        }
+
+        // Spread heavy work over ticks, except for the catch-up after waking
+        if (entry.cost == Cost::HEAVY && !catchingUp) {
+            if (heavyStarted) {
+                entry.dueMs = now + Config::SCHEDULER_TICK_MS;
+                continue;
+            }
+            heavyStarted = true;
+        }
+
+        // Keep the cadence, but never replay runs that were missed
+        int64_t period = periodFor(entry);
+        entry.dueMs = catchingUp ? now + period : entry.dueMs + period;
+        if (entry.dueMs <= now) {
+            entry.dueMs = now + period;
+        }
+        entry.parked = false;
+
+        Job job = entry.job;    // Copy: the job may remove itself
+        job();
+    }
+
+    m_running = false;
+    rearm(nowMs());
+}
+
+void Scheduler::rearm(int64_t now)
+{
+    int64_t next = NEVER;
+    for (const auto& item : m_jobs) {
+        const Entry& entry = item.second;
+        if (entry.visibleOnly && !m_visible) {
+            continue;
+        }
+        if (entry.dueMs < next) {
+            next = entry.dueMs;
+        }
+    }
+    if (m_catchUp) {
+        next = now;
+    }
+    m_nextDueMs = next;
+
+    if (!m_loop || m_timer < 0) {
+        return;
+    }
+    if (next == NEVER) {
+        m_loop->disarmTimer(m_timer);
+        return;
+    }
+
+    // Wake on the shared grid so deadlines close together fire at once
+    int64_t tick = Config::SCHEDULER_TICK_MS;
+    int64_t deadline = m_catchUp ? now : (next + tick - 1) / tick * tick;
+    int64_t delay = deadline > now ? deadline - now : 0;
+    m_loop->armTimer(m_timer, static_cast<int>(delay));
+}
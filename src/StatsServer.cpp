@@ -0,0 +1,106 @@
+#include "StatsServer.h"
+#include "Logger.h"
+#include "PerfCounters.h"
+#include <cerrno>
+#include <cstring>
+#include <unistd.h>
+#include <sys/socket.h>
+#include <sys/un.h>
+
+namespace {
+    bool makeAddress(const std::string& path, struct sockaddr_un& address)
+    {
+        memset(&address, 0, sizeof(address));
+        address.sun_family = AF_UNIX;
+        if (path.empty() || path.size() >= sizeof(address.sun_path)) {
+            return false;
+        }
+        memcpy(address.sun_path, path.c_str(), path.size());
+        return true;
+    }
+
+    // True if a live process accepts connections on path
+    bool isAnswered(const struct sockaddr_un& address)
+    {
+        int fd = socket(AF_UNIX, SOCK_STREAM | SOCK_CLOEXEC, 0);
+        if (fd < 0) {
+            return false;
+        }
+        bool answered = connect(fd, reinterpret_cast<const struct sockaddr*>(&address), sizeof(address)) == 0;
+        close(fd);
+        return answered;
+    }
+}
+
+StatsServer::~StatsServer()
+{
+    stop();
+}
+
+bool StatsServer::listen(const std::string& path)
+{
+    stop();
+
+    struct sockaddr_un address;
+    if (!makeAddress(path, address)) {
+        Logger::warning("Invalid stats socket path: " + path);
+        return false;
+    }
+    if (isAnswered(address)) {
+        Logger::warning("Stats socket " + path + " is in use by another instance");
+        return false;
+    }
+    unlink(path.c_str());
+
+    m_fd = socket(AF_UNIX, SOCK_STREAM | SOCK_NONBLOCK | SOCK_CLOEXEC, 0);
+    if (m_fd < 0) {
+        Logger::warning("Cannot create stats socket: " + std::string(strerror(errno)));
+        return false;
+    }
+    if (bind(m_fd, reinterpret_cast<struct sockaddr*>(&address), sizeof(address)) < 0 ||
+        ::listen(m_fd, 4) < 0) {
+        Logger::warning("Cannot listen on stats socket " + path + ": " + strerror(errno));
+        close(m_fd);
+        m_fd = -1;
+        return false;
+    }
+
+    m_path = path;
+    Logger::info("Serving performance counters on " + path);
+    return true;
+}
+
+void StatsServer::stop()
+{
+    if (m_fd < 0) {
+        return;
+    }
+    close(m_fd);
+    m_fd = -1;
+    unlink(m_path.c_str());
+    m_path.clear();
+}
+
+void StatsServer::acceptClients()
+{
+    for (;;) {
+        int client = accept4(m_fd, nullptr, nullptr, SOCK_NONBLOCK | SOCK_CLOEXEC);
+        if (client < 0) {
+            if (errno == EINTR) {
+                continue;
+            }
+            if (errno != EAGAIN && errno != EWOULDBLOCK) {
+                LOG_DEBUG("Stats accept failed: " + std::string(strerror(errno)));
+            }
+            return;
+        }
+
+        // The report is a few hundred bytes, well within the socket buffer
+        std::string report = PerfCounters::getInstance().report();
+        ssize_t sent = send(client, report.data(), report.size(), MSG_DONTWAIT | MSG_NOSIGNAL);
+        if (sent < static_cast<ssize_t>(report.size())) {
+            LOG_DEBUG("Stats report truncated");
+        }
+        close(client);
+    }
+}
@@ -0,0 +1,135 @@
+#include "BlitCodec.h"
+#include <cstring>
+
+namespace {
+    constexpr size_t MIN_RUN = 3;
+    constexpr size_t MAX_RUN = 130;
+    constexpr size_t MAX_LITERAL = 128;
+}
+
+size_t BlitCodec::packBits(const uint8_t* in, size_t length, uint8_t* out, size_t limit)
+{
+    size_t i = 0;
+    size_t o = 0;
+
+    while (i < length) {
+        size_t run = 1;
+        while (i + run < length && run < MAX_RUN && in[i + run] == in[i]) {
+            run++;
+        }
+
+        if (run >= MIN_RUN) {
+            if (o + 2 > limit) {
+                return 0;
+            }
+            out[o++] = static_cast<uint8_t>(run + 125);
+            out[o++] = in[i];
+            i += run;
+            continue;
+        }
+
+        // Literal stretch up to the next run worth encoding
+        size_t start = i;
+        size_t count = 0;
+        while (i < length && count < MAX_LITERAL) {
+            if (i + 2 < length && in[i] == in[i + 1] && in[i] == in[i + 2]) {
+                break;
+            }
+            i++;
+            count++;
+        }
+
+        if (o + 1 + count > limit) {
+            return 0;
+        }
+        out[o++] = static_cast<uint8_t>(count - 1);
+        std::memcpy(out + o, in + start, count);
+        o += count;
+    }
+
+    return o;
+}
+
+size_t BlitCodec::unpackBits(const uint8_t* in, size_t length, uint8_t* out, size_t limit)
+{
+    size_t i = 0;
+    size_t o = 0;
+
+    while (i < length) {
+        uint8_t control = in[i++];
+
+        if (control >= 128) {
+            size_t run = control - 125;
+            if (i >= length || o + run > limit) {
+                return 0;
+            }
+            std::memset(out + o, in[i++], run);
+            o += run;
+        } else {
+            size_t count = control + 1;
+            if (i + count > length || o + count > limit) {
+                return 0;
+            }
+            std::memcpy(out + o, in + i, count);
+            i += count;
+            o += count;
+        }
+    }
+
+    return o;
+}
+
+size_t BlitCodec::encode(const MonoFrame::Window& window, const uint8_t* current,
+                         const uint8_t* previous, uint8_t* out)
+{
+    size_t rawLength = window.bytes();
+    uint8_t* payload = out + Config::BLIT_HEADER_SIZE;
+
+    // Start from raw and keep whichever encoding is smallest
+    uint8_t encoding = Config::BLIT_ENCODING_RAW;
+    size_t payloadLength = rawLength;
+
+    uint8_t packed[MAX_PAYLOAD];
+    size_t packedLength = packBits(current, rawLength, packed, rawLength - 1);
+    if (packedLength > 0) {
+        encoding = Config::BLIT_ENCODING_RLE;
+        payloadLength = packedLength;
+    }
+
+    uint8_t delta[MAX_PAYLOAD];
+    uint8_t packedDelta[MAX_PAYLOAD];
+    size_t packedDeltaLength = 0;
+    if (previous) {
+        for (size_t i = 0; i < rawLength; i++) {
+            delta[i] = current[i] ^ previous[i];
+        }
+        packedDeltaLength = packBits(delta, rawLength, packedDelta, payloadLength - 1);
+        if (packedDeltaLength > 0) {
+            encoding = Config::BLIT_ENCODING_DELTA_RLE;
+            payloadLength = packedDeltaLength;
+        }
+    }
+
+    switch (encoding) {
+        case Config::BLIT_ENCODING_DELTA_RLE:
+            std::memcpy(payload, packedDelta, payloadLength);
+            break;
+        case Config::BLIT_ENCODING_RLE:
+            std::memcpy(payload, packed, payloadLength);
+            break;
+        default:
+            std::memcpy(payload, current, payloadLength);
+            break;
+    }
+
+    out[0] = Config::CMD_BLIT;
+    out[1] = static_cast<uint8_t>(window.firstPage);
+    out[2] = static_cast<uint8_t>(window.lastPage);
+    out[3] = static_cast<uint8_t>(window.firstColumn);
+    out[4] = static_cast<uint8_t>(window.lastColumn);
+    out[5] = encoding;
+    out[6] = static_cast<uint8_t>(payloadLength & 0xFF);
+    out[7] = static_cast<uint8_t>(payloadLength >> 8);
+
+    return Config::BLIT_HEADER_SIZE + payloadLength;
+}
@@ -2,6 +2,7 @@
 #include "Config.h"
 #include <iostream>
 #include <cstring>
+#include <strings.h>
 #include <unistd.h>
 #include <libudev.h>
 #include <poll.h>
@@ -12,21 +13,62 @@
 #include <dirent.h>  // For DIR and readdir
 #include "Logger.h"
 
+namespace {
+
+// True when a udev PRODUCT value ("vid/pid/bcdDevice", hex) names the HMI
+bool isHmiProduct(const char* product)
+{
+    if (!product) {
+        return false;
+    }
+    char* end = nullptr;
+    unsigned long vendor = strtoul(product, &end, 16);
+    if (*end != '/') {
+        return false;
+    }
+    unsigned long model = strtoul(end + 1, &end, 16);
+    return vendor == strtoul(Config::HMI_VENDOR_ID, nullptr, 16) &&
+           model == strtoul(Config::HMI_PRODUCT_ID, nullptr, 16);
+}
+
+} // namespace
+
 DeviceManager::DeviceManager()
-    : m_deviceDisconnected(false),
-      m_monitorThreadRunning(false)
+    : m_deviceDisconnected(false)
 {
+    m_udev = udev_new();
+    if (!m_udev) {
+        Logger::error("Failed to create udev context");
+    }
 }
 
 DeviceManager::~DeviceManager()
 {
-    stopDisconnectionMonitor();
+    if (m_monitor) {
+        udev_monitor_unref(m_monitor);
+    }
+    if (m_udev) {
+        udev_unref(m_udev);
+    }
 }
 
 std::pair<std::string, std::string> DeviceManager::detectDevices()
 {
-    std::string inputDevice = findHmiInputDevice();
-    std::string serialDevice = findHmiSerialDevice();
+    // The HMI's own nodes, found through its USB device
+    std::string inputDevice;
+    std::string serialDevice;
+    if (findHmiNodes(inputDevice, serialDevice)) {
+        Logger::info("Found HMI device: " + inputDevice + " + " + serialDevice);
+        attach(inputDevice, serialDevice);
+        return std::make_pair(inputDevice, serialDevice);
+    }
+
+    // Not (fully) enumerated under its VID:PID: search by name and capability
+    inputDevice = findHmiInputDevice();
+    serialDevice = findHmiSerialDevice();
+    if (!inputDevice.empty() && !serialDevice.empty()) {
+        attach(inputDevice, serialDevice);
+    }
     
     return std::make_pair(inputDevice, serialDevice);
 }
@@ -71,12 +113,12 @@ bool DeviceManager::checkDevicePresent() const
         return false;
     }
     
-    Logger::debug("Looking for HMI device with VID:PID " + std::string(Config::HMI_VENDOR_ID) + ":" + 
+    LOG_DEBUG("Looking for HMI device with VID:PID " + std::string(Config::HMI_VENDOR_ID) + ":" + 
                 std::string(Config::HMI_PRODUCT_ID));
     
     // List all input devices for debugging
     if (Logger::isVerbose()) {
-        Logger::debug("Available input devices:");
+        LOG_DEBUG("Available input devices:");
         DIR* dir = opendir("/dev/input");
         if (dir) {
             struct dirent* entry;
@@ -90,13 +132,13 @@ bool DeviceManager::checkDevicePresent() const
                     if (fd >= 0) {
                         char name[256] = "Unknown";
                         if (ioctl(fd, EVIOCGNAME(sizeof(name)), name) >= 0) {
-                            Logger::debug("  " + path + ": " + name);
+                            LOG_DEBUG("  " + path + ": " + name);
                         } else {
-                            Logger::debug("  " + path + ": <unknown>");
+                            LOG_DEBUG("  " + path + ": <unknown>");
                         }
                         close(fd);
                     } else {
-                        Logger::debug("  " + path + ": <cannot open>");
+                        LOG_DEBUG("  " + path + ": <cannot open>");
                     }
                 }
             }
@@ -131,7 +173,7 @@ bool DeviceManager::checkDevicePresent() const
                     deviceInfo += " - " + std::string(manufacturer ? manufacturer : "") + " " + 
                                std::string(productName ? productName : "");
                 }
-                Logger::debug(deviceInfo);
+                LOG_DEBUG(deviceInfo);
             }
             
             // Check if this is our HMI device
@@ -162,297 +204,252 @@ bool DeviceManager::checkDevicePresent() const
     return found;
 }
 
-bool DeviceManager::checkDevicePresentSilent() const
+bool DeviceManager::findHmiNodes(std::string& inputDevice, std::string& serialDevice) const
 {
-    struct udev* udev;
-    struct udev_enumerate* enumerate;
-    struct udev_list_entry* devices, *devListEntry;
-    bool found = false;
-    
-    // Create udev context
-    udev = udev_new();
-    if (!udev) {
+    if (!m_udev) {
         return false;
     }
-    
-    // Create enumerate object
-    enumerate = udev_enumerate_new(udev);
+
+    struct udev_enumerate* enumerate = udev_enumerate_new(m_udev);
     udev_enumerate_add_match_subsystem(enumerate, "usb");
+    udev_enumerate_add_match_property(enumerate, "DEVTYPE", "usb_device");
+    udev_enumerate_add_match_sysattr(enumerate, "idVendor", Config::HMI_VENDOR_ID);
+    udev_enumerate_add_match_sysattr(enumerate, "idProduct", Config::HMI_PRODUCT_ID);
     udev_enumerate_scan_devices(enumerate);
-    
-    // Get the list of matching devices
-    devices = udev_enumerate_get_list_entry(enumerate);
-    
-    // Iterate through devices
-    udev_list_entry_foreach(devListEntry, devices) {
-        const char* path = udev_list_entry_get_name(devListEntry);
-        struct udev_device* dev = udev_device_new_from_syspath(udev, path);
-        
-        if (dev) {
-            const char* vendor = udev_device_get_sysattr_value(dev, "idVendor");
-            const char* product = udev_device_get_sysattr_value(dev, "idProduct");
-            
-            // Check if this is our HMI device
-            if (vendor && product &&
-                strcmp(vendor, Config::HMI_VENDOR_ID) == 0 &&
-                strcmp(product, Config::HMI_PRODUCT_ID) == 0) {
-                found = true;
-            }
-            
-            udev_device_unref(dev);
-            
-            if (found) break;
+
+    bool found = false;
+    struct udev_list_entry* entry;
+    udev_list_entry_foreach(entry, udev_enumerate_get_list_entry(enumerate)) {
+        struct udev_device* usbDevice = udev_device_new_from_syspath(m_udev, udev_list_entry_get_name(entry));
+        if (usbDevice) {
+            found = findHmiNodes(usbDevice, inputDevice, serialDevice);
+            udev_device_unref(usbDevice);
+        }
+        if (found) {
+            break;
         }
     }
-    
-    // Clean up
+
     udev_enumerate_unref(enumerate);
-    udev_unref(udev);
-    
     return found;
 }
 
-bool DeviceManager::monitorDeviceUntilConnected(std::atomic<bool>& runningFlag)
+bool DeviceManager::findHmiNodes(struct udev_device* usbDevice, std::string& inputDevice, std::string& serialDevice) const
 {
-    struct udev* udev;
-    struct udev_monitor* mon;
-    int fd;
+    // Only this device's own interfaces, no system-wide scan
+    struct udev_enumerate* enumerate = udev_enumerate_new(m_udev);
+    udev_enumerate_add_match_parent(enumerate, usbDevice);
+    udev_enumerate_scan_devices(enumerate);
 
-    // Create udev context
-    udev = udev_new();
-    if (!udev) {
-        Logger::error("Failed to create udev context");
-        return false;
+    std::string input;
+    std::string serial;
+    struct udev_list_entry* entry;
+    udev_list_entry_foreach(entry, udev_enumerate_get_list_entry(enumerate)) {
+        struct udev_device* dev = udev_device_new_from_syspath(m_udev, udev_list_entry_get_name(entry));
+        if (!dev) {
+            continue;
+        }
+
+        // Nodes udev is still working on (permissions, symlinks) are not ready
+        const char* devnode = udev_device_get_devnode(dev);
+        const char* subsystem = udev_device_get_subsystem(dev);
+        if (devnode && subsystem && udev_device_get_is_initialized(dev)) {
+            if (input.empty() && strcmp(subsystem, "input") == 0 &&
+                strncmp(devnode, "/dev/input/event", 16) == 0) {
+                input = devnode;
+            } else if (serial.empty() && strcmp(subsystem, "tty") == 0 &&
+                       strncmp(devnode, "/dev/ttyACM", 11) == 0) {
+                serial = devnode;
+            }
+        }
+        udev_device_unref(dev);
     }
+    udev_enumerate_unref(enumerate);
 
-    // Set up monitoring
-    mon = udev_monitor_new_from_netlink(udev, "udev");
-    udev_monitor_filter_add_match_subsystem_devtype(mon, "usb", NULL);
-    udev_monitor_enable_receiving(mon);
-    fd = udev_monitor_get_fd(mon);
+    if (input.empty() || serial.empty()) {
+        return false;
+    }
+    inputDevice = input;
+    serialDevice = serial;
+    return true;
+}
 
-    // Set up polling
-    struct pollfd fds[1];
-    fds[0].fd = fd;
-    fds[0].events = POLLIN;
+bool DeviceManager::monitorDeviceUntilConnected(std::atomic<bool>& runningFlag)
+{
+    // Listen first so a plug-in between the check below and the wait is not missed
+    startHotplugMonitor();
 
     Logger::info("Waiting for HMI device to be connected...");
 
-    int reconnectAttempts = 0;
-    const int maxReconnectAttempts = 30; // Limit the number of reconnect attempts
-
-    //while (reconnectAttempts < maxReconnectAttempts && runningFlag) {
+    rescan();
     while (runningFlag) {
-        // Check if user cancelled with Ctrl+C
-        if (!runningFlag) {
-            Logger::info("Detection cancelled by user");
-            return false;
+        if (!m_inputNode.empty()) {
+            Logger::info("HMI device found!");
+            return true;
         }
 
-        // First check if device is already present
-        bool deviceFound = checkDevicePresent();
+        if (m_monitorFd < 0) {
+            rescan();
+            usleep(Config::DETECTION_POLL_INTERVAL * 1000);
+            continue;
+        }
 
-        if (deviceFound) {
-            Logger::info("HMI device found!");
-            // Clean up
-            udev_monitor_unref(mon);
-            udev_unref(udev);
-            return true;
+        struct pollfd fds[1];
+        fds[0].fd = m_monitorFd;
+        fds[0].events = POLLIN;
+        int ret = poll(fds, 1, Config::DETECTION_POLL_INTERVAL);
+        if (ret > 0) {
+            processHotplugEvents();
+        } else if (ret == 0) {
+            // Quiet: covers systems without udevd, whose events never come
+            rescan();
         }
+    }
 
-        // Wait for device events
-        int ret = poll(fds, 1, Config::UDEV_POLL_TIMEOUT);
+    Logger::info("Detection cancelled by user");
+    return false;
+}
+
+bool DeviceManager::startHotplugMonitor()
+{
+    if (m_monitor) {
+        return true;
+    }
+    if (!m_udev) {
+        return false;
+    }
 
-        if (ret > 0 && (fds[0].revents & POLLIN)) {
-            // Get the device
-            struct udev_device* dev = udev_monitor_receive_device(mon);
-            if (dev) {
-                const char* action = udev_device_get_action(dev);
+    // Events after udev rules ran, so device nodes are ready when they arrive
+    m_monitor = udev_monitor_new_from_netlink(m_udev, "udev");
+    if (!m_monitor) {
+        Logger::error("Failed to create udev monitor");
+        return false;
+    }
 
-                // Only care about add events
-                if (action && strcmp(action, "add") == 0) {
-                    // Check if this is potentially our device
-                    struct udev_device* usbDev = udev_device_get_parent_with_subsystem_devtype(
-                        dev, "usb", "usb_device");
+    // Kernel-side filter; VID:PID is checked per event
+    udev_monitor_filter_add_match_subsystem_devtype(m_monitor, "input", NULL);
+    udev_monitor_filter_add_match_subsystem_devtype(m_monitor, "tty", NULL);
+    udev_monitor_filter_add_match_subsystem_devtype(m_monitor, "usb", "usb_device");
+    if (udev_monitor_enable_receiving(m_monitor) < 0) {
+        Logger::error("Failed to enable udev monitor");
+        udev_monitor_unref(m_monitor);
+        m_monitor = nullptr;
+        return false;
+    }
 
-                    if (usbDev) {
-                        const char* vendor = udev_device_get_sysattr_value(usbDev, "idVendor");
-                        const char* product = udev_device_get_sysattr_value(usbDev, "idProduct");
+    m_monitorFd = udev_monitor_get_fd(m_monitor);
+    LOG_DEBUG("udev hotplug monitor started");
+    return true;
+}
 
-                        if (vendor && product &&
-                            strcmp(vendor, Config::HMI_VENDOR_ID) == 0 &&
-                            strcmp(product, Config::HMI_PRODUCT_ID) == 0) {
+void DeviceManager::processHotplugEvents()
+{
+    if (!m_monitor) {
+        return;
+    }
 
-                            Logger::debug("USB device connected (VID:PID " + std::string(vendor) + ":" +
-                                      std::string(product) + ")");
+    // The monitor socket is non-blocking: drain everything queued
+    struct udev_device* dev;
+    while ((dev = udev_monitor_receive_device(m_monitor)) != NULL) {
+        handleHotplugEvent(dev);
+        udev_device_unref(dev);
+    }
+}
 
-                            // Give some time for all device nodes to be created
-                            sleep(2);
+bool DeviceManager::isHmiEvent(struct udev_device* device) const
+{
+    // Set by udev's usb_id builtin on input and tty nodes
+    const char* vendor = udev_device_get_property_value(device, "ID_VENDOR_ID");
+    const char* model = udev_device_get_property_value(device, "ID_MODEL_ID");
+    if (vendor && model) {
+        return strcasecmp(vendor, Config::HMI_VENDOR_ID) == 0 &&
+               strcasecmp(model, Config::HMI_PRODUCT_ID) == 0;
+    }
 
-                            // Double check that all required interfaces are present
-                            if (checkDevicePresent()) {
-                                Logger::info("HMI device fully initialized!");
-                                udev_device_unref(dev);
+    // Kernel uevent variable of usb devices and interfaces
+    return isHmiProduct(udev_device_get_property_value(device, "PRODUCT"));
+}
 
-                                // Clean up
-                                udev_monitor_unref(mon);
-                                udev_unref(udev);
+void DeviceManager::handleHotplugEvent(struct udev_device* device)
+{
+    const char* action = udev_device_get_action(device);
+    if (!action) {
+        return;
+    }
+    const char* devnode = udev_device_get_devnode(device);
 
-                                return true;
-                            }
-                        }
-                    }
-                }
-                udev_device_unref(dev);
-            }
+    if (strcmp(action, "remove") == 0) {
+        if (m_inputNode.empty()) {
+            return;
         }
-
-        // If we've waited for a while with no device events, do a periodic check
-        // This handles the case where we might have missed an event
-        static time_t lastPeriodicCheck = 0;
-        time_t now = time(NULL);
-
-        if (now - lastPeriodicCheck >= 5) {  // Check every 5 seconds
-            lastPeriodicCheck = now;
-            reconnectAttempts++;
-
-            // Print a progress message
-            Logger::debug("Waiting for device... Attempt " +
-                       std::to_string(reconnectAttempts) + " of " +
-                       std::to_string(maxReconnectAttempts));
-
-            // Manual check for device
-            if (checkDevicePresent()) {
-                Logger::info("HMI device found on periodic check!");
-                // Clean up
-                udev_monitor_unref(mon);
-                udev_unref(udev);
-                return true;
-            }
+        bool attachedNode = devnode && (m_inputNode == devnode || m_serialNode == devnode);
+        if (!attachedNode && !isHmiEvent(device)) {
+            return;
         }
 
-        // Brief delay before checking again if no events
-        if (ret == 0) {
-            usleep(1000000); // 1 second wait between poll attempts
+        Logger::info("HMI device removed (" + std::string(devnode ? devnode : udev_device_get_syspath(device)) + ")");
+        forgetDevice();
+        if (m_disconnectCallback) {
+            m_disconnectCallback();
         }
+        return;
     }
 
-    Logger::warning("Gave up waiting for device after " +
-                 std::to_string(maxReconnectAttempts) + " attempts");
-
-    // Clean up
-    udev_monitor_unref(mon);
-    udev_unref(udev);
+    if (strcmp(action, "add") != 0 || !m_inputNode.empty() || !isHmiEvent(device)) {
+        return;
+    }
 
-    return false;
+    // Whichever node arrives last completes the pair
+    struct udev_device* usbDevice = udev_device_get_parent_with_subsystem_devtype(device, "usb", "usb_device");
+    const char* devtype = udev_device_get_devtype(device);
+    if (devtype && strcmp(devtype, "usb_device") == 0) {
+        usbDevice = device;
+    }
+    std::string inputDevice;
+    std::string serialDevice;
+    if (usbDevice && findHmiNodes(usbDevice, inputDevice, serialDevice)) {
+        Logger::info("HMI device connected: " + inputDevice + " + " + serialDevice);
+        attach(inputDevice, serialDevice);
+        if (m_connectCallback) {
+            m_connectCallback(inputDevice, serialDevice);
+        }
+    }
 }
 
-void DeviceManager::startDisconnectionMonitor()
+void DeviceManager::rescan()
 {
-    // Only start if not already running
-    if (!m_monitorThreadRunning) {
-        m_deviceDisconnected = false;
-        m_monitorThreadRunning = true;
-        m_monitorThread = std::thread(&DeviceManager::disconnectionMonitorThread, this);
+    if (!m_inputNode.empty()) {
+        return;
     }
-}
 
-void DeviceManager::stopDisconnectionMonitor()
-{
-    if (m_monitorThreadRunning) {
-        m_monitorThreadRunning = false;
-        if (m_monitorThread.joinable()) {
-            m_monitorThread.join();
+    std::string inputDevice;
+    std::string serialDevice;
+    if (findHmiNodes(inputDevice, serialDevice)) {
+        Logger::info("HMI device found on rescan: " + inputDevice + " + " + serialDevice);
+        attach(inputDevice, serialDevice);
+        if (m_connectCallback) {
+            m_connectCallback(inputDevice, serialDevice);
         }
     }
 }
 
-bool DeviceManager::isDeviceDisconnected() const
+void DeviceManager::attach(const std::string& inputDevice, const std::string& serialDevice)
 {
-    return m_deviceDisconnected;
+    m_inputNode = inputDevice;
+    m_serialNode = serialDevice;
+    m_deviceDisconnected = false;
 }
-void DeviceManager::disconnectionMonitorThread()
+
+void DeviceManager::forgetDevice()
 {
-    struct udev* udev;
-    struct udev_monitor* mon;
-    int fd;
-    
-    // Create udev context
-    udev = udev_new();
-    if (!udev) {
-        std::cerr << "Failed to create udev context in monitor thread" << std::endl;
-        return;
-    }
-    
-    // Set up monitoring
-    mon = udev_monitor_new_from_netlink(udev, "udev");
-    udev_monitor_filter_add_match_subsystem_devtype(mon, "usb", NULL);
-    udev_monitor_enable_receiving(mon);
-    fd = udev_monitor_get_fd(mon);
-    
-    // Set up polling
-    struct pollfd fds[1];
-    fds[0].fd = fd;
-    fds[0].events = POLLIN;
-    
-    std::cout << "Disconnection monitor thread started" << std::endl;
-    
-    // Track time for periodic checks
-    time_t lastCheckTime = time(NULL);
-    
-    while (m_monitorThreadRunning) {
-        // Only check device connection periodically (every 5 seconds)
-        time_t now = time(NULL);
-        if (now - lastCheckTime >= 5) {
-            // Check that the device is still present
-            if (!checkDevicePresentSilent()) {
-                std::cout << "Device disconnected (periodic check)" << std::endl;
-                m_deviceDisconnected = true;
-                break;
-            }
-            lastCheckTime = now;
-        }
-        
-        // Poll for device events (focusing on removal events)
-        int ret = poll(fds, 1, 1000); // 1 second timeout
-        
-        if (ret > 0 && (fds[0].revents & POLLIN)) {
-            // Get the device
-            struct udev_device* dev = udev_monitor_receive_device(mon);
-            if (dev) {
-                const char* action = udev_device_get_action(dev);
-                
-                // Only process remove events to avoid repeated detection
-                if (action && strcmp(action, "remove") == 0) {
-                    // Check if this is potentially our device
-                    struct udev_device* usbDev = udev_device_get_parent_with_subsystem_devtype(
-                        dev, "usb", "usb_device");
-                        
-                    if (usbDev) {
-                        const char* vendor = udev_device_get_sysattr_value(usbDev, "idVendor");
-                        const char* product = udev_device_get_sysattr_value(usbDev, "idProduct");
-                        
-                        if (vendor && product &&
-                            strcmp(vendor, Config::HMI_VENDOR_ID) == 0 &&
-                            strcmp(product, Config::HMI_PRODUCT_ID) == 0) {
-                            
-                            std::cout << "USB device disconnected (VID:PID " << vendor << ":" << product << ")" << std::endl;
-                            m_deviceDisconnected = true;
-                            udev_device_unref(dev);
-                            break;
-                        }
-                    }
-                }
-                udev_device_unref(dev);
-            }
-        }
-    }
-    
-    // Clean up
-    udev_monitor_unref(mon);
-    udev_unref(udev);
-    
-    std::cout << "Disconnection monitor thread exiting" << std::endl;
+    m_inputNode.clear();
+    m_serialNode.clear();
+    m_deviceDisconnected = true;
+}
+
+bool DeviceManager::isDeviceDisconnected() const
+{
+    return m_deviceDisconnected;
 }
 
 std::string DeviceManager::findHmiInputDevice() const
@@ -469,7 +466,7 @@ std::string DeviceManager::findHmiInputDevice() const
         return result;
     }
     
-    Logger::debug("Searching for HMI input device (VID=" + std::string(Config::HMI_VENDOR_ID) + 
+    LOG_DEBUG("Searching for HMI input device (VID=" + std::string(Config::HMI_VENDOR_ID) + 
                 " PID=" + std::string(Config::HMI_PRODUCT_ID) + 
                 " Product=" + std::string(Config::HMI_PRODUCT_NAME) + ")");
     
@@ -531,7 +528,7 @@ std::string DeviceManager::findHmiInputDevice() const
             const char* manufacturer = udev_device_get_sysattr_value(usbDev, "manufacturer");
             const char* productName = udev_device_get_sysattr_value(usbDev, "product");
             
-            Logger::debug("  USB device: " +
+            LOG_DEBUG("  USB device: " +
                        std::string(vendor ? vendor : "unknown") + ":" +
                        std::string(product ? product : "unknown") + " - " +
                        std::string(manufacturer ? manufacturer : "unknown") + " " +
@@ -553,31 +550,9 @@ std::string DeviceManager::findHmiInputDevice() const
     
     udev_enumerate_unref(enumerate);
     
-    // If we didn't find a device, try the more direct approach
-    if (result.empty()) {
-        Logger::debug("Trying alternative detection method...");
-        
-        // Look for device by dmesg pattern (recent device appears in dmesg)
-        FILE* fp = popen("dmesg | grep -A 2 \"input: DIY Projects Pico Encoder Display as\" | grep -o \"/dev/input/event[0-9]*\"", "r");
-        if (fp) {
-            char path[64];
-            if (fgets(path, sizeof(path), fp) != NULL) {
-                // Remove trailing newline
-                size_t len = strlen(path);
-                if (len > 0 && path[len-1] == '\n') {
-                    path[len-1] = '\0';
-                }
-                
-                Logger::debug("Found input device from dmesg: " + std::string(path));
-                result = path;
-            }
-            pclose(fp);
-        }
-    }
-    
     // If we still didn't find a device, check all input devices for Mouse capability
     if (result.empty()) {
-        Logger::debug("Searching for any mouse-like input device...");
+        LOG_DEBUG("Searching for any mouse-like input device...");
         
         enumerate = udev_enumerate_new(udev);
         udev_enumerate_add_match_subsystem(enumerate, "input");
@@ -609,7 +584,7 @@ std::string DeviceManager::findHmiInputDevice() const
                     if ((evbit[EV_REL/8/sizeof(long)] & (1 << (EV_REL % (8 * sizeof(long))))) &&
                         (relbit[REL_X/8/sizeof(long)] & (1 << (REL_X % (8 * sizeof(long)))))) {
                         
-                        Logger::debug("Found input device with REL_X capability: " + std::string(devnode));
+                        LOG_DEBUG("Found input device with REL_X capability: " + std::string(devnode));
                         result = devnode;
                         close(fd);
                         udev_device_unref(dev);
@@ -722,28 +697,6 @@ std::string DeviceManager::findHmiSerialDevice() const
     
     udev_enumerate_unref(enumerate);
     
-    // If we didn't find a device, try the more direct approach
-    if (result.empty()) {
-        std::cout << "Trying alternative detection method for serial device..." << std::endl;
-        
-        // Look for device by dmesg pattern
-        FILE* fp = popen("dmesg | grep -A 1 \"Product: Pico Encoder Display\" | grep -o \"/dev/ttyACM[0-9]*\"", "r");
-        if (fp) {
-            char path[64];
-            if (fgets(path, sizeof(path), fp) != NULL) {
-                // Remove trailing newline
-                size_t len = strlen(path);
-                if (len > 0 && path[len-1] == '\n') {
-                    path[len-1] = '\0';
-                }
-                
-                std::cout << "Found serial device from dmesg: " << path << std::endl;
-                result = path;
-            }
-            pclose(fp);
-        }
-    }
-    
     // Final fallback - just look for any ttyACM device
     if (result.empty()) {
         std::cout << "Checking for any ttyACM device..." << std::endl;
@@ -1,4 +1,6 @@
 #include "DeviceInterfaces.h"
+#include "Logger.h"
+#include "BlitCodec.h"
 #include <cstring>
 #include <cerrno>
 #include <unistd.h>
@@ -79,6 +81,17 @@ bool DisplayDevice::open()
     
     // Reset disconnection status
     m_disconnected = false;
+
+    // Whatever the device shows now is unknown
+    invalidateShown();
+
+    // Hand writes to the writer thread; it needs a non-blocking fd
+    int flags = fcntl(m_fd, F_GETFL, 0);
+    fcntl(m_fd, F_SETFL, flags | O_NONBLOCK);
+    if (!m_writer.start(m_fd, [this]() { m_disconnected = true; })) {
+        std::cerr << "Serial writer thread unavailable, using blocking writes" << std::endl;
+        fcntl(m_fd, F_SETFL, flags);
+    }
     
     return true;
 }
@@ -89,6 +102,9 @@ void DisplayDevice::close()
     if (isOpen()) {
         // Send any remaining buffered commands
         flushBuffer();
+
+        // Let queued frames reach the device, but don't hang on a dead link
+        m_writer.stop(m_disconnected ? 0 : 500);
         
         // Close the file descriptor
         ::close(m_fd);
@@ -118,61 +134,64 @@ bool DisplayDevice::checkConnection() const
 // Buffer a command to be sent later
 void DisplayDevice::bufferCommand(const uint8_t* data, size_t length)
 {
-    std::lock_guard<std::mutex> lock(m_mutex);
-    
-    // If buffer would overflow, flush it first
-    if (m_cmdBuffer.used + length > Config::CMD_BUFFER_SIZE) {
-        flushBuffer();
+    std::vector<uint8_t> pending;
+
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+
+        // If buffer would overflow, send what is buffered first
+        if (m_cmdBuffer.used + length > Config::CMD_BUFFER_SIZE) {
+            pending.assign(m_cmdBuffer.buffer, m_cmdBuffer.buffer + m_cmdBuffer.used);
+            m_cmdBuffer.used = 0;
+        }
+
+        // Copy new command to buffer
+        memcpy(m_cmdBuffer.buffer + m_cmdBuffer.used, data, length);
+        m_cmdBuffer.used += length;
+
+        // Update last action timestamp
+        gettimeofday(&m_cmdBuffer.lastFlush, nullptr);
+    }
+
+    if (!pending.empty()) {
+        sendFrame(pending.data(), pending.size(), 0);
     }
-    
-    // Copy new command to buffer
-    memcpy(m_cmdBuffer.buffer + m_cmdBuffer.used, data, length);
-    m_cmdBuffer.used += length;
-    
-    // Update last action timestamp
-    gettimeofday(&m_cmdBuffer.lastFlush, nullptr);
 }
 
 // Flush the command buffer to the serial device
 void DisplayDevice::flushBuffer()
 {
-    std::lock_guard<std::mutex> lock(m_mutex);
-    
-    if (m_cmdBuffer.used > 0 && isOpen()) {
-        ssize_t bytesWritten = write(m_fd, m_cmdBuffer.buffer, m_cmdBuffer.used);
-        if (bytesWritten < 0) {
-            std::cerr << "Error writing to serial device: " << strerror(errno) << std::endl;
-            
-            // If error indicates device disconnection, set the flag
-            if (errno == EIO || errno == ENODEV || errno == ENXIO) {
-                std::cerr << "Serial buffer write error indicates device disconnection" << std::endl;
-                m_disconnected = true;
-            }
-        } else if ((size_t)bytesWritten < m_cmdBuffer.used) {
-            std::cerr << "Warning: Only wrote " << bytesWritten << " of " 
-                      << m_cmdBuffer.used << " bytes" << std::endl;
-        }
-        
-        // Flush the output only if device still connected
-        if (!m_disconnected) {
-            if (tcdrain(m_fd) < 0) {
-                std::cerr << "Error draining serial output: " << strerror(errno) << std::endl;
-                
-                // Check if tcdrain error indicates device disconnection
-                if (errno == EIO || errno == ENODEV || errno == ENXIO) {
-                    std::cerr << "Serial buffer drain error indicates device disconnection" << std::endl;
-                    m_disconnected = true;
-                }
-            }
+    std::vector<uint8_t> pending;
+
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        if (m_cmdBuffer.used == 0) {
+            return;
         }
-        
+        pending.assign(m_cmdBuffer.buffer, m_cmdBuffer.buffer + m_cmdBuffer.used);
         m_cmdBuffer.used = 0;
     }
+
+    sendFrame(pending.data(), pending.size(), 0);
 }
 
-// Send a command immediately to the serial device
+// Send a command to the serial device
 void DisplayDevice::sendCommand(const uint8_t* data, size_t length)
 {
+    sendFrame(data, length, 0);
+}
+
+void DisplayDevice::sendFrame(const uint8_t* data, size_t length, int gapUs)
+{
+    if (m_writer.isRunning()) {
+        if (!m_writer.enqueue(data, length, gapUs)) {
+            Logger::warning("Serial writer queue full, dropped display command");
+            // The device no longer matches what we think it shows
+            invalidateShown();
+        }
+        return;
+    }
+
     std::lock_guard<std::mutex> lock(m_mutex);
     
     if (isOpen()) {
@@ -204,28 +223,68 @@ void DisplayDevice::sendCommand(const uint8_t* data, size_t length)
                 }
             }
         }
+
+        if (gapUs > 0) {
+            usleep(gapUs);
+        }
     }
 }
 
 // Clear the display
 void DisplayDevice::clear()
 {
-    uint8_t cmd = Config::CMD_CLEAR;
-    sendCommand(&cmd, 1);
+    if (m_blitFrame) {
+        std::lock_guard<std::mutex> lock(m_blitMutex);
+        m_blitFrame->clear();
+        return;
+    }
+    if (m_frameBuffer) {
+        m_frameBuffer->beginFrame();
+        return;
+    }
+    m_replay.beginFrame();
+    sendClear();
 }
 
 // Draw text at position
-void DisplayDevice::drawText(int x, int y, const std::string& text)
+void DisplayDevice::drawText(int x, int y, const char* text, size_t length)
 {
-    size_t textLen = text.length();
-    std::vector<uint8_t> cmd(textLen + 3);
-    
+    if (m_blitFrame) {
+        std::lock_guard<std::mutex> lock(m_blitMutex);
+        m_blitFrame->drawText(x, y, text, length);
+        return;
+    }
+    if (m_frameBuffer) {
+        m_frameBuffer->drawText(x, y, text, length);
+        return;
+    }
+    m_replay.drawText(x, y, text, length);
+    sendText(x, y, text, length);
+}
+
+void DisplayDevice::sendClear(int gapUs)
+{
+    uint8_t cmd = Config::CMD_CLEAR;
+    sendFrame(&cmd, 1, gapUs);
+}
+
+void DisplayDevice::sendText(int x, int y, const char* text, size_t length, int gapUs)
+{
+    // Rows fit on the stack; only unusually long text needs the heap
+    uint8_t local[3 + FrameBuffer::MAX_TEXT];
+    std::vector<uint8_t> large;
+    uint8_t* cmd = local;
+    if (length > FrameBuffer::MAX_TEXT) {
+        large.resize(length + 3);
+        cmd = large.data();
+    }
+
     cmd[0] = Config::CMD_DRAW_TEXT;
     cmd[1] = static_cast<uint8_t>(x);
     cmd[2] = static_cast<uint8_t>(y);
-    memcpy(cmd.data() + 3, text.c_str(), textLen);
-    
-    sendCommand(cmd.data(), cmd.size());
+    memcpy(cmd + 3, text, length);
+
+    sendFrame(cmd, length + 3, gapUs);
 }
 
 // Set cursor position
@@ -258,6 +317,21 @@ void DisplayDevice::setBrightness(int brightness)
 
 // Send progress bar command
 void DisplayDevice::drawProgressBar(int x, int y, int width, int height, int percentage)
+{
+    if (m_blitFrame) {
+        std::lock_guard<std::mutex> lock(m_blitMutex);
+        m_blitFrame->drawProgressBar(x, y, width, height, percentage);
+        return;
+    }
+    if (m_frameBuffer) {
+        m_frameBuffer->drawProgressBar(x, y, width, height, percentage);
+        return;
+    }
+    m_replay.drawProgressBar(x, y, width, height, percentage);
+    sendProgressBar(x, y, width, height, percentage);
+}
+
+void DisplayDevice::sendProgressBar(int x, int y, int width, int height, int percentage, int gapUs)
 {
     uint8_t cmd[6];
     cmd[0] = Config::CMD_PROGRESS_BAR;
@@ -266,7 +340,7 @@ void DisplayDevice::drawProgressBar(int x, int y, int width, int height, int per
     cmd[3] = static_cast<uint8_t>(width);
     cmd[4] = static_cast<uint8_t>(height);
     cmd[5] = static_cast<uint8_t>(percentage);
-    sendCommand(cmd, 6);
+    sendFrame(cmd, 6, gapUs);
 }
 
 // Set power mode
@@ -277,3 +351,181 @@ void DisplayDevice::setPower(bool on)
     cmd[1] = on ? 0x01 : 0x00;
     sendCommand(cmd, 2);
 }
+
+// Send the difference between the composed frame and what the device shows.
+// Each op still goes out as its own command since the protocol has no framing;
+// the pacing between them is applied by the writer thread, not the caller.
+void DisplayDevice::present()
+{
+    if (m_blitFrame) {
+        presentBlit();
+        return;
+    }
+
+    if (!m_frameBuffer || !m_frameBuffer->isDirty() || !isOpen()) {
+        return;
+    }
+
+    m_frameBuffer->present(m_update);
+    sendUpdate(m_update);
+
+    if (Logger::isVerbose()) {
+        LOG_DEBUG("Framebuffer present: " + std::to_string(m_update.ops.size()) + " ops, " +
+                      std::to_string(m_update.bytes) + " bytes" + (m_update.fullRedraw ? " (full redraw)" : ""));
+    }
+}
+
+void DisplayDevice::repaint()
+{
+    if (!isOpen()) {
+        return;
+    }
+
+    // Shadow modes were invalidated by open(), so this sends the whole frame
+    if (m_blitFrame || m_frameBuffer) {
+        present();
+        return;
+    }
+
+    m_replay.invalidate();
+    m_replay.present(m_update);
+    sendUpdate(m_update);
+}
+
+void DisplayDevice::sendUpdate(const FrameBuffer::Update& update)
+{
+    if (update.fullRedraw) {
+        sendClear(update.ops.empty() ? 0 : Config::DISPLAY_CLEAR_DELAY);
+    }
+
+    for (size_t i = 0; i < update.ops.size(); i++) {
+        const FrameBuffer::Op& op = update.ops[i];
+        int gapUs = (i + 1 < update.ops.size()) ? Config::DISPLAY_CMD_DELAY : 0;
+        if (op.type == FrameBuffer::OpType::TEXT) {
+            sendText(op.x, op.y, op.text.data(), op.text.size(), gapUs);
+        } else {
+            sendProgressBar(op.x, op.y, op.width, op.height, op.percentage, gapUs);
+        }
+    }
+}
+
+void DisplayDevice::setBlitMode(bool enabled)
+{
+    std::lock_guard<std::mutex> lock(m_blitMutex);
+
+    if (enabled) {
+        // Bitmap frames replace the text display list
+        m_frameBuffer.reset();
+        m_blitFrame.reset(new MonoFrame());
+        m_blitFrame->markAllDirty();
+    } else {
+        m_blitFrame.reset();
+    }
+    m_blitShown.clear();
+}
+
+void DisplayDevice::invalidateShown()
+{
+    if (m_frameBuffer) {
+        m_frameBuffer->invalidate();
+    }
+
+    std::lock_guard<std::mutex> lock(m_blitMutex);
+    m_blitShown.clear();
+    if (m_blitFrame) {
+        m_blitFrame->markAllDirty();
+    }
+}
+
+// Copy a pre-rendered window into the local frame and send it right away
+void DisplayDevice::blit(const MonoFrame::Window& window, const uint8_t* pixels)
+{
+    {
+        std::lock_guard<std::mutex> lock(m_blitMutex);
+        if (!m_blitFrame) {
+            return;
+        }
+        m_blitFrame->writeWindow(window, pixels);
+    }
+
+    presentBlit();
+}
+
+// Send one window as CMD_BLIT, delta-encoded when the old contents are known
+void DisplayDevice::sendBlit(const MonoFrame::Window& window, const uint8_t* pixels)
+{
+    uint8_t command[BlitCodec::MAX_COMMAND];
+    size_t length;
+    int width = window.lastColumn - window.firstColumn + 1;
+
+    {
+        std::lock_guard<std::mutex> lock(m_blitMutex);
+
+        uint8_t previous[MonoFrame::SIZE];
+        bool havePrevious = !m_blitShown.empty();
+        size_t offset = 0;
+        for (int page = window.firstPage; page <= window.lastPage; page++) {
+            uint8_t* shown = havePrevious ? &m_blitShown[page * MonoFrame::WIDTH + window.firstColumn] : nullptr;
+            if (shown) {
+                std::memcpy(previous + offset, shown, width);
+            }
+            offset += width;
+        }
+
+        // Nothing to send if the device already shows these bytes
+        if (havePrevious && std::memcmp(previous, pixels, window.bytes()) == 0) {
+            return;
+        }
+
+        length = BlitCodec::encode(window, pixels, havePrevious ? previous : nullptr, command);
+
+        // Only a full-frame raw blit establishes the device contents from scratch
+        if (!havePrevious && window.bytes() == MonoFrame::SIZE) {
+            m_blitShown.assign(pixels, pixels + MonoFrame::SIZE);
+        } else if (havePrevious) {
+            offset = 0;
+            for (int page = window.firstPage; page <= window.lastPage; page++) {
+                std::memcpy(&m_blitShown[page * MonoFrame::WIDTH + window.firstColumn], pixels + offset, width);
+                offset += width;
+            }
+        }
+    }
+
+    sendFrame(command, length, Config::DISPLAY_CMD_DELAY);
+}
+
+void DisplayDevice::presentBlit()
+{
+    std::vector<MonoFrame::Window> windows;
+    std::vector<uint8_t> pixels;
+
+    {
+        std::lock_guard<std::mutex> lock(m_blitMutex);
+        if (!m_blitFrame || !isOpen()) {
+            return;
+        }
+
+        // Device contents unknown: the first blit has to cover the whole frame
+        if (m_blitShown.empty()) {
+            m_blitFrame->markAllDirty();
+        }
+
+        windows = m_blitFrame->takeDirtyWindows(Config::BLIT_HEADER_SIZE);
+        for (const auto& window : windows) {
+            size_t offset = pixels.size();
+            pixels.resize(offset + window.bytes());
+            m_blitFrame->copyWindow(window, pixels.data() + offset);
+        }
+    }
+
+    size_t offset = 0;
+    for (const auto& window : windows) {
+        sendBlit(window, pixels.data() + offset);
+        offset += window.bytes();
+    }
+
+    if (Logger::isVerbose() && !windows.empty()) {
+        LOG_DEBUG("Blit present: " + std::to_string(windows.size()) + " windows, " +
+                      std::to_string(pixels.size()) + " raw bytes");
+    }
+}
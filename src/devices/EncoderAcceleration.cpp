@@ -0,0 +1,119 @@
+#include "EncoderAcceleration.h"
+#include "Config.h"
+#include <algorithm>
+#include <cstdlib>
+#include <sstream>
+
+namespace {
+
+std::vector<EncoderAcceleration::Point>& sharedCurve()
+{
+    static std::vector<EncoderAcceleration::Point> curve = []() {
+        std::vector<EncoderAcceleration::Point> parsed;
+        EncoderAcceleration::parseCurve(Config::ENCODER_ACCEL_CURVE, parsed);
+        return parsed;
+    }();
+    return curve;
+}
+
+} // namespace
+
+bool EncoderAcceleration::parseCurve(const std::string& text, std::vector<Point>& curve)
+{
+    curve.clear();
+    if (text == "off") {
+        return true;
+    }
+
+    std::istringstream fields(text);
+    std::string field;
+    while (std::getline(fields, field, ',')) {
+        size_t colon = field.find(':');
+        if (colon == std::string::npos) {
+            return false;
+        }
+        char* end = nullptr;
+        Point point;
+        point.rate = std::strtod(field.c_str(), &end);
+        if (end != field.c_str() + colon) {
+            return false;
+        }
+        const char* gainText = field.c_str() + colon + 1;
+        point.gain = std::strtod(gainText, &end);
+        if (end == gainText || *end != '\0') {
+            return false;
+        }
+
+        // Never slower than the hand, and rates must rise
+        if (point.rate <= 0 || point.gain < 1.0 || point.gain > Config::ENCODER_ACCEL_MAX_GAIN ||
+            (!curve.empty() && point.rate <= curve.back().rate)) {
+            return false;
+        }
+        curve.push_back(point);
+    }
+    return !curve.empty();
+}
+
+void EncoderAcceleration::setCurve(const std::vector<Point>& curve)
+{
+    sharedCurve() = curve;
+}
+
+const std::vector<EncoderAcceleration::Point>& EncoderAcceleration::curve()
+{
+    return sharedCurve();
+}
+
+double EncoderAcceleration::gainAt(double rate)
+{
+    const std::vector<Point>& points = sharedCurve();
+    if (points.empty() || rate <= points.front().rate) {
+        return points.empty() ? 1.0 : points.front().gain;
+    }
+    for (size_t i = 1; i < points.size(); i++) {
+        if (rate < points[i].rate) {
+            const Point& low = points[i - 1];
+            const Point& high = points[i];
+            return low.gain + (high.gain - low.gain) * (rate - low.rate) / (high.rate - low.rate);
+        }
+    }
+    return points.back().gain;
+}
+
+int EncoderAcceleration::step(int direction, const struct timeval& time)
+{
+    if (direction == 0) {
+        return 0;
+    }
+    direction = direction > 0 ? 1 : -1;
+
+    long long us = static_cast<long long>(time.tv_sec) * 1000000 + time.tv_usec;
+    long long intervalUs = us - m_lastUs;
+
+    // A pause, a reversal or a clock step begins a new gesture at 1:1
+    if (m_lastUs == 0 || direction != m_direction || intervalUs <= 0 ||
+        intervalUs > static_cast<long long>(Config::ENCODER_ACCEL_IDLE_MS) * 1000) {
+        m_rate = 0.0;
+        m_carry = 0.0;
+    } else {
+        // Detents reported together still count as a fast turn, not an infinite one; the
+        // average starts from rest, so the gain ramps up over a spin instead of jumping
+        double instant = 1e6 / std::max<long long>(intervalUs, Config::ENCODER_ACCEL_MIN_INTERVAL_US);
+        m_rate += Config::ENCODER_ACCEL_SMOOTHING * (instant - m_rate);
+    }
+    m_lastUs = us;
+    m_direction = direction;
+
+    double exact = gainAt(m_rate) + m_carry;
+    int steps = static_cast<int>(exact);
+    m_carry = exact - steps;
+    return direction * steps;
+}
+
+void EncoderAcceleration::reset()
+{
+    m_lastUs = 0;
+    m_direction = 0;
+    m_rate = 0.0;
+    m_carry = 0.0;
+}
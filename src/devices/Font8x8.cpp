@@ -1,9 +1,11 @@
 // Create new file: src/devices/Font8x8.cpp
 
 #include "DeviceInterfaces.h"
+#include "FontTables.h"
 
 // 8x8 Font ASCII 0-127 based on https://github.com/dhepper/font8x8
-const uint8_t Font8x8::font8x8_basic[128][8] = {
+// constexpr so the pre-rotated tables below are generated by the compiler
+constexpr uint8_t Font8x8::font8x8_basic[128][8] = {
     { 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00},   // U+0000 (nul)
     { 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00},   // U+0001
     { 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00},   // U+0002
@@ -133,3 +135,88 @@ const uint8_t Font8x8::font8x8_basic[128][8] = {
     { 0x6E, 0x3B, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00},   // U+007E (~)
     { 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00}    // U+007F
 };
+
+namespace {
+
+template <int Width, int Pages>
+struct GlyphTable {
+    uint8_t bytes[128 * Pages * Width];
+};
+
+// Column c of a source glyph: font8x8 stores rows with bit 0 leftmost
+constexpr uint8_t sourceColumn(int glyph, int column)
+{
+    uint8_t bits = 0;
+    for (int row = 0; row < 8; row++) {
+        if (Font8x8::font8x8_basic[glyph][row] & (1 << column)) {
+            bits |= static_cast<uint8_t>(1 << row);
+        }
+    }
+    return bits;
+}
+
+constexpr GlyphTable<8, 1> makeNormal()
+{
+    GlyphTable<8, 1> table{};
+    for (int glyph = 0; glyph < 128; glyph++) {
+        for (int column = 0; column < 8; column++) {
+            table.bytes[glyph * 8 + column] = sourceColumn(glyph, column);
+        }
+    }
+    return table;
+}
+
+// The glyphs are at most 7 columns wide; folding columns 1+2 and 4+5 leaves
+// 5 columns and one column of spacing
+constexpr GlyphTable<6, 1> makeCondensed()
+{
+    GlyphTable<6, 1> table{};
+    for (int glyph = 0; glyph < 128; glyph++) {
+        uint8_t* out = &table.bytes[glyph * 6];
+        out[0] = sourceColumn(glyph, 0);
+        out[1] = sourceColumn(glyph, 1) | sourceColumn(glyph, 2);
+        out[2] = sourceColumn(glyph, 3);
+        out[3] = sourceColumn(glyph, 4) | sourceColumn(glyph, 5);
+        out[4] = sourceColumn(glyph, 6);
+        out[5] = 0;
+    }
+    return table;
+}
+
+constexpr GlyphTable<16, 2> makeLarge()
+{
+    GlyphTable<16, 2> table{};
+    for (int glyph = 0; glyph < 128; glyph++) {
+        for (int column = 0; column < 8; column++) {
+            uint8_t bits = sourceColumn(glyph, column);
+
+            // Double each row bit: rows 0-3 fill the top page, 4-7 the bottom
+            uint16_t tall = 0;
+            for (int row = 0; row < 8; row++) {
+                if (bits & (1 << row)) {
+                    tall |= static_cast<uint16_t>(3 << (row * 2));
+                }
+            }
+
+            for (int page = 0; page < 2; page++) {
+                uint8_t half = static_cast<uint8_t>(tall >> (page * 8));
+                uint8_t* out = &table.bytes[(glyph * 2 + page) * 16 + column * 2];
+                out[0] = half;
+                out[1] = half;
+            }
+        }
+    }
+    return table;
+}
+
+constexpr GlyphTable<8, 1> kNormal = makeNormal();
+constexpr GlyphTable<6, 1> kCondensed = makeCondensed();
+constexpr GlyphTable<16, 2> kLarge = makeLarge();
+
+} // namespace
+
+namespace Fonts {
+    const GlyphFace NORMAL = {8, 1, kNormal.bytes};
+    const GlyphFace CONDENSED = {6, 1, kCondensed.bytes};
+    const GlyphFace LARGE = {16, 2, kLarge.bytes};
+}
@@ -0,0 +1,302 @@
+#include "FrameBuffer.h"
+#include <algorithm>
+
+namespace {
+    enum SendMode : uint8_t {
+        NONE,       // Device already shows this op
+        PARTIAL,    // Only a character span changed
+        FULL        // Send the whole op
+    };
+
+    // Text as if padded with spaces to any length
+    char charAt(const FrameBuffer::Text& text, size_t index)
+    {
+        return index < text.size() ? text[index] : ' ';
+    }
+}
+
+FrameBuffer::FrameBuffer()
+{
+    m_pending.reserve(Config::MENU_VISIBLE_ITEMS + 4);
+    m_shown.reserve(Config::MENU_VISIBLE_ITEMS + 4);
+}
+
+void FrameBuffer::beginFrame()
+{
+    std::lock_guard<std::mutex> lock(m_mutex);
+    m_pending.clear();
+    m_dirty = true;
+}
+
+void FrameBuffer::drawText(int x, int y, const char* text, size_t length)
+{
+    if (length == 0) {
+        return;
+    }
+
+    std::lock_guard<std::mutex> lock(m_mutex);
+    addOp(textOp(x, y, text, length));
+}
+
+void FrameBuffer::drawProgressBar(int x, int y, int width, int height, int percentage)
+{
+    Op op;
+    op.type = OpType::PROGRESS_BAR;
+    op.x = x;
+    op.y = y;
+    op.width = width;
+    op.height = height;
+    op.percentage = std::max(0, std::min(100, percentage));
+
+    std::lock_guard<std::mutex> lock(m_mutex);
+    addOp(op);
+}
+
+void FrameBuffer::invalidate()
+{
+    std::lock_guard<std::mutex> lock(m_mutex);
+    m_forceFull = true;
+    m_dirty = true;
+}
+
+bool FrameBuffer::isDirty() const
+{
+    std::lock_guard<std::mutex> lock(m_mutex);
+    return m_dirty || m_forceFull;
+}
+
+size_t FrameBuffer::opBytes(const Op& op)
+{
+    if (op.type == OpType::TEXT) {
+        return 3 + op.text.size();
+    }
+    return 6;
+}
+
+FrameBuffer::Rect FrameBuffer::bounds(const Op& op)
+{
+    if (op.type == OpType::TEXT) {
+        return {op.x, op.y,
+                op.x + static_cast<int>(op.text.size()) * Config::CHAR_WIDTH,
+                op.y + Config::CHAR_HEIGHT};
+    }
+    return {op.x, op.y, op.x + op.width, op.y + op.height};
+}
+
+bool FrameBuffer::sameSlot(const Op& a, const Op& b)
+{
+    return a.type == b.type && a.x == b.x && a.y == b.y;
+}
+
+bool FrameBuffer::sameContent(const Op& a, const Op& b)
+{
+    if (a.type != b.type) {
+        return false;
+    }
+    if (a.type == OpType::TEXT) {
+        return a.text == b.text;
+    }
+    return a.width == b.width && a.height == b.height && a.percentage == b.percentage;
+}
+
+FrameBuffer::Op FrameBuffer::textOp(int x, int y, const char* text, size_t length)
+{
+    Op op;
+    op.type = OpType::TEXT;
+    op.x = x;
+    op.y = y;
+    op.text.assign(text, length);
+    return op;
+}
+
+bool FrameBuffer::isBlank(const Text& text)
+{
+    for (size_t i = 0; i < text.size(); i++) {
+        if (text[i] != ' ') {
+            return false;
+        }
+    }
+    return true;
+}
+
+void FrameBuffer::addOp(const Op& op)
+{
+    Rect area = bounds(op);
+
+    // A redraw of the same slot replaces the old op, and opaque text hides
+    // anything it fully covers, so neither needs to be retained
+    m_pending.erase(std::remove_if(m_pending.begin(), m_pending.end(),
+        [&](const Op& existing) {
+            if (sameSlot(existing, op)) {
+                return true;
+            }
+            return op.type == OpType::TEXT && area.contains(bounds(existing));
+        }), m_pending.end());
+
+    m_pending.push_back(op);
+    m_dirty = true;
+
+    // Modules that never clear can keep adding ops at new positions; rebuild
+    // from scratch rather than growing without bound
+    if (m_pending.size() > MAX_FRAME_OPS) {
+        m_pending.erase(m_pending.begin());
+        m_forceFull = true;
+    }
+}
+
+void FrameBuffer::appendEraseOps(const Op& op, std::vector<Op>& out) const
+{
+    Text blank;
+
+    if (op.type == OpType::TEXT) {
+        // Blank text leaves nothing behind to erase
+        if (!isBlank(op.text)) {
+            blank.resize(op.text.size());
+            out.push_back(textOp(op.x, op.y, blank.data(), blank.size()));
+        }
+        return;
+    }
+
+    // The protocol has no fill primitive, so blank the bar with rows of spaces
+    int columns = (op.width + Config::CHAR_WIDTH - 1) / Config::CHAR_WIDTH;
+    blank.resize(static_cast<size_t>(std::max(0, columns)));
+    for (int y = op.y; y < op.y + op.height; y += Config::CHAR_HEIGHT) {
+        out.push_back(textOp(op.x, y, blank.data(), blank.size()));
+    }
+}
+
+void FrameBuffer::present(Update& update)
+{
+    std::lock_guard<std::mutex> lock(m_mutex);
+    update.fullRedraw = false;
+    update.ops.clear();
+    update.bytes = 0;
+
+    if (!m_dirty && !m_forceFull) {
+        return;
+    }
+
+    // Cost of repainting everything after a clear
+    size_t fullBytes = 1;
+    for (const auto& op : m_pending) {
+        fullBytes += opBytes(op);
+    }
+
+    if (!m_forceFull) {
+        m_modes.assign(m_pending.size(), FULL);
+        m_spans.resize(m_pending.size());
+        m_matched.assign(m_shown.size(), 0);
+        m_damage.clear();
+        m_erasures.clear();
+
+        // Match pending ops to what the device shows, slot by slot
+        for (size_t i = 0; i < m_pending.size(); i++) {
+            const Op& op = m_pending[i];
+            for (size_t j = 0; j < m_shown.size(); j++) {
+                if (m_matched[j] || !sameSlot(op, m_shown[j])) {
+                    continue;
+                }
+                m_matched[j] = 1;
+
+                if (sameContent(op, m_shown[j])) {
+                    m_modes[i] = NONE;
+                } else if (op.type == OpType::TEXT) {
+                    // Only resend the span of characters that differ; padding
+                    // the new text with spaces erases a longer old tail
+                    const Text& oldText = m_shown[j].text;
+                    size_t length = std::max(oldText.size(), op.text.size());
+
+                    size_t first = 0;
+                    while (first < length && charAt(oldText, first) == charAt(op.text, first)) {
+                        first++;
+                    }
+                    if (first == length) {
+                        m_modes[i] = NONE;
+                    } else {
+                        size_t last = length - 1;
+                        while (last > first && charAt(oldText, last) == charAt(op.text, last)) {
+                            last--;
+                        }
+                        Text span;
+                        for (size_t k = first; k <= last; k++) {
+                            span.append(charAt(op.text, k));
+                        }
+                        m_spans[i] = textOp(op.x + static_cast<int>(first) * Config::CHAR_WIDTH, op.y,
+                                            span.data(), span.size());
+                        m_modes[i] = PARTIAL;
+                    }
+                }
+                break;
+            }
+        }
+
+        // Anything the device shows that is no longer in the frame gets erased
+        for (size_t j = 0; j < m_shown.size(); j++) {
+            if (!m_matched[j]) {
+                size_t start = m_erasures.size();
+                appendEraseOps(m_shown[j], m_erasures);
+                for (size_t k = start; k < m_erasures.size(); k++) {
+                    m_damage.push_back({-1, bounds(m_erasures[k])});
+                }
+            }
+        }
+
+        for (size_t i = 0; i < m_pending.size(); i++) {
+            if (m_modes[i] != NONE) {
+                m_damage.push_back({static_cast<int>(i), bounds(m_modes[i] == PARTIAL ? m_spans[i] : m_pending[i])});
+            }
+        }
+
+        // Erasures and redraws are opaque, so any op they overlap must be
+        // repainted in full; repeat until no new damage appears
+        bool changed = true;
+        while (changed) {
+            changed = false;
+            for (size_t i = 0; i < m_pending.size(); i++) {
+                if (m_modes[i] == FULL) {
+                    continue;
+                }
+                Rect r = bounds(m_pending[i]);
+                for (size_t d = 0; d < m_damage.size(); d++) {
+                    if (m_damage[d].owner != static_cast<int>(i) && r.intersects(m_damage[d].area)) {
+                        m_modes[i] = FULL;
+                        m_damage.push_back({static_cast<int>(i), r});
+                        changed = true;
+                        break;
+                    }
+                }
+            }
+        }
+
+        // Erasures go first, then draws in frame order so stacking is preserved
+        update.ops.assign(m_erasures.begin(), m_erasures.end());
+        for (size_t i = 0; i < m_pending.size(); i++) {
+            if (m_modes[i] == FULL) {
+                update.ops.push_back(m_pending[i]);
+            } else if (m_modes[i] == PARTIAL) {
+                update.ops.push_back(m_spans[i]);
+            }
+        }
+        for (const auto& op : update.ops) {
+            update.bytes += opBytes(op);
+        }
+    }
+
+    if (m_forceFull || update.bytes >= fullBytes) {
+        update.fullRedraw = true;
+        update.ops.clear();
+        update.bytes = 1;
+        for (const auto& op : m_pending) {
+            // Blank text is a no-op on a freshly cleared display
+            if (op.type == OpType::TEXT && isBlank(op.text)) {
+                continue;
+            }
+            update.ops.push_back(op);
+            update.bytes += opBytes(op);
+        }
+    }
+
+    m_shown = m_pending;
+    m_dirty = false;
+    m_forceFull = false;
+}
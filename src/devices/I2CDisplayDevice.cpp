@@ -3,19 +3,20 @@
 #include "DeviceInterfaces.h"
 #include "Config.h"
 #include "Logger.h"
+#include "PerfCounters.h"
 #include <iostream>
 #include <cstring>
 #include <cerrno>
 #include <unistd.h>
 #include <fcntl.h>
 #include <sys/ioctl.h>
+#include <linux/i2c.h>
 #include <linux/i2c-dev.h>
 #include <i2c/smbus.h>
 
 I2CDisplayDevice::I2CDisplayDevice(const std::string& devicePath)
     : BaseDisplayDevice(devicePath) {
-    std::memset(m_displayBuffer, 0, sizeof(m_displayBuffer));
-    Logger::debug("I2CDisplayDevice created for: " + devicePath);
+    LOG_DEBUG("I2CDisplayDevice created for: " + devicePath);
 }
 
 I2CDisplayDevice::~I2CDisplayDevice() {
@@ -23,7 +24,7 @@ I2CDisplayDevice::~I2CDisplayDevice() {
 }
 
 bool I2CDisplayDevice::open() {
-    Logger::debug("Opening I2C device: " + m_devicePath);
+    LOG_DEBUG("Opening I2C device: " + m_devicePath);
     
     // Open I2C device
     m_fd = ::open(m_devicePath.c_str(), O_RDWR);
@@ -40,7 +41,7 @@ bool I2CDisplayDevice::open() {
         return false;
     }
 
-    Logger::debug("I2C device opened successfully, initializing display...");
+    LOG_DEBUG("I2C device opened successfully, initializing display...");
 
     // Initialize the SSD1306 display
     if (!initializeDisplay()) {
@@ -85,13 +86,17 @@ bool I2CDisplayDevice::writeCommand(uint8_t command) {
 
     uint8_t data[2] = {0x00, command}; // Control byte 0x00 = command
     ssize_t result = write(m_fd, data, 2);
-    
+    PerfCounters& perf = PerfCounters::getInstance();
+    perf.add(PerfCounters::Counter::I2C_TRANSACTIONS);
+
     if (result != 2) {
+        perf.add(PerfCounters::Counter::I2C_ERRORS);
         std::cerr << "I2C command write failed: " << strerror(errno) << std::endl;
         m_disconnected.store(true);
         return false;
     }
 
+    perf.add(PerfCounters::Counter::I2C_BYTES, 2);
     return true;
 }
 
@@ -108,13 +113,17 @@ bool I2CDisplayDevice::writeData(const uint8_t* data, size_t length) {
     std::memcpy(buffer.data() + 1, data, length);
 
     ssize_t result = write(m_fd, buffer.data(), buffer.size());
-    
+    PerfCounters& perf = PerfCounters::getInstance();
+    perf.add(PerfCounters::Counter::I2C_TRANSACTIONS);
+
     if (result != static_cast<ssize_t>(buffer.size())) {
+        perf.add(PerfCounters::Counter::I2C_ERRORS);
         std::cerr << "I2C data write failed: " << strerror(errno) << std::endl;
         m_disconnected.store(true);
         return false;
     }
 
+    perf.add(PerfCounters::Counter::I2C_BYTES, buffer.size());
     return true;
 }
 
@@ -154,52 +163,45 @@ bool I2CDisplayDevice::initializeDisplay() {
     if (!writeCommand(SSD1306_DISPLAY_NORMAL)) return false;
     if (!writeCommand(SSD1306_DISPLAY_ON)) return false;
 
-    // Clear the display
+    // Clear the display, even when commits are deferred
     clear();
+    flushBuffer();
 
     std::cout << "SSD1306 initialization complete" << std::endl;
     return true;
 }
 
 void I2CDisplayDevice::clear() {
-    Logger::debug("I2CDisplayDevice::clear()");
+    LOG_DEBUG("I2CDisplayDevice::clear()");
     
-    // Clear framebuffer
-    std::memset(m_displayBuffer, 0, sizeof(m_displayBuffer));
-
-    // Set address range for whole display
-    writeCommand(SSD1306_PAGE_ADDR);
-    writeCommand(0);
-    writeCommand(DISPLAY_PAGES - 1);
-    writeCommand(SSD1306_COLUMN_ADDR);
-    writeCommand(0);
-    writeCommand(DISPLAY_WIDTH - 1);
-
-    // Send cleared buffer to display
-    writeData(m_displayBuffer, sizeof(m_displayBuffer));
-
-    // Reset cursor position
-    m_cursorX = 0;
-    m_cursorY = 0;
+    // Clear framebuffer and mark the whole display for the next flush
+    m_frame.clear();
+
+    if (!m_deferredCommit) {
+        flushBuffer();
+    }
 }
 
-void I2CDisplayDevice::drawText(int x, int y, const std::string& text) {
-    Logger::debug("I2CDisplayDevice::drawText(" + std::to_string(x) + "," + std::to_string(y) + ",\"" + text + "\")");
-    
-    setCursor(x, y);
+void I2CDisplayDevice::drawText(int x, int y, const char* text, size_t length) {
+    if (Logger::isVerbose()) {
+        LOG_DEBUG("I2CDisplayDevice::drawText(" + std::to_string(x) + "," + std::to_string(y) + ",\"" +
+                  std::string(text, length) + "\")");
+    }
     
-    for (char c : text) {
-        drawCharacter(c);
+    m_frame.drawText(x, y, text, length);
+
+    // Commit the whole string at once rather than glyph by glyph
+    if (!m_deferredCommit) {
+        flushBuffer();
     }
 }
 
 void I2CDisplayDevice::setCursor(int x, int y) {
-    m_cursorX = static_cast<uint8_t>(x);
-    m_cursorY = static_cast<uint8_t>(y);
+    m_frame.setCursor(x, y);
 }
 
 void I2CDisplayDevice::setInverted(bool inverted) {
-    Logger::debug("I2CDisplayDevice::setInverted(" + std::string(inverted ? "true" : "false") + ")");
+    LOG_DEBUG("I2CDisplayDevice::setInverted(" + std::string(inverted ? "true" : "false") + ")");
     
     m_inverted = inverted;
     
@@ -211,7 +213,7 @@ void I2CDisplayDevice::setInverted(bool inverted) {
 }
 
 void I2CDisplayDevice::setBrightness(int brightness) {
-    Logger::debug("I2CDisplayDevice::setBrightness(" + std::to_string(brightness) + ")");
+    LOG_DEBUG("I2CDisplayDevice::setBrightness(" + std::to_string(brightness) + ")");
     
     // Clamp brightness to valid range
     uint8_t contrast = static_cast<uint8_t>(brightness > 255 ? 255 : (brightness < 0 ? 0 : brightness));
@@ -221,56 +223,18 @@ void I2CDisplayDevice::setBrightness(int brightness) {
 }
 
 void I2CDisplayDevice::drawProgressBar(int x, int y, int width, int height, int percentage) {
-    Logger::debug("I2CDisplayDevice::drawProgressBar(" + std::to_string(x) + "," + std::to_string(y) + "," +
+    LOG_DEBUG("I2CDisplayDevice::drawProgressBar(" + std::to_string(x) + "," + std::to_string(y) + "," +
                   std::to_string(width) + "," + std::to_string(height) + "," + std::to_string(percentage) + "%)");
     
-    // Ensure progress is within range
-    if (percentage > 100) percentage = 100;
-    if (percentage < 0) percentage = 0;
-
-    // Calculate progress width in pixels
-    int progressWidth = (width * percentage) / 100;
-
-    // Calculate which pages the bar spans
-    int startPage = y / 8;
-    int endPage = (y + height - 1) / 8;
-
-    // Draw the progress bar
-    for (int page = startPage; page <= endPage && page < DISPLAY_PAGES; page++) {
-        for (int col = x; col < x + width && col < DISPLAY_WIDTH; col++) {
-            uint8_t mask = 0;
-
-            // Calculate which bits in the byte should be set
-            for (int bit = 0; bit < 8; bit++) {
-                int pixelY = page * 8 + bit;
-                if (pixelY >= y && pixelY < y + height) {
-                    // This bit is part of the progress bar
-                    if (col == x || col == x + width - 1 ||
-                        pixelY == y || pixelY == y + height - 1) {
-                        // This pixel is part of the border
-                        mask |= (1 << bit);
-                    }
-                    else if (col < x + progressWidth) {
-                        // This pixel is part of the filled area
-                        mask |= (1 << bit);
-                    }
-                }
-            }
-
-            // Update display buffer
-            int pos = page * DISPLAY_WIDTH + col;
-            if (pos < static_cast<int>(sizeof(m_displayBuffer))) {
-                m_displayBuffer[pos] = mask;
-            }
-        }
-    }
+    m_frame.drawProgressBar(x, y, width, height, percentage);
 
-    // Update the affected display region
-    updateDisplay(startPage, endPage, x, x + width - 1);
+    if (!m_deferredCommit) {
+        flushBuffer();
+    }
 }
 
 void I2CDisplayDevice::setPower(bool on) {
-    Logger::debug("I2CDisplayDevice::setPower(" + std::string(on ? "true" : "false") + ")");
+    LOG_DEBUG("I2CDisplayDevice::setPower(" + std::string(on ? "true" : "false") + ")");
     
     if (on) {
         writeCommand(SSD1306_DISPLAY_ON);
@@ -279,83 +243,103 @@ void I2CDisplayDevice::setPower(bool on) {
     }
 }
 
-void I2CDisplayDevice::drawCharacter(char c) {
-    if (c < 0 || c > 127) c = '?'; // Handle non-ASCII chars
+void I2CDisplayDevice::flushBuffer() {
+    std::lock_guard<std::mutex> lock(m_mutex);
 
-    // Calculate buffer position
-    int page = m_cursorY / 8;  // Page = y / 8
-    int col = m_cursorX;       // Column = x
+    if (!isOpen()) {
+        return;
+    }
 
-    // Check bounds
-    if (page >= DISPLAY_PAGES || col > DISPLAY_WIDTH - 8) {
+    // Each window costs an address command write plus a data control byte
+    std::vector<MonoFrame::Window> windows = m_frame.takeDirtyWindows(sizeof(m_txCommands[0]) + 1);
+    if (windows.empty()) {
         return;
     }
 
-    // Get character data and transpose it (convert rows to columns)
-    // This matches your RP2040 implementation
-    uint8_t transposed[8] = {0};
+    Segment segments[DISPLAY_PAGES * 2];
+    size_t segmentCount = 0;
+    size_t dataUsed = 0;
+
+    for (const auto& window : windows) {
+        uint8_t* cmd = m_txCommands[segmentCount / 2];
+        cmd[0] = 0x00; // Control byte 0x00 = command stream
+        cmd[1] = SSD1306_PAGE_ADDR;
+        cmd[2] = static_cast<uint8_t>(window.firstPage);
+        cmd[3] = static_cast<uint8_t>(window.lastPage);
+        cmd[4] = SSD1306_COLUMN_ADDR;
+        cmd[5] = static_cast<uint8_t>(window.firstColumn);
+        cmd[6] = static_cast<uint8_t>(window.lastColumn);
+        segments[segmentCount++] = {cmd, sizeof(m_txCommands[0])};
+
+        uint8_t* data = m_txData + dataUsed;
+        data[0] = 0x40; // Control byte 0x40 = data
+        size_t length = 1 + m_frame.copyWindow(window, data + 1);
+        dataUsed += length;
+        segments[segmentCount++] = {data, length};
+    }
 
-    // Transpose the character (swap rows and columns)
-    for (int srcRow = 0; srcRow < 8; srcRow++) {
-        uint8_t srcByte = Font8x8::font8x8_basic[static_cast<uint8_t>(c)][srcRow];
+    transferSegments(segments, segmentCount);
+}
 
-        for (int srcCol = 0; srcCol < 8; srcCol++) {
-            if (srcByte & (1 << srcCol)) {
-                // Set the corresponding bit in the transposed character
-                transposed[srcCol] |= (1 << srcRow);
-            }
-        }
+void I2CDisplayDevice::blit(const MonoFrame::Window& window, const uint8_t* pixels) {
+    m_frame.writeWindow(window, pixels);
+
+    if (!m_deferredCommit) {
+        flushBuffer();
     }
+}
 
-    // Copy transposed character to buffer
-    for (int i = 0; i < 8; i++) {
-        if (col + i < DISPLAY_WIDTH) {
-            int pos = page * DISPLAY_WIDTH + (col + i);
-            if (pos < static_cast<int>(sizeof(m_displayBuffer))) {
-                m_displayBuffer[pos] = transposed[i];
-            }
-        }
+// Caller holds m_mutex
+bool I2CDisplayDevice::transferSegments(const Segment* segments, size_t count) {
+    PerfCounters& perf = PerfCounters::getInstance();
+    size_t bytes = 0;
+    for (size_t i = 0; i < count; i++) {
+        bytes += segments[i].length;
     }
 
-    // Update the display for this character
-    updateDisplay(page, page, col, col + 7);
+    if (m_rdwrSupported) {
+        // Send every segment in one combined transaction
+        struct i2c_msg msgs[DISPLAY_PAGES * 2];
+        for (size_t i = 0; i < count; i++) {
+            msgs[i].addr = SSD1306_ADDR;
+            msgs[i].flags = 0;
+            msgs[i].len = static_cast<__u16>(segments[i].length);
+            msgs[i].buf = const_cast<__u8*>(segments[i].data);
+        }
+
+        struct i2c_rdwr_ioctl_data request;
+        request.msgs = msgs;
+        request.nmsgs = static_cast<__u32>(count);
 
-    // Advance cursor - move 8 pixels to the right
-    m_cursorX += 8;
+        if (ioctl(m_fd, I2C_RDWR, &request) >= 0) {
+            perf.add(PerfCounters::Counter::I2C_TRANSACTIONS);
+            perf.add(PerfCounters::Counter::I2C_BYTES, bytes);
+            return true;
+        }
 
-    // Wrap to next line if needed
-    if (m_cursorX > DISPLAY_WIDTH - 8) {
-        m_cursorX = 0;
-        m_cursorY += 8; // Move down one character row (8 pixels)
-        if (m_cursorY >= DISPLAY_HEIGHT) {
-            m_cursorY = 0; // Wrap to top if we reach the bottom
+        if (errno == EINVAL || errno == ENOTTY || errno == EOPNOTSUPP) {
+            // Adapter can't do combined transfers; use plain writes from now on
+            LOG_DEBUG("I2C_RDWR not supported, falling back to write()");
+            m_rdwrSupported = false;
+        } else {
+            perf.add(PerfCounters::Counter::I2C_ERRORS);
+            std::cerr << "I2C transfer failed: " << strerror(errno) << std::endl;
+            m_disconnected.store(true);
+            return false;
         }
     }
-}
 
-void I2CDisplayDevice::updateDisplay(int startPage, int endPage, int startCol, int endCol) {
-    // Clamp values to valid ranges
-    if (startPage < 0) startPage = 0;
-    if (endPage >= DISPLAY_PAGES) endPage = DISPLAY_PAGES - 1;
-    if (startCol < 0) startCol = 0;
-    if (endCol >= DISPLAY_WIDTH) endCol = DISPLAY_WIDTH - 1;
-
-    // Update each page in the specified region
-    for (int page = startPage; page <= endPage; page++) {
-        // Set page and column address range
-        writeCommand(SSD1306_PAGE_ADDR);
-        writeCommand(static_cast<uint8_t>(page));
-        writeCommand(static_cast<uint8_t>(page));
-        writeCommand(SSD1306_COLUMN_ADDR);
-        writeCommand(static_cast<uint8_t>(startCol));
-        writeCommand(static_cast<uint8_t>(endCol));
-
-        // Send the data for this region
-        int dataStart = page * DISPLAY_WIDTH + startCol;
-        int dataLength = endCol - startCol + 1;
-        
-        if (dataStart >= 0 && dataStart + dataLength <= static_cast<int>(sizeof(m_displayBuffer))) {
-            writeData(&m_displayBuffer[dataStart], dataLength);
+    for (size_t i = 0; i < count; i++) {
+        ssize_t result = write(m_fd, segments[i].data, segments[i].length);
+        perf.add(PerfCounters::Counter::I2C_TRANSACTIONS);
+        if (result != static_cast<ssize_t>(segments[i].length)) {
+            perf.add(PerfCounters::Counter::I2C_ERRORS);
+            std::cerr << "I2C write failed: " << strerror(errno) << std::endl;
+            m_disconnected.store(true);
+            return false;
         }
     }
+
+    perf.add(PerfCounters::Counter::I2C_BYTES, bytes);
+    return true;
 }
@@ -1,6 +1,7 @@
 #include "DeviceInterfaces.h"
 #include "Config.h"
 #include "Logger.h"
+#include "PerfCounters.h"
 #include <cstring>
 #include <cerrno>
 #include <iostream>
@@ -157,26 +158,57 @@ int InputDevice::waitForEvents(int timeoutMs)
 }
 
 // NEW: Process pending keyboard synthesis events (simplified - no longer needed for single events)
-void InputDevice::processKeyboardSynthesis(std::function<void(int)> onRotation)
+void InputDevice::processKeyboardSynthesis(const InputHandler& onEvent)
 {
     // NOTE: Currently not used since we switched to single events for keyboards
     // Keeping the function for future use if needed
-    (void)onRotation; // Suppress unused parameter warning
+    (void)onEvent; // Suppress unused parameter warning
 }
 
+namespace {
+
+long elapsedMs(const struct timeval& from, const struct timeval& to)
+{
+    return (to.tv_sec - from.tv_sec) * 1000 + (to.tv_usec - from.tv_usec) / 1000;
+}
+
+} // namespace
+
 bool InputDevice::processEvents(std::function<void(int)> onRotation, std::function<void()> onButtonPress)
+{
+    return processEvents([&](const InputEvent& event) {
+        if (event.isMovement()) {
+            if (onRotation) {
+                onRotation(event.steps());
+            }
+        } else if (event.type == InputEvent::Type::PRESS && onButtonPress) {
+            onButtonPress();
+        }
+    });
+}
+
+bool InputDevice::processEvents(const InputHandler& onEvent)
 {
     if (!isOpen()) {
         std::cerr << "Input device not open in processEvents" << std::endl;
         return false;
     }
 
+    // Every delivered event may start an input-to-flush latency span
+    InputHandler timed = [&onEvent](const InputEvent& event) {
+        PerfCounters::getInstance().markInput(event.time);
+        onEvent(event);
+    };
+
     // First, process any pending keyboard synthesis events
-    processKeyboardSynthesis(onRotation);
+    processKeyboardSynthesis(timed);
 
-    struct input_event ev;
+    struct input_event events[Config::INPUT_READ_BATCH];
     int eventCount = 0;
-    int btnPress = 0;
+    InputEvent press;
+    InputEvent longPress;
+    bool btnPress = false;
+    bool btnLongPress = false;
     bool pendingMovement = false;
     bool pendingVerticalMovement = false;
     struct timeval now;
@@ -184,193 +216,148 @@ bool InputDevice::processEvents(std::function<void(int)> onRotation, std::functi
     // Read and coalesce events
     ssize_t bytesRead;
     if (Logger::isVerbose()) {
-        Logger::debug("Starting processEvents - device fd=" + std::to_string(m_fd));
+        LOG_DEBUG("Starting processEvents - device fd=" + std::to_string(m_fd));
     }
-    while ((bytesRead = read(m_fd, &ev, sizeof(ev))) > 0 && eventCount < Config::MAX_EVENTS_PER_ITERATION) {
-        if (Logger::isVerbose()) {
-            Logger::debug("Input event received: type=" + std::to_string(ev.type) +
-                         " code=" + std::to_string(ev.code) +
-                         " value=" + std::to_string(ev.value));
-        }
-
-        // Handle SYN_REPORT events (type 0)
-        if (ev.type == 0) {
-            continue;
-        }
-
-        // Handle EV_KEY events (both keyboard keys and mouse buttons)
-        if (ev.type == EV_KEY) {
-            // Handle BTN_LEFT (RP2040 enter button) - EXISTING FUNCTIONALITY
-            if (ev.code == BTN_LEFT && ev.value == 1) {
-                // Mouse left button press (value 1 = pressed) - EXISTING
-                if (Logger::isVerbose()) {
-                    Logger::debug("BTN_LEFT press detected (RP2040 enter button)");
-                }
-                btnPress = 1;
-                eventCount++;
+    // Drain everything queued in as few reads as possible: a fast spin is many events per wakeup
+    while ((bytesRead = read(m_fd, events, sizeof(events))) > 0) {
+        size_t count = static_cast<size_t>(bytesRead) / sizeof(events[0]);
+        for (size_t i = 0; i < count; i++) {
+            const struct input_event& ev = events[i];
+            if (Logger::isVerbose()) {
+                LOG_DEBUG("Input event received: type=" + std::to_string(ev.type) +
+                             " code=" + std::to_string(ev.code) +
+                             " value=" + std::to_string(ev.value));
             }
-            // NEW: Handle keyboard keys - only process key press events (value == 1)
-            else if (ev.value == 1) {
-                gettimeofday(&now, nullptr);
 
-                switch (ev.code) {
-                    case KEY_LEFT: // 105
-                        if (Logger::isVerbose()) {
-                            Logger::debug("KEY_LEFT press detected - sending single REL_X event");
-                        }
-                        // Send single event immediately (no dual events for keyboard)
-                        if (onRotation) {
-                            onRotation(-5);
-                        }
-                        eventCount++;
-                        break;
+            // Handle SYN_REPORT events (type 0)
+            if (ev.type == 0) {
+                continue;
+            }
 
-                    case KEY_RIGHT: // 106
+            // Handle EV_KEY events (both keyboard keys and mouse buttons)
+            if (ev.type == EV_KEY) {
+                // BTN_LEFT (RP2040 enter button) and KEY_ENTER: press on down,
+                // long press on a late release
+                if (ev.code == BTN_LEFT || ev.code == KEY_ENTER) {
+                    if (ev.value == 1) {
                         if (Logger::isVerbose()) {
-                            Logger::debug("KEY_RIGHT press detected - sending single REL_X event");
-                        }
-                        // Send single event immediately (no dual events for keyboard)
-                        if (onRotation) {
-                            onRotation(5);
+                            LOG_DEBUG(ev.code == BTN_LEFT ? "BTN_LEFT press detected (RP2040 enter button)"
+                                                          : "KEY_ENTER press detected");
                         }
+                        press.type = InputEvent::Type::PRESS;
+                        press.time = ev.time;
+                        btnPress = true;
+                        m_state.pressTime = ev.time;
                         eventCount++;
-                        break;
-
-                    case KEY_UP: // 103
-                        if (Logger::isVerbose()) {
-                            Logger::debug("KEY_UP press detected - sending single REL_Y event");
-                        }
-                        // Send single event immediately (no dual events for keyboard)
-                        if (onRotation) {
-                            onRotation(-5);  // UP moves menu selection up
+                    } else if (ev.value == 0 && m_state.pressTime.tv_sec != 0) {
+                        if (elapsedMs(m_state.pressTime, ev.time) >= Config::LONG_PRESS_MS) {
+                            LOG_DEBUG("Long press detected");
+                            longPress.type = InputEvent::Type::LONG_PRESS;
+                            longPress.time = ev.time;
+                            btnLongPress = true;
+                            eventCount++;
                         }
-                        eventCount++;
-                        break;
-
-                    case KEY_DOWN: // 108
+                        m_state.pressTime = {0, 0};
+                    }
+                }
+                // NEW: Handle keyboard keys - only process key press events (value == 1)
+                else if (ev.value == 1) {
+                    InputEvent key;
+                    key.type = InputEvent::Type::KEY;
+                    key.time = ev.time;
+
+                    // Send single event immediately (no dual events for keyboard)
+                    switch (ev.code) {
+                        case KEY_LEFT: // 105
+                            key.key = InputEvent::Key::LEFT;
+                            key.delta = -5;
+                            break;
+                        case KEY_RIGHT: // 106
+                            key.key = InputEvent::Key::RIGHT;
+                            key.delta = 5;
+                            break;
+                        case KEY_UP: // 103
+                            key.key = InputEvent::Key::UP;
+                            key.delta = -5;  // UP moves menu selection up
+                            break;
+                        case KEY_DOWN: // 108
+                            key.key = InputEvent::Key::DOWN;
+                            key.delta = 5;   // DOWN moves menu selection down
+                            break;
+                        default:
+                            // Ignore other keys
+                            break;
+                    }
+
+                    if (key.key != InputEvent::Key::NONE) {
                         if (Logger::isVerbose()) {
-                            Logger::debug("KEY_DOWN press detected - sending single REL_Y event");
+                            LOG_DEBUG("Key " + std::to_string(ev.code) + " press detected - delta " +
+                                      std::to_string(key.delta));
                         }
-                        // Send single event immediately (no dual events for keyboard)
-                        if (onRotation) {
-                            onRotation(5);   // DOWN moves menu selection down
+                        if (onEvent) {
+                            timed(key);
                         }
                         eventCount++;
-                        break;
-
-                    case KEY_ENTER: // 28
-                        if (Logger::isVerbose()) {
-                            Logger::debug("KEY_ENTER press detected");
-                        }
-                        btnPress = 1;
-                        eventCount++;
-                        break;
-
-                    default:
-                        // Ignore other keys
-                        break;
+                    }
                 }
+                // Continue to next event
+                continue;
             }
-            // Continue to next event
-            continue;
-        }
-
-        // EXISTING: Process relative movement events (rotary encoder)
-        else if (ev.type == EV_REL && ev.code == REL_X) {
-            //std::cout << "Rotary encoder movement detected! Value: " << ev.value << std::endl;
-
-            // Get current time
-            gettimeofday(&now, nullptr);
-
-            // Calculate time diff in milliseconds since last event
-            long timeDiffMs = 0;
-            if (m_state.lastEventTime.tv_sec != 0) {
-                timeDiffMs = (now.tv_sec - m_state.lastEventTime.tv_sec) * 1000 +
-                           (now.tv_usec - m_state.lastEventTime.tv_usec) / 1000;
-            }
-
-            // Update the last event time
-            m_state.lastEventTime = now;
-
-            // Reset paired count if this is a new movement after a long gap
-            if (timeDiffMs > 100) {
-                m_state.pairedEventCount = 0;
-                m_state.totalRelX = 0;
-                m_state.totalRelY = 0;
-            }
-
-            // Accumulate the value
-            m_state.totalRelX += ev.value;
-            m_state.pairedEventCount++;
-            pendingMovement = true;
 
-            //std::cout << "Accumulated REL_X: " << m_state.totalRelX
-            //          << " (paired events: " << m_state.pairedEventCount << ")" << std::endl;
-
-            eventCount++;
-        }
-        else if (ev.type == EV_REL && ev.code == REL_Y) {
-            //std::cout << "Vertical movement detected! Value: " << ev.value << std::endl;
-
-            // Get current time
-            gettimeofday(&now, nullptr);
-
-            // Calculate time diff in milliseconds since last event
-            long timeDiffMs = 0;
-            if (m_state.lastEventTime.tv_sec != 0) {
-                timeDiffMs = (now.tv_sec - m_state.lastEventTime.tv_sec) * 1000 +
-                           (now.tv_usec - m_state.lastEventTime.tv_usec) / 1000;
-            }
+            // EXISTING: Process relative movement events (rotary encoder)
+            else if (ev.type == EV_REL && (ev.code == REL_X || ev.code == REL_Y)) {
+                // Reset paired count if this is a new movement after a long gap
+                if (m_state.lastEventTime.tv_sec != 0 && elapsedMs(m_state.lastEventTime, ev.time) > 100) {
+                    m_state.pairedEventCount = 0;
+                    m_state.totalRelX = 0;
+                    m_state.totalRelY = 0;
+                }
 
-            // Update the last event time
-            m_state.lastEventTime = now;
+                // Update the last event time
+                m_state.lastEventTime = ev.time;
+
+                // Accumulate the value, scaled by how fast the knob turns (the zero partner adds nothing)
+                int steps = m_acceleration.step(ev.value, ev.time);
+                if (ev.code == REL_X) {
+                    m_state.totalRelX += steps;
+                    pendingMovement = true;
+                } else {
+                    m_state.totalRelY += steps;
+                    pendingVerticalMovement = true;
+                }
+                m_state.pairedEventCount++;
 
-            // Reset paired count if this is a new movement after a long gap
-            if (timeDiffMs > 100) {
-                m_state.pairedEventCount = 0;
-                m_state.totalRelX = 0;
-                m_state.totalRelY = 0;
+                eventCount++;
             }
-
-            // Accumulate the value
-            m_state.totalRelY += ev.value;
-            m_state.pairedEventCount++;
-            pendingVerticalMovement = true;
-
-            //std::cout << "Accumulated REL_Y: " << m_state.totalRelY
-            //          << " (paired events: " << m_state.pairedEventCount << ")" << std::endl;
-
-            eventCount++;
         }
-        // Remove the duplicate BTN_LEFT handling since it's now handled above
-        // (The old BTN_LEFT handling code was here but is now moved up to the EV_KEY section)
-
-        // Avoid processing too many events at once
-        if (eventCount >= Config::MAX_EVENTS_PER_ITERATION) {
-            break;
+        if (static_cast<size_t>(bytesRead) < sizeof(events)) {
+            break;      // Short read: nothing more queued
         }
     }
 
     if (bytesRead < 0) {
         if (errno != EAGAIN) {
             if (Logger::isVerbose()) {
-                Logger::debug("Error reading from input device: " + std::string(strerror(errno)));
+                LOG_DEBUG("Error reading from input device: " + std::string(strerror(errno)));
             }
         } else if (Logger::isVerbose()) {
-            Logger::debug("No events available (EAGAIN)");
+            LOG_DEBUG("No events available (EAGAIN)");
         }
     } else if (bytesRead == 0 && Logger::isVerbose()) {
-        Logger::debug("No bytes read (EOF)");
+        LOG_DEBUG("No bytes read (EOF)");
     }
 
     // Process button press if detected
-    if (btnPress && onButtonPress) {
+    if (btnPress && onEvent) {
         if (Logger::isVerbose()) {
-            Logger::debug("Calling button press callback");
+            LOG_DEBUG("Calling button press callback");
         }
-        onButtonPress();
-    } else if (btnPress && !onButtonPress && Logger::isVerbose()) {
-        Logger::debug("Button press detected but no callback provided");
+        timed(press);
+    } else if (btnPress && !onEvent && Logger::isVerbose()) {
+        LOG_DEBUG("Button press detected but no callback provided");
+    }
+    if (btnLongPress && onEvent) {
+        timed(longPress);
     }
 
     // EXISTING: Handle relative movement processing
@@ -378,27 +365,32 @@ bool InputDevice::processEvents(std::function<void(int)> onRotation, std::functi
     // 1. We've received 2 or more events (paired_event_count >= 2), which means we've seen both events from one rotation
     // 2. OR if it's been more than 30ms since the last event, which means we might not get a paired event
     gettimeofday(&now, nullptr);
-    long timeSinceLastMs = (m_state.lastEventTime.tv_sec - m_state.lastEventTime.tv_sec) * 1000 +
-                         (now.tv_usec - m_state.lastEventTime.tv_usec) / 1000;
+    long timeSinceLastMs = elapsedMs(m_state.lastEventTime, now);
 
     if ((pendingMovement || pendingVerticalMovement) &&
         (m_state.pairedEventCount >= 2 || timeSinceLastMs > Config::EVENT_PROCESS_THRESHOLD)) {
+        InputEvent rotation;
+        rotation.type = InputEvent::Type::ROTATE;
+        rotation.time = m_state.lastEventTime;
+
         // Process horizontal movement (REL_X)
-        if (m_state.totalRelX != 0 && onRotation) {
+        if (m_state.totalRelX != 0 && onEvent) {
             if (Logger::isVerbose()) {
-                Logger::debug("Calling rotation callback with REL_X value: " + std::to_string(m_state.totalRelX));
+                LOG_DEBUG("Calling rotation callback with REL_X value: " + std::to_string(m_state.totalRelX));
             }
-            onRotation(m_state.totalRelX);
+            rotation.delta = m_state.totalRelX;
+            timed(rotation);
         }
 
         // Process vertical movement (REL_Y)
         // For vertical movement, we invert the value as up should be positive (REL_Y is negative for up)
-        if (m_state.totalRelY != 0 && onRotation) {
+        if (m_state.totalRelY != 0 && onEvent) {
             if (Logger::isVerbose()) {
-                Logger::debug("Calling rotation callback with REL_Y value: " + std::to_string(-m_state.totalRelY));
+                LOG_DEBUG("Calling rotation callback with REL_Y value: " + std::to_string(-m_state.totalRelY));
             }
             // Invert Y value for more intuitive direction (negative is down, positive is up)
-            onRotation(-m_state.totalRelY);
+            rotation.delta = -m_state.totalRelY;
+            timed(rotation);
         }
 
         // Reset tracking variables
@@ -407,16 +399,8 @@ bool InputDevice::processEvents(std::function<void(int)> onRotation, std::functi
         m_state.totalRelY = 0;
     }
 
-    // If we processed the maximum events, flush any remaining
-    if (eventCount >= Config::MAX_EVENTS_PER_ITERATION) {
-        // Drain input buffer
-        while (read(m_fd, &ev, sizeof(ev)) > 0) {
-            // Just drain, don't process
-        }
-    }
-
     if (Logger::isVerbose()) {
-        Logger::debug("processEvents returning with eventCount=" + std::to_string(eventCount));
+        LOG_DEBUG("processEvents returning with eventCount=" + std::to_string(eventCount));
     }
     return eventCount > 0;
 }
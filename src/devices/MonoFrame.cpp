@@ -0,0 +1,263 @@
+#include "MonoFrame.h"
+#include <cstring>
+
+namespace {
+
+// Constant sizes let the compiler emit plain 64/128-bit moves
+inline void copyColumns(uint8_t* dest, const uint8_t* src, int width)
+{
+    switch (width) {
+    case 8:  std::memcpy(dest, src, 8); break;
+    case 16: std::memcpy(dest, src, 16); break;
+    default: std::memcpy(dest, src, width); break;
+    }
+}
+
+} // namespace
+
+MonoFrame::MonoFrame()
+{
+    std::memset(m_buffer, 0, sizeof(m_buffer));
+    resetDirty();
+}
+
+void MonoFrame::resetDirty()
+{
+    for (int page = 0; page < PAGES; page++) {
+        m_dirtyStart[page] = WIDTH;
+        m_dirtyEnd[page] = -1;
+    }
+}
+
+void MonoFrame::clear()
+{
+    std::memset(m_buffer, 0, sizeof(m_buffer));
+    markAllDirty();
+
+    // Reset cursor position
+    m_cursorX = 0;
+    m_cursorY = 0;
+}
+
+void MonoFrame::setCursor(int x, int y)
+{
+    m_cursorX = static_cast<uint8_t>(x);
+    m_cursorY = static_cast<uint8_t>(y);
+}
+
+void MonoFrame::drawText(int x, int y, const std::string& text)
+{
+    drawText(x, y, text, Fonts::NORMAL);
+}
+
+void MonoFrame::drawText(int x, int y, const std::string& text, const GlyphFace& face)
+{
+    setCursor(x, y);
+    drawRun(text.data(), text.size(), face);
+}
+
+void MonoFrame::drawText(int x, int y, const char* text, size_t length)
+{
+    setCursor(x, y);
+    drawRun(text, length, Fonts::NORMAL);
+}
+
+void MonoFrame::drawCharacter(char c)
+{
+    drawRun(&c, 1, Fonts::NORMAL);
+}
+
+void MonoFrame::drawRun(const char* text, size_t length, const GlyphFace& face)
+{
+    while (length > 0) {
+        int page = m_cursorY / 8;
+        int col = m_cursorX;
+
+        // Glyphs are never clipped horizontally; out of range text is dropped
+        if (page >= PAGES || col > WIDTH - face.width) {
+            return;
+        }
+
+        // Everything up to the end of the line goes out as one run
+        size_t count = static_cast<size_t>((WIDTH - col) / face.width);
+        if (count > length) count = length;
+
+        blitGlyphs(page, col, text, count, face);
+        text += count;
+        length -= count;
+
+        m_cursorX = static_cast<uint8_t>(col + count * face.width);
+
+        // Wrap to next line if needed
+        if (m_cursorX > WIDTH - face.width) {
+            m_cursorX = 0;
+            m_cursorY += 8 * face.pages;
+            if (m_cursorY >= HEIGHT) {
+                m_cursorY = 0; // Wrap to top if we reach the bottom
+            }
+        }
+    }
+}
+
+void MonoFrame::blitGlyphs(int page, int col, const char* text, size_t count, const GlyphFace& face)
+{
+    int lastPage = page + face.pages - 1;
+    if (lastPage >= PAGES) lastPage = PAGES - 1;   // Tall faces lose their bottom rows
+
+    // Glyph pages are stored in column order already, so each glyph is one
+    // copy per page
+    for (int glyphPage = 0; page + glyphPage <= lastPage; glyphPage++) {
+        uint8_t* dest = &m_buffer[(page + glyphPage) * WIDTH + col];
+        for (size_t i = 0; i < count; i++) {
+            copyColumns(dest, face.glyph(text[i], glyphPage), face.width);
+            dest += face.width;
+        }
+    }
+
+    markDirty(page, lastPage, col, col + static_cast<int>(count) * face.width - 1);
+}
+
+void MonoFrame::drawProgressBar(int x, int y, int width, int height, int percentage)
+{
+    // Ensure progress is within range
+    if (percentage > 100) percentage = 100;
+    if (percentage < 0) percentage = 0;
+
+    // Calculate progress width in pixels
+    int progressWidth = (width * percentage) / 100;
+
+    // Calculate which pages the bar spans
+    int startPage = y / 8;
+    int endPage = (y + height - 1) / 8;
+
+    // Draw the progress bar
+    for (int page = startPage; page <= endPage && page < PAGES; page++) {
+        for (int col = x; col < x + width && col < WIDTH; col++) {
+            uint8_t mask = 0;
+
+            // Calculate which bits in the byte should be set
+            for (int bit = 0; bit < 8; bit++) {
+                int pixelY = page * 8 + bit;
+                if (pixelY >= y && pixelY < y + height) {
+                    // This bit is part of the progress bar
+                    if (col == x || col == x + width - 1 ||
+                        pixelY == y || pixelY == y + height - 1) {
+                        // This pixel is part of the border
+                        mask |= (1 << bit);
+                    }
+                    else if (col < x + progressWidth) {
+                        // This pixel is part of the filled area
+                        mask |= (1 << bit);
+                    }
+                }
+            }
+
+            // Update display buffer
+            int pos = page * WIDTH + col;
+            if (pos >= 0 && pos < static_cast<int>(SIZE)) {
+                m_buffer[pos] = mask;
+            }
+        }
+    }
+
+    // Update the affected display region
+    markDirty(startPage, endPage, x, x + width - 1);
+}
+
+void MonoFrame::markDirty(int startPage, int endPage, int startCol, int endCol)
+{
+    // Clamp values to valid ranges
+    if (startPage < 0) startPage = 0;
+    if (endPage >= PAGES) endPage = PAGES - 1;
+    if (startCol < 0) startCol = 0;
+    if (endCol >= WIDTH) endCol = WIDTH - 1;
+
+    // Grow the dirty span of each page in the region; nothing is sent here
+    for (int page = startPage; page <= endPage; page++) {
+        if (startCol < m_dirtyStart[page]) m_dirtyStart[page] = startCol;
+        if (endCol > m_dirtyEnd[page]) m_dirtyEnd[page] = endCol;
+    }
+}
+
+bool MonoFrame::isDirty() const
+{
+    for (int page = 0; page < PAGES; page++) {
+        if (m_dirtyEnd[page] >= m_dirtyStart[page]) {
+            return true;
+        }
+    }
+    return false;
+}
+
+std::vector<MonoFrame::Window> MonoFrame::takeDirtyWindows(size_t windowOverhead)
+{
+    std::vector<Window> windows;
+
+    // Collect the union of dirty spans
+    Window bounding = {-1, -1, WIDTH, -1};
+    size_t spanBytes = 0;
+    size_t spanCount = 0;
+
+    for (int page = 0; page < PAGES; page++) {
+        if (m_dirtyEnd[page] < m_dirtyStart[page]) {
+            continue;
+        }
+        if (bounding.firstPage < 0) bounding.firstPage = page;
+        bounding.lastPage = page;
+        if (m_dirtyStart[page] < bounding.firstColumn) bounding.firstColumn = m_dirtyStart[page];
+        if (m_dirtyEnd[page] > bounding.lastColumn) bounding.lastColumn = m_dirtyEnd[page];
+        spanBytes += m_dirtyEnd[page] - m_dirtyStart[page] + 1;
+        spanCount++;
+    }
+
+    if (spanCount == 0) {
+        return windows;
+    }
+
+    // A single bounding window resends clean bytes but saves the per-window
+    // setup, so pick whichever moves fewer bytes
+    size_t boundingBytes = bounding.bytes() + windowOverhead;
+    size_t perPageBytes = spanBytes + spanCount * windowOverhead;
+
+    if (boundingBytes <= perPageBytes) {
+        windows.push_back(bounding);
+    } else {
+        for (int page = bounding.firstPage; page <= bounding.lastPage; page++) {
+            if (m_dirtyEnd[page] >= m_dirtyStart[page]) {
+                windows.push_back({page, page, m_dirtyStart[page], m_dirtyEnd[page]});
+            }
+        }
+    }
+
+    resetDirty();
+    return windows;
+}
+
+size_t MonoFrame::copyWindow(const Window& window, uint8_t* dest) const
+{
+    // Horizontal addressing wraps column by column within the window
+    size_t length = 0;
+    int width = window.lastColumn - window.firstColumn + 1;
+    for (int page = window.firstPage; page <= window.lastPage; page++) {
+        std::memcpy(dest + length, &m_buffer[page * WIDTH + window.firstColumn], width);
+        length += width;
+    }
+    return length;
+}
+
+void MonoFrame::writeWindow(const Window& window, const uint8_t* src)
+{
+    if (window.firstPage < 0 || window.lastPage >= PAGES || window.firstPage > window.lastPage ||
+        window.firstColumn < 0 || window.lastColumn >= WIDTH || window.firstColumn > window.lastColumn) {
+        return;
+    }
+
+    size_t offset = 0;
+    int width = window.lastColumn - window.firstColumn + 1;
+    for (int page = window.firstPage; page <= window.lastPage; page++) {
+        std::memcpy(&m_buffer[page * WIDTH + window.firstColumn], src + offset, width);
+        offset += width;
+    }
+
+    markDirty(window.firstPage, window.lastPage, window.firstColumn, window.lastColumn);
+}
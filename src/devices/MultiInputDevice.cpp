@@ -1,6 +1,7 @@
 #include "MultiInputDevice.h"
 #include "Config.h"
 #include "Logger.h"
+#include "PerfCounters.h"
 #include <iostream>
 #include <cstring>
 #include <cerrno>
@@ -244,8 +245,34 @@ int MultiInputDevice::waitForEvents(int timeoutMs) {
     return ret;
 }
 
+std::vector<int> MultiInputDevice::getFds() const {
+    std::vector<int> fds;
+    for (const auto& pfd : m_pollFds) {
+        fds.push_back(pfd.fd);
+    }
+    return fds;
+}
+
 bool MultiInputDevice::processEvents(std::function<void(int)> onRotation, std::function<void()> onButtonPress) {
+    return processEvents([&](const InputEvent& event) {
+        if (event.isMovement()) {
+            if (onRotation) {
+                onRotation(event.steps());
+            }
+        } else if (event.type == InputEvent::Type::PRESS && onButtonPress) {
+            onButtonPress();
+        }
+    });
+}
+
+bool MultiInputDevice::processEvents(const InputHandler& onEvent) {
     int eventsProcessed = 0;
+
+    // Every delivered event may start an input-to-flush latency span
+    InputHandler timed = [&onEvent](const InputEvent& event) {
+        PerfCounters::getInstance().markInput(event.time);
+        onEvent(event);
+    };
     
     // Check each device for events
     for (size_t i = 0; i < m_devices.size(); ++i) {
@@ -259,7 +286,7 @@ bool MultiInputDevice::processEvents(std::function<void(int)> onRotation, std::f
                                   });
         
         if (pollIt != m_pollFds.end() && (pollIt->revents & POLLIN)) {
-            if (processDeviceEvents(device, onRotation, onButtonPress)) {
+            if (processDeviceEvents(device, timed)) {
                 eventsProcessed++;
             }
         }
@@ -268,81 +295,121 @@ bool MultiInputDevice::processEvents(std::function<void(int)> onRotation, std::f
     return eventsProcessed > 0;
 }
 
-bool MultiInputDevice::processDeviceEvents(GPIODevice& device, std::function<void(int)> onRotation,
-                                         std::function<void()> onButtonPress) {
-    struct input_event ev;
+bool MultiInputDevice::processDeviceEvents(GPIODevice& device, const InputHandler& onEvent) {
+    struct input_event events[Config::INPUT_READ_BATCH];
     bool eventProcessed = false;
+    int rotation = 0;
+    struct timeval rotationTime = {0, 0};
+
+    // Read all available events from this device, a batch per read()
+    ssize_t bytesRead;
+    while ((bytesRead = read(device.fd, events, sizeof(events))) > 0) {
+        size_t count = static_cast<size_t>(bytesRead) / sizeof(events[0]);
+        for (size_t i = 0; i < count; i++) {
+            const struct input_event& ev = events[i];
+            // Skip sync events
+            if (ev.type == EV_SYN) continue;
 
-    // Read all available events from this device
-    while (read(device.fd, &ev, sizeof(ev)) > 0) {
-        // Skip sync events
-        if (ev.type == EV_SYN) continue;
-
-        if (device.type == DeviceType::ROTARY_ENCODER) {
-            // Handle rotary encoder events (EV_REL)
-            if (ev.type == EV_REL && ev.code == REL_X) {
-                Logger::debug("Rotary encoder " + device.path + " REL_X: " + std::to_string(ev.value));
-                processRotaryEncoderEvent(device, ev.value, onRotation);
-                eventProcessed = true;
-            }
-        } else {
-            // Handle button events (EV_KEY) - existing logic
-            if (ev.type == EV_KEY && ev.value == 1) { // Key press (not release)
-                Logger::debug("GPIO device " + device.path + " key press: " + std::to_string(ev.code) +
-                              " (expected: " + std::to_string(device.keycode) + ")");
-
-                if (ev.code == device.keycode) {
-                    if (ev.code == KEY_ENTER) {
-                        // Handle enter button
-                        if (onButtonPress) {
-                            Logger::debug("ENTER button pressed on " + device.path);
-                            onButtonPress();
+            if (device.type == DeviceType::ROTARY_ENCODER) {
+                // Handle rotary encoder events (EV_REL)
+                if (ev.type == EV_REL && ev.code == REL_X) {
+                    LOG_DEBUG("Rotary encoder " + device.path + " REL_X: " + std::to_string(ev.value));
+                    rotation += device.acceleration.step(ev.value, ev.time);
+                    rotationTime = ev.time;
+                    eventProcessed = true;
+                }
+            } else if (ev.type == EV_KEY && ev.code == KEY_ENTER && ev.code == device.keycode && ev.value == 0) {
+                // Enter released: a long hold adds a LONG_PRESS after the PRESS
+                if (device.pressTime.tv_sec != 0) {
+                    long heldMs = (ev.time.tv_sec - device.pressTime.tv_sec) * 1000 +
+                                  (ev.time.tv_usec - device.pressTime.tv_usec) / 1000;
+                    device.pressTime = {0, 0};
+                    if (heldMs >= Config::LONG_PRESS_MS && onEvent) {
+                        LOG_DEBUG("ENTER long press on " + device.path);
+                        InputEvent event;
+                        event.type = InputEvent::Type::LONG_PRESS;
+                        event.time = ev.time;
+                        onEvent(event);
+                        eventProcessed = true;
+                    }
+                }
+            } else {
+                // Handle button events (EV_KEY) - existing logic
+                if (ev.type == EV_KEY && ev.value == 1) { // Key press (not release)
+                    LOG_DEBUG("GPIO device " + device.path + " key press: " + std::to_string(ev.code) +
+                                  " (expected: " + std::to_string(device.keycode) + ")");
+
+                    if (ev.code == device.keycode) {
+                        if (ev.code == KEY_ENTER) {
+                            // Handle enter button
+                            device.pressTime = ev.time;
+                            if (onEvent) {
+                                LOG_DEBUG("ENTER button pressed on " + device.path);
+                                InputEvent event;
+                                event.type = InputEvent::Type::PRESS;
+                                event.time = ev.time;
+                                onEvent(event);
+                            }
+                        } else {
+                            // Handle directional buttons
+                            LOG_DEBUG("Direction button pressed: " + std::to_string(ev.code) + " on " + device.path);
+                            synthesizeMovementEvent(ev, onEvent);
                         }
+                        eventProcessed = true;
                     } else {
-                        // Handle directional buttons
-                        Logger::debug("Direction button pressed: " + std::to_string(ev.code) + " on " + device.path);
-                        synthesizeMovementEvent(ev.code, onRotation);
+                        std::cout << "DEBUG: Key mismatch - received " << ev.code << " but expected " << device.keycode << " on " << device.path << std::endl;
                     }
-                    eventProcessed = true;
-                } else {
-                    std::cout << "DEBUG: Key mismatch - received " << ev.code << " but expected " << device.keycode << " on " << device.path << std::endl;
                 }
             }
         }
+        if (static_cast<size_t>(bytesRead) < sizeof(events)) {
+            break;
+        }
+    }
+
+    // Detents read together become one rotation, so a fast spin costs one redraw
+    if (rotation != 0) {
+        processRotaryEncoderEvent(device, rotation, rotationTime, onEvent);
     }
 
     return eventProcessed;
 }
 
-void MultiInputDevice::synthesizeMovementEvent(int keycode, std::function<void(int)> onRotation) {
-    if (!onRotation) return;
+void MultiInputDevice::synthesizeMovementEvent(const struct input_event& ev, const InputHandler& onEvent) {
+    if (!onEvent) return;
     
-    int movement = 0;
+    InputEvent event;
+    event.type = InputEvent::Type::KEY;
+    event.time = ev.time;
     const char* direction = "";
     
-    switch (keycode) {
+    switch (ev.code) {
         case KEY_LEFT:
-            movement = -5;
+            event.key = InputEvent::Key::LEFT;
+            event.delta = -5;
             direction = "LEFT";
             break;
         case KEY_RIGHT:
-            movement = 5;
+            event.key = InputEvent::Key::RIGHT;
+            event.delta = 5;
             direction = "RIGHT";
             break;
         case KEY_UP:
-            movement = -5; // UP moves menu selection up (negative Y)
+            event.key = InputEvent::Key::UP;
+            event.delta = -5; // UP moves menu selection up (negative Y)
             direction = "UP";
             break;
         case KEY_DOWN:
-            movement = 5;  // DOWN moves menu selection down (positive Y)
+            event.key = InputEvent::Key::DOWN;
+            event.delta = 5;  // DOWN moves menu selection down (positive Y)
             direction = "DOWN";
             break;
         default:
             return;
     }
     
-    Logger::debug("Synthesizing " + std::string(direction) + " movement (value=" + std::to_string(movement) + ")");
-    onRotation(movement);
+    LOG_DEBUG("Synthesizing " + std::string(direction) + " movement (value=" + std::to_string(event.delta) + ")");
+    onEvent(event);
 }
 
 void MultiInputDevice::logDeviceInfo() const {
@@ -384,16 +451,15 @@ MultiInputDevice::DeviceType MultiInputDevice::detectDeviceType(const std::strin
 
     return DeviceType::BUTTON;
 }
-void MultiInputDevice::processRotaryEncoderEvent(GPIODevice& device, int relativeValue, std::function<void(int)> onRotation) {
-    (void)device; 
-    if (!onRotation) return;
-
-    // Apply ±5 scaling and direction mapping to match RP2040 behavior
-    // RP2040: clockwise = -5, counter-clockwise = +5
-    // Hardware: clockwise = +1, counter-clockwise = -1
-    // Mapping: hardware +1 → application -5, hardware -1 → application +5
-    int scaledMovement = relativeValue * 5;
-
-    Logger::debug("Rotary encoder: raw=" + std::to_string(relativeValue) + " → scaled=" + std::to_string(scaledMovement));
-    onRotation(scaledMovement);
+void MultiInputDevice::processRotaryEncoderEvent(GPIODevice& device, int steps, const struct timeval& time, const InputHandler& onEvent) {
+    if (!onEvent) return;
+
+    // Steps come from the shared acceleration curve: one per detent when turned slowly
+    InputEvent event;
+    event.type = InputEvent::Type::ROTATE;
+    event.delta = steps;
+    event.time = time;
+
+    LOG_DEBUG("Rotary encoder " + device.path + ": " + std::to_string(steps) + " steps");
+    onEvent(event);
 }
@@ -0,0 +1,215 @@
+#include "ScriptedInputDevice.h"
+#include "Config.h"
+#include "Logger.h"
+#include <cerrno>
+#include <cstring>
+#include <fcntl.h>
+#include <fstream>
+#include <sstream>
+#include <unistd.h>
+#include <sys/time.h>
+#include <linux/input.h>
+
+ScriptedInputDevice::ScriptedInputDevice(const std::string& scriptPath)
+    : InputDevice(scriptPath)
+{
+}
+
+ScriptedInputDevice::~ScriptedInputDevice()
+{
+    close();
+}
+
+bool ScriptedInputDevice::loadScript()
+{
+    std::ifstream file(m_devicePath);
+    if (!file) {
+        Logger::error("Cannot open input script: " + m_devicePath);
+        return false;
+    }
+
+    m_steps.clear();
+    std::string line;
+    int lineNumber = 0;
+    while (std::getline(file, line)) {
+        lineNumber++;
+        size_t hash = line.find('#');
+        if (hash != std::string::npos) {
+            line.erase(hash);
+        }
+
+        std::istringstream fields(line);
+        std::string action;
+        Step step = {0, Action::ROTATE, 0};
+        if (!(fields >> step.timeMs)) {
+            continue;   // Blank or comment
+        }
+
+        bool valid = static_cast<bool>(fields >> action);
+        if (action == "rotate") {
+            valid = valid && (fields >> step.value) && step.value != 0;
+        } else if (action == "press") {
+            step.action = Action::PRESS;
+            step.value = Config::REPLAY_PRESS_MS;
+        } else if (action == "hold") {
+            step.action = Action::PRESS;
+            valid = valid && (fields >> step.value) && step.value >= 0;
+        } else if (action == "up" || action == "down" || action == "left" || action == "right") {
+            step.action = Action::KEY;
+            step.value = action == "up" ? KEY_UP : action == "down" ? KEY_DOWN :
+                         action == "left" ? KEY_LEFT : KEY_RIGHT;
+        } else if (action == "quit") {
+            step.action = Action::QUIT;
+        } else {
+            valid = false;
+        }
+
+        if (!valid || (!m_steps.empty() && step.timeMs < m_steps.back().timeMs)) {
+            Logger::error("Input script " + m_devicePath + ":" + std::to_string(lineNumber) +
+                          ": invalid step '" + line + "'");
+            return false;
+        }
+        m_steps.push_back(step);
+    }
+
+    Logger::info("Loaded " + std::to_string(m_steps.size()) + " input steps from " + m_devicePath);
+    return true;
+}
+
+bool ScriptedInputDevice::open()
+{
+    if (isOpen()) {
+        return true;
+    }
+    if (!loadScript()) {
+        return false;
+    }
+
+    // Both ends nonblocking: a full pipe must not hold the replay thread
+    // in write() past close(), see writeEvent()
+    int fds[2];
+    if (pipe2(fds, O_CLOEXEC | O_NONBLOCK) < 0) {
+        Logger::error("Cannot create input replay pipe: " + std::string(strerror(errno)));
+        return false;
+    }
+    m_fd = fds[0];
+    m_writeFd = fds[1];
+
+    m_stop = false;
+    return true;
+}
+
+void ScriptedInputDevice::close()
+{
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        m_stop = true;
+    }
+    m_wake.notify_all();
+    if (m_thread.joinable()) {
+        m_thread.join();
+    }
+
+    if (m_writeFd >= 0) {
+        ::close(m_writeFd);
+        m_writeFd = -1;
+    }
+    if (isOpen()) {
+        ::close(m_fd);
+        m_fd = -1;
+    }
+}
+
+void ScriptedInputDevice::start(std::function<void()> onInput, std::function<void()> onFinished)
+{
+    if (!isOpen() || m_thread.joinable()) {
+        return;
+    }
+    m_thread = std::thread(&ScriptedInputDevice::replayLoop, this, onInput, onFinished);
+}
+
+bool ScriptedInputDevice::waitUntil(std::chrono::steady_clock::time_point deadline)
+{
+    std::unique_lock<std::mutex> lock(m_mutex);
+    return !m_wake.wait_until(lock, deadline, [this]() { return m_stop; });
+}
+
+void ScriptedInputDevice::writeEvent(uint16_t type, uint16_t code, int32_t value)
+{
+    struct input_event ev;
+    memset(&ev, 0, sizeof(ev));
+    gettimeofday(&ev.time, nullptr);
+    ev.type = type;
+    ev.code = code;
+    ev.value = value;
+
+    // Events are far below PIPE_BUF, so a write is whole or EAGAIN; while
+    // the reader is behind, retry until it catches up or close() stops us
+    while (write(m_writeFd, &ev, sizeof(ev)) != static_cast<ssize_t>(sizeof(ev))) {
+        if (errno != EAGAIN && errno != EINTR) {
+            Logger::warning("Input replay write failed: " + std::string(strerror(errno)));
+            return;
+        }
+        if (errno == EAGAIN &&
+            !waitUntil(std::chrono::steady_clock::now() + std::chrono::milliseconds(Config::REPLAY_RETRY_MS))) {
+            return;
+        }
+    }
+}
+
+void ScriptedInputDevice::replayLoop(std::function<void()> onInput, std::function<void()> onFinished)
+{
+    using std::chrono::milliseconds;
+    auto startTime = std::chrono::steady_clock::now();
+
+    for (const Step& step : m_steps) {
+        if (!waitUntil(startTime + milliseconds(step.timeMs))) {
+            return;
+        }
+        if (step.action == Action::QUIT) {
+            break;
+        }
+        if (onInput) {
+            onInput();
+        }
+
+        switch (step.action) {
+        case Action::ROTATE: {
+            // One detent per batch, or processEvents() would merge them into
+            // one move; the zero partner completes the pair it waits for
+            int direction = step.value > 0 ? 1 : -1;
+            for (int i = 0; i < step.value * direction; i++) {
+                if (i > 0 && !waitUntil(std::chrono::steady_clock::now() + milliseconds(Config::REPLAY_DETENT_MS))) {
+                    return;
+                }
+                writeEvent(EV_REL, REL_X, direction);
+                writeEvent(EV_REL, REL_X, 0);
+                writeEvent(EV_SYN, SYN_REPORT, 0);
+            }
+            break;
+        }
+        case Action::PRESS:
+            writeEvent(EV_KEY, KEY_ENTER, 1);
+            writeEvent(EV_SYN, SYN_REPORT, 0);
+            if (!waitUntil(std::chrono::steady_clock::now() + milliseconds(step.value))) {
+                return;
+            }
+            writeEvent(EV_KEY, KEY_ENTER, 0);
+            writeEvent(EV_SYN, SYN_REPORT, 0);
+            break;
+        case Action::KEY:
+            writeEvent(EV_KEY, static_cast<uint16_t>(step.value), 1);
+            writeEvent(EV_SYN, SYN_REPORT, 0);
+            writeEvent(EV_KEY, static_cast<uint16_t>(step.value), 0);
+            writeEvent(EV_SYN, SYN_REPORT, 0);
+            break;
+        case Action::QUIT:
+            break;
+        }
+    }
+
+    // Let the answer to the last step reach the display
+    if (waitUntil(std::chrono::steady_clock::now() + milliseconds(Config::REPLAY_EXIT_DELAY_MS)) && onFinished) {
+        onFinished();
+    }
+}
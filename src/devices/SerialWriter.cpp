@@ -0,0 +1,323 @@
+#include "SerialWriter.h"
+#include "Config.h"
+#include "Logger.h"
+#include "PerfCounters.h"
+#include <cerrno>
+#include <cstring>
+#include <ctime>
+#include <iostream>
+#include <poll.h>
+#include <termios.h>
+#include <unistd.h>
+#include <sys/eventfd.h>
+
+namespace {
+    long monotonicMs()
+    {
+        struct timespec ts;
+        clock_gettime(CLOCK_MONOTONIC, &ts);
+        return ts.tv_sec * 1000L + ts.tv_nsec / 1000000L;
+    }
+
+    bool isDisconnectError(int error)
+    {
+        return error == EIO || error == ENODEV || error == ENXIO;
+    }
+}
+
+SerialWriter::SerialWriter()
+{
+}
+
+SerialWriter::~SerialWriter()
+{
+    stop(0);
+}
+
+bool SerialWriter::start(int fd, std::function<void()> onDisconnect)
+{
+    if (m_running.load()) {
+        return true;
+    }
+
+    m_wakeFd = eventfd(0, EFD_NONBLOCK | EFD_CLOEXEC);
+    if (m_wakeFd < 0) {
+        std::cerr << "Failed to create serial writer eventfd: " << strerror(errno) << std::endl;
+        return false;
+    }
+
+    m_fd = fd;
+    m_onDisconnect = onDisconnect;
+    m_head.store(0);
+    m_tail.store(0);
+    m_stopping.store(false);
+    m_running.store(true);
+    m_thread = std::thread(&SerialWriter::writerThread, this);
+    return true;
+}
+
+void SerialWriter::stop(int drainTimeoutMs)
+{
+    if (!m_running.load()) {
+        return;
+    }
+
+    m_drainDeadlineMs.store(monotonicMs() + drainTimeoutMs);
+    m_stopping.store(true);
+
+    uint64_t one = 1;
+    ssize_t result = write(m_wakeFd, &one, sizeof(one));
+    (void)result;
+
+    if (m_thread.joinable()) {
+        m_thread.join();
+    }
+
+    ::close(m_wakeFd);
+    m_wakeFd = -1;
+    m_fd = -1;
+    m_running.store(false);
+}
+
+bool SerialWriter::enqueue(const uint8_t* data, size_t length, int gapUs)
+{
+    if (!m_running.load() || m_stopping.load() || !data || length == 0 || length > MAX_FRAME_SIZE) {
+        return false;
+    }
+
+    {
+        std::lock_guard<std::mutex> lock(m_producerMutex);
+
+        size_t head = m_head.load(std::memory_order_relaxed);
+        size_t tail = m_tail.load(std::memory_order_acquire);
+        size_t needed = HEADER_SIZE + length;
+
+        if (RING_SIZE - (head - tail) < needed) {
+            m_dropped++;
+            PerfCounters::getInstance().add(PerfCounters::Counter::SERIAL_DROPPED_FRAMES);
+            return false;
+        }
+
+        uint8_t header[HEADER_SIZE];
+        uint32_t gap = gapUs > 0 ? static_cast<uint32_t>(gapUs) : 0;
+        header[0] = static_cast<uint8_t>(length & 0xFF);
+        header[1] = static_cast<uint8_t>(length >> 8);
+        header[2] = static_cast<uint8_t>(gap & 0xFF);
+        header[3] = static_cast<uint8_t>((gap >> 8) & 0xFF);
+        header[4] = static_cast<uint8_t>((gap >> 16) & 0xFF);
+        header[5] = static_cast<uint8_t>(gap >> 24);
+
+        copyIn(head, header, HEADER_SIZE);
+        copyIn(head + HEADER_SIZE, data, length);
+        m_head.store(head + needed, std::memory_order_release);
+    }
+
+    uint64_t one = 1;
+    ssize_t result = write(m_wakeFd, &one, sizeof(one));
+    (void)result; // EAGAIN means the writer is already signalled
+    return true;
+}
+
+void SerialWriter::copyIn(size_t offset, const uint8_t* src, size_t length)
+{
+    for (size_t i = 0; i < length; i++) {
+        m_ring[(offset + i) & (RING_SIZE - 1)] = src[i];
+    }
+}
+
+void SerialWriter::copyOut(size_t offset, uint8_t* dest, size_t length) const
+{
+    for (size_t i = 0; i < length; i++) {
+        dest[i] = m_ring[(offset + i) & (RING_SIZE - 1)];
+    }
+}
+
+bool SerialWriter::peekHeader(size_t offset, FrameHeader& header) const
+{
+    uint8_t raw[HEADER_SIZE];
+    copyOut(offset, raw, HEADER_SIZE);
+    header.length = raw[0] | (static_cast<size_t>(raw[1]) << 8);
+    header.gapUs = static_cast<int>(raw[2] | (static_cast<uint32_t>(raw[3]) << 8) |
+                                    (static_cast<uint32_t>(raw[4]) << 16) |
+                                    (static_cast<uint32_t>(raw[5]) << 24));
+    return header.length > 0;
+}
+
+bool SerialWriter::supersedes(const uint8_t* later, size_t laterLength,
+                              const uint8_t* earlier, size_t earlierLength)
+{
+    if (later[0] != earlier[0]) {
+        return false;
+    }
+
+    switch (later[0]) {
+        case Config::CMD_CLEAR:
+        case Config::CMD_SET_CURSOR:
+        case Config::CMD_INVERT:
+        case Config::CMD_BRIGHTNESS:
+        case Config::CMD_POWER_MODE:
+            // Pure state setters: only the last value matters
+            return true;
+
+        case Config::CMD_DRAW_TEXT:
+            // Same position and at least as long, so every old glyph is overdrawn
+            return laterLength >= 3 && earlierLength >= 3 &&
+                   later[1] == earlier[1] && later[2] == earlier[2] &&
+                   laterLength >= earlierLength;
+
+        case Config::CMD_PROGRESS_BAR:
+            // Same bar geometry, only the percentage differs
+            return laterLength >= 5 && earlierLength >= 5 &&
+                   std::memcmp(later + 1, earlier + 1, 4) == 0;
+
+        default:
+            return false;
+    }
+}
+
+bool SerialWriter::waitWritable(int timeoutMs)
+{
+    struct pollfd pfd;
+    pfd.fd = m_fd;
+    pfd.events = POLLOUT;
+    pfd.revents = 0;
+
+    int ret = poll(&pfd, 1, timeoutMs);
+    if (ret > 0 && (pfd.revents & (POLLERR | POLLHUP | POLLNVAL))) {
+        return false;
+    }
+    return true;
+}
+
+bool SerialWriter::writeFrame(const uint8_t* data, size_t length, int& error)
+{
+    PerfCounters& perf = PerfCounters::getInstance();
+    int64_t startUs = PerfCounters::nowUs();
+    error = 0;
+    size_t written = 0;
+
+    while (written < length) {
+        ssize_t result = write(m_fd, data + written, length - written);
+
+        if (result > 0) {
+            perf.add(PerfCounters::Counter::SERIAL_WRITES);
+            perf.add(PerfCounters::Counter::SERIAL_BYTES, static_cast<uint64_t>(result));
+            if (static_cast<size_t>(result) < length - written) {
+                perf.add(PerfCounters::Counter::SERIAL_PARTIAL_WRITES);
+            }
+            written += static_cast<size_t>(result);
+            continue;
+        }
+        if (result < 0 && errno == EINTR) {
+            continue;
+        }
+        if (result < 0 && (errno == EAGAIN || errno == EWOULDBLOCK)) {
+            // Give up on a stalled link only when asked to stop
+            if (m_stopping.load() && monotonicMs() > m_drainDeadlineMs.load()) {
+                error = ETIMEDOUT;
+                return false;
+            }
+            if (!waitWritable(100)) {
+                error = EIO;
+                std::cerr << "Serial link error while waiting to write" << std::endl;
+                return false;
+            }
+            continue;
+        }
+
+        error = result < 0 ? errno : EIO;
+        std::cerr << "Error writing to serial device: " << strerror(error) << std::endl;
+        return false;
+    }
+
+    // Drain so each command arrives as its own transfer; only this thread waits
+    if (tcdrain(m_fd) < 0 && errno != EINTR) {
+        error = errno;
+        std::cerr << "Error draining serial output: " << strerror(error) << std::endl;
+        return false;
+    }
+
+    perf.record(PerfCounters::Histogram::SERIAL_WRITE, static_cast<uint64_t>(PerfCounters::nowUs() - startUs));
+    return true;
+}
+
+void SerialWriter::writerThread()
+{
+    uint8_t frame[MAX_FRAME_SIZE];
+    uint8_t nextPrefix[6];
+    bool linkDown = false;
+
+    while (true) {
+        size_t tail = m_tail.load(std::memory_order_relaxed);
+        size_t head = m_head.load(std::memory_order_acquire);
+
+        if (tail == head) {
+            if (m_stopping.load()) {
+                break;
+            }
+
+            struct pollfd pfd;
+            pfd.fd = m_wakeFd;
+            pfd.events = POLLIN;
+            pfd.revents = 0;
+            if (poll(&pfd, 1, -1) > 0) {
+                uint64_t count;
+                ssize_t result = read(m_wakeFd, &count, sizeof(count));
+                (void)result;
+            }
+            continue;
+        }
+
+        if (m_stopping.load() && monotonicMs() > m_drainDeadlineMs.load()) {
+            break;
+        }
+
+        FrameHeader header;
+        peekHeader(tail, header);
+        size_t next = tail + HEADER_SIZE + header.length;
+        copyOut(tail + HEADER_SIZE, frame, header.length);
+
+        // Drop this frame if the one queued right behind it overwrites it
+        if (next != head) {
+            FrameHeader nextHeader;
+            peekHeader(next, nextHeader);
+            size_t prefix = nextHeader.length < sizeof(nextPrefix) ? nextHeader.length : sizeof(nextPrefix);
+            copyOut(next + HEADER_SIZE, nextPrefix, prefix);
+            if (supersedes(nextPrefix, nextHeader.length, frame, header.length)) {
+                m_tail.store(next, std::memory_order_release);
+                m_merged++;
+                PerfCounters::getInstance().add(PerfCounters::Counter::SERIAL_MERGED_FRAMES);
+                continue;
+            }
+        }
+
+        // Hand the ring space back before the (slow) write
+        m_tail.store(next, std::memory_order_release);
+
+        if (linkDown) {
+            continue; // Discard until the device is reopened
+        }
+
+        int error = 0;
+        if (!writeFrame(frame, header.length, error)) {
+            if (isDisconnectError(error)) {
+                std::cerr << "Serial write error indicates device disconnection" << std::endl;
+                linkDown = true;
+                if (m_onDisconnect) {
+                    m_onDisconnect();
+                }
+            } else if (m_stopping.load()) {
+                break;
+            }
+            continue;
+        }
+
+        if (header.gapUs > 0) {
+            usleep(header.gapUs);
+        }
+    }
+
+    if (m_head.load() != m_tail.load()) {
+        LOG_DEBUG("Serial writer stopped with frames still queued");
+    }
+}
@@ -0,0 +1,278 @@
+#include "VirtualDisplayDevice.h"
+#include "Config.h"
+#include "Logger.h"
+#include <algorithm>
+#include <cerrno>
+#include <cstdio>
+#include <ctime>
+#include <fstream>
+#include <iostream>
+#include <sstream>
+#include <sys/stat.h>
+
+VirtualDisplayDevice::VirtualDisplayDevice(const std::string& devicePath)
+    : BaseDisplayDevice(devicePath)
+{
+    size_t colon = devicePath.find(':');
+    if (colon != std::string::npos) {
+        m_outputDir = devicePath.substr(colon + 1);
+    }
+}
+
+VirtualDisplayDevice::~VirtualDisplayDevice()
+{
+    close();
+}
+
+bool VirtualDisplayDevice::isVirtualPath(const std::string& devicePath)
+{
+    std::string prefix = Config::VIRTUAL_DISPLAY_PREFIX;
+    return devicePath == prefix || devicePath.compare(0, prefix.size() + 1, prefix + ":") == 0;
+}
+
+bool VirtualDisplayDevice::open()
+{
+    if (m_open) {
+        return true;
+    }
+
+    if (!m_outputDir.empty()) {
+        if (mkdir(m_outputDir.c_str(), 0755) < 0 && errno != EEXIST) {
+            Logger::error("Cannot create frame directory: " + m_outputDir);
+            return false;
+        }
+        Logger::info("Virtual display writing frames to " + m_outputDir);
+    }
+
+    std::lock_guard<std::mutex> lock(m_mutex);
+    m_stats.clear();
+    m_frames.clear();
+    m_inputs = 0;
+    m_inputPending = false;
+    m_openTime = Clock::now();
+    m_lastCpuMs = cpuTimeMs();
+    m_open = true;
+    return true;
+}
+
+void VirtualDisplayDevice::close()
+{
+    if (!m_open) {
+        return;
+    }
+    m_open = false;
+
+    std::cout << "Virtual display summary:\n" << summary() << std::flush;
+    if (!m_outputDir.empty() && !writeCsv(m_outputDir + "/frames.csv")) {
+        Logger::warning("Could not write " + m_outputDir + "/frames.csv");
+    }
+}
+
+void VirtualDisplayDevice::countCommand(size_t bytes)
+{
+    m_drawCalls++;
+    m_serialBytes += bytes;
+}
+
+void VirtualDisplayDevice::clear()
+{
+    m_frame.clear();
+    countCommand(1);
+}
+
+void VirtualDisplayDevice::drawText(int x, int y, const char* text, size_t length)
+{
+    m_frame.drawText(x, y, text, length);
+    countCommand(3 + length);
+}
+
+void VirtualDisplayDevice::setCursor(int x, int y)
+{
+    m_frame.setCursor(x, y);
+    countCommand(3);
+}
+
+void VirtualDisplayDevice::setInverted(bool inverted)
+{
+    m_inverted = inverted;
+    m_frame.markAllDirty();
+    countCommand(2);
+}
+
+void VirtualDisplayDevice::setBrightness(int brightness)
+{
+    (void)brightness;
+    countCommand(2);
+}
+
+void VirtualDisplayDevice::drawProgressBar(int x, int y, int width, int height, int percentage)
+{
+    m_frame.drawProgressBar(x, y, width, height, percentage);
+    countCommand(6);
+}
+
+void VirtualDisplayDevice::setPower(bool on)
+{
+    m_poweredOn = on;
+    m_frame.markAllDirty();
+    countCommand(2);
+}
+
+void VirtualDisplayDevice::blit(const MonoFrame::Window& window, const uint8_t* pixels)
+{
+    m_frame.writeWindow(window, pixels);
+    countCommand(Config::BLIT_HEADER_SIZE + window.bytes());
+}
+
+void VirtualDisplayDevice::markInput()
+{
+    std::lock_guard<std::mutex> lock(m_mutex);
+    m_inputTime = Clock::now();
+    m_inputPending = true;
+    m_inputs++;
+}
+
+void VirtualDisplayDevice::endFrame()
+{
+    if (!m_open || (m_drawCalls == 0 && !m_frame.isDirty())) {
+        return;
+    }
+
+    FrameStats stats;
+    stats.drawCalls = m_drawCalls;
+    stats.serialBytes = m_serialBytes;
+    for (const MonoFrame::Window& window : m_frame.takeDirtyWindows(Config::BLIT_HEADER_SIZE)) {
+        stats.blitBytes += Config::BLIT_HEADER_SIZE + window.bytes();
+    }
+    m_drawCalls = 0;
+    m_serialBytes = 0;
+
+    double cpuMs = cpuTimeMs();
+    Clock::time_point now = Clock::now();
+
+    std::unique_lock<std::mutex> lock(m_mutex);
+    stats.index = static_cast<int>(m_stats.size());
+    stats.timeMs = std::chrono::duration<double, std::milli>(now - m_openTime).count();
+    stats.cpuMs = cpuMs - m_lastCpuMs;
+    m_lastCpuMs = cpuMs;
+    if (m_inputPending) {
+        stats.latencyMs = std::chrono::duration<double, std::milli>(now - m_inputTime).count();
+        m_inputPending = false;
+    }
+    m_stats.push_back(stats);
+
+    m_frames.emplace_back(m_frame.data(), m_frame.data() + MonoFrame::SIZE);
+    if (m_frames.size() > static_cast<size_t>(Config::VIRTUAL_FRAME_HISTORY)) {
+        m_frames.pop_front();
+    }
+    lock.unlock();
+
+    if (!m_outputDir.empty()) {
+        char name[32];
+        snprintf(name, sizeof(name), "/frame-%05d.pbm", stats.index);
+        if (!writePbm(m_outputDir + name)) {
+            Logger::warning("Could not write frame " + std::to_string(stats.index));
+        }
+    }
+}
+
+bool VirtualDisplayDevice::writePbm(const std::string& path) const
+{
+    std::ofstream file(path, std::ios::binary);
+    if (!file) {
+        return false;
+    }
+
+    // P4: one bit per pixel, MSB leftmost, 1 = black; lit pixels print as ink
+    file << "P4\n" << MonoFrame::WIDTH << " " << MonoFrame::HEIGHT << "\n";
+    const uint8_t* pixels = m_frame.data();
+    for (int y = 0; y < MonoFrame::HEIGHT; y++) {
+        uint8_t row[MonoFrame::WIDTH / 8] = {0};
+        for (int x = 0; x < MonoFrame::WIDTH; x++) {
+            bool lit = (pixels[(y / 8) * MonoFrame::WIDTH + x] >> (y % 8)) & 1;
+            if (m_poweredOn && lit != m_inverted) {
+                row[x / 8] |= static_cast<uint8_t>(0x80 >> (x % 8));
+            }
+        }
+        file.write(reinterpret_cast<const char*>(row), sizeof(row));
+    }
+    return static_cast<bool>(file);
+}
+
+bool VirtualDisplayDevice::writeCsv(const std::string& path) const
+{
+    std::ofstream file(path);
+    if (!file) {
+        return false;
+    }
+
+    file << "frame,time_ms,draw_calls,serial_bytes,blit_bytes,cpu_ms,latency_ms\n";
+    for (const FrameStats& stats : getStats()) {
+        file << stats.index << "," << stats.timeMs << "," << stats.drawCalls << ","
+             << stats.serialBytes << "," << stats.blitBytes << "," << stats.cpuMs << ","
+             << stats.latencyMs << "\n";
+    }
+    return static_cast<bool>(file);
+}
+
+std::vector<VirtualDisplayDevice::FrameStats> VirtualDisplayDevice::getStats() const
+{
+    std::lock_guard<std::mutex> lock(m_mutex);
+    return m_stats;
+}
+
+std::deque<std::vector<uint8_t>> VirtualDisplayDevice::getFrames() const
+{
+    std::lock_guard<std::mutex> lock(m_mutex);
+    return m_frames;
+}
+
+std::string VirtualDisplayDevice::summary() const
+{
+    std::vector<FrameStats> frames = getStats();
+    int inputs;
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        inputs = m_inputs;
+    }
+
+    size_t serialBytes = 0;
+    size_t blitBytes = 0;
+    double cpuMs = 0;
+    std::vector<double> latencies;
+    for (const FrameStats& stats : frames) {
+        serialBytes += stats.serialBytes;
+        blitBytes += stats.blitBytes;
+        cpuMs += stats.cpuMs;
+        if (stats.latencyMs >= 0) {
+            latencies.push_back(stats.latencyMs);
+        }
+    }
+    std::sort(latencies.begin(), latencies.end());
+
+    auto percentile = [&latencies](double p) {
+        if (latencies.empty()) return 0.0;
+        size_t i = static_cast<size_t>(p * (latencies.size() - 1) + 0.5);
+        return latencies[i];
+    };
+
+    std::ostringstream out;
+    out << "frames=" << frames.size() << "\n"
+        << "inputs=" << inputs << "\n"
+        << "serial_bytes=" << serialBytes << "\n"
+        << "blit_bytes=" << blitBytes << "\n"
+        << "serial_bytes_per_input=" << (inputs > 0 ? serialBytes / inputs : 0) << "\n"
+        << "blit_bytes_per_input=" << (inputs > 0 ? blitBytes / inputs : 0) << "\n"
+        << "cpu_ms_per_frame=" << (frames.empty() ? 0.0 : cpuMs / frames.size()) << "\n"
+        << "latency_ms_p50=" << percentile(0.5) << "\n"
+        << "latency_ms_p95=" << percentile(0.95) << "\n"
+        << "latency_ms_max=" << (latencies.empty() ? 0.0 : latencies.back()) << "\n";
+    return out.str();
+}
+
+double VirtualDisplayDevice::cpuTimeMs()
+{
+    struct timespec ts;
+    clock_gettime(CLOCK_PROCESS_CPUTIME_ID, &ts);
+    return ts.tv_sec * 1000.0 + ts.tv_nsec / 1e6;
+}
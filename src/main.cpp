@@ -0,0 +1,17 @@
+#include "MicroPanel.h"
+#include <cstdlib>
+
+// Main entry point
+int main(int argc, char* argv[])
+{
+    MicroPanel app(argc, argv);
+
+    if (!app.initialize()) {
+        return EXIT_FAILURE;
+    }
+
+    app.run();
+    app.shutdown();
+
+    return EXIT_SUCCESS;
+}
@@ -1,6 +1,8 @@
 #include "MenuSystem.h"
 #include "DeviceInterfaces.h"
 #include "Config.h"
+#include "PerfCounters.h"
+#include <cstring>
 #include <unistd.h>
 #include <iostream>
 
@@ -15,20 +17,33 @@ Display::Display(std::shared_ptr<BaseDisplayDevice> device)
 void Display::clear()
 {
     if (m_device) {
+        beginFrame();
         m_device->clear();
     }
 }
 
 void Display::drawText(int x, int y, const std::string& text)
+{
+    drawText(x, y, text.data(), text.size());
+}
+
+void Display::drawText(int x, int y, const char* text)
+{
+    drawText(x, y, text, strlen(text));
+}
+
+void Display::drawText(int x, int y, const char* text, size_t length)
 {
     if (m_device) {
-        m_device->drawText(x, y, text);
+        beginFrame();
+        m_device->drawText(x, y, text, length);
     }
 }
 
 void Display::setCursor(int x, int y)
 {
     if (m_device) {
+        beginFrame();
         m_device->setCursor(x, y);
     }
 }
@@ -52,10 +67,95 @@ void Display::setBrightness(int brightness)
 void Display::drawProgressBar(int x, int y, int width, int height, int percentage)
 {
     if (m_device) {
+        beginFrame();
         m_device->drawProgressBar(x, y, width, height, percentage);
     }
 }
 
+void Display::beginFrame()
+{
+    if (m_frameStartUs == 0) {
+        m_frameStartUs = PerfCounters::nowUs();
+    }
+}
+
+void Display::present()
+{
+    if (!m_device) {
+        return;
+    }
+    m_device->present();
+
+    // Module loops present every iteration; only frames with drawing count
+    if (m_frameStartUs == 0) {
+        return;
+    }
+    PerfCounters& perf = PerfCounters::getInstance();
+    perf.record(PerfCounters::Histogram::FRAME_RENDER, static_cast<uint64_t>(PerfCounters::nowUs() - m_frameStartUs));
+    m_frameStartUs = 0;
+
+    if (m_device->isFrameBufferEnabled()) {
+        perf.frameFlushed();
+    } else {
+        m_flushPending = true;
+    }
+}
+
+void Display::flush()
+{
+    if (!m_device) {
+        return;
+    }
+    m_device->flushBuffer();
+
+    if (m_flushPending) {
+        m_flushPending = false;
+        PerfCounters::getInstance().frameFlushed();
+    }
+}
+
+void Display::repaint()
+{
+    if (!m_device) {
+        return;
+    }
+
+    // A replugged device starts powered on, at default brightness, not inverted
+    if (!m_poweredOn) {
+        m_device->setPower(false);
+    }
+    m_device->setBrightness(m_brightness);
+    if (m_inverted) {
+        m_device->setInverted(true);
+    }
+    m_device->repaint();
+}
+
+bool Display::isFrameBuffered() const
+{
+    return m_device && m_device->isFrameBufferEnabled();
+}
+
+bool Display::supportsBlit() const
+{
+    return m_device && m_device->supportsBlit();
+}
+
+void Display::blit(const MonoFrame::Window& window, const uint8_t* pixels)
+{
+    if (m_device) {
+        beginFrame();
+        m_device->blit(window, pixels);
+    }
+}
+
+void Display::requestRedraw()
+{
+    if (m_redrawNotifier) {
+        m_redrawNotifier();
+    }
+}
+
 void Display::setPower(bool on)
 {
     // Only send command if the state is changing
@@ -78,6 +178,10 @@ void Display::setPower(bool on)
     }
 
     std::cout << "Display power set to: " << (on ? "ON" : "OFF") << std::endl;
+
+    if (m_powerNotifier) {
+        m_powerNotifier(on);
+    }
 }
 
 void Display::enablePowerSave(bool enable)
@@ -128,6 +232,18 @@ void Display::checkPowerSaveTimeout()
     }
 }
 
+int Display::getPowerSaveRemainingMs() const
+{
+    struct timeval now;
+    gettimeofday(&now, nullptr);
+
+    long elapsedMs = (now.tv_sec - m_lastActivityTime.tv_sec) * 1000 +
+                     (now.tv_usec - m_lastActivityTime.tv_usec) / 1000;
+    long remainingMs = Config::POWER_SAVE_TIMEOUT_SEC * 1000L - elapsedMs;
+
+    return remainingMs > 0 ? static_cast<int>(remainingMs) : 0;
+}
+
 bool Display::isDisconnected() const
 {
     return m_device ? m_device->isDisconnected() : true;
@@ -1,5 +1,6 @@
 #include "MenuSystem.h"
 #include "DeviceInterfaces.h"
+#include "AllocationCounter.h"
 #include <iostream>
 #include <unistd.h>
 #include <algorithm>
@@ -7,7 +8,7 @@
 Menu::Menu(std::shared_ptr<Display> display, const std::string& title)
     : m_title(title), m_display(display)
 {
-    gettimeofday(&m_lastUpdateTime, nullptr);
+    // m_lastUpdateTime starts at zero so the first render is never debounced
 }
 
 void Menu::addItem(std::shared_ptr<MenuItem> item)
@@ -45,12 +46,14 @@ std::shared_ptr<MenuItem> Menu::getItem(int index) const
     return nullptr;
 }
 
-void Menu::setCurrentSelection(int selection)
+void Menu::setCurrentSelection(int selection, bool redraw)
 {
     if (selection >= 0 && static_cast<size_t>(selection) < m_items.size()) {
         int oldSelection = m_currentItem;
         m_currentItem = selection;
-        updateSelection(oldSelection, m_currentItem);
+        if (redraw) {
+            updateSelection(oldSelection, m_currentItem);
+        }
     }
 }
 
@@ -72,39 +75,42 @@ void Menu::updateSelection(int oldSelection, int newSelection)
     // If the old selection isn't visible, just update the new selection
     if (!oldVisible) {
         int menuPos = newSelection - m_scrollOffset;
-        // Format with the arrow indicator
-        std::string buffer = "> " + m_items[newSelection]->getLabel();
-        
-        // Calculate position and draw
-        int yPos = Config::MENU_START_Y + (menuPos * Config::MENU_ITEM_SPACING);
-        m_display->drawText(0, yPos, buffer);
+        {
+            AllocationGuard guard("Menu::updateSelection");
+            drawItem(newSelection, Config::MENU_START_Y + (menuPos * Config::MENU_ITEM_SPACING));
+        }
+        m_display->present();
         return;
     }
-    
-    // Both old and new selection are visible, so just update those two lines
-    // Update the old selection (remove the arrow)
-    if (oldSelection >= 0 && static_cast<size_t>(oldSelection) < m_items.size()) {
-        int menuPos = oldSelection - m_scrollOffset;
-        // Format without the arrow indicator
-        std::string buffer = "  " + m_items[oldSelection]->getLabel();
-        
-        // Calculate y position and draw
-        int yPos = Config::MENU_START_Y + (menuPos * Config::MENU_ITEM_SPACING);
-        m_display->drawText(0, yPos, buffer);
-        usleep(Config::DISPLAY_CMD_DELAY);
-    }
 
-    // Update the new selection (add the arrow)
-    if (newSelection >= 0 && static_cast<size_t>(newSelection) < m_items.size()) {
-        int menuPos = newSelection - m_scrollOffset;
-        // Format with the arrow indicator
-        std::string buffer = "> " + m_items[newSelection]->getLabel();
-        
-        // Calculate y position and draw
-        int yPos = Config::MENU_START_Y + (menuPos * Config::MENU_ITEM_SPACING);
-        m_display->drawText(0, yPos, buffer);
-        usleep(Config::DISPLAY_CMD_DELAY);
+    {
+        AllocationGuard guard("Menu::updateSelection");
+
+        // Both old and new selection are visible, so just update those two lines
+        // Update the old selection (remove the arrow)
+        if (oldSelection >= 0 && static_cast<size_t>(oldSelection) < m_items.size()) {
+            int menuPos = oldSelection - m_scrollOffset;
+            drawItem(oldSelection, Config::MENU_START_Y + (menuPos * Config::MENU_ITEM_SPACING));
+            pace(Config::DISPLAY_CMD_DELAY);
+        }
+
+        // Update the new selection (add the arrow)
+        if (newSelection >= 0 && static_cast<size_t>(newSelection) < m_items.size()) {
+            int menuPos = newSelection - m_scrollOffset;
+            drawItem(newSelection, Config::MENU_START_Y + (menuPos * Config::MENU_ITEM_SPACING));
+            pace(Config::DISPLAY_CMD_DELAY);
+        }
     }
+
+    m_display->present();
+}
+
+void Menu::drawItem(int index, int y)
+{
+    // Selection indicator and label, formatted on the stack
+    TextLine line(index == m_currentItem ? "> " : "  ");
+    line.append(m_items[index]->getLabel());
+    m_display->drawText(0, y, line);
 }
 
 void Menu::render()
@@ -145,64 +151,60 @@ void Menu::render()
     m_scrollOffset = std::min(static_cast<int>(m_items.size()) - Config::MENU_VISIBLE_ITEMS, m_scrollOffset);
     m_scrollOffset = std::max(0, m_scrollOffset);  // In case we have fewer items than visible slots
 
-    // Clear the display first
-    m_display->clear();
-    usleep(Config::DISPLAY_CLEAR_DELAY);  // 50ms delay after clear
+    {
+        AllocationGuard guard("Menu::render");
 
-    // Draw a title at the top
-    m_display->drawText(24, 0, m_title);
-    usleep(Config::DISPLAY_CMD_DELAY);
+        // Clear the display first
+        m_display->clear();
+        pace(Config::DISPLAY_CLEAR_DELAY);  // 50ms delay after clear
 
-    // Draw a separator line
-    m_display->drawText(0, 8, Config::MENU_SEPARATOR);
-    usleep(Config::DISPLAY_CMD_DELAY);
+        // Draw a title at the top
+        m_display->drawText(24, 0, m_title);
+        pace(Config::DISPLAY_CMD_DELAY);
 
-    // Now draw visible menu items with proper spacing
-    int displayedItems = 0;
-    int maxItemsToDisplay = std::min(static_cast<int>(m_items.size()), Config::MENU_VISIBLE_ITEMS);
+        // Draw a separator line
+        m_display->drawText(0, 8, Config::MENU_SEPARATOR);
+        pace(Config::DISPLAY_CMD_DELAY);
 
-    for (int i = 0; i < maxItemsToDisplay; i++) {
-        int menuIndex = i + m_scrollOffset;
+        // Now draw visible menu items with proper spacing
+        int maxItemsToDisplay = std::min(static_cast<int>(m_items.size()), Config::MENU_VISIBLE_ITEMS);
 
-        // Skip if we've gone past the end of the menu
-        if (static_cast<size_t>(menuIndex) >= m_items.size()) {
-            break;
-        }
+        for (int i = 0; i < maxItemsToDisplay; i++) {
+            int menuIndex = i + m_scrollOffset;
 
-        std::string buffer;
-        // Format menu item text with selection indicator
-        if (menuIndex == m_currentItem) {
-            buffer = "> " + m_items[menuIndex]->getLabel();
-        } else {
-            buffer = "  " + m_items[menuIndex]->getLabel();
-        }
+            // Skip if we've gone past the end of the menu
+            if (static_cast<size_t>(menuIndex) >= m_items.size()) {
+                break;
+            }
 
-        // Calculate y position based on menu start position and spacing
-        int yPos = Config::MENU_START_Y + (i * Config::MENU_ITEM_SPACING);
-        m_display->drawText(0, yPos, buffer);
-        displayedItems++;
+            // Calculate y position based on menu start position and spacing
+            drawItem(menuIndex, Config::MENU_START_Y + (i * Config::MENU_ITEM_SPACING));
 
-        // Add delay between drawing commands
-        usleep(Config::DISPLAY_CMD_DELAY);
-    }
-
-    // Draw scroll indicators if needed
-    if (m_items.size() > Config::MENU_VISIBLE_ITEMS) {
-        // Draw up arrow if there are items above
-        if (m_scrollOffset > 0) {
-            m_display->drawText(Config::DISPLAY_WIDTH - Config::MENU_SCROLL_INDICATOR_WIDTH, 
-                             Config::MENU_START_Y, "^");
+            // Add delay between drawing commands
+            pace(Config::DISPLAY_CMD_DELAY);
         }
 
-        // Draw down arrow if there are items below
-        if (m_scrollOffset + Config::MENU_VISIBLE_ITEMS < static_cast<int>(m_items.size())) {
-            int yPos = Config::MENU_START_Y + ((Config::MENU_VISIBLE_ITEMS - 1) * Config::MENU_ITEM_SPACING);
-            m_display->drawText(Config::DISPLAY_WIDTH - Config::MENU_SCROLL_INDICATOR_WIDTH, yPos, "v");
+        // Draw scroll indicators if needed
+        if (m_items.size() > Config::MENU_VISIBLE_ITEMS) {
+            // Draw up arrow if there are items above
+            if (m_scrollOffset > 0) {
+                m_display->drawText(Config::DISPLAY_WIDTH - Config::MENU_SCROLL_INDICATOR_WIDTH,
+                                 Config::MENU_START_Y, "^");
+            }
+
+            // Draw down arrow if there are items below
+            if (m_scrollOffset + Config::MENU_VISIBLE_ITEMS < static_cast<int>(m_items.size())) {
+                int yPos = Config::MENU_START_Y + ((Config::MENU_VISIBLE_ITEMS - 1) * Config::MENU_ITEM_SPACING);
+                m_display->drawText(Config::DISPLAY_WIDTH - Config::MENU_SCROLL_INDICATOR_WIDTH, yPos, "v");
+            }
         }
     }
 
+    // Send the composed frame in framebuffer mode
+    m_display->present();
+
     // Make sure all commands are processed
-    usleep(Config::DISPLAY_CMD_DELAY * 2);
+    pace(Config::DISPLAY_CMD_DELAY * 2);
 
     // Update the timestamp
     gettimeofday(&m_lastUpdateTime, nullptr);
@@ -211,12 +213,19 @@ void Menu::render()
 
     // If another update was requested during this one, do it now
     if (m_needsUpdate) {
-        usleep(Config::DISPLAY_CMD_DELAY * 2);
+        pace(Config::DISPLAY_CMD_DELAY * 2);
         m_needsUpdate = false;
         render();
     }
 }
 
+void Menu::refresh()
+{
+    // The debounce is for navigation bursts; a changed item list must be drawn
+    m_lastUpdateTime = {0, 0};
+    render();
+}
+
 void Menu::moveSelectionUp(int steps)
 {
     // Remember old selection
@@ -267,12 +276,13 @@ bool Menu::handleRotation(int direction)
     //std::cout << "Menu::handleRotation called with direction: " << direction << std::endl;
     m_display->updateActivityTimestamp();
     
+    // A fast spin arrives as one rotation of several steps
     if (direction < 0) {
         //std::cout << "Moving selection up" << std::endl;
-        moveSelectionUp(1);
+        moveSelectionUp(-direction);
     } else if (direction > 0) {
         //std::cout << "Moving selection down" << std::endl;
-        moveSelectionDown(1);
+        moveSelectionDown(direction);
     }
     
     return true;
@@ -284,3 +294,10 @@ bool Menu::handleButtonPress()
     executeSelected();
     return true;
 }
+
+void Menu::pace(int usec) const
+{
+    if (!m_display->isFrameBuffered()) {
+        usleep(usec);
+    }
+}
@@ -1,4 +1,5 @@
 #include "ScreenModules.h"
+#include "ModuleCatalog.h"
 #include "MenuSystem.h"
 #include "DeviceInterfaces.h"
 #include "Config.h"
@@ -46,47 +47,34 @@ void BrightnessScreen::exit()
     
     // Only save if it's changed
     if (currentBrightness != m_previousBrightness) {
-        Logger::debug("Saving brightness value to persistent storage: " + std::to_string(currentBrightness));
+        LOG_DEBUG("Saving brightness value to persistent storage: " + std::to_string(currentBrightness));
         storage.setValue("brightness", "level", currentBrightness);
     }
 }
 
 bool BrightnessScreen::handleInput()
 {
-    if (m_input->waitForEvents(100) > 0) {
-        bool buttonPressed = false;
-        
-        m_input->processEvents(
-            [this](int direction) {
-                // Rotation adjusts brightness
-                int currentBrightness = m_display->getBrightness();
-                
-                if (direction < 0) {
-                    // Decrease brightness (rotate left)
-                    currentBrightness -= 10;
-                    if (currentBrightness < 0) currentBrightness = 0;
-                } else {
-                    // Increase brightness (rotate right)
-                    currentBrightness += 10;
-                    if (currentBrightness > 255) currentBrightness = 255;
-                }
-                
-                updateBrightnessValue(currentBrightness);
-                m_display->updateActivityTimestamp();
-            },
-            [&]() {
-                // Button press exits
-                buttonPressed = true;
-                m_display->updateActivityTimestamp();
-            }
-        );
-        
-        if (buttonPressed) {
-            return false; // Exit the screen
-        }
+    // Rotation goes through handleGPIORotation(), a press exits
+    return ScreenModule::handleInput();
+}
+
+void BrightnessScreen::handleGPIORotation(int direction)
+{
+    // Rotation adjusts brightness
+    int currentBrightness = m_display->getBrightness();
+    
+    if (direction < 0) {
+        // Decrease brightness (rotate left)
+        currentBrightness -= 10;
+        if (currentBrightness < 0) currentBrightness = 0;
+    } else {
+        // Increase brightness (rotate right)
+        currentBrightness += 10;
+        if (currentBrightness > 255) currentBrightness = 255;
     }
     
-    return true; // Continue running
+    updateBrightnessValue(currentBrightness);
+    m_display->updateActivityTimestamp();
 }
 
 void BrightnessScreen::setupScreen()
@@ -127,3 +115,5 @@ void BrightnessScreen::updateBrightnessValue(int brightness)
     
     //std::cout << "Brightness set to " << brightness << " (" << percentage << "%)" << std::endl;
 }
+
+MICROPANEL_REGISTER_MODULE("brightness", BrightnessScreen);
@@ -0,0 +1,150 @@
+#include "ScreenModules.h"
+#include "ModuleCatalog.h"
+#include "MenuSystem.h"
+#include "DeviceInterfaces.h"
+#include "Config.h"
+#include "PerfCounters.h"
+#include <cstdio>
+#include <unistd.h>
+
+namespace {
+    constexpr int PAGES = 2;
+
+    std::string padLine(const std::string& text)
+    {
+        return text.size() >= 16 ? text.substr(0, 16) : text + std::string(16 - text.size(), ' ');
+    }
+
+    // At most 5 characters ("999", "12.3K", "4.5M", "1.2G")
+    std::string formatCount(uint64_t value)
+    {
+        char text[16];
+        if (value < 1000) {
+            snprintf(text, sizeof(text), "%llu", static_cast<unsigned long long>(value));
+        } else if (value < 1000000) {
+            snprintf(text, sizeof(text), "%.1fK", value / 1e3);
+        } else if (value < 1000000000) {
+            snprintf(text, sizeof(text), "%.1fM", value / 1e6);
+        } else {
+            snprintf(text, sizeof(text), "%.1fG", value / 1e9);
+        }
+        return text;
+    }
+
+    // "In  p50  12.3ms": label, quantile and the value in milliseconds
+    std::string latencyLine(const char* label, const LatencyHistogram::Snapshot& histogram, double quantile)
+    {
+        char text[32];
+        if (histogram.count == 0) {
+            snprintf(text, sizeof(text), "%-3s p%-2d     --", label, static_cast<int>(quantile * 100));
+        } else {
+            snprintf(text, sizeof(text), "%-3s p%-2d%6.1fms", label, static_cast<int>(quantile * 100),
+                     histogram.percentile(quantile) / 1000.0);
+        }
+        return text;
+    }
+}
+
+DiagnosticsScreen::DiagnosticsScreen(std::shared_ptr<Display> display, std::shared_ptr<InputDevice> input)
+    : ScreenModule(display, input)
+{
+}
+
+void DiagnosticsScreen::enter()
+{
+    m_display->clear();
+    usleep(Config::DISPLAY_CMD_DELAY * 3);
+
+    m_page = 0;
+    m_redrawNeeded = true;
+    update();
+}
+
+void DiagnosticsScreen::update()
+{
+    auto now = std::chrono::steady_clock::now();
+    if (!m_redrawNeeded && now - m_lastDraw < std::chrono::milliseconds(Config::DIAGNOSTICS_REFRESH_MS)) {
+        return;
+    }
+    m_redrawNeeded = false;
+    m_lastDraw = now;
+
+    char title[32];
+    snprintf(title, sizeof(title), " Diagnostics %d/%d", m_page + 1, PAGES);
+    m_display->drawText(0, 0, padLine(title));
+    m_display->drawText(0, 8, "----------------");
+    usleep(Config::DISPLAY_CMD_DELAY);
+
+    if (m_page == 0) {
+        drawLatencies();
+    } else {
+        drawCounters();
+    }
+}
+
+void DiagnosticsScreen::drawLatencies()
+{
+    PerfCounters& perf = PerfCounters::getInstance();
+    LatencyHistogram::Snapshot input = perf.snapshot(PerfCounters::Histogram::INPUT_TO_FLUSH);
+    LatencyHistogram::Snapshot frame = perf.snapshot(PerfCounters::Histogram::FRAME_RENDER);
+    LatencyHistogram::Snapshot serial = perf.snapshot(PerfCounters::Histogram::SERIAL_WRITE);
+
+    const std::string lines[] = {
+        latencyLine("In", input, 0.5),
+        latencyLine("In", input, 0.99),
+        latencyLine("Frm", frame, 0.5),
+        latencyLine("Frm", frame, 0.99),
+        latencyLine("Ser", serial, 0.99),
+        "Inputs " + formatCount(perf.get(PerfCounters::Counter::INPUT_EVENTS)),
+    };
+    int y = 16;
+    for (const std::string& line : lines) {
+        m_display->drawText(0, y, padLine(line));
+        usleep(Config::DISPLAY_CMD_DELAY);
+        y += 8;
+    }
+}
+
+void DiagnosticsScreen::drawCounters()
+{
+    PerfCounters& perf = PerfCounters::getInstance();
+    auto count = [&perf](PerfCounters::Counter counter) { return formatCount(perf.get(counter)); };
+
+    const std::string lines[] = {
+        "Serial " + count(PerfCounters::Counter::SERIAL_BYTES) + "B",
+        "Part " + count(PerfCounters::Counter::SERIAL_PARTIAL_WRITES) +
+            " Drop " + count(PerfCounters::Counter::SERIAL_DROPPED_FRAMES),
+        "I2C " + count(PerfCounters::Counter::I2C_TRANSACTIONS) + " Err " + count(PerfCounters::Counter::I2C_ERRORS),
+        "Frames " + count(PerfCounters::Counter::FRAMES),
+        "Spawned " + count(PerfCounters::Counter::CHILD_PROCESSES),
+        "Saves " + count(PerfCounters::Counter::STORAGE_SAVES) +
+            " Fail " + count(PerfCounters::Counter::STORAGE_SAVE_FAILURES),
+    };
+    int y = 16;
+    for (const std::string& line : lines) {
+        m_display->drawText(0, y, padLine(line));
+        usleep(Config::DISPLAY_CMD_DELAY);
+        y += 8;
+    }
+}
+
+void DiagnosticsScreen::exit()
+{
+    m_display->clear();
+    usleep(Config::DISPLAY_CMD_DELAY * 3);
+}
+
+bool DiagnosticsScreen::handleInput()
+{
+    // Same handlers as GPIO mode: rotation pages, a press exits
+    return ScreenModule::handleInput();
+}
+
+void DiagnosticsScreen::handleGPIORotation(int direction)
+{
+    m_page = (m_page + (direction > 0 ? 1 : PAGES - 1)) % PAGES;
+    m_redrawNeeded = true;
+    update();
+}
+
+MICROPANEL_REGISTER_MODULE("diagnostics", DiagnosticsScreen);
@@ -3,10 +3,13 @@
 #include "DeviceInterfaces.h"
 #include "MenuSystem.h"
 #include "Logger.h"
+#include "CommandRunner.h"
+#include "PerfCounters.h"
 #include <iostream>
 #include <unistd.h>
+#include <fcntl.h>
 #include <memory>
-#include <array>
+#include <algorithm>
 #include <sstream>
 #include <sys/wait.h>
 #include <signal.h>
@@ -21,7 +24,10 @@ GenericListScreen::GenericListScreen(std::shared_ptr<Display> display, std::shar
 
 GenericListScreen::~GenericListScreen()
 {
-    // Clean up any resources
+    // The stream's line handler points at this screen
+    if (m_streamId >= 0) {
+        CommandRunner::getInstance().closeStream(m_streamId);
+    }
 }
 
 void GenericListScreen::setConfig(const nlohmann::json& config)
@@ -112,8 +118,27 @@ void GenericListScreen::setConfig(const nlohmann::json& config)
         m_prependStaticItems = config["prepend_static_items"].get<bool>();
     }
 
-    // Load dynamic items if source is specified
+    // Script output is shown from cache at once and refreshed when older than this
+    if (config.contains("cache_ttl") && config["cache_ttl"].is_number()) {
+        m_cacheTtlMs = std::max(0, static_cast<int>(config["cache_ttl"].get<double>() * 1000));
+    }
+    if (config.contains("command_timeout") && config["command_timeout"].is_number()) {
+        m_commandTimeoutMs = std::max(0, static_cast<int>(config["command_timeout"].get<double>() * 1000));
+    }
+
+    // Only Back/Stop-Playback from list_items are kept around dynamic items
+    m_staticItems.clear();
     if (!m_itemsSource.empty()) {
+        for (const auto& item : m_items) {
+            if (item.title == "Back" || item.title == "Stop-Playback") {
+                m_staticItems.push_back(item);
+            }
+        }
+    }
+
+    // Cached sources are loaded now to warm the cache before the first visit;
+    // streamed ones start their producer on enter()
+    if (!m_itemsSource.empty() && !streamItems()) {
         loadDynamicItems();
     }
 
@@ -124,17 +149,26 @@ void GenericListScreen::setConfig(const nlohmann::json& config)
     if (config.contains("callback_action") && config["callback_action"].is_string()) {
         m_callbackAction = config["callback_action"].get<std::string>();
     }
-    Logger::debug("GenericListScreen configured: " + m_id);
+    LOG_DEBUG("GenericListScreen configured: " + m_id);
 }
 
 void GenericListScreen::enter()
 {
-    Logger::debug("Entering GenericListScreen: " + m_id);
+    LOG_DEBUG("Entering GenericListScreen: " + m_id);
+    m_filter.clear();
+    m_filterValid = false;
+    m_searching = false;
+
     // Reload dynamic items if needed
     if (!m_itemsSource.empty()) {
         loadDynamicItems();
     }
 
+    // Current state comes from cache; a refresh redraws it when it lands
+    if (m_stateMode && !m_selectionScript.empty()) {
+        CommandRunner::getInstance().request(m_selectionScript, m_cacheTtlMs, m_commandTimeoutMs);
+    }
+
     // Reset state
     m_selectedIndex = 0;
     m_firstVisibleItem = 0;
@@ -161,11 +195,81 @@ void GenericListScreen::update()
     if (m_asyncState == AsyncState::RUNNING) {
         updateAsyncProgress();
     }
+
+    refreshFromCommands();
+}
+
+void GenericListScreen::refreshFromCommands()
+{
+    auto& commands = CommandRunner::getInstance();
+    bool changed = false;
+
+    if (m_streamId >= 0) {
+        // Lines are appended by CommandRunner::poll(); only rows that come into view need a redraw
+        commands.poll();
+        if (!commands.isStreamRunning(m_streamId)) {
+            commands.closeStream(m_streamId);
+            m_streamId = -1;
+            m_loading = false;
+            changed = true;
+            LOG_DEBUG("GenericListScreen '" + m_id + "' streamed " + std::to_string(m_dynamicItems.size()) + " items");
+        }
+        if (m_itemsArrived) {
+            bool viewFilled = m_renderedCount >= m_firstVisibleItem + m_maxVisibleItems;
+            if (m_layoutShifted || !viewFilled || !m_filter.empty() || m_searching) {
+                changed = true;
+            }
+            if (m_searching) {
+                buildSearchChoices();
+            }
+        }
+        m_itemsArrived = false;
+        m_layoutShifted = false;
+    } else if (!m_itemsSource.empty() && !streamItems()) {
+        CommandRunner::Result result = commands.peek(itemsCommand());
+        if (result.available && result.generation != m_itemsGeneration) {
+            m_itemsGeneration = result.generation;
+
+            // Keep the cursor on the same entry if it is still listed
+            std::string selectedTitle;
+            if (m_selectedIndex >= 0 && m_selectedIndex < itemCount()) {
+                selectedTitle = itemAt(m_selectedIndex).title;
+            }
+            applyDynamicItems(result.output, false);
+
+            m_selectedIndex = std::max(0, findRow(selectedTitle));
+            if (m_selectedIndex < m_firstVisibleItem || m_selectedIndex >= m_firstVisibleItem + m_maxVisibleItems) {
+                m_firstVisibleItem = std::max(0, m_selectedIndex - m_maxVisibleItems + 1);
+            }
+            if (m_searching) {
+                buildSearchChoices();
+            }
+            changed = true;
+        }
+    }
+
+    if (m_stateMode && !m_selectionScript.empty()) {
+        CommandRunner::Result result = commands.peek(m_selectionScript);
+        if (result.available && result.generation != m_selectionGeneration) {
+            changed = true;
+        }
+    }
+
+    // Leave async progress and completion messages alone
+    if (changed && m_asyncState == AsyncState::IDLE && !m_asyncWaitingForUser && !m_shouldExit) {
+        renderList();
+    }
 }
 
 void GenericListScreen::exit()
 {
-    Logger::debug("Exiting GenericListScreen: " + m_id);
+    LOG_DEBUG("Exiting GenericListScreen: " + m_id);
+    if (m_streamId >= 0) {
+        CommandRunner::getInstance().closeStream(m_streamId);
+        m_streamId = -1;
+        m_loading = false;
+    }
+    m_searching = false;
 
     // Clear the display
     m_display->clear();
@@ -194,7 +298,7 @@ bool GenericListScreen::handleInput()
             );
 
             if (inputReceived) {
-                Logger::debug("Async completion message dismissed by user input");
+                LOG_DEBUG("Async completion message dismissed by user input");
                 // Return to normal list view
                 m_asyncState = AsyncState::IDLE;
                 m_asyncWaitingForUser = false;
@@ -219,20 +323,18 @@ bool GenericListScreen::handleInput()
 
         m_input->processEvents(
             [this](int direction) {
+                // While searching the encoder picks the next character instead
+                if (m_searching) {
+                    handleSearchRotation(direction);
+                    m_display->updateActivityTimestamp();
+                    return;
+                }
+
                 // Handle rotation - navigate through items
                 int oldSelection = m_selectedIndex;
 
-                if (direction < 0) {
-                    // Move up
-                    if (m_selectedIndex > 0) {
-                        m_selectedIndex--;
-                    }
-                } else {
-                    // Move down
-                    if (m_selectedIndex < static_cast<int>(m_items.size() - 1)) {
-                        m_selectedIndex++;
-                    }
-                }
+                // Move by the accelerated step count, stopping at either end
+                m_selectedIndex = std::max(0, std::min(itemCount() - 1, m_selectedIndex + direction));
 
                 // Handle scrolling for long lists
                 if (m_selectedIndex < m_firstVisibleItem) {
@@ -255,10 +357,13 @@ bool GenericListScreen::handleInput()
             }
         );
 
-        if (buttonPressed) {
-            // Handle selected item
-            if (m_selectedIndex >= 0 && m_selectedIndex < static_cast<int>(m_items.size())) {
-                const auto& selectedItem = m_items[m_selectedIndex];
+        if (buttonPressed && isSearchRow(m_selectedIndex)) {
+            handleSearchPress();
+            renderList();
+        } else if (buttonPressed) {
+            // Handle selected item (a copy: dynamic rows are rebuilt as the view moves)
+            if (m_selectedIndex >= 0 && m_selectedIndex < itemCount()) {
+                const ListItem selectedItem = itemAt(m_selectedIndex);
 
                 // Handle "Back" item
                 if (selectedItem.title == "Back" || selectedItem.title == "back" || selectedItem.title == "BACK") {
@@ -287,7 +392,7 @@ bool GenericListScreen::handleInput()
 
 void GenericListScreen::renderList()
 {
-    Logger::debug("GenericListScreen::renderList() called for: " + m_id);
+    LOG_DEBUG("GenericListScreen::renderList() called for: " + m_id);
     // Clear lines 0 and 8 to ensure clean title and separator redraw
     m_display->drawText(0, 0, "                "); // Clear title line
     usleep(Config::DISPLAY_CMD_DELAY);
@@ -300,47 +405,37 @@ void GenericListScreen::renderList()
     m_display->drawText(0, 8, "----------------");
     usleep(Config::DISPLAY_CMD_DELAY);
 
-    // If in state mode, run the selection script first
+    // If in state mode, mark the current state (last known output of the selection script)
     if (m_stateMode && !m_selectionScript.empty()) {
-        // Execute the script to get the current state
-        std::string result = executeCommand(m_selectionScript);
-        // Remove trailing newline
-        if (!result.empty() && result.back() == '\n') {
-            result.pop_back();
-        }
-        // Reset all selection states
-        for (auto& item : m_items) {
-            item.isSelected = false;
-        }
-        // Find the matching item
-        for (auto& item : m_items) {
-            if (item.title == result) {
-                item.isSelected = true;
-                break;
-            }
+        CommandRunner::Result result = CommandRunner::getInstance().peek(m_selectionScript);
+        if (result.available) {
+            m_selectionGeneration = result.generation;
+            applySelectionState(result.output);
         }
     }
     // Calculate visible items
-    int lastVisibleItem = std::min(m_firstVisibleItem + m_maxVisibleItems,
-                                  static_cast<int>(m_items.size()));
+    clampSelection();
+    m_renderedCount = itemCount();
+    int lastVisibleItem = std::min(m_firstVisibleItem + m_maxVisibleItems, m_renderedCount);
 
     // Draw visible options (clear and draw each line together to reduce flicker)
     for (int i = m_firstVisibleItem; i < lastVisibleItem; i++) {
         int displayIndex = i - m_firstVisibleItem;
         int yPos = 16 + (displayIndex * 8);
+        const ListItem& item = itemAt(i);
         std::string buffer;
         // Format with selection indicator and/or state highlight
         if (i == m_selectedIndex) {
-            if (m_items[i].isSelected) {
-                buffer = ">[" + m_items[i].title + "]";
+            if (item.isSelected) {
+                buffer = ">[" + item.title + "]";
             } else {
-                buffer = "> " + m_items[i].title;
+                buffer = "> " + item.title;
             }
         } else {
-            if (m_items[i].isSelected) {
-                buffer = " [" + m_items[i].title + "]";
+            if (item.isSelected) {
+                buffer = " [" + item.title + "]";
             } else {
-                buffer = "  " + m_items[i].title;
+                buffer = "  " + item.title;
             }
         }
         // Truncate if too long
@@ -365,7 +460,7 @@ void GenericListScreen::renderList()
     //if (m_firstVisibleItem > 0) {
     //    m_display->drawText(15, 16, "^");
     //}
-    //if (lastVisibleItem < static_cast<int>(m_items.size())) {
+    //if (lastVisibleItem < itemCount()) {
     //    m_display->drawText(15, 16 + ((m_maxVisibleItems - 1) * 10), "v");
     //}
 }
@@ -373,30 +468,32 @@ void GenericListScreen::renderList()
 void GenericListScreen::executeAction(const std::string& actionTemplate)
 {
     std::string action = actionTemplate;
+    std::string selectedValue = itemAt(m_selectedIndex).title;
     // Handle $1 parameter substitution
     size_t paramPos = action.find("$1");
     if (paramPos != std::string::npos) {
-        action.replace(paramPos, 2, m_items[m_selectedIndex].title);
+        action.replace(paramPos, 2, selectedValue);
     }
 
     // Check if this is a module launch action
     if (action.find("launch_module:") == 0) {
         // Handle module launching
         std::string moduleType = action.substr(14); // Remove "launch_module:" prefix
-        std::string selectedValue = m_items[m_selectedIndex].title;
-
-        Logger::debug("GenericListScreen '" + m_id + "' launching module: " + moduleType + " with parameter: " + selectedValue);
+        LOG_DEBUG("GenericListScreen '" + m_id + "' launching module: " + moduleType + " with parameter: " + selectedValue);
 
         // Launch the module with the selected value as parameter
         launchModule(moduleType, selectedValue);
     } else {
         // Traditional shell command execution (existing functionality)
         std::string result = executeCommand(action);
-        Logger::debug("GenericListScreen '" + m_id + "' executed action: " + action);
-        Logger::debug("Executed action: " + action);
-
-        // If in state mode, redraw the screen to show updated state
-        if (m_stateMode) {
+        LOG_DEBUG("GenericListScreen '" + m_id + "' executed action: " + action);
+        LOG_DEBUG("Executed action: " + action);
+
+        // If in state mode, fetch the new state; update() redraws when it arrives
+        if (m_stateMode && !m_selectionScript.empty()) {
+            auto& commands = CommandRunner::getInstance();
+            commands.invalidate(m_selectionScript);
+            commands.request(m_selectionScript, m_cacheTtlMs, m_commandTimeoutMs);
             renderList();
         }
     }
@@ -404,7 +501,7 @@ void GenericListScreen::executeAction(const std::string& actionTemplate)
 
 void GenericListScreen::launchModule(const std::string& moduleType, const std::string& parameter)
 {
-    Logger::debug("GenericListScreen::launchModule - Type: " + moduleType + ", Parameter: " + parameter);
+    LOG_DEBUG("GenericListScreen::launchModule - Type: " + moduleType + ", Parameter: " + parameter);
 
     // Use the callback system to request module launch from parent
     if (m_callback) {
@@ -412,7 +509,7 @@ void GenericListScreen::launchModule(const std::string& moduleType, const std::s
         std::string action = "launch_module";
         std::string value = moduleType + ":" + parameter;
 
-        Logger::debug("GenericListScreen: Notifying callback to launch module");
+        LOG_DEBUG("GenericListScreen: Notifying callback to launch module");
         m_callback->onScreenAction(m_id, action, value);
     } else {
         Logger::warning("GenericListScreen: No callback set - cannot launch module");
@@ -421,20 +518,45 @@ void GenericListScreen::launchModule(const std::string& moduleType, const std::s
 
 std::string GenericListScreen::executeCommand(const std::string& command) const
 {
-    std::array<char, 128> buffer;
-    std::string result;
-
-    FILE* pipe = popen(command.c_str(), "r");
-    if (!pipe) {
+    // Actions must finish before the list moves on, but still get a timeout
+    CommandRunner::Result result = CommandRunner::getInstance().runSync(command, m_commandTimeoutMs);
+    if (result.failed) {
         return "ERROR";
     }
+    return result.output;
+}
 
-    while (fgets(buffer.data(), buffer.size(), pipe) != nullptr) {
-        result += buffer.data();
+void GenericListScreen::applySelectionState(const std::string& output)
+{
+    std::string state = output;
+    // Remove trailing newline
+    if (!state.empty() && state.back() == '\n') {
+        state.pop_back();
+    }
+    if (state == m_currentState) {
+        return;
     }
+    m_currentState = state;
+
+    // Find the matching item; dynamic rows pick it up when they are materialized
+    bool found = false;
+    for (auto* items : {&m_items, &m_staticItems}) {
+        for (auto& item : *items) {
+            item.isSelected = !found && item.title == state;
+            found = found || item.isSelected;
+        }
+    }
+    m_windowValid = false;
+}
 
-    pclose(pipe);
-    return result;
+std::string GenericListScreen::itemsCommand() const
+{
+    // Build the command - include path if specified
+    std::string command = m_itemsSource;
+    if (!m_itemsPath.empty()) {
+        command += " " + m_itemsPath;
+    }
+    return command;
 }
 
 void GenericListScreen::loadDynamicItems()
@@ -443,77 +565,319 @@ void GenericListScreen::loadDynamicItems()
         return;  // No dynamic source defined
     }
 
-    Logger::debug("Loading dynamic items from: " + m_itemsSource);
+    LOG_DEBUG("Loading dynamic items from: " + m_itemsSource);
 
-    // Build the command - include path if specified
-    std::string command = m_itemsSource;
-    if (!m_itemsPath.empty()) {
-        command += " " + m_itemsPath;
+    // Without a cache the list fills in as the script prints it
+    if (streamItems()) {
+        startItemsStream();
+        return;
+    }
+
+    // Cached output comes back at once; a slow script refreshes in the background
+    CommandRunner::Result result = CommandRunner::getInstance().request(itemsCommand(), m_cacheTtlMs,
+                                                                         m_commandTimeoutMs);
+    m_itemsGeneration = result.generation;
+    applyDynamicItems(result.output, !result.available);
+}
+
+void GenericListScreen::startItemsStream()
+{
+    CommandRunner& commands = CommandRunner::getInstance();
+    if (m_streamId >= 0) {
+        commands.closeStream(m_streamId);
     }
 
-    // Execute the command to get the list of items
-    std::string result = executeCommand(command);
+    m_dynamicItems.clear();
+    m_filterValid = false;
+    m_windowValid = false;
+    m_loading = true;
+    m_itemsArrived = false;
+    m_layoutShifted = false;
 
-    // Save any static items from list_items (like Stop-Playback and Back)
-    std::vector<ListItem> staticItems;
-    for (const auto& item : m_items) {
-        if (item.title == "Back" || item.title == "Stop-Playback") {
-            staticItems.push_back(item);
+    m_streamId = commands.openStream(itemsCommand(), [this](const std::string& line) {
+        // Skip empty lines
+        if (!line.empty()) {
+            appendDynamicItem(line);
         }
+    });
+    if (m_streamId < 0) {
+        m_loading = false;
     }
+}
 
-    // Clear existing items
-    m_items.clear();
+void GenericListScreen::appendDynamicItem(const std::string& title)
+{
+    bool hadSearchRow = searchable();
+    m_dynamicItems.append(title);
+    m_itemsArrived = true;
+    m_filterValid = false;
+
+    // Rows already built stay valid unless the filter reorders them
+    if (!m_filter.empty()) {
+        m_windowValid = false;
+    }
 
-    // If prepending static items, add them first
-    if (m_prependStaticItems) {
-        for (const auto& item : staticItems) {
-            m_items.push_back(item);
+    // The search row pushes everything down one; keep the cursor on its item
+    if (!hadSearchRow && searchable()) {
+        m_selectedIndex++;
+        if (m_firstVisibleItem > 0) {
+            m_firstVisibleItem++;
         }
+        m_layoutShifted = true;
     }
+}
 
-    // Parse the result line by line
-    std::istringstream iss(result);
+void GenericListScreen::applyDynamicItems(const std::string& result, bool loading)
+{
+    m_dynamicItems.clear();
+    m_filterValid = false;
+    m_windowValid = false;
+    m_loading = loading;
+
+    // Parse the result line by line; a launcher reply is one comma-separated
+    // line (list-patterns, list-apps)
+    std::string items = result;
+    if (LauncherClient::isCommand(m_itemsSource)) {
+        std::replace(items.begin(), items.end(), ',', '\n');
+    }
+    std::istringstream iss(items);
     std::string line;
-
     while (std::getline(iss, line)) {
         // Skip empty lines
         if (line.empty()) {
             continue;
         }
+        m_dynamicItems.append(line);
+    }
+
+    LOG_DEBUG("Loaded " + std::to_string(m_dynamicItems.size()) + " dynamic items");
+}
 
-        // Remove trailing newline if present
-        if (line.back() == '\n') {
-            line.pop_back();
+int GenericListScreen::itemCount()
+{
+    if (m_itemsSource.empty()) {
+        return static_cast<int>(m_items.size());
+    }
+    int count = dynamicCount();
+    bool placeholder = count == 0 && (m_loading || !m_filter.empty());
+    return (searchable() ? 1 : 0) + static_cast<int>(m_staticItems.size()) + count + (placeholder ? 1 : 0);
+}
+
+const GenericListScreen::ListItem& GenericListScreen::itemAt(int index)
+{
+    if (m_itemsSource.empty()) {
+        return m_items[index];
+    }
+
+    // Search row, prepended statics, dynamic rows or their placeholder, appended statics
+    int row = index;
+    if (searchable()) {
+        if (row == 0) {
+            m_extraItem = ListItem();
+            m_extraItem.title = searchRowTitle();
+            return m_extraItem;
         }
+        row--;
+    }
+    int before = m_prependStaticItems ? static_cast<int>(m_staticItems.size()) : 0;
+    if (row < before) {
+        return m_staticItems[row];
+    }
+    row -= before;
 
-        // Create a new item
-        ListItem item;
-        item.title = line;
+    int count = dynamicCount();
+    if (row < count) {
+        return dynamicItemAt(row);
+    }
+    row -= count;
+    if (count == 0 && (m_loading || !m_filter.empty())) {
+        if (row == 0) {
+            m_extraItem = ListItem();
+            m_extraItem.title = m_loading ? "Loading..." : "No match";
+            return m_extraItem;
+        }
+        row--;
+    }
+    return m_staticItems[before + row];
+}
 
-        // Set the action using the template
-        if (!m_itemsAction.empty()) {
+const GenericListScreen::ListItem& GenericListScreen::dynamicItemAt(int position)
+{
+    int windowEnd = m_windowStart + static_cast<int>(m_window.size());
+    if (!m_windowValid || position < m_windowStart || position >= windowEnd) {
+        // Materialize the view plus a margin on each side; scrolling rebuilds it rarely
+        int viewFirst = std::max(0, m_firstVisibleItem - dynamicFirstRow());
+        int first = std::max(0, std::min(position, viewFirst) - Config::LIST_PREFETCH_ITEMS);
+        int last = std::min(dynamicCount(),
+                            std::max(position + 1, viewFirst + m_maxVisibleItems) + Config::LIST_PREFETCH_ITEMS);
+
+        m_window.clear();
+        m_window.reserve(static_cast<size_t>(last - first));
+        for (int p = first; p < last; p++) {
+            size_t index = m_filter.empty() ? static_cast<size_t>(p)
+                                            : m_dynamicItems.sortedAt(m_filterRange.begin + static_cast<size_t>(p));
+            ListItem item;
+            item.title = m_dynamicItems.at(index);
             item.action = m_itemsAction;
+            item.isSelected = m_stateMode && item.title == m_currentState;
+            m_window.push_back(std::move(item));
         }
+        m_windowStart = first;
+        m_windowValid = true;
+    }
+    return m_window[position - m_windowStart];
+}
+
+int GenericListScreen::dynamicCount()
+{
+    if (m_filter.empty()) {
+        return static_cast<int>(m_dynamicItems.size());
+    }
+    updateFilter();
+    return static_cast<int>(m_filterRange.size());
+}
 
-        m_items.push_back(item);
+int GenericListScreen::dynamicFirstRow() const
+{
+    return (searchable() ? 1 : 0) + (m_prependStaticItems ? static_cast<int>(m_staticItems.size()) : 0);
+}
+
+int GenericListScreen::findRow(const std::string& title)
+{
+    if (title.empty()) {
+        return -1;
+    }
+    for (size_t i = 0; i < m_staticItems.size(); i++) {
+        if (m_staticItems[i].title == title) {
+            int before = m_prependStaticItems ? 0 : dynamicCount();
+            return (searchable() ? 1 : 0) + before + static_cast<int>(i);
+        }
     }
 
-    // If not prepending, add static items at the end (original behavior)
-    if (!m_prependStaticItems) {
-        for (const auto& item : staticItems) {
-            m_items.push_back(item);
+    // Sorted position first, then where that item sits in the current view
+    size_t position = m_dynamicItems.findSorted(title);
+    if (position == ItemIndex::npos) {
+        return -1;
+    }
+    if (!m_filter.empty()) {
+        updateFilter();
+        if (position < m_filterRange.begin || position >= m_filterRange.end) {
+            return -1;
         }
+        return dynamicFirstRow() + static_cast<int>(position - m_filterRange.begin);
+    }
+    return dynamicFirstRow() + static_cast<int>(m_dynamicItems.sortedAt(position));
+}
+
+void GenericListScreen::clampSelection()
+{
+    int count = itemCount();
+    if (m_selectedIndex >= count) {
+        m_selectedIndex = std::max(0, count - 1);
+    }
+    if (m_firstVisibleItem > m_selectedIndex) {
+        m_firstVisibleItem = m_selectedIndex;
+    }
+}
+
+bool GenericListScreen::searchable() const
+{
+    return !m_itemsSource.empty() &&
+           (!m_filter.empty() || m_dynamicItems.size() >= static_cast<size_t>(Config::LIST_SEARCH_MIN_ITEMS));
+}
+
+void GenericListScreen::updateFilter()
+{
+    if (!m_filterValid) {
+        m_filterRange = m_dynamicItems.prefixRange(m_filter);
+        m_filterValid = true;
+    }
+}
+
+void GenericListScreen::buildSearchChoices()
+{
+    updateFilter();
+    m_searchCharacters = m_dynamicItems.nextCharacters(m_filter, m_filterRange,
+                                                       static_cast<size_t>(Config::LIST_SEARCH_MAX_CHOICES));
+    m_searchChoice = std::min(m_searchChoice, searchChoiceCount() - 1);
+}
+
+int GenericListScreen::searchChoiceCount() const
+{
+    return 1 + (m_filter.empty() ? 0 : 1) + static_cast<int>(m_searchCharacters.size());
+}
+
+std::string GenericListScreen::searchChoiceLabel(int choice) const
+{
+    if (choice == 0) {
+        return "OK";
     }
+    if (!m_filter.empty() && choice == 1) {
+        return "<";
+    }
+    return std::string(1, m_searchCharacters[choice - (m_filter.empty() ? 1 : 2)]);
+}
 
-    Logger::debug("Loaded " + std::to_string(m_items.size()) + " items (including static items)");
+std::string GenericListScreen::searchRowTitle() const
+{
+    if (!m_searching) {
+        return m_filter.empty() ? "Find..." : "Find:" + m_filter;
+    }
+    // Keep the end of a long filter next to the choice
+    std::string choice = "[" + searchChoiceLabel(m_searchChoice) + "]";
+    size_t room = 14 - std::min<size_t>(14, 5 + choice.size());
+    std::string shown = m_filter.size() > room ? m_filter.substr(m_filter.size() - room) : m_filter;
+    return "Find:" + shown + choice;
+}
+
+void GenericListScreen::handleSearchRotation(int direction)
+{
+    int count = searchChoiceCount();
+    m_searchChoice = ((m_searchChoice + (direction < 0 ? -1 : 1)) % count + count) % count;
+    renderList();
 }
 
+void GenericListScreen::handleSearchPress()
+{
+    int characterChoice = m_filter.empty() ? 1 : 2;
+    if (!m_searching) {
+        m_searching = true;
+        buildSearchChoices();
+        m_searchChoice = searchChoiceCount() > characterChoice ? characterChoice : 0;
+        return;
+    }
+
+    if (m_searchChoice == 0) {
+        // Done: land on the first match
+        m_searching = false;
+        m_firstVisibleItem = 0;
+        m_selectedIndex = dynamicCount() > 0 ? dynamicFirstRow() : 0;
+        if (m_selectedIndex >= m_maxVisibleItems) {
+            m_firstVisibleItem = m_selectedIndex - m_maxVisibleItems + 1;
+        }
+        return;
+    }
+    if (m_searchChoice == 1 && !m_filter.empty()) {
+        m_filter.pop_back();
+    } else {
+        m_filter += m_searchCharacters[m_searchChoice - characterChoice];
+    }
+
+    // The list below follows the filter while characters are picked
+    m_filterValid = false;
+    m_windowValid = false;
+    m_firstVisibleItem = 0;
+    buildSearchChoices();
+    characterChoice = m_filter.empty() ? 1 : 2;
+    m_searchChoice = searchChoiceCount() > characterChoice ? characterChoice : 0;
+    LOG_DEBUG("GenericListScreen '" + m_id + "' filter '" + m_filter + "': " + std::to_string(dynamicCount()) +
+                  " matches");
+}
 
 // New async process methods
 void GenericListScreen::startAsyncProcess(const ListItem& item)
 {
-    Logger::debug("Starting async process: " + item.action);
+    LOG_DEBUG("Starting async process: " + item.action);
     m_parseProgress = item.parse_progress;
     m_lastParsedPercentage = -1;
     m_asyncResultPattern = item.result_pattern;
@@ -541,11 +905,19 @@ void GenericListScreen::startAsyncProcess(const ListItem& item)
 
     // Fork the process
     m_asyncPid = fork();
+    if (m_asyncPid > 0) {
+        PerfCounters::getInstance().add(PerfCounters::Counter::CHILD_PROCESSES);
+    }
     if (m_asyncPid == 0) {
-        // Child process - redirect output to log file
+        // Child process - redirect output to log file. One open file for
+        // both streams, appending, so stderr lines never overwrite stdout's
         if (!item.log_file.empty()) {
-            freopen(item.log_file.c_str(), "w", stdout);
-            freopen(item.log_file.c_str(), "w", stderr);
+            int logFd = open(item.log_file.c_str(), O_WRONLY | O_CREAT | O_TRUNC | O_APPEND | O_CLOEXEC, 0644);
+            if (logFd >= 0) {
+                dup2(logFd, STDOUT_FILENO);
+                dup2(logFd, STDERR_FILENO);
+                close(logFd);
+            }
         }
 
         // Execute the command
@@ -559,6 +931,17 @@ void GenericListScreen::startAsyncProcess(const ListItem& item)
         m_asyncTimeout = item.timeout;
         m_asyncWaitingForUser = false;
 
+        // Markers, progress and the result are picked up as the log grows
+        m_logSuccess = false;
+        m_logError = false;
+        m_logPercentage = -1;
+        m_resultString.clear();
+        if (m_asyncLogFile.empty()) {
+            m_asyncLog.close();
+        } else {
+            m_asyncLog.open(m_asyncLogFile);
+        }
+
         // Reset display state tracking
         m_lastDisplayedPercentage = -1;
         m_lastDisplayedTime = "";
@@ -569,10 +952,10 @@ void GenericListScreen::startAsyncProcess(const ListItem& item)
         usleep(Config::DISPLAY_CMD_DELAY * 5);
         renderAsyncProgress();
 
-        Logger::debug("Async process started with PID: " + std::to_string(m_asyncPid));
+        LOG_DEBUG("Async process started with PID: " + std::to_string(m_asyncPid));
     } else {
         // Fork failed
-        Logger::debug("Failed to fork async process");
+        LOG_DEBUG("Failed to fork async process");
         m_asyncState = AsyncState::FAILED;
         m_asyncResultMessage = "Failed to start process";
         m_asyncWaitingForUser = true;
@@ -582,6 +965,9 @@ void GenericListScreen::startAsyncProcess(const ListItem& item)
 
 void GenericListScreen::updateAsyncProgress()
 {
+    // Only what was appended since the last update is parsed
+    m_asyncLog.poll([this](const std::string& line) { scanLogLine(line); });
+
     // Check if process completed
     checkAsyncCompletion();
 
@@ -590,8 +976,9 @@ void GenericListScreen::updateAsyncProgress()
         std::chrono::steady_clock::now() - m_asyncStartTime).count();
 
     if (elapsed >= m_asyncTimeout && m_asyncState == AsyncState::RUNNING) {
-        Logger::debug("Async process timed out after " + std::to_string(elapsed) + " seconds");
+        LOG_DEBUG("Async process timed out after " + std::to_string(elapsed) + " seconds");
         killAsyncProcess();
+        m_asyncLog.close();
         m_asyncState = AsyncState::TIMEOUT;
         m_asyncResultMessage = "Action timed-out\nUpate failed!";
         m_asyncWaitingForUser = true;
@@ -706,7 +1093,7 @@ void GenericListScreen::checkAsyncCompletion()
 
     if (result == m_asyncPid) {
         // Process completed
-        Logger::debug("Async process completed with status: " + std::to_string(status));
+        LOG_DEBUG("Async process completed with status: " + std::to_string(status));
 
         // Check log file for success/error patterns
         if (parseLogForCompletion()) {
@@ -721,7 +1108,8 @@ void GenericListScreen::checkAsyncCompletion()
 
     } else if (result == -1) {
         // Error checking process status
-        Logger::debug("Error checking async process status");
+        LOG_DEBUG("Error checking async process status");
+        m_asyncLog.close();
         m_asyncState = AsyncState::FAILED;
         m_asyncResultMessage = "Update status error";
         m_asyncWaitingForUser = true;
@@ -733,7 +1121,7 @@ void GenericListScreen::checkAsyncCompletion()
 void GenericListScreen::killAsyncProcess()
 {
     if (m_asyncPid > 0) {
-        Logger::debug("Killing async process: " + std::to_string(m_asyncPid));
+        LOG_DEBUG("Killing async process: " + std::to_string(m_asyncPid));
         kill(m_asyncPid, SIGTERM);
         usleep(1000000); // Wait 1 second
 
@@ -753,65 +1141,72 @@ bool GenericListScreen::parseLogForCompletion()
     if (m_asyncLogFile.empty()) {
         return true; // Assume success if no log file specified
     }
-
-    std::ifstream logFile(m_asyncLogFile);
-    if (!logFile.is_open()) {
+    if (!m_asyncLog.isOpen()) {
         return false;
     }
 
-    std::string line;
-    bool foundSuccess = false;
-    bool foundError = false;
-
-    // Clear any previous result string
-    m_resultString = "";
-
-    while (std::getline(logFile, line)) {
-        if (line.find("[SUCCESS]") != std::string::npos) {
-            foundSuccess = true;
-        }
-        if (line.find("[ERROR]") != std::string::npos) {
-            foundError = true;
-        }
-
-	// Check for RH850 MCU success patterns
-        if (line.find("Flash verification successful") != std::string::npos ||
-            line.find("Optionbyte verification successful") != std::string::npos) {
-            foundSuccess = true;
-        }
-
-        // Check for RH850 MCU error patterns
-        if (line.find("Error") != std::string::npos ||
-            line.find("Failed") != std::string::npos ||
-            line.find("failed") != std::string::npos) {
-            foundError = true;
-        }
-
-        // Extract result using configurable pattern (generic result extraction)
-        if (!m_asyncResultPattern.empty() && line.find(m_asyncResultPattern) != std::string::npos) {
-            size_t pos = line.find(m_asyncResultPattern);
-            if (pos != std::string::npos) {
-                std::string extractedValue = line.substr(pos + m_asyncResultPattern.length());
-                // Trim leading/trailing whitespace
-                size_t start = extractedValue.find_first_not_of(" \t\r\n");
-                size_t end = extractedValue.find_last_not_of(" \t\r\n");
-                if (start != std::string::npos && end != std::string::npos) {
-                    extractedValue = extractedValue.substr(start, end - start + 1);
-                    // Apply prefix if configured
-                    if (!m_asyncResultPrefix.empty()) {
-                        m_resultString = m_asyncResultPrefix + extractedValue;
-                    } else {
-                        m_resultString = extractedValue;
-                    }
-                }
+    // The rest of the log, including a last line without a newline
+    m_asyncLog.finish([this](const std::string& line) { scanLogLine(line); });
+    m_asyncLog.close();
+
+    // Success if we found [SUCCESS] and no [ERROR]
+    return m_logSuccess && !m_logError;
+}
+
+void GenericListScreen::scanLogLine(const std::string& line)
+{
+    if (line.find("[SUCCESS]") != std::string::npos) {
+        m_logSuccess = true;
+    }
+    if (line.find("[ERROR]") != std::string::npos) {
+        m_logError = true;
+    }
+
+    // Check for RH850 MCU success patterns
+    if (line.find("Flash verification successful") != std::string::npos ||
+        line.find("Optionbyte verification successful") != std::string::npos) {
+        m_logSuccess = true;
+    }
+
+    // Check for RH850 MCU error patterns
+    if (line.find("Error") != std::string::npos ||
+        line.find("Failed") != std::string::npos ||
+        line.find("failed") != std::string::npos) {
+        m_logError = true;
+    }
+
+    // Extract result using configurable pattern; the last match wins
+    if (!m_asyncResultPattern.empty()) {
+        size_t pos = line.find(m_asyncResultPattern);
+        if (pos != std::string::npos) {
+            std::string extractedValue = line.substr(pos + m_asyncResultPattern.length());
+            // Trim leading/trailing whitespace
+            size_t start = extractedValue.find_first_not_of(" \t\r\n");
+            size_t end = extractedValue.find_last_not_of(" \t\r\n");
+            if (start != std::string::npos && end != std::string::npos) {
+                extractedValue = extractedValue.substr(start, end - start + 1);
+                // Apply prefix if configured
+                m_resultString = m_asyncResultPrefix + extractedValue;
             }
         }
     }
 
-    logFile.close();
-
-    // Success if we found [SUCCESS] and no [ERROR]
-    return foundSuccess && !foundError;
+    // Look for percentage patterns like "14.7%" or "29.0%"
+    size_t percentPos = line.find('%');
+    if (percentPos != std::string::npos) {
+        // Find the start of the number before %
+        size_t start = percentPos;
+        while (start > 0 && (std::isdigit(static_cast<unsigned char>(line[start-1])) || line[start-1] == '.')) {
+            start--;
+        }
+        if (start < percentPos) {
+            try {
+                m_logPercentage = static_cast<int>(std::stof(line.substr(start, percentPos - start)));
+            } catch (...) {
+                // Ignore parsing errors
+            }
+        }
+    }
 }
 
 int GenericListScreen::calculateProgressPercentage()
@@ -844,47 +1239,18 @@ std::string GenericListScreen::formatElapsedTime()
 
 int GenericListScreen::parseProgressFromLog()
 {
-    if (m_asyncLogFile.empty()) return -1;
-
-    std::ifstream logFile(m_asyncLogFile);
-    if (!logFile.is_open()) return -1;
-
-    std::string line;
-    int lastPercentage = -1;
-
-    while (std::getline(logFile, line)) {
-        // Look for percentage patterns like "14.7%" or "29.0%"
-        size_t percentPos = line.find('%');
-        if (percentPos != std::string::npos) {
-            // Find the start of the number before %
-            size_t start = percentPos;
-            while (start > 0 && (std::isdigit(line[start-1]) || line[start-1] == '.')) {
-                start--;
-            }
-
-            if (start < percentPos) {
-                std::string percentStr = line.substr(start, percentPos - start);
-                try {
-                    float percent = std::stof(percentStr);
-                    lastPercentage = static_cast<int>(percent);
-                } catch (...) {
-                    // Ignore parsing errors
-                }
-            }
-        }
-    }
-
-    logFile.close();
-    return lastPercentage;
+    // Kept up to date by scanLogLine() as the log grows
+    return m_logPercentage;
 }
+
 void GenericListScreen::handleGPIORotation(int direction) {
-    Logger::debug("GenericListScreen GPIO rotation: " + std::to_string(direction));
+    LOG_DEBUG("GenericListScreen GPIO rotation: " + std::to_string(direction));
 
     // Handle async completion states - rotation should also dismiss the completion message
     if (m_asyncWaitingForUser && (m_asyncState == AsyncState::COMPLETED ||
                                   m_asyncState == AsyncState::FAILED ||
                                   m_asyncState == AsyncState::TIMEOUT)) {
-        Logger::debug("Async process completed, rotation dismissing message and returning to list view");
+        LOG_DEBUG("Async process completed, rotation dismissing message and returning to list view");
         // Return to normal list view (same as button press behavior)
         m_asyncState = AsyncState::IDLE;
         m_asyncWaitingForUser = false;
@@ -895,24 +1261,21 @@ void GenericListScreen::handleGPIORotation(int direction) {
 
     // Don't handle rotation during async process (while it's running)
     if (m_asyncState == AsyncState::RUNNING) {
-        Logger::debug("Ignoring rotation - async process is running");
+        LOG_DEBUG("Ignoring rotation - async process is running");
+        return;
+    }
+
+    if (m_searching) {
+        handleSearchRotation(direction);
+        m_display->updateActivityTimestamp();
         return;
     }
 
     // Use the same navigation logic as handleInput()
     int oldSelection = m_selectedIndex;
 
-    if (direction < 0) {
-        // Move up
-        if (m_selectedIndex > 0) {
-            m_selectedIndex--;
-        }
-    } else {
-        // Move down
-        if (m_selectedIndex < static_cast<int>(m_items.size() - 1)) {
-            m_selectedIndex++;
-        }
-    }
+    // Move by the accelerated step count, stopping at either end
+    m_selectedIndex = std::max(0, std::min(itemCount() - 1, m_selectedIndex + direction));
 
     // Handle scrolling for long lists (same as handleInput)
     if (m_selectedIndex < m_firstVisibleItem) {
@@ -930,14 +1293,14 @@ void GenericListScreen::handleGPIORotation(int direction) {
 }
 
 bool GenericListScreen::handleGPIOButtonPress() {
-    Logger::debug("GenericListScreen GPIO button press - selecting item");
+    LOG_DEBUG("GenericListScreen GPIO button press - selecting item");
 
     // Handle async completion states - only accept input when waiting for user
     // This prevents the "press any button to continue" from triggering menu selection
     if (m_asyncWaitingForUser && (m_asyncState == AsyncState::COMPLETED ||
                                   m_asyncState == AsyncState::FAILED ||
                                   m_asyncState == AsyncState::TIMEOUT)) {
-        Logger::debug("Async process completed, returning to list view");
+        LOG_DEBUG("Async process completed, returning to list view");
         // Return to normal list view
         m_asyncState = AsyncState::IDLE;
         m_asyncWaitingForUser = false;
@@ -948,13 +1311,20 @@ bool GenericListScreen::handleGPIOButtonPress() {
 
     // Don't process button presses during async process
     if (m_asyncState == AsyncState::RUNNING) {
-        Logger::debug("Ignoring button press - async process is running");
+        LOG_DEBUG("Ignoring button press - async process is running");
+        return true;
+    }
+
+    if (isSearchRow(m_selectedIndex)) {
+        handleSearchPress();
+        renderList();
+        m_display->updateActivityTimestamp();
         return true;
     }
 
     // Use the same selection logic as handleInput()
-    if (m_selectedIndex >= 0 && m_selectedIndex < static_cast<int>(m_items.size())) {
-        const auto& selectedItem = m_items[m_selectedIndex];
+    if (m_selectedIndex >= 0 && m_selectedIndex < itemCount()) {
+        const ListItem selectedItem = itemAt(m_selectedIndex);
 
         // Handle "Back" item (same as handleInput)
         if (selectedItem.title == "Back" || selectedItem.title == "back" || selectedItem.title == "BACK") {
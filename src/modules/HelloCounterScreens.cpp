@@ -1,4 +1,5 @@
 #include "ScreenModules.h"
+#include "ModuleCatalog.h"
 #include "MenuSystem.h"
 #include "DeviceInterfaces.h"
 #include "Config.h"
@@ -137,3 +138,6 @@ bool CounterScreen::handleInput()
     
     return true; // Continue
 }
+
+MICROPANEL_REGISTER_MODULE("hello", HelloWorldScreen);
+MICROPANEL_REGISTER_MODULE("counter", CounterScreen);
@@ -0,0 +1,332 @@
+#include "HttpSpeedTest.h"
+#include "Config.h"
+#include "Logger.h"
+#include <algorithm>
+#include <chrono>
+#include <cstring>
+#include <memory>
+#include <curl/curl.h>
+
+namespace {
+    constexpr int POLL_MS = 50;
+    constexpr size_t UPLOAD_BLOCK_SIZE = 256 * 1024;
+    constexpr curl_off_t UPLOAD_BODY_SIZE = static_cast<curl_off_t>(1) << 30;  // Restarted if a server takes it all
+    constexpr long RECEIVE_BUFFER_SIZE = 256 * 1024;
+
+    // One easy handle; lives and is touched only on the worker thread
+    struct Transfer {
+        CURL* easy = nullptr;
+        bool upload = false;
+        const std::vector<char>* block = nullptr;
+        const std::atomic<bool>* cancel = nullptr;
+        uint64_t* counter = nullptr;    // Bytes moved by all transfers
+        curl_off_t lastNow = 0;         // Progress reported so far by the current run
+        uint64_t total = 0;
+        int restarts = 0;
+        bool active = true;
+    };
+
+    int onProgress(void* userp, curl_off_t dltotal, curl_off_t dlnow, curl_off_t ultotal, curl_off_t ulnow)
+    {
+        (void)dltotal;
+        (void)ultotal;
+        Transfer* transfer = static_cast<Transfer*>(userp);
+        curl_off_t now = transfer->upload ? ulnow : dlnow;
+        if (now > transfer->lastNow) {
+            uint64_t delta = static_cast<uint64_t>(now - transfer->lastNow);
+            *transfer->counter += delta;
+            transfer->total += delta;
+            transfer->lastNow = now;
+        }
+        // Non-zero aborts the transfer
+        return transfer->cancel->load() ? 1 : 0;
+    }
+
+    size_t onWrite(char* data, size_t size, size_t nmemb, void* userp)
+    {
+        (void)data;
+        (void)userp;
+        // Only the byte count matters, and that comes from onProgress
+        return size * nmemb;
+    }
+
+    size_t onRead(char* buffer, size_t size, size_t nmemb, void* userp)
+    {
+        const Transfer* transfer = static_cast<const Transfer*>(userp);
+        size_t length = std::min(size * nmemb, transfer->block->size());
+        std::memcpy(buffer, transfer->block->data(), length);
+        return length;
+    }
+
+    int64_t elapsedMs(std::chrono::steady_clock::time_point start)
+    {
+        return std::chrono::duration_cast<std::chrono::milliseconds>(
+            std::chrono::steady_clock::now() - start).count();
+    }
+}
+
+HttpSpeedTest::HttpSpeedTest()
+{
+}
+
+HttpSpeedTest::~HttpSpeedTest()
+{
+    cancel();
+}
+
+bool HttpSpeedTest::start(const Options& options)
+{
+    if (m_running) {
+        return false;
+    }
+    if (m_thread.joinable()) {
+        m_thread.join();
+    }
+
+    m_options = options;
+    m_options.connections = std::max(1, std::min(m_options.connections, Config::SPEEDTEST_MAX_CONNECTIONS));
+    m_options.warmupMs = std::max(0, m_options.warmupMs);
+    m_options.durationMs = std::max(1000, m_options.durationMs);
+    m_options.sampleMs = std::max(50, m_options.sampleMs);
+
+    if (m_options.direction == Direction::UPLOAD && m_uploadBlock.empty()) {
+        // Incompressible-looking filler so transparent compression can't help
+        m_uploadBlock.resize(UPLOAD_BLOCK_SIZE);
+        uint32_t state = 0x12345678;
+        for (auto& byte : m_uploadBlock) {
+            state = state * 1664525 + 1013904223;
+            byte = static_cast<char>(state >> 24);
+        }
+    }
+
+    {
+        std::lock_guard<std::mutex> lock(m_resultMutex);
+        m_samples.clear();
+        m_result = Result();
+    }
+    m_cancel = false;
+    m_progress = 0.0;
+    m_running = true;
+    m_thread = std::thread(&HttpSpeedTest::run, this);
+    return true;
+}
+
+void HttpSpeedTest::cancel()
+{
+    if (m_running) {
+        m_cancel = true;
+    }
+    if (m_thread.joinable()) {
+        m_thread.join();
+    }
+}
+
+double HttpSpeedTest::getProgress() const
+{
+    return m_progress.load();
+}
+
+size_t HttpSpeedTest::getSamples(std::vector<Sample>& out, size_t from) const
+{
+    std::lock_guard<std::mutex> lock(m_resultMutex);
+    for (size_t i = from; i < m_samples.size(); i++) {
+        out.push_back(m_samples[i]);
+    }
+    return m_samples.size();
+}
+
+HttpSpeedTest::Result HttpSpeedTest::getResult() const
+{
+    std::lock_guard<std::mutex> lock(m_resultMutex);
+    return m_result;
+}
+
+void HttpSpeedTest::finish(const Result& result)
+{
+    {
+        std::lock_guard<std::mutex> lock(m_resultMutex);
+        m_result = result;
+    }
+    if (!result.valid) {
+        Logger::error("HttpSpeedTest: " + result.error);
+    }
+    m_running = false;
+}
+
+void HttpSpeedTest::run()
+{
+    const bool upload = m_options.direction == Direction::UPLOAD;
+    const int64_t totalMs = m_options.warmupMs + m_options.durationMs;
+    Result result;
+
+    CURLM* multi = curl_multi_init();
+    if (!multi) {
+        result.error = "Failed to initialize CURL";
+        finish(result);
+        return;
+    }
+
+    struct curl_slist* headers = nullptr;
+    headers = curl_slist_append(headers, "Cache-Control: no-cache, no-store");
+    headers = curl_slist_append(headers, "Pragma: no-cache");
+    if (upload) {
+        // Don't wait a round trip for 100-continue before sending the body
+        headers = curl_slist_append(headers, "Expect:");
+    }
+
+    uint64_t bytes = 0;
+    std::vector<std::unique_ptr<Transfer>> transfers;
+
+    for (int i = 0; i < m_options.connections; i++) {
+        std::unique_ptr<Transfer> transfer(new Transfer());
+        transfer->upload = upload;
+        transfer->block = &m_uploadBlock;
+        transfer->cancel = &m_cancel;
+        transfer->counter = &bytes;
+
+        CURL* easy = curl_easy_init();
+        if (!easy) {
+            continue;
+        }
+        transfer->easy = easy;
+
+        curl_easy_setopt(easy, CURLOPT_URL, m_options.url.c_str());
+        curl_easy_setopt(easy, CURLOPT_PRIVATE, transfer.get());
+        curl_easy_setopt(easy, CURLOPT_NOSIGNAL, 1L);
+        curl_easy_setopt(easy, CURLOPT_FOLLOWLOCATION, 1L);
+        curl_easy_setopt(easy, CURLOPT_MAXREDIRS, 10L);
+        curl_easy_setopt(easy, CURLOPT_CONNECTTIMEOUT, 10L);
+        curl_easy_setopt(easy, CURLOPT_USERAGENT, "MicroPanel SpeedTest/1.0");
+        curl_easy_setopt(easy, CURLOPT_SSL_VERIFYPEER, 0L);
+        curl_easy_setopt(easy, CURLOPT_SSL_VERIFYHOST, 0L);
+        curl_easy_setopt(easy, CURLOPT_FAILONERROR, 1L);
+        curl_easy_setopt(easy, CURLOPT_HTTPHEADER, headers);
+        curl_easy_setopt(easy, CURLOPT_WRITEFUNCTION, onWrite);
+        curl_easy_setopt(easy, CURLOPT_BUFFERSIZE, RECEIVE_BUFFER_SIZE);
+        curl_easy_setopt(easy, CURLOPT_NOPROGRESS, 0L);
+        curl_easy_setopt(easy, CURLOPT_XFERINFOFUNCTION, onProgress);
+        curl_easy_setopt(easy, CURLOPT_XFERINFODATA, transfer.get());
+
+        if (upload) {
+            curl_easy_setopt(easy, CURLOPT_POST, 1L);
+            curl_easy_setopt(easy, CURLOPT_READFUNCTION, onRead);
+            curl_easy_setopt(easy, CURLOPT_READDATA, transfer.get());
+            curl_easy_setopt(easy, CURLOPT_POSTFIELDSIZE_LARGE, UPLOAD_BODY_SIZE);
+#if LIBCURL_VERSION_NUM >= 0x073e00
+            curl_easy_setopt(easy, CURLOPT_UPLOAD_BUFFERSIZE, static_cast<long>(UPLOAD_BLOCK_SIZE));
+#endif
+        }
+
+        curl_multi_add_handle(multi, easy);
+        transfers.push_back(std::move(transfer));
+    }
+
+    const auto start = std::chrono::steady_clock::now();
+    int64_t nextSampleMs = m_options.sampleMs;
+    uint64_t lastSampleBytes = 0;
+    bool warmedUp = m_options.warmupMs == 0;
+    uint64_t measureStartBytes = 0;
+    int64_t measureStartMs = 0;
+    int64_t endMs = 0;
+    int active = static_cast<int>(transfers.size());
+    std::string lastError = active > 0 ? "" : "Failed to initialize CURL";
+
+    LOG_DEBUG("HttpSpeedTest: " + std::string(upload ? "upload" : "download") + " to " +
+                  m_options.url + " over " + std::to_string(active) + " connections");
+
+    while (active > 0 && !m_cancel) {
+        int running = 0;
+        curl_multi_perform(multi, &running);
+
+        int queued = 0;
+        CURLMsg* message;
+        while ((message = curl_multi_info_read(multi, &queued)) != nullptr) {
+            if (message->msg != CURLMSG_DONE) {
+                continue;
+            }
+            Transfer* transfer = nullptr;
+            curl_easy_getinfo(message->easy_handle, CURLINFO_PRIVATE, reinterpret_cast<char**>(&transfer));
+            CURLcode code = message->data.result;
+
+            curl_multi_remove_handle(multi, message->easy_handle);
+            if (code == CURLE_OK && transfer->total > 0) {
+                // Finished early (small test file): run it again to keep the connection loaded
+                transfer->lastNow = 0;
+                transfer->restarts++;
+                curl_multi_add_handle(multi, message->easy_handle);
+            } else {
+                transfer->active = false;
+                active--;
+                lastError = code == CURLE_OK ? "Empty response" : curl_easy_strerror(code);
+                Logger::warning("HttpSpeedTest: connection failed: " + lastError);
+            }
+        }
+
+        int64_t now = elapsedMs(start);
+        while (now >= nextSampleMs) {
+            Sample sample;
+            sample.seconds = nextSampleMs / 1000.0;
+            sample.mbps = (bytes - lastSampleBytes) * 8.0 / (m_options.sampleMs * 1000.0);
+            sample.warmup = nextSampleMs <= m_options.warmupMs;
+            lastSampleBytes = bytes;
+            {
+                std::lock_guard<std::mutex> lock(m_resultMutex);
+                m_samples.push_back(sample);
+            }
+            nextSampleMs += m_options.sampleMs;
+        }
+
+        if (!warmedUp && now >= m_options.warmupMs) {
+            // Everything before this point is connection setup and slow start
+            warmedUp = true;
+            measureStartBytes = bytes;
+            measureStartMs = now;
+        }
+
+        m_progress = std::min(1.0, static_cast<double>(now) / totalMs);
+        if (now >= totalMs) {
+            endMs = now;
+            break;
+        }
+
+        int timeout = static_cast<int>(std::min<int64_t>(POLL_MS, nextSampleMs - now));
+        curl_multi_wait(multi, nullptr, 0, std::max(timeout, 1), nullptr);
+    }
+
+    if (endMs == 0) {
+        endMs = elapsedMs(start);
+    }
+
+    for (auto& transfer : transfers) {
+        if (transfer->total > 0) {
+            result.connections++;
+        }
+        if (transfer->active) {
+            curl_multi_remove_handle(multi, transfer->easy);
+        }
+        curl_easy_cleanup(transfer->easy);
+    }
+    curl_multi_cleanup(multi);
+    curl_slist_free_all(headers);
+
+    result.cancelled = m_cancel.load();
+    result.bytes = warmedUp ? bytes - measureStartBytes : 0;
+    result.seconds = (endMs - measureStartMs) / 1000.0;
+
+    if (result.cancelled) {
+        result.error = "Cancelled";
+    } else if (!warmedUp || endMs - measureStartMs < m_options.sampleMs) {
+        result.error = "Transfer failed: " + lastError;
+    } else if (result.bytes < 100000) {
+        // Same floor as the single-connection test had
+        result.error = "Too little data (" + std::to_string(result.bytes) + " bytes)";
+    } else {
+        result.mbps = result.bytes * 8.0 / 1000000.0 / result.seconds;
+        result.valid = true;
+        LOG_DEBUG("HttpSpeedTest: " + std::to_string(result.bytes) + " bytes in " +
+                      std::to_string(result.seconds) + "s over " + std::to_string(result.connections) +
+                      " connections = " + std::to_string(result.mbps) + " Mbps");
+    }
+
+    finish(result);
+}
@@ -1,20 +1,31 @@
 #include "ScreenModules.h"
+#include "ModuleCatalog.h"
 #include "MenuSystem.h"
 #include "DeviceInterfaces.h"
 #include "IPSelector.h"
+#include "HistoryLog.h"
+#include "IPSuggestions.h"
 #include "Logger.h"
 #include "Config.h"
 #include <iostream>
 #include <unistd.h>
 #include <string>
 #include <memory>
-#include <cstdlib>
-#include <thread>
-#include <atomic>
-#include <csignal>
-#include <sys/wait.h>
-#include <fstream>
-#include <sstream>
+#include <cstdio>
+
+namespace {
+    // Fit RTTs into a 16-column line: one decimal below 10ms, whole ms above
+    std::string formatMs(double ms) {
+        char buffer[16];
+        snprintf(buffer, sizeof(buffer), ms < 10.0 ? "%.1f" : "%.0f", ms);
+        return buffer;
+    }
+
+    std::string padLine(std::string text) {
+        text.resize(16, ' ');
+        return text;
+    }
+}
 
 IPPingScreen::IPPingScreen(std::shared_ptr<Display> display, std::shared_ptr<InputDevice> input)
     : ScreenModule(display, input)
@@ -25,7 +36,7 @@ IPPingScreen::IPPingScreen(std::shared_ptr<Display> display, std::shared_ptr<Inp
     // Create IP Selector with callback
     auto callback = [this](const std::string& ip) {
         m_targetIp = ip;
-        Logger::debug("IP address changed to: " + ip);
+        LOG_DEBUG("IP address changed to: " + ip);
     };
 
     // Create redraw callback to update menu
@@ -34,21 +45,20 @@ IPPingScreen::IPPingScreen(std::shared_ptr<Display> display, std::shared_ptr<Inp
     };
 
     m_ipSelector = std::make_unique<IPSelector>(m_targetIp, 16, callback, redrawCallback);
+    m_ipSelector->enableSuggestions();
 }
 
 void IPPingScreen::enter() {
-    Logger::debug("IPPingScreen: Entered");
+    LOG_DEBUG("IPPingScreen: Entered");
 
     // Reset state
     m_state = IPPingMenuState::MENU_STATE_IP;
-    m_pingInProgress = false;
-    m_pingPid = -1;
-    m_pingResult = -1;
-    m_statusMessage.clear();
+    m_pinger.reset();
+    m_statsGeneration = 0;
     m_shouldExit = false;
     m_lastStatusText = "";   // Reset last status
+    m_lastDetailText = "";
     m_statusChanged = true;  // Force initial status update
-    m_pingTimeMs = 0.0;      // Reset ping time
 
     // Reset IP selector
     m_ipSelector->reset();
@@ -58,15 +68,27 @@ void IPPingScreen::enter() {
 }
 
 void IPPingScreen::update() {
-    // Check ping status periodically if ping is in progress
-    if (m_pingInProgress) {
-        bool wasInProgress = m_pingInProgress;
-        checkPingStatus();
-
-        // Only update status if ping state changed or still in progress
-        if (wasInProgress != m_pingInProgress || m_pingInProgress) {
-            m_statusChanged = true;
+    // Refresh the statistics whenever the engine recorded something new
+    IcmpPinger::Stats stats = m_pinger.getStats();
+    if (stats.generation != m_statsGeneration) {
+        m_statsGeneration = stats.generation;
+        m_statusChanged = true;
+
+        // Replies that arrived between two updates share the newest RTT
+        if (stats.received > m_recordedReplies) {
+            HistoryLog::getInstance().append(HistoryLog::Kind::PING_RTT, stats.lastMs);
+            m_recordedReplies = stats.received;
         }
+        for (; m_recordedLost < stats.lost; m_recordedLost++) {
+            HistoryLog::getInstance().append(HistoryLog::Kind::PING_RTT, 0.0, true);
+        }
+    }
+
+    // Engine stopped on its own (socket error): show Ping again
+    if (!m_pinger.isRunning() && stats.error && m_statusChanged) {
+        renderMenu(false);
+        m_statusChanged = false;
+        return;
     }
 
     // Only update the status line when needed
@@ -76,19 +98,10 @@ void IPPingScreen::update() {
     }
 }
 void IPPingScreen::exit() {
-    Logger::debug("IPPingScreen: Exiting");
-
-    // Terminate any ongoing ping process
-    if (m_pingInProgress && m_pingPid > 0) {
-        kill(m_pingPid, SIGTERM);
-        waitpid(m_pingPid, nullptr, 0);
-        m_pingInProgress = false;
-        m_pingPid = -1;
-    }
+    LOG_DEBUG("IPPingScreen: Exiting");
 
-    // Clean up temporary file if it exists
-    std::string tempFile = "/tmp/micropanel_ping_result.txt";
-    unlink(tempFile.c_str());
+    // Stop the ping engine
+    stopPing();
 
     // Clear display
     m_display->clear();
@@ -128,8 +141,12 @@ bool IPPingScreen::handleInput() {
                     break;
 
                 case IPPingMenuState::MENU_STATE_PING:
-                    // Start ping
-                    startPing();
+                    // Start or stop continuous ping
+                    if (m_pinger.isRunning()) {
+                        stopPing();
+                    } else {
+                        startPing();
+                    }
                     redrawNeeded = true;
                     break;
 
@@ -219,7 +236,8 @@ void IPPingScreen::renderMenu(bool fullRedraw) {
     m_ipSelector->draw(ipSelected, drawFunc);
 
     // Draw Ping line with selection marker
-    std::string pingLine = (m_state == IPPingMenuState::MENU_STATE_PING ? ">Ping" : " Ping");
+    std::string pingLine = (m_state == IPPingMenuState::MENU_STATE_PING ? ">" : " ");
+    pingLine += (m_pinger.isRunning() ? "Stop " : "Ping ");
     m_display->drawText(0, 32, pingLine);
     usleep(Config::DISPLAY_CMD_DELAY);
 
@@ -233,138 +251,65 @@ void IPPingScreen::renderMenu(bool fullRedraw) {
 }
 
 void IPPingScreen::updateStatusLine() {
+    IcmpPinger::Stats stats = m_pinger.getStats();
     std::string statusText;
-
-    // Handle progress of ping
-    if (m_pingInProgress) {
-        static int dots = 0;
-        statusText = "Pinging" + std::string(dots, '.');
-        dots = (dots + 1) % 4;
-    }
-    // Handle ping result
-    else if (m_pingResult != -1) {
-        if (m_pingResult == 0) {
-            // Format with ping time if available
-            char buffer[32];
-            snprintf(buffer, sizeof(buffer), "Success!(%.1fms)", m_pingTimeMs);
-            statusText = buffer;
-        } else {
-            statusText = "No Response";
-        }
+    std::string detailText;
+
+    if (stats.error) {
+        statusText = "Ping Error";
+    } else if (stats.received > 0) {
+        // Last RTT and loss, then min/avg/max and jitter
+        statusText = formatMs(stats.lastMs) + "ms L" + std::to_string(stats.lossPercent()) + "% " +
+                     std::to_string(stats.received) + "/" + std::to_string(stats.sent);
+        detailText = formatMs(stats.minMs) + "/" + formatMs(stats.avgMs) + "/" +
+                     formatMs(stats.maxMs) + " j" + formatMs(stats.jitterMs);
+    } else if (stats.lost > 0) {
+        statusText = "No Response " + std::to_string(stats.lost) + "/" + std::to_string(stats.sent);
+    } else if (m_pinger.isRunning()) {
+        statusText = "Pinging...";
     }
 
     // Only update display if status text has changed
     if (statusText != m_lastStatusText) {
-        m_display->drawText(0, 48, "                ");
-        if (!statusText.empty()) {
-            m_display->drawText(0, 48, statusText);
-        }
+        m_display->drawText(0, 48, padLine(statusText));
         usleep(Config::DISPLAY_CMD_DELAY);
-
-        // Save current status text
         m_lastStatusText = statusText;
     }
-}
 
-void IPPingScreen::checkPingStatus() {
-    if (!m_pingInProgress) return;
-
-    // Check if the ping process has completed
-    int status;
-    pid_t result = waitpid(m_pingPid, &status, WNOHANG);
-
-    if (result == m_pingPid) {
-        // Ping process has completed
-        m_pingInProgress = false;
-        m_pingPid = -1;
-
-        // Determine ping result
-        if (WIFEXITED(status)) {
-            m_pingResult = WEXITSTATUS(status);
-
-            // If ping succeeded, try to read the ping time from temp file
-            if (m_pingResult == 0) {
-                std::ifstream pingFile("/tmp/micropanel_ping_result.txt");
-                if (pingFile.is_open()) {
-                    std::string line;
-                    if (std::getline(pingFile, line) && !line.empty()) {
-                        try {
-                            m_pingTimeMs = std::stod(line);
-                            // Additional validation: if time is 0.0, it might indicate parsing failure
-                            if (m_pingTimeMs <= 0.0) {
-                                Logger::error("Invalid ping time value: " + line);
-                                m_pingResult = 1; // Treat as failure
-                            }
-                        } catch (...) {
-                            Logger::error("Failed to parse ping time: " + line);
-                            m_pingResult = 1; // Treat as failure
-                            m_pingTimeMs = 0.0;
-                        }
-                    } else {
-                        // Empty file or no line - ping actually failed
-                        Logger::error("No ping time found in result file");
-                        m_pingResult = 1; // Treat as failure
-                        m_pingTimeMs = 0.0;
-                    }
-                    pingFile.close();
-                } else {
-                    // Could not open temp file - ping failed
-                    Logger::error("Could not open ping result file");
-                    m_pingResult = 1; // Treat as failure
-                }
-
-                // Clean up temporary file
-                unlink("/tmp/micropanel_ping_result.txt");
-            }
-        } else {
-            m_pingResult = 1; // Error
-        }
-
-        Logger::debug("Ping completed with result: " + std::to_string(m_pingResult) +
-                     (m_pingResult == 0 ? " time: " + std::to_string(m_pingTimeMs) + "ms" : ""));
-
-        // Mark status as changed so it will update once
-        m_statusChanged = true;
+    if (detailText != m_lastDetailText) {
+        m_display->drawText(0, 56, padLine(detailText));
+        usleep(Config::DISPLAY_CMD_DELAY);
+        m_lastDetailText = detailText;
     }
 }
 
-
 void IPPingScreen::startPing() {
-    if (m_pingInProgress) return;
+    if (m_pinger.isRunning()) return;
 
     // Get current IP for ping
     std::string ipAddress = m_ipSelector->getIp();
-    Logger::debug("Starting ping to " + ipAddress);
+    LOG_DEBUG("Starting ping to " + ipAddress);
+
+    // Continuous pings once per second, lost after 2 seconds
+    m_recordedReplies = 0;
+    m_recordedLost = 0;
+    if (!m_pinger.start(ipAddress, 1000, 2000)) {
+        Logger::error("Failed to start ping to " + ipAddress);
+    } else {
+        IPSuggestions::getInstance().remember(ipAddress);
+    }
 
-    // Reset ping state
-    m_pingResult = -1;
-    m_pingTimeMs = 0.0;
-    m_pingInProgress = true;
     m_statusChanged = true;  // Force status update
-    m_lastStatusText = "";   // Reset last status
+}
 
-    // Fork to run ping
-    pid_t child_pid = fork();
-
-    if (child_pid == 0) {
-        // Child process - run ping
-        char command[256];
-        // Use busybox-compatible ping command to extract time value
-        snprintf(command, sizeof(command),
-                "ping -c 1 -W 2 %s | grep 'time=' | awk -F'time=' '{print $2}' | awk '{print $1}' > /tmp/micropanel_ping_result.txt",
-                ipAddress.c_str());
-        int result = system(command);
-        std::quick_exit(result == 0 ? 0 : 1);
-    } else if (child_pid < 0) {
-        // Fork failed
-        Logger::error("Failed to fork ping process");
-        m_pingInProgress = false;
-        m_pingResult = 1;
-        m_statusChanged = true;  // Force status update
-    } else {
-        // Parent process
-        m_pingPid = child_pid;
+void IPPingScreen::stopPing() {
+    if (m_pinger.isRunning()) {
+        IcmpPinger::Stats stats = m_pinger.getStats();
+        LOG_DEBUG("Ping stopped: " + std::to_string(stats.received) + "/" +
+                      std::to_string(stats.sent) + " replies, avg " + std::to_string(stats.avgMs) + "ms");
     }
+    m_pinger.stop();
+    m_statusChanged = true;
 }
 
 
@@ -375,7 +320,7 @@ const std::string& IPPingScreen::getSelectedIp() const {
 
 void IPPingScreen::handleGPIORotation(int direction)
 {
-    Logger::debug("IPPingScreen::handleGPIORotation(" + std::to_string(direction) + ")");
+    LOG_DEBUG("IPPingScreen::handleGPIORotation(" + std::to_string(direction) + ")");
 
     bool handled = false;
     IPPingMenuState previousState = m_state;
@@ -415,7 +360,7 @@ void IPPingScreen::handleGPIORotation(int direction)
             }
         }
 
-        Logger::debug("Menu state changed from " + std::to_string((int)previousState) + " to " + std::to_string((int)m_state));
+        LOG_DEBUG("Menu state changed from " + std::to_string((int)previousState) + " to " + std::to_string((int)m_state));
     }
 
     // Redraw if state changed or IP selector was handled
@@ -428,7 +373,7 @@ void IPPingScreen::handleGPIORotation(int direction)
 
 bool IPPingScreen::handleGPIOButtonPress()
 {
-    Logger::debug("IPPingScreen::handleGPIOButtonPress() - state: " + std::to_string((int)m_state));
+    LOG_DEBUG("IPPingScreen::handleGPIOButtonPress() - state: " + std::to_string((int)m_state));
 
     bool redrawNeeded = false;
 
@@ -436,22 +381,27 @@ bool IPPingScreen::handleGPIOButtonPress()
     switch (m_state) {
         case IPPingMenuState::MENU_STATE_IP:
             // Let IP selector handle button
-            Logger::debug("Handling IP selector button press");
+            LOG_DEBUG("Handling IP selector button press");
             if (m_ipSelector->handleButton()) {
                 redrawNeeded = true;
             }
             break;
 
         case IPPingMenuState::MENU_STATE_PING:
-            // Start ping
-            Logger::debug("Starting ping operation");
-            startPing();
+            // Start or stop continuous ping
+            if (m_pinger.isRunning()) {
+                LOG_DEBUG("Stopping ping operation");
+                stopPing();
+            } else {
+                LOG_DEBUG("Starting ping operation");
+                startPing();
+            }
             redrawNeeded = true;
             break;
 
         case IPPingMenuState::MENU_STATE_EXIT:
             // Exit screen
-            Logger::debug("Exit selected - leaving IPPingScreen");
+            LOG_DEBUG("Exit selected - leaving IPPingScreen");
             m_shouldExit = true;
             return false; // Exit the screen
     }
@@ -464,3 +414,5 @@ bool IPPingScreen::handleGPIOButtonPress()
     m_display->updateActivityTimestamp();
     return !m_shouldExit; // Continue running unless exit was selected
 }
+
+MICROPANEL_REGISTER_MODULE("ping", IPPingScreen);
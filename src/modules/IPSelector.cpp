@@ -1,8 +1,41 @@
 #include "IPSelector.h"
 #include "Logger.h"
+#include "Config.h"
 #include <algorithm>
+#include <cstdio>
+#include <cstring>
+#include <ctime>
 #include <unistd.h>
 
+namespace {
+    // "192.168.1.10" -> "192.168.001.010", the selector's fixed-width form
+    std::string padIp(const std::string& ip) {
+        unsigned int octets[4];
+        if (sscanf(ip.c_str(), "%u.%u.%u.%u", &octets[0], &octets[1], &octets[2], &octets[3]) != 4) {
+            return "";
+        }
+        char padded[16];
+        snprintf(padded, sizeof(padded), "%03u.%03u.%03u.%03u", octets[0] % 1000, octets[1] % 1000,
+                 octets[2] % 1000, octets[3] % 1000);
+        return padded;
+    }
+
+    std::string formatAge(int64_t seen) {
+        int64_t age = std::max<int64_t>(0, static_cast<int64_t>(time(nullptr)) - seen);
+        char buffer[16];
+        if (age < 100) {
+            snprintf(buffer, sizeof(buffer), "%llds", static_cast<long long>(age));
+        } else if (age < 100 * 60) {
+            snprintf(buffer, sizeof(buffer), "%lldm", static_cast<long long>(age / 60));
+        } else if (age < 100 * 3600) {
+            snprintf(buffer, sizeof(buffer), "%lldh", static_cast<long long>(age / 3600));
+        } else {
+            snprintf(buffer, sizeof(buffer), "%lldd", static_cast<long long>(std::min<int64_t>(age / 86400, 999)));
+        }
+        return buffer;
+    }
+}
+
 // Constructor
 IPSelector::IPSelector(const std::string& defaultIp,
                        int yPos,
@@ -29,37 +62,41 @@ void IPSelector::reset()
     m_cursorMode = false;
     m_digitEditMode = false;
     m_cursorPosition = 0;
+    m_suggestMode = false;
+    m_suggestions.clear();
 }
 
-// Increment the digit at cursor position
-void IPSelector::incrementDigit()
+// Show the suggestion at the spin position on the address line
+void IPSelector::previewSuggestion()
 {
-    // Skip dots
-    if (m_ipAddress[m_cursorPosition] == '.') {
-        return;
+    m_shownIp = m_suggestIndex == 0 ? m_ipAddress : padIp(m_suggestions[m_suggestIndex - 1].ip);
+    if (m_shownIp.size() != 15) {
+        m_shownIp = m_ipAddress;
     }
+}
 
-    char digit = m_ipAddress[m_cursorPosition];
-
-    // Increment the digit, wrapping from 9 to 0
-    if (digit >= '0' && digit <= '9') {
-        digit = (digit == '9') ? '0' : digit + 1;
-        m_ipAddress[m_cursorPosition] = digit;
-
-        // Call IP changed callback if provided
-        if (m_onIpChanged) {
-            m_onIpChanged(m_ipAddress);
-        }
+// Press while spinning: take the suggestion, or edit digits from position 0
+bool IPSelector::handleSuggestButton()
+{
+    m_suggestMode = false;
+    if (m_suggestIndex == 0) {
+        m_cursorMode = true;
+        m_cursorPosition = 0;
+        LOG_DEBUG("Entered cursor mode");
+    } else {
+        LOG_DEBUG("Picked suggestion " + m_suggestions[m_suggestIndex - 1].ip);
+        setIp(m_shownIp);
+    }
+    m_suggestions.clear();
 
-        // Trigger redraw if callback is provided
-        if (m_onRedraw) {
-            m_onRedraw();
-        }
+    if (m_onRedraw) {
+        m_onRedraw();
     }
+    return true;
 }
 
-// Decrement the digit at cursor position
-void IPSelector::decrementDigit()
+// Change the digit at cursor position by steps, wrapping between 9 and 0
+void IPSelector::stepDigit(int steps)
 {
     // Skip dots
     if (m_ipAddress[m_cursorPosition] == '.') {
@@ -68,10 +105,10 @@ void IPSelector::decrementDigit()
 
     char digit = m_ipAddress[m_cursorPosition];
 
-    // Decrement the digit, wrapping from 0 to 9
-    if (digit >= '0' && digit <= '9') {
-        digit = (digit == '0') ? '9' : digit - 1;
-        m_ipAddress[m_cursorPosition] = digit;
+    // A fast turn moves several values but redraws once
+    if (digit >= '0' && digit <= '9' && steps % 10 != 0) {
+        int value = ((digit - '0' + steps) % 10 + 10) % 10;
+        m_ipAddress[m_cursorPosition] = static_cast<char>('0' + value);
 
         // Call IP changed callback if provided
         if (m_onIpChanged) {
@@ -101,7 +138,7 @@ void IPSelector::moveCursorLeft()
     if (m_cursorPosition < 0) {
         m_cursorMode = false;
         m_digitEditMode = false;
-        Logger::debug("Exiting cursor mode (moved left from first position)");
+        LOG_DEBUG("Exiting cursor mode (moved left from first position)");
     }
 }
 
@@ -121,17 +158,36 @@ void IPSelector::moveCursorRight()
     if (m_cursorPosition > 14) {
         m_cursorMode = false;
         m_digitEditMode = false;
-        Logger::debug("Exiting cursor mode (moved right past last position)");
+        LOG_DEBUG("Exiting cursor mode (moved right past last position)");
     }
 }
 
 // Handle button press
 bool IPSelector::handleButton()
 {
-    Logger::debug("IPSelector: handleButton - Current state: cursorMode=" + 
+    LOG_DEBUG("IPSelector: handleButton - Current state: cursorMode=" + 
                   std::to_string(m_cursorMode) + ", digitEditMode=" + 
                   std::to_string(m_digitEditMode));
 
+    if (m_suggestMode) {
+        return handleSuggestButton();
+    }
+
+    // First press: offer suggestions when there are any
+    if (!m_cursorMode && !m_digitEditMode && m_suggestionsEnabled) {
+        m_suggestions = IPSuggestions::getInstance().candidates(Config::IP_SUGGEST_MAX, m_ipAddress);
+        if (!m_suggestions.empty()) {
+            m_suggestMode = true;
+            m_suggestIndex = 0;
+            previewSuggestion();
+            if (m_onRedraw) {
+                m_onRedraw();
+            }
+            LOG_DEBUG("Offering " + std::to_string(m_suggestions.size()) + " suggestions");
+            return true;
+        }
+    }
+
     // First press: enter cursor mode
     if (!m_cursorMode && !m_digitEditMode) {
         m_cursorMode = true;
@@ -142,7 +198,7 @@ bool IPSelector::handleButton()
             m_onRedraw();
         }
         
-        Logger::debug("Entered cursor mode");
+        LOG_DEBUG("Entered cursor mode");
         return true;
     }
 
@@ -155,7 +211,7 @@ bool IPSelector::handleButton()
             m_onRedraw();
         }
         
-        Logger::debug("Entered digit edit mode");
+        LOG_DEBUG("Entered digit edit mode");
         return true;
     }
 
@@ -168,7 +224,7 @@ bool IPSelector::handleButton()
             m_onRedraw();
         }
         
-        Logger::debug("Exited digit edit mode");
+        LOG_DEBUG("Exited digit edit mode");
         return true;
     }
 
@@ -179,36 +235,43 @@ bool IPSelector::handleButton()
 // Handle rotation
 bool IPSelector::handleRotation(int direction)
 {
-    Logger::debug("IPSelector: handleRotation - Current state: cursorMode=" +
+    LOG_DEBUG("IPSelector: handleRotation - Current state: cursorMode=" +
                   std::to_string(m_cursorMode) + ", digitEditMode=" +
                   std::to_string(m_digitEditMode) +
                   ", direction=" + std::to_string(direction) +
                   ", cursorPosition=" + std::to_string(m_cursorPosition));
 
+    // Spin through the suggestions, wrapping through the current address
+    if (m_suggestMode) {
+        int positions = static_cast<int>(m_suggestions.size()) + 1;
+        m_suggestIndex = ((m_suggestIndex + direction) % positions + positions) % positions;
+        previewSuggestion();
+        if (m_onRedraw) {
+            m_onRedraw();
+        }
+        return true;
+    }
+
     // Skip rotation if not in edit modes
     if (!m_cursorMode) {
-        Logger::debug("Rotation ignored: not in cursor mode");
+        LOG_DEBUG("Rotation ignored: not in cursor mode");
         return false;
     }
 
     // In digit edit mode, change the digit
     if (m_digitEditMode) {
-        if (direction < 0) {
-            decrementDigit();
-            Logger::debug("Decremented digit at position " + std::to_string(m_cursorPosition));
-        } else if (direction > 0) {
-            incrementDigit();
-            Logger::debug("Incremented digit at position " + std::to_string(m_cursorPosition));
-        }
+        stepDigit(direction);
+        LOG_DEBUG("Stepped digit at position " + std::to_string(m_cursorPosition) + " by " +
+                      std::to_string(direction));
     }
     // In cursor mode (not digit edit), move the cursor
     else {
         if (direction < 0) {
             moveCursorLeft();
-            Logger::debug("Moved cursor left to position " + std::to_string(m_cursorPosition));
+            LOG_DEBUG("Moved cursor left to position " + std::to_string(m_cursorPosition));
         } else if (direction > 0) {
             moveCursorRight();
-            Logger::debug("Moved cursor right to position " + std::to_string(m_cursorPosition));
+            LOG_DEBUG("Moved cursor right to position " + std::to_string(m_cursorPosition));
         }
     }
     
@@ -230,9 +293,27 @@ void IPSelector::draw(bool selected, std::function<void(int, int, const std::str
 
     // IP Address line
     const std::string marker = selected ? ">" : " ";
-    std::string line = marker + m_ipAddress;
+    std::string line = marker + (m_suggestMode ? m_shownIp : m_ipAddress);
     drawFunc(0, m_yPosition, line);
 
+    // Spinning: source and age of the previewed address, position on the right
+    if (m_suggestMode) {
+        char info[32];
+        if (m_suggestIndex == 0) {
+            snprintf(info, sizeof(info), " edit");
+        } else {
+            const IPSuggestions::Candidate& candidate = m_suggestions[m_suggestIndex - 1];
+            snprintf(info, sizeof(info), " %-4s %s", IPSuggestions::sourceTag(candidate.source),
+                     formatAge(candidate.seen).c_str());
+        }
+        char position[16];
+        snprintf(position, sizeof(position), "%d/%zu", m_suggestIndex, m_suggestions.size());
+        std::string infoLine = info;
+        infoLine.resize(16 - strlen(position), ' ');
+        drawFunc(0, m_yPosition + 8, infoLine + position);
+        return;
+    }
+
     // Cursor line: always show when IP is selected, with cursor positioning logic
     if (selected) {
         std::string cursorLine(16, ' ');
@@ -276,5 +357,5 @@ void IPSelector::setIp(const std::string& ipAddress)
 // Check if editing
 bool IPSelector::isEditing() const
 {
-    return (m_cursorMode || m_digitEditMode);
+    return (m_cursorMode || m_digitEditMode || m_suggestMode);
 }
@@ -0,0 +1,186 @@
+#include "IPSuggestions.h"
+#include "Config.h"
+#include "NetworkState.h"
+#include "PersistentStorage.h"
+#include <algorithm>
+#include <cstdio>
+#include <ctime>
+#include <set>
+#include <sstream>
+#include <sys/socket.h>
+
+namespace {
+    constexpr const char* STORAGE_MODULE = "ipsuggestions";
+    constexpr const char* STORAGE_KEY = "recent";
+
+    // "192.168.001.010" (IPSelector) or "192.168.1.10" -> "192.168.1.10"; empty if not IPv4
+    std::string normalize(const std::string& ip) {
+        unsigned int octets[4];
+        char tail = 0;
+        if (sscanf(ip.c_str(), "%u.%u.%u.%u%c", &octets[0], &octets[1], &octets[2], &octets[3], &tail) != 4) {
+            return "";
+        }
+        for (unsigned int octet : octets) {
+            if (octet > 255) {
+                return "";
+            }
+        }
+        if (octets[0] == 0) {
+            return "";
+        }
+        return std::to_string(octets[0]) + "." + std::to_string(octets[1]) + "." + std::to_string(octets[2]) + "." +
+               std::to_string(octets[3]);
+    }
+}
+
+IPSuggestions& IPSuggestions::getInstance()
+{
+    static IPSuggestions instance;
+    return instance;
+}
+
+const char* IPSuggestions::sourceTag(Source source)
+{
+    switch (source) {
+        case Source::NEIGHBOR: return "arp";
+        case Source::RECENT: return "used";
+        case Source::SWEEP: return "scan";
+    }
+    return "";
+}
+
+void IPSuggestions::loadRecent() const
+{
+    // Stored as "ip@seen,ip@seen", newest first
+    if (m_recentLoaded || !PersistentStorage::getInstance().isAvailable()) {
+        return;
+    }
+    m_recentLoaded = true;
+
+    std::istringstream stored(PersistentStorage::getInstance().getValue(STORAGE_MODULE, STORAGE_KEY, std::string()));
+    std::string entry;
+    while (std::getline(stored, entry, ',') && m_recent.size() < static_cast<size_t>(Config::IP_SUGGEST_RECENT)) {
+        size_t at = entry.find('@');
+        Candidate candidate;
+        candidate.ip = normalize(entry.substr(0, at));
+        candidate.source = Source::RECENT;
+        if (candidate.ip.empty() || at == std::string::npos) {
+            continue;
+        }
+        try {
+            candidate.seen = std::stoll(entry.substr(at + 1));
+        } catch (...) {
+            continue;
+        }
+        m_recent.push_back(candidate);
+    }
+}
+
+void IPSuggestions::remember(const std::string& ip)
+{
+    std::string address = normalize(ip);
+    if (address.empty()) {
+        return;
+    }
+
+    std::lock_guard<std::mutex> lock(m_mutex);
+    loadRecent();
+    m_recent.erase(std::remove_if(m_recent.begin(), m_recent.end(),
+                                  [&address](const Candidate& candidate) { return candidate.ip == address; }),
+                   m_recent.end());
+    Candidate candidate;
+    candidate.ip = address;
+    candidate.source = Source::RECENT;
+    candidate.seen = static_cast<int64_t>(time(nullptr));
+    m_recent.insert(m_recent.begin(), candidate);
+    if (m_recent.size() > static_cast<size_t>(Config::IP_SUGGEST_RECENT)) {
+        m_recent.resize(Config::IP_SUGGEST_RECENT);
+    }
+
+    std::string stored;
+    for (const auto& recent : m_recent) {
+        stored += (stored.empty() ? "" : ",") + recent.ip + "@" + std::to_string(recent.seen);
+    }
+    PersistentStorage::getInstance().setValue(STORAGE_MODULE, STORAGE_KEY, stored);
+}
+
+void IPSuggestions::addSweepHost(const std::string& ip)
+{
+    std::string address = normalize(ip);
+    if (address.empty()) {
+        return;
+    }
+
+    std::lock_guard<std::mutex> lock(m_mutex);
+    m_sweep[address] = static_cast<int64_t>(time(nullptr));
+
+    // Forget the oldest finds beyond the limit
+    while (m_sweep.size() > static_cast<size_t>(Config::IP_SUGGEST_SWEEP_MAX)) {
+        auto oldest = std::min_element(m_sweep.begin(), m_sweep.end(),
+                                       [](const std::pair<const std::string, int64_t>& a,
+                                          const std::pair<const std::string, int64_t>& b) {
+                                           return a.second < b.second;
+                                       });
+        m_sweep.erase(oldest);
+    }
+}
+
+std::vector<IPSuggestions::Candidate> IPSuggestions::candidates(size_t limit, const std::string& exclude) const
+{
+    NetworkState& network = NetworkState::getInstance();
+    std::set<std::string> own;
+    own.insert(normalize(exclude));
+    for (const auto& link : network.getInterfaces()) {
+        for (const auto& address : link.addresses) {
+            if (address.family == AF_INET) {
+                own.insert(address.address);
+            }
+        }
+    }
+
+    // Newest sighting per address; on a tie the neighbour table wins, it is live
+    std::map<std::string, Candidate> merged;
+    auto offer = [&merged, &own](const Candidate& candidate) {
+        if (candidate.ip.empty() || own.count(candidate.ip) > 0) {
+            return;
+        }
+        auto existing = merged.find(candidate.ip);
+        if (existing == merged.end() || candidate.seen > existing->second.seen) {
+            merged[candidate.ip] = candidate;
+        }
+    };
+
+    for (const auto& neighbor : network.getNeighbors()) {
+        Candidate candidate;
+        candidate.ip = neighbor.address;
+        candidate.source = Source::NEIGHBOR;
+        candidate.seen = neighbor.seen;
+        offer(candidate);
+    }
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        loadRecent();
+        for (const auto& recent : m_recent) {
+            offer(recent);
+        }
+        for (const auto& host : m_sweep) {
+            Candidate candidate;
+            candidate.ip = host.first;
+            candidate.source = Source::SWEEP;
+            candidate.seen = host.second;
+            offer(candidate);
+        }
+    }
+
+    std::vector<Candidate> ranked;
+    ranked.reserve(merged.size());
+    for (const auto& item : merged) {
+        ranked.push_back(item.second);
+    }
+    std::stable_sort(ranked.begin(), ranked.end(),
+                     [](const Candidate& a, const Candidate& b) { return a.seen > b.seen; });
+    if (ranked.size() > limit) {
+        ranked.resize(limit);
+    }
+    return ranked;
+}
@@ -0,0 +1,420 @@
+#include "IcmpPinger.h"
+#include "Logger.h"
+#include <cerrno>
+#include <cmath>
+#include <cstdlib>
+#include <cstring>
+#include <ctime>
+#include <fcntl.h>
+#include <poll.h>
+#include <unistd.h>
+#include <arpa/inet.h>
+#include <netinet/ip.h>
+#include <netinet/ip_icmp.h>
+#include <sys/eventfd.h>
+#include <sys/socket.h>
+
+namespace {
+    constexpr size_t PAYLOAD_SIZE = 56;     // Same as ping(8)
+    constexpr int MAX_POLL_MS = 100;
+
+    int64_t nowUs(clockid_t clock) {
+        struct timespec ts;
+        clock_gettime(clock, &ts);
+        return static_cast<int64_t>(ts.tv_sec) * 1000000 + ts.tv_nsec / 1000;
+    }
+}
+
+uint16_t IcmpPinger::checksum(const uint8_t* data, size_t length)
+{
+    uint32_t sum = 0;
+    for (size_t i = 0; i + 1 < length; i += 2) {
+        sum += (data[i] << 8) | data[i + 1];
+    }
+    if (length & 1) {
+        sum += data[length - 1] << 8;
+    }
+    while (sum >> 16) {
+        sum = (sum & 0xFFFF) + (sum >> 16);
+    }
+    return htons(static_cast<uint16_t>(~sum));
+}
+
+int IcmpPinger::openIcmpSocket(bool& raw)
+{
+    // Unprivileged ping socket first, raw socket as the fallback
+    raw = false;
+    int fd = socket(AF_INET, SOCK_DGRAM | SOCK_NONBLOCK | SOCK_CLOEXEC, IPPROTO_ICMP);
+    if (fd >= 0) {
+        return fd;
+    }
+
+    int dgramError = errno;
+    fd = socket(AF_INET, SOCK_RAW | SOCK_NONBLOCK | SOCK_CLOEXEC, IPPROTO_ICMP);
+    if (fd < 0) {
+        errno = dgramError;
+        return -1;
+    }
+    raw = true;
+    return fd;
+}
+
+IcmpPinger::IcmpPinger()
+{
+}
+
+IcmpPinger::~IcmpPinger()
+{
+    stop();
+}
+
+bool IcmpPinger::parseAddress(const std::string& address, in_addr& out)
+{
+    // inet_pton rejects "192.168.001.001", so parse octets as decimal
+    uint32_t value = 0;
+    int octets = 0;
+    const char* p = address.c_str();
+
+    while (*p) {
+        char* end;
+        errno = 0;
+        long octet = std::strtol(p, &end, 10);
+        if (end == p || errno != 0 || octet < 0 || octet > 255) {
+            return false;
+        }
+        value = (value << 8) | static_cast<uint32_t>(octet);
+        octets++;
+
+        if (*end == '.') {
+            p = end + 1;
+        } else if (*end == '\0') {
+            p = end;
+        } else {
+            return false;
+        }
+    }
+
+    if (octets != 4) {
+        return false;
+    }
+
+    out.s_addr = htonl(value);
+    return true;
+}
+
+bool IcmpPinger::openSocket()
+{
+    m_fd = openIcmpSocket(m_raw);
+    if (m_fd < 0) {
+        setError(std::string("ICMP socket: ") + strerror(errno));
+        return false;
+    }
+
+    int on = 1;
+    if (setsockopt(m_fd, SOL_SOCKET, SO_TIMESTAMPNS, &on, sizeof(on)) < 0) {
+        LOG_DEBUG("IcmpPinger: kernel receive timestamps unavailable");
+    }
+
+    LOG_DEBUG(std::string("IcmpPinger: using ") + (m_raw ? "raw" : "datagram") + " ICMP socket");
+    return true;
+}
+
+bool IcmpPinger::start(const std::string& address, int intervalMs, int timeoutMs, bool keepSamples)
+{
+    reset();
+
+    std::memset(&m_target, 0, sizeof(m_target));
+    m_target.sin_family = AF_INET;
+    if (!parseAddress(address, m_target.sin_addr)) {
+        setError("Invalid address: " + address);
+        return false;
+    }
+
+    if (!openSocket()) {
+        return false;
+    }
+
+    m_wakeFd = eventfd(0, EFD_NONBLOCK | EFD_CLOEXEC);
+    if (m_wakeFd < 0) {
+        setError(std::string("eventfd: ") + strerror(errno));
+        ::close(m_fd);
+        m_fd = -1;
+        return false;
+    }
+
+    m_intervalMs = intervalMs > 0 ? intervalMs : 1000;
+    m_timeoutMs = timeoutMs > 0 ? timeoutMs : 2000;
+    m_ident = static_cast<uint16_t>(getpid() ^ reinterpret_cast<uintptr_t>(this));
+    m_nextSeq = 0;
+    m_keepSamples = keepSamples;
+    for (auto& pending : m_pending) {
+        pending = Pending();
+    }
+
+    m_running = true;
+    m_thread = std::thread(&IcmpPinger::run, this);
+    return true;
+}
+
+void IcmpPinger::stop()
+{
+    if (m_thread.joinable()) {
+        m_running = false;
+        uint64_t one = 1;
+        if (write(m_wakeFd, &one, sizeof(one)) < 0) {
+            // Thread still notices m_running within one poll interval
+        }
+        m_thread.join();
+    }
+    m_running = false;
+
+    if (m_fd >= 0) {
+        ::close(m_fd);
+        m_fd = -1;
+    }
+    if (m_wakeFd >= 0) {
+        ::close(m_wakeFd);
+        m_wakeFd = -1;
+    }
+}
+
+void IcmpPinger::reset()
+{
+    stop();
+
+    std::lock_guard<std::mutex> lock(m_statsMutex);
+    m_stats = Stats();
+    m_sumMs = 0.0;
+    m_samples.clear();
+}
+
+IcmpPinger::Stats IcmpPinger::getStats() const
+{
+    std::lock_guard<std::mutex> lock(m_statsMutex);
+    return m_stats;
+}
+
+size_t IcmpPinger::getSamples(std::vector<double>& out, size_t from) const
+{
+    std::lock_guard<std::mutex> lock(m_statsMutex);
+    if (from < m_samples.size()) {
+        out.insert(out.end(), m_samples.begin() + static_cast<std::ptrdiff_t>(from), m_samples.end());
+    }
+    return m_samples.size();
+}
+
+void IcmpPinger::setError(const std::string& message)
+{
+    Logger::error("IcmpPinger: " + message);
+    std::lock_guard<std::mutex> lock(m_statsMutex);
+    m_stats.error = true;
+    m_stats.errorMessage = message;
+    m_stats.generation++;
+}
+
+void IcmpPinger::run()
+{
+    int64_t nextSend = nowUs(CLOCK_MONOTONIC);
+
+    while (m_running) {
+        int64_t now = nowUs(CLOCK_MONOTONIC);
+
+        if (now >= nextSend) {
+            if (!sendRequest()) {
+                break;
+            }
+            nextSend += static_cast<int64_t>(m_intervalMs) * 1000;
+            if (nextSend <= now) {
+                // Fell behind (suspend, slow board): don't burst to catch up
+                nextSend = now + static_cast<int64_t>(m_intervalMs) * 1000;
+            }
+        }
+
+        expireRequests(now);
+
+        int64_t waitMs = (nextSend - now + 999) / 1000;
+        if (waitMs > MAX_POLL_MS) waitMs = MAX_POLL_MS;
+        if (waitMs < 0) waitMs = 0;
+
+        struct pollfd fds[2] = {
+            {m_fd, POLLIN, 0},
+            {m_wakeFd, POLLIN, 0}
+        };
+        int ready = poll(fds, 2, static_cast<int>(waitMs));
+        if (ready < 0 && errno != EINTR) {
+            setError(std::string("poll: ") + strerror(errno));
+            break;
+        }
+        if (ready > 0 && (fds[0].revents & POLLIN)) {
+            receiveReplies();
+        }
+    }
+
+    m_running = false;
+}
+
+bool IcmpPinger::sendRequest()
+{
+    uint8_t packet[sizeof(struct icmphdr) + PAYLOAD_SIZE];
+    std::memset(packet, 0, sizeof(packet));
+
+    uint16_t seq = m_nextSeq++;
+    auto* header = reinterpret_cast<struct icmphdr*>(packet);
+    header->type = ICMP_ECHO;
+    header->code = 0;
+    header->un.echo.id = htons(m_ident);     // Replaced by the kernel on ping sockets
+    header->un.echo.sequence = htons(seq);
+
+    for (size_t i = 0; i < PAYLOAD_SIZE; i++) {
+        packet[sizeof(struct icmphdr) + i] = static_cast<uint8_t>(i);
+    }
+    header->checksum = checksum(packet, sizeof(packet));
+
+    Pending& slot = m_pending[seq % SEQ_SLOTS];
+    if (slot.active) {
+        // Slot reused before its timeout: count the old request as lost
+        std::lock_guard<std::mutex> lock(m_statsMutex);
+        m_stats.lost++;
+        m_stats.generation++;
+    }
+    slot.seq = seq;
+    slot.active = true;
+    slot.sentRealUs = nowUs(CLOCK_REALTIME);
+    slot.sentMonoUs = nowUs(CLOCK_MONOTONIC);
+
+    ssize_t sent = sendto(m_fd, packet, sizeof(packet), 0,
+                          reinterpret_cast<const struct sockaddr*>(&m_target), sizeof(m_target));
+    if (sent < 0) {
+        int error = errno;
+        slot.active = false;
+        if (error == EAGAIN || error == ENOBUFS || error == EHOSTUNREACH ||
+            error == ENETUNREACH || error == EHOSTDOWN) {
+            // Transient: the request is simply lost
+            std::lock_guard<std::mutex> lock(m_statsMutex);
+            m_stats.sent++;
+            m_stats.lost++;
+            m_stats.generation++;
+            return true;
+        }
+        setError(std::string("sendto: ") + strerror(error));
+        return false;
+    }
+
+    std::lock_guard<std::mutex> lock(m_statsMutex);
+    m_stats.sent++;
+    m_stats.generation++;
+    return true;
+}
+
+void IcmpPinger::receiveReplies()
+{
+    uint8_t buffer[1500];
+    char control[128];
+
+    while (true) {
+        struct sockaddr_in from;
+        struct iovec iov = {buffer, sizeof(buffer)};
+        struct msghdr msg;
+        std::memset(&msg, 0, sizeof(msg));
+        msg.msg_name = &from;
+        msg.msg_namelen = sizeof(from);
+        msg.msg_iov = &iov;
+        msg.msg_iovlen = 1;
+        msg.msg_control = control;
+        msg.msg_controllen = sizeof(control);
+
+        ssize_t length = recvmsg(m_fd, &msg, MSG_DONTWAIT);
+        if (length < 0) {
+            return;
+        }
+
+        int64_t receivedMonoUs = nowUs(CLOCK_MONOTONIC);
+        int64_t kernelRealUs = 0;
+        for (struct cmsghdr* cmsg = CMSG_FIRSTHDR(&msg); cmsg; cmsg = CMSG_NXTHDR(&msg, cmsg)) {
+            if (cmsg->cmsg_level == SOL_SOCKET && cmsg->cmsg_type == SCM_TIMESTAMPNS) {
+                struct timespec ts;
+                std::memcpy(&ts, CMSG_DATA(cmsg), sizeof(ts));
+                kernelRealUs = static_cast<int64_t>(ts.tv_sec) * 1000000 + ts.tv_nsec / 1000;
+            }
+        }
+
+        // Raw sockets deliver the IP header as well
+        const uint8_t* icmp = buffer;
+        size_t icmpLength = static_cast<size_t>(length);
+        if (m_raw) {
+            if (icmpLength < sizeof(struct iphdr)) continue;
+            size_t ipHeaderLength = (buffer[0] & 0x0F) * 4;
+            if (icmpLength < ipHeaderLength) continue;
+            icmp += ipHeaderLength;
+            icmpLength -= ipHeaderLength;
+        }
+        if (icmpLength < sizeof(struct icmphdr)) continue;
+
+        struct icmphdr header;
+        std::memcpy(&header, icmp, sizeof(header));
+        if (header.type != ICMP_ECHOREPLY) continue;
+        if (from.sin_addr.s_addr != m_target.sin_addr.s_addr) continue;
+        // Ping sockets only see their own replies; raw sockets see everyone's
+        if (m_raw && ntohs(header.un.echo.id) != m_ident) continue;
+
+        uint16_t seq = ntohs(header.un.echo.sequence);
+        Pending& slot = m_pending[seq % SEQ_SLOTS];
+        if (!slot.active || slot.seq != seq) {
+            continue;   // Duplicate or already timed out
+        }
+        slot.active = false;
+
+        int64_t rttUs = receivedMonoUs - slot.sentMonoUs;
+        if (kernelRealUs > 0) {
+            int64_t kernelRttUs = kernelRealUs - slot.sentRealUs;
+            // Ignore the kernel stamp if the wall clock stepped meanwhile
+            if (kernelRttUs >= 0 && kernelRttUs <= rttUs) {
+                rttUs = kernelRttUs;
+            }
+        }
+
+        recordReply(rttUs / 1000.0);
+    }
+}
+
+void IcmpPinger::expireRequests(int64_t nowUs)
+{
+    int64_t timeoutUs = static_cast<int64_t>(m_timeoutMs) * 1000;
+    unsigned int expired = 0;
+
+    for (auto& slot : m_pending) {
+        if (slot.active && nowUs - slot.sentMonoUs >= timeoutUs) {
+            slot.active = false;
+            expired++;
+        }
+    }
+
+    if (expired > 0) {
+        std::lock_guard<std::mutex> lock(m_statsMutex);
+        m_stats.lost += expired;
+        m_stats.generation++;
+    }
+}
+
+void IcmpPinger::recordReply(double rttMs)
+{
+    std::lock_guard<std::mutex> lock(m_statsMutex);
+
+    if (m_stats.received == 0) {
+        m_stats.minMs = rttMs;
+        m_stats.maxMs = rttMs;
+    } else {
+        if (rttMs < m_stats.minMs) m_stats.minMs = rttMs;
+        if (rttMs > m_stats.maxMs) m_stats.maxMs = rttMs;
+        m_stats.jitterMs += (std::fabs(rttMs - m_stats.lastMs) - m_stats.jitterMs) / 16.0;
+    }
+
+    m_stats.received++;
+    m_stats.lastMs = rttMs;
+    m_sumMs += rttMs;
+    m_stats.avgMs = m_sumMs / m_stats.received;
+    m_stats.generation++;
+    if (m_keepSamples) {
+        m_samples.push_back(rttMs);
+    }
+}
@@ -1,169 +1,199 @@
 #include "ScreenModules.h"
+#include "ModuleCatalog.h"
 #include "MenuSystem.h"
 #include "DeviceInterfaces.h"
+#include "ModuleDependency.h"
 #include "Config.h"
 #include "Logger.h"
-#include <iostream>
-#include <unistd.h>
+#include "HistoryLog.h"
+#include <cstdio>
 #include <cstdlib>
-#include <ctime>
-#include <chrono>
+#include <sstream>
+#include <unistd.h>
+
+namespace {
+    constexpr int COLUMNS = 16;
+    constexpr int ROWS = 8;
+
+    // Latency fitting a 16-column row: one decimal below 100ms, whole ms above
+    std::string formatMs(double ms) {
+        char buffer[16];
+        snprintf(buffer, sizeof(buffer), ms < 100.0 ? "%.1fms" : "%.0fms", ms);
+        return buffer;
+    }
+
+    // Label on the left, value flush right; the label gives way when both don't fit
+    std::string stageRow(std::string label, const std::string& value) {
+        int room = COLUMNS - static_cast<int>(value.size()) - 1;
+        if (static_cast<int>(label.size()) > room) {
+            label.resize(room > 0 ? static_cast<size_t>(room) : 0);
+        }
+        label.resize(static_cast<size_t>(COLUMNS) - value.size(), ' ');
+        return label + value;
+    }
+
+    std::string padLine(std::string text) {
+        text.resize(COLUMNS, ' ');
+        return text;
+    }
+}
 
 InternetTestScreen::InternetTestScreen(std::shared_ptr<Display> display, std::shared_ptr<InputDevice> input)
-    : ScreenModule(display, input),
-      m_testCompleted(false),
-      m_testResult(-1),
-      m_progress(0)
+    : ScreenModule(display, input)
 {
 }
 
+ReachabilityProbe::Options InternetTestScreen::loadOptions() const
+{
+    // Optional "internet" dependencies override the built-in targets
+    ModuleDependency& dependencies = ModuleDependency::getInstance();
+    ReachabilityProbe::Options options;
+
+    options.dnsName = dependencies.getDependencyPath("internet", "dns_name");
+    if (options.dnsName.empty()) {
+        options.dnsName = Config::INTERNET_TEST_DNS_NAME;
+    }
+
+    std::string port = dependencies.getDependencyPath("internet", "tcp_port");
+    options.tcpPort = port.empty() ? Config::INTERNET_TEST_TCP_PORT : std::atoi(port.c_str());
+    if (options.tcpPort <= 0 || options.tcpPort > 65535) {
+        options.tcpPort = Config::INTERNET_TEST_TCP_PORT;
+    }
+
+    std::string timeout = dependencies.getDependencyPath("internet", "timeout");
+    options.timeoutMs = timeout.empty() ? Config::INTERNET_TEST_TIMEOUT_MS : std::atoi(timeout.c_str());
+    if (options.timeoutMs <= 0) {
+        options.timeoutMs = Config::INTERNET_TEST_TIMEOUT_MS;
+    }
+
+    std::string targets = dependencies.getDependencyPath("internet", "targets");
+    std::istringstream fields(targets.empty() ? std::string(Config::INTERNET_TEST_TARGETS) : targets);
+    std::string target;
+    while (std::getline(fields, target, ',') &&
+           static_cast<int>(options.targets.size()) < Config::INTERNET_TEST_MAX_TARGETS) {
+        if (!target.empty()) {
+            options.targets.push_back(target);
+        }
+    }
+    return options;
+}
+
 void InternetTestScreen::enter()
 {
-    Logger::debug("InternetTestScreen: Entered");
+    LOG_DEBUG("InternetTestScreen: Entered");
     m_running = true;
-    
-    // Clear display and show initial screen
+    m_interrupted = false;
+    m_recorded = false;
+
     m_display->clear();
     usleep(Config::DISPLAY_CMD_DELAY * 3);
+    m_lastRows.assign(ROWS, std::string(COLUMNS, ' '));
+
+    ReachabilityProbe::Options options = loadOptions();
+    m_probe.start(options);
+    m_generation = m_probe.getGeneration() - 1;  // Draw the pending rows right away
 
-    // Draw title
-    m_display->drawText(0, 0, " Internet Test");
-    usleep(Config::DISPLAY_CMD_DELAY);
-
-    // Draw separator
-    m_display->drawText(0, 8, "----------------");
-    usleep(Config::DISPLAY_CMD_DELAY);
-
-    // Draw testing message
-    m_display->drawText(20, 20, "Testing...");
-    usleep(Config::DISPLAY_CMD_DELAY);
-
-    // Initial progress bar (0%)
-    m_display->drawProgressBar(10, 35, 108, 15, 0);
-    usleep(Config::DISPLAY_CMD_DELAY);
-
-    // Reset state
-    m_testCompleted = false;
-    m_testResult = -1;
-    m_progress = 0;
-    m_progressLastUpdated = 0;
-    m_animationLastUpdated = 0;
-    m_resultDisplayed = false;
-
-    // Record start time
-    m_startTime = std::chrono::steady_clock::now();
-
-    // Start the test in a separate thread
-    startTest();
-    
-    Logger::debug("InternetTestScreen: Test started");
+    LOG_DEBUG("InternetTestScreen: Probing " + options.dnsName + ":" + std::to_string(options.tcpPort) +
+              " and " + std::to_string(options.targets.size()) + " ICMP targets");
 }
 
-void InternetTestScreen::startTest()
+void InternetTestScreen::update()
 {
-    // Start a new thread for the test
-    m_testThread = std::thread([this]() {
-        Logger::debug("InternetTestScreen: Test thread started for " + m_testServer);
-        
-        // Sleep for a short time to allow UI to initialize
-        std::this_thread::sleep_for(std::chrono::milliseconds(500));
-        
-        // Perform the ping test
-        int result = pingServer(m_testServer, m_timeoutSec);
-        
-        Logger::debug("InternetTestScreen: Test completed with result " + std::to_string(result));
-
-        // Update state when complete
-        m_testResult = result;
-        m_testCompleted = true;
-        m_progress = 100;
-    });
-
-    // Detach the thread to allow it to run independently
-    m_testThread.detach();
+    unsigned int generation = m_probe.getGeneration();
+    if (generation != m_generation) {
+        m_generation = generation;
+        render();
+    }
+
+    // The TCP connect stands for the whole run, as in verdict()
+    if (!m_recorded && !m_interrupted && m_probe.isFinished()) {
+        m_recorded = true;
+        ReachabilityProbe::Result tcp = m_probe.getResults()[ReachabilityProbe::ROW_TCP];
+        bool ok = tcp.status == ReachabilityProbe::Status::OK;
+        HistoryLog::getInstance().append(HistoryLog::Kind::INTERNET_RTT, ok ? tcp.ms : 0.0, !ok);
+    }
 }
 
-void InternetTestScreen::update()
+std::string InternetTestScreen::verdict(const std::vector<ReachabilityProbe::Result>& results) const
 {
-    auto currentTime = std::chrono::steady_clock::now();
-    auto elapsedMs = std::chrono::duration_cast<std::chrono::milliseconds>(
-        currentTime - m_startTime).count();
-    
-    // Update animation every 500ms
-    bool shouldUpdateAnimation = (elapsedMs - m_animationLastUpdated >= 500);
-    if (shouldUpdateAnimation) {
-        m_animationLastUpdated = elapsedMs;
-        
-        if (!m_testCompleted) {
-            // Update animation dots
-            int dots = ((elapsedMs / 500) % 4);
-            std::string message = "Testing";
-            for (int i = 0; i < dots; i++) {
-                message += ".";
-            }
-            for (int i = dots; i < 3; i++) {
-                message += " ";
-            }
-            
-            m_display->drawText(0, 20, "                ");
-            m_display->drawText(20, 20, message);
-            usleep(Config::DISPLAY_CMD_DELAY);
-            
-            Logger::debug("InternetTestScreen: Animation update: " + message);
-        }
+    using Status = ReachabilityProbe::Status;
+    if (m_interrupted) {
+        return "Interrupted";
     }
-    
-    // Update progress every 250ms if test is running
-    bool shouldUpdateProgress = (elapsedMs - m_progressLastUpdated >= 250);
-    if (shouldUpdateProgress && !m_testCompleted) {
-        m_progressLastUpdated = elapsedMs;
-        
-        // Calculate progress as a percentage of the timeout
-        int progress = static_cast<int>((elapsedMs * 100) / (m_timeoutSec * 1000));
-        if (progress > 95) progress = 95;  // Cap at 95% until complete
-        
-        if (progress > m_progress) {
-            m_progress = progress;
-            m_display->drawProgressBar(10, 35, 108, 15, progress);
-            usleep(Config::DISPLAY_CMD_DELAY);
-            Logger::debug("InternetTestScreen: Progress update: " + std::to_string(progress) + "%");
+    if (!m_probe.isFinished()) {
+        return "Testing...";
+    }
+
+    bool anyTarget = false;
+    for (size_t row = ReachabilityProbe::ROW_FIRST_TARGET; row < results.size(); row++) {
+        anyTarget = anyTarget || results[row].status == Status::OK;
+    }
+
+    // A working TCP connect is what applications need; otherwise name the lowest broken layer
+    if (results[ReachabilityProbe::ROW_TCP].status == Status::OK) {
+        return "Internet OK";
+    }
+    if (anyTarget) {
+        return results[ReachabilityProbe::ROW_DNS].status == Status::FAILED ? "DNS problem" : "TCP blocked";
+    }
+    if (results[ReachabilityProbe::ROW_GATEWAY].status == Status::FAILED) {
+        return "L2/GW problem";
+    }
+    return "Upstream down";
+}
+
+void InternetTestScreen::render()
+{
+    using Status = ReachabilityProbe::Status;
+    std::vector<ReachabilityProbe::Result> results = m_probe.getResults();
+    bool done = m_interrupted || m_probe.isFinished();
+
+    std::vector<std::string> rows(ROWS, std::string(COLUMNS, ' '));
+    rows[0] = padLine(verdict(results));
+    for (size_t i = 0; i < results.size() && i + 2 < ROWS; i++) {
+        const ReachabilityProbe::Result& result = results[i];
+        std::string label = result.label;
+        std::string value;
+        switch (result.status) {
+            case Status::PENDING:
+                value = done ? "-" : "...";
+                break;
+            case Status::OK:
+                if (result.ms < 0) {
+                    value = result.detail;      // Reachable without a latency, e.g. ARP only
+                } else {
+                    value = formatMs(result.ms);
+                    if (!result.detail.empty()) {
+                        label += " " + result.detail;
+                    }
+                }
+                break;
+            case Status::FAILED:
+                value = result.detail.empty() ? "fail" : result.detail;
+                break;
+            case Status::SKIPPED:
+                value = result.detail.empty() ? "-" : result.detail;
+                break;
         }
+        rows[i + 1] = stageRow(label, value);
     }
-    
-    // Handle test completion
-    if (m_testCompleted && !m_resultDisplayed) {
-        // Update to 100%
-        m_display->drawProgressBar(10, 35, 108, 15, 100);
-        usleep(Config::DISPLAY_CMD_DELAY);
-        
-        // Clear testing message
-        m_display->drawText(0, 20, "                ");
-        usleep(Config::DISPLAY_CMD_DELAY);
-        
-        // Show result
-        if (m_testResult == 0) {
-            m_display->drawText(20, 20, "CONNECTED!");
-            Logger::debug("InternetTestScreen: Showing CONNECTED message");
-        } else {
-            m_display->drawText(20, 20, "NO CONNECTION");
-            Logger::debug("InternetTestScreen: Showing NO CONNECTION message");
+    rows[ROWS - 1] = padLine(done ? " Press to exit" : " Press to stop");
+
+    // Only rows that changed go to the display
+    for (int i = 0; i < ROWS; i++) {
+        if (rows[i] != m_lastRows[i]) {
+            m_display->drawText(0, i * 8, rows[i]);
+            usleep(Config::DISPLAY_CMD_DELAY);
+            m_lastRows[i] = rows[i];
         }
-        usleep(Config::DISPLAY_CMD_DELAY);
-        
-        // Show press button message
-        m_display->drawText(15, 60, "Press to exit");
-        usleep(Config::DISPLAY_CMD_DELAY);
-        
-        m_resultDisplayed = true;
-        Logger::debug("InternetTestScreen: Result displayed");
     }
 }
 
 void InternetTestScreen::exit()
 {
-    Logger::debug("InternetTestScreen: Exiting");
-    
-    // Clean up
+    LOG_DEBUG("InternetTestScreen: Exiting");
+
+    m_probe.stop();
     m_running = false;
     m_display->clear();
     usleep(Config::DISPLAY_CMD_DELAY * 3);
@@ -181,43 +211,26 @@ bool InternetTestScreen::handleInput()
                 m_display->updateActivityTimestamp();
             },
             [&buttonPressed, this]() {
-                // Button press 
                 buttonPressed = true;
                 m_display->updateActivityTimestamp();
-                Logger::debug("InternetTestScreen: Button pressed");
+                LOG_DEBUG("InternetTestScreen: Button pressed");
             }
         );
 
         if (buttonPressed) {
-            if (m_testCompleted) {
-                Logger::debug("InternetTestScreen: Test completed, exiting on button press");
-                return false; // Exit if test is complete
-            } else {
-                // If test is still running, mark it as complete with an interrupted status
-                Logger::debug("InternetTestScreen: Test interrupted by user");
-                m_testCompleted = true;
-                m_testResult = 2; // 2 = interrupted
-                return true; // Stay in screen to show result
+            if (m_interrupted || m_probe.isFinished()) {
+                LOG_DEBUG("InternetTestScreen: Test completed, exiting on button press");
+                return false;
             }
+            // Stop the probe but stay to show what it found so far
+            LOG_DEBUG("InternetTestScreen: Test interrupted by user");
+            m_probe.stop();
+            m_interrupted = true;
+            render();
         }
     }
 
     return m_running; // Continue as long as running is true
 }
 
-int InternetTestScreen::pingServer(const std::string& server, int timeoutSec)
-{
-    Logger::debug("InternetTestScreen: Pinging server " + server);
-    
-    // Construct ping command with timeout and minimal output
-    std::string command = "ping -c 1 -W " + std::to_string(timeoutSec) + " " + server + " > /dev/null 2>&1";
-
-    // Execute the command
-    int result = system(command.c_str());
-    
-    // Log the result
-    Logger::debug("InternetTestScreen: Ping returned " + std::to_string(result));
-
-    // Return 0 for success, non-zero for failure
-    return (result == 0) ? 0 : 1;
-}
+MICROPANEL_REGISTER_MODULE("internet", InternetTestScreen);
@@ -0,0 +1,942 @@
+#include "Iperf3Client.h"
+#include "Iperf3Protocol.h"
+#include "Config.h"
+#include "Logger.h"
+#include <nlohmann/json.hpp>
+#include <algorithm>
+#include <cerrno>
+#include <cmath>
+#include <cstring>
+#include <ctime>
+#include <fcntl.h>
+#include <netdb.h>
+#include <poll.h>
+#include <pthread.h>
+#include <sched.h>
+#include <unistd.h>
+#include <arpa/inet.h>
+#include <netinet/in.h>
+#include <netinet/tcp.h>
+#include <sys/eventfd.h>
+#include <sys/resource.h>
+#include <sys/sendfile.h>
+#include <sys/socket.h>
+#include <sys/syscall.h>
+#include <sys/time.h>
+
+using json = nlohmann::json;
+namespace P = Iperf3Protocol;
+
+namespace {
+    constexpr int CONNECT_TIMEOUT_MS = 5000;
+    constexpr int CONTROL_TIMEOUT_MS = 10000;
+    constexpr int STREAM_POLL_MS = 100;
+    constexpr size_t DEFAULT_UDP_BLOCK = 1460;
+    constexpr uint64_t DEFAULT_UDP_RATE = 1000000;  // iperf3 default for UDP
+    constexpr int UDP_BATCH = 32;
+
+    int64_t monotonicUs() {
+        struct timespec ts;
+        clock_gettime(CLOCK_MONOTONIC, &ts);
+        return static_cast<int64_t>(ts.tv_sec) * 1000000 + ts.tv_nsec / 1000;
+    }
+
+    double realtimeSeconds() {
+        struct timespec ts;
+        clock_gettime(CLOCK_REALTIME, &ts);
+        return ts.tv_sec + ts.tv_nsec / 1e9;
+    }
+
+    int createPayloadFd(const uint8_t* data, size_t length) {
+#ifdef SYS_memfd_create
+        int fd = static_cast<int>(syscall(SYS_memfd_create, "micropanel-iperf", 0));
+        if (fd < 0) {
+            return -1;
+        }
+        size_t done = 0;
+        while (done < length) {
+            ssize_t n = write(fd, data + done, length - done);
+            if (n <= 0) {
+                close(fd);
+                return -1;
+            }
+            done += n;
+        }
+        return fd;
+#else
+        (void)data;
+        (void)length;
+        return -1;
+#endif
+    }
+
+    double cpuSeconds(const struct timeval& tv) {
+        return tv.tv_sec + tv.tv_usec / 1e6;
+    }
+}
+
+// One data connection and its counters; written by its own thread only
+struct Iperf3Client::Stream {
+    int id = 0;
+    int fd = -1;
+    int cpu = -1;
+    std::thread thread;
+    std::atomic<uint64_t> bytes{0};
+
+    // UDP
+    std::atomic<uint64_t> packets{0};       // Sent, or highest sequence received
+    std::atomic<uint64_t> errors{0};        // Lost (receiver)
+    std::atomic<double> jitter{0.0};        // Seconds (receiver)
+    uint64_t outOfOrder = 0;
+    double previousTransit = 0.0;
+    bool haveTransit = false;
+
+    int retransmits = -1;                   // Final TCP sender count
+};
+
+Iperf3Client::Iperf3Client()
+{
+}
+
+Iperf3Client::~Iperf3Client()
+{
+    cancel();
+}
+
+bool Iperf3Client::start(const Options& options)
+{
+    if (m_running) {
+        return false;
+    }
+    if (m_thread.joinable()) {
+        m_thread.join();
+    }
+
+    m_options = options;
+    if (m_options.parallel < 1) m_options.parallel = 1;
+    if (m_options.durationSec < 1) m_options.durationSec = 1;
+    if (m_options.blockSize == 0) {
+        m_options.blockSize = m_options.udp ? DEFAULT_UDP_BLOCK : P::DEFAULT_TCP_BLOCK;
+    }
+    if (m_options.udp && m_options.blockSize < P::UDP_HEADER_SIZE) {
+        m_options.blockSize = P::UDP_HEADER_SIZE;
+    }
+    if (m_options.udp && m_options.bitrate == 0) {
+        m_options.bitrate = DEFAULT_UDP_RATE;
+    }
+
+    {
+        std::lock_guard<std::mutex> lock(m_resultMutex);
+        m_intervals.clear();
+        m_result = Result();
+    }
+    m_cancel = false;
+    m_startUs = 0;
+    m_duration = 0.0;
+    m_lastBytes = 0;
+    m_lastRetransmits = 0;
+    m_lastPackets = 0;
+    m_lastErrors = 0;
+    m_lastSample = 0.0;
+
+    m_wakeFd = eventfd(0, EFD_NONBLOCK | EFD_CLOEXEC);
+    if (m_wakeFd < 0) {
+        fail(std::string("eventfd: ") + strerror(errno));
+        return false;
+    }
+
+    m_running = true;
+    m_thread = std::thread(&Iperf3Client::run, this);
+    return true;
+}
+
+void Iperf3Client::cancel()
+{
+    if (m_running) {
+        m_cancel = true;
+        uint64_t one = 1;
+        if (write(m_wakeFd, &one, sizeof(one)) < 0) {
+            // The control thread polls with a bounded timeout anyway
+        }
+    }
+    if (m_thread.joinable()) {
+        m_thread.join();
+    }
+}
+
+double Iperf3Client::getElapsed() const
+{
+    int64_t start = m_startUs.load();
+    if (start == 0) {
+        return 0.0;
+    }
+    if (!m_running) {
+        return m_duration;
+    }
+    return (monotonicUs() - start) / 1e6;
+}
+
+size_t Iperf3Client::getIntervals(std::vector<Interval>& out, size_t from) const
+{
+    std::lock_guard<std::mutex> lock(m_resultMutex);
+    for (size_t i = from; i < m_intervals.size(); i++) {
+        out.push_back(m_intervals[i]);
+    }
+    return m_intervals.size();
+}
+
+Iperf3Client::Result Iperf3Client::getResult() const
+{
+    std::lock_guard<std::mutex> lock(m_resultMutex);
+    return m_result;
+}
+
+void Iperf3Client::fail(const std::string& message)
+{
+    std::lock_guard<std::mutex> lock(m_resultMutex);
+    // Keep the first error; later ones are usually fallout
+    if (m_result.error.empty()) {
+        m_result.error = message;
+        Logger::error("Iperf3Client: " + message);
+    }
+    m_result.valid = false;
+}
+
+void Iperf3Client::run()
+{
+    m_cookie = P::makeCookie();
+
+    // One block of payload, reused for every send
+    m_payload.assign(m_options.blockSize, 0);
+    for (size_t i = 0; i < m_payload.size(); i++) {
+        m_payload[i] = static_cast<uint8_t>('0' + i % 10);
+    }
+    if (!m_options.udp && !m_options.reverse) {
+        m_payloadFd = createPayloadFd(m_payload.data(), m_payload.size());
+        if (m_payloadFd < 0) {
+            LOG_DEBUG("Iperf3Client: memfd unavailable, sending from userspace buffer");
+        }
+    }
+
+    struct rusage usageStart;
+    getrusage(RUSAGE_SELF, &usageStart);
+
+    bool ok = connectControl() &&
+              waitForState(P::PARAM_EXCHANGE, CONTROL_TIMEOUT_MS) &&
+              P::writeJson(m_controlFd, buildParameters(), CONTROL_TIMEOUT_MS) &&
+              waitForState(P::CREATE_STREAMS, CONTROL_TIMEOUT_MS) &&
+              createStreams() &&
+              waitForState(P::TEST_START, CONTROL_TIMEOUT_MS) &&
+              waitForState(P::TEST_RUNNING, CONTROL_TIMEOUT_MS) &&
+              runTest() &&
+              exchangeResults();
+
+    if (!ok && m_cancel && m_controlFd >= 0) {
+        // Let the server release the test instead of waiting for its timeout
+        P::writeState(m_controlFd, P::CLIENT_TERMINATE, 1000);
+    }
+
+    stopStreamThreads();
+    for (auto& stream : m_streams) {
+        if (stream->fd >= 0) {
+            close(stream->fd);
+        }
+    }
+    m_streams.clear();
+
+    if (m_controlFd >= 0) {
+        close(m_controlFd);
+        m_controlFd = -1;
+    }
+    if (m_payloadFd >= 0) {
+        close(m_payloadFd);
+        m_payloadFd = -1;
+    }
+    close(m_wakeFd);
+    m_wakeFd = -1;
+
+    struct rusage usageEnd;
+    getrusage(RUSAGE_SELF, &usageEnd);
+    LOG_DEBUG("Iperf3Client: CPU " +
+                  std::to_string(cpuSeconds(usageEnd.ru_utime) - cpuSeconds(usageStart.ru_utime)) + "s user, " +
+                  std::to_string(cpuSeconds(usageEnd.ru_stime) - cpuSeconds(usageStart.ru_stime)) + "s system");
+
+    {
+        std::lock_guard<std::mutex> lock(m_resultMutex);
+        m_result.cancelled = m_cancel.load();
+        if (!ok) {
+            m_result.valid = false;
+            if (m_result.error.empty()) {
+                m_result.error = m_cancel ? "Cancelled" : "Test failed";
+            }
+        }
+    }
+
+    m_running = false;
+}
+
+int Iperf3Client::connectSocket(int type, int timeoutMs)
+{
+    struct addrinfo hints;
+    std::memset(&hints, 0, sizeof(hints));
+    hints.ai_family = AF_UNSPEC;
+    hints.ai_socktype = type;
+
+    struct addrinfo* addresses = nullptr;
+    std::string port = std::to_string(m_options.port);
+    int rc = getaddrinfo(m_options.host.c_str(), port.c_str(), &hints, &addresses);
+    if (rc != 0) {
+        fail(std::string("Resolve ") + m_options.host + ": " + gai_strerror(rc));
+        return -1;
+    }
+
+    int fd = -1;
+    for (struct addrinfo* ai = addresses; ai && fd < 0; ai = ai->ai_next) {
+        fd = socket(ai->ai_family, ai->ai_socktype | SOCK_NONBLOCK | SOCK_CLOEXEC, ai->ai_protocol);
+        if (fd < 0) {
+            continue;
+        }
+        if (connect(fd, ai->ai_addr, ai->ai_addrlen) == 0) {
+            break;
+        }
+        if (errno == EINPROGRESS) {
+            struct pollfd pfd = {fd, POLLOUT, 0};
+            int error = 0;
+            socklen_t length = sizeof(error);
+            if (poll(&pfd, 1, timeoutMs) > 0 &&
+                getsockopt(fd, SOL_SOCKET, SO_ERROR, &error, &length) == 0 && error == 0) {
+                break;
+            }
+        }
+        close(fd);
+        fd = -1;
+    }
+    freeaddrinfo(addresses);
+
+    if (fd < 0) {
+        fail("Connect to " + m_options.host + " failed");
+    }
+    return fd;
+}
+
+bool Iperf3Client::connectControl()
+{
+    m_controlFd = connectSocket(SOCK_STREAM, CONNECT_TIMEOUT_MS);
+    if (m_controlFd < 0) {
+        return false;
+    }
+
+    int on = 1;
+    setsockopt(m_controlFd, IPPROTO_TCP, TCP_NODELAY, &on, sizeof(on));
+
+    if (!P::writeAll(m_controlFd, m_cookie.c_str(), P::COOKIE_SIZE, CONTROL_TIMEOUT_MS)) {
+        fail("Sending cookie failed");
+        return false;
+    }
+    return true;
+}
+
+// Wait for the next state byte, or fail on cancel/timeout/server error
+bool Iperf3Client::waitState(int8_t& state, int timeoutMs)
+{
+    struct pollfd fds[2] = {
+        {m_controlFd, POLLIN, 0},
+        {m_wakeFd, POLLIN, 0}
+    };
+
+    int ready;
+    do {
+        ready = poll(fds, 2, timeoutMs);
+    } while (ready < 0 && errno == EINTR);
+
+    if (m_cancel) {
+        return false;
+    }
+    if (ready <= 0) {
+        fail("Server timeout");
+        return false;
+    }
+    if (!P::readAll(m_controlFd, &state, sizeof(state), CONTROL_TIMEOUT_MS)) {
+        fail("Server closed connection");
+        return false;
+    }
+
+    LOG_DEBUG(std::string("Iperf3Client: state ") + P::stateName(state));
+
+    switch (state) {
+        case P::ACCESS_DENIED:
+            fail("Server busy");
+            return false;
+        case P::SERVER_ERROR: {
+            // Followed by the server's i_errno and errno
+            int32_t codes[2] = {0, 0};
+            P::readAll(m_controlFd, codes, sizeof(codes), 1000);
+            fail("Server error " + std::to_string(static_cast<int32_t>(ntohl(codes[0]))));
+            return false;
+        }
+        case P::SERVER_TERMINATE:
+            fail("Server terminated");
+            return false;
+        default:
+            return true;
+    }
+}
+
+bool Iperf3Client::waitForState(int8_t expected, int timeoutMs)
+{
+    int8_t state;
+    if (!waitState(state, timeoutMs)) {
+        return false;
+    }
+    if (state != expected) {
+        fail(std::string("Unexpected ") + P::stateName(state));
+        return false;
+    }
+    return true;
+}
+
+std::string Iperf3Client::buildParameters() const
+{
+    json parameters;
+    parameters[m_options.udp ? "udp" : "tcp"] = true;
+    parameters["omit"] = 0;
+    parameters["time"] = m_options.durationSec;
+    parameters["num"] = 0;
+    parameters["blockcount"] = 0;
+    parameters["parallel"] = m_options.parallel;
+    if (m_options.reverse) {
+        parameters["reverse"] = true;
+    }
+    if (m_options.window > 0) {
+        parameters["window"] = m_options.window;
+    }
+    parameters["len"] = m_options.blockSize;
+    if (m_options.bitrate > 0) {
+        parameters["bandwidth"] = m_options.bitrate;
+    }
+    parameters["pacing_timer"] = 1000;
+    parameters["client_version"] = std::string("micropanel ") + Config::VERSION;
+    return parameters.dump();
+}
+
+bool Iperf3Client::createStreams()
+{
+    long cpus = sysconf(_SC_NPROCESSORS_ONLN);
+
+    for (int i = 0; i < m_options.parallel; i++) {
+        std::unique_ptr<Stream> stream(new Stream());
+        // iperf3 numbers streams 1, 3, 4, ... and matches results by id
+        stream->id = i == 0 ? 1 : i + 2;
+        stream->cpu = cpus > 1 ? static_cast<int>(i % cpus) : -1;
+
+        bool ok = m_options.udp ? connectUdpStream(*stream) : connectTcpStream(*stream);
+        if (!ok) {
+            if (stream->fd >= 0) close(stream->fd);
+            return false;
+        }
+
+        if (m_options.window > 0) {
+            int window = static_cast<int>(m_options.window);
+            setsockopt(stream->fd, SOL_SOCKET, SO_SNDBUF, &window, sizeof(window));
+            setsockopt(stream->fd, SOL_SOCKET, SO_RCVBUF, &window, sizeof(window));
+        }
+        m_streams.push_back(std::move(stream));
+    }
+    return true;
+}
+
+bool Iperf3Client::connectTcpStream(Stream& stream)
+{
+    stream.fd = connectSocket(SOCK_STREAM, CONNECT_TIMEOUT_MS);
+    if (stream.fd < 0) {
+        return false;
+    }
+    if (!P::writeAll(stream.fd, m_cookie.c_str(), P::COOKIE_SIZE, CONTROL_TIMEOUT_MS)) {
+        fail("Stream setup failed");
+        return false;
+    }
+    return true;
+}
+
+bool Iperf3Client::connectUdpStream(Stream& stream)
+{
+    stream.fd = connectSocket(SOCK_DGRAM, CONNECT_TIMEOUT_MS);
+    if (stream.fd < 0) {
+        return false;
+    }
+
+    // The server learns our address from this datagram and answers on it
+    uint32_t message = P::UDP_CONNECT_MSG;
+    if (send(stream.fd, &message, sizeof(message), 0) != sizeof(message)) {
+        fail("UDP stream setup failed");
+        return false;
+    }
+
+    struct pollfd pfd = {stream.fd, POLLIN, 0};
+    uint32_t reply = 0;
+    if (poll(&pfd, 1, CONNECT_TIMEOUT_MS) <= 0 ||
+        recv(stream.fd, &reply, sizeof(reply), 0) != sizeof(reply) ||
+        (reply != P::UDP_CONNECT_REPLY && reply != P::LEGACY_UDP_CONNECT_REPLY)) {
+        fail("No UDP stream reply");
+        return false;
+    }
+    return true;
+}
+
+void Iperf3Client::startStreamThreads()
+{
+    m_streamsActive = true;
+
+    for (auto& streamPtr : m_streams) {
+        Stream* stream = streamPtr.get();
+        if (m_options.udp) {
+            stream->thread = m_options.reverse ? std::thread(&Iperf3Client::udpReceiver, this, std::ref(*stream))
+                                               : std::thread(&Iperf3Client::udpSender, this, std::ref(*stream));
+        } else {
+            stream->thread = m_options.reverse ? std::thread(&Iperf3Client::tcpReceiver, this, std::ref(*stream))
+                                               : std::thread(&Iperf3Client::tcpSender, this, std::ref(*stream));
+        }
+
+        if (stream->cpu >= 0) {
+            cpu_set_t set;
+            CPU_ZERO(&set);
+            CPU_SET(stream->cpu, &set);
+            pthread_setaffinity_np(stream->thread.native_handle(), sizeof(set), &set);
+        }
+    }
+}
+
+void Iperf3Client::stopStreamThreads()
+{
+    m_streamsActive = false;
+    for (auto& stream : m_streams) {
+        if (stream->thread.joinable()) {
+            stream->thread.join();
+        }
+    }
+}
+
+bool Iperf3Client::runTest()
+{
+    m_startUs = monotonicUs();
+    startStreamThreads();
+
+    const double duration = m_options.durationSec;
+    double nextSample = 1.0;
+
+    while (true) {
+        double now = (monotonicUs() - m_startUs) / 1e6;
+        if (now >= nextSample) {
+            sampleInterval(now);
+            nextSample += 1.0;
+        }
+        if (now >= duration) {
+            break;
+        }
+
+        double until = std::min(nextSample, duration) - now;
+        int timeoutMs = static_cast<int>(until * 1000.0) + 1;
+
+        struct pollfd fds[2] = {
+            {m_controlFd, POLLIN, 0},
+            {m_wakeFd, POLLIN, 0}
+        };
+        int ready = poll(fds, 2, timeoutMs);
+        if (m_cancel) {
+            return false;
+        }
+        if (ready > 0 && (fds[0].revents & (POLLIN | POLLHUP | POLLERR))) {
+            // The server only speaks during the test to abort it
+            int8_t state;
+            if (!waitState(state, 0)) {
+                return false;
+            }
+        }
+    }
+
+    m_duration = (monotonicUs() - m_startUs) / 1e6;
+    if (m_duration - m_lastSample > 0.1) {
+        sampleInterval(m_duration);
+    }
+
+    // Senders stop now; receivers keep draining until the server stops too
+    if (!m_options.reverse) {
+        stopStreamThreads();
+    }
+
+    if (!P::writeState(m_controlFd, P::TEST_END, CONTROL_TIMEOUT_MS)) {
+        fail("Sending TEST_END failed");
+        return false;
+    }
+    return true;
+}
+
+int Iperf3Client::readRetransmits(const Stream& stream) const
+{
+    struct tcp_info info;
+    socklen_t length = sizeof(info);
+    if (getsockopt(stream.fd, IPPROTO_TCP, TCP_INFO, &info, &length) != 0) {
+        return 0;
+    }
+    return static_cast<int>(info.tcpi_total_retrans);
+}
+
+void Iperf3Client::sampleInterval(double now)
+{
+    uint64_t bytes = 0, packets = 0, errors = 0;
+    int retransmits = 0;
+    double jitter = 0.0;
+
+    for (const auto& stream : m_streams) {
+        bytes += stream->bytes.load();
+        packets += stream->packets.load();
+        errors += stream->errors.load();
+        jitter += stream->jitter.load();
+        if (!m_options.udp && !m_options.reverse) {
+            retransmits += readRetransmits(*stream);
+        }
+    }
+
+    Interval interval;
+    interval.start = m_lastSample;
+    interval.end = now;
+    double seconds = now - m_lastSample;
+    interval.bitsPerSecond = seconds > 0 ? (bytes - m_lastBytes) * 8.0 / seconds : 0.0;
+    interval.retransmits = retransmits - m_lastRetransmits;
+    if (m_options.udp && m_options.reverse) {
+        interval.jitterMs = m_streams.empty() ? 0.0 : jitter / m_streams.size() * 1000.0;
+        uint64_t intervalPackets = packets - m_lastPackets;
+        uint64_t intervalErrors = errors >= m_lastErrors ? errors - m_lastErrors : 0;
+        interval.lostPercent = intervalPackets ? 100.0 * intervalErrors / intervalPackets : 0.0;
+    }
+
+    m_lastBytes = bytes;
+    m_lastRetransmits = retransmits;
+    m_lastPackets = packets;
+    m_lastErrors = errors;
+    m_lastSample = now;
+
+    std::lock_guard<std::mutex> lock(m_resultMutex);
+    m_intervals.push_back(interval);
+}
+
+std::string Iperf3Client::buildResults() const
+{
+    json results;
+    results["cpu_util_total"] = 0.0;
+    results["cpu_util_user"] = 0.0;
+    results["cpu_util_system"] = 0.0;
+    results["sender_has_retransmits"] = (!m_options.udp && !m_options.reverse) ? 1 : 0;
+
+    json streams = json::array();
+    for (const auto& stream : m_streams) {
+        json entry;
+        entry["id"] = stream->id;
+        entry["bytes"] = stream->bytes.load();
+        entry["retransmits"] = stream->retransmits;
+        entry["jitter"] = stream->jitter.load();
+        entry["errors"] = stream->errors.load();
+        entry["omitted_errors"] = 0;
+        entry["packets"] = stream->packets.load();
+        entry["omitted_packets"] = 0;
+        entry["start_time"] = 0;
+        entry["end_time"] = m_duration;
+        streams.push_back(entry);
+    }
+    results["streams"] = streams;
+    return results.dump();
+}
+
+bool Iperf3Client::exchangeResults()
+{
+    if (!waitForState(P::EXCHANGE_RESULTS, CONTROL_TIMEOUT_MS)) {
+        return false;
+    }
+
+    // The server has stopped sending by now
+    stopStreamThreads();
+    if (!m_options.udp && !m_options.reverse) {
+        for (auto& stream : m_streams) {
+            stream->retransmits = readRetransmits(*stream);
+        }
+    }
+
+    std::string serverResults;
+    if (!P::writeJson(m_controlFd, buildResults(), CONTROL_TIMEOUT_MS) ||
+        !P::readJson(m_controlFd, serverResults, CONTROL_TIMEOUT_MS)) {
+        fail("Results exchange failed");
+        return false;
+    }
+
+    applyServerResults(serverResults);
+
+    if (!waitForState(P::DISPLAY_RESULTS, CONTROL_TIMEOUT_MS)) {
+        return false;
+    }
+    P::writeState(m_controlFd, P::IPERF_DONE, CONTROL_TIMEOUT_MS);
+    return true;
+}
+
+void Iperf3Client::applyServerResults(const std::string& text)
+{
+    uint64_t serverBytes = 0;
+    int serverRetransmits = 0;
+    double serverJitter = 0.0;
+    long serverErrors = 0;
+    long serverPackets = 0;
+    double serverSeconds = 0.0;
+    size_t serverStreams = 0;
+    bool serverHasRetransmits = false;
+
+    try {
+        json results = json::parse(text);
+        serverHasRetransmits = results.value("sender_has_retransmits", 0) == 1;
+        for (const auto& stream : results.at("streams")) {
+            serverBytes += stream.value("bytes", static_cast<uint64_t>(0));
+            int retransmits = stream.value("retransmits", 0);
+            if (retransmits > 0) serverRetransmits += retransmits;
+            serverJitter += stream.value("jitter", 0.0);
+            serverErrors += stream.value("errors", 0L);
+            serverPackets += stream.value("packets", 0L);
+            serverSeconds = std::max(serverSeconds, stream.value("end_time", 0.0));
+            serverStreams++;
+        }
+    } catch (const std::exception& e) {
+        fail(std::string("Bad server results: ") + e.what());
+        return;
+    }
+
+    uint64_t localBytes = 0;
+    uint64_t localPackets = 0, localErrors = 0;
+    int localRetransmits = 0;
+    double localJitter = 0.0;
+    for (const auto& stream : m_streams) {
+        localBytes += stream->bytes.load();
+        localPackets += stream->packets.load();
+        localErrors += stream->errors.load();
+        localJitter += stream->jitter.load();
+        if (stream->retransmits > 0) localRetransmits += stream->retransmits;
+    }
+
+    double seconds = m_duration > 0 ? m_duration : m_options.durationSec;
+    double receiverSeconds = serverSeconds > 0 && !m_options.reverse ? serverSeconds : seconds;
+
+    std::lock_guard<std::mutex> lock(m_resultMutex);
+    Result& result = m_result;
+    result.seconds = seconds;
+
+    if (m_options.reverse) {
+        result.senderBitsPerSecond = serverBytes * 8.0 / (serverSeconds > 0 ? serverSeconds : seconds);
+        result.receiverBitsPerSecond = localBytes * 8.0 / seconds;
+        result.retransmits = serverHasRetransmits ? serverRetransmits : 0;
+        if (m_options.udp) {
+            result.jitterMs = m_streams.empty() ? 0.0 : localJitter / m_streams.size() * 1000.0;
+            result.lostPackets = static_cast<long>(localErrors);
+            result.totalPackets = static_cast<long>(localPackets);
+        }
+    } else {
+        result.senderBitsPerSecond = localBytes * 8.0 / seconds;
+        result.receiverBitsPerSecond = serverBytes * 8.0 / receiverSeconds;
+        result.retransmits = localRetransmits;
+        if (m_options.udp) {
+            result.jitterMs = serverStreams ? serverJitter / serverStreams * 1000.0 : 0.0;
+            result.lostPackets = serverErrors;
+            result.totalPackets = serverPackets > 0 ? serverPackets : static_cast<long>(localPackets);
+        }
+    }
+    if (result.totalPackets > 0) {
+        result.lostPercent = 100.0 * result.lostPackets / result.totalPackets;
+    }
+    result.valid = true;
+
+    Logger::info("Iperf3Client: sender " + std::to_string(result.senderBitsPerSecond / 1e6) +
+                 " Mbps, receiver " + std::to_string(result.receiverBitsPerSecond / 1e6) + " Mbps");
+}
+
+void Iperf3Client::tcpSender(Stream& stream)
+{
+    const size_t block = m_options.blockSize;
+    const double bytesPerUs = m_options.bitrate / 8.0 / 1e6;
+    const int64_t start = monotonicUs();
+    bool useSendfile = m_payloadFd >= 0;
+    size_t offset = 0;      // Position within the current block
+
+    while (m_streamsActive) {
+        // Pace against the target rate when one is set
+        if (m_options.bitrate > 0) {
+            double allowed = (monotonicUs() - start) * bytesPerUs;
+            if (stream.bytes.load() >= allowed) {
+                usleep(1000);
+                continue;
+            }
+        }
+
+        ssize_t sent;
+        if (useSendfile) {
+            off_t fileOffset = static_cast<off_t>(offset);
+            sent = sendfile(stream.fd, m_payloadFd, &fileOffset, block - offset);
+            if (sent < 0 && (errno == EINVAL || errno == ENOSYS)) {
+                useSendfile = false;
+                continue;
+            }
+        } else {
+            sent = send(stream.fd, m_payload.data() + offset, block - offset, MSG_NOSIGNAL);
+        }
+
+        if (sent > 0) {
+            stream.bytes += sent;
+            offset = (offset + sent) % block;
+        } else if (sent < 0 && (errno == EAGAIN || errno == EWOULDBLOCK || errno == EINTR)) {
+            struct pollfd pfd = {stream.fd, POLLOUT, 0};
+            poll(&pfd, 1, STREAM_POLL_MS);
+        } else {
+            LOG_DEBUG("Iperf3Client: stream " + std::to_string(stream.id) + " send ended");
+            break;
+        }
+    }
+}
+
+void Iperf3Client::tcpReceiver(Stream& stream)
+{
+    // MSG_TRUNC makes the kernel drop TCP payload without copying it out
+    uint8_t sink[1];
+
+    while (m_streamsActive) {
+        ssize_t received = recv(stream.fd, sink, P::DEFAULT_TCP_BLOCK * 4, MSG_TRUNC | MSG_DONTWAIT);
+        if (received > 0) {
+            stream.bytes += received;
+        } else if (received < 0 && (errno == EAGAIN || errno == EWOULDBLOCK || errno == EINTR)) {
+            struct pollfd pfd = {stream.fd, POLLIN, 0};
+            poll(&pfd, 1, STREAM_POLL_MS);
+        } else {
+            break;  // Server closed the stream
+        }
+    }
+}
+
+void Iperf3Client::udpSender(Stream& stream)
+{
+    const size_t block = m_options.blockSize;
+    const double bytesPerUs = m_options.bitrate / 8.0 / 1e6;
+    const int64_t start = monotonicUs();
+
+    uint8_t headers[UDP_BATCH][P::UDP_HEADER_SIZE];
+    struct iovec iov[UDP_BATCH][2];
+    struct mmsghdr messages[UDP_BATCH];
+    std::memset(messages, 0, sizeof(messages));
+
+    for (int i = 0; i < UDP_BATCH; i++) {
+        iov[i][0].iov_base = headers[i];
+        iov[i][0].iov_len = P::UDP_HEADER_SIZE;
+        iov[i][1].iov_base = m_payload.data() + P::UDP_HEADER_SIZE;
+        iov[i][1].iov_len = block - P::UDP_HEADER_SIZE;
+        messages[i].msg_hdr.msg_iov = iov[i];
+        messages[i].msg_hdr.msg_iovlen = 2;
+    }
+
+    uint32_t sequence = 0;
+
+    while (m_streamsActive) {
+        double allowed = (monotonicUs() - start) * bytesPerUs;
+        double budget = allowed - stream.bytes.load();
+        int count = static_cast<int>(budget / block);
+        if (count <= 0) {
+            usleep(1000);   // iperf3's default 1 ms pacing timer
+            continue;
+        }
+        if (count > UDP_BATCH) count = UDP_BATCH;
+
+        struct timeval now;
+        gettimeofday(&now, nullptr);
+        for (int i = 0; i < count; i++) {
+            uint32_t fields[3] = {
+                htonl(static_cast<uint32_t>(now.tv_sec)),
+                htonl(static_cast<uint32_t>(now.tv_usec)),
+                htonl(sequence + 1 + i)
+            };
+            std::memcpy(headers[i], fields, sizeof(fields));
+        }
+
+        int sent = sendmmsg(stream.fd, messages, count, 0);
+        if (sent > 0) {
+            sequence += sent;
+            stream.bytes += static_cast<uint64_t>(sent) * block;
+            stream.packets += sent;
+        } else if (sent < 0 && (errno == EAGAIN || errno == ENOBUFS || errno == EINTR)) {
+            struct pollfd pfd = {stream.fd, POLLOUT, 0};
+            poll(&pfd, 1, STREAM_POLL_MS);
+        } else if (sent < 0 && errno == ECONNREFUSED) {
+            continue;   // ICMP unreachable from a previous datagram; keep going
+        } else {
+            break;
+        }
+    }
+}
+
+void Iperf3Client::udpReceiver(Stream& stream)
+{
+    // Only the 12-byte header is copied out; MSG_TRUNC still reports the
+    // full datagram length
+    uint8_t headers[UDP_BATCH][P::UDP_HEADER_SIZE];
+    struct iovec iov[UDP_BATCH];
+    struct mmsghdr messages[UDP_BATCH];
+
+    while (m_streamsActive) {
+        std::memset(messages, 0, sizeof(messages));
+        for (int i = 0; i < UDP_BATCH; i++) {
+            iov[i].iov_base = headers[i];
+            iov[i].iov_len = P::UDP_HEADER_SIZE;
+            messages[i].msg_hdr.msg_iov = &iov[i];
+            messages[i].msg_hdr.msg_iovlen = 1;
+        }
+
+        int count = recvmmsg(stream.fd, messages, UDP_BATCH, MSG_DONTWAIT | MSG_TRUNC, nullptr);
+        if (count <= 0) {
+            if (count < 0 && errno != EAGAIN && errno != EWOULDBLOCK && errno != EINTR &&
+                errno != ECONNREFUSED) {
+                break;
+            }
+            struct pollfd pfd = {stream.fd, POLLIN, 0};
+            poll(&pfd, 1, STREAM_POLL_MS);
+            continue;
+        }
+
+        double arrival = realtimeSeconds();
+        for (int i = 0; i < count; i++) {
+            size_t length = messages[i].msg_len;
+            stream.bytes += length;
+            if (length < P::UDP_HEADER_SIZE) {
+                continue;
+            }
+
+            uint32_t fields[3];
+            std::memcpy(fields, headers[i], sizeof(fields));
+            double sent = ntohl(fields[0]) + ntohl(fields[1]) / 1e6;
+            uint64_t sequence = ntohl(fields[2]);
+
+            // Loss and reordering accounting as in iperf3
+            uint64_t expected = stream.packets.load() + 1;
+            if (sequence >= expected) {
+                if (sequence > expected) {
+                    stream.errors += sequence - expected;
+                }
+                stream.packets = sequence;
+            } else {
+                stream.outOfOrder++;
+                if (stream.errors.load() > 0) {
+                    stream.errors--;
+                }
+            }
+
+            // RFC 1889 interarrival jitter
+            double transit = arrival - sent;
+            if (stream.haveTransit) {
+                double delta = std::fabs(transit - stream.previousTransit);
+                double jitter = stream.jitter.load();
+                stream.jitter = jitter + (delta - jitter) / 16.0;
+            }
+            stream.previousTransit = transit;
+            stream.haveTransit = true;
+        }
+    }
+}
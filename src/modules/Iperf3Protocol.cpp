@@ -0,0 +1,138 @@
+#include "Iperf3Protocol.h"
+#include <cerrno>
+#include <chrono>
+#include <random>
+#include <poll.h>
+#include <unistd.h>
+#include <arpa/inet.h>
+#include <sys/socket.h>
+
+namespace Iperf3Protocol {
+
+std::string makeCookie()
+{
+    // Same alphabet as iperf3 (base32 without padding)
+    static const char alphabet[] = "abcdefghijklmnopqrstuvwxyz234567";
+    std::random_device device;
+    std::mt19937 generator(device() ^ static_cast<unsigned int>(
+        std::chrono::steady_clock::now().time_since_epoch().count()));
+    std::uniform_int_distribution<int> pick(0, sizeof(alphabet) - 2);
+
+    std::string cookie;
+    for (size_t i = 0; i < COOKIE_SIZE - 1; i++) {
+        cookie += alphabet[pick(generator)];
+    }
+    return cookie;
+}
+
+static bool waitFd(int fd, short events, int timeoutMs)
+{
+    struct pollfd pfd = {fd, events, 0};
+    int ready;
+    do {
+        ready = poll(&pfd, 1, timeoutMs);
+    } while (ready < 0 && errno == EINTR);
+    return ready > 0 && !(pfd.revents & POLLNVAL);
+}
+
+bool writeAll(int fd, const void* data, size_t length, int timeoutMs)
+{
+    const uint8_t* bytes = static_cast<const uint8_t*>(data);
+    size_t done = 0;
+
+    while (done < length) {
+        ssize_t n = send(fd, bytes + done, length - done, MSG_NOSIGNAL);
+        if (n > 0) {
+            done += n;
+            continue;
+        }
+        if (n < 0 && errno == EINTR) {
+            continue;
+        }
+        if (n < 0 && (errno == EAGAIN || errno == EWOULDBLOCK)) {
+            if (!waitFd(fd, POLLOUT, timeoutMs)) {
+                return false;
+            }
+            continue;
+        }
+        return false;
+    }
+    return true;
+}
+
+bool readAll(int fd, void* data, size_t length, int timeoutMs)
+{
+    uint8_t* bytes = static_cast<uint8_t*>(data);
+    size_t done = 0;
+
+    while (done < length) {
+        ssize_t n = recv(fd, bytes + done, length - done, 0);
+        if (n > 0) {
+            done += n;
+            continue;
+        }
+        if (n == 0) {
+            return false;   // Peer closed
+        }
+        if (errno == EINTR) {
+            continue;
+        }
+        if (errno == EAGAIN || errno == EWOULDBLOCK) {
+            if (!waitFd(fd, POLLIN, timeoutMs)) {
+                return false;
+            }
+            continue;
+        }
+        return false;
+    }
+    return true;
+}
+
+bool writeState(int fd, int8_t state, int timeoutMs)
+{
+    return writeAll(fd, &state, sizeof(state), timeoutMs);
+}
+
+bool writeJson(int fd, const std::string& json, int timeoutMs)
+{
+    uint32_t length = htonl(static_cast<uint32_t>(json.size()));
+    return writeAll(fd, &length, sizeof(length), timeoutMs) &&
+           writeAll(fd, json.data(), json.size(), timeoutMs);
+}
+
+bool readJson(int fd, std::string& json, int timeoutMs)
+{
+    uint32_t length;
+    if (!readAll(fd, &length, sizeof(length), timeoutMs)) {
+        return false;
+    }
+    length = ntohl(length);
+    if (length == 0 || length > MAX_JSON_SIZE) {
+        return false;
+    }
+
+    json.resize(length);
+    return readAll(fd, &json[0], length, timeoutMs);
+}
+
+const char* stateName(int8_t state)
+{
+    switch (state) {
+        case TEST_START: return "TEST_START";
+        case TEST_RUNNING: return "TEST_RUNNING";
+        case TEST_END: return "TEST_END";
+        case PARAM_EXCHANGE: return "PARAM_EXCHANGE";
+        case CREATE_STREAMS: return "CREATE_STREAMS";
+        case SERVER_TERMINATE: return "SERVER_TERMINATE";
+        case CLIENT_TERMINATE: return "CLIENT_TERMINATE";
+        case EXCHANGE_RESULTS: return "EXCHANGE_RESULTS";
+        case DISPLAY_RESULTS: return "DISPLAY_RESULTS";
+        case IPERF_START: return "IPERF_START";
+        case IPERF_DONE: return "IPERF_DONE";
+        case ACCESS_DENIED: return "ACCESS_DENIED";
+        case SERVER_ERROR: return "SERVER_ERROR";
+        default: return "UNKNOWN";
+    }
+}
+
+}
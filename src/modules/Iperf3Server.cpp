@@ -0,0 +1,1292 @@
+#include "Iperf3Server.h"
+#include "Iperf3Protocol.h"
+#include "Config.h"
+#include "Logger.h"
+#include <nlohmann/json.hpp>
+#include <algorithm>
+#include <cerrno>
+#include <cmath>
+#include <cstring>
+#include <ctime>
+#include <fcntl.h>
+#include <unistd.h>
+#include <arpa/inet.h>
+#include <netinet/in.h>
+#include <netinet/tcp.h>
+#include <sys/epoll.h>
+#include <sys/eventfd.h>
+#include <sys/resource.h>
+#include <sys/sendfile.h>
+#include <sys/socket.h>
+#include <sys/syscall.h>
+#include <sys/time.h>
+#include <sys/timerfd.h>
+
+using json = nlohmann::json;
+namespace P = Iperf3Protocol;
+
+namespace {
+    constexpr int MAX_EVENTS = 64;
+    constexpr int LOOP_TIMEOUT_MS = 100;
+    constexpr int CONTROL_WRITE_TIMEOUT_MS = 2000;
+    constexpr int RUN_GRACE_MS = 15000;                 // Past the requested duration
+    constexpr int FINISHED_LINGER_MS = 10000;           // Finished tests stay visible
+    constexpr size_t SPLICE_CHUNK = 1024 * 1024;
+    constexpr int PIPE_SIZE = 1024 * 1024;
+    constexpr int READS_PER_EVENT = 16;                 // Fairness between streams
+    constexpr size_t TCP_SEND_PER_EVENT = 4 * 1024 * 1024;
+    constexpr int UDP_BATCH = 64;
+    constexpr int UDP_MAX_PER_TICK = 256;
+    constexpr size_t UDP_HEADER_MAX = 16;               // sec, usec, 64-bit sequence
+    constexpr size_t MAX_UDP_BLOCK = 65507;
+
+    int64_t monotonicUs() {
+        struct timespec ts;
+        clock_gettime(CLOCK_MONOTONIC, &ts);
+        return static_cast<int64_t>(ts.tv_sec) * 1000000 + ts.tv_nsec / 1000;
+    }
+
+    double realtimeSeconds() {
+        struct timespec ts;
+        clock_gettime(CLOCK_REALTIME, &ts);
+        return ts.tv_sec + ts.tv_nsec / 1e9;
+    }
+
+    double cpuSeconds(const struct timeval& tv) {
+        return tv.tv_sec + tv.tv_usec / 1e6;
+    }
+
+    std::string formatPeer(const struct sockaddr_storage& address) {
+        char host[INET6_ADDRSTRLEN] = "?";
+        if (address.ss_family == AF_INET) {
+            const auto* in = reinterpret_cast<const struct sockaddr_in*>(&address);
+            inet_ntop(AF_INET, &in->sin_addr, host, sizeof(host));
+        } else if (address.ss_family == AF_INET6) {
+            const auto* in6 = reinterpret_cast<const struct sockaddr_in6*>(&address);
+            if (IN6_IS_ADDR_V4MAPPED(&in6->sin6_addr)) {
+                // Show dual-stack IPv4 clients as plain dotted quads
+                inet_ntop(AF_INET, &in6->sin6_addr.s6_addr[12], host, sizeof(host));
+            } else {
+                inet_ntop(AF_INET6, &in6->sin6_addr, host, sizeof(host));
+            }
+        }
+        return host;
+    }
+}
+
+// What an epoll event refers to
+struct Iperf3Server::Endpoint {
+    enum class Type { TCP_LISTEN, UDP_LISTEN, WAKE, TIMER, PENDING, CONTROL, STREAM };
+    Type type;
+    Pending* pending = nullptr;
+    Test* test = nullptr;
+    Stream* stream = nullptr;
+};
+
+// TCP connection that hasn't sent its cookie yet
+struct Iperf3Server::Pending {
+    int fd = -1;
+    struct sockaddr_storage peer;
+    std::string buffer;
+    int64_t sinceUs = 0;
+    bool dead = false;
+    Endpoint endpoint;
+};
+
+struct Iperf3Server::Stream {
+    int fd = -1;
+    int id = 0;
+    Test* test = nullptr;
+    bool open = true;
+    Endpoint endpoint;
+
+    // TCP receive sink
+    int pipe[2] = {-1, -1};
+    bool useSplice = true;
+
+    // Counters
+    uint64_t bytes = 0;
+    uint64_t packets = 0;           // UDP: sent, or highest sequence received
+    uint64_t errors = 0;            // UDP receiver: lost
+    uint64_t outOfOrder = 0;
+    double jitter = 0.0;            // UDP receiver, seconds
+    double previousTransit = 0.0;
+    bool haveTransit = false;
+    int retransmits = -1;           // TCP sender, read at the end
+
+    // TCP sender
+    size_t offset = 0;
+    bool wantWrite = false;
+};
+
+struct Iperf3Server::Test {
+    enum class State { PARAMS, CREATE_STREAMS, RUNNING, EXCHANGE, DISPLAY };
+
+    int controlFd = -1;
+    std::string cookie;
+    struct sockaddr_storage peer;
+    std::string address;
+    State state = State::PARAMS;
+    std::string input;              // Unconsumed control bytes
+    bool dead = false;
+    Endpoint endpoint;
+
+    // Parameters
+    bool udp = false;
+    bool reverse = false;
+    bool udp64 = false;
+    int parallel = 1;
+    int durationSec = 10;
+    size_t blockSize = P::DEFAULT_TCP_BLOCK;
+    uint64_t bitrate = 0;           // Per stream
+    int window = 0;
+
+    std::vector<std::unique_ptr<Stream>> streams;
+
+    int64_t stateSinceUs = 0;
+    int64_t startUs = 0;
+    int64_t endUs = 0;
+    struct rusage usageStart;
+
+    // Once-a-second sampling
+    int64_t lastSampleUs = 0;
+    uint64_t lastSampleBytes = 0;
+    double mbps = 0.0;
+
+    uint64_t totalBytes() const {
+        uint64_t total = 0;
+        for (const auto& stream : streams) total += stream->bytes;
+        return total;
+    }
+
+    double elapsed(int64_t nowUs) const {
+        if (startUs == 0) return 0.0;
+        return ((endUs ? endUs : nowUs) - startUs) / 1e6;
+    }
+};
+
+Iperf3Server::Iperf3Server()
+{
+}
+
+Iperf3Server::~Iperf3Server()
+{
+    stop();
+}
+
+bool Iperf3Server::start(int port)
+{
+    if (m_running) {
+        return false;
+    }
+    if (m_thread.joinable()) {
+        m_thread.join();
+    }
+
+    m_port = port;
+    if (!openListeners()) {
+        stop();
+        return false;
+    }
+
+    m_epollFd = epoll_create1(EPOLL_CLOEXEC);
+    m_wakeFd = eventfd(0, EFD_NONBLOCK | EFD_CLOEXEC);
+    m_timerFd = timerfd_create(CLOCK_MONOTONIC, TFD_NONBLOCK | TFD_CLOEXEC);
+    m_devNullFd = open("/dev/null", O_WRONLY | O_CLOEXEC);
+    if (m_epollFd < 0 || m_wakeFd < 0 || m_timerFd < 0) {
+        Logger::error(std::string("Iperf3Server: setup failed: ") + strerror(errno));
+        stop();
+        return false;
+    }
+
+    m_tcpListenEndpoint.reset(new Endpoint{Endpoint::Type::TCP_LISTEN});
+    m_udpListenEndpoint.reset(new Endpoint{Endpoint::Type::UDP_LISTEN});
+    m_wakeEndpoint.reset(new Endpoint{Endpoint::Type::WAKE});
+    m_timerEndpoint.reset(new Endpoint{Endpoint::Type::TIMER});
+    setEvents(m_tcpListenFd, m_tcpListenEndpoint.get(), EPOLLIN, true);
+    setEvents(m_udpListenFd, m_udpListenEndpoint.get(), EPOLLIN, true);
+    setEvents(m_wakeFd, m_wakeEndpoint.get(), EPOLLIN, true);
+    setEvents(m_timerFd, m_timerEndpoint.get(), EPOLLIN, true);
+
+    {
+        std::lock_guard<std::mutex> lock(m_clientsMutex);
+        m_clients.clear();
+    }
+    m_finished.clear();
+    m_finishedAt.clear();
+    m_completed = 0;
+    m_stop = false;
+    m_running = true;
+    m_thread = std::thread(&Iperf3Server::run, this);
+
+    Logger::info("Iperf3Server: listening on port " + std::to_string(m_port));
+    return true;
+}
+
+void Iperf3Server::stop()
+{
+    if (m_running) {
+        m_stop = true;
+        uint64_t one = 1;
+        if (write(m_wakeFd, &one, sizeof(one)) < 0) {
+            // The loop wakes up within LOOP_TIMEOUT_MS anyway
+        }
+    }
+    if (m_thread.joinable()) {
+        m_thread.join();
+    }
+
+    for (int* fd : {&m_tcpListenFd, &m_udpListenFd, &m_epollFd, &m_wakeFd, &m_timerFd,
+                    &m_devNullFd, &m_payloadFd}) {
+        if (*fd >= 0) {
+            close(*fd);
+            *fd = -1;
+        }
+    }
+    m_timerArmed = false;
+}
+
+std::vector<Iperf3Server::ClientInfo> Iperf3Server::getClients() const
+{
+    std::lock_guard<std::mutex> lock(m_clientsMutex);
+    return m_clients;
+}
+
+bool Iperf3Server::setEvents(int fd, Endpoint* endpoint, uint32_t events, bool add)
+{
+    struct epoll_event event;
+    std::memset(&event, 0, sizeof(event));
+    event.events = events;
+    event.data.ptr = endpoint;
+    if (epoll_ctl(m_epollFd, add ? EPOLL_CTL_ADD : EPOLL_CTL_MOD, fd, &event) < 0) {
+        Logger::error(std::string("Iperf3Server: epoll_ctl(") + (add ? "ADD" : "MOD") + ") on fd " +
+                      std::to_string(fd) + ": " + strerror(errno));
+        return false;
+    }
+    return true;
+}
+
+bool Iperf3Server::openListeners()
+{
+    // Dual-stack IPv6 takes IPv4 clients too; plain IPv4 if IPv6 is off
+    int on = 1, off = 0;
+    m_family = AF_INET6;
+    m_tcpListenFd = socket(AF_INET6, SOCK_STREAM | SOCK_NONBLOCK | SOCK_CLOEXEC, 0);
+    if (m_tcpListenFd >= 0) {
+        setsockopt(m_tcpListenFd, IPPROTO_IPV6, IPV6_V6ONLY, &off, sizeof(off));
+    } else {
+        m_family = AF_INET;
+        m_tcpListenFd = socket(AF_INET, SOCK_STREAM | SOCK_NONBLOCK | SOCK_CLOEXEC, 0);
+    }
+    if (m_tcpListenFd < 0) {
+        Logger::error(std::string("Iperf3Server: socket: ") + strerror(errno));
+        return false;
+    }
+    setsockopt(m_tcpListenFd, SOL_SOCKET, SO_REUSEADDR, &on, sizeof(on));
+
+    struct sockaddr_storage address;
+    std::memset(&address, 0, sizeof(address));
+    socklen_t length;
+    if (m_family == AF_INET6) {
+        auto* in6 = reinterpret_cast<struct sockaddr_in6*>(&address);
+        in6->sin6_family = AF_INET6;
+        in6->sin6_addr = in6addr_any;
+        in6->sin6_port = htons(static_cast<uint16_t>(m_port));
+        length = sizeof(*in6);
+    } else {
+        auto* in = reinterpret_cast<struct sockaddr_in*>(&address);
+        in->sin_family = AF_INET;
+        in->sin_addr.s_addr = htonl(INADDR_ANY);
+        in->sin_port = htons(static_cast<uint16_t>(m_port));
+        length = sizeof(*in);
+    }
+
+    if (bind(m_tcpListenFd, reinterpret_cast<struct sockaddr*>(&address), length) != 0 ||
+        listen(m_tcpListenFd, 64) != 0) {
+        Logger::error("Iperf3Server: cannot listen on port " + std::to_string(m_port) + ": " + strerror(errno));
+        return false;
+    }
+
+    m_udpListenFd = openUdpListener();
+    return m_udpListenFd >= 0;
+}
+
+int Iperf3Server::openUdpListener()
+{
+    // Each UDP stream takes over the listening socket by connect()ing it to
+    // the client, then a fresh one is bound to the same port - as iperf3 does
+    int fd = socket(m_family, SOCK_DGRAM | SOCK_NONBLOCK | SOCK_CLOEXEC, 0);
+    if (fd < 0) {
+        Logger::error(std::string("Iperf3Server: UDP socket: ") + strerror(errno));
+        return -1;
+    }
+    int on = 1, off = 0;
+    setsockopt(fd, SOL_SOCKET, SO_REUSEADDR, &on, sizeof(on));
+
+    struct sockaddr_storage address;
+    std::memset(&address, 0, sizeof(address));
+    socklen_t length;
+    if (m_family == AF_INET6) {
+        setsockopt(fd, IPPROTO_IPV6, IPV6_V6ONLY, &off, sizeof(off));
+        auto* in6 = reinterpret_cast<struct sockaddr_in6*>(&address);
+        in6->sin6_family = AF_INET6;
+        in6->sin6_addr = in6addr_any;
+        in6->sin6_port = htons(static_cast<uint16_t>(m_port));
+        length = sizeof(*in6);
+    } else {
+        auto* in = reinterpret_cast<struct sockaddr_in*>(&address);
+        in->sin_family = AF_INET;
+        in->sin_addr.s_addr = htonl(INADDR_ANY);
+        in->sin_port = htons(static_cast<uint16_t>(m_port));
+        length = sizeof(*in);
+    }
+
+    if (bind(fd, reinterpret_cast<struct sockaddr*>(&address), length) != 0) {
+        Logger::error("Iperf3Server: cannot bind UDP port " + std::to_string(m_port) + ": " + strerror(errno));
+        close(fd);
+        return -1;
+    }
+    return fd;
+}
+
+void Iperf3Server::run()
+{
+    struct epoll_event events[MAX_EVENTS];
+    int64_t nextHousekeeping = monotonicUs();
+
+    while (!m_stop) {
+        int count = epoll_wait(m_epollFd, events, MAX_EVENTS, LOOP_TIMEOUT_MS);
+        if (count < 0 && errno != EINTR) {
+            Logger::error(std::string("Iperf3Server: epoll_wait: ") + strerror(errno));
+            break;
+        }
+
+        for (int i = 0; i < count; i++) {
+            handleEvent(static_cast<Endpoint*>(events[i].data.ptr), events[i].events);
+        }
+
+        int64_t now = monotonicUs();
+        if (now >= nextHousekeeping) {
+            housekeeping();
+            nextHousekeeping = now + 250000;
+        }
+        removeDead();
+    }
+
+    for (auto& test : m_tests) {
+        if (!test->dead) {
+            P::writeState(test->controlFd, P::SERVER_TERMINATE, 100);
+            closeTest(*test, "server stopped");
+        }
+    }
+    for (auto& pending : m_pending) {
+        if (!pending->dead) {
+            close(pending->fd);
+            pending->dead = true;
+        }
+    }
+    removeDead();
+    {
+        std::lock_guard<std::mutex> lock(m_clientsMutex);
+        m_clients.clear();
+    }
+
+    Logger::info("Iperf3Server: stopped");
+    m_running = false;
+}
+
+void Iperf3Server::handleEvent(Endpoint* endpoint, uint32_t events)
+{
+    switch (endpoint->type) {
+        case Endpoint::Type::TCP_LISTEN:
+            acceptConnections();
+            break;
+        case Endpoint::Type::UDP_LISTEN:
+            acceptUdpStream();
+            break;
+        case Endpoint::Type::WAKE: {
+            uint64_t value;
+            if (read(m_wakeFd, &value, sizeof(value)) < 0) {
+                // Nothing pending
+            }
+            break;
+        }
+        case Endpoint::Type::TIMER:
+            onTimer();
+            break;
+        case Endpoint::Type::PENDING:
+            if (!endpoint->pending->dead) {
+                readPending(*endpoint->pending);
+            }
+            break;
+        case Endpoint::Type::CONTROL:
+            if (!endpoint->test->dead) {
+                readControl(*endpoint->test);
+            }
+            break;
+        case Endpoint::Type::STREAM: {
+            Stream& stream = *endpoint->stream;
+            if (stream.test->dead || !stream.open) {
+                break;
+            }
+            if (events & EPOLLOUT) {
+                if (stream.test->udp) sendUdp(stream); else sendTcp(stream);
+            }
+            if (stream.open && (events & (EPOLLIN | EPOLLHUP | EPOLLERR))) {
+                if (stream.test->udp) receiveUdp(stream); else receiveTcp(stream);
+            }
+            break;
+        }
+    }
+}
+
+void Iperf3Server::acceptConnections()
+{
+    while (true) {
+        struct sockaddr_storage peer;
+        socklen_t length = sizeof(peer);
+        int fd = accept4(m_tcpListenFd, reinterpret_cast<struct sockaddr*>(&peer), &length,
+                         SOCK_NONBLOCK | SOCK_CLOEXEC);
+        if (fd < 0) {
+            if (errno != EAGAIN && errno != EWOULDBLOCK && errno != EINTR) {
+                Logger::warning(std::string("Iperf3Server: accept: ") + strerror(errno));
+            }
+            return;
+        }
+
+        std::unique_ptr<Pending> pending(new Pending());
+        pending->fd = fd;
+        pending->peer = peer;
+        pending->sinceUs = monotonicUs();
+        pending->endpoint.type = Endpoint::Type::PENDING;
+        pending->endpoint.pending = pending.get();
+        setEvents(fd, &pending->endpoint, EPOLLIN, true);
+        m_pending.push_back(std::move(pending));
+    }
+}
+
+void Iperf3Server::readPending(Pending& pending)
+{
+    char buffer[P::COOKIE_SIZE];
+    size_t want = P::COOKIE_SIZE - pending.buffer.size();
+    ssize_t n = recv(pending.fd, buffer, want, 0);
+    if (n <= 0) {
+        if (n < 0 && (errno == EAGAIN || errno == EWOULDBLOCK || errno == EINTR)) {
+            return;
+        }
+        close(pending.fd);
+        pending.dead = true;
+        return;
+    }
+    pending.buffer.append(buffer, n);
+    if (pending.buffer.size() < P::COOKIE_SIZE) {
+        return;
+    }
+
+    // A known cookie is a data stream for a test waiting on its streams
+    for (auto& test : m_tests) {
+        if (!test->dead && test->state == Test::State::CREATE_STREAMS && !test->udp &&
+            test->cookie == pending.buffer) {
+            epoll_ctl(m_epollFd, EPOLL_CTL_DEL, pending.fd, nullptr);
+            attachTcpStream(*test, pending.fd);
+            pending.fd = -1;
+            pending.dead = true;
+            return;
+        }
+    }
+
+    for (auto it = m_pending.begin(); it != m_pending.end(); ++it) {
+        if (it->get() == &pending) {
+            std::unique_ptr<Pending> owned(std::move(*it));
+            // Leave a dead placeholder so removeDead() can drop the slot
+            it->reset(new Pending());
+            (*it)->dead = true;
+            startTest(std::move(owned));
+            return;
+        }
+    }
+}
+
+void Iperf3Server::startTest(std::unique_ptr<Pending> pending)
+{
+    int active = 0;
+    for (const auto& test : m_tests) {
+        if (!test->dead) active++;
+    }
+
+    std::string address = formatPeer(pending->peer);
+    if (active >= Config::IPERF_SERVER_MAX_TESTS) {
+        Logger::warning("Iperf3Server: refusing " + address + ", " + std::to_string(active) + " tests running");
+        P::writeState(pending->fd, P::ACCESS_DENIED, 100);
+        epoll_ctl(m_epollFd, EPOLL_CTL_DEL, pending->fd, nullptr);
+        close(pending->fd);
+        return;
+    }
+
+    std::unique_ptr<Test> test(new Test());
+    test->controlFd = pending->fd;
+    test->cookie = pending->buffer;
+    test->peer = pending->peer;
+    test->address = address;
+    test->state = Test::State::PARAMS;
+    test->stateSinceUs = monotonicUs();
+    test->endpoint.type = Endpoint::Type::CONTROL;
+    test->endpoint.test = test.get();
+
+    int on = 1;
+    setsockopt(test->controlFd, IPPROTO_TCP, TCP_NODELAY, &on, sizeof(on));
+    setEvents(test->controlFd, &test->endpoint, EPOLLIN, false);
+
+    Logger::info("Iperf3Server: test from " + address);
+    if (!P::writeState(test->controlFd, P::PARAM_EXCHANGE, CONTROL_WRITE_TIMEOUT_MS)) {
+        closeTest(*test, "control write failed");
+    }
+    m_tests.push_back(std::move(test));
+}
+
+void Iperf3Server::attachTcpStream(Test& test, int fd)
+{
+    std::unique_ptr<Stream> stream(new Stream());
+    stream->fd = fd;
+    stream->test = &test;
+    // Same numbering as the client (1, 3, 4, ...) so results match up by id
+    stream->id = test.streams.empty() ? 1 : static_cast<int>(test.streams.size()) + 2;
+    stream->endpoint.type = Endpoint::Type::STREAM;
+    stream->endpoint.stream = stream.get();
+
+    if (test.window > 0) {
+        setsockopt(fd, SOL_SOCKET, SO_RCVBUF, &test.window, sizeof(test.window));
+        setsockopt(fd, SOL_SOCKET, SO_SNDBUF, &test.window, sizeof(test.window));
+    }
+
+    if (!test.reverse) {
+        if (m_devNullFd < 0 || pipe2(stream->pipe, O_NONBLOCK | O_CLOEXEC) != 0) {
+            stream->useSplice = false;
+        } else {
+            fcntl(stream->pipe[0], F_SETPIPE_SZ, PIPE_SIZE);
+        }
+    }
+
+    // Not polled until the test starts, so nothing is counted during setup
+    setEvents(fd, &stream->endpoint, 0, true);
+    test.streams.push_back(std::move(stream));
+
+    if (static_cast<int>(test.streams.size()) == test.parallel) {
+        beginTest(test);
+    }
+}
+
+void Iperf3Server::acceptUdpStream()
+{
+    uint8_t buffer[64];
+    struct sockaddr_storage peer;
+    socklen_t length = sizeof(peer);
+    ssize_t n = recvfrom(m_udpListenFd, buffer, sizeof(buffer), MSG_TRUNC,
+                         reinterpret_cast<struct sockaddr*>(&peer), &length);
+    if (n != static_cast<ssize_t>(sizeof(uint32_t))) {
+        return;     // Stray data packet from a finished test
+    }
+    uint32_t message;
+    std::memcpy(&message, buffer, sizeof(message));
+    if (message != P::UDP_CONNECT_MSG && message != P::LEGACY_UDP_CONNECT_MSG) {
+        return;
+    }
+
+    // Prefer the test whose control connection comes from the same host
+    std::string address = formatPeer(peer);
+    Test* owner = nullptr;
+    for (auto& test : m_tests) {
+        if (test->dead || !test->udp || test->state != Test::State::CREATE_STREAMS) continue;
+        if (test->address == address) {
+            owner = test.get();
+            break;
+        }
+        if (!owner) owner = test.get();
+    }
+    if (!owner) {
+        LOG_DEBUG("Iperf3Server: unexpected UDP connect from " + address);
+        return;
+    }
+
+    int fd = m_udpListenFd;
+    if (connect(fd, reinterpret_cast<struct sockaddr*>(&peer), length) != 0) {
+        Logger::warning(std::string("Iperf3Server: UDP connect: ") + strerror(errno));
+        return;
+    }
+
+    int replacement = openUdpListener();
+    if (replacement < 0) {
+        closeTest(*owner, "UDP listener failed");
+        return;
+    }
+    m_udpListenFd = replacement;
+    setEvents(m_udpListenFd, m_udpListenEndpoint.get(), EPOLLIN, true);
+
+    uint32_t reply = message == P::UDP_CONNECT_MSG ? P::UDP_CONNECT_REPLY : P::LEGACY_UDP_CONNECT_REPLY;
+    if (send(fd, &reply, sizeof(reply), 0) != static_cast<ssize_t>(sizeof(reply))) {
+        close(fd);
+        closeTest(*owner, "UDP reply failed");
+        return;
+    }
+
+    std::unique_ptr<Stream> stream(new Stream());
+    stream->fd = fd;
+    stream->test = owner;
+    stream->id = owner->streams.empty() ? 1 : static_cast<int>(owner->streams.size()) + 2;
+    stream->endpoint.type = Endpoint::Type::STREAM;
+    stream->endpoint.stream = stream.get();
+    int window = owner->window > 0 ? owner->window : 0;
+    if (window > 0) {
+        setsockopt(fd, SOL_SOCKET, SO_RCVBUF, &window, sizeof(window));
+        setsockopt(fd, SOL_SOCKET, SO_SNDBUF, &window, sizeof(window));
+    }
+
+    // The socket moved from the listener endpoint to the stream; it is still
+    // registered, so only its endpoint and events change
+    setEvents(fd, &stream->endpoint, 0, false);
+    owner->streams.push_back(std::move(stream));
+
+    if (static_cast<int>(owner->streams.size()) == owner->parallel) {
+        beginTest(*owner);
+    }
+}
+
+void Iperf3Server::readControl(Test& test)
+{
+    char buffer[4096];
+    while (true) {
+        ssize_t n = recv(test.controlFd, buffer, sizeof(buffer), 0);
+        if (n > 0) {
+            test.input.append(buffer, n);
+            if (test.input.size() > P::MAX_JSON_SIZE + sizeof(uint32_t)) {
+                closeTest(test, "control message too large");
+                return;
+            }
+            continue;
+        }
+        if (n < 0 && errno == EINTR) continue;
+        if (n < 0 && (errno == EAGAIN || errno == EWOULDBLOCK)) break;
+
+        // Peer closed: finish whatever it sent first
+        processControl(test);
+        if (!test.dead) {
+            closeTest(test, test.state == Test::State::DISPLAY ? "" : "client disconnected");
+        }
+        return;
+    }
+    processControl(test);
+}
+
+// Consume complete control messages; false once the test is closed
+bool Iperf3Server::processControl(Test& test)
+{
+    while (!test.dead && !test.input.empty()) {
+        if (test.state == Test::State::PARAMS || test.state == Test::State::EXCHANGE) {
+            // Length-prefixed JSON
+            if (test.input.size() < sizeof(uint32_t)) return true;
+            uint32_t length;
+            std::memcpy(&length, test.input.data(), sizeof(length));
+            length = ntohl(length);
+            if (length == 0 || length > P::MAX_JSON_SIZE) {
+                closeTest(test, "bad JSON length");
+                return false;
+            }
+            if (test.input.size() < sizeof(uint32_t) + length) return true;
+            std::string message = test.input.substr(sizeof(uint32_t), length);
+            test.input.erase(0, sizeof(uint32_t) + length);
+
+            if (test.state == Test::State::PARAMS) {
+                if (!parseParameters(test, message)) {
+                    closeTest(test, "bad parameters");
+                    return false;
+                }
+                test.state = Test::State::CREATE_STREAMS;
+                test.stateSinceUs = monotonicUs();
+                if (!P::writeState(test.controlFd, P::CREATE_STREAMS, CONTROL_WRITE_TIMEOUT_MS)) {
+                    closeTest(test, "control write failed");
+                    return false;
+                }
+            } else {
+                // The client's own numbers aren't needed; answer with ours
+                if (!P::writeJson(test.controlFd, buildResults(test), CONTROL_WRITE_TIMEOUT_MS) ||
+                    !P::writeState(test.controlFd, P::DISPLAY_RESULTS, CONTROL_WRITE_TIMEOUT_MS)) {
+                    closeTest(test, "results write failed");
+                    return false;
+                }
+                test.state = Test::State::DISPLAY;
+                test.stateSinceUs = monotonicUs();
+            }
+            continue;
+        }
+
+        int8_t state = static_cast<int8_t>(test.input[0]);
+        test.input.erase(0, 1);
+
+        switch (state) {
+            case P::TEST_END:
+                if (test.state == Test::State::RUNNING) {
+                    endTest(test);
+                }
+                break;
+            case P::IPERF_DONE:
+                closeTest(test, "");
+                return false;
+            case P::CLIENT_TERMINATE:
+                closeTest(test, "client terminated");
+                return false;
+            default:
+                LOG_DEBUG(std::string("Iperf3Server: ignoring ") + P::stateName(state) +
+                              " from " + test.address);
+                break;
+        }
+    }
+    return !test.dead;
+}
+
+bool Iperf3Server::parseParameters(Test& test, const std::string& text)
+{
+    try {
+        json parameters = json::parse(text);
+        test.udp = parameters.value("udp", false);
+        test.reverse = parameters.value("reverse", false);
+        test.udp64 = parameters.value("udp_counters_64bit", 0) != 0;
+        test.parallel = parameters.value("parallel", 1);
+        test.durationSec = parameters.value("time", 10);
+        test.bitrate = parameters.value("bandwidth", static_cast<uint64_t>(0));
+        test.window = parameters.value("window", 0);
+        size_t defaultBlock = test.udp ? 1460 : P::DEFAULT_TCP_BLOCK;
+        test.blockSize = parameters.value("len", defaultBlock);
+    } catch (const std::exception& e) {
+        Logger::warning(std::string("Iperf3Server: parameters: ") + e.what());
+        return false;
+    }
+
+    if (test.parallel < 1 || test.parallel > Config::IPERF_SERVER_MAX_STREAMS) {
+        return false;
+    }
+    if (test.blockSize == 0) {
+        test.blockSize = test.udp ? 1460 : P::DEFAULT_TCP_BLOCK;
+    }
+    size_t header = test.udp64 ? UDP_HEADER_MAX : P::UDP_HEADER_SIZE;
+    if (test.udp && (test.blockSize < header || test.blockSize > MAX_UDP_BLOCK)) {
+        return false;
+    }
+    if (test.blockSize > 16 * 1024 * 1024) {
+        return false;
+    }
+
+    Logger::info("Iperf3Server: " + test.address + " " + (test.udp ? "UDP" : "TCP") +
+                 (test.reverse ? " reverse" : "") + ", " + std::to_string(test.parallel) +
+                 " streams, " + std::to_string(test.durationSec) + "s");
+    return true;
+}
+
+void Iperf3Server::beginTest(Test& test)
+{
+    // One payload block shared by all senders
+    if (test.reverse && test.blockSize > m_payload.size()) {
+        m_payload.assign(test.blockSize, 0);
+        for (size_t i = 0; i < m_payload.size(); i++) {
+            m_payload[i] = static_cast<uint8_t>('0' + i % 10);
+        }
+    }
+    if (test.reverse && !test.udp && test.blockSize > m_payloadSize) {
+        if (m_payloadFd >= 0) close(m_payloadFd);
+        m_payloadFd = -1;
+        m_payloadSize = 0;
+#ifdef SYS_memfd_create
+        int fd = static_cast<int>(syscall(SYS_memfd_create, "micropanel-iperfd", 0));
+        if (fd >= 0 && write(fd, m_payload.data(), test.blockSize) == static_cast<ssize_t>(test.blockSize)) {
+            m_payloadFd = fd;
+            m_payloadSize = test.blockSize;
+        } else if (fd >= 0) {
+            close(fd);
+        }
+#endif
+    }
+
+    if (!P::writeState(test.controlFd, P::TEST_START, CONTROL_WRITE_TIMEOUT_MS) ||
+        !P::writeState(test.controlFd, P::TEST_RUNNING, CONTROL_WRITE_TIMEOUT_MS)) {
+        closeTest(test, "control write failed");
+        return;
+    }
+
+    test.state = Test::State::RUNNING;
+    test.startUs = monotonicUs();
+    test.stateSinceUs = test.startUs;
+    test.lastSampleUs = test.startUs;
+    getrusage(RUSAGE_SELF, &test.usageStart);
+
+    for (auto& stream : test.streams) {
+        uint32_t events = EPOLLIN;
+        if (test.reverse && !test.udp && test.bitrate == 0) {
+            events |= EPOLLOUT;     // Unpaced TCP: send whenever there's room
+            stream->wantWrite = true;
+        }
+        setEvents(stream->fd, &stream->endpoint, events, false);
+    }
+    updateTimer();
+}
+
+void Iperf3Server::endTest(Test& test)
+{
+    test.endUs = monotonicUs();
+
+    // Stop sending; receivers keep draining until the client drops the streams
+    for (auto& stream : test.streams) {
+        if (test.reverse && stream->open) {
+            if (!test.udp) {
+                struct tcp_info info;
+                socklen_t length = sizeof(info);
+                if (getsockopt(stream->fd, IPPROTO_TCP, TCP_INFO, &info, &length) == 0) {
+                    stream->retransmits = static_cast<int>(info.tcpi_total_retrans);
+                }
+            }
+            closeStream(*stream);
+        }
+    }
+
+    test.state = Test::State::EXCHANGE;
+    test.stateSinceUs = test.endUs;
+    updateTimer();
+    if (!P::writeState(test.controlFd, P::EXCHANGE_RESULTS, CONTROL_WRITE_TIMEOUT_MS)) {
+        closeTest(test, "control write failed");
+    }
+}
+
+std::string Iperf3Server::buildResults(const Test& test) const
+{
+    struct rusage usage;
+    getrusage(RUSAGE_SELF, &usage);
+    double wall = std::max(test.elapsed(monotonicUs()), 0.001);
+    double user = cpuSeconds(usage.ru_utime) - cpuSeconds(test.usageStart.ru_utime);
+    double system = cpuSeconds(usage.ru_stime) - cpuSeconds(test.usageStart.ru_stime);
+
+    json results;
+    results["cpu_util_total"] = 100.0 * (user + system) / wall;
+    results["cpu_util_user"] = 100.0 * user / wall;
+    results["cpu_util_system"] = 100.0 * system / wall;
+    results["sender_has_retransmits"] = (test.reverse && !test.udp) ? 1 : 0;
+
+    json streams = json::array();
+    for (const auto& stream : test.streams) {
+        json entry;
+        entry["id"] = stream->id;
+        entry["bytes"] = stream->bytes;
+        entry["retransmits"] = stream->retransmits;
+        entry["jitter"] = stream->jitter;
+        entry["errors"] = stream->errors;
+        entry["omitted_errors"] = 0;
+        entry["packets"] = stream->packets;
+        entry["omitted_packets"] = 0;
+        entry["start_time"] = 0;
+        entry["end_time"] = test.elapsed(monotonicUs());
+        streams.push_back(entry);
+    }
+    results["streams"] = streams;
+    return results.dump();
+}
+
+void Iperf3Server::closeStream(Stream& stream)
+{
+    if (!stream.open) return;
+    stream.open = false;
+    epoll_ctl(m_epollFd, EPOLL_CTL_DEL, stream.fd, nullptr);
+    close(stream.fd);
+    stream.fd = -1;
+    for (int& fd : stream.pipe) {
+        if (fd >= 0) {
+            close(fd);
+            fd = -1;
+        }
+    }
+}
+
+void Iperf3Server::closeTest(Test& test, const std::string& reason)
+{
+    if (test.dead) return;
+    test.dead = true;
+
+    for (auto& stream : test.streams) {
+        closeStream(*stream);
+    }
+    epoll_ctl(m_epollFd, EPOLL_CTL_DEL, test.controlFd, nullptr);
+    close(test.controlFd);
+    test.controlFd = -1;
+
+    int64_t now = monotonicUs();
+    if (test.endUs == 0) test.endUs = now;
+
+    if (test.startUs != 0) {
+        // Keep the outcome on screen for a while
+        ClientInfo info;
+        info.address = test.address;
+        info.udp = test.udp;
+        info.reverse = test.reverse;
+        info.streams = static_cast<int>(test.streams.size());
+        info.durationSec = test.durationSec;
+        info.elapsed = test.elapsed(now);
+        info.averageMbps = info.elapsed > 0 ? test.totalBytes() * 8.0 / 1e6 / info.elapsed : 0.0;
+        info.mbps = info.averageMbps;
+        info.finished = true;
+        m_finished.push_back(info);
+        m_finishedAt.push_back(now);
+    }
+
+    if (reason.empty()) {
+        m_completed++;
+        Logger::info("Iperf3Server: test from " + test.address + " complete, " +
+                     std::to_string(test.totalBytes()) + " bytes");
+    } else {
+        Logger::warning("Iperf3Server: test from " + test.address + " ended: " + reason);
+    }
+    updateTimer();
+    publishClients();
+}
+
+void Iperf3Server::receiveTcp(Stream& stream)
+{
+    for (int i = 0; i < READS_PER_EVENT; i++) {
+        ssize_t n;
+        if (stream.useSplice) {
+            // socket -> pipe -> /dev/null: the payload stays in kernel pages
+            n = splice(stream.fd, nullptr, stream.pipe[1], nullptr, SPLICE_CHUNK,
+                       SPLICE_F_MOVE | SPLICE_F_NONBLOCK);
+            if (n > 0) {
+                ssize_t left = n;
+                while (left > 0) {
+                    ssize_t drained = splice(stream.pipe[0], nullptr, m_devNullFd, nullptr, left,
+                                             SPLICE_F_MOVE | SPLICE_F_NONBLOCK);
+                    if (drained <= 0) break;
+                    left -= drained;
+                }
+            } else if (n < 0 && errno == EINVAL) {
+                stream.useSplice = false;
+                continue;
+            }
+        } else {
+            // MSG_TRUNC discards TCP data in the kernel without copying it
+            static char sink[1];
+            n = recv(stream.fd, sink, SPLICE_CHUNK, MSG_TRUNC | MSG_DONTWAIT);
+        }
+
+        if (n > 0) {
+            stream.bytes += n;
+            continue;
+        }
+        if (n < 0 && (errno == EAGAIN || errno == EWOULDBLOCK || errno == EINTR)) {
+            return;
+        }
+        closeStream(stream);    // Client closed the stream
+        return;
+    }
+}
+
+void Iperf3Server::receiveUdp(Stream& stream)
+{
+    Test& test = *stream.test;
+    const size_t header = test.udp64 ? UDP_HEADER_MAX : P::UDP_HEADER_SIZE;
+    uint8_t headers[UDP_BATCH][UDP_HEADER_MAX];
+    struct iovec iov[UDP_BATCH];
+    struct mmsghdr messages[UDP_BATCH];
+
+    for (int round = 0; round < READS_PER_EVENT; round++) {
+        std::memset(messages, 0, sizeof(messages));
+        for (int i = 0; i < UDP_BATCH; i++) {
+            iov[i].iov_base = headers[i];
+            iov[i].iov_len = header;
+            messages[i].msg_hdr.msg_iov = &iov[i];
+            messages[i].msg_hdr.msg_iovlen = 1;
+        }
+
+        int count = recvmmsg(stream.fd, messages, UDP_BATCH, MSG_DONTWAIT | MSG_TRUNC, nullptr);
+        if (count <= 0) {
+            if (count < 0 && errno != EAGAIN && errno != EWOULDBLOCK && errno != EINTR &&
+                errno != ECONNREFUSED) {
+                closeStream(stream);
+            }
+            return;
+        }
+        if (test.state != Test::State::RUNNING) {
+            continue;   // Late packets after TEST_END don't count
+        }
+
+        double arrival = realtimeSeconds();
+        for (int i = 0; i < count; i++) {
+            size_t length = messages[i].msg_len;
+            stream.bytes += length;
+            if (length < header) continue;
+
+            uint32_t seconds, micros;
+            std::memcpy(&seconds, headers[i], 4);
+            std::memcpy(&micros, headers[i] + 4, 4);
+            uint64_t sequence;
+            if (test.udp64) {
+                uint32_t high, low;
+                std::memcpy(&high, headers[i] + 8, 4);
+                std::memcpy(&low, headers[i] + 12, 4);
+                sequence = (static_cast<uint64_t>(ntohl(high)) << 32) | ntohl(low);
+            } else {
+                uint32_t value;
+                std::memcpy(&value, headers[i] + 8, 4);
+                sequence = ntohl(value);
+            }
+
+            // Loss and reordering accounting as in iperf3
+            if (sequence >= stream.packets + 1) {
+                if (sequence > stream.packets + 1) {
+                    stream.errors += sequence - (stream.packets + 1);
+                }
+                stream.packets = sequence;
+            } else {
+                stream.outOfOrder++;
+                if (stream.errors > 0) stream.errors--;
+            }
+
+            // RFC 1889 interarrival jitter
+            double transit = arrival - (ntohl(seconds) + ntohl(micros) / 1e6);
+            if (stream.haveTransit) {
+                double delta = std::fabs(transit - stream.previousTransit);
+                stream.jitter += (delta - stream.jitter) / 16.0;
+            }
+            stream.previousTransit = transit;
+            stream.haveTransit = true;
+        }
+    }
+}
+
+void Iperf3Server::sendTcp(Stream& stream)
+{
+    Test& test = *stream.test;
+    const size_t block = test.blockSize;
+    uint64_t budget = TCP_SEND_PER_EVENT;
+
+    if (test.bitrate > 0) {
+        double allowed = (monotonicUs() - test.startUs) / 1e6 * test.bitrate / 8.0;
+        budget = allowed > stream.bytes ? std::min<uint64_t>(budget, static_cast<uint64_t>(allowed - stream.bytes)) : 0;
+    }
+
+    uint64_t sent = 0;
+    bool blocked = false;
+    while (sent < budget) {
+        size_t chunk = std::min<uint64_t>(block - stream.offset, budget - sent);
+        ssize_t n;
+        if (m_payloadFd >= 0 && block <= m_payloadSize) {
+            off_t offset = static_cast<off_t>(stream.offset);
+            n = sendfile(stream.fd, m_payloadFd, &offset, chunk);
+        } else {
+            n = send(stream.fd, m_payload.data() + stream.offset, chunk, MSG_NOSIGNAL | MSG_DONTWAIT);
+        }
+        if (n > 0) {
+            stream.bytes += n;
+            sent += n;
+            stream.offset = (stream.offset + n) % block;
+            continue;
+        }
+        if (n < 0 && (errno == EAGAIN || errno == EWOULDBLOCK || errno == EINTR)) {
+            blocked = true;
+            break;
+        }
+        closeStream(stream);
+        return;
+    }
+
+    // Paced streams wait for the timer unless the socket itself is full
+    bool wantWrite = test.bitrate == 0 || blocked;
+    if (wantWrite != stream.wantWrite) {
+        stream.wantWrite = wantWrite;
+        setEvents(stream.fd, &stream.endpoint, EPOLLIN | (wantWrite ? static_cast<uint32_t>(EPOLLOUT) : 0u), false);
+    }
+}
+
+void Iperf3Server::sendUdp(Stream& stream)
+{
+    Test& test = *stream.test;
+    const size_t block = test.blockSize;
+    const size_t header = test.udp64 ? UDP_HEADER_MAX : P::UDP_HEADER_SIZE;
+
+    int count = UDP_MAX_PER_TICK;
+    if (test.bitrate > 0) {
+        double allowed = (monotonicUs() - test.startUs) / 1e6 * test.bitrate / 8.0;
+        double budget = allowed - stream.bytes;
+        count = budget > 0 ? std::min(UDP_MAX_PER_TICK, static_cast<int>(budget / block)) : 0;
+    }
+
+    uint8_t headers[UDP_BATCH][UDP_HEADER_MAX];
+    struct iovec iov[UDP_BATCH][2];
+    struct mmsghdr messages[UDP_BATCH];
+
+    while (count > 0) {
+        int batch = std::min(count, UDP_BATCH);
+        struct timeval now;
+        gettimeofday(&now, nullptr);
+        std::memset(messages, 0, sizeof(messages));
+
+        for (int i = 0; i < batch; i++) {
+            uint64_t sequence = stream.packets + 1 + i;
+            uint32_t fields[4] = {
+                htonl(static_cast<uint32_t>(now.tv_sec)),
+                htonl(static_cast<uint32_t>(now.tv_usec)),
+                htonl(static_cast<uint32_t>(test.udp64 ? sequence >> 32 : sequence)),
+                htonl(static_cast<uint32_t>(sequence))
+            };
+            std::memcpy(headers[i], fields, header);
+            iov[i][0].iov_base = headers[i];
+            iov[i][0].iov_len = header;
+            iov[i][1].iov_base = m_payload.data() + header;
+            iov[i][1].iov_len = block - header;
+            messages[i].msg_hdr.msg_iov = iov[i];
+            messages[i].msg_hdr.msg_iovlen = 2;
+        }
+
+        int sent = sendmmsg(stream.fd, messages, batch, MSG_DONTWAIT);
+        if (sent <= 0) {
+            if (sent < 0 && errno != EAGAIN && errno != ENOBUFS && errno != EINTR && errno != ECONNREFUSED) {
+                closeStream(stream);
+            }
+            return;
+        }
+        stream.packets += sent;
+        stream.bytes += static_cast<uint64_t>(sent) * block;
+        count -= sent;
+        if (sent < batch) return;
+    }
+}
+
+void Iperf3Server::onTimer()
+{
+    uint64_t expirations;
+    if (read(m_timerFd, &expirations, sizeof(expirations)) < 0) {
+        return;
+    }
+
+    for (auto& test : m_tests) {
+        if (test->dead || test->state != Test::State::RUNNING || !test->reverse) continue;
+        for (auto& stream : test->streams) {
+            if (!stream->open) continue;
+            if (test->udp) {
+                sendUdp(*stream);
+            } else if (test->bitrate > 0 && !stream->wantWrite) {
+                sendTcp(*stream);
+            }
+        }
+    }
+}
+
+void Iperf3Server::updateTimer()
+{
+    // Only paced senders need the 1 ms tick
+    bool needed = false;
+    for (const auto& test : m_tests) {
+        if (!test->dead && test->state == Test::State::RUNNING && test->reverse &&
+            (test->udp || test->bitrate > 0)) {
+            needed = true;
+            break;
+        }
+    }
+    if (needed == m_timerArmed) return;
+
+    struct itimerspec spec;
+    std::memset(&spec, 0, sizeof(spec));
+    if (needed) {
+        spec.it_interval.tv_nsec = 1000000;
+        spec.it_value.tv_nsec = 1000000;
+    }
+    timerfd_settime(m_timerFd, 0, &spec, nullptr);
+    m_timerArmed = needed;
+}
+
+void Iperf3Server::housekeeping()
+{
+    int64_t now = monotonicUs();
+
+    // Drop connections that never finish setting up, and runaway tests
+    for (auto& pending : m_pending) {
+        if (!pending->dead && now - pending->sinceUs > Config::IPERF_SERVER_SETUP_TIMEOUT_MS * 1000LL) {
+            epoll_ctl(m_epollFd, EPOLL_CTL_DEL, pending->fd, nullptr);
+            close(pending->fd);
+            pending->dead = true;
+        }
+    }
+    for (auto& test : m_tests) {
+        if (test->dead) continue;
+        int64_t age = now - test->stateSinceUs;
+        bool expired;
+        if (test->state == Test::State::RUNNING) {
+            int64_t limit = test->durationSec > 0 ? test->durationSec * 1000000LL + RUN_GRACE_MS * 1000LL
+                                                  : 3600LL * 1000000;
+            expired = age > limit;
+        } else {
+            expired = age > Config::IPERF_SERVER_SETUP_TIMEOUT_MS * 1000LL;
+        }
+        if (expired) {
+            P::writeState(test->controlFd, P::SERVER_TERMINATE, 100);
+            closeTest(*test, "timed out");
+            continue;
+        }
+
+        // Once-a-second rate sample
+        if (test->state == Test::State::RUNNING && now - test->lastSampleUs >= 1000000) {
+            uint64_t bytes = test->totalBytes();
+            test->mbps = (bytes - test->lastSampleBytes) * 8.0 / (now - test->lastSampleUs);
+            test->lastSampleBytes = bytes;
+            test->lastSampleUs = now;
+        }
+    }
+
+    for (size_t i = 0; i < m_finished.size();) {
+        if (now - m_finishedAt[i] > FINISHED_LINGER_MS * 1000LL) {
+            m_finished.erase(m_finished.begin() + i);
+            m_finishedAt.erase(m_finishedAt.begin() + i);
+        } else {
+            i++;
+        }
+    }
+
+    publishClients();
+}
+
+void Iperf3Server::publishClients()
+{
+    int64_t now = monotonicUs();
+    std::vector<ClientInfo> clients;
+
+    for (const auto& test : m_tests) {
+        if (test->dead) continue;
+        ClientInfo info;
+        info.address = test->address;
+        info.udp = test->udp;
+        info.reverse = test->reverse;
+        info.streams = static_cast<int>(test->streams.size());
+        info.durationSec = test->durationSec;
+        info.elapsed = test->elapsed(now);
+        info.mbps = test->mbps;
+        info.averageMbps = info.elapsed > 0 ? test->totalBytes() * 8.0 / 1e6 / info.elapsed : 0.0;
+        if (test->udp && !test->reverse && !test->streams.empty()) {
+            uint64_t packets = 0, errors = 0;
+            double jitter = 0.0;
+            for (const auto& stream : test->streams) {
+                packets += stream->packets;
+                errors += stream->errors;
+                jitter += stream->jitter;
+            }
+            info.jitterMs = jitter / test->streams.size() * 1000.0;
+            info.lostPercent = packets ? 100.0 * errors / packets : 0.0;
+        }
+        clients.push_back(info);
+    }
+    clients.insert(clients.end(), m_finished.begin(), m_finished.end());
+
+    std::lock_guard<std::mutex> lock(m_clientsMutex);
+    m_clients.swap(clients);
+}
+
+void Iperf3Server::removeDead()
+{
+    m_pending.erase(std::remove_if(m_pending.begin(), m_pending.end(),
+                                   [](const std::unique_ptr<Pending>& pending) { return pending->dead; }),
+                    m_pending.end());
+    m_tests.erase(std::remove_if(m_tests.begin(), m_tests.end(),
+                                 [](const std::unique_ptr<Test>& test) { return test->dead; }),
+                  m_tests.end());
+}
@@ -0,0 +1,266 @@
+#include "LatencyUnderLoad.h"
+#include "Config.h"
+#include "Logger.h"
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <ctime>
+
+namespace {
+    constexpr int TICK_MS = 20;     // Control loop period
+
+    int64_t monotonicUs() {
+        struct timespec ts;
+        clock_gettime(CLOCK_MONOTONIC, &ts);
+        return static_cast<int64_t>(ts.tv_sec) * 1000000 + ts.tv_nsec / 1000;
+    }
+}
+
+LatencyUnderLoad::LatencyUnderLoad()
+{
+}
+
+LatencyUnderLoad::~LatencyUnderLoad()
+{
+    cancel();
+}
+
+double LatencyUnderLoad::percentile(std::vector<double> samples, double fraction)
+{
+    if (samples.empty()) {
+        return 0.0;
+    }
+    size_t rank = static_cast<size_t>(std::ceil(fraction * samples.size()));
+    size_t index = rank > 0 ? rank - 1 : 0;
+    if (index >= samples.size()) {
+        index = samples.size() - 1;
+    }
+    std::nth_element(samples.begin(), samples.begin() + static_cast<std::ptrdiff_t>(index), samples.end());
+    return samples[index];
+}
+
+std::string LatencyUnderLoad::grade(double addedMs)
+{
+    // Same bands as the common public bufferbloat tests
+    if (addedMs < 5.0) return "A+";
+    if (addedMs < 30.0) return "A";
+    if (addedMs < 60.0) return "B";
+    if (addedMs < 200.0) return "C";
+    if (addedMs < 400.0) return "D";
+    return "F";
+}
+
+bool LatencyUnderLoad::start(const Options& options)
+{
+    if (m_running) {
+        return false;
+    }
+    if (m_thread.joinable()) {
+        m_thread.join();
+    }
+
+    m_options = options;
+    m_samples.clear();
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        m_progress = Progress();
+        m_result = Result();
+    }
+
+    if (!m_pinger.start(options.host, Config::LATENCY_PROBE_INTERVAL_MS, Config::LATENCY_PROBE_TIMEOUT_MS, true)) {
+        Logger::error("LatencyUnderLoad: cannot probe " + options.host);
+        return false;
+    }
+
+    m_cancel = false;
+    m_running = true;
+    m_phaseStartUs = monotonicUs();
+    m_thread = std::thread(&LatencyUnderLoad::run, this);
+    return true;
+}
+
+void LatencyUnderLoad::cancel()
+{
+    if (m_running) {
+        m_cancel = true;
+    }
+    if (m_thread.joinable()) {
+        m_thread.join();
+    }
+}
+
+LatencyUnderLoad::Progress LatencyUnderLoad::getProgress() const
+{
+    std::lock_guard<std::mutex> lock(m_mutex);
+    Progress progress = m_progress;
+    progress.elapsed = (monotonicUs() - m_phaseStartUs) / 1e6;
+    return progress;
+}
+
+LatencyUnderLoad::Result LatencyUnderLoad::getResult() const
+{
+    std::lock_guard<std::mutex> lock(m_mutex);
+    return m_result;
+}
+
+void LatencyUnderLoad::setPhase(Phase phase)
+{
+    std::lock_guard<std::mutex> lock(m_mutex);
+    m_progress.phase = phase;
+    m_progress.bitsPerSecond = 0.0;
+    m_phaseStartUs = monotonicUs();
+}
+
+void LatencyUnderLoad::collectSamples()
+{
+    m_pinger.getSamples(m_samples, m_samples.size());
+    if (!m_samples.empty()) {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        m_progress.lastRttMs = m_samples.back();
+    }
+}
+
+bool LatencyUnderLoad::waitMs(int ms)
+{
+    int64_t until = monotonicUs() + static_cast<int64_t>(ms) * 1000;
+    while (!m_cancel && monotonicUs() < until) {
+        std::this_thread::sleep_for(std::chrono::milliseconds(TICK_MS));
+        collectSamples();
+    }
+    return !m_cancel;
+}
+
+LatencyUnderLoad::Latency LatencyUnderLoad::measure(size_t from, size_t to, const IcmpPinger::Stats& before,
+                                                    const IcmpPinger::Stats& after) const
+{
+    Latency latency;
+    if (to > from) {
+        std::vector<double> phase(m_samples.begin() + static_cast<std::ptrdiff_t>(from),
+                                  m_samples.begin() + static_cast<std::ptrdiff_t>(to));
+        latency.valid = true;
+        latency.samples = phase.size();
+        latency.p50Ms = percentile(phase, 0.5);
+        latency.p90Ms = percentile(phase, 0.9);
+    }
+
+    // Probes that timed out count against the phase they were lost in
+    unsigned int received = after.received - before.received;
+    unsigned int lost = after.lost - before.lost;
+    unsigned int completed = received + lost;
+    latency.lossPercent = completed ? static_cast<int>((lost * 100 + completed / 2) / completed) : 0;
+    return latency;
+}
+
+bool LatencyUnderLoad::runLoad(bool reverse, Latency& latency, double& bitsPerSecond)
+{
+    setPhase(reverse ? Phase::DOWNLOAD : Phase::UPLOAD);
+
+    Iperf3Client::Options options;
+    options.host = m_options.host;
+    options.port = m_options.port;
+    options.reverse = reverse;
+    options.durationSec = m_options.durationSec;
+    options.parallel = std::max(m_options.parallel, Config::LATENCY_LOAD_MIN_STREAMS);
+    if (!m_engine.start(options)) {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        m_result.error = "Failed to start load";
+        return false;
+    }
+
+    // Latency counts only once the streams have had time to fill the queues
+    size_t from = 0;
+    bool measuring = false;
+    IcmpPinger::Stats before;
+    size_t intervals = 0;
+    while (m_engine.isRunning()) {
+        if (m_cancel) {
+            m_engine.cancel();
+            return false;
+        }
+        std::this_thread::sleep_for(std::chrono::milliseconds(TICK_MS));
+        collectSamples();
+
+        if (!measuring && m_engine.getElapsed() * 1000.0 >= Config::LATENCY_WARMUP_MS) {
+            measuring = true;
+            from = m_samples.size();
+            before = m_pinger.getStats();
+        }
+
+        std::vector<Iperf3Client::Interval> fresh;
+        size_t total = m_engine.getIntervals(fresh, intervals);
+        if (!fresh.empty()) {
+            std::lock_guard<std::mutex> lock(m_mutex);
+            m_progress.bitsPerSecond = fresh.back().bitsPerSecond;
+        }
+        intervals = total;
+    }
+    collectSamples();
+
+    Iperf3Client::Result result = m_engine.getResult();
+    if (!result.valid) {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        m_result.error = result.error.empty() ? "Load failed" : result.error;
+        return false;
+    }
+    bitsPerSecond = result.receiverBitsPerSecond;
+    if (measuring) {
+        latency = measure(from, m_samples.size(), before, m_pinger.getStats());
+    }
+    return true;
+}
+
+void LatencyUnderLoad::run()
+{
+    Latency idle, download, upload;
+    double downloadBps = 0.0, uploadBps = 0.0;
+
+    // Idle baseline first, on a quiet link
+    IcmpPinger::Stats before = m_pinger.getStats();
+    bool ok = waitMs(Config::LATENCY_IDLE_MS);
+    if (ok) {
+        idle = measure(0, m_samples.size(), before, m_pinger.getStats());
+        if (!idle.valid) {
+            std::lock_guard<std::mutex> lock(m_mutex);
+            m_result.error = "No ping replies";
+            ok = false;
+        }
+    }
+    if (ok && m_options.download) {
+        ok = runLoad(true, download, downloadBps);
+    }
+    if (ok && m_options.upload) {
+        ok = runLoad(false, upload, uploadBps);
+    }
+    m_pinger.stop();
+
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        m_result.cancelled = m_cancel.load();
+        m_result.valid = ok && !m_result.cancelled;
+        m_result.idle = idle;
+        m_result.download = download;
+        m_result.upload = upload;
+        m_result.downloadBitsPerSecond = downloadBps;
+        m_result.uploadBitsPerSecond = uploadBps;
+
+        // Responsiveness at the worse loaded median
+        double loaded = std::max(download.valid ? download.p50Ms : 0.0, upload.valid ? upload.p50Ms : 0.0);
+        if (loaded > 0.0) {
+            m_result.rpm = static_cast<int>(60000.0 / loaded + 0.5);
+            m_result.grade = grade(std::max(0.0, loaded - idle.p50Ms));
+        }
+        // Not a single reply under load is as bloated as it gets
+        if ((m_options.download && !download.valid) || (m_options.upload && !upload.valid)) {
+            m_result.rpm = 0;
+            m_result.grade = "F";
+        }
+        m_progress.phase = Phase::DONE;
+    }
+
+    if (m_result.valid) {
+        Logger::info("LatencyUnderLoad: idle p50 " + std::to_string(idle.p50Ms) + " ms, download p50 " +
+                     std::to_string(download.p50Ms) + " ms, upload p50 " + std::to_string(upload.p50Ms) +
+                     " ms, RPM " + std::to_string(m_result.rpm));
+    }
+    m_running = false;
+}
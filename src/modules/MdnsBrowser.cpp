@@ -0,0 +1,495 @@
+#include "MdnsBrowser.h"
+#include "Config.h"
+#include "Logger.h"
+#include <algorithm>
+#include <cctype>
+#include <cerrno>
+#include <cstring>
+#include <ctime>
+#include <poll.h>
+#include <unistd.h>
+#include <arpa/inet.h>
+#include <netinet/in.h>
+#include <sys/socket.h>
+
+namespace {
+    constexpr uint16_t MDNS_PORT = 5353;
+    constexpr const char* MDNS_GROUP = "224.0.0.251";
+    constexpr uint16_t TYPE_A = 1;
+    constexpr uint16_t TYPE_PTR = 12;
+    constexpr uint16_t TYPE_TXT = 16;
+    constexpr uint16_t TYPE_SRV = 33;
+    constexpr uint16_t CLASS_IN = 1;
+    constexpr uint16_t CACHE_FLUSH = 0x8000;
+    constexpr size_t MAX_PACKET = 9000;
+    constexpr size_t MAX_QUERY = 1400;
+    const int QUERY_TIMES_MS[] = {0, 250, 750};     // RFC 6762 5.2: double the interval
+
+    int64_t nowMs() {
+        struct timespec ts;
+        clock_gettime(CLOCK_MONOTONIC, &ts);
+        return static_cast<int64_t>(ts.tv_sec) * 1000 + ts.tv_nsec / 1000000;
+    }
+
+    std::string lower(std::string text) {
+        std::transform(text.begin(), text.end(), text.begin(),
+                       [](unsigned char c) { return static_cast<char>(std::tolower(c)); });
+        return text;
+    }
+
+    std::string join(const std::vector<std::string>& labels, size_t from = 0) {
+        std::string name;
+        for (size_t i = from; i < labels.size(); i++) {
+            if (!name.empty()) name += '.';
+            name += labels[i];
+        }
+        return name;
+    }
+
+    // Bounds-checked reader over one DNS message
+    class Reader {
+    public:
+        Reader(const uint8_t* data, size_t length) : m_data(data), m_length(length) {}
+
+        bool u16(uint16_t& value) {
+            if (m_offset + 2 > m_length) return false;
+            value = static_cast<uint16_t>(m_data[m_offset] << 8 | m_data[m_offset + 1]);
+            m_offset += 2;
+            return true;
+        }
+
+        bool u32(uint32_t& value) {
+            uint16_t high, low;
+            if (!u16(high) || !u16(low)) return false;
+            value = static_cast<uint32_t>(high) << 16 | low;
+            return true;
+        }
+
+        // Follows compression pointers; the reader ends up after the name
+        bool name(std::vector<std::string>& labels) {
+            return nameAt(m_offset, labels, true);
+        }
+
+        bool nameAt(size_t offset, std::vector<std::string>& labels, bool advance) {
+            labels.clear();
+            size_t position = offset;
+            bool jumped = false;
+            for (int hops = 0; hops < 64; hops++) {
+                if (position >= m_length) return false;
+                uint8_t length = m_data[position];
+                if (length == 0) {
+                    if (advance && !jumped) m_offset = position + 1;
+                    return true;
+                }
+                if ((length & 0xC0) == 0xC0) {
+                    if (position + 1 >= m_length) return false;
+                    if (advance && !jumped) m_offset = position + 2;
+                    jumped = true;
+                    position = static_cast<size_t>(length & 0x3F) << 8 | m_data[position + 1];
+                    continue;
+                }
+                if ((length & 0xC0) != 0 || position + 1 + length > m_length) return false;
+                labels.emplace_back(reinterpret_cast<const char*>(m_data + position + 1), length);
+                position += 1 + length;
+            }
+            return false;   // Pointer loop
+        }
+
+        bool skip(size_t count) {
+            if (m_offset + count > m_length) return false;
+            m_offset += count;
+            return true;
+        }
+
+        size_t offset() const { return m_offset; }
+        const uint8_t* data() const { return m_data; }
+
+    private:
+        const uint8_t* m_data;
+        size_t m_length;
+        size_t m_offset = 0;
+    };
+
+    void putU16(std::vector<uint8_t>& out, uint16_t value) {
+        out.push_back(static_cast<uint8_t>(value >> 8));
+        out.push_back(static_cast<uint8_t>(value));
+    }
+
+    void putName(std::vector<uint8_t>& out, const std::vector<std::string>& labels) {
+        for (const auto& label : labels) {
+            out.push_back(static_cast<uint8_t>(std::min<size_t>(label.size(), 63)));
+            out.insert(out.end(), label.begin(), label.begin() + std::min<size_t>(label.size(), 63));
+        }
+        out.push_back(0);
+    }
+
+    std::vector<std::string> split(const std::string& name) {
+        std::vector<std::string> labels;
+        size_t start = 0;
+        while (start <= name.size()) {
+            size_t dot = name.find('.', start);
+            if (dot == std::string::npos) dot = name.size();
+            if (dot > start) labels.push_back(name.substr(start, dot - start));
+            start = dot + 1;
+        }
+        return labels;
+    }
+}
+
+MdnsBrowser& MdnsBrowser::getInstance()
+{
+    static MdnsBrowser instance;
+    return instance;
+}
+
+MdnsBrowser::MdnsBrowser()
+{
+}
+
+MdnsBrowser::~MdnsBrowser()
+{
+    cancel();
+}
+
+bool MdnsBrowser::browse(const std::vector<std::string>& types, int durationMs)
+{
+    if (m_browsing) {
+        return true;
+    }
+    if (m_thread.joinable()) {
+        m_thread.join();
+    }
+
+    // Open here so the caller learns about a missing network stack right away
+    bool shared = false;
+    int fd = openSocket(shared);
+    if (fd < 0) {
+        return false;
+    }
+    close(fd);
+
+    m_cancel = false;
+    m_browsing = true;
+    m_thread = std::thread(&MdnsBrowser::run, this, types, durationMs);
+    return true;
+}
+
+void MdnsBrowser::cancel()
+{
+    if (m_browsing) {
+        m_cancel = true;
+    }
+    if (m_thread.joinable()) {
+        m_thread.join();
+    }
+}
+
+int MdnsBrowser::openSocket(bool& shared)
+{
+    int fd = socket(AF_INET, SOCK_DGRAM | SOCK_CLOEXEC, 0);
+    if (fd < 0) {
+        Logger::error(std::string("MdnsBrowser: socket: ") + strerror(errno));
+        return -1;
+    }
+
+    // avahi-daemon binds 5353 with SO_REUSEADDR/SO_REUSEPORT too, so we can
+    // sit next to it and see multicast answers with their full TTLs
+    int on = 1;
+    setsockopt(fd, SOL_SOCKET, SO_REUSEADDR, &on, sizeof(on));
+#ifdef SO_REUSEPORT
+    setsockopt(fd, SOL_SOCKET, SO_REUSEPORT, &on, sizeof(on));
+#endif
+
+    struct sockaddr_in address;
+    std::memset(&address, 0, sizeof(address));
+    address.sin_family = AF_INET;
+    address.sin_addr.s_addr = htonl(INADDR_ANY);
+    address.sin_port = htons(MDNS_PORT);
+
+    struct ip_mreq membership;
+    std::memset(&membership, 0, sizeof(membership));
+    inet_pton(AF_INET, MDNS_GROUP, &membership.imr_multiaddr);
+    membership.imr_interface.s_addr = htonl(INADDR_ANY);
+
+    shared = bind(fd, reinterpret_cast<struct sockaddr*>(&address), sizeof(address)) == 0 &&
+             setsockopt(fd, IPPROTO_IP, IP_ADD_MEMBERSHIP, &membership, sizeof(membership)) == 0;
+    if (!shared) {
+        // Any other port: responders answer us directly (RFC 6762 6.7)
+        close(fd);
+        fd = socket(AF_INET, SOCK_DGRAM | SOCK_CLOEXEC, 0);
+        if (fd < 0) {
+            Logger::error(std::string("MdnsBrowser: socket: ") + strerror(errno));
+            return -1;
+        }
+        address.sin_port = 0;
+        if (bind(fd, reinterpret_cast<struct sockaddr*>(&address), sizeof(address)) != 0) {
+            Logger::error(std::string("MdnsBrowser: bind: ") + strerror(errno));
+            close(fd);
+            return -1;
+        }
+    }
+
+    unsigned char ttl = 255;
+    setsockopt(fd, IPPROTO_IP, IP_MULTICAST_TTL, &ttl, sizeof(ttl));
+    unsigned char loop = 1;
+    setsockopt(fd, IPPROTO_IP, IP_MULTICAST_LOOP, &loop, sizeof(loop));
+    return fd;
+}
+
+void MdnsBrowser::run(std::vector<std::string> types, int durationMs)
+{
+    bool shared = false;
+    int fd = openSocket(shared);
+    if (fd < 0) {
+        m_browsing = false;
+        return;
+    }
+
+    LOG_DEBUG("MdnsBrowser: browsing " + std::to_string(types.size()) + " service types (" +
+                  (shared ? "port 5353" : "legacy unicast") + ")");
+
+    const int64_t start = nowMs();
+    const int64_t end = start + std::max(durationMs, 100);
+    size_t nextQuery = 0;
+    const size_t queryCount = sizeof(QUERY_TIMES_MS) / sizeof(QUERY_TIMES_MS[0]);
+    uint8_t buffer[MAX_PACKET];
+
+    while (!m_cancel) {
+        int64_t now = nowMs();
+        if (now >= end) break;
+
+        if (nextQuery < queryCount && now - start >= QUERY_TIMES_MS[nextQuery]) {
+            sendQuery(fd, pendingQuestions(types), !shared);
+            nextQuery++;
+        }
+
+        int64_t wake = end;
+        if (nextQuery < queryCount) {
+            wake = std::min<int64_t>(wake, start + QUERY_TIMES_MS[nextQuery]);
+        }
+        struct pollfd pfd = {fd, POLLIN, 0};
+        int timeout = static_cast<int>(std::max<int64_t>(1, std::min<int64_t>(wake - now, 50)));
+        if (poll(&pfd, 1, timeout) <= 0) {
+            continue;
+        }
+
+        while (true) {
+            ssize_t n = recv(fd, buffer, sizeof(buffer), MSG_DONTWAIT);
+            if (n <= 0) break;
+            handlePacket(buffer, static_cast<size_t>(n));
+        }
+    }
+
+    close(fd);
+    m_browsing = false;
+}
+
+std::vector<MdnsBrowser::Question> MdnsBrowser::pendingQuestions(const std::vector<std::string>& types)
+{
+    std::vector<Question> questions;
+    std::lock_guard<std::mutex> lock(m_cacheMutex);
+    expireLocked(nowMs());
+
+    for (const auto& type : types) {
+        questions.push_back({split(type + ".local"), TYPE_PTR});
+
+        // Ask directly for whatever the first answers left unresolved
+        const std::string prefix = lower(type + ".local") + '\n';
+        for (auto it = m_pointers.lower_bound(prefix);
+             it != m_pointers.end() && it->first.compare(0, prefix.size(), prefix) == 0; ++it) {
+            auto service = m_services.find(lower(it->second.target));
+            if (service == m_services.end()) {
+                questions.push_back({it->second.labels, TYPE_SRV});
+                questions.push_back({it->second.labels, TYPE_TXT});
+            } else if (m_addresses.find(lower(service->second.target)) == m_addresses.end()) {
+                questions.push_back({split(service->second.target), TYPE_A});
+            }
+        }
+    }
+    return questions;
+}
+
+void MdnsBrowser::sendQuery(int fd, const std::vector<Question>& questions, bool legacy)
+{
+    struct sockaddr_in group;
+    std::memset(&group, 0, sizeof(group));
+    group.sin_family = AF_INET;
+    group.sin_port = htons(MDNS_PORT);
+    inet_pton(AF_INET, MDNS_GROUP, &group.sin_addr);
+
+    size_t index = 0;
+    while (index < questions.size()) {
+        std::vector<uint8_t> packet;
+        // Legacy unicast queries need a non-zero ID to match the answer
+        putU16(packet, legacy ? static_cast<uint16_t>(nowMs() & 0xFFFF) | 1 : 0);
+        putU16(packet, 0);      // Standard query
+        size_t countOffset = packet.size();
+        putU16(packet, 0);
+        putU16(packet, 0);
+        putU16(packet, 0);
+        putU16(packet, 0);
+
+        uint16_t count = 0;
+        while (index < questions.size() && packet.size() < MAX_QUERY) {
+            const Question& question = questions[index++];
+            putName(packet, question.labels);
+            putU16(packet, question.type);
+            putU16(packet, CLASS_IN);
+            count++;
+        }
+        packet[countOffset] = static_cast<uint8_t>(count >> 8);
+        packet[countOffset + 1] = static_cast<uint8_t>(count);
+
+        if (sendto(fd, packet.data(), packet.size(), 0,
+                   reinterpret_cast<struct sockaddr*>(&group), sizeof(group)) < 0) {
+            Logger::warning(std::string("MdnsBrowser: sendto: ") + strerror(errno));
+            return;
+        }
+    }
+}
+
+void MdnsBrowser::handlePacket(const uint8_t* data, size_t length)
+{
+    Reader reader(data, length);
+    uint16_t id, flags, questions, answers, authorities, additionals;
+    if (!reader.u16(id) || !reader.u16(flags) || !reader.u16(questions) || !reader.u16(answers) ||
+        !reader.u16(authorities) || !reader.u16(additionals)) {
+        return;
+    }
+    if (!(flags & 0x8000)) {
+        return;     // Someone else's query (including our own, looped back)
+    }
+
+    std::vector<std::string> labels;
+    for (uint16_t i = 0; i < questions; i++) {
+        if (!reader.name(labels) || !reader.skip(4)) return;
+    }
+
+    const int64_t now = nowMs();
+    std::lock_guard<std::mutex> lock(m_cacheMutex);
+    int records = answers + authorities + additionals;
+
+    for (int i = 0; i < records; i++) {
+        uint16_t type, rrclass, rdlength;
+        uint32_t ttl;
+        if (!reader.name(labels) || !reader.u16(type) || !reader.u16(rrclass) ||
+            !reader.u32(ttl) || !reader.u16(rdlength)) {
+            return;
+        }
+        size_t rdata = reader.offset();
+        if (!reader.skip(rdlength)) return;
+        if ((rrclass & ~CACHE_FLUSH) != CLASS_IN) continue;
+
+        std::string owner = join(labels);
+        std::string key = lower(owner);
+        Record record;
+        record.expiresMs = now + static_cast<int64_t>(ttl) * 1000;
+
+        switch (type) {
+            case TYPE_PTR: {
+                std::vector<std::string> target;
+                if (!reader.nameAt(rdata, target, false) || target.empty()) break;
+                record.target = join(target);
+                record.labels = target;
+                std::string ptrKey = key + '\n' + lower(record.target);
+                if (ttl == 0) {
+                    m_pointers.erase(ptrKey);   // Goodbye
+                } else {
+                    m_pointers[ptrKey] = record;
+                }
+                break;
+            }
+            case TYPE_SRV: {
+                if (rdlength < 7) break;
+                const uint8_t* p = reader.data() + rdata;
+                record.port = p[4] << 8 | p[5];
+                std::vector<std::string> target;
+                if (!reader.nameAt(rdata + 6, target, false)) break;
+                record.target = join(target);
+                if (ttl == 0) m_services.erase(key); else m_services[key] = record;
+                break;
+            }
+            case TYPE_TXT: {
+                const uint8_t* p = reader.data() + rdata;
+                size_t offset = 0;
+                while (offset < rdlength) {
+                    size_t size = p[offset];
+                    if (offset + 1 + size > rdlength) break;
+                    if (size > 0) {
+                        record.txt.emplace_back(reinterpret_cast<const char*>(p + offset + 1), size);
+                    }
+                    offset += 1 + size;
+                }
+                if (ttl == 0) m_texts.erase(key); else m_texts[key] = record;
+                break;
+            }
+            case TYPE_A: {
+                if (rdlength != 4) break;
+                char text[INET_ADDRSTRLEN];
+                inet_ntop(AF_INET, reader.data() + rdata, text, sizeof(text));
+                record.target = text;
+                if (ttl == 0) m_addresses.erase(key); else m_addresses[key] = record;
+                break;
+            }
+            default:
+                break;
+        }
+    }
+
+    // Keep a busy network from growing the cache without bound
+    size_t total = m_pointers.size() + m_services.size() + m_texts.size() + m_addresses.size();
+    if (total > static_cast<size_t>(Config::MDNS_MAX_RECORDS)) {
+        expireLocked(now);
+        for (auto* map : {&m_texts, &m_addresses, &m_services, &m_pointers}) {
+            while (!map->empty() && m_pointers.size() + m_services.size() + m_texts.size() +
+                   m_addresses.size() > static_cast<size_t>(Config::MDNS_MAX_RECORDS)) {
+                map->erase(map->begin());
+            }
+        }
+    }
+}
+
+void MdnsBrowser::expireLocked(int64_t now)
+{
+    for (auto* map : {&m_pointers, &m_services, &m_texts, &m_addresses}) {
+        for (auto it = map->begin(); it != map->end();) {
+            if (it->second.expiresMs <= now) {
+                it = map->erase(it);
+            } else {
+                ++it;
+            }
+        }
+    }
+}
+
+std::vector<MdnsBrowser::Service> MdnsBrowser::getServices(const std::string& type) const
+{
+    std::vector<Service> result;
+    const std::string prefix = lower(type + ".local") + '\n';
+    const int64_t now = nowMs();
+
+    std::lock_guard<std::mutex> lock(m_cacheMutex);
+    for (auto it = m_pointers.lower_bound(prefix);
+         it != m_pointers.end() && it->first.compare(0, prefix.size(), prefix) == 0; ++it) {
+        if (it->second.expiresMs <= now) continue;
+        const std::string instanceKey = lower(it->second.target);
+
+        auto service = m_services.find(instanceKey);
+        if (service == m_services.end() || service->second.expiresMs <= now) continue;
+        auto address = m_addresses.find(lower(service->second.target));
+        if (address == m_addresses.end() || address->second.expiresMs <= now) continue;
+
+        Service entry;
+        entry.instance = it->second.labels[0];
+        entry.type = type;
+        entry.host = service->second.target;
+        entry.address = address->second.target;
+        entry.port = service->second.port;
+        auto text = m_texts.find(instanceKey);
+        if (text != m_texts.end() && text->second.expiresMs > now) {
+            entry.txt = text->second.txt;
+        }
+        result.push_back(entry);
+    }
+    return result;
+}
@@ -22,7 +22,7 @@ MenuScreenModule::~MenuScreenModule() {
 }
 
 void MenuScreenModule::enter() {
-    Logger::debug("Entering menu screen: " + m_id);
+    LOG_DEBUG("Entering menu screen: " + m_id);
     // If this is the top level menu, always clear the exit to main menu flag
     if (m_isTopLevelMenu) {
         m_exitToMainMenu = false;
@@ -49,7 +49,7 @@ void MenuScreenModule::update() {
 }
 
 void MenuScreenModule::exit() {
-    Logger::debug("Exiting menu screen: " + m_id);
+    LOG_DEBUG("Exiting menu screen: " + m_id);
 
     // Clear the display
     m_display->clear();
@@ -93,10 +93,10 @@ void MenuScreenModule::addSubmenuItem(const std::string& moduleId, const std::st
     item.title = title;
     m_submenuItems.push_back(item);
 
-    Logger::debug("Added submenu item '" + title + "' with id '" + moduleId + "' to menu " + m_id);
+    LOG_DEBUG("Added submenu item '" + title + "' with id '" + moduleId + "' to menu " + m_id);
 }
 
-void MenuScreenModule::setModuleRegistry(const std::map<std::string, std::shared_ptr<ScreenModule>>* registry) {
+void MenuScreenModule::setModuleRegistry(ModuleRegistry* registry) {
     m_moduleRegistry = registry;
 }
 
@@ -138,6 +138,12 @@ void MenuScreenModule::buildSubmenu() {
             continue;
         }
 
+        // Modules left out of this build get no entry
+        if (!m_moduleRegistry->contains(item.moduleId)) {
+            LOG_DEBUG("Skipping submenu item for unavailable module: " + item.moduleId);
+            continue;
+        }
+
         // Otherwise, create an action item that launches the corresponding module
         m_menu->addItem(std::make_shared<ActionMenuItem>(item.title, [this, moduleId = item.moduleId]() {
             // Execute the module
@@ -172,15 +178,14 @@ void MenuScreenModule::executeSubmenuAction(const std::string& moduleId) {
         return;
     }
 
-    // Look up the module in the registry
-    auto it = m_moduleRegistry->find(moduleId);
-    if (it == m_moduleRegistry->end()) {
+    // Look up the module in the registry; built on first use
+    if (!m_moduleRegistry->contains(moduleId)) {
         Logger::error("Module not found in registry: " + moduleId);
         return;
     }
 
     // Get the module
-    auto module = it->second;
+    auto module = m_moduleRegistry->get(moduleId);
     if (!module) {
         Logger::error("Invalid module pointer for: " + moduleId);
         return;
@@ -232,7 +237,7 @@ void MenuScreenModule::executeSubmenuAction(const std::string& moduleId) {
     }
 
     // Execute the module
-    Logger::debug("Executing submenu module: " + moduleId);
+    LOG_DEBUG("Executing submenu module: " + moduleId);
 
     // Clear the display before launching the module
     m_display->clear();
@@ -242,10 +247,10 @@ void MenuScreenModule::executeSubmenuAction(const std::string& moduleId) {
     //module->run();
     // Run the module (with GPIO support if enabled)
     if (m_useGPIOMode && m_gpioHandler) {
-        Logger::debug("MenuScreenModule: Using GPIO handler for module");
+        LOG_DEBUG("MenuScreenModule: Using GPIO handler for module");
         m_gpioHandler(module);
     } else {
-        Logger::debug("MenuScreenModule: Using traditional run() for module");
+        LOG_DEBUG("MenuScreenModule: Using traditional run() for module");
         module->run();
     }
 
@@ -257,7 +262,7 @@ void MenuScreenModule::executeSubmenuAction(const std::string& moduleId) {
     m_menu->render();
 }
 void MenuScreenModule::navigateToMainMenu() {
-    Logger::debug("Navigating to main menu from: " + m_id);
+    LOG_DEBUG("Navigating to main menu from: " + m_id);
 
     // Set our exit flags to trigger a return to parent menu
     m_exitToParent = true;
@@ -268,7 +273,7 @@ void MenuScreenModule::onScreenAction(const std::string& screenId,
                                     const std::string& action,
                                     const std::string& value)
 {
-    Logger::debug("Menu received callback from " + screenId +
+    LOG_DEBUG("Menu received callback from " + screenId +
                 ": Action=" + action + ", Value=" + value);
 
     // Store the value for later use
@@ -282,17 +287,17 @@ void MenuScreenModule::onScreenAction(const std::string& screenId,
         // Handle item activation
     } else if (action == "exit_to_main_menu") {
         // Handle request to navigate to main menu from child screen
-        Logger::debug("Child screen requested exit to main menu: " + screenId);
+        LOG_DEBUG("Child screen requested exit to main menu: " + screenId);
         navigateToMainMenu();
     } else if (action == "launch_module") {
         // Handle module launching request from GenericListScreen
-        Logger::debug("Module launch requested: " + value);
+        LOG_DEBUG("Module launch requested: " + value);
         handleModuleLaunch(screenId, value);
     }
 }
 
 void MenuScreenModule::handleModuleLaunch(const std::string& sourceModuleId, const std::string& value) {
-    Logger::debug("MenuScreenModule::handleModuleLaunch called from " + sourceModuleId + " with value: " + value);
+    LOG_DEBUG("MenuScreenModule::handleModuleLaunch called from " + sourceModuleId + " with value: " + value);
 
     // Parse the value: "textbox:eth0" -> moduleType="textbox", parameter="eth0"
     size_t colonPos = value.find(':');
@@ -304,7 +309,7 @@ void MenuScreenModule::handleModuleLaunch(const std::string& sourceModuleId, con
     std::string moduleType = value.substr(0, colonPos);
     std::string parameter = value.substr(colonPos + 1);
 
-    Logger::debug("Module launch request - Type: " + moduleType + ", Parameter: " + parameter);
+    LOG_DEBUG("Module launch request - Type: " + moduleType + ", Parameter: " + parameter);
 
     // For now, we'll handle textbox modules
     if (moduleType == "textbox") {
@@ -336,7 +341,7 @@ void MenuScreenModule::handleModuleLaunch(const std::string& sourceModuleId, con
         dependencies.addDependency(dynamicId, "refresh_sec", "2.0");
         dependencies.addDependency(dynamicId, "display_title", "$INTERFACE Stats");
 
-        Logger::debug("Launching dynamic TextBoxScreen for interface: " + parameter);
+        LOG_DEBUG("Launching dynamic TextBoxScreen for interface: " + parameter);
 
         // If we have a GPIO handler, use it to run the module
         if (m_gpioHandler && m_useGPIOMode) {
@@ -357,13 +362,13 @@ void MenuScreenModule::handleGPIORotation(int direction) {
 }
 
 bool MenuScreenModule::handleGPIOButtonPress() {
-    Logger::debug("MenuScreenModule::handleGPIOButtonPress() called");
+    LOG_DEBUG("MenuScreenModule::handleGPIOButtonPress() called");
 
     if (m_menu) {
-        Logger::debug("Calling m_menu->handleButtonPress()");
+        LOG_DEBUG("Calling m_menu->handleButtonPress()");
         m_menu->handleButtonPress();
 
-        Logger::debug("After menu button press - exitToParent: " + std::to_string(m_exitToParent) +
+        LOG_DEBUG("After menu button press - exitToParent: " + std::to_string(m_exitToParent) +
                       ", exitToMainMenu: " + std::to_string(m_exitToMainMenu));
 
         // Check for exit conditions (same as the original handleInput logic)
@@ -374,7 +379,7 @@ bool MenuScreenModule::handleGPIOButtonPress() {
                 m_parentMenu->m_exitToMainMenu = true;
                 m_parentMenu->m_exitToParent = true;
             }
-            Logger::debug("MenuScreenModule should exit!");
+            LOG_DEBUG("MenuScreenModule should exit!");
             return false; // Exit the module
         }
 
@@ -0,0 +1,415 @@
+#include "MeshAgent.h"
+#include "Config.h"
+#include "Logger.h"
+#include "PerfCounters.h"
+#include <algorithm>
+#include <cerrno>
+#include <csignal>
+#include <cstdlib>
+#include <cstring>
+#include <ctime>
+#include <poll.h>
+#include <unistd.h>
+#include <arpa/inet.h>
+#include <sys/eventfd.h>
+#include <sys/socket.h>
+#include <sys/wait.h>
+#include <nlohmann/json.hpp>
+
+using json = nlohmann::json;
+
+namespace {
+    constexpr int MAX_POLL_MS = 100;        // While a test runs: notice it finishing
+    constexpr int IDLE_POLL_MS = 1000;
+    constexpr size_t MAX_DATAGRAM = 2048;
+    constexpr const char* AVAHI_PUBLISH = "/usr/bin/avahi-publish";
+
+    int64_t nowUs() {
+        struct timespec ts;
+        clock_gettime(CLOCK_MONOTONIC, &ts);
+        return static_cast<int64_t>(ts.tv_sec) * 1000000 + ts.tv_nsec / 1000;
+    }
+
+    const char* testState(bool started, bool finished, const Iperf3Client::Result& result) {
+        if (!started) return "scheduled";
+        if (!finished) return "running";
+        return result.valid ? "done" : "failed";
+    }
+
+    // json::value() throws when a field's type differs from the default's,
+    // so requests are checked field by field before anything reads them
+    bool fieldsWellFormed(const json& request) {
+        for (const char* key : {"session", "host"}) {
+            if (request.contains(key) && !request[key].is_string()) return false;
+        }
+        for (const char* key : {"test", "seq", "port", "duration", "parallel", "delay_ms"}) {
+            if (request.contains(key) && !request[key].is_number_integer()) return false;
+        }
+        return !request.contains("reverse") || request["reverse"].is_boolean();
+    }
+}
+
+MeshAgent::MeshAgent()
+{
+}
+
+MeshAgent::~MeshAgent()
+{
+    stop();
+}
+
+bool MeshAgent::start(const std::string& name, int controlPort, int iperfPort)
+{
+    if (m_running) {
+        return true;
+    }
+
+    m_fd = socket(AF_INET, SOCK_DGRAM | SOCK_NONBLOCK | SOCK_CLOEXEC, 0);
+    if (m_fd < 0) {
+        Logger::error("MeshAgent: socket: " + std::string(strerror(errno)));
+        return false;
+    }
+    int enable = 1;
+    setsockopt(m_fd, SOL_SOCKET, SO_REUSEADDR, &enable, sizeof(enable));
+
+    sockaddr_in address;
+    std::memset(&address, 0, sizeof(address));
+    address.sin_family = AF_INET;
+    address.sin_addr.s_addr = htonl(INADDR_ANY);
+    address.sin_port = htons(static_cast<uint16_t>(controlPort));
+    if (bind(m_fd, reinterpret_cast<sockaddr*>(&address), sizeof(address)) < 0) {
+        Logger::error("MeshAgent: cannot bind control port " + std::to_string(controlPort) + ": " +
+                      strerror(errno));
+        ::close(m_fd);
+        m_fd = -1;
+        return false;
+    }
+
+    if (!m_server.start(iperfPort)) {
+        Logger::error("MeshAgent: cannot start the iperf3 server on port " + std::to_string(iperfPort));
+        ::close(m_fd);
+        m_fd = -1;
+        return false;
+    }
+
+    m_wakeFd = eventfd(0, EFD_NONBLOCK | EFD_CLOEXEC);
+    if (m_wakeFd < 0) {
+        Logger::error("MeshAgent: eventfd: " + std::string(strerror(errno)));
+        m_server.stop();
+        ::close(m_fd);
+        m_fd = -1;
+        return false;
+    }
+
+    m_name = name;
+    m_controlPort = controlPort;
+    m_iperfPort = iperfPort;
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        m_tests.clear();
+        m_testsRun = 0;
+    }
+
+    announce();
+
+    m_stop = false;
+    m_running = true;
+    m_thread = std::thread(&MeshAgent::run, this);
+    Logger::info("MeshAgent: node " + m_name + " listening on " + std::to_string(controlPort) +
+                 ", iperf3 on " + std::to_string(iperfPort));
+    return true;
+}
+
+void MeshAgent::stop()
+{
+    if (m_thread.joinable()) {
+        m_stop = true;
+        uint64_t one = 1;
+        if (write(m_wakeFd, &one, sizeof(one)) < 0) {
+            // Thread still notices m_stop within one poll interval
+        }
+        m_thread.join();
+    }
+    m_running = false;
+
+    stopAnnouncement();
+    m_server.stop();
+
+    if (m_fd >= 0) {
+        ::close(m_fd);
+        m_fd = -1;
+    }
+    if (m_wakeFd >= 0) {
+        ::close(m_wakeFd);
+        m_wakeFd = -1;
+    }
+}
+
+MeshAgent::Status MeshAgent::getStatus() const
+{
+    Status status;
+    status.running = m_running.load();
+    status.name = m_name;
+    status.controlPort = m_controlPort;
+    status.iperfPort = m_iperfPort;
+    status.announced = m_announcePid > 0;
+    status.serverClients = 0;
+    for (const auto& client : m_server.getClients()) {
+        if (!client.finished) {
+            status.serverClients++;
+        }
+    }
+
+    std::lock_guard<std::mutex> lock(m_mutex);
+    status.testsRun = m_testsRun;
+    for (const auto& test : m_tests) {
+        if (test->started && !test->finished) {
+            status.testsActive++;
+            status.activity = test->target;
+        }
+    }
+    return status;
+}
+
+void MeshAgent::announce()
+{
+    // Same mechanism as ThroughputServerScreen; without avahi the node can
+    // still be added by address
+    if (access(AVAHI_PUBLISH, X_OK) != 0) {
+        Logger::warning("MeshAgent: avahi-publish not available, node will not be discoverable");
+        return;
+    }
+
+    std::string instance = "MicroPanel mesh " + m_name;
+    std::string port = std::to_string(m_controlPort);
+    std::string txt = "iperf=" + std::to_string(m_iperfPort);
+
+    pid_t pid = fork();
+    if (pid == 0) {
+        execl(AVAHI_PUBLISH, "avahi-publish", "-s", instance.c_str(), Config::MESH_SERVICE_TYPE,
+              port.c_str(), txt.c_str(), static_cast<char*>(nullptr));
+        _exit(127);
+    }
+    if (pid < 0) {
+        Logger::warning("MeshAgent: cannot fork avahi-publish");
+        return;
+    }
+    PerfCounters::getInstance().add(PerfCounters::Counter::CHILD_PROCESSES);
+    m_announcePid = pid;
+}
+
+void MeshAgent::stopAnnouncement()
+{
+    if (m_announcePid > 0) {
+        kill(m_announcePid, SIGTERM);
+        waitpid(m_announcePid, nullptr, 0);
+        m_announcePid = -1;
+    }
+}
+
+void MeshAgent::run()
+{
+    char buffer[MAX_DATAGRAM];
+
+    while (!m_stop) {
+        int64_t now = nowUs();
+        serviceTests(now);
+
+        struct pollfd fds[2] = {
+            {m_fd, POLLIN, 0},
+            {m_wakeFd, POLLIN, 0}
+        };
+        int ready = poll(fds, 2, pollTimeoutMs(now));
+        if (ready < 0 && errno != EINTR) {
+            Logger::error("MeshAgent: poll: " + std::string(strerror(errno)));
+            break;
+        }
+        if (ready <= 0 || !(fds[0].revents & POLLIN)) {
+            continue;
+        }
+
+        for (;;) {
+            sockaddr_in from;
+            socklen_t fromLength = sizeof(from);
+            ssize_t length = recvfrom(m_fd, buffer, sizeof(buffer), 0, reinterpret_cast<sockaddr*>(&from),
+                                      &fromLength);
+            if (length < 0) {
+                break;
+            }
+            handleMessage(buffer, static_cast<size_t>(length), from);
+        }
+    }
+
+    // Tests still running belong to a coordinator that will not ask again
+    std::lock_guard<std::mutex> lock(m_mutex);
+    for (auto& test : m_tests) {
+        if (test->client) {
+            test->client->cancel();
+        }
+    }
+    m_tests.clear();
+    m_running = false;
+}
+
+int MeshAgent::pollTimeoutMs(int64_t now) const
+{
+    int64_t timeout = IDLE_POLL_MS;
+    for (const auto& test : m_tests) {
+        if (test->finished) {
+            continue;
+        }
+        if (test->started) {
+            timeout = std::min<int64_t>(timeout, MAX_POLL_MS);
+        } else {
+            timeout = std::min<int64_t>(timeout, std::max<int64_t>(0, (test->startUs - now + 999) / 1000));
+        }
+    }
+    return static_cast<int>(timeout);
+}
+
+void MeshAgent::serviceTests(int64_t now)
+{
+    std::lock_guard<std::mutex> lock(m_mutex);
+
+    for (auto& test : m_tests) {
+        if (test->finished) {
+            continue;
+        }
+        if (!test->started && test->startUs <= now) {
+            test->started = true;
+            test->client.reset(new Iperf3Client());
+            if (!test->client->start(test->options)) {
+                test->finished = true;
+                test->result.error = "Failed to start";
+                test->client.reset();
+            } else {
+                LOG_DEBUG("MeshAgent: test " + test->session + "/" + std::to_string(test->id) + " to " +
+                          test->target + " started");
+            }
+        } else if (test->started && test->client && !test->client->isRunning()) {
+            test->result = test->client->getResult();
+            test->finished = true;
+            test->client.reset();
+            m_testsRun++;
+            LOG_DEBUG("MeshAgent: test " + test->session + "/" + std::to_string(test->id) + " finished: " +
+                      (test->result.valid ? std::to_string(test->result.receiverBitsPerSecond / 1e6) + " Mbps"
+                                          : test->result.error));
+        }
+    }
+
+    // Bounded history: the oldest finished tests go first
+    while (m_tests.size() > static_cast<size_t>(Config::MESH_MAX_TESTS)) {
+        auto oldest = std::find_if(m_tests.begin(), m_tests.end(),
+                                   [](const std::unique_ptr<Test>& test) { return test->finished; });
+        if (oldest == m_tests.end()) {
+            break;
+        }
+        m_tests.erase(oldest);
+    }
+}
+
+MeshAgent::Test* MeshAgent::findTest(const std::string& session, int id)
+{
+    for (auto& test : m_tests) {
+        if (test->session == session && test->id == id) {
+            return test.get();
+        }
+    }
+    return nullptr;
+}
+
+void MeshAgent::reply(const std::string& payload, const sockaddr_in& to)
+{
+    if (sendto(m_fd, payload.data(), payload.size(), 0, reinterpret_cast<const sockaddr*>(&to), sizeof(to)) < 0) {
+        LOG_DEBUG("MeshAgent: reply failed: " + std::string(strerror(errno)));
+    }
+}
+
+void MeshAgent::handleMessage(const char* data, size_t length, const sockaddr_in& from)
+{
+    json request = json::parse(data, data + length, nullptr, false);
+    if (request.is_discarded() || !request.is_object() || !request.contains("op") || !request["op"].is_string()) {
+        LOG_DEBUG("MeshAgent: ignoring malformed datagram");
+        return;
+    }
+    if (!fieldsWellFormed(request)) {
+        char address[INET_ADDRSTRLEN];
+        inet_ntop(AF_INET, &from.sin_addr, address, sizeof(address));
+        Logger::warning("MeshAgent: dropping request with mistyped fields from " + std::string(address));
+        return;
+    }
+
+    std::string op = request["op"].get<std::string>();
+    std::string session = request.value("session", std::string());
+    int id = request.value("test", 0);
+    json response = {{"op", op}};
+
+    if (op == "hello") {
+        response["seq"] = request.value("seq", 0);
+        response["name"] = m_name;
+        response["iperf"] = m_iperfPort;
+    } else if (op == "run") {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        response["op"] = "ack";
+        response["session"] = session;
+        response["test"] = id;
+        if (!findTest(session, id)) {
+            // Resent requests find the test and are only acknowledged again
+            std::unique_ptr<Test> test(new Test());
+            test->session = session;
+            test->id = id;
+            test->target = request.value("host", std::string());
+            test->options.host = test->target;
+            test->options.port = request.value("port", Config::MESH_IPERF_PORT);
+            test->options.durationSec = std::max(1, std::min(request.value("duration", 10), 300));
+            test->options.parallel = std::max(1, std::min(request.value("parallel", 1), 16));
+            test->options.reverse = request.value("reverse", false);
+            int delayMs = std::max(0, std::min(request.value("delay_ms", 0), 600000));
+            test->startUs = nowUs() + static_cast<int64_t>(delayMs) * 1000;
+            LOG_DEBUG("MeshAgent: scheduled test " + session + "/" + std::to_string(id) + " to " + test->target +
+                      " in " + std::to_string(delayMs) + " ms");
+            m_tests.push_back(std::move(test));
+            uint64_t one = 1;
+            if (write(m_wakeFd, &one, sizeof(one)) < 0) {
+                // Only the poll timeout is affected
+            }
+        }
+    } else if (op == "result") {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        response["session"] = session;
+        response["test"] = id;
+        Test* test = findTest(session, id);
+        if (!test) {
+            response["state"] = "unknown";
+        } else {
+            const Iperf3Client::Result& result = test->result;
+            response["state"] = testState(test->started, test->finished, result);
+            if (test->finished) {
+                response["mbps"] = result.receiverBitsPerSecond / 1e6;
+                response["sender_mbps"] = result.senderBitsPerSecond / 1e6;
+                response["retransmits"] = result.retransmits;
+                response["error"] = result.error;
+            }
+        }
+    } else if (op == "abort") {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        response["op"] = "ack";
+        response["session"] = session;
+        for (auto& test : m_tests) {
+            if (test->session != session || test->finished) {
+                continue;
+            }
+            if (test->client) {
+                test->client->cancel();
+                test->client.reset();
+            }
+            test->started = true;
+            test->finished = true;
+            test->result.error = "Aborted";
+        }
+    } else {
+        return;
+    }
+
+    reply(response.dump(), from);
+}
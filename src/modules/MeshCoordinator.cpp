@@ -0,0 +1,638 @@
+#include "MeshCoordinator.h"
+#include "Config.h"
+#include "Logger.h"
+#include <algorithm>
+#include <cerrno>
+#include <cstdio>
+#include <cstring>
+#include <ctime>
+#include <fstream>
+#include <poll.h>
+#include <unistd.h>
+#include <arpa/inet.h>
+#include <netinet/in.h>
+#include <sys/socket.h>
+#include <nlohmann/json.hpp>
+
+using json = nlohmann::json;
+
+namespace {
+    constexpr size_t MAX_DATAGRAM = 2048;
+    constexpr int WAIT_SLICE_MS = 100;      // Cancel latency while a round runs
+
+    int64_t nowUs() {
+        struct timespec ts;
+        clock_gettime(CLOCK_MONOTONIC, &ts);
+        return static_cast<int64_t>(ts.tv_sec) * 1000000 + ts.tv_nsec / 1000;
+    }
+
+    const char* stateName(MeshCoordinator::State state) {
+        switch (state) {
+            case MeshCoordinator::State::PENDING:   return "pending";
+            case MeshCoordinator::State::SCHEDULED: return "scheduled";
+            case MeshCoordinator::State::RUNNING:   return "running";
+            case MeshCoordinator::State::DONE:      return "done";
+            case MeshCoordinator::State::FAILED:    return "failed";
+        }
+        return "unknown";
+    }
+
+    // json::value() throws when a field's type differs from the default's,
+    // so replies are checked field by field before they are matched
+    bool fieldsWellFormed(const json& reply) {
+        for (const char* key : {"op", "session", "name", "state", "error"}) {
+            if (reply.contains(key) && !reply[key].is_string()) return false;
+        }
+        for (const char* key : {"seq", "test", "iperf", "retransmits"}) {
+            if (reply.contains(key) && !reply[key].is_number_integer()) return false;
+        }
+        for (const char* key : {"mbps", "sender_mbps"}) {
+            if (reply.contains(key) && !reply[key].is_number()) return false;
+        }
+        return true;
+    }
+
+    bool isFinished(MeshCoordinator::State state) {
+        return state == MeshCoordinator::State::DONE || state == MeshCoordinator::State::FAILED;
+    }
+
+    // Greedy rounds: each round takes every pair whose nodes are both still idle
+    void assignRounds(std::vector<MeshCoordinator::Pair*>& pending, size_t nodes) {
+        for (int round = 0; !pending.empty(); round++) {
+            std::vector<bool> busy(nodes, false);
+            std::vector<MeshCoordinator::Pair*> later;
+            for (MeshCoordinator::Pair* pair : pending) {
+                if (busy[pair->from] || busy[pair->to]) {
+                    later.push_back(pair);
+                    continue;
+                }
+                busy[pair->from] = busy[pair->to] = true;
+                pair->round = round;
+            }
+            pending.swap(later);
+        }
+    }
+}
+
+/**
+ * One outstanding datagram exchange with a node. The reply is matched on the
+ * sender address, its op and the id field ("seq" for hello, else "test").
+ */
+struct MeshCoordinator::Request {
+    size_t node = 0;
+    std::string op;                     // Sent
+    std::string replyOp;                // Expected back
+    int id = 0;
+    int test = -1;                      // Result index for run requests (payload rebuilt per send)
+    std::string payload;
+    int attempts = 0;
+    int64_t sentUs = 0;
+    bool answered = false;
+    int64_t rttUs = 0;
+    json reply;
+};
+
+MeshCoordinator::MeshCoordinator()
+{
+}
+
+MeshCoordinator::~MeshCoordinator()
+{
+    cancel();
+}
+
+std::vector<MeshCoordinator::Pair> MeshCoordinator::buildSchedule(size_t nodes, Pattern pattern, Order order)
+{
+    std::vector<Pair> pending;
+    if (pattern == Pattern::HUB) {
+        for (size_t from = 1; from < nodes; from++) {
+            pending.push_back({static_cast<int>(from), 0, 0});
+        }
+    } else {
+        for (size_t from = 0; from < nodes; from++) {
+            for (size_t to = 0; to < nodes; to++) {
+                if (from != to) {
+                    pending.push_back({static_cast<int>(from), static_cast<int>(to), 0});
+                }
+            }
+        }
+    }
+
+    if (order == Order::STAGGERED) {
+        std::vector<Pair*> unassigned;
+        for (Pair& pair : pending) {
+            unassigned.push_back(&pair);
+        }
+        assignRounds(unassigned, nodes);
+        std::stable_sort(pending.begin(), pending.end(),
+                         [](const Pair& a, const Pair& b) { return a.round < b.round; });
+    }
+    return pending;
+}
+
+bool MeshCoordinator::start(const std::vector<Node>& nodes, const Options& options)
+{
+    if (m_running) {
+        return false;
+    }
+    if (m_thread.joinable()) {
+        m_thread.join();
+    }
+    if (nodes.size() < 2 || nodes.size() > static_cast<size_t>(Config::MESH_MAX_NODES)) {
+        Logger::error("MeshCoordinator: need 2 to " + std::to_string(Config::MESH_MAX_NODES) + " nodes, got " +
+                      std::to_string(nodes.size()));
+        return false;
+    }
+
+    std::vector<Pair> schedule = buildSchedule(nodes.size(), options.pattern, options.order);
+    if (schedule.size() > static_cast<size_t>(Config::MESH_MAX_TESTS)) {
+        Logger::error("MeshCoordinator: " + std::to_string(schedule.size()) + " tests exceed MESH_MAX_TESTS");
+        return false;
+    }
+
+    m_fd = socket(AF_INET, SOCK_DGRAM | SOCK_NONBLOCK | SOCK_CLOEXEC, 0);
+    if (m_fd < 0) {
+        Logger::error("MeshCoordinator: socket: " + std::string(strerror(errno)));
+        return false;
+    }
+
+    m_options = options;
+    m_session = std::to_string(time(nullptr)) + "-" + std::to_string(getpid());
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        m_nodes = nodes;
+        m_rttUs.assign(nodes.size(), -1);
+        m_results.clear();
+        for (const Pair& pair : schedule) {
+            Result result;
+            result.pair = pair;
+            m_results.push_back(result);
+        }
+        m_rounds = schedule.empty() ? 0 : schedule.back().round + 1;
+        m_round = 0;
+        m_firstStartUs = 0;
+        m_phase = "Contacting";
+    }
+
+    Logger::info("MeshCoordinator: session " + m_session + ", " + std::to_string(nodes.size()) + " nodes, " +
+                 std::to_string(schedule.size()) + " tests in " + std::to_string(m_rounds) + " rounds");
+
+    m_cancel = false;
+    m_running = true;
+    m_thread = std::thread(&MeshCoordinator::run, this);
+    return true;
+}
+
+void MeshCoordinator::cancel()
+{
+    m_cancel = true;
+    if (m_thread.joinable()) {
+        m_thread.join();
+    }
+}
+
+MeshCoordinator::Progress MeshCoordinator::getProgress() const
+{
+    std::lock_guard<std::mutex> lock(m_mutex);
+    Progress progress;
+    progress.running = m_running.load();
+    progress.phase = m_phase;
+    progress.round = m_round;
+    progress.rounds = m_rounds;
+    progress.total = static_cast<int>(m_results.size());
+    for (const auto& result : m_results) {
+        if (isFinished(result.state)) {
+            progress.finished++;
+        }
+    }
+    if (m_firstStartUs > 0 && progress.running) {
+        int64_t roundUs = static_cast<int64_t>(m_options.durationSec) * 1000000 + Config::MESH_ROUND_GAP_MS * 1000;
+        int64_t endUs = m_firstStartUs + m_rounds * roundUs;
+        progress.secondsLeft = std::max<int64_t>(0, endUs - nowUs()) / 1e6;
+    }
+    return progress;
+}
+
+std::vector<MeshCoordinator::Node> MeshCoordinator::getNodes() const
+{
+    std::lock_guard<std::mutex> lock(m_mutex);
+    return m_nodes;
+}
+
+std::vector<MeshCoordinator::Result> MeshCoordinator::getResults() const
+{
+    std::lock_guard<std::mutex> lock(m_mutex);
+    return m_results;
+}
+
+void MeshCoordinator::setPhase(const std::string& phase)
+{
+    std::lock_guard<std::mutex> lock(m_mutex);
+    m_phase = phase;
+}
+
+void MeshCoordinator::run()
+{
+    // Only this thread writes m_nodes and m_results (under m_mutex), so it
+    // reads them without the lock
+    bool completed = contactNodes() && pushSchedule();
+
+    int64_t roundUs = static_cast<int64_t>(m_options.durationSec) * 1000000 + Config::MESH_ROUND_GAP_MS * 1000;
+    for (int round = 0; completed && round < m_rounds; round++) {
+        int64_t startUs = m_firstStartUs + round * roundUs;
+        int64_t endUs = startUs + static_cast<int64_t>(m_options.durationSec) * 1000000;
+        {
+            std::lock_guard<std::mutex> lock(m_mutex);
+            m_round = round;
+            m_phase = "Round " + std::to_string(round + 1) + "/" + std::to_string(m_rounds);
+        }
+
+        bool marked = false;
+        while (!m_cancel && nowUs() < endUs) {
+            if (!marked && nowUs() >= startUs) {
+                std::lock_guard<std::mutex> lock(m_mutex);
+                for (auto& result : m_results) {
+                    if (result.pair.round == round && result.state == State::SCHEDULED) {
+                        result.state = State::RUNNING;
+                    }
+                }
+                marked = true;
+            }
+            usleep(WAIT_SLICE_MS * 1000);
+        }
+        if (m_cancel) {
+            completed = false;
+            break;
+        }
+        collectRound(round);
+    }
+
+    if (m_cancel) {
+        abortSession();
+    }
+
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        for (auto& result : m_results) {
+            if (!isFinished(result.state)) {
+                result.state = State::FAILED;
+                result.error = m_cancel ? "Cancelled" : "No result";
+            }
+        }
+        m_phase = m_cancel ? "Cancelled" : "Done";
+    }
+
+    if (!m_options.exportPath.empty()) {
+        if (writeExport()) {
+            Logger::info("MeshCoordinator: results written to " + m_options.exportPath);
+        } else {
+            Logger::warning("MeshCoordinator: cannot write " + m_options.exportPath);
+        }
+    }
+
+    ::close(m_fd);
+    m_fd = -1;
+    m_running = false;
+}
+
+bool MeshCoordinator::contactNodes()
+{
+    std::vector<Request> requests(m_nodes.size());
+    for (size_t i = 0; i < m_nodes.size(); i++) {
+        requests[i].node = i;
+        requests[i].op = "hello";
+        requests[i].replyOp = "hello";
+        requests[i].id = static_cast<int>(i);
+        requests[i].payload = json{{"op", "hello"}, {"seq", i}}.dump();
+    }
+    exchange(requests, nowUs() + static_cast<int64_t>(Config::MESH_RETRIES) * Config::MESH_RETRY_MS * 1000, true);
+    if (m_cancel) {
+        return false;
+    }
+
+    std::lock_guard<std::mutex> lock(m_mutex);
+    for (const Request& request : requests) {
+        Node& node = m_nodes[request.node];
+        if (!request.answered) {
+            Logger::warning("MeshCoordinator: no answer from " + node.address);
+            continue;
+        }
+        m_rttUs[request.node] = request.rttUs;
+        // The node knows best; mDNS TXT data may be stale or missing
+        node.name = request.reply.value("name", node.name);
+        node.iperfPort = request.reply.value("iperf", node.iperfPort);
+        LOG_DEBUG("MeshCoordinator: " + node.name + " at " + node.address + ", rtt " +
+                  std::to_string(request.rttUs) + " us");
+    }
+    // Pairs with a silent node never run (round -1); the rest are packed
+    // again so rounds that only held those pairs are not waited out
+    std::vector<Pair*> pending;
+    for (auto& result : m_results) {
+        if (m_rttUs[result.pair.from] < 0 || m_rttUs[result.pair.to] < 0) {
+            result.state = State::FAILED;
+            result.error = "No answer";
+            result.pair.round = -1;
+        } else if (m_options.order == Order::STAGGERED) {
+            pending.push_back(&result.pair);
+        }
+    }
+    assignRounds(pending, m_nodes.size());
+    m_rounds = 0;
+    for (const auto& result : m_results) {
+        m_rounds = std::max(m_rounds, result.pair.round + 1);
+    }
+    return true;
+}
+
+std::string MeshCoordinator::runRequest(size_t index) const
+{
+    // Called with m_mutex held; the delay is recomputed for every resend
+    const Result& result = m_results[index];
+    const Node& target = m_nodes[result.pair.to];
+    int64_t roundUs = static_cast<int64_t>(m_options.durationSec) * 1000000 + Config::MESH_ROUND_GAP_MS * 1000;
+    int64_t startUs = m_firstStartUs + result.pair.round * roundUs;
+    int64_t delayUs = startUs - nowUs() - m_rttUs[result.pair.from] / 2;
+
+    return json{
+        {"op", "run"},
+        {"session", m_session},
+        {"test", index + 1},
+        {"host", target.address},
+        {"port", target.iperfPort},
+        {"duration", m_options.durationSec},
+        {"parallel", m_options.parallel},
+        {"delay_ms", std::max<int64_t>(0, delayUs / 1000)}
+    }.dump();
+}
+
+bool MeshCoordinator::pushSchedule()
+{
+    std::vector<Request> requests;
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        m_phase = "Scheduling";
+        m_firstStartUs = nowUs() + static_cast<int64_t>(Config::MESH_START_LEAD_MS) * 1000;
+        for (size_t i = 0; i < m_results.size(); i++) {
+            if (m_results[i].state != State::PENDING) {
+                continue;
+            }
+            Request request;
+            request.node = static_cast<size_t>(m_results[i].pair.from);
+            request.op = "run";
+            request.replyOp = "ack";
+            request.id = static_cast<int>(i + 1);
+            request.test = static_cast<int>(i);
+            requests.push_back(request);
+        }
+    }
+
+    exchange(requests, nowUs() + static_cast<int64_t>(Config::MESH_RETRIES) * Config::MESH_RETRY_MS * 1000, true);
+    if (m_cancel) {
+        return false;
+    }
+
+    std::lock_guard<std::mutex> lock(m_mutex);
+    for (const Request& request : requests) {
+        Result& result = m_results[request.test];
+        if (request.answered) {
+            result.state = State::SCHEDULED;
+        } else {
+            result.state = State::FAILED;
+            result.error = "Not scheduled";
+        }
+    }
+    return true;
+}
+
+void MeshCoordinator::collectRound(int round)
+{
+    int64_t graceEndUs = nowUs() + static_cast<int64_t>(Config::MESH_RESULT_GRACE_MS) * 1000;
+
+    while (!m_cancel) {
+        std::vector<Request> requests;
+        {
+            std::lock_guard<std::mutex> lock(m_mutex);
+            for (size_t i = 0; i < m_results.size(); i++) {
+                const Result& result = m_results[i];
+                if (result.pair.round != round || isFinished(result.state)) {
+                    continue;
+                }
+                Request request;
+                request.node = static_cast<size_t>(result.pair.from);
+                request.op = "result";
+                request.replyOp = "result";
+                request.id = static_cast<int>(i + 1);
+                request.test = static_cast<int>(i);
+                request.payload = json{{"op", "result"}, {"session", m_session}, {"test", i + 1}}.dump();
+                requests.push_back(request);
+            }
+        }
+        if (requests.empty() || nowUs() >= graceEndUs) {
+            return;
+        }
+
+        exchange(requests, std::min(graceEndUs, nowUs() + static_cast<int64_t>(Config::MESH_RETRIES) *
+                                                           Config::MESH_RETRY_MS * 1000), true);
+
+        bool roundFinished = true;
+        {
+            std::lock_guard<std::mutex> lock(m_mutex);
+            for (const Request& request : requests) {
+                if (!request.answered) {
+                    roundFinished = false;
+                    continue;
+                }
+                Result& result = m_results[request.test];
+                std::string state = request.reply.value("state", std::string());
+                if (state == "done") {
+                    result.state = State::DONE;
+                    result.mbps = request.reply.value("mbps", 0.0);
+                    result.retransmits = request.reply.value("retransmits", 0);
+                } else if (state == "failed") {
+                    result.state = State::FAILED;
+                    result.error = request.reply.value("error", std::string("Failed"));
+                } else if (state == "unknown") {
+                    // The node restarted and forgot the test
+                    result.state = State::FAILED;
+                    result.error = "Lost by node";
+                } else {
+                    roundFinished = false;
+                }
+            }
+        }
+        if (roundFinished) {
+            return;
+        }
+        usleep(Config::MESH_RETRY_MS * 1000);
+    }
+}
+
+void MeshCoordinator::abortSession()
+{
+    setPhase("Aborting");
+
+    std::vector<Request> requests;
+    for (size_t i = 0; i < m_nodes.size(); i++) {
+        if (m_rttUs[i] < 0) {
+            continue;
+        }
+        Request request;
+        request.node = i;
+        request.op = "abort";
+        request.replyOp = "ack";
+        request.payload = json{{"op", "abort"}, {"session", m_session}}.dump();
+        requests.push_back(request);
+    }
+    exchange(requests, nowUs() + static_cast<int64_t>(Config::MESH_RETRIES) * Config::MESH_RETRY_MS * 1000, false);
+}
+
+void MeshCoordinator::exchange(std::vector<Request>& requests, int64_t deadlineUs, bool stopOnCancel)
+{
+    std::vector<sockaddr_in> addresses(requests.size());
+    for (size_t i = 0; i < requests.size(); i++) {
+        const Node& node = m_nodes[requests[i].node];
+        std::memset(&addresses[i], 0, sizeof(addresses[i]));
+        addresses[i].sin_family = AF_INET;
+        addresses[i].sin_port = htons(static_cast<uint16_t>(node.controlPort));
+        if (inet_pton(AF_INET, node.address.c_str(), &addresses[i].sin_addr) != 1) {
+            requests[i].attempts = Config::MESH_RETRIES;   // Never sent, never answered
+        }
+    }
+
+    char buffer[MAX_DATAGRAM];
+    while (!(stopOnCancel && m_cancel)) {
+        int64_t now = nowUs();
+        bool waiting = false;
+
+        for (size_t i = 0; i < requests.size(); i++) {
+            Request& request = requests[i];
+            if (request.answered) {
+                continue;
+            }
+            bool due = request.attempts == 0 || now - request.sentUs >= Config::MESH_RETRY_MS * 1000;
+            if (due && request.attempts < Config::MESH_RETRIES) {
+                std::string payload;
+                if (request.test >= 0 && request.op == "run") {
+                    std::lock_guard<std::mutex> lock(m_mutex);
+                    payload = runRequest(static_cast<size_t>(request.test));
+                } else {
+                    payload = request.payload;
+                }
+                sendto(m_fd, payload.data(), payload.size(), 0, reinterpret_cast<sockaddr*>(&addresses[i]),
+                       sizeof(addresses[i]));
+                request.sentUs = now;
+                request.attempts++;
+            }
+            // The last attempt still gets its full retry interval to answer
+            if (request.attempts < Config::MESH_RETRIES || now - request.sentUs < Config::MESH_RETRY_MS * 1000) {
+                waiting = true;
+            }
+        }
+        if (!waiting || now >= deadlineUs) {
+            return;
+        }
+
+        struct pollfd pfd = {m_fd, POLLIN, 0};
+        int timeoutMs = static_cast<int>(std::min<int64_t>(Config::MESH_RETRY_MS, (deadlineUs - now + 999) / 1000));
+        if (poll(&pfd, 1, std::min(timeoutMs, WAIT_SLICE_MS)) <= 0) {
+            continue;
+        }
+
+        for (;;) {
+            sockaddr_in from;
+            socklen_t fromLength = sizeof(from);
+            ssize_t length = recvfrom(m_fd, buffer, sizeof(buffer), 0, reinterpret_cast<sockaddr*>(&from),
+                                      &fromLength);
+            if (length < 0) {
+                break;
+            }
+            json reply = json::parse(buffer, buffer + length, nullptr, false);
+            if (reply.is_discarded() || !reply.is_object()) {
+                continue;
+            }
+            if (!fieldsWellFormed(reply)) {
+                char address[INET_ADDRSTRLEN];
+                inet_ntop(AF_INET, &from.sin_addr, address, sizeof(address));
+                Logger::warning("MeshCoordinator: dropping reply with mistyped fields from " + std::string(address));
+                continue;
+            }
+            std::string op = reply.value("op", std::string());
+            bool hello = op == "hello";
+            int id = reply.value(hello ? "seq" : "test", 0);
+            if (!hello && reply.value("session", std::string()) != m_session) {
+                continue;       // Late answer from an earlier run
+            }
+
+            int64_t received = nowUs();
+            for (size_t i = 0; i < requests.size(); i++) {
+                Request& request = requests[i];
+                if (request.answered || request.replyOp != op || request.id != id ||
+                    addresses[i].sin_addr.s_addr != from.sin_addr.s_addr || addresses[i].sin_port != from.sin_port) {
+                    continue;
+                }
+                request.answered = true;
+                request.rttUs = received - request.sentUs;
+                request.reply = std::move(reply);
+                break;
+            }
+        }
+    }
+}
+
+bool MeshCoordinator::writeExport() const
+{
+    json document;
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        document["session"] = m_session;
+        document["time"] = static_cast<int64_t>(time(nullptr));
+        document["pattern"] = m_options.pattern == Pattern::HUB ? "hub" : "full";
+        document["order"] = m_options.order == Order::STAGGERED ? "staggered" : "concurrent";
+        document["duration"] = m_options.durationSec;
+        document["parallel"] = m_options.parallel;
+
+        json nodes = json::array();
+        for (size_t i = 0; i < m_nodes.size(); i++) {
+            json node = {{"name", m_nodes[i].name}, {"address", m_nodes[i].address}, {"iperf", m_nodes[i].iperfPort}};
+            node["rtt_ms"] = m_rttUs[i] >= 0 ? json(m_rttUs[i] / 1000.0) : json(nullptr);
+            nodes.push_back(node);
+        }
+        document["nodes"] = nodes;
+
+        json results = json::array();
+        for (const auto& result : m_results) {
+            json entry = {
+                {"from", result.pair.from},
+                {"to", result.pair.to},
+                {"round", result.pair.round},
+                {"state", stateName(result.state)}
+            };
+            if (result.state == State::DONE) {
+                entry["mbps"] = result.mbps;
+                entry["retransmits"] = result.retransmits;
+            } else if (!result.error.empty()) {
+                entry["error"] = result.error;
+            }
+            results.push_back(entry);
+        }
+        document["results"] = results;
+    }
+
+    // Same write-and-rename as PerfCounters: readers never see half a file
+    std::string temporary = m_options.exportPath + ".tmp";
+    {
+        std::ofstream file(temporary);
+        if (!file) {
+            return false;
+        }
+        file << document.dump(2) << "\n";
+        if (!file) {
+            return false;
+        }
+    }
+    if (std::rename(temporary.c_str(), m_options.exportPath.c_str()) != 0) {
+        std::remove(temporary.c_str());
+        return false;
+    }
+    return true;
+}
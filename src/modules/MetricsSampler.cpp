@@ -0,0 +1,359 @@
+#include "MetricsSampler.h"
+#include "Logger.h"
+#include "Scheduler.h"
+#include <algorithm>
+#include <cstdio>
+#include <cstring>
+#include <ctime>
+#include <fcntl.h>
+#include <unistd.h>
+
+namespace {
+    constexpr int CPU_FIELDS = 8;       // user nice system idle iowait irq softirq steal
+
+    int64_t nowMs() {
+        struct timespec ts;
+        clock_gettime(CLOCK_MONOTONIC, &ts);
+        return static_cast<int64_t>(ts.tv_sec) * 1000 + ts.tv_nsec / 1000000;
+    }
+
+    // Parsing helpers over a NUL-terminated buffer; each advances p past what it consumed
+    void skipSpaces(const char*& p) {
+        while (*p == ' ' || *p == '\t') p++;
+    }
+
+    bool parseUnsigned(const char*& p, uint64_t& value) {
+        skipSpaces(p);
+        if (*p < '0' || *p > '9') return false;
+        value = 0;
+        while (*p >= '0' && *p <= '9') {
+            value = value * 10 + static_cast<uint64_t>(*p - '0');
+            p++;
+        }
+        return true;
+    }
+
+    bool parseSigned(const char*& p, int64_t& value) {
+        skipSpaces(p);
+        bool negative = *p == '-';
+        if (negative) p++;
+        uint64_t magnitude;
+        if (!parseUnsigned(p, magnitude)) return false;
+        value = negative ? -static_cast<int64_t>(magnitude) : static_cast<int64_t>(magnitude);
+        return true;
+    }
+
+    void nextLine(const char*& p) {
+        while (*p && *p != '\n') p++;
+        if (*p == '\n') p++;
+    }
+
+    // Value in kB of a /proc/meminfo key such as "MemTotal:"
+    bool meminfoValue(const char* buffer, const char* key, uint64_t& value) {
+        const char* p = strstr(buffer, key);
+        if (!p) return false;
+        p += strlen(key);
+        return parseUnsigned(p, value);
+    }
+}
+
+void MetricsSampler::Ring::push(int32_t value)
+{
+    m_values[m_head] = value;
+    m_head = (m_head + 1) % HISTORY;
+    if (m_count < static_cast<size_t>(HISTORY)) m_count++;
+}
+
+void MetricsSampler::Ring::copyTo(std::vector<int32_t>& out) const
+{
+    out.clear();
+    out.reserve(m_count);
+    size_t start = (m_head + HISTORY - m_count) % HISTORY;
+    for (size_t i = 0; i < m_count; i++) {
+        out.push_back(m_values[(start + i) % HISTORY]);
+    }
+}
+
+MetricsSampler& MetricsSampler::getInstance()
+{
+    static MetricsSampler instance;
+    return instance;
+}
+
+MetricsSampler::MetricsSampler()
+{
+    for (int i = 0; i < MAX_THERMAL_ZONES; i++) {
+        m_thermalFds[i] = -1;
+    }
+}
+
+MetricsSampler::~MetricsSampler()
+{
+    for (int fd : {m_statFd, m_meminfoFd, m_loadavgFd, m_netDevFd}) {
+        if (fd >= 0) close(fd);
+    }
+    for (int i = 0; i < m_thermalCount; i++) {
+        close(m_thermalFds[i]);
+    }
+}
+
+void MetricsSampler::start()
+{
+    if (m_job >= 0) {
+        return;
+    }
+    openSources();
+    sample();
+
+    // Sparklines are only looked at, so sampling stops while the display is dark
+    m_job = Scheduler::getInstance().add("metrics", Config::METRICS_INTERVAL_MS, Scheduler::Cost::LIGHT, true,
+                                         [this]() { sample(); });
+}
+
+void MetricsSampler::openSources()
+{
+    m_statFd = open("/proc/stat", O_RDONLY | O_CLOEXEC);
+    m_meminfoFd = open("/proc/meminfo", O_RDONLY | O_CLOEXEC);
+    m_loadavgFd = open("/proc/loadavg", O_RDONLY | O_CLOEXEC);
+    m_netDevFd = open("/proc/net/dev", O_RDONLY | O_CLOEXEC);
+    if (m_statFd < 0) {
+        Logger::warning("MetricsSampler: /proc/stat not available");
+    }
+
+    // Zones can be sparse (thermal_zone0 missing, thermal_zone1 present)
+    for (int zone = 0; zone < MAX_THERMAL_ZONES * 2 && m_thermalCount < MAX_THERMAL_ZONES; zone++) {
+        char path[64];
+        snprintf(path, sizeof(path), "/sys/class/thermal/thermal_zone%d/temp", zone);
+        int fd = open(path, O_RDONLY | O_CLOEXEC);
+        if (fd >= 0) {
+            m_thermalFds[m_thermalCount++] = fd;
+        }
+    }
+    LOG_DEBUG("MetricsSampler: " + std::to_string(m_thermalCount) + " thermal zones");
+}
+
+ssize_t MetricsSampler::readSource(int fd)
+{
+    if (fd < 0) {
+        return -1;
+    }
+    // procfs and sysfs regenerate the contents for a read at offset 0
+    ssize_t length = pread(fd, m_buffer, sizeof(m_buffer) - 1, 0);
+    m_buffer[length > 0 ? length : 0] = '\0';
+    return length;
+}
+
+void MetricsSampler::sample()
+{
+    int64_t now = nowMs();
+    int64_t elapsed = m_lastSampleMs ? now - m_lastSampleMs : 0;
+    m_lastSampleMs = now;
+
+    sampleCpu();
+    sampleMemory();
+    sampleLoad();
+    sampleTemperature();
+    sampleNetwork(elapsed);
+    m_generation++;
+}
+
+void MetricsSampler::sampleCpu()
+{
+    if (readSource(m_statFd) <= 0) {
+        return;
+    }
+
+    // "cpu  ..." then "cpu0 ...", "cpu1 ..."; anything else ends the block
+    std::vector<CpuCounters>& current = m_currentCpu;
+    current.clear();
+    const char* p = m_buffer;
+    while (strncmp(p, "cpu", 3) == 0) {
+        p += 3;
+        while (*p >= '0' && *p <= '9') p++;
+
+        uint64_t fields[CPU_FIELDS] = {0};
+        for (int i = 0; i < CPU_FIELDS && parseUnsigned(p, fields[i]); i++) {
+        }
+        CpuCounters counters;
+        for (int i = 0; i < CPU_FIELDS; i++) {
+            counters.total += fields[i];
+        }
+        counters.busy = counters.total - fields[3] - fields[4];
+        current.push_back(counters);
+        nextLine(p);
+    }
+    if (current.empty()) {
+        return;
+    }
+
+    if (m_cpu.size() != current.size()) {
+        // First sample, or CPUs came online/offline: restart the per-core history
+        m_cpu.assign(current.size(), Ring());
+        m_previousCpu.swap(current);
+        return;
+    }
+    for (size_t i = 0; i < current.size(); i++) {
+        uint64_t total = current[i].total - m_previousCpu[i].total;
+        uint64_t busy = current[i].busy - m_previousCpu[i].busy;
+        if (current[i].total < m_previousCpu[i].total || busy > total) {
+            busy = total = 0;
+        }
+        m_cpu[i].push(total ? static_cast<int32_t>((busy * 100 + total / 2) / total) : 0);
+    }
+    m_previousCpu.swap(current);
+}
+
+void MetricsSampler::sampleMemory()
+{
+    if (readSource(m_meminfoFd) <= 0) {
+        return;
+    }
+
+    uint64_t total = 0;
+    uint64_t available = 0;
+    if (!meminfoValue(m_buffer, "MemTotal:", total) || total == 0) {
+        return;
+    }
+    // Kernels before 3.14 have no MemAvailable
+    if (!meminfoValue(m_buffer, "MemAvailable:", available)) {
+        meminfoValue(m_buffer, "MemFree:", available);
+    }
+
+    m_memory.push(static_cast<int32_t>(((total - std::min(available, total)) * 100 + total / 2) / total));
+}
+
+void MetricsSampler::sampleLoad()
+{
+    if (readSource(m_loadavgFd) <= 0) {
+        return;
+    }
+
+    // "0.52 0.58 0.59 1/123 4567": take the first value as hundredths
+    const char* p = m_buffer;
+    uint64_t whole = 0;
+    if (!parseUnsigned(p, whole)) {
+        return;
+    }
+    uint64_t hundredths = 0;
+    if (*p == '.') {
+        p++;
+        for (int digit = 0; digit < 2; digit++) {
+            hundredths *= 10;
+            if (*p >= '0' && *p <= '9') hundredths += static_cast<uint64_t>(*p++ - '0');
+        }
+    }
+
+    m_load.push(static_cast<int32_t>(whole * 100 + hundredths));
+}
+
+void MetricsSampler::sampleTemperature()
+{
+    bool found = false;
+    int64_t hottest = 0;
+    for (int i = 0; i < m_thermalCount; i++) {
+        if (readSource(m_thermalFds[i]) <= 0) {
+            continue;
+        }
+        const char* p = m_buffer;
+        int64_t value;
+        if (parseSigned(p, value) && (!found || value > hottest)) {
+            hottest = value;
+            found = true;
+        }
+    }
+    if (!found) {
+        return;
+    }
+
+    m_temperature.push(static_cast<int32_t>(hottest));
+}
+
+void MetricsSampler::sampleNetwork(int64_t elapsedMs)
+{
+    if (readSource(m_netDevFd) <= 0) {
+        return;
+    }
+
+    // Two header lines, then "  eth0: rx_bytes ... (8 rx fields) tx_bytes ..."
+    const char* p = m_buffer;
+    nextLine(p);
+    nextLine(p);
+    uint64_t rx = 0;
+    uint64_t tx = 0;
+    while (*p) {
+        skipSpaces(p);
+        const char* name = p;
+        while (*p && *p != ':' && *p != '\n') p++;
+        if (*p != ':') {
+            nextLine(p);
+            continue;
+        }
+        bool loopback = (p - name == 2) && strncmp(name, "lo", 2) == 0;
+        p++;
+
+        uint64_t fields[9] = {0};
+        int parsed = 0;
+        while (parsed < 9 && parseUnsigned(p, fields[parsed])) parsed++;
+        if (!loopback && parsed == 9) {
+            rx += fields[0];
+            tx += fields[8];
+        }
+        nextLine(p);
+    }
+
+    bool haveRate = m_haveNetwork && elapsedMs > 0;
+    // Counters go backwards when an interface disappears; skip that sample
+    uint64_t rxDelta = rx >= m_previousRx ? rx - m_previousRx : 0;
+    uint64_t txDelta = tx >= m_previousTx ? tx - m_previousTx : 0;
+    m_previousRx = rx;
+    m_previousTx = tx;
+    m_haveNetwork = true;
+    if (!haveRate) {
+        return;
+    }
+
+    const uint64_t limit = 0x7FFFFFFF;
+    m_netRx.push(static_cast<int32_t>(std::min(limit, rxDelta * 1000 / static_cast<uint64_t>(elapsedMs))));
+    m_netTx.push(static_cast<int32_t>(std::min(limit, txDelta * 1000 / static_cast<uint64_t>(elapsedMs))));
+}
+
+const MetricsSampler::Ring* MetricsSampler::ring(Metric metric, int core) const
+{
+    switch (metric) {
+        case Metric::CPU: {
+            size_t index = static_cast<size_t>(core + 1);
+            return index < m_cpu.size() ? &m_cpu[index] : nullptr;
+        }
+        case Metric::MEMORY: return &m_memory;
+        case Metric::LOAD: return &m_load;
+        case Metric::TEMPERATURE: return &m_temperature;
+        case Metric::NET_RX: return &m_netRx;
+        case Metric::NET_TX: return &m_netTx;
+    }
+    return nullptr;
+}
+
+std::vector<int32_t> MetricsSampler::history(Metric metric, int core) const
+{
+    std::vector<int32_t> values;
+    const Ring* series = ring(metric, core);
+    if (series) {
+        series->copyTo(values);
+    }
+    return values;
+}
+
+bool MetricsSampler::latest(Metric metric, int32_t& value, int core) const
+{
+    const Ring* series = ring(metric, core);
+    if (!series || series->size() == 0) {
+        return false;
+    }
+    value = series->newest();
+    return true;
+}
+
+int MetricsSampler::coreCount() const
+{
+    return m_cpu.empty() ? 0 : static_cast<int>(m_cpu.size()) - 1;
+}
@@ -1,20 +1,60 @@
 #include "ScreenModules.h"
+#include "ModuleCatalog.h"
 #include "MenuSystem.h"
 #include "DeviceInterfaces.h"
 #include "Config.h"
 #include "Logger.h"
+#include "NetworkState.h"
+#include "SwitchPortListener.h"
 #include <iostream>
 #include <unistd.h>
 #include <vector>
 #include <algorithm>
-#include <ifaddrs.h>
-#include <netinet/in.h>
+#include <cstdio>
+#include <ctime>
 #include <sys/socket.h>
-#include <sys/ioctl.h>
-#include <arpa/inet.h>
-#include <net/if.h>
-#include <string.h>
-#include <dirent.h>
+
+namespace {
+    constexpr int COLUMNS = 16;
+
+    int64_t monotonicMs() {
+        struct timespec ts;
+        clock_gettime(CLOCK_MONOTONIC, &ts);
+        return static_cast<int64_t>(ts.tv_sec) * 1000 + ts.tv_nsec / 1000000;
+    }
+
+    std::string padLine(std::string text) {
+        text.resize(COLUMNS, ' ');
+        return text;
+    }
+
+    std::string centered(const std::string& text) {
+        int pad = std::max(0, (COLUMNS - static_cast<int>(text.length())) / 2);
+        return padLine(std::string(static_cast<size_t>(pad), ' ') + text);
+    }
+
+    // Counters in at most five characters: 1234, 56k, 7M
+    // At most four characters for any 64-bit count: "9999", "999k", "18E"
+    std::string compactCount(uint64_t value) {
+        if (value < 10000) return std::to_string(value);
+        static const char suffixes[] = "kMGTPE";
+        int index = 0;
+        value /= 1000;
+        while (value >= 1000) {
+            value /= 1000;
+            index++;
+        }
+        return std::to_string(value) + suffixes[index];
+    }
+
+    std::string speedText(int speedMbps) {
+        if (speedMbps < 1000) return std::to_string(speedMbps) + "M";
+        if (speedMbps % 1000 == 0) return std::to_string(speedMbps / 1000) + "G";
+        char buffer[16];
+        snprintf(buffer, sizeof(buffer), "%.1fG", speedMbps / 1000.0);
+        return buffer;
+    }
+}
 
 // Structure to hold network interface information
 struct InterfaceInfo {
@@ -41,10 +81,20 @@ public:
     int m_scrollOffset = 0;
     // Use enum instead of static constexpr for constants
     enum { MAX_VISIBLE_ITEMS = 6 }; // Max number of items visible on screen
-    enum { REFRESH_INTERVAL = 5 };  // Refresh interval in seconds
 
-    // Timing for interface refresh
-    time_t m_lastRefreshTime = 0;
+    // NetworkState generation the list was built from
+    uint64_t m_networkGeneration = 0;
+
+    // Details: address page and switch port page, switched by rotating
+    enum { DETAIL_PAGES = 2 };
+    int m_detailPage = 0;
+    std::vector<std::string> m_detailRows;
+    int64_t m_detailRefreshedMs = 0;
+
+    // LLDP/CDP capture on every listed interface while the screen is open
+    SwitchPortListener m_listener;
+    std::vector<std::string> m_capturedInterfaces;
+    unsigned int m_neighborGeneration = 0;
 
     // State flags
     bool m_shouldExit = false;
@@ -55,14 +105,15 @@ public:
 
     // Network interface methods
     void refreshInterfaceList();
-    bool getInterfaceDetails(InterfaceInfo& interface);
-    bool checkLinkStatus(const std::string& interfaceName);
-    bool getMacAddress(const std::string& interfaceName, std::string& macAddress);
+    void updateCapture();
 
     // Drawing methods
     void renderMenu(bool fullRedraw);
     void updateSelection(int oldSelection, int newSelection);
-    void renderInterfaceDetails(int interfaceIndex);
+    void renderInterfaceDetails(int interfaceIndex, bool fullRedraw);
+    void turnDetailPage(int direction);
+    std::vector<std::string> addressPage(const InterfaceInfo& iface) const;
+    std::vector<std::string> switchPortPage(const InterfaceInfo& iface) const;
 };
 
 // Implementation of NetInfoScreen methods
@@ -78,7 +129,7 @@ NetInfoScreen::~NetInfoScreen() = default;
 
 void NetInfoScreen::enter()
 {
-    Logger::debug("NetInfoScreen: Entered");
+    LOG_DEBUG("NetInfoScreen: Entered");
 
     // Reset state
     m_pImpl->m_inSubmenu = false;
@@ -86,6 +137,7 @@ void NetInfoScreen::enter()
     m_pImpl->m_previousSelection = -1;
     m_pImpl->m_scrollOffset = 0;
     m_pImpl->m_shouldExit = false;
+    m_pImpl->m_detailPage = 0;
 
     // Get initial interface list
     m_pImpl->refreshInterfaceList();
@@ -96,9 +148,8 @@ void NetInfoScreen::enter()
 
 void NetInfoScreen::update()
 {
-    // Periodically refresh interface list
-    time_t currentTime = time(nullptr);
-    if (currentTime - m_pImpl->m_lastRefreshTime >= m_pImpl->REFRESH_INTERVAL) {
+    // Rebuild the list only when the kernel reported a link or address change
+    if (NetworkState::getInstance().getGeneration() != m_pImpl->m_networkGeneration) {
         // Save current selection
         std::string selectedName;
         if (!m_pImpl->m_interfaces.empty() && m_pImpl->m_selectedInterface >= 0 &&
@@ -124,16 +175,27 @@ void NetInfoScreen::update()
             m_pImpl->renderMenu(true);
         } else if (m_pImpl->m_selectedInterface < static_cast<int>(m_pImpl->m_interfaces.size()) - 2) {
             // Update the details screen if we're in submenu (exclude Back and Main Menu)
-            m_pImpl->renderInterfaceDetails(m_pImpl->m_selectedInterface);
+            m_pImpl->renderInterfaceDetails(m_pImpl->m_selectedInterface, false);
         }
+    }
 
-        m_pImpl->m_lastRefreshTime = currentTime;
+    // Details follow new advertisements at once, counters and ages once a period
+    if (m_pImpl->m_inSubmenu) {
+        unsigned int neighborGeneration = m_pImpl->m_listener.getGeneration();
+        if (neighborGeneration != m_pImpl->m_neighborGeneration ||
+            monotonicMs() - m_pImpl->m_detailRefreshedMs >= Config::NETINFO_COUNTERS_REFRESH_MS) {
+            m_pImpl->m_neighborGeneration = neighborGeneration;
+            m_pImpl->renderInterfaceDetails(m_pImpl->m_selectedInterface, false);
+        }
     }
 }
 
 void NetInfoScreen::exit()
 {
-    Logger::debug("NetInfoScreen: Exiting");
+    LOG_DEBUG("NetInfoScreen: Exiting");
+
+    m_pImpl->m_listener.stop();
+    m_pImpl->m_capturedInterfaces.clear();
 
     // Clear display
     m_display->clear();
@@ -176,11 +238,16 @@ bool NetInfoScreen::handleInput()
                 } else {
                     // Interface selected - show details
                     m_pImpl->m_inSubmenu = true;
-                    m_pImpl->renderInterfaceDetails(m_pImpl->m_selectedInterface);
+                    m_pImpl->renderInterfaceDetails(m_pImpl->m_selectedInterface, true);
                 }
             }
         }
 
+        // Rotation in the details switches pages
+        if (m_pImpl->m_inSubmenu && rotationDirection != 0) {
+            m_pImpl->turnDetailPage(rotationDirection);
+        }
+
         // Handle rotation
         if (!m_pImpl->m_inSubmenu && rotationDirection != 0) {
             int oldSelection = m_pImpl->m_selectedInterface;
@@ -215,60 +282,33 @@ void NetInfoScreen::Impl::refreshInterfaceList()
     // Clear existing interfaces
     m_interfaces.clear();
 
-    // Get network interfaces
-    struct ifaddrs *ifaddr, *ifa;
-
-    if (getifaddrs(&ifaddr) == -1) {
-        Logger::error("Failed to get interface addresses");
-
-        // Add "Back" option even if we failed
-        InterfaceInfo backOption;
-        backOption.name = "Back";
-        m_interfaces.push_back(backOption);
-
-        return;
-    }
-
-    // Find all interfaces
-    for (ifa = ifaddr; ifa != nullptr; ifa = ifa->ifa_next) {
-        if (ifa->ifa_addr == nullptr)
-            continue;
+    // Read the cached snapshot; no syscalls per interface
+    NetworkState& network = NetworkState::getInstance();
+    m_networkGeneration = network.getGeneration();
 
+    for (const auto& link : network.getInterfaces()) {
         // Skip loopback interfaces
-        if (ifa->ifa_flags & IFF_LOOPBACK)
-            continue;
-
-        // Check if we already have this interface
-        bool found = false;
-        for (const auto& iface : m_interfaces) {
-            if (iface.name == ifa->ifa_name) {
-                found = true;
-                break;
-            }
-        }
-
-        if (found)
+        if (link.isLoopback())
             continue;
 
         // Create new interface info
         InterfaceInfo iface;
-        iface.name = ifa->ifa_name;
-        iface.linkUp = checkLinkStatus(iface.name);
-
-        // Get MAC and populate initial values
-        getMacAddress(iface.name, iface.macAddress);
+        iface.name = link.name;
+        iface.linkUp = link.operUp;
+        iface.macAddress = link.hasMac ? link.macString(false) : "";
         iface.ipAddress = "<no ip>";
         iface.netmask = "<no netmask>";
 
-        // Try to fill in more details
-        getInterfaceDetails(iface);
+        const NetworkState::Address* address = link.firstAddress(AF_INET);
+        if (address) {
+            iface.ipAddress = address->address;
+            iface.netmask = NetworkState::netmaskFromPrefix(address->prefixLength);
+        }
 
         // Add to list
         m_interfaces.push_back(iface);
     }
 
-    freeifaddrs(ifaddr);
-
     // Add "Back" and "Main Menu" options
     InterfaceInfo backOption;
     backOption.name = "Back";
@@ -280,99 +320,21 @@ void NetInfoScreen::Impl::refreshInterfaceList()
     mainMenuOption.linkUp = false;  // Explicitly set to prevent garbage values
     m_interfaces.push_back(mainMenuOption);
 
-    // Set last refresh time
-    m_lastRefreshTime = time(nullptr);
-
-    Logger::debug("Found " + std::to_string(m_interfaces.size() - 1) + " network interfaces");
-}
-
-bool NetInfoScreen::Impl::getInterfaceDetails(InterfaceInfo& interface)
-{
-    struct ifaddrs *ifaddr, *ifa;
-    char addrStr[INET_ADDRSTRLEN];
-
-    if (getifaddrs(&ifaddr) == -1) {
-        return false;
-    }
-
-    // Find matching interface
-    for (ifa = ifaddr; ifa != nullptr; ifa = ifa->ifa_next) {
-        if (ifa->ifa_addr == nullptr || ifa->ifa_name == nullptr)
-            continue;
-
-        if (strcmp(ifa->ifa_name, interface.name.c_str()) != 0)
-            continue;
-
-        // Found a match
-        if (ifa->ifa_addr->sa_family == AF_INET) {
-            // IPv4 address
-            struct sockaddr_in *addr = (struct sockaddr_in *)ifa->ifa_addr;
-            struct sockaddr_in *mask = (struct sockaddr_in *)ifa->ifa_netmask;
-
-            // Get IP address
-            inet_ntop(AF_INET, &addr->sin_addr, addrStr, sizeof(addrStr));
-            interface.ipAddress = addrStr;
-
-            // Get netmask
-            inet_ntop(AF_INET, &mask->sin_addr, addrStr, sizeof(addrStr));
-            interface.netmask = addrStr;
-
-            break;
-        }
-    }
-
-    freeifaddrs(ifaddr);
-    return true;
-}
-
-bool NetInfoScreen::Impl::checkLinkStatus(const std::string& interfaceName)
-{
-    char path[64];
-    snprintf(path, sizeof(path), "/sys/class/net/%s/operstate", interfaceName.c_str());
-
-    FILE* fp = fopen(path, "r");
-    if (!fp) {
-        return false;
-    }
-
-    char buf[8];
-    bool linkUp = false;
-
-    if (fgets(buf, sizeof(buf), fp)) {
-        // "up" indicates the link is up
-        if (strncmp(buf, "up", 2) == 0) {
-            linkUp = true;
-        }
-    }
-
-    fclose(fp);
-    return linkUp;
+    LOG_DEBUG("Found " + std::to_string(m_interfaces.size() - 2) + " network interfaces");
+    updateCapture();
 }
 
-bool NetInfoScreen::Impl::getMacAddress(const std::string& interfaceName, std::string& macAddress)
+void NetInfoScreen::Impl::updateCapture()
 {
-    int fd = socket(AF_INET, SOCK_DGRAM, 0);
-    if (fd < 0) {
-        return false;
+    // Restart only when the set changes, so advertisements already heard stay
+    std::vector<std::string> names;
+    for (size_t i = 0; i + 2 < m_interfaces.size(); i++) {
+        names.push_back(m_interfaces[i].name);
     }
-
-    struct ifreq ifr;
-    memset(&ifr, 0, sizeof(ifr));
-    strncpy(ifr.ifr_name, interfaceName.c_str(), IFNAMSIZ - 1);
-
-    if (ioctl(fd, SIOCGIFHWADDR, &ifr) < 0) {
-        close(fd);
-        return false;
+    if (names != m_capturedInterfaces) {
+        m_capturedInterfaces = names;
+        m_listener.start(names);
     }
-
-    unsigned char* mac = (unsigned char*)ifr.ifr_hwaddr.sa_data;
-    char macStr[18];
-    snprintf(macStr, sizeof(macStr), "%02X%02X%02X%02X%02X%02X",
-            mac[0], mac[1], mac[2], mac[3], mac[4], mac[5]);
-
-    macAddress = macStr;
-    close(fd);
-    return true;
 }
 
 void NetInfoScreen::Impl::renderMenu(bool fullRedraw)
@@ -524,7 +486,7 @@ void NetInfoScreen::Impl::updateSelection(int oldSelection, int newSelection)
     }
 }
 
-void NetInfoScreen::Impl::renderInterfaceDetails(int interfaceIndex)
+void NetInfoScreen::Impl::renderInterfaceDetails(int interfaceIndex, bool fullRedraw)
 {
     // Ensure interface index is valid
     if (interfaceIndex < 0 || interfaceIndex >= static_cast<int>(m_interfaces.size()) - 1) {
@@ -532,58 +494,100 @@ void NetInfoScreen::Impl::renderInterfaceDetails(int interfaceIndex)
     }
 
     const InterfaceInfo& iface = m_interfaces[interfaceIndex];
+    std::vector<std::string> rows = m_detailPage == 0 ? addressPage(iface) : switchPortPage(iface);
+    m_detailRefreshedMs = monotonicMs();
 
-    // Clear display
-    m_display->clear();
-    usleep(Config::DISPLAY_CMD_DELAY * 3);
+    if (fullRedraw || m_detailRows.size() != rows.size()) {
+        m_display->clear();
+        usleep(Config::DISPLAY_CMD_DELAY * 3);
+        m_detailRows.assign(rows.size(), std::string(COLUMNS, ' '));
+    }
+
+    // Only rows that changed are sent
+    for (size_t i = 0; i < rows.size(); i++) {
+        if (rows[i] != m_detailRows[i]) {
+            m_display->drawText(0, static_cast<int>(i) * 8, rows[i]);
+            usleep(Config::DISPLAY_CMD_DELAY);
+            m_detailRows[i] = rows[i];
+        }
+    }
+}
 
-    // Draw header with interface name
-    std::string header = iface.name;
-    int headerPos = std::max(0, (16 - static_cast<int>(header.length())) / 2);
-    m_display->drawText(headerPos, 0, header);
-    usleep(Config::DISPLAY_CMD_DELAY);
+void NetInfoScreen::Impl::turnDetailPage(int direction)
+{
+    m_detailPage = (m_detailPage + (direction > 0 ? 1 : DETAIL_PAGES - 1)) % DETAIL_PAGES;
+    renderInterfaceDetails(m_selectedInterface, true);
+}
 
-    // Draw separator
-    m_display->drawText(0, 8, "----------------");
-    usleep(Config::DISPLAY_CMD_DELAY);
+std::vector<std::string> NetInfoScreen::Impl::addressPage(const InterfaceInfo& iface) const
+{
+    std::vector<std::string> rows;
+    rows.push_back(centered(iface.name));
+    rows.push_back("----------------");
 
-    // Draw link status
+    // Link state with the negotiated speed and duplex when the driver reports them
     std::string linkStatus = "Link: " + std::string(iface.linkUp ? "Up" : "Down");
-    m_display->drawText(0, 16, linkStatus);
-    usleep(Config::DISPLAY_CMD_DELAY);
-
-    // Draw IP address (centered)
-    std::string ipStr = iface.ipAddress;
-    int ipPos = std::max(0, (16 - static_cast<int>(ipStr.length())) / 2);
-    m_display->drawText(ipPos, 24, ipStr);
-    usleep(Config::DISPLAY_CMD_DELAY);
-
-    // Draw MAC address (centered)
-    std::string macStr = iface.macAddress;
-    int macPos = std::max(0, (16 - static_cast<int>(macStr.length())) / 2);
-    m_display->drawText(macPos, 32, macStr);
-    usleep(Config::DISPLAY_CMD_DELAY);
-
-    // Draw netmask (centered)
-    std::string netmaskStr = iface.netmask;
-    int netmaskPos = std::max(0, (16 - static_cast<int>(netmaskStr.length())) / 2);
-    m_display->drawText(netmaskPos, 40, netmaskStr);
-    usleep(Config::DISPLAY_CMD_DELAY);
-
-    // Draw back instruction
-    m_display->drawText(0, 48, "Press to return");
-    usleep(Config::DISPLAY_CMD_DELAY);
+    SwitchPortListener::LinkSettings settings;
+    if (iface.linkUp && SwitchPortListener::readLinkSettings(iface.name, settings) && settings.speedMbps > 0) {
+        linkStatus += " " + speedText(settings.speedMbps) + (settings.fullDuplex ? "/FD" : "/HD");
+    }
+    rows.push_back(padLine(linkStatus));
+
+    rows.push_back(centered(iface.ipAddress));
+    rows.push_back(centered(iface.macAddress));
+    rows.push_back(centered(iface.netmask));
+
+    SwitchPortListener::LinkCounters counters;
+    if (SwitchPortListener::readLinkCounters(iface.name, counters)) {
+        rows.push_back(padLine("E:" + compactCount(counters.rxErrors + counters.txErrors) +
+                               " D:" + compactCount(counters.rxDropped + counters.txDropped)));
+    } else {
+        rows.push_back(padLine(""));
+    }
+
+    rows.push_back(padLine("Press to return"));
+    return rows;
+}
+
+std::vector<std::string> NetInfoScreen::Impl::switchPortPage(const InterfaceInfo& iface) const
+{
+    SwitchPortListener::Neighbor neighbor;
+    SwitchPortListener::State state = m_listener.getNeighbor(iface.name, neighbor);
+
+    std::string status;
+    bool heard = state == SwitchPortListener::State::HEARD;
+    if (state == SwitchPortListener::State::UNAVAILABLE) {
+        status = "No capture";
+    } else if (!heard) {
+        status = "Listening...";
+    } else {
+        int64_t ageSec = (monotonicMs() - neighbor.receivedMs) / 1000;
+        bool expired = neighbor.ttlSec > 0 && ageSec > neighbor.ttlSec;
+        status = neighbor.protocol + (expired ? " expired" : " " + std::to_string(ageSec) + "s ago");
+    }
+
+    std::vector<std::string> rows;
+    rows.push_back(centered(iface.name + " port"));
+    rows.push_back("----------------");
+    rows.push_back(padLine(status));
+    rows.push_back(padLine("Switch:"));
+    rows.push_back(padLine(heard ? neighbor.switchName : "-"));
+    rows.push_back(padLine("Port: " + (heard && !neighbor.portId.empty() ? neighbor.portId : "-")));
+    rows.push_back(padLine("VLAN: " + (heard && neighbor.vlan >= 0 ? std::to_string(neighbor.vlan) : "-")));
+    rows.push_back(padLine("Press to return"));
+    return rows;
 }
 
 
 // GPIO handling methods
 void NetInfoScreen::handleGPIORotation(int direction)
 {
-    Logger::debug("NetInfoScreen::handleGPIORotation(" + std::to_string(direction) + ")");
+    LOG_DEBUG("NetInfoScreen::handleGPIORotation(" + std::to_string(direction) + ")");
 
-    // Only handle rotation if we're in the main menu (not in submenu)
+    // In the details rotation switches between the address and switch port pages
     if (m_pImpl->m_inSubmenu) {
-        Logger::debug("Ignoring rotation - in submenu");
+        m_pImpl->turnDetailPage(direction);
+        m_display->updateActivityTimestamp();
         return;
     }
 
@@ -603,7 +607,7 @@ void NetInfoScreen::handleGPIORotation(int direction)
 
     // Update display if selection changed
     if (oldSelection != m_pImpl->m_selectedInterface) {
-        Logger::debug("Selection changed from " + std::to_string(oldSelection) + " to " + std::to_string(m_pImpl->m_selectedInterface));
+        LOG_DEBUG("Selection changed from " + std::to_string(oldSelection) + " to " + std::to_string(m_pImpl->m_selectedInterface));
         m_pImpl->updateSelection(oldSelection, m_pImpl->m_selectedInterface);
     }
 
@@ -612,31 +616,31 @@ void NetInfoScreen::handleGPIORotation(int direction)
 
 bool NetInfoScreen::handleGPIOButtonPress()
 {
-    Logger::debug("NetInfoScreen::handleGPIOButtonPress()");
+    LOG_DEBUG("NetInfoScreen::handleGPIOButtonPress()");
 
     if (m_pImpl->m_inSubmenu) {
         // In submenu, go back to main menu
-        Logger::debug("In submenu - returning to main menu");
+        LOG_DEBUG("In submenu - returning to main menu");
         m_pImpl->m_inSubmenu = false;
         m_pImpl->renderMenu(true);
     } else {
         // In main menu
         if (m_pImpl->m_selectedInterface == static_cast<int>(m_pImpl->m_interfaces.size()) - 1) {
             // "Main Menu" selected - trigger callback to navigate to main menu
-            Logger::debug("Main Menu selected - triggering callback to navigate to main menu");
+            LOG_DEBUG("Main Menu selected - triggering callback to navigate to main menu");
             notifyCallback("exit_to_main_menu", "");
             m_pImpl->m_shouldExit = true;
             return false; // Exit the screen
         } else if (m_pImpl->m_selectedInterface == static_cast<int>(m_pImpl->m_interfaces.size()) - 2) {
             // "Back" selected - exit normally
-            Logger::debug("Back selected - exiting NetInfoScreen");
+            LOG_DEBUG("Back selected - exiting NetInfoScreen");
             m_pImpl->m_shouldExit = true;
             return false; // Exit the screen
         } else {
             // Interface selected - show details
-            Logger::debug("Interface selected - showing details for interface " + std::to_string(m_pImpl->m_selectedInterface));
+            LOG_DEBUG("Interface selected - showing details for interface " + std::to_string(m_pImpl->m_selectedInterface));
             m_pImpl->m_inSubmenu = true;
-            m_pImpl->renderInterfaceDetails(m_pImpl->m_selectedInterface);
+            m_pImpl->renderInterfaceDetails(m_pImpl->m_selectedInterface, true);
         }
     }
 
@@ -650,4 +654,4 @@ void NetInfoScreen::notifyCallback(const std::string& action, const std::string&
     }
 }
 
-
+MICROPANEL_REGISTER_MODULE("netinfo", NetInfoScreen);
@@ -1,10 +1,15 @@
 #include "ScreenModules.h"
+#include "ModuleCatalog.h"
 #include "MenuSystem.h"
 #include "DeviceInterfaces.h"
 #include "ModuleDependency.h"
 #include "Config.h"
 #include "Logger.h"
 #include "IPSelector.h"
+#include "NetworkState.h"
+#include "NetlinkConfigurator.h"
+#include "CommandRunner.h"
+#include "PerfCounters.h"
 #include <iostream>
 #include <unistd.h>
 #include <vector>
@@ -13,6 +18,7 @@
 #include <cstdio>
 #include <fstream>
 #include <sstream>
+#include <sys/socket.h>
 
 // Script path for network settings
 //#define NET_SETTINGS_SCRIPT "/usr/bin/dhcp-net-settings.sh"
@@ -68,6 +74,10 @@ public:
     void refreshSettings();
     void applyNetworkSettings();
     bool initNetworkSettingsFromScript();
+    bool initNetworkSettingsFromNetlink();
+    bool applyStaticSettingsNetlink(const std::string& iface, const std::string& ip,
+                                    const std::string& gateway, const std::string& netmask);
+    bool useNetlinkBackend();
     void networkFieldChanged(const std::string& ip);
     std::string getNetSettingsScriptPath();
     std::string getNetSettingsOsType();
@@ -123,6 +133,18 @@ public:
     std::shared_ptr<InputDevice> m_input;
 };
 
+// IPSelector works on zero-padded dotted quads ("192.168.001.010")
+static std::string padIpAddress(const std::string& address) {
+    unsigned int octets[4];
+    if (sscanf(address.c_str(), "%u.%u.%u.%u", &octets[0], &octets[1], &octets[2], &octets[3]) != 4) {
+        return "";
+    }
+    char padded[16];
+    snprintf(padded, sizeof(padded), "%03u.%03u.%03u.%03u",
+             octets[0] % 1000, octets[1] % 1000, octets[2] % 1000, octets[3] % 1000);
+    return padded;
+}
+
 // Callback function for IP selector changes
 static void ip_change_callback(const std::string&) {
     // This will be handled in the implementation
@@ -137,8 +159,9 @@ NetSettingsScreen::Impl::Impl(std::shared_ptr<Display> display, std::shared_ptr<
     m_gatewaySelector = std::make_unique<IPSelector>("192.168.001.001", 16, ip_change_callback);
     m_netmaskSelector = std::make_unique<IPSelector>("255.255.255.000", 16, ip_change_callback);
     
-    // Try to initialize from script
-    if (!initNetworkSettingsFromScript()) {
+    // Try to initialize from netlink or the script
+    bool initialized = useNetlinkBackend() && initNetworkSettingsFromNetlink();
+    if (!initialized && !initNetworkSettingsFromScript()) {
         Logger::info("Using default network settings");
     }
 }
@@ -158,8 +181,9 @@ bool NetSettingsScreen::Impl::initNetworkSettingsFromScript() {
     std::string iface = getNetSettingsInterface();
     std::string cmd = scriptPath + " --os=" + ostype + " --interface=" + iface;
 
-    Logger::debug("Initializing network settings from script: " + cmd);
+    LOG_DEBUG("Initializing network settings from script: " + cmd);
 
+    PerfCounters::getInstance().add(PerfCounters::Counter::CHILD_PROCESSES);
     FILE* fp = popen(cmd.c_str(), "r");
     if (!fp) {
         Logger::info("Network settings script not available, using defaults");
@@ -180,7 +204,7 @@ bool NetSettingsScreen::Impl::initNetworkSettingsFromScript() {
             line[len-1] = '\0';
         }
 
-        Logger::debug("Script output: " + std::string(line));
+        LOG_DEBUG("Script output: " + std::string(line));
 
         // Check for result status
         if (strncmp(line, "RESULT:", 7) == 0) {
@@ -232,11 +256,70 @@ bool NetSettingsScreen::Impl::initNetworkSettingsFromScript() {
         }
     }
 
-    Logger::debug("Network settings initialized from script: mode=" + 
+    LOG_DEBUG("Network settings initialized from script: mode=" + 
                   std::string((m_mode == NetworkMode::NET_MODE_STATIC) ? "static" : "dhcp"));
     return true;
 }
 
+bool NetSettingsScreen::Impl::initNetworkSettingsFromNetlink() {
+    // Current runtime state straight from the kernel; no script fork
+    std::string iface = getNetSettingsInterface();
+    NetworkState::Interface link;
+    if (!NetworkState::getInstance().getInterface(iface, link)) {
+        Logger::info("Interface " + iface + " not found via netlink, asking the script");
+        return false;
+    }
+
+    const NetworkState::Address* address = link.firstAddress(AF_INET);
+    if (!address) {
+        // Nothing to show; the script knows the configured mode
+        return false;
+    }
+
+    // A leased address has a lifetime; one set statically is permanent
+    m_mode = address->dynamic ? NetworkMode::NET_MODE_DHCP : NetworkMode::NET_MODE_STATIC;
+    m_ipSelector->setIp(padIpAddress(address->address));
+    m_netmaskSelector->setIp(padIpAddress(NetworkState::netmaskFromPrefix(address->prefixLength)));
+
+    NetlinkConfigurator configurator;
+    std::string gateway;
+    if (configurator.getDefaultGateway(iface, gateway) && !gateway.empty()) {
+        m_gatewaySelector->setIp(padIpAddress(gateway));
+    }
+
+    LOG_DEBUG("Network settings initialized from netlink: mode=" +
+                  std::string((m_mode == NetworkMode::NET_MODE_STATIC) ? "static" : "dhcp"));
+    return true;
+}
+
+bool NetSettingsScreen::Impl::applyStaticSettingsNetlink(const std::string& iface, const std::string& ip,
+                                                          const std::string& gateway, const std::string& netmask) {
+    NetlinkConfigurator configurator;
+    if (!configurator.setStaticIpv4(iface, ip, netmask, gateway)) {
+        return false;
+    }
+
+    // The script still stops the DHCP client and persists the settings; that
+    // can take seconds, so it runs in the background after the change is live
+    std::string persist = ModuleDependency::getInstance().getDependencyPath("netsettings", "persist");
+    if (persist != "false") {
+        std::string cmd = getNetSettingsScriptPath() + " --os=" + getNetSettingsOsType() + " --interface=" + iface +
+                          " --mode=static --ip=" + ip + " --gateway=" + gateway + " --netmask=" + netmask;
+        CommandRunner& runner = CommandRunner::getInstance();
+        runner.invalidate(cmd);
+        runner.request(cmd, 0, 0);
+        LOG_DEBUG("Persisting static settings in the background: " + cmd);
+    }
+    return true;
+}
+
+bool NetSettingsScreen::Impl::useNetlinkBackend() {
+    // "script" (default) runs action_script for everything; "netlink" applies
+    // static settings natively and keeps the script for DHCP
+    std::string backend = ModuleDependency::getInstance().getDependencyPath("netsettings", "backend");
+    return backend == "netlink";
+}
+
 void NetSettingsScreen::Impl::networkFieldChanged(const std::string&) {
     m_settingsChanged = true;
     m_settingsApplied = false;
@@ -248,9 +331,10 @@ void NetSettingsScreen::Impl::refreshSettings() {
     std::string currentGateway = m_gatewaySelector->getIp();
     std::string currentNetmask = m_netmaskSelector->getIp();
 
-    // Refresh network settings from the script
-    Logger::debug("Refreshing network settings from script");
-    if (!initNetworkSettingsFromScript()) {
+    // Refresh network settings from netlink or the script
+    LOG_DEBUG("Refreshing network settings");
+    bool refreshed = useNetlinkBackend() && initNetworkSettingsFromNetlink();
+    if (!refreshed && !initNetworkSettingsFromScript()) {
         Logger::warning("Failed to refresh network settings, using current values");
         // If script failed, restore previous values
         m_ipSelector->setIp(currentIp);
@@ -268,7 +352,13 @@ void NetSettingsScreen::Impl::applyNetworkSettings() {
     std::string iface  = getNetSettingsInterface();
     FILE* fp = nullptr;
 
-    if (m_mode == NetworkMode::NET_MODE_STATIC) {
+    if (m_mode == NetworkMode::NET_MODE_STATIC && useNetlinkBackend()) {
+        // Applied over rtnetlink; the result is known as soon as the kernel acks
+        success = applyStaticSettingsNetlink(iface, m_ipSelector->getIp(), m_gatewaySelector->getIp(),
+                                             m_netmaskSelector->getIp());
+        LOG_DEBUG("Applied static IP settings via netlink");
+    }
+    else if (m_mode == NetworkMode::NET_MODE_STATIC) {
         // Get current IP values from selectors
         const std::string& ip = m_ipSelector->getIp();
         const std::string& netmask = m_netmaskSelector->getIp();
@@ -279,9 +369,10 @@ void NetSettingsScreen::Impl::applyNetworkSettings() {
                 "%s --os=%s --interface=%s --mode=static --ip=%s --gateway=%s --netmask=%s",
                 scriptPath.c_str(), ostype.c_str(),iface.c_str(),ip.c_str(), gateway.c_str(), netmask.c_str());
 
-        Logger::debug("Running command: " + std::string(cmd));
+        LOG_DEBUG("Running command: " + std::string(cmd));
 
         // Execute the command and check result
+        PerfCounters::getInstance().add(PerfCounters::Counter::CHILD_PROCESSES);
         fp = popen(cmd, "r");
         if (!fp) {
             Logger::error("Failed to run dhcp-net-settings.sh");
@@ -297,7 +388,7 @@ void NetSettingsScreen::Impl::applyNetworkSettings() {
                 line[len-1] = '\0';
             }
 
-            Logger::debug("Script output: " + std::string(line));
+            LOG_DEBUG("Script output: " + std::string(line));
 
             // Check for result status
             if (strncmp(line, "RESULT:", 7) == 0) {
@@ -307,18 +398,19 @@ void NetSettingsScreen::Impl::applyNetworkSettings() {
             }
         }
 
-        Logger::debug("Applied static IP settings:");
-        Logger::debug("  IP: " + ip);
-        Logger::debug("  Netmask: " + netmask);
-        Logger::debug("  Gateway: " + gateway);
+        LOG_DEBUG("Applied static IP settings:");
+        LOG_DEBUG("  IP: " + ip);
+        LOG_DEBUG("  Netmask: " + netmask);
+        LOG_DEBUG("  Gateway: " + gateway);
     }
     else {
         // DHCP mode - simpler command
         snprintf(cmd, sizeof(cmd), "%s --os=%s --interface=%s --mode=dhcp", scriptPath.c_str(),ostype.c_str(),iface.c_str());//NET_SETTINGS_SCRIPT);
 
-        Logger::debug("Running command: " + std::string(cmd));
+        LOG_DEBUG("Running command: " + std::string(cmd));
 
         // Execute the command and check result
+        PerfCounters::getInstance().add(PerfCounters::Counter::CHILD_PROCESSES);
         fp = popen(cmd, "r");
         if (!fp) {
             Logger::error("Failed to run dhcp-net-settings.sh");
@@ -334,7 +426,7 @@ void NetSettingsScreen::Impl::applyNetworkSettings() {
                 line[len-1] = '\0';
             }
 
-            Logger::debug("Script output: " + std::string(line));
+            LOG_DEBUG("Script output: " + std::string(line));
 
             // Check for result status
             if (strncmp(line, "RESULT:", 7) == 0) {
@@ -344,7 +436,7 @@ void NetSettingsScreen::Impl::applyNetworkSettings() {
             }
         }
 
-        Logger::debug("Applied DHCP configuration");
+        LOG_DEBUG("Applied DHCP configuration");
     }
 
     if (fp) {
@@ -355,7 +447,7 @@ void NetSettingsScreen::Impl::applyNetworkSettings() {
     if (success) {
         m_settingsChanged = false;
         m_settingsApplied = true;
-        Logger::debug("Network settings applied successfully");
+        LOG_DEBUG("Network settings applied successfully");
     } else {
         m_settingsApplied = false;
         Logger::error("Failed to apply network settings");
@@ -908,7 +1000,7 @@ NetSettingsScreen::NetSettingsScreen(std::shared_ptr<Display> display, std::shar
 NetSettingsScreen::~NetSettingsScreen() = default;
 
 void NetSettingsScreen::enter() {
-    Logger::debug("NetSettingsScreen: Entered");
+    LOG_DEBUG("NetSettingsScreen: Entered");
     
     // Reset state
     m_pImpl->m_menuState = NetSettingsMenuState::MENU_MAIN;
@@ -955,7 +1047,7 @@ void NetSettingsScreen::update() {
 }
 
 void NetSettingsScreen::exit() {
-    Logger::debug("NetSettingsScreen: Exiting");
+    LOG_DEBUG("NetSettingsScreen: Exiting");
     
     // Clear display
     m_display->clear();
@@ -1157,11 +1249,11 @@ std::string NetSettingsScreen::Impl::getNetSettingsScriptPath() {
     std::string scriptPath = dependencies.getDependencyPath("netsettings", "action_script");
     
     if (scriptPath.empty()) {
-        Logger::debug("No action_script dependency found for netsettings, using default path");
+        LOG_DEBUG("No action_script dependency found for netsettings, using default path");
         return defaultPath;
     }
     
-    Logger::debug("Using script path from dependencies: " + scriptPath);
+    LOG_DEBUG("Using script path from dependencies: " + scriptPath);
     return scriptPath;
 }
 std::string NetSettingsScreen::Impl::getNetSettingsOsType() {
@@ -1172,10 +1264,10 @@ std::string NetSettingsScreen::Impl::getNetSettingsOsType() {
     std::string osType = dependencies.getDependencyPath("netsettings", "os_type");
 
     if (osType.empty()) {
-        Logger::debug("No os_type dependency found for netsettings, using default debian os_type");
+        LOG_DEBUG("No os_type dependency found for netsettings, using default debian os_type");
         return defaultOs;
     }
-    Logger::debug("Using os_type from dependencies: " + osType);
+    LOG_DEBUG("Using os_type from dependencies: " + osType);
     return osType;
 }
 std::string NetSettingsScreen::Impl::getNetSettingsInterface() {
@@ -1186,10 +1278,10 @@ std::string NetSettingsScreen::Impl::getNetSettingsInterface() {
     std::string interfaceName = dependencies.getDependencyPath("netsettings", "iface_name");
 
     if(interfaceName.empty()) {
-       Logger::debug("No iface_name dependency found for netsettings, using default eth0 interface");
+       LOG_DEBUG("No iface_name dependency found for netsettings, using default eth0 interface");
        return defaultInterface;
     }
-    Logger::debug("Using iface_name from dependencies: " + interfaceName);
+    LOG_DEBUG("Using iface_name from dependencies: " + interfaceName);
     return interfaceName;
 }
 
@@ -1384,3 +1476,5 @@ bool NetSettingsScreen::handleGPIOButtonPress() {
     m_display->updateActivityTimestamp();
     return result;
 }
+
+MICROPANEL_REGISTER_MODULE("netsettings", NetSettingsScreen);
@@ -0,0 +1,443 @@
+#include "NetlinkConfigurator.h"
+#include "Logger.h"
+#include <cerrno>
+#include <cstring>
+#include <vector>
+#include <arpa/inet.h>
+#include <linux/netlink.h>
+#include <linux/rtnetlink.h>
+#include <net/if.h>
+#include <sys/socket.h>
+#include <sys/time.h>
+#include <unistd.h>
+
+namespace {
+    constexpr int REPLY_TIMEOUT_MS = 1000;
+    constexpr size_t REQUEST_SIZE = 256;
+    constexpr size_t RECEIVE_BUFFER = 32 * 1024;
+
+    struct LinkRequest {
+        struct nlmsghdr header;
+        struct ifinfomsg info;
+    };
+
+    struct AddressRequest {
+        struct nlmsghdr header;
+        struct ifaddrmsg info;
+        char attributes[REQUEST_SIZE];
+    };
+
+    struct RouteRequest {
+        struct nlmsghdr header;
+        struct rtmsg info;
+        char attributes[REQUEST_SIZE];
+    };
+
+    void addAttribute(struct nlmsghdr* header, int type, const void* data, size_t length)
+    {
+        struct rtattr* attribute = reinterpret_cast<struct rtattr*>(
+            reinterpret_cast<char*>(header) + NLMSG_ALIGN(header->nlmsg_len));
+        attribute->rta_type = type;
+        attribute->rta_len = RTA_LENGTH(length);
+        std::memcpy(RTA_DATA(attribute), data, length);
+        header->nlmsg_len = NLMSG_ALIGN(header->nlmsg_len) + RTA_ALIGN(attribute->rta_len);
+    }
+
+    bool parseIpv4(const std::string& text, uint32_t& address)
+    {
+        // IPSelector hands out zero-padded octets ("192.168.001.010"), which
+        // inet_pton rejects; parse the four numbers ourselves
+        unsigned int octets[4];
+        char trailing;
+        if (sscanf(text.c_str(), "%u.%u.%u.%u%c", &octets[0], &octets[1], &octets[2], &octets[3], &trailing) != 4) {
+            return false;
+        }
+        uint32_t value = 0;
+        for (unsigned int octet : octets) {
+            if (octet > 255) return false;
+            value = (value << 8) | octet;
+        }
+        address = htonl(value);
+        return true;
+    }
+}
+
+NetlinkConfigurator::NetlinkConfigurator()
+{
+}
+
+NetlinkConfigurator::~NetlinkConfigurator()
+{
+    if (m_fd >= 0) {
+        close(m_fd);
+    }
+}
+
+bool NetlinkConfigurator::fail(const std::string& message)
+{
+    m_lastError = message;
+    Logger::error("NetlinkConfigurator: " + message);
+    return false;
+}
+
+bool NetlinkConfigurator::open()
+{
+    if (m_fd >= 0) {
+        return true;
+    }
+    m_fd = socket(AF_NETLINK, SOCK_RAW | SOCK_CLOEXEC, NETLINK_ROUTE);
+    if (m_fd < 0) {
+        return fail(std::string("netlink socket: ") + strerror(errno));
+    }
+    struct timeval timeout;
+    timeout.tv_sec = REPLY_TIMEOUT_MS / 1000;
+    timeout.tv_usec = (REPLY_TIMEOUT_MS % 1000) * 1000;
+    setsockopt(m_fd, SOL_SOCKET, SO_RCVTIMEO, &timeout, sizeof(timeout));
+    return true;
+}
+
+int NetlinkConfigurator::interfaceIndex(const std::string& interfaceName)
+{
+    int index = static_cast<int>(if_nametoindex(interfaceName.c_str()));
+    if (index == 0) {
+        fail("no interface " + interfaceName);
+    }
+    return index;
+}
+
+bool NetlinkConfigurator::transact(void* request, uint32_t length)
+{
+    if (!open()) {
+        return false;
+    }
+
+    m_lastErrno = 0;
+    struct nlmsghdr* header = static_cast<struct nlmsghdr*>(request);
+    header->nlmsg_flags |= NLM_F_REQUEST | NLM_F_ACK;
+    header->nlmsg_seq = ++m_seq;
+    if (send(m_fd, request, length, 0) < 0) {
+        return fail(std::string("netlink send: ") + strerror(errno));
+    }
+
+    std::vector<char> buffer(RECEIVE_BUFFER);
+    for (;;) {
+        ssize_t received = recv(m_fd, buffer.data(), buffer.size(), 0);
+        if (received < 0) {
+            if (errno == EINTR) continue;
+            return fail(std::string("netlink reply: ") + strerror(errno));
+        }
+
+        size_t remaining = static_cast<size_t>(received);
+        for (struct nlmsghdr* reply = reinterpret_cast<struct nlmsghdr*>(buffer.data());
+             NLMSG_OK(reply, remaining); reply = NLMSG_NEXT(reply, remaining)) {
+            if (reply->nlmsg_seq != header->nlmsg_seq || reply->nlmsg_type != NLMSG_ERROR) {
+                continue;
+            }
+            const struct nlmsgerr* error = static_cast<const struct nlmsgerr*>(NLMSG_DATA(reply));
+            if (error->error != 0) {
+                // Left to the caller to log; some errors are expected
+                m_lastErrno = -error->error;
+                m_lastError = strerror(m_lastErrno);
+                return false;
+            }
+            return true;
+        }
+    }
+}
+
+bool NetlinkConfigurator::dump(void* request, uint32_t length,
+                               const std::function<void(const void*, size_t)>& handler)
+{
+    if (!open()) {
+        return false;
+    }
+
+    struct nlmsghdr* header = static_cast<struct nlmsghdr*>(request);
+    header->nlmsg_flags |= NLM_F_REQUEST | NLM_F_DUMP;
+    header->nlmsg_seq = ++m_seq;
+    if (send(m_fd, request, length, 0) < 0) {
+        return fail(std::string("netlink send: ") + strerror(errno));
+    }
+
+    std::vector<char> buffer(RECEIVE_BUFFER);
+    for (;;) {
+        ssize_t received = recv(m_fd, buffer.data(), buffer.size(), 0);
+        if (received < 0) {
+            if (errno == EINTR) continue;
+            return fail(std::string("netlink dump: ") + strerror(errno));
+        }
+
+        size_t remaining = static_cast<size_t>(received);
+        for (struct nlmsghdr* reply = reinterpret_cast<struct nlmsghdr*>(buffer.data());
+             NLMSG_OK(reply, remaining); reply = NLMSG_NEXT(reply, remaining)) {
+            if (reply->nlmsg_seq != header->nlmsg_seq) {
+                continue;
+            }
+            if (reply->nlmsg_type == NLMSG_DONE) {
+                return true;
+            }
+            if (reply->nlmsg_type == NLMSG_ERROR) {
+                const struct nlmsgerr* error = static_cast<const struct nlmsgerr*>(NLMSG_DATA(reply));
+                return fail(std::string("netlink dump: ") + strerror(-error->error));
+            }
+            handler(reply, reply->nlmsg_len);
+        }
+    }
+}
+
+bool NetlinkConfigurator::setLinkUp(const std::string& interfaceName, bool up)
+{
+    int index = interfaceIndex(interfaceName);
+    if (index == 0) {
+        return false;
+    }
+
+    LinkRequest request;
+    std::memset(&request, 0, sizeof(request));
+    request.header.nlmsg_len = NLMSG_LENGTH(sizeof(struct ifinfomsg));
+    request.header.nlmsg_type = RTM_NEWLINK;
+    request.info.ifi_family = AF_UNSPEC;
+    request.info.ifi_index = index;
+    request.info.ifi_flags = up ? IFF_UP : 0;
+    request.info.ifi_change = IFF_UP;
+    if (!transact(&request, request.header.nlmsg_len)) {
+        return fail("link " + interfaceName + ": " + m_lastError);
+    }
+    return true;
+}
+
+bool NetlinkConfigurator::removeAddress(int index, uint32_t address, int prefixLength)
+{
+    AddressRequest request;
+    std::memset(&request, 0, sizeof(request));
+    request.header.nlmsg_len = NLMSG_LENGTH(sizeof(struct ifaddrmsg));
+    request.header.nlmsg_type = RTM_DELADDR;
+    request.info.ifa_family = AF_INET;
+    request.info.ifa_prefixlen = prefixLength;
+    request.info.ifa_index = index;
+    addAttribute(&request.header, IFA_LOCAL, &address, sizeof(address));
+    return transact(&request, request.header.nlmsg_len);
+}
+
+bool NetlinkConfigurator::removeDefaultRoute(int index, uint32_t gateway, uint32_t priority)
+{
+    RouteRequest request;
+    std::memset(&request, 0, sizeof(request));
+    request.header.nlmsg_len = NLMSG_LENGTH(sizeof(struct rtmsg));
+    request.header.nlmsg_type = RTM_DELROUTE;
+    request.info.rtm_family = AF_INET;
+    request.info.rtm_table = RT_TABLE_MAIN;
+    request.info.rtm_scope = RT_SCOPE_NOWHERE;
+    addAttribute(&request.header, RTA_OIF, &index, sizeof(index));
+    if (gateway != 0) {
+        addAttribute(&request.header, RTA_GATEWAY, &gateway, sizeof(gateway));
+    }
+    addAttribute(&request.header, RTA_PRIORITY, &priority, sizeof(priority));
+    return transact(&request, request.header.nlmsg_len);
+}
+
+bool NetlinkConfigurator::setStaticIpv4(const std::string& interfaceName, const std::string& ip,
+                                        const std::string& netmask, const std::string& gateway)
+{
+    uint32_t address = 0;
+    uint32_t router = 0;
+    int prefixLength = prefixFromNetmask(netmask);
+    if (!parseIpv4(ip, address)) {
+        return fail("invalid address " + ip);
+    }
+    if (prefixLength < 0) {
+        return fail("invalid netmask " + netmask);
+    }
+    if (!gateway.empty() && !parseIpv4(gateway, router)) {
+        return fail("invalid gateway " + gateway);
+    }
+
+    int index = interfaceIndex(interfaceName);
+    if (index == 0 || !setLinkUp(interfaceName, true)) {
+        return false;
+    }
+
+    // Collect what is there now, then change it; requests cannot be sent mid-dump
+    struct Existing {
+        uint32_t address;
+        int prefixLength;
+    };
+    std::vector<Existing> addresses;
+    AddressRequest addressDump;
+    std::memset(&addressDump, 0, sizeof(addressDump));
+    addressDump.header.nlmsg_len = NLMSG_LENGTH(sizeof(struct ifaddrmsg));
+    addressDump.header.nlmsg_type = RTM_GETADDR;
+    addressDump.info.ifa_family = AF_INET;
+    bool listed = dump(&addressDump, addressDump.header.nlmsg_len, [&](const void* message, size_t) {
+        const struct nlmsghdr* header = static_cast<const struct nlmsghdr*>(message);
+        const struct ifaddrmsg* info = static_cast<const struct ifaddrmsg*>(NLMSG_DATA(header));
+        if (static_cast<int>(info->ifa_index) != index) return;
+        int length = IFA_PAYLOAD(header);
+        for (const struct rtattr* attribute = IFA_RTA(info); RTA_OK(attribute, length);
+             attribute = RTA_NEXT(attribute, length)) {
+            if (attribute->rta_type == IFA_LOCAL && RTA_PAYLOAD(attribute) == sizeof(uint32_t)) {
+                Existing existing;
+                std::memcpy(&existing.address, RTA_DATA(attribute), sizeof(uint32_t));
+                existing.prefixLength = info->ifa_prefixlen;
+                addresses.push_back(existing);
+            }
+        }
+    });
+    if (!listed) {
+        return false;
+    }
+
+    for (const auto& existing : addresses) {
+        if (existing.address == address && existing.prefixLength == prefixLength) continue;
+        // Removing the primary can take its secondaries with it; that is fine here
+        if (!removeAddress(index, existing.address, existing.prefixLength) && m_lastErrno != EADDRNOTAVAIL) {
+            return fail("remove address: " + m_lastError);
+        }
+    }
+
+    // Replace also turns a leased copy of the same address into a permanent one
+    AddressRequest add;
+    std::memset(&add, 0, sizeof(add));
+    add.header.nlmsg_len = NLMSG_LENGTH(sizeof(struct ifaddrmsg));
+    add.header.nlmsg_type = RTM_NEWADDR;
+    add.header.nlmsg_flags = NLM_F_CREATE | NLM_F_REPLACE;
+    add.info.ifa_family = AF_INET;
+    add.info.ifa_prefixlen = prefixLength;
+    add.info.ifa_scope = RT_SCOPE_UNIVERSE;
+    add.info.ifa_index = index;
+    addAttribute(&add.header, IFA_LOCAL, &address, sizeof(address));
+    addAttribute(&add.header, IFA_ADDRESS, &address, sizeof(address));
+    if (prefixLength < 31) {
+        uint32_t hostMask = prefixLength == 0 ? 0xFFFFFFFFu : (0xFFFFFFFFu >> prefixLength);
+        uint32_t broadcast = address | htonl(hostMask);
+        addAttribute(&add.header, IFA_BROADCAST, &broadcast, sizeof(broadcast));
+    }
+    if (!transact(&add, add.header.nlmsg_len)) {
+        return fail("add address " + ip + ": " + m_lastError);
+    }
+
+    // Default routes through this interface, e.g. one a DHCP client installed
+    struct Route {
+        uint32_t gateway;
+        uint32_t priority;
+    };
+    std::vector<Route> routes;
+    RouteRequest routeDump;
+    std::memset(&routeDump, 0, sizeof(routeDump));
+    routeDump.header.nlmsg_len = NLMSG_LENGTH(sizeof(struct rtmsg));
+    routeDump.header.nlmsg_type = RTM_GETROUTE;
+    routeDump.info.rtm_family = AF_INET;
+    listed = dump(&routeDump, routeDump.header.nlmsg_len, [&](const void* message, size_t) {
+        const struct nlmsghdr* header = static_cast<const struct nlmsghdr*>(message);
+        const struct rtmsg* info = static_cast<const struct rtmsg*>(NLMSG_DATA(header));
+        if (info->rtm_dst_len != 0 || info->rtm_table != RT_TABLE_MAIN) return;
+        Route route = {0, 0};
+        int oif = 0;
+        int length = RTM_PAYLOAD(header);
+        for (const struct rtattr* attribute = RTM_RTA(info); RTA_OK(attribute, length);
+             attribute = RTA_NEXT(attribute, length)) {
+            if (RTA_PAYLOAD(attribute) != sizeof(uint32_t)) continue;
+            if (attribute->rta_type == RTA_OIF) std::memcpy(&oif, RTA_DATA(attribute), sizeof(oif));
+            if (attribute->rta_type == RTA_GATEWAY) std::memcpy(&route.gateway, RTA_DATA(attribute), sizeof(uint32_t));
+            if (attribute->rta_type == RTA_PRIORITY) std::memcpy(&route.priority, RTA_DATA(attribute), sizeof(uint32_t));
+        }
+        if (oif == index) routes.push_back(route);
+    });
+    if (!listed) {
+        return false;
+    }
+    for (const auto& route : routes) {
+        if (!removeDefaultRoute(index, route.gateway, route.priority) && m_lastErrno != ESRCH) {
+            return fail("remove default route: " + m_lastError);
+        }
+    }
+
+    if (router == 0) {
+        Logger::info("NetlinkConfigurator: " + interfaceName + " set to " + ip + "/" + std::to_string(prefixLength));
+        return true;
+    }
+
+    RouteRequest route;
+    std::memset(&route, 0, sizeof(route));
+    route.header.nlmsg_len = NLMSG_LENGTH(sizeof(struct rtmsg));
+    route.header.nlmsg_type = RTM_NEWROUTE;
+    route.header.nlmsg_flags = NLM_F_CREATE | NLM_F_REPLACE;
+    route.info.rtm_family = AF_INET;
+    route.info.rtm_table = RT_TABLE_MAIN;
+    route.info.rtm_protocol = RTPROT_STATIC;
+    route.info.rtm_scope = RT_SCOPE_UNIVERSE;
+    route.info.rtm_type = RTN_UNICAST;
+    addAttribute(&route.header, RTA_GATEWAY, &router, sizeof(router));
+    addAttribute(&route.header, RTA_OIF, &index, sizeof(index));
+    if (!transact(&route, route.header.nlmsg_len)) {
+        return fail("default route via " + gateway + ": " + m_lastError);
+    }
+
+    Logger::info("NetlinkConfigurator: " + interfaceName + " set to " + ip + "/" + std::to_string(prefixLength) +
+                 " via " + gateway);
+    return true;
+}
+
+bool NetlinkConfigurator::getDefaultGateway(const std::string& interfaceName, std::string& gateway)
+{
+    gateway.clear();
+    int index = interfaceIndex(interfaceName);
+    if (index == 0) {
+        return false;
+    }
+
+    // Lowest metric wins, as in the kernel's route selection
+    uint32_t bestPriority = 0;
+    bool found = false;
+    RouteRequest routeDump;
+    std::memset(&routeDump, 0, sizeof(routeDump));
+    routeDump.header.nlmsg_len = NLMSG_LENGTH(sizeof(struct rtmsg));
+    routeDump.header.nlmsg_type = RTM_GETROUTE;
+    routeDump.info.rtm_family = AF_INET;
+    bool listed = dump(&routeDump, routeDump.header.nlmsg_len, [&](const void* message, size_t) {
+        const struct nlmsghdr* header = static_cast<const struct nlmsghdr*>(message);
+        const struct rtmsg* info = static_cast<const struct rtmsg*>(NLMSG_DATA(header));
+        if (info->rtm_dst_len != 0 || info->rtm_table != RT_TABLE_MAIN) return;
+        uint32_t router = 0;
+        uint32_t priority = 0;
+        int oif = 0;
+        int length = RTM_PAYLOAD(header);
+        for (const struct rtattr* attribute = RTM_RTA(info); RTA_OK(attribute, length);
+             attribute = RTA_NEXT(attribute, length)) {
+            if (RTA_PAYLOAD(attribute) != sizeof(uint32_t)) continue;
+            if (attribute->rta_type == RTA_OIF) std::memcpy(&oif, RTA_DATA(attribute), sizeof(oif));
+            if (attribute->rta_type == RTA_GATEWAY) std::memcpy(&router, RTA_DATA(attribute), sizeof(uint32_t));
+            if (attribute->rta_type == RTA_PRIORITY) std::memcpy(&priority, RTA_DATA(attribute), sizeof(uint32_t));
+        }
+        if (oif != index || router == 0 || (found && priority >= bestPriority)) return;
+
+        char text[INET_ADDRSTRLEN];
+        if (inet_ntop(AF_INET, &router, text, sizeof(text))) {
+            gateway = text;
+            bestPriority = priority;
+            found = true;
+        }
+    });
+    return listed;
+}
+
+int NetlinkConfigurator::prefixFromNetmask(const std::string& netmask)
+{
+    uint32_t mask = 0;
+    if (!parseIpv4(netmask, mask)) {
+        return -1;
+    }
+    mask = ntohl(mask);
+
+    // Contiguous ones followed by zeros only
+    uint32_t inverted = ~mask;
+    if ((inverted & (inverted + 1)) != 0) {
+        return -1;
+    }
+    int prefixLength = 0;
+    while (mask & 0x80000000u) {
+        prefixLength++;
+        mask <<= 1;
+    }
+    return prefixLength;
+}
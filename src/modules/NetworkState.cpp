@@ -0,0 +1,500 @@
+#include "NetworkState.h"
+#include "Config.h"
+#include "Logger.h"
+#include <algorithm>
+#include <cerrno>
+#include <cstring>
+#include <arpa/inet.h>
+#include <ctime>
+#include <linux/if.h>
+#include <linux/neighbour.h>
+#include <linux/netlink.h>
+#include <linux/rtnetlink.h>
+#include <poll.h>
+#include <sys/socket.h>
+#include <unistd.h>
+
+namespace {
+    constexpr size_t RECEIVE_BUFFER = 32 * 1024;
+    constexpr int EVENT_POLL_MS = 250;  // Bounds shutdown latency
+
+    // Entries that name a host we can talk to; FAILED/INCOMPLETE are not
+    // answering and NOARP covers broadcast and multicast
+    constexpr uint16_t USABLE_NEIGHBOR =
+        NUD_REACHABLE | NUD_STALE | NUD_DELAY | NUD_PROBE | NUD_PERMANENT;
+}
+
+bool NetworkState::Interface::isLoopback() const
+{
+    return (flags & IFF_LOOPBACK) != 0;
+}
+
+const NetworkState::Address* NetworkState::Interface::firstAddress(int family) const
+{
+    for (const auto& address : addresses) {
+        if (address.family == family) {
+            return &address;
+        }
+    }
+    return nullptr;
+}
+
+std::string NetworkState::Interface::macString(bool separator) const
+{
+    char buffer[18];
+    snprintf(buffer, sizeof(buffer), separator ? "%02X:%02X:%02X:%02X:%02X:%02X" : "%02X%02X%02X%02X%02X%02X",
+             mac[0], mac[1], mac[2], mac[3], mac[4], mac[5]);
+    return buffer;
+}
+
+std::string NetworkState::netmaskFromPrefix(int prefixLength)
+{
+    if (prefixLength < 0) prefixLength = 0;
+    if (prefixLength > 32) prefixLength = 32;
+    uint32_t mask = prefixLength == 0 ? 0 : 0xFFFFFFFFu << (32 - prefixLength);
+    struct in_addr addr;
+    addr.s_addr = htonl(mask);
+    char buffer[INET_ADDRSTRLEN];
+    inet_ntop(AF_INET, &addr, buffer, sizeof(buffer));
+    return buffer;
+}
+
+NetworkState& NetworkState::getInstance()
+{
+    static NetworkState instance;
+    return instance;
+}
+
+NetworkState::NetworkState()
+{
+    if (!openSocket()) {
+        return;
+    }
+
+    // Populate synchronously so the first reader sees real data
+    resync();
+    m_thread = std::thread(&NetworkState::run, this);
+}
+
+NetworkState::~NetworkState()
+{
+    m_stop = true;
+    if (m_thread.joinable()) {
+        m_thread.join();
+    }
+    if (m_fd >= 0) {
+        close(m_fd);
+    }
+}
+
+bool NetworkState::openSocket()
+{
+    m_fd = socket(AF_NETLINK, SOCK_RAW | SOCK_CLOEXEC, NETLINK_ROUTE);
+    if (m_fd < 0) {
+        Logger::error(std::string("NetworkState: netlink socket: ") + strerror(errno));
+        return false;
+    }
+
+    int size = Config::NETLINK_RCVBUF_BYTES;
+    setsockopt(m_fd, SOL_SOCKET, SO_RCVBUF, &size, sizeof(size));
+
+    struct sockaddr_nl local;
+    std::memset(&local, 0, sizeof(local));
+    local.nl_family = AF_NETLINK;
+    local.nl_groups = RTMGRP_LINK | RTMGRP_IPV4_IFADDR | RTMGRP_IPV6_IFADDR | RTMGRP_NEIGH;
+    if (bind(m_fd, reinterpret_cast<struct sockaddr*>(&local), sizeof(local)) < 0) {
+        Logger::error(std::string("NetworkState: netlink bind: ") + strerror(errno));
+        close(m_fd);
+        m_fd = -1;
+        return false;
+    }
+    return true;
+}
+
+bool NetworkState::dump(int type)
+{
+    // Strict-checking kernels want a full ndmsg for neighbour dumps; its
+    // first byte is the family, as in rtgenmsg
+    struct {
+        struct nlmsghdr header;
+        struct ndmsg body;
+    } request;
+    std::memset(&request, 0, sizeof(request));
+    bool neighbors = type == RTM_GETNEIGH;
+    request.header.nlmsg_len = NLMSG_LENGTH(neighbors ? sizeof(struct ndmsg) : sizeof(struct rtgenmsg));
+    request.header.nlmsg_type = type;
+    request.header.nlmsg_flags = NLM_F_REQUEST | NLM_F_DUMP;
+    request.header.nlmsg_seq = ++m_seq;
+    request.body.ndm_family = neighbors ? AF_INET : AF_UNSPEC;
+
+    if (send(m_fd, &request, request.header.nlmsg_len, 0) < 0) {
+        Logger::error(std::string("NetworkState: netlink dump request: ") + strerror(errno));
+        return false;
+    }
+
+    // Change events may be interleaved with the dump; they are applied in order
+    bool done = false;
+    int waited = 0;
+    while (!done && waited < Config::NETLINK_DUMP_TIMEOUT_MS) {
+        if (!receive(EVENT_POLL_MS, request.header.nlmsg_seq, done)) {
+            return false;
+        }
+        waited += EVENT_POLL_MS;
+    }
+    if (!done) {
+        Logger::warning("NetworkState: netlink dump timed out");
+    }
+    return done;
+}
+
+bool NetworkState::receive(int timeoutMs, uint32_t dumpSeq, bool& dumpDone)
+{
+    struct pollfd pfd = {m_fd, POLLIN, 0};
+    int ready = ::poll(&pfd, 1, timeoutMs);
+    if (ready <= 0) {
+        return true;
+    }
+
+    static thread_local char buffer[RECEIVE_BUFFER];
+    for (;;) {
+        ssize_t length = recv(m_fd, buffer, sizeof(buffer), MSG_DONTWAIT);
+        if (length < 0) {
+            if (errno == EINTR) continue;
+            if (errno == EAGAIN || errno == EWOULDBLOCK) break;
+            if (errno == ENOBUFS) {
+                // Events were dropped; the snapshot can no longer be trusted
+                Logger::warning("NetworkState: netlink buffer overrun, resynchronising");
+                return false;
+            }
+            Logger::error(std::string("NetworkState: netlink recv: ") + strerror(errno));
+            break;
+        }
+
+        size_t remaining = static_cast<size_t>(length);
+        for (struct nlmsghdr* header = reinterpret_cast<struct nlmsghdr*>(buffer);
+             NLMSG_OK(header, remaining); header = NLMSG_NEXT(header, remaining)) {
+            if (dumpSeq != 0 && header->nlmsg_seq == dumpSeq &&
+                (header->nlmsg_type == NLMSG_DONE || header->nlmsg_type == NLMSG_ERROR)) {
+                dumpDone = true;
+                continue;
+            }
+            handleMessage(header, header->nlmsg_len);
+        }
+    }
+
+    if ((m_changed || m_neighborsChanged) && !m_resyncing) {
+        publish();
+    }
+    return true;
+}
+
+void NetworkState::publish()
+{
+    std::lock_guard<std::mutex> lock(m_mutex);
+    if (m_changed) {
+        m_snapshot = m_interfaces;
+        m_changed = false;
+        m_generation++;
+    }
+    if (m_neighborsChanged) {
+        m_neighborSnapshot.clear();
+        m_neighborSnapshot.reserve(m_neighbors.size());
+        for (const auto& item : m_neighbors) {
+            m_neighborSnapshot.push_back(item.second);
+        }
+        m_neighborsChanged = false;
+        m_neighborGeneration++;
+    }
+}
+
+void NetworkState::handleMessage(const void* message, size_t length)
+{
+    const struct nlmsghdr* header = static_cast<const struct nlmsghdr*>(message);
+    switch (header->nlmsg_type) {
+        case RTM_NEWLINK:
+        case RTM_DELLINK:
+            handleLink(message, length, header->nlmsg_type == RTM_DELLINK);
+            break;
+        case RTM_NEWADDR:
+        case RTM_DELADDR:
+            handleAddress(message, length, header->nlmsg_type == RTM_DELADDR);
+            break;
+        case RTM_NEWNEIGH:
+        case RTM_DELNEIGH:
+            handleNeighbor(message, length, header->nlmsg_type == RTM_DELNEIGH);
+            break;
+        default:
+            break;
+    }
+}
+
+void NetworkState::handleLink(const void* message, size_t length, bool removed)
+{
+    const struct nlmsghdr* header = static_cast<const struct nlmsghdr*>(message);
+    if (length < NLMSG_LENGTH(sizeof(struct ifinfomsg))) {
+        return;
+    }
+    const struct ifinfomsg* info = static_cast<const struct ifinfomsg*>(NLMSG_DATA(header));
+
+    if (removed) {
+        if (m_interfaces.erase(info->ifi_index) > 0) {
+            m_changed = true;
+        }
+        return;
+    }
+
+    Interface updated;
+    auto existing = m_interfaces.find(info->ifi_index);
+    if (existing != m_interfaces.end()) {
+        updated = existing->second;
+    }
+    updated.index = info->ifi_index;
+    updated.flags = info->ifi_flags;
+
+    int attributesLength = IFLA_PAYLOAD(header);
+    for (const struct rtattr* attribute = IFLA_RTA(info); RTA_OK(attribute, attributesLength);
+         attribute = RTA_NEXT(attribute, attributesLength)) {
+        const void* data = RTA_DATA(attribute);
+        size_t dataLength = RTA_PAYLOAD(attribute);
+        switch (attribute->rta_type) {
+            case IFLA_IFNAME:
+                updated.name.assign(static_cast<const char*>(data), strnlen(static_cast<const char*>(data), dataLength));
+                break;
+            case IFLA_ADDRESS:
+                if (dataLength == sizeof(updated.mac)) {
+                    std::memcpy(updated.mac, data, sizeof(updated.mac));
+                    updated.hasMac = true;
+                }
+                break;
+            case IFLA_OPERSTATE:
+                updated.operUp = dataLength >= 1 && *static_cast<const uint8_t*>(data) == IF_OPER_UP;
+                break;
+            default:
+                break;
+        }
+    }
+
+    // Wireless drivers send frequent link messages that change nothing visible
+    if (existing != m_interfaces.end()) {
+        const Interface& previous = existing->second;
+        if (previous.name == updated.name && previous.flags == updated.flags && previous.operUp == updated.operUp &&
+            previous.hasMac == updated.hasMac && std::memcmp(previous.mac, updated.mac, sizeof(updated.mac)) == 0) {
+            return;
+        }
+    }
+    m_interfaces[info->ifi_index] = updated;
+    m_changed = true;
+}
+
+void NetworkState::handleAddress(const void* message, size_t length, bool removed)
+{
+    const struct nlmsghdr* header = static_cast<const struct nlmsghdr*>(message);
+    if (length < NLMSG_LENGTH(sizeof(struct ifaddrmsg))) {
+        return;
+    }
+    const struct ifaddrmsg* info = static_cast<const struct ifaddrmsg*>(NLMSG_DATA(header));
+    if (info->ifa_family != AF_INET && info->ifa_family != AF_INET6) {
+        return;
+    }
+
+    auto interface = m_interfaces.find(static_cast<int>(info->ifa_index));
+    if (interface == m_interfaces.end()) {
+        return;
+    }
+
+    // IFA_LOCAL is the interface's own address; IFA_ADDRESS is the peer on point-to-point links
+    const void* local = nullptr;
+    const void* address = nullptr;
+    int attributesLength = IFA_PAYLOAD(header);
+    for (const struct rtattr* attribute = IFA_RTA(info); RTA_OK(attribute, attributesLength);
+         attribute = RTA_NEXT(attribute, attributesLength)) {
+        if (attribute->rta_type == IFA_LOCAL) {
+            local = RTA_DATA(attribute);
+        } else if (attribute->rta_type == IFA_ADDRESS) {
+            address = RTA_DATA(attribute);
+        }
+    }
+    const void* raw = local ? local : address;
+    if (!raw) {
+        return;
+    }
+
+    char text[INET6_ADDRSTRLEN];
+    if (!inet_ntop(info->ifa_family, raw, text, sizeof(text))) {
+        return;
+    }
+
+    // Addresses with a finite lifetime were handed out by DHCP/SLAAC
+    bool dynamic = (info->ifa_flags & IFA_F_PERMANENT) == 0;
+
+    std::vector<Address>& addresses = interface->second.addresses;
+    for (auto it = addresses.begin(); it != addresses.end(); ++it) {
+        if (it->family == info->ifa_family && it->address == text) {
+            if (removed) {
+                addresses.erase(it);
+                m_changed = true;
+            } else if (it->prefixLength != info->ifa_prefixlen || it->dynamic != dynamic) {
+                it->prefixLength = info->ifa_prefixlen;
+                it->dynamic = dynamic;
+                m_changed = true;
+            }
+            return;
+        }
+    }
+    if (!removed) {
+        Address entry;
+        entry.family = info->ifa_family;
+        entry.address = text;
+        entry.prefixLength = info->ifa_prefixlen;
+        entry.dynamic = dynamic;
+        addresses.push_back(entry);
+        m_changed = true;
+    }
+}
+
+void NetworkState::handleNeighbor(const void* message, size_t length, bool removed)
+{
+    const struct nlmsghdr* header = static_cast<const struct nlmsghdr*>(message);
+    if (length < NLMSG_LENGTH(sizeof(struct ndmsg))) {
+        return;
+    }
+    const struct ndmsg* info = static_cast<const struct ndmsg*>(NLMSG_DATA(header));
+    if (info->ndm_family != AF_INET) {
+        return;
+    }
+
+    Neighbor updated;
+    updated.interfaceIndex = info->ndm_ifindex;
+    updated.state = info->ndm_state;
+    const struct nda_cacheinfo* cache = nullptr;
+    int attributesLength = RTM_PAYLOAD(header);
+    for (const struct rtattr* attribute = RTM_RTA(info); RTA_OK(attribute, attributesLength);
+         attribute = RTA_NEXT(attribute, attributesLength)) {
+        const void* data = RTA_DATA(attribute);
+        size_t dataLength = RTA_PAYLOAD(attribute);
+        switch (attribute->rta_type) {
+            case NDA_DST:
+                if (dataLength == 4) {
+                    char text[INET_ADDRSTRLEN];
+                    if (inet_ntop(AF_INET, data, text, sizeof(text))) {
+                        updated.address = text;
+                    }
+                }
+                break;
+            case NDA_LLADDR:
+                if (dataLength == sizeof(updated.mac)) {
+                    std::memcpy(updated.mac, data, sizeof(updated.mac));
+                    updated.hasMac = true;
+                }
+                break;
+            case NDA_CACHEINFO:
+                if (dataLength >= sizeof(struct nda_cacheinfo)) {
+                    cache = static_cast<const struct nda_cacheinfo*>(data);
+                }
+                break;
+            default:
+                break;
+        }
+    }
+    if (updated.address.empty()) {
+        return;
+    }
+
+    auto key = std::make_pair(updated.interfaceIndex, updated.address);
+    if (removed || (updated.state & USABLE_NEIGHBOR) == 0) {
+        if (m_neighbors.erase(key) > 0) {
+            m_neighborsChanged = true;
+        }
+        return;
+    }
+
+    // Ages come in clock ticks. A new entry learnt from the host's own ARP
+    // has a fresh "updated" but an old "confirmed", so take the younger; after
+    // that only a confirmation counts, "updated" also moves on timer-driven
+    // REACHABLE -> STALE transitions
+    static const long ticksPerSecond = sysconf(_SC_CLK_TCK) > 0 ? sysconf(_SC_CLK_TCK) : 100;
+    int64_t now = static_cast<int64_t>(time(nullptr));
+    auto existing = m_neighbors.find(key);
+    if (cache) {
+        uint32_t age = existing == m_neighbors.end() ? std::min(cache->ndm_confirmed, cache->ndm_updated)
+                                                     : cache->ndm_confirmed;
+        updated.seen = now - static_cast<int64_t>(age / ticksPerSecond);
+    } else {
+        updated.seen = now;
+    }
+
+    // Probe/reachable flips every few seconds; only a new host, a new MAC or
+    // a newer sighting counts as a change
+    if (existing != m_neighbors.end()) {
+        const Neighbor& previous = existing->second;
+        updated.seen = std::max(updated.seen, previous.seen);
+        if (previous.hasMac == updated.hasMac && std::memcmp(previous.mac, updated.mac, sizeof(updated.mac)) == 0 &&
+            updated.seen <= previous.seen + 1) {
+            existing->second.state = updated.state;
+            return;
+        }
+    }
+    m_neighbors[key] = updated;
+    m_neighborsChanged = true;
+}
+
+void NetworkState::resync()
+{
+    // Rebuilt privately; readers keep the previous snapshot until the dump completes
+    m_resyncing = true;
+    bool complete = false;
+    for (int attempt = 0; attempt < 3 && !complete; attempt++) {
+        m_interfaces.clear();
+        m_neighbors.clear();
+        complete = dump(RTM_GETLINK) && dump(RTM_GETADDR) && dump(RTM_GETNEIGH);
+    }
+    m_resyncing = false;
+
+    if (!complete) {
+        Logger::error("NetworkState: could not read interface list from netlink");
+    }
+    m_changed = true;
+    m_neighborsChanged = true;
+    publish();
+    LOG_DEBUG("NetworkState: " + std::to_string(m_interfaces.size()) + " interfaces, " +
+              std::to_string(m_neighbors.size()) + " neighbors");
+}
+
+void NetworkState::run()
+{
+    while (!m_stop) {
+        bool unused = false;
+        if (!receive(EVENT_POLL_MS, 0, unused)) {
+            resync();
+        }
+    }
+}
+
+std::vector<NetworkState::Interface> NetworkState::getInterfaces() const
+{
+    std::lock_guard<std::mutex> lock(m_mutex);
+    std::vector<Interface> interfaces;
+    interfaces.reserve(m_snapshot.size());
+    for (const auto& item : m_snapshot) {
+        interfaces.push_back(item.second);
+    }
+    return interfaces;
+}
+
+std::vector<NetworkState::Neighbor> NetworkState::getNeighbors() const
+{
+    std::lock_guard<std::mutex> lock(m_mutex);
+    return m_neighborSnapshot;
+}
+
+bool NetworkState::getInterface(const std::string& name, Interface& interface) const
+{
+    std::lock_guard<std::mutex> lock(m_mutex);
+    for (const auto& item : m_snapshot) {
+        if (item.second.name == name) {
+            interface = item.second;
+            return true;
+        }
+    }
+    return false;
+}
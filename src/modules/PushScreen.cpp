@@ -0,0 +1,154 @@
+#include "ScreenModules.h"
+#include "MenuSystem.h"
+#include "DeviceInterfaces.h"
+#include "Config.h"
+#include "PushServer.h"
+#include "Logger.h"
+#include <algorithm>
+#include <unistd.h>
+
+namespace {
+    constexpr int ROWS = 8;
+    constexpr int BODY_ROW = 2;             // Below the title and the separator
+    constexpr int BAR_ROW = ROWS - 1;
+
+    std::string padLine(const std::string& text)
+    {
+        return text.size() >= 16 ? text.substr(0, 16) : text + std::string(16 - text.size(), ' ');
+    }
+}
+
+PushScreen::PushScreen(std::shared_ptr<Display> display, std::shared_ptr<InputDevice> input)
+    : ScreenModule(display, input)
+{
+}
+
+void PushScreen::enter()
+{
+    m_display->clear();
+    usleep(Config::DISPLAY_CMD_DELAY * 3);
+
+    if (m_channel.empty()) {
+        m_channel = m_id;
+    }
+    m_scroll = 0;
+    m_drawn = false;
+    m_frameShown = false;
+    m_drawnRows.assign(ROWS, std::string());
+    m_drawnProgress = -1;
+    update();
+}
+
+void PushScreen::update()
+{
+    // Module loops that do not run the main event loop still see new pushes
+    PushServer& push = PushServer::getInstance();
+    push.poll();
+
+    const PushServer::Content* content = push.find(m_channel);
+    uint64_t generation = content ? content->generation : 0;
+    if (m_drawn && generation == m_drawnGeneration) {
+        return;
+    }
+    m_drawn = true;
+    m_drawnGeneration = generation;
+
+    if (content && content->showFrame && m_display->supportsBlit()) {
+        drawFrame(content->frame);
+    } else {
+        drawText(content);
+    }
+}
+
+void PushScreen::drawFrame(const std::vector<uint8_t>& frame)
+{
+    m_display->blit({0, MonoFrame::PAGES - 1, 0, MonoFrame::WIDTH - 1}, frame.data());
+    m_frameShown = true;
+}
+
+void PushScreen::drawText(const PushServer::Content* content)
+{
+    // A frame covered everything: start over from a blank screen
+    if (m_frameShown) {
+        m_display->clear();
+        usleep(Config::DISPLAY_CMD_DELAY * 3);
+        m_drawnRows.assign(ROWS, std::string());
+        m_drawnProgress = -1;
+        m_frameShown = false;
+    }
+
+    std::vector<std::string> rows(ROWS);
+    rows[0] = " " + (content && !content->title.empty() ? content->title : m_title);
+    rows[1] = "----------------";
+
+    int progress = content ? content->progress : -1;
+    int bodyEnd = progress >= 0 ? BAR_ROW - 1 : ROWS;
+    if (!content) {
+        rows[BODY_ROW + 1] = "Waiting for data";
+    } else if (content->showFrame) {
+        rows[BODY_ROW + 1] = "Frame received";
+        rows[BODY_ROW + 2] = "(needs bitmaps)";
+    } else {
+        int row = BODY_ROW;
+        for (size_t i = 0; i < content->lines.size() && row < bodyEnd; i++) {
+            rows[row++] = content->lines[i];
+        }
+        // Items fill the rows left over, starting at the scroll position
+        int visible = bodyEnd - row;
+        int maxScroll = std::max(0, static_cast<int>(content->items.size()) - visible);
+        m_scroll = std::min(m_scroll, maxScroll);
+        for (int i = m_scroll; i < static_cast<int>(content->items.size()) && row < bodyEnd; i++) {
+            rows[row++] = content->items[i];
+        }
+    }
+    if (progress >= 0) {
+        rows[BAR_ROW - 1] = content->progressLabel.empty() ?
+                            std::to_string(progress) + "%" : content->progressLabel;
+    }
+
+    // Only rows that changed since the last push go to the display
+    for (int row = 0; row < ROWS; row++) {
+        if (row == BAR_ROW && progress >= 0) {
+            continue;
+        }
+        std::string line = padLine(rows[row]);
+        if (line != m_drawnRows[row]) {
+            m_display->drawText(0, row * 8, line);
+            usleep(Config::DISPLAY_CMD_DELAY);
+            m_drawnRows[row] = line;
+        }
+    }
+    if (progress >= 0 && progress != m_drawnProgress) {
+        m_display->drawProgressBar(0, BAR_ROW * 8, MonoFrame::WIDTH, 8, progress);
+        usleep(Config::DISPLAY_CMD_DELAY);
+        m_drawnRows[BAR_ROW].clear();   // Text drawn here later must overwrite the bar
+    }
+    m_drawnProgress = progress;
+}
+
+void PushScreen::exit()
+{
+    m_display->clear();
+    usleep(Config::DISPLAY_CMD_DELAY * 3);
+}
+
+bool PushScreen::handleInput()
+{
+    // Same handlers as GPIO mode: rotation scrolls the items, a press exits
+    return ScreenModule::handleInput();
+}
+
+void PushScreen::handleGPIORotation(int direction)
+{
+    const PushServer::Content* content = PushServer::getInstance().find(m_channel);
+    if (!content || content->items.empty()) {
+        return;
+    }
+    int scroll = std::max(0, m_scroll + (direction > 0 ? 1 : -1));
+    if (scroll == m_scroll) {
+        return;
+    }
+    m_scroll = scroll;
+    m_drawn = false;    // drawText() clamps the scroll to the items it has
+    update();
+}
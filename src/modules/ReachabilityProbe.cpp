@@ -0,0 +1,661 @@
+#include "ReachabilityProbe.h"
+#include "Config.h"
+#include "IcmpPinger.h"
+#include "Logger.h"
+#include <cerrno>
+#include <cstdlib>
+#include <cstring>
+#include <ctime>
+#include <fstream>
+#include <sstream>
+#include <poll.h>
+#include <unistd.h>
+#include <arpa/inet.h>
+#include <netinet/ip.h>
+#include <netinet/ip_icmp.h>
+#include <sys/eventfd.h>
+
+namespace {
+    constexpr int MAX_POLL_MS = 10;         // Granularity of the happy-eyeballs timers
+    constexpr uint16_t DNS_TYPE_A = 1;
+    constexpr uint16_t DNS_TYPE_AAAA = 28;
+    constexpr size_t PAYLOAD_SIZE = 16;
+
+    int64_t nowUs() {
+        struct timespec ts;
+        clock_gettime(CLOCK_MONOTONIC, &ts);
+        return static_cast<int64_t>(ts.tv_sec) * 1000000 + ts.tv_nsec / 1000;
+    }
+
+    double elapsedMs(int64_t fromUs, int64_t toUs) {
+        return (toUs - fromUs) / 1000.0;
+    }
+
+    uint16_t read16(const uint8_t* p) {
+        return static_cast<uint16_t>((p[0] << 8) | p[1]);
+    }
+
+    // Offset just past the (possibly compressed) name at pos, 0 if malformed
+    size_t skipName(const uint8_t* message, size_t length, size_t pos) {
+        while (pos < length) {
+            uint8_t label = message[pos];
+            if ((label & 0xC0) == 0xC0) {
+                return pos + 2 <= length ? pos + 2 : 0;
+            }
+            if (label == 0) {
+                return pos + 1;
+            }
+            pos += label + 1u;
+        }
+        return 0;
+    }
+
+    const char* rcodeName(int rcode) {
+        switch (rcode) {
+            case 1: return "FORMERR";
+            case 2: return "SERVFAIL";
+            case 3: return "NXDOMAIN";
+            case 5: return "REFUSED";
+            default: return "error";
+        }
+    }
+
+    const char* connectError(int error) {
+        switch (error) {
+            case ECONNREFUSED: return "refused";
+            case ENETUNREACH:
+            case EHOSTUNREACH: return "unreach";
+            case ETIMEDOUT: return "timeout";
+            default: return "fail";
+        }
+    }
+
+    // One happy-eyeballs connection attempt
+    struct Attempt {
+        int fd = -1;
+        int64_t startUs = 0;
+        bool started = false;
+        bool failed = false;
+        int error = 0;
+
+        void close() {
+            if (fd >= 0) {
+                ::close(fd);
+                fd = -1;
+            }
+        }
+    };
+
+    bool startAttempt(Attempt& attempt, int family, const void* address, int port) {
+        attempt.started = true;
+        attempt.startUs = nowUs();
+
+        struct sockaddr_storage target;
+        socklen_t targetLength;
+        std::memset(&target, 0, sizeof(target));
+        if (family == AF_INET6) {
+            auto* v6 = reinterpret_cast<struct sockaddr_in6*>(&target);
+            v6->sin6_family = AF_INET6;
+            v6->sin6_port = htons(static_cast<uint16_t>(port));
+            std::memcpy(&v6->sin6_addr, address, sizeof(v6->sin6_addr));
+            targetLength = sizeof(*v6);
+        } else {
+            auto* v4 = reinterpret_cast<struct sockaddr_in*>(&target);
+            v4->sin_family = AF_INET;
+            v4->sin_port = htons(static_cast<uint16_t>(port));
+            std::memcpy(&v4->sin_addr, address, sizeof(v4->sin_addr));
+            targetLength = sizeof(*v4);
+        }
+
+        attempt.fd = socket(family, SOCK_STREAM | SOCK_NONBLOCK | SOCK_CLOEXEC, 0);
+        if (attempt.fd < 0 ||
+            (connect(attempt.fd, reinterpret_cast<struct sockaddr*>(&target), targetLength) < 0 &&
+             errno != EINPROGRESS)) {
+            attempt.error = errno;
+            attempt.failed = true;
+            attempt.close();
+            return false;
+        }
+        return true;
+    }
+}
+
+ReachabilityProbe::ReachabilityProbe()
+{
+}
+
+ReachabilityProbe::~ReachabilityProbe()
+{
+    stop();
+}
+
+std::string ReachabilityProbe::defaultGateway()
+{
+    // Iface Destination Gateway Flags RefCnt Use Metric Mask ..., addresses in host-order hex
+    std::ifstream routes("/proc/net/route");
+    std::string line;
+    std::getline(routes, line);
+
+    std::string best;
+    unsigned long bestMetric = 0;
+    while (std::getline(routes, line)) {
+        std::istringstream fields(line);
+        std::string iface, destination, gateway, flags, refcnt, use, metric, mask;
+        if (!(fields >> iface >> destination >> gateway >> flags >> refcnt >> use >> metric >> mask)) {
+            continue;
+        }
+        unsigned long flagBits = std::strtoul(flags.c_str(), nullptr, 16);
+        // RTF_UP | RTF_GATEWAY on 0.0.0.0/0
+        if (destination != "00000000" || mask != "00000000" || (flagBits & 0x3) != 0x3) {
+            continue;
+        }
+        unsigned long metricValue = std::strtoul(metric.c_str(), nullptr, 10);
+        if (best.empty() || metricValue < bestMetric) {
+            struct in_addr address;
+            address.s_addr = static_cast<in_addr_t>(std::strtoul(gateway.c_str(), nullptr, 16));
+            char text[INET_ADDRSTRLEN];
+            if (inet_ntop(AF_INET, &address, text, sizeof(text))) {
+                best = text;
+                bestMetric = metricValue;
+            }
+        }
+    }
+    return best;
+}
+
+bool ReachabilityProbe::hasNeighbor(const std::string& address)
+{
+    // IP-address HW-type Flags HW-address Mask Device
+    std::ifstream arp("/proc/net/arp");
+    std::string line;
+    std::getline(arp, line);
+
+    while (std::getline(arp, line)) {
+        std::istringstream fields(line);
+        std::string ip, type, flags;
+        if (!(fields >> ip >> type >> flags) || ip != address) {
+            continue;
+        }
+        // ATF_COM: the hardware address is resolved
+        if (std::strtoul(flags.c_str(), nullptr, 16) & 0x2) {
+            return true;
+        }
+    }
+    return false;
+}
+
+bool ReachabilityProbe::nameserver(struct sockaddr_storage& server, socklen_t& length)
+{
+    std::ifstream resolv("/etc/resolv.conf");
+    std::string line;
+    while (std::getline(resolv, line)) {
+        std::istringstream fields(line);
+        std::string keyword, address;
+        if (!(fields >> keyword >> address) || keyword != "nameserver") {
+            continue;
+        }
+
+        std::memset(&server, 0, sizeof(server));
+        auto* v4 = reinterpret_cast<struct sockaddr_in*>(&server);
+        auto* v6 = reinterpret_cast<struct sockaddr_in6*>(&server);
+        // Drop a zone index ("fe80::1%eth0"); link-local servers are rare enough
+        std::string host = address.substr(0, address.find('%'));
+        if (inet_pton(AF_INET, host.c_str(), &v4->sin_addr) == 1) {
+            v4->sin_family = AF_INET;
+            v4->sin_port = htons(53);
+            length = sizeof(*v4);
+            return true;
+        }
+        if (inet_pton(AF_INET6, host.c_str(), &v6->sin6_addr) == 1) {
+            v6->sin6_family = AF_INET6;
+            v6->sin6_port = htons(53);
+            length = sizeof(*v6);
+            return true;
+        }
+    }
+    return false;
+}
+
+std::vector<uint8_t> ReachabilityProbe::buildQuery(const std::string& name, uint16_t id, uint16_t type)
+{
+    // Header: id, RD, one question
+    std::vector<uint8_t> query = {
+        static_cast<uint8_t>(id >> 8), static_cast<uint8_t>(id), 0x01, 0x00,
+        0x00, 0x01, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00
+    };
+
+    std::istringstream labels(name);
+    std::string label;
+    while (std::getline(labels, label, '.')) {
+        if (label.empty() && labels.eof()) {
+            break;      // Trailing dot
+        }
+        if (label.empty() || label.size() > 63) {
+            return std::vector<uint8_t>();
+        }
+        query.push_back(static_cast<uint8_t>(label.size()));
+        query.insert(query.end(), label.begin(), label.end());
+    }
+    if (query.size() == 12 || query.size() > 12 + 254) {
+        return std::vector<uint8_t>();
+    }
+    query.push_back(0);
+    query.push_back(static_cast<uint8_t>(type >> 8));
+    query.push_back(static_cast<uint8_t>(type));
+    query.push_back(0x00);
+    query.push_back(0x01);      // IN
+    return query;
+}
+
+void ReachabilityProbe::start(const Options& options)
+{
+    stop();
+
+    m_wakeFd = eventfd(0, EFD_NONBLOCK | EFD_CLOEXEC);
+    if (m_wakeFd < 0) {
+        Logger::error(std::string("ReachabilityProbe: eventfd: ") + strerror(errno));
+    }
+
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        m_results.assign(ROW_FIRST_TARGET + options.targets.size(), Result());
+        m_results[ROW_GATEWAY].label = "GW";
+        m_results[ROW_DNS].label = "DNS";
+        m_results[ROW_TCP].label = "TCP";
+        for (size_t i = 0; i < options.targets.size(); i++) {
+            m_results[ROW_FIRST_TARGET + i].label = options.targets[i];
+        }
+    }
+    m_generation++;
+
+    m_stop = false;
+    m_finished = false;
+    m_thread = std::thread(&ReachabilityProbe::run, this, options);
+}
+
+void ReachabilityProbe::stop()
+{
+    if (m_thread.joinable()) {
+        m_stop = true;
+        uint64_t one = 1;
+        if (m_wakeFd >= 0 && write(m_wakeFd, &one, sizeof(one)) < 0) {
+            // Thread still notices m_stop within one poll interval
+        }
+        m_thread.join();
+    }
+    if (m_wakeFd >= 0) {
+        ::close(m_wakeFd);
+        m_wakeFd = -1;
+    }
+}
+
+std::vector<ReachabilityProbe::Result> ReachabilityProbe::getResults() const
+{
+    std::lock_guard<std::mutex> lock(m_mutex);
+    return m_results;
+}
+
+void ReachabilityProbe::publish(int row, Status status, double ms, const std::string& detail)
+{
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        Result& result = m_results[static_cast<size_t>(row)];
+        result.status = status;
+        result.ms = ms;
+        result.detail = detail;
+    }
+    m_generation++;
+}
+
+bool ReachabilityProbe::pending(int row) const
+{
+    std::lock_guard<std::mutex> lock(m_mutex);
+    return m_results[static_cast<size_t>(row)].status == Status::PENDING;
+}
+
+void ReachabilityProbe::run(Options options)
+{
+    const int64_t startUs = nowUs();
+    const int64_t deadlineUs = startUs + static_cast<int64_t>(options.timeoutMs) * 1000;
+    const int targetCount = static_cast<int>(options.targets.size());
+
+    // --- ICMP: the gateway and every target share one socket, told apart by address and seq ---
+    std::string gateway = defaultGateway();
+    if (gateway.empty()) {
+        publish(ROW_GATEWAY, Status::FAILED, 0.0, "no route");
+    }
+
+    struct Echo {
+        int row;
+        struct sockaddr_in address;
+        int64_t sentUs;
+        bool sent;
+    };
+    std::vector<Echo> echoes;
+    auto addEcho = [&](int row, const std::string& text) {
+        Echo echo = {row, {}, 0, false};
+        echo.address.sin_family = AF_INET;
+        if (!IcmpPinger::parseAddress(text, echo.address.sin_addr)) {
+            publish(row, Status::FAILED, 0.0, "bad addr");
+            return;
+        }
+        echoes.push_back(echo);
+    };
+    if (!gateway.empty()) {
+        addEcho(ROW_GATEWAY, gateway);
+    }
+    for (int i = 0; i < targetCount; i++) {
+        addEcho(ROW_FIRST_TARGET + i, options.targets[static_cast<size_t>(i)]);
+    }
+
+    bool raw = false;
+    int icmpFd = IcmpPinger::openIcmpSocket(raw);
+    uint16_t ident = static_cast<uint16_t>(getpid() ^ reinterpret_cast<uintptr_t>(this));
+    uint16_t seqBase = static_cast<uint16_t>(startUs);
+    if (icmpFd < 0) {
+        Logger::error(std::string("ReachabilityProbe: ICMP socket: ") + strerror(errno));
+        for (const Echo& echo : echoes) {
+            if (echo.row != ROW_GATEWAY) {
+                publish(echo.row, Status::FAILED, 0.0, "no socket");
+            }
+        }
+    } else {
+        for (size_t i = 0; i < echoes.size(); i++) {
+            uint8_t packet[sizeof(struct icmphdr) + PAYLOAD_SIZE];
+            std::memset(packet, 0, sizeof(packet));
+            auto* header = reinterpret_cast<struct icmphdr*>(packet);
+            header->type = ICMP_ECHO;
+            header->un.echo.id = htons(ident);
+            header->un.echo.sequence = htons(static_cast<uint16_t>(seqBase + i));
+            header->checksum = IcmpPinger::checksum(packet, sizeof(packet));
+
+            echoes[i].sentUs = nowUs();
+            echoes[i].sent = sendto(icmpFd, packet, sizeof(packet), 0,
+                                    reinterpret_cast<const struct sockaddr*>(&echoes[i].address),
+                                    sizeof(echoes[i].address)) >= 0;
+            if (!echoes[i].sent && echoes[i].row != ROW_GATEWAY) {
+                publish(echoes[i].row, Status::FAILED, 0.0, connectError(errno));
+            }
+        }
+    }
+
+    // --- DNS: A and AAAA at once, or nothing to resolve for an IP literal ---
+    bool haveV4 = false, haveV6 = false;
+    bool v4Done = false, v6Done = false;
+    int64_t v4DoneUs = 0;
+    struct in_addr v4Address{};
+    struct in6_addr v6Address{};
+    std::string dnsError = "timeout";
+    uint16_t dnsId = static_cast<uint16_t>(startUs >> 4);
+    int dnsFd = -1;
+
+    if (inet_pton(AF_INET, options.dnsName.c_str(), &v4Address) == 1) {
+        haveV4 = v4Done = v6Done = true;
+        publish(ROW_DNS, Status::SKIPPED, 0.0, "literal");
+    } else if (inet_pton(AF_INET6, options.dnsName.c_str(), &v6Address) == 1) {
+        haveV6 = v4Done = v6Done = true;
+        publish(ROW_DNS, Status::SKIPPED, 0.0, "literal");
+    } else {
+        struct sockaddr_storage server;
+        socklen_t serverLength = 0;
+        std::vector<uint8_t> queryA = buildQuery(options.dnsName, dnsId, DNS_TYPE_A);
+        std::vector<uint8_t> queryAAAA = buildQuery(options.dnsName, static_cast<uint16_t>(dnsId + 1), DNS_TYPE_AAAA);
+        if (queryA.empty()) {
+            dnsError = "bad name";
+        } else if (!nameserver(server, serverLength)) {
+            dnsError = "no server";
+        } else {
+            dnsFd = socket(server.ss_family, SOCK_DGRAM | SOCK_NONBLOCK | SOCK_CLOEXEC, 0);
+            // Connected, so only the server's answers get through
+            if (dnsFd < 0 || connect(dnsFd, reinterpret_cast<struct sockaddr*>(&server), serverLength) < 0 ||
+                send(dnsFd, queryA.data(), queryA.size(), 0) < 0 ||
+                send(dnsFd, queryAAAA.data(), queryAAAA.size(), 0) < 0) {
+                dnsError = connectError(errno);
+                if (dnsFd >= 0) {
+                    ::close(dnsFd);
+                    dnsFd = -1;
+                }
+            }
+        }
+        if (dnsFd < 0) {
+            v4Done = v6Done = true;
+        }
+    }
+    const int64_t dnsSentUs = nowUs();
+
+    Attempt attempts[2];    // [0] IPv6, [1] IPv4
+    bool tcpDone = false;
+
+    while (!m_stop) {
+        int64_t now = nowUs();
+
+        // DNS settles once both answers are in
+        if (v4Done && v6Done && pending(ROW_DNS)) {
+            publish(ROW_DNS, Status::FAILED, 0.0, dnsError);
+        }
+
+        // --- Happy eyeballs: IPv6 as soon as it is known, IPv4 after its delays ---
+        if (!tcpDone) {
+            if (haveV6 && !attempts[0].started) {
+                startAttempt(attempts[0], AF_INET6, &v6Address, options.tcpPort);
+            }
+            if (haveV4 && !attempts[1].started) {
+                bool v6Pending = attempts[0].started && !attempts[0].failed;
+                bool go;
+                if (attempts[0].started) {
+                    go = !v6Pending ||
+                         now - attempts[0].startUs >= Config::HAPPY_EYEBALLS_CONNECT_DELAY_MS * 1000LL;
+                } else {
+                    go = v6Done || now - v4DoneUs >= Config::HAPPY_EYEBALLS_RESOLUTION_DELAY_MS * 1000LL;
+                }
+                if (go) {
+                    startAttempt(attempts[1], AF_INET, &v4Address, options.tcpPort);
+                }
+            }
+
+            bool v6Out = !haveV6 || attempts[0].failed;
+            bool v4Out = !haveV4 || attempts[1].failed;
+            if (v4Done && v6Done && v6Out && v4Out) {
+                tcpDone = true;
+                if (!haveV4 && !haveV6) {
+                    publish(ROW_TCP, Status::SKIPPED, 0.0, "no addr");
+                } else {
+                    int error = attempts[1].started ? attempts[1].error : attempts[0].error;
+                    publish(ROW_TCP, Status::FAILED, 0.0, connectError(error));
+                }
+            }
+        }
+
+        // The gateway may drop pings; a resolved neighbor still means L2 is fine
+        bool othersDone = !pending(ROW_DNS) && tcpDone;
+        for (int i = 0; i < targetCount && othersDone; i++) {
+            othersDone = !pending(ROW_FIRST_TARGET + i);
+        }
+        if (othersDone && pending(ROW_GATEWAY) && hasNeighbor(gateway)) {
+            publish(ROW_GATEWAY, Status::OK, -1.0, "arp");
+        }
+        if (othersDone && !pending(ROW_GATEWAY)) {
+            break;
+        }
+        if (now >= deadlineUs) {
+            break;
+        }
+
+        // --- Wait for whichever socket has something ---
+        struct pollfd fds[5];
+        int count = 0;
+        fds[count++] = {m_wakeFd, POLLIN, 0};
+        int icmpIndex = -1, dnsIndex = -1, tcpIndex[2] = {-1, -1};
+        if (icmpFd >= 0) {
+            icmpIndex = count;
+            fds[count++] = {icmpFd, POLLIN, 0};
+        }
+        if (dnsFd >= 0) {
+            dnsIndex = count;
+            fds[count++] = {dnsFd, POLLIN, 0};
+        }
+        for (int a = 0; a < 2; a++) {
+            if (!tcpDone && attempts[a].fd >= 0) {
+                tcpIndex[a] = count;
+                fds[count++] = {attempts[a].fd, POLLOUT, 0};
+            }
+        }
+
+        int64_t waitMs = (deadlineUs - now + 999) / 1000;
+        if (waitMs > MAX_POLL_MS) waitMs = MAX_POLL_MS;
+        int ready = poll(fds, static_cast<nfds_t>(count), static_cast<int>(waitMs));
+        if (ready < 0 && errno != EINTR) {
+            Logger::error(std::string("ReachabilityProbe: poll: ") + strerror(errno));
+            break;
+        }
+        if (ready <= 0) {
+            continue;
+        }
+        int64_t receivedUs = nowUs();
+
+        if (icmpIndex >= 0 && (fds[icmpIndex].revents & POLLIN)) {
+            uint8_t buffer[1500];
+            struct sockaddr_in from;
+            socklen_t fromLength = sizeof(from);
+            ssize_t length;
+            while ((length = recvfrom(icmpFd, buffer, sizeof(buffer), MSG_DONTWAIT,
+                                      reinterpret_cast<struct sockaddr*>(&from), &fromLength)) >= 0) {
+                fromLength = sizeof(from);
+
+                // Raw sockets deliver the IP header as well
+                const uint8_t* icmp = buffer;
+                size_t icmpLength = static_cast<size_t>(length);
+                if (raw) {
+                    size_t ipHeaderLength = icmpLength ? (buffer[0] & 0x0F) * 4u : 0;
+                    if (ipHeaderLength < sizeof(struct iphdr) || icmpLength < ipHeaderLength) continue;
+                    icmp += ipHeaderLength;
+                    icmpLength -= ipHeaderLength;
+                }
+                if (icmpLength < sizeof(struct icmphdr)) continue;
+
+                struct icmphdr header;
+                std::memcpy(&header, icmp, sizeof(header));
+                if (header.type != ICMP_ECHOREPLY) continue;
+                if (raw && ntohs(header.un.echo.id) != ident) continue;
+
+                size_t index = static_cast<uint16_t>(ntohs(header.un.echo.sequence) - seqBase);
+                if (index >= echoes.size() || !echoes[index].sent ||
+                    from.sin_addr.s_addr != echoes[index].address.sin_addr.s_addr) {
+                    continue;
+                }
+                echoes[index].sent = false;     // Ignore duplicates
+                if (pending(echoes[index].row)) {
+                    publish(echoes[index].row, Status::OK, elapsedMs(echoes[index].sentUs, receivedUs), "");
+                }
+            }
+        }
+
+        if (dnsIndex >= 0 && (fds[dnsIndex].revents & (POLLIN | POLLERR))) {
+            uint8_t message[1500];
+            ssize_t length;
+            while ((length = recv(dnsFd, message, sizeof(message), MSG_DONTWAIT)) >= 0 || errno == ECONNREFUSED) {
+                if (length < 0) {
+                    // ICMP port unreachable from the server
+                    dnsError = "refused";
+                    v4Done = v6Done = true;
+                    break;
+                }
+                size_t size = static_cast<size_t>(length);
+                if (size < 12) continue;
+                uint16_t id = read16(message);
+                bool isA = id == dnsId;
+                if ((!isA && id != static_cast<uint16_t>(dnsId + 1)) || !(message[2] & 0x80)) continue;
+                if ((isA && v4Done) || (!isA && v6Done)) continue;
+
+                int rcode = message[3] & 0x0F;
+                if (rcode == 0 && pending(ROW_DNS)) {
+                    publish(ROW_DNS, Status::OK, elapsedMs(dnsSentUs, receivedUs), "");
+                } else if (rcode != 0) {
+                    dnsError = rcodeName(rcode);
+                }
+
+                // Skip the question, then take the first address of the wanted type (past any CNAMEs)
+                size_t pos = skipName(message, size, 12);
+                pos = pos ? pos + 4 : 0;
+                uint16_t answers = read16(message + 6);
+                uint16_t wanted = isA ? DNS_TYPE_A : DNS_TYPE_AAAA;
+                bool found = false;
+                for (uint16_t i = 0; rcode == 0 && pos && i < answers && !found; i++) {
+                    pos = skipName(message, size, pos);
+                    if (!pos || pos + 10 > size) break;
+                    uint16_t type = read16(message + pos);
+                    uint16_t dataLength = read16(message + pos + 8);
+                    pos += 10;
+                    if (pos + dataLength > size) break;
+                    if (type == wanted && dataLength == 4 && isA) {
+                        std::memcpy(&v4Address, message + pos, 4);
+                        found = haveV4 = true;
+                    } else if (type == wanted && dataLength == 16 && !isA) {
+                        std::memcpy(&v6Address, message + pos, 16);
+                        found = haveV6 = true;
+                    }
+                    pos += dataLength;
+                }
+
+                if (isA) {
+                    v4Done = true;
+                    v4DoneUs = receivedUs;
+                } else {
+                    v6Done = true;
+                }
+            }
+            if (v4Done && v6Done) {
+                ::close(dnsFd);
+                dnsFd = -1;
+            }
+        }
+
+        for (int a = 0; a < 2 && !tcpDone; a++) {
+            if (tcpIndex[a] < 0 || !(fds[tcpIndex[a]].revents & (POLLOUT | POLLERR | POLLHUP))) {
+                continue;
+            }
+            int error = 0;
+            socklen_t errorLength = sizeof(error);
+            if (getsockopt(attempts[a].fd, SOL_SOCKET, SO_ERROR, &error, &errorLength) < 0) {
+                error = errno;
+            }
+            if (error == 0) {
+                tcpDone = true;
+                publish(ROW_TCP, Status::OK, elapsedMs(attempts[a].startUs, receivedUs), a == 0 ? "v6" : "v4");
+            } else {
+                attempts[a].error = error;
+                attempts[a].failed = true;
+                attempts[a].close();
+            }
+        }
+    }
+
+    // Whatever is left timed out, unless the run was cut short
+    if (!m_stop) {
+        if (pending(ROW_GATEWAY)) {
+            if (hasNeighbor(gateway)) {
+                publish(ROW_GATEWAY, Status::OK, -1.0, "arp");
+            } else {
+                publish(ROW_GATEWAY, Status::FAILED, 0.0, "no ARP");
+            }
+        }
+        for (int row = ROW_DNS; row < ROW_FIRST_TARGET + targetCount; row++) {
+            if (pending(row)) {
+                publish(row, Status::FAILED, 0.0, "timeout");
+            }
+        }
+    }
+
+    attempts[0].close();
+    attempts[1].close();
+    if (dnsFd >= 0) {
+        ::close(dnsFd);
+    }
+    if (icmpFd >= 0) {
+        ::close(icmpFd);
+    }
+
+    LOG_DEBUG("ReachabilityProbe: finished in " + std::to_string(elapsedMs(startUs, nowUs())) + " ms");
+    m_finished = true;
+    m_generation++;
+}
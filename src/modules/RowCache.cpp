@@ -0,0 +1,23 @@
+#include "RowCache.h"
+#include "MenuSystem.h"
+#include <unistd.h>
+
+void RowCache::draw(int row, const std::string& text)
+{
+    std::string line = text;
+    line.resize(COLUMNS, ' ');
+    if (m_lines[row] == line) {
+        return;
+    }
+
+    m_display->drawText(0, row * 8, line);
+    usleep(Config::DISPLAY_CMD_DELAY);
+    m_lines[row] = line;
+}
+
+void RowCache::invalidate()
+{
+    for (auto& line : m_lines) {
+        line.clear();
+    }
+}
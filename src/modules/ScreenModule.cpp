@@ -3,11 +3,13 @@
 #include "DeviceInterfaces.h"
 #include "Config.h"
 #include "Logger.h"
+#include "Scheduler.h"
 #include <iostream>
 #include <unistd.h>
 #include <linux/input.h>
 #include <atomic>
 std::atomic<bool> g_signalReceived(false);
+std::function<bool()> ScreenModule::s_deviceGuard;
 void ScreenModule::run()
 {
     // Set running flag
@@ -26,12 +28,17 @@ void ScreenModule::run()
     while (m_running) {
         // Check for global signal flag
         if (g_signalReceived.load()) {
-            Logger::debug("Signal detected in screen module: " + getModuleId());
+            LOG_DEBUG("Signal detected in screen module: " + getModuleId());
             break;
         }
 
-        // Check for device disconnection
-        if (m_display->isDisconnected()) {
+        // Check for device disconnection; with a guard the module rides out a
+        // reconnect and keeps its state
+        if (s_deviceGuard) {
+            if (!s_deviceGuard()) {
+                break;
+            }
+        } else if (m_display->isDisconnected()) {
             std::cout << "Device disconnected during module execution" << std::endl;
             break;
         }
@@ -50,8 +57,14 @@ void ScreenModule::run()
             break;
         }
         
+        // This loop bypasses the EventLoop, so periodic jobs are polled here
+        Scheduler::getInstance().runDue();
+
         // Update module display if needed
         update();
+
+        // Send the composed frame in framebuffer mode
+        m_display->present();
         
         // Small delay to reduce CPU usage
         usleep(Config::MAIN_LOOP_DELAY);
@@ -75,25 +88,35 @@ bool ScreenModule::handleInput()
         return false; // Exit the module
     }
     
-    // Basic input handling - exit on button press
+    // Basic input handling - the same handlers GPIO mode calls
     if (m_input->waitForEvents(100) > 0) {
-        bool buttonPressed = false;
+        bool keepRunning = true;
         
-        m_input->processEvents(
-            [](int) {
-                // Ignore rotation events by default
-            },
-            [&]() {
-                // Button press exits by default
-                buttonPressed = true;
+        m_input->processEvents([&](const InputEvent& event) {
+            if (keepRunning && !handleInputEvent(event)) {
+                keepRunning = false;
             }
-        );
+        });
         
-        if (buttonPressed) {
-            return false; // Exit the module
-        }
+        return keepRunning;
     }
     
     return true; // Continue running
 }
+
+bool ScreenModule::handleInputEvent(const InputEvent& event)
+{
+    switch (event.type) {
+        case InputEvent::Type::ROTATE:
+        case InputEvent::Type::KEY:
+            handleGPIORotation(event.steps());
+            return true;
+        case InputEvent::Type::PRESS:
+            return handleGPIOButtonPress();
+        case InputEvent::Type::LONG_PRESS:
+            // The press itself was already delivered
+            return true;
+    }
+    return true;
+}
 //
@@ -1,9 +1,12 @@
 #include "ScreenModules.h"
+#include "ModuleCatalog.h"
 #include "MenuSystem.h"
 #include "DeviceInterfaces.h"
 #include "Config.h"
 #include "Logger.h"
 #include "ModuleDependency.h"
+#include "PerfCounters.h"
+#include "HistoryLog.h"
 #include <iostream>
 #include <fstream>
 #include <unistd.h>
@@ -14,21 +17,14 @@
 #include <chrono>
 #include <iomanip>
 #include <sstream>
+#include <algorithm>
 #include <curl/curl.h>
 
-// Callback function for CURL to write downloaded data
-static size_t WriteCallback(void *contents, size_t size, size_t nmemb, void *userp) {
-    (void)contents; 
-    size_t realsize = size * nmemb;
-    // We don't actually need to store the data, just count it
-    (*(size_t*)userp) += realsize;
-    return realsize;
-}
-
 SpeedTestScreen::SpeedTestScreen(std::shared_ptr<Display> display, std::shared_ptr<InputDevice> input)
     : ScreenModule(display, input),
       m_downloadUrl(""),
       m_uploadScript(""),
+      m_uploadUrl(""),
       m_uploadEnabled(false),
       m_downloadInProgress(false),
       m_uploadInProgress(false),
@@ -67,19 +63,45 @@ bool SpeedTestScreen::checkConfiguration() {
     
     if (!url.empty()) {
         m_downloadUrl = url;
-        Logger::debug("SpeedTestScreen: Using configured download URL from JSON: " + m_downloadUrl);
+        LOG_DEBUG("SpeedTestScreen: Using configured download URL from JSON: " + m_downloadUrl);
     } else {
         Logger::warning("SpeedTestScreen: No download_url in JSON config, using default: " + defaultUrl);
         m_downloadUrl = defaultUrl;
     }
     
+    // Parallel connections and test timing
+    m_connections = Config::SPEEDTEST_CONNECTIONS;
+    m_warmupMs = Config::SPEEDTEST_WARMUP_MS;
+    m_durationMs = Config::SPEEDTEST_DURATION_MS;
+    try {
+        std::string value = dependencies.getDependencyPath("speedtest", "connections");
+        if (!value.empty()) m_connections = std::stoi(value);
+        value = dependencies.getDependencyPath("speedtest", "warmup");
+        if (!value.empty()) m_warmupMs = static_cast<int>(std::stod(value) * 1000);
+        value = dependencies.getDependencyPath("speedtest", "duration");
+        if (!value.empty()) m_durationMs = static_cast<int>(std::stod(value) * 1000);
+    } catch (...) {
+        Logger::warning("SpeedTestScreen: Invalid connections/warmup/duration in config, using defaults");
+    }
+    m_connections = std::max(1, std::min(m_connections, Config::SPEEDTEST_MAX_CONNECTIONS));
+    LOG_DEBUG("SpeedTestScreen: " + std::to_string(m_connections) + " connections, " +
+                  std::to_string(m_warmupMs) + "ms warm-up, " + std::to_string(m_durationMs) + "ms test");
+
+    // Upload to an HTTP endpoint when one is configured, else the legacy script
+    m_uploadUrl = dependencies.getDependencyPath("speedtest", "upload_url");
+    if (!m_uploadUrl.empty()) {
+        m_uploadEnabled = true;
+        LOG_DEBUG("SpeedTestScreen: Upload testing enabled: " + m_uploadUrl);
+        return true;
+    }
+
     // Check for upload script configuration
     m_uploadScript = dependencies.getDependencyPath("speedtest", "upload_script");
     if (!m_uploadScript.empty()) {
-        Logger::debug("SpeedTestScreen: Upload script configured: " + m_uploadScript);
+        LOG_DEBUG("SpeedTestScreen: Upload script configured: " + m_uploadScript);
         if (access(m_uploadScript.c_str(), X_OK) == 0) {
             m_uploadEnabled = true;
-            Logger::debug("SpeedTestScreen: Upload testing enabled");
+            LOG_DEBUG("SpeedTestScreen: Upload testing enabled");
         } else {
             Logger::warning("SpeedTestScreen: Upload script not executable: " + m_uploadScript);
             m_uploadEnabled = false;
@@ -90,7 +112,7 @@ bool SpeedTestScreen::checkConfiguration() {
 }
 
 void SpeedTestScreen::enter() {
-    Logger::debug("SpeedTestScreen: Entered");
+    LOG_DEBUG("SpeedTestScreen: Entered");
     m_running = true;
     
     // Reset state
@@ -107,6 +129,10 @@ void SpeedTestScreen::enter() {
     m_statusChanged = true;
     m_progressLastUpdated = 0;
     m_animationLastUpdated = 0;
+    m_probeActive = false;
+    m_graphEnabled = m_display->supportsBlit();
+    m_graph.clear();
+    m_sampleCount = 0;
     
     // Clear display
     m_display->clear();
@@ -124,9 +150,14 @@ void SpeedTestScreen::update() {
     auto currentTime = std::chrono::steady_clock::now();
     auto elapsedMs = std::chrono::duration_cast<std::chrono::milliseconds>(
         currentTime - m_startTime).count();
+
+    // Live samples and completion of the curl transfers
+    if (m_probeActive) {
+        pollProbe();
+    }
     
-    // Update animation every 250ms if test is in progress
-    bool shouldUpdateAnimation = (elapsedMs - m_animationLastUpdated >= 250);
+    // Update animation every 250ms until live throughput replaces it
+    bool shouldUpdateAnimation = (elapsedMs - m_animationLastUpdated >= 250) && m_sampleCount == 0;
     if (shouldUpdateAnimation && (m_downloadInProgress || m_uploadInProgress) && !m_testCompleted) {
         m_animationLastUpdated = elapsedMs;
         
@@ -162,14 +193,19 @@ void SpeedTestScreen::update() {
     if (shouldUpdateProgress && (m_downloadInProgress || m_uploadInProgress) && !m_testCompleted) {
         m_progressLastUpdated = elapsedMs;
         
-        // Progress is a percentage of expected test duration (15 seconds)
-        int progress = static_cast<int>((elapsedMs * 100) / 15000);
+        // Progress is a percentage of expected test duration (15 seconds for
+        // the upload script, the configured warm-up + duration otherwise)
+        int progress = m_probeActive ? static_cast<int>(m_probe.getProgress() * 100)
+                                     : static_cast<int>((elapsedMs * 100) / 15000);
         if (progress > 95) progress = 95;  // Cap at 95% until complete
         
         if (progress > m_progress) {
             m_progress = progress;
-            m_display->drawProgressBar(10, 35, 108, 15, progress);
-            usleep(Config::DISPLAY_CMD_DELAY);
+            // The graph grows left to right and doubles as the progress bar
+            if (!m_graphEnabled || !m_probeActive) {
+                m_display->drawProgressBar(10, 35, 108, 15, progress);
+                usleep(Config::DISPLAY_CMD_DELAY);
+            }
         }
     }
     
@@ -182,11 +218,20 @@ void SpeedTestScreen::update() {
     // If test completes, update status
     if (m_testCompleted && m_progress < 100) {
         // Update progress bar to 100%
-        m_display->drawProgressBar(10, 35, 108, 15, 100);
+        if (!m_graphEnabled || m_graph.empty()) {
+            m_display->drawProgressBar(10, 35, 108, 15, 100);
+        }
         m_progress = 100;
         
         // Update status line
         m_statusChanged = true;
+
+        // Once per direction; a cancelled test cleared both flags and is not a result
+        if (m_downloadInProgress || m_uploadInProgress) {
+            HistoryLog::getInstance().append(
+                m_downloadInProgress ? HistoryLog::Kind::SPEED_DOWN : HistoryLog::Kind::SPEED_UP,
+                m_downloadInProgress ? m_downloadSpeed : m_uploadSpeed, m_testResult != 0);
+        }
         
         // If this was the download test and upload is enabled, start upload test
         if (m_downloadInProgress && m_uploadEnabled) {
@@ -202,9 +247,11 @@ void SpeedTestScreen::update() {
 }
 
 void SpeedTestScreen::exit() {
-    Logger::debug("SpeedTestScreen: Exiting");
+    LOG_DEBUG("SpeedTestScreen: Exiting");
     
     // Cancel any ongoing test
+    m_probe.cancel();
+    m_probeActive = false;
     m_downloadInProgress = false;
     m_uploadInProgress = false;
     
@@ -233,19 +280,21 @@ bool SpeedTestScreen::handleInput() {
                 // Button press
                 buttonPressed = true;
                 m_display->updateActivityTimestamp();
-                Logger::debug("SpeedTestScreen: Button pressed");
+                LOG_DEBUG("SpeedTestScreen: Button pressed");
             }
         );
         
         if (buttonPressed) {
             if (m_testCompleted || (!m_downloadInProgress && !m_uploadInProgress)) {
                 // If test is complete or not running, exit on button press
-                Logger::debug("SpeedTestScreen: Test completed, exiting on button press");
+                LOG_DEBUG("SpeedTestScreen: Test completed, exiting on button press");
                 m_shouldExit = true;
             }
             else {
                 // If test is in progress, cancel it
-                Logger::debug("SpeedTestScreen: Test in progress, canceling");
+                LOG_DEBUG("SpeedTestScreen: Test in progress, canceling");
+                m_probe.cancel();
+                m_probeActive = false;
                 m_downloadInProgress = false;
                 m_uploadInProgress = false;
                 m_testCompleted = true;
@@ -275,9 +324,12 @@ void SpeedTestScreen::renderScreen() {
     m_display->drawText(0, 20, "Initializing...");
     usleep(Config::DISPLAY_CMD_DELAY);
     
-    // Initial progress bar (0%)
-    m_display->drawProgressBar(10, 35, 108, 15, 0);
-    usleep(Config::DISPLAY_CMD_DELAY);
+    // Initial progress bar (0%), replaced by the throughput graph if the
+    // display can take bitmaps
+    if (!m_graphEnabled) {
+        m_display->drawProgressBar(10, 35, 108, 15, 0);
+        usleep(Config::DISPLAY_CMD_DELAY);
+    }
     
     // Draw status line
     updateStatusLine();
@@ -318,7 +370,7 @@ void SpeedTestScreen::startDownloadTest() {
         return;  // Test already in progress
     }
     
-    Logger::debug("SpeedTestScreen: Starting download test to " + m_downloadUrl);
+    LOG_DEBUG("SpeedTestScreen: Starting download test to " + m_downloadUrl);
     
     // Reset state
     m_testCompleted = false;
@@ -330,110 +382,8 @@ void SpeedTestScreen::startDownloadTest() {
     
     // Record start time
     m_startTime = std::chrono::steady_clock::now();
-    
-    // Start test in separate thread
-    m_testThread = std::thread([this]() {
-        // Initialize curl
-        CURL *curl;
-        CURLcode res;
-        size_t downloadedBytes = 0;
-        
-        curl = curl_easy_init();
-        if (curl) {
-            // Set the URL
-            curl_easy_setopt(curl, CURLOPT_URL, m_downloadUrl.c_str());
-            
-            // Set write callback function
-            curl_easy_setopt(curl, CURLOPT_WRITEFUNCTION, WriteCallback);
-            curl_easy_setopt(curl, CURLOPT_WRITEDATA, &downloadedBytes);
-            
-            // Follow redirects
-            curl_easy_setopt(curl, CURLOPT_FOLLOWLOCATION, 1L);
-            
-            // Set maximum redirects
-            curl_easy_setopt(curl, CURLOPT_MAXREDIRS, 10L);
-            
-            // Set a reasonable timeout (30 seconds)
-            curl_easy_setopt(curl, CURLOPT_TIMEOUT, 30L);
-            
-            // Disable progress meter
-            curl_easy_setopt(curl, CURLOPT_NOPROGRESS, 1L);
-            
-            // Set user agent
-            curl_easy_setopt(curl, CURLOPT_USERAGENT, "MicroPanel SpeedTest/1.0");
-            
-            // Don't verify SSL certificates for HTTP URLs (avoids SSL issues)
-            curl_easy_setopt(curl, CURLOPT_SSL_VERIFYPEER, 0L);
-            curl_easy_setopt(curl, CURLOPT_SSL_VERIFYHOST, 0L);
-            
-            // Fail on HTTP error (like 404, 500, etc.)
-            curl_easy_setopt(curl, CURLOPT_FAILONERROR, 1L);
-            
-            // Set connection timeout
-            curl_easy_setopt(curl, CURLOPT_CONNECTTIMEOUT, 10L);
-            
-            // Add some HTTP headers to avoid caching
-            struct curl_slist *headers = NULL;
-            headers = curl_slist_append(headers, "Cache-Control: no-cache, no-store");
-            headers = curl_slist_append(headers, "Pragma: no-cache");
-            curl_easy_setopt(curl, CURLOPT_HTTPHEADER, headers);
-            
-            // Start the download
-            auto startTime = std::chrono::steady_clock::now();
-            res = curl_easy_perform(curl);
-            auto endTime = std::chrono::steady_clock::now();
-            
-            // Calculate time taken
-            auto duration = std::chrono::duration_cast<std::chrono::milliseconds>(endTime - startTime);
-            
-            // Get more info about the transfer
-            double contentLength = 0;
-            curl_easy_getinfo(curl, CURLINFO_CONTENT_LENGTH_DOWNLOAD, &contentLength);
-            double speedDownload = 0;
-            curl_easy_getinfo(curl, CURLINFO_SPEED_DOWNLOAD, &speedDownload);
-            long httpCode = 0;
-            curl_easy_getinfo(curl, CURLINFO_RESPONSE_CODE, &httpCode);
-            
-            // Clean up headers
-            curl_slist_free_all(headers);
-            
-            // Log more details about the download
-            Logger::debug("SpeedTestScreen: HTTP Response Code: " + std::to_string(httpCode));
-            Logger::debug("SpeedTestScreen: Content length: " + std::to_string(contentLength) + " bytes");
-            Logger::debug("SpeedTestScreen: CURL reported speed: " + std::to_string(speedDownload) + " bytes/sec");
-            Logger::debug("SpeedTestScreen: Actual downloaded: " + std::to_string(downloadedBytes) + " bytes");
-            Logger::debug("SpeedTestScreen: Download duration: " + std::to_string(duration.count()) + " ms");
-            
-            // Clean up
-            curl_easy_cleanup(curl);
-            
-            // Consider the test successful if we downloaded more than 100KB
-            // and the HTTP response code is 200 OK
-            if (res == CURLE_OK && downloadedBytes > 100000 && (httpCode >= 200 && httpCode < 300)) {
-                // Calculate speed in Mbps
-                m_downloadSpeed = calculateSpeed(downloadedBytes, duration);
-                Logger::debug("SpeedTestScreen: Download completed successfully - " + 
-                             std::to_string(downloadedBytes) + " bytes in " + 
-                             std::to_string(duration.count()) + "ms = " + 
-                             std::to_string(m_downloadSpeed) + " Mbps");
-                m_testResult = 0; // Success
-            } else {
-                Logger::error("SpeedTestScreen: Download failed or too small - " + 
-                             std::string(curl_easy_strerror(res)) +
-                             " (HTTP " + std::to_string(httpCode) + ")");
-                m_testResult = 1; // Failure
-            }
-        } else {
-            Logger::error("SpeedTestScreen: Failed to initialize CURL");
-            m_testResult = 1;
-        }
-        
-        // Mark test as completed
-        m_testCompleted = true;
-    });
-    
-    // Detach thread to run independently
-    m_testThread.detach();
+
+    startProbe(HttpSpeedTest::Direction::DOWNLOAD, m_downloadUrl);
 }
 
 void SpeedTestScreen::startUploadTest() {
@@ -441,7 +391,8 @@ void SpeedTestScreen::startUploadTest() {
         return;  // Upload not enabled or test already in progress
     }
     
-    Logger::debug("SpeedTestScreen: Starting upload test using script: " + m_uploadScript);
+    LOG_DEBUG("SpeedTestScreen: Starting upload test using " +
+                  (m_uploadUrl.empty() ? "script: " + m_uploadScript : "URL: " + m_uploadUrl));
     
     // Reset state for upload test
     m_testCompleted = false;
@@ -452,6 +403,11 @@ void SpeedTestScreen::startUploadTest() {
     
     // Record start time
     m_startTime = std::chrono::steady_clock::now();
+
+    if (!m_uploadUrl.empty()) {
+        startProbe(HttpSpeedTest::Direction::UPLOAD, m_uploadUrl);
+        return;
+    }
     
     // Start test in separate thread
     m_testThread = std::thread([this]() {
@@ -460,6 +416,7 @@ void SpeedTestScreen::startUploadTest() {
         
         // Execute the upload script
         std::string command = m_uploadScript + " > " + tempFile + " 2>&1";
+        PerfCounters::getInstance().add(PerfCounters::Counter::CHILD_PROCESSES);
         int result = system(command.c_str());
         
         if (result == 0) {
@@ -470,7 +427,7 @@ void SpeedTestScreen::startUploadTest() {
                 if (std::getline(resultFile, line)) {
                     try {
                         m_uploadSpeed = std::stod(line);
-                        Logger::debug("SpeedTestScreen: Upload completed - " + 
+                        LOG_DEBUG("SpeedTestScreen: Upload completed - " + 
                                     std::to_string(m_uploadSpeed) + " Mbps");
                         m_testResult = 0;
                     } catch (...) {
@@ -500,20 +457,124 @@ void SpeedTestScreen::startUploadTest() {
     m_testThread.detach();
 }
 
-double SpeedTestScreen::calculateSpeed(size_t bytes, std::chrono::milliseconds duration) {
-    // Convert bytes to bits
-    double bits = bytes * 8.0;
-    
-    // Convert to megabits
-    double megabits = bits / 1000000.0;
-    
-    // Calculate seconds
-    double seconds = duration.count() / 1000.0;
-    
-    // Calculate speed in Mbps
-    double speed = megabits / seconds;
-    
-    return speed;
+void SpeedTestScreen::startProbe(HttpSpeedTest::Direction direction, const std::string& url) {
+    HttpSpeedTest::Options options;
+    options.url = url;
+    options.direction = direction;
+    options.connections = m_connections;
+    options.warmupMs = m_warmupMs;
+    options.durationMs = m_durationMs;
+    options.sampleMs = Config::SPEEDTEST_SAMPLE_MS;
+
+    m_graph.clear();
+    m_sampleCount = 0;
+    m_graphSlots = static_cast<size_t>((m_warmupMs + m_durationMs) / Config::SPEEDTEST_SAMPLE_MS);
+    if (m_graphEnabled) {
+        drawGraph();
+    }
+
+    if (!m_probe.start(options)) {
+        Logger::error("SpeedTestScreen: Speed test already running");
+        m_testResult = 1;
+        m_testCompleted = true;
+        return;
+    }
+    m_probeActive = true;
+}
+
+void SpeedTestScreen::pollProbe() {
+    std::vector<HttpSpeedTest::Sample> samples;
+    size_t total = m_probe.getSamples(samples, m_sampleCount);
+    if (total != m_sampleCount && !samples.empty()) {
+        m_sampleCount = total;
+        m_graph.insert(m_graph.end(), samples.begin(), samples.end());
+
+        // Live rate replaces the "Download Test..." animation
+        std::ostringstream rateStream;
+        double mbps = samples.back().mbps;
+        rateStream << (m_downloadInProgress ? "Down " : "Up ") << std::fixed
+                   << std::setprecision(mbps < 100 ? 1 : 0) << mbps << "Mbps";
+        std::string rate = rateStream.str();
+        rate.resize(16, ' ');
+        m_display->drawText(0, 20, rate);
+        usleep(Config::DISPLAY_CMD_DELAY);
+
+        if (m_graphEnabled) {
+            drawGraph();
+        }
+    }
+
+    if (m_probe.isRunning()) {
+        return;
+    }
+
+    m_probeActive = false;
+    HttpSpeedTest::Result result = m_probe.getResult();
+    if (result.valid) {
+        if (m_downloadInProgress) {
+            m_downloadSpeed = result.mbps;
+        } else {
+            m_uploadSpeed = result.mbps;
+        }
+        LOG_DEBUG("SpeedTestScreen: " + std::string(m_downloadInProgress ? "Download" : "Upload") +
+                      " completed - " + std::to_string(result.mbps) + " Mbps over " +
+                      std::to_string(result.connections) + " connections");
+        m_testResult = 0;
+    } else {
+        Logger::error("SpeedTestScreen: Speed test failed - " + result.error);
+        m_testResult = 1;
+    }
+    m_testCompleted = true;
+}
+
+void SpeedTestScreen::drawGraph() {
+    // Bar graph in pages 4-5 (y 32-47), autoscaled to the peak sample;
+    // warm-up samples are drawn hatched since they don't count. Past one
+    // sample per column each column averages a bin of samples, like
+    // TrendScreen::drawGraph, and is hatched if the whole bin is warm-up
+    constexpr int WIDTH = Config::DISPLAY_WIDTH;
+    constexpr int FIRST_PAGE = 4;
+    constexpr int PAGES = 2;
+    constexpr int HEIGHT = PAGES * 8;
+    uint8_t pixels[PAGES * WIDTH] = {0};
+
+    double peak = 0.0;
+    for (const auto& sample : m_graph) {
+        peak = std::max(peak, sample.mbps);
+    }
+    size_t slots = std::max(m_graphSlots, m_graph.size());
+    size_t bins = std::min<size_t>(slots, WIDTH);
+
+    for (size_t bin = 0; bin < bins && peak > 0.0; bin++) {
+        size_t begin = slots * bin / bins;
+        size_t end = std::min(slots * (bin + 1) / bins, m_graph.size());
+        if (begin >= end) break;
+        double sum = 0.0;
+        bool warmup = true;
+        for (size_t i = begin; i < end; i++) {
+            sum += m_graph[i].mbps;
+            warmup = warmup && m_graph[i].warmup;
+        }
+        double mbps = sum / (end - begin);
+
+        int x0 = static_cast<int>(bin * WIDTH / bins);
+        int x1 = static_cast<int>((bin + 1) * WIDTH / bins);
+        if (x1 - x0 >= 2) x1--;     // Gap between bars
+        int height = static_cast<int>(std::lround(mbps / peak * HEIGHT));
+        if (height == 0 && mbps > 0.0) height = 1;
+
+        for (int x = x0; x < x1; x++) {
+            for (int y = 0; y < height; y++) {
+                int row = HEIGHT - 1 - y;
+                if (warmup && ((row + x) & 1)) continue;
+                pixels[(row / 8) * WIDTH + x] |= static_cast<uint8_t>(1 << (row % 8));
+            }
+        }
+    }
+
+    MonoFrame::Window window = {FIRST_PAGE, FIRST_PAGE + PAGES - 1, 0, WIDTH - 1};
+    m_display->blit(window, pixels);
+    usleep(Config::DISPLAY_CMD_DELAY);
 }
 
 // method to display final results with proper formatting
@@ -583,3 +644,5 @@ void SpeedTestScreen::displayFinalResults() {
         usleep(Config::DISPLAY_CMD_DELAY);
     }
 }
+
+MICROPANEL_REGISTER_MODULE("speedtest", SpeedTestScreen);
@@ -0,0 +1,518 @@
+#include "SubnetScanner.h"
+#include "IcmpPinger.h"
+#include "Config.h"
+#include "Logger.h"
+#include <cerrno>
+#include <cstring>
+#include <ctime>
+#include <unistd.h>
+#include <ifaddrs.h>
+#include <arpa/inet.h>
+#include <net/if.h>
+#include <net/if_arp.h>
+#include <netinet/in.h>
+#include <netinet/ip.h>
+#include <netinet/ip_icmp.h>
+#include <netinet/if_ether.h>
+#include <netpacket/packet.h>
+#include <sys/epoll.h>
+#include <sys/eventfd.h>
+#include <sys/ioctl.h>
+#include <sys/socket.h>
+
+namespace {
+    constexpr int MAX_WAIT_MS = 50;
+
+    // ARP payload as carried by a SOCK_DGRAM packet socket (no Ethernet header)
+    struct ArpPacket {
+        uint16_t hardwareType;
+        uint16_t protocolType;
+        uint8_t hardwareLength;
+        uint8_t protocolLength;
+        uint16_t operation;
+        uint8_t senderMac[6];
+        uint8_t senderIp[4];
+        uint8_t targetMac[6];
+        uint8_t targetIp[4];
+    } __attribute__((packed));
+
+    int64_t monotonicUs() {
+        struct timespec ts;
+        clock_gettime(CLOCK_MONOTONIC, &ts);
+        return static_cast<int64_t>(ts.tv_sec) * 1000000 + ts.tv_nsec / 1000;
+    }
+
+    std::string formatMac(const uint8_t* mac) {
+        char buffer[18];
+        snprintf(buffer, sizeof(buffer), "%02x:%02x:%02x:%02x:%02x:%02x",
+                 mac[0], mac[1], mac[2], mac[3], mac[4], mac[5]);
+        return buffer;
+    }
+}
+
+SubnetScanner::SubnetScanner()
+{
+}
+
+SubnetScanner::~SubnetScanner()
+{
+    stop();
+}
+
+std::vector<SubnetScanner::Subnet> SubnetScanner::localSubnets()
+{
+    std::vector<Subnet> subnets;
+    struct ifaddrs *ifaddr, *ifa;
+
+    if (getifaddrs(&ifaddr) == -1) {
+        Logger::error("Failed to get interface addresses");
+        return subnets;
+    }
+
+    for (ifa = ifaddr; ifa != nullptr; ifa = ifa->ifa_next) {
+        if (ifa->ifa_addr == nullptr || ifa->ifa_netmask == nullptr)
+            continue;
+        if (ifa->ifa_addr->sa_family != AF_INET)
+            continue;
+        if ((ifa->ifa_flags & IFF_LOOPBACK) || !(ifa->ifa_flags & IFF_UP))
+            continue;
+
+        Subnet subnet;
+        subnet.interfaceName = ifa->ifa_name;
+        subnet.address = ntohl(reinterpret_cast<struct sockaddr_in*>(ifa->ifa_addr)->sin_addr.s_addr);
+        uint32_t mask = ntohl(reinterpret_cast<struct sockaddr_in*>(ifa->ifa_netmask)->sin_addr.s_addr);
+        subnet.prefix = __builtin_popcount(mask);
+        subnets.push_back(subnet);
+    }
+
+    freeifaddrs(ifaddr);
+    return subnets;
+}
+
+bool SubnetScanner::hostRange(uint32_t address, int prefix, uint32_t& first, uint32_t& last)
+{
+    if (prefix < 0 || prefix > 32) {
+        return false;
+    }
+
+    uint32_t mask = prefix == 0 ? 0 : 0xFFFFFFFFu << (32 - prefix);
+    uint32_t network = address & mask;
+    uint32_t broadcast = network | ~mask;
+
+    if (prefix >= 31) {
+        // Point-to-point links have no network/broadcast addresses
+        first = network;
+        last = broadcast;
+    } else {
+        first = network + 1;
+        last = broadcast - 1;
+    }
+    return first <= last;
+}
+
+std::string SubnetScanner::formatAddress(uint32_t address)
+{
+    struct in_addr addr;
+    addr.s_addr = htonl(address);
+    char buffer[INET_ADDRSTRLEN];
+    inet_ntop(AF_INET, &addr, buffer, sizeof(buffer));
+    return buffer;
+}
+
+bool SubnetScanner::openArpSocket(const std::string& interfaceName)
+{
+    m_ifIndex = if_nametoindex(interfaceName.c_str());
+    if (m_ifIndex == 0) {
+        return false;
+    }
+
+    int fd = socket(AF_PACKET, SOCK_DGRAM | SOCK_NONBLOCK | SOCK_CLOEXEC, htons(ETH_P_ARP));
+    if (fd < 0) {
+        LOG_DEBUG("SubnetScanner: no ARP socket (" + std::string(strerror(errno)) + "), ICMP only");
+        return false;
+    }
+
+    // ARP only makes sense on Ethernet-like links
+    struct ifreq ifr;
+    std::memset(&ifr, 0, sizeof(ifr));
+    strncpy(ifr.ifr_name, interfaceName.c_str(), IFNAMSIZ - 1);
+    if (ioctl(fd, SIOCGIFHWADDR, &ifr) < 0 || ifr.ifr_hwaddr.sa_family != ARPHRD_ETHER) {
+        ::close(fd);
+        return false;
+    }
+    std::memcpy(m_localMac, ifr.ifr_hwaddr.sa_data, sizeof(m_localMac));
+
+    struct sockaddr_ll local;
+    std::memset(&local, 0, sizeof(local));
+    local.sll_family = AF_PACKET;
+    local.sll_protocol = htons(ETH_P_ARP);
+    local.sll_ifindex = m_ifIndex;
+    if (bind(fd, reinterpret_cast<struct sockaddr*>(&local), sizeof(local)) < 0) {
+        ::close(fd);
+        return false;
+    }
+
+    m_arpFd = fd;
+    return true;
+}
+
+bool SubnetScanner::start(const Subnet& subnet, uint32_t first, uint32_t last)
+{
+    stop();
+
+    {
+        std::lock_guard<std::mutex> lock(m_resultsMutex);
+        m_hosts.clear();
+        m_progress = Progress();
+    }
+
+    if (first > last || last - first + 1 > static_cast<uint32_t>(Config::SWEEP_MAX_HOSTS)) {
+        setError("Range too large");
+        return false;
+    }
+
+    m_localAddress = subnet.address;
+    m_targets.clear();
+    m_targetIndex.clear();
+    for (uint32_t address = first; ; address++) {
+        if (address != m_localAddress) {
+            Target target;
+            target.address = address;
+            m_targetIndex[address] = m_targets.size();
+            m_targets.push_back(target);
+        }
+        if (address == last) break;
+    }
+    m_nextTarget = 0;
+    m_inFlight = 0;
+
+    m_icmpFd = IcmpPinger::openIcmpSocket(m_icmpRaw);
+    if (m_icmpFd < 0) {
+        setError(std::string("ICMP socket: ") + strerror(errno));
+        return false;
+    }
+    bool arp = openArpSocket(subnet.interfaceName);
+
+    m_epollFd = epoll_create1(EPOLL_CLOEXEC);
+    m_wakeFd = eventfd(0, EFD_NONBLOCK | EFD_CLOEXEC);
+    if (m_epollFd < 0 || m_wakeFd < 0) {
+        setError(std::string("epoll: ") + strerror(errno));
+        stop();
+        return false;
+    }
+
+    for (int fd : {m_icmpFd, m_arpFd, m_wakeFd}) {
+        if (fd < 0) continue;
+        struct epoll_event event;
+        std::memset(&event, 0, sizeof(event));
+        event.events = EPOLLIN;
+        event.data.fd = fd;
+        epoll_ctl(m_epollFd, EPOLL_CTL_ADD, fd, &event);
+    }
+
+    m_ident = static_cast<uint16_t>(getpid() ^ reinterpret_cast<uintptr_t>(this));
+
+    {
+        std::lock_guard<std::mutex> lock(m_resultsMutex);
+        m_progress.total = m_targets.size();
+        m_progress.running = true;
+        m_progress.arpEnabled = arp;
+        m_progress.generation++;
+    }
+
+    LOG_DEBUG("SubnetScanner: sweeping " + formatAddress(first) + " - " + formatAddress(last) +
+                  " on " + subnet.interfaceName + (arp ? " (ICMP+ARP)" : " (ICMP)"));
+
+    m_running = true;
+    m_thread = std::thread(&SubnetScanner::run, this);
+    return true;
+}
+
+void SubnetScanner::stop()
+{
+    if (m_thread.joinable()) {
+        m_running = false;
+        uint64_t one = 1;
+        if (write(m_wakeFd, &one, sizeof(one)) < 0) {
+            // Thread still notices m_running within one wait interval
+        }
+        m_thread.join();
+    }
+    m_running = false;
+
+    for (int* fd : {&m_icmpFd, &m_arpFd, &m_epollFd, &m_wakeFd}) {
+        if (*fd >= 0) {
+            ::close(*fd);
+            *fd = -1;
+        }
+    }
+
+    std::lock_guard<std::mutex> lock(m_resultsMutex);
+    if (m_progress.running) {
+        m_progress.running = false;
+        m_progress.generation++;
+    }
+}
+
+std::vector<SubnetScanner::Host> SubnetScanner::getHosts() const
+{
+    std::lock_guard<std::mutex> lock(m_resultsMutex);
+    std::vector<Host> hosts;
+    hosts.reserve(m_hosts.size());
+    for (const auto& entry : m_hosts) {
+        hosts.push_back(entry.second);
+    }
+    return hosts;
+}
+
+SubnetScanner::Progress SubnetScanner::getProgress() const
+{
+    std::lock_guard<std::mutex> lock(m_resultsMutex);
+    return m_progress;
+}
+
+void SubnetScanner::setError(const std::string& message)
+{
+    Logger::error("SubnetScanner: " + message);
+    std::lock_guard<std::mutex> lock(m_resultsMutex);
+    m_progress.error = true;
+    m_progress.errorMessage = message;
+    m_progress.generation++;
+}
+
+void SubnetScanner::run()
+{
+    const int64_t timeoutUs = static_cast<int64_t>(Config::SWEEP_PROBE_TIMEOUT_MS) * 1000;
+    size_t remaining = m_targets.size();
+
+    while (m_running && remaining > 0) {
+        int64_t now = monotonicUs();
+
+        // Retire timed-out probes, then refill the window in address order
+        for (auto& target : m_targets) {
+            if (target.inFlight && now - target.lastSentUs >= timeoutUs) {
+                target.inFlight = false;
+                m_inFlight--;
+                if (target.attempts >= Config::SWEEP_PROBE_ATTEMPTS) {
+                    finishTarget(target);
+                }
+            }
+        }
+
+        for (size_t i = 0; i < m_targets.size() && m_inFlight < Config::SWEEP_MAX_IN_FLIGHT; i++) {
+            size_t index = (m_nextTarget + i) % m_targets.size();
+            Target& target = m_targets[index];
+            if (!target.done && !target.inFlight && target.attempts < Config::SWEEP_PROBE_ATTEMPTS) {
+                sendProbes(target, index, now);
+            }
+        }
+
+        remaining = 0;
+        int64_t nextExpiry = now + timeoutUs;
+        for (const auto& target : m_targets) {
+            if (!target.done) {
+                remaining++;
+                if (target.inFlight && target.lastSentUs + timeoutUs < nextExpiry) {
+                    nextExpiry = target.lastSentUs + timeoutUs;
+                }
+            }
+        }
+        if (remaining == 0) {
+            break;
+        }
+
+        int waitMs = static_cast<int>((nextExpiry - now + 999) / 1000);
+        if (waitMs > MAX_WAIT_MS) waitMs = MAX_WAIT_MS;
+        if (waitMs < 0) waitMs = 0;
+
+        struct epoll_event events[4];
+        int count = epoll_wait(m_epollFd, events, 4, waitMs);
+        if (count < 0 && errno != EINTR) {
+            setError(std::string("epoll_wait: ") + strerror(errno));
+            break;
+        }
+
+        now = monotonicUs();
+        for (int i = 0; i < count; i++) {
+            if (events[i].data.fd == m_icmpFd) {
+                receiveIcmp(now);
+            } else if (events[i].data.fd == m_arpFd) {
+                receiveArp(now);
+            }
+        }
+    }
+
+    m_running = false;
+
+    std::lock_guard<std::mutex> lock(m_resultsMutex);
+    m_progress.running = false;
+    m_progress.generation++;
+    LOG_DEBUG("SubnetScanner: finished, " + std::to_string(m_hosts.size()) + " hosts found");
+}
+
+void SubnetScanner::sendProbes(Target& target, size_t index, int64_t nowUs)
+{
+    // ICMP echo; the sequence number is the target slot
+    uint8_t packet[sizeof(struct icmphdr) + 8];
+    std::memset(packet, 0, sizeof(packet));
+    auto* header = reinterpret_cast<struct icmphdr*>(packet);
+    header->type = ICMP_ECHO;
+    header->un.echo.id = htons(m_ident);
+    header->un.echo.sequence = htons(static_cast<uint16_t>(index));
+    header->checksum = IcmpPinger::checksum(packet, sizeof(packet));
+
+    struct sockaddr_in destination;
+    std::memset(&destination, 0, sizeof(destination));
+    destination.sin_family = AF_INET;
+    destination.sin_addr.s_addr = htonl(target.address);
+
+    ssize_t sent = sendto(m_icmpFd, packet, sizeof(packet), 0,
+                          reinterpret_cast<struct sockaddr*>(&destination), sizeof(destination));
+    if (sent < 0 && (errno == EAGAIN || errno == ENOBUFS)) {
+        // Socket buffer full: try this target again on the next pass
+        m_nextTarget = index;
+        return;
+    }
+
+    if (m_arpFd >= 0) {
+        ArpPacket arp;
+        arp.hardwareType = htons(ARPHRD_ETHER);
+        arp.protocolType = htons(ETH_P_IP);
+        arp.hardwareLength = 6;
+        arp.protocolLength = 4;
+        arp.operation = htons(ARPOP_REQUEST);
+        std::memcpy(arp.senderMac, m_localMac, 6);
+        uint32_t local = htonl(m_localAddress);
+        std::memcpy(arp.senderIp, &local, 4);
+        std::memset(arp.targetMac, 0, 6);
+        uint32_t remote = htonl(target.address);
+        std::memcpy(arp.targetIp, &remote, 4);
+
+        struct sockaddr_ll broadcast;
+        std::memset(&broadcast, 0, sizeof(broadcast));
+        broadcast.sll_family = AF_PACKET;
+        broadcast.sll_protocol = htons(ETH_P_ARP);
+        broadcast.sll_ifindex = m_ifIndex;
+        broadcast.sll_halen = 6;
+        std::memset(broadcast.sll_addr, 0xFF, 6);
+
+        sendto(m_arpFd, &arp, sizeof(arp), 0,
+               reinterpret_cast<struct sockaddr*>(&broadcast), sizeof(broadcast));
+    }
+
+    if (target.attempts == 0) {
+        target.firstSentUs = nowUs;
+    }
+    target.attempts++;
+    target.lastSentUs = nowUs;
+    target.inFlight = true;
+    m_inFlight++;
+    m_nextTarget = index + 1;
+}
+
+void SubnetScanner::receiveIcmp(int64_t nowUs)
+{
+    uint8_t buffer[1500];
+
+    while (true) {
+        struct sockaddr_in from;
+        socklen_t fromLength = sizeof(from);
+        ssize_t length = recvfrom(m_icmpFd, buffer, sizeof(buffer), MSG_DONTWAIT,
+                                  reinterpret_cast<struct sockaddr*>(&from), &fromLength);
+        if (length < 0) {
+            return;
+        }
+
+        const uint8_t* icmp = buffer;
+        size_t icmpLength = static_cast<size_t>(length);
+        if (m_icmpRaw) {
+            size_t ipHeaderLength = (buffer[0] & 0x0F) * 4;
+            if (icmpLength < ipHeaderLength) continue;
+            icmp += ipHeaderLength;
+            icmpLength -= ipHeaderLength;
+        }
+        if (icmpLength < sizeof(struct icmphdr)) continue;
+
+        struct icmphdr header;
+        std::memcpy(&header, icmp, sizeof(header));
+        if (header.type != ICMP_ECHOREPLY) continue;
+        if (m_icmpRaw && ntohs(header.un.echo.id) != m_ident) continue;
+
+        hostAnswered(ntohl(from.sin_addr.s_addr), nowUs, false, nullptr);
+    }
+}
+
+void SubnetScanner::receiveArp(int64_t nowUs)
+{
+    ArpPacket arp;
+
+    while (true) {
+        ssize_t length = recv(m_arpFd, &arp, sizeof(arp), MSG_DONTWAIT);
+        if (length < 0) {
+            return;
+        }
+        if (length < static_cast<ssize_t>(sizeof(arp)) || ntohs(arp.protocolType) != ETH_P_IP) {
+            continue;
+        }
+
+        // Replies and the host's own requests both prove it is alive
+        uint16_t operation = ntohs(arp.operation);
+        if (operation != ARPOP_REPLY && operation != ARPOP_REQUEST) {
+            continue;
+        }
+
+        uint32_t sender;
+        std::memcpy(&sender, arp.senderIp, 4);
+        hostAnswered(ntohl(sender), nowUs, true, arp.senderMac);
+    }
+}
+
+void SubnetScanner::hostAnswered(uint32_t address, int64_t nowUs, bool viaArp, const uint8_t* mac)
+{
+    auto it = m_targetIndex.find(address);
+    if (it == m_targetIndex.end()) {
+        return;
+    }
+
+    Target& target = m_targets[it->second];
+    // Unsolicited ARP traffic may arrive before we probed this host
+    double rttMs = target.attempts > 0 ? (nowUs - target.firstSentUs) / 1000.0 : 0.0;
+    if (!target.done) {
+        finishTarget(target);
+    }
+
+    std::lock_guard<std::mutex> lock(m_resultsMutex);
+    auto hostIt = m_hosts.find(address);
+    if (hostIt == m_hosts.end()) {
+        Host host;
+        host.address = address;
+        host.ip = formatAddress(address);
+        host.rttMs = rttMs;
+        hostIt = m_hosts.emplace(address, host).first;
+        m_progress.found = m_hosts.size();
+    }
+
+    Host& host = hostIt->second;
+    if (viaArp) {
+        host.arp = true;
+        if (mac) {
+            host.mac = formatMac(mac);
+        }
+    } else {
+        host.icmp = true;
+    }
+    m_progress.generation++;
+}
+
+void SubnetScanner::finishTarget(Target& target)
+{
+    target.done = true;
+    if (target.inFlight) {
+        target.inFlight = false;
+        m_inFlight--;
+    }
+
+    std::lock_guard<std::mutex> lock(m_resultsMutex);
+    m_progress.completed++;
+    m_progress.generation++;
+}
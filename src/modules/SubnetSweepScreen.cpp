@@ -0,0 +1,374 @@
+#include "ScreenModules.h"
+#include "ModuleCatalog.h"
+#include "MenuSystem.h"
+#include "DeviceInterfaces.h"
+#include "Logger.h"
+#include "Config.h"
+#include "IPSuggestions.h"
+#include <iostream>
+#include <unistd.h>
+#include <string>
+#include <memory>
+#include <cstdio>
+
+namespace {
+    // Narrowest range offered; wider than the interface prefix is never swept
+    constexpr int NARROWEST_PREFIX = 30;
+
+    int widestPrefix(int interfacePrefix) {
+        // Config::SWEEP_MAX_HOSTS bounds the range (1024 hosts = /22)
+        int widest = 32;
+        while (widest > 0 && (1u << (32 - (widest - 1))) <= static_cast<unsigned int>(Config::SWEEP_MAX_HOSTS)) {
+            widest--;
+        }
+        return interfacePrefix > widest ? interfacePrefix : widest;
+    }
+
+    // "aabb.ccdd.eeff": a colon-separated MAC does not fit a 16-column line
+    std::string compactMac(const std::string& mac) {
+        std::string hex;
+        for (char c : mac) {
+            if (c != ':') hex += c;
+        }
+        if (hex.size() != 12) {
+            return mac;
+        }
+        return hex.substr(0, 4) + "." + hex.substr(4, 4) + "." + hex.substr(8, 4);
+    }
+}
+
+SubnetSweepScreen::SubnetSweepScreen(std::shared_ptr<Display> display, std::shared_ptr<InputDevice> input)
+    : ScreenModule(display, input)
+    , m_rows(display)
+{
+}
+
+void SubnetSweepScreen::enter() {
+    LOG_DEBUG("SubnetSweepScreen: Entered");
+
+    m_view = View::MENU;
+    m_state = SweepMenuState::MENU_STATE_IFACE;
+    m_shouldExit = false;
+    m_selectedHost = 0;
+    m_scrollOffset = 0;
+
+    // Keep the previous results if a sweep finished while we were away
+    m_hosts = m_scanner.getHosts();
+    m_generation = m_scanner.getProgress().generation;
+
+    // Prefer the interface swept last time
+    std::string previous = m_subnetIndex < m_subnets.size() ? m_subnets[m_subnetIndex].interfaceName : "";
+    m_subnets = SubnetScanner::localSubnets();
+    m_subnetIndex = 0;
+    for (size_t i = 0; i < m_subnets.size(); i++) {
+        if (m_subnets[i].interfaceName == previous) {
+            m_subnetIndex = i;
+        }
+    }
+    if (previous.empty() || m_subnetIndex >= m_subnets.size() ||
+        m_subnets[m_subnetIndex].interfaceName != previous) {
+        selectDefaultRange();
+    }
+
+    m_display->clear();
+    usleep(Config::DISPLAY_CMD_DELAY * 3);
+    m_rows.invalidate();
+    render();
+}
+
+void SubnetSweepScreen::update() {
+    // Pull in new hosts and progress whenever the scanner recorded something
+    SubnetScanner::Progress progress = m_scanner.getProgress();
+    if (progress.generation == m_generation) {
+        return;
+    }
+    m_generation = progress.generation;
+    m_hosts = m_scanner.getHosts();
+
+    // Offer the finds to the IP selectors once the sweep is over
+    if (!progress.running && !m_hostsShared) {
+        for (const auto& host : m_hosts) {
+            IPSuggestions::getInstance().addSweepHost(host.ip);
+        }
+        m_hostsShared = true;
+    }
+
+    if (m_selectedHost > static_cast<int>(m_hosts.size())) {
+        m_selectedHost = m_hosts.size();
+    }
+
+    // Details of a host never change once shown
+    if (m_view != View::DETAILS) {
+        render();
+    }
+}
+
+void SubnetSweepScreen::exit() {
+    LOG_DEBUG("SubnetSweepScreen: Exiting");
+
+    m_scanner.stop();
+    if (!m_hostsShared) {
+        for (const auto& host : m_scanner.getHosts()) {
+            IPSuggestions::getInstance().addSweepHost(host.ip);
+        }
+        m_hostsShared = true;
+    }
+
+    // Clear display
+    m_display->clear();
+    usleep(Config::DISPLAY_CMD_DELAY * 3);
+}
+
+bool SubnetSweepScreen::handleInput() {
+    if (m_input->waitForEvents(100) > 0) {
+        bool buttonPressed = false;
+        int rotationDirection = 0;
+
+        m_input->processEvents(
+            [this, &rotationDirection](int direction) {
+                rotationDirection = direction;
+                m_display->updateActivityTimestamp();
+            },
+            [this, &buttonPressed]() {
+                buttonPressed = true;
+                m_display->updateActivityTimestamp();
+            }
+        );
+
+        if (buttonPressed) {
+            handleButton();
+        }
+        if (rotationDirection != 0) {
+            handleRotation(rotationDirection);
+        }
+    }
+
+    return !m_shouldExit;
+}
+
+void SubnetSweepScreen::handleGPIORotation(int direction) {
+    LOG_DEBUG("SubnetSweepScreen::handleGPIORotation(" + std::to_string(direction) + ")");
+    handleRotation(direction);
+    m_display->updateActivityTimestamp();
+}
+
+bool SubnetSweepScreen::handleGPIOButtonPress() {
+    LOG_DEBUG("SubnetSweepScreen::handleGPIOButtonPress()");
+    bool keepRunning = handleButton();
+    m_display->updateActivityTimestamp();
+    return keepRunning;
+}
+
+void SubnetSweepScreen::handleRotation(int direction) {
+    switch (m_view) {
+        case View::MENU: {
+            // Four items, wrapping like the other tool screens
+            int item = static_cast<int>(m_state);
+            item = (item + (direction < 0 ? 3 : 1)) % 4;
+            m_state = static_cast<SweepMenuState>(item);
+            break;
+        }
+        case View::RESULTS: {
+            int last = static_cast<int>(m_hosts.size());   // "Back"
+            if (direction < 0 && m_selectedHost > 0) {
+                m_selectedHost--;
+            } else if (direction > 0 && m_selectedHost < last) {
+                m_selectedHost++;
+            }
+            break;
+        }
+        case View::DETAILS:
+            return;
+    }
+
+    render();
+}
+
+bool SubnetSweepScreen::handleButton() {
+    switch (m_view) {
+        case View::MENU:
+            switch (m_state) {
+                case SweepMenuState::MENU_STATE_IFACE:
+                    if (!m_subnets.empty()) {
+                        m_subnetIndex = (m_subnetIndex + 1) % m_subnets.size();
+                        selectDefaultRange();
+                    }
+                    break;
+                case SweepMenuState::MENU_STATE_RANGE:
+                    if (!m_subnets.empty()) {
+                        // Step to a narrower prefix, wrapping back to the widest
+                        int widest = widestPrefix(m_subnets[m_subnetIndex].prefix);
+                        m_prefix = m_prefix >= NARROWEST_PREFIX ? widest : m_prefix + 1;
+                    }
+                    break;
+                case SweepMenuState::MENU_STATE_SWEEP:
+                    // A running sweep keeps going; just show its results
+                    if (!m_scanner.isRunning()) {
+                        startSweep();
+                    }
+                    m_view = View::RESULTS;
+                    m_selectedHost = 0;
+                    m_scrollOffset = 0;
+                    break;
+                case SweepMenuState::MENU_STATE_EXIT:
+                    m_shouldExit = true;
+                    return false;
+            }
+            break;
+
+        case View::RESULTS:
+            if (m_selectedHost >= static_cast<int>(m_hosts.size())) {
+                m_view = View::MENU;
+            } else {
+                m_view = View::DETAILS;
+            }
+            break;
+
+        case View::DETAILS:
+            m_view = View::RESULTS;
+            break;
+    }
+
+    render();
+    return true;
+}
+
+void SubnetSweepScreen::selectDefaultRange() {
+    // The interface's own subnet, capped to a /24 around our address
+    if (m_subnets.empty()) {
+        m_prefix = 24;
+        return;
+    }
+    int prefix = m_subnets[m_subnetIndex].prefix;
+    m_prefix = prefix > 24 ? prefix : 24;
+}
+
+void SubnetSweepScreen::startSweep() {
+    if (m_subnets.empty()) {
+        return;
+    }
+
+    const SubnetScanner::Subnet& subnet = m_subnets[m_subnetIndex];
+    uint32_t first, last;
+    if (!SubnetScanner::hostRange(subnet.address, m_prefix, first, last)) {
+        return;
+    }
+
+    LOG_DEBUG("Starting sweep of " + SubnetScanner::formatAddress(first) + "/" + std::to_string(m_prefix) +
+                  " on " + subnet.interfaceName);
+    m_scanner.start(subnet, first, last);
+    m_hosts.clear();
+    m_hostsShared = false;
+}
+
+void SubnetSweepScreen::render() {
+    switch (m_view) {
+        case View::MENU:
+            renderMenu();
+            break;
+        case View::RESULTS:
+            renderResults();
+            break;
+        case View::DETAILS:
+            renderDetails();
+            break;
+    }
+}
+
+void SubnetSweepScreen::renderMenu() {
+    SubnetScanner::Progress progress = m_scanner.getProgress();
+
+    m_rows.draw(0, "   Host Sweep");
+    m_rows.draw(1, Config::MENU_SEPARATOR);
+
+    std::string iface = m_subnets.empty() ? "none" : m_subnets[m_subnetIndex].interfaceName;
+    m_rows.draw(2, std::string(m_state == SweepMenuState::MENU_STATE_IFACE ? ">" : " ") + "If: " + iface);
+    m_rows.draw(3, std::string(m_state == SweepMenuState::MENU_STATE_RANGE ? ">" : " ") + "Range: /" +
+                std::to_string(m_prefix));
+    m_rows.draw(4, std::string(m_state == SweepMenuState::MENU_STATE_SWEEP ? ">" : " ") +
+                (m_scanner.isRunning() ? "Results" : "Sweep"));
+    m_rows.draw(5, std::string(m_state == SweepMenuState::MENU_STATE_EXIT ? ">" : " ") + "Exit");
+
+    // Network being swept and the last outcome
+    std::string network = "No IPv4 iface";
+    uint32_t first, last;
+    if (!m_subnets.empty() && SubnetScanner::hostRange(m_subnets[m_subnetIndex].address, m_prefix, first, last)) {
+        uint32_t mask = 0xFFFFFFFFu << (32 - m_prefix);
+        network = SubnetScanner::formatAddress(m_subnets[m_subnetIndex].address & mask) + "/" + std::to_string(m_prefix);
+    }
+    m_rows.draw(6, network);
+
+    std::string status;
+    if (progress.error) {
+        status = "Sweep Error";
+    } else if (progress.running) {
+        status = "Found " + std::to_string(progress.found) + " " + std::to_string(progress.percent()) + "%";
+    } else if (progress.total > 0) {
+        status = "Done: " + std::to_string(progress.found) + " hosts";
+    }
+    m_rows.draw(7, status);
+}
+
+void SubnetSweepScreen::renderResults() {
+    SubnetScanner::Progress progress = m_scanner.getProgress();
+
+    std::string header = std::to_string(m_hosts.size()) + " hosts";
+    if (progress.running) {
+        header += " " + std::to_string(progress.percent()) + "%";
+    }
+    m_rows.draw(0, header);
+    m_rows.draw(1, Config::MENU_SEPARATOR);
+
+    // Hosts followed by "Back", scrolled to keep the selection visible
+    int itemCount = static_cast<int>(m_hosts.size()) + 1;
+    if (m_selectedHost < m_scrollOffset) {
+        m_scrollOffset = m_selectedHost;
+    } else if (m_selectedHost >= m_scrollOffset + VISIBLE_ROWS) {
+        m_scrollOffset = m_selectedHost - VISIBLE_ROWS + 1;
+    }
+    int maxOffset = itemCount - VISIBLE_ROWS;
+    if (maxOffset < 0) maxOffset = 0;
+    if (m_scrollOffset > maxOffset) m_scrollOffset = maxOffset;
+
+    for (int row = 0; row < VISIBLE_ROWS; row++) {
+        int item = m_scrollOffset + row;
+        std::string line;
+        if (item < static_cast<int>(m_hosts.size())) {
+            line = (item == m_selectedHost ? ">" : " ") + m_hosts[item].ip;
+        } else if (item == static_cast<int>(m_hosts.size())) {
+            line = std::string(item == m_selectedHost ? ">" : " ") + "Back";
+        }
+
+        // Scroll indicators in the last column
+        if (line.size() < 16) line.resize(16, ' ');
+        if (row == 0 && m_scrollOffset > 0) line[15] = '^';
+        if (row == VISIBLE_ROWS - 1 && m_scrollOffset + VISIBLE_ROWS < itemCount) line[15] = 'v';
+
+        m_rows.draw(2 + row, line);
+    }
+}
+
+void SubnetSweepScreen::renderDetails() {
+    if (m_selectedHost >= static_cast<int>(m_hosts.size())) {
+        m_view = View::RESULTS;
+        renderResults();
+        return;
+    }
+
+    const SubnetScanner::Host& host = m_hosts[m_selectedHost];
+
+    char rtt[16];
+    snprintf(rtt, sizeof(rtt), "RTT %.1fms", host.rttMs);
+    std::string via = host.icmp && host.arp ? "ICMP+ARP" : (host.arp ? "ARP" : "ICMP");
+
+    m_rows.draw(0, "  Host Details");
+    m_rows.draw(1, Config::MENU_SEPARATOR);
+    m_rows.draw(2, host.ip);
+    m_rows.draw(3, host.mac.empty() ? "MAC unknown" : compactMac(host.mac));
+    m_rows.draw(4, rtt);
+    m_rows.draw(5, "Via " + via);
+    m_rows.draw(6, "");
+    m_rows.draw(7, ">Back");
+}
+
+MICROPANEL_REGISTER_MODULE("sweep", SubnetSweepScreen);
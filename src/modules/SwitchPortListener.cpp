@@ -0,0 +1,461 @@
+#include "SwitchPortListener.h"
+#include "Config.h"
+#include "Logger.h"
+#include <algorithm>
+#include <cerrno>
+#include <cstdio>
+#include <cstring>
+#include <ctime>
+#include <fstream>
+#include <poll.h>
+#include <unistd.h>
+#include <arpa/inet.h>
+#include <linux/ethtool.h>
+#include <linux/filter.h>
+#include <linux/if_packet.h>
+#include <linux/sockios.h>
+#include <net/ethernet.h>
+#include <net/if.h>
+#include <sys/eventfd.h>
+#include <sys/ioctl.h>
+#include <sys/mman.h>
+#include <sys/socket.h>
+
+namespace {
+    constexpr uint16_t ETHERTYPE_LLDP = 0x88cc;
+    constexpr size_t ETHER_HEADER = 14;
+    const uint8_t LLDP_MULTICAST[6] = {0x01, 0x80, 0xc2, 0x00, 0x00, 0x0e};
+    const uint8_t CDP_MULTICAST[6] = {0x01, 0x00, 0x0c, 0xcc, 0xcc, 0xcc};
+
+    // ldh [12]; jeq 0x88cc -> accept; ld [0]; jeq 0x01000ccc; ldh [4]; jeq 0xcccc -> accept; else drop
+    struct sock_filter FILTER[] = {
+        BPF_STMT(BPF_LD | BPF_H | BPF_ABS, 12),
+        BPF_JUMP(BPF_JMP | BPF_JEQ | BPF_K, ETHERTYPE_LLDP, 5, 0),
+        BPF_STMT(BPF_LD | BPF_W | BPF_ABS, 0),
+        BPF_JUMP(BPF_JMP | BPF_JEQ | BPF_K, 0x01000ccc, 0, 2),
+        BPF_STMT(BPF_LD | BPF_H | BPF_ABS, 4),
+        BPF_JUMP(BPF_JMP | BPF_JEQ | BPF_K, 0xcccc, 1, 0),
+        BPF_STMT(BPF_RET | BPF_K, 0),
+        BPF_STMT(BPF_RET | BPF_K, 0xFFFF),
+    };
+
+    int64_t nowMs() {
+        struct timespec ts;
+        clock_gettime(CLOCK_MONOTONIC, &ts);
+        return static_cast<int64_t>(ts.tv_sec) * 1000 + ts.tv_nsec / 1000000;
+    }
+
+    uint16_t read16(const uint8_t* p) {
+        return static_cast<uint16_t>((p[0] << 8) | p[1]);
+    }
+
+    // Switch-supplied text made safe for the display
+    std::string printable(const uint8_t* data, size_t length) {
+        std::string text;
+        for (size_t i = 0; i < length; i++) {
+            char c = static_cast<char>(data[i]);
+            text += (data[i] >= 0x20 && data[i] < 0x7f) ? c : '?';
+        }
+        while (!text.empty() && (text.back() == ' ' || text.back() == '?')) {
+            text.pop_back();
+        }
+        return text;
+    }
+
+    std::string macText(const uint8_t* mac) {
+        char buffer[18];
+        snprintf(buffer, sizeof(buffer), "%02x:%02x:%02x:%02x:%02x:%02x",
+                 mac[0], mac[1], mac[2], mac[3], mac[4], mac[5]);
+        return buffer;
+    }
+
+    bool readCounter(const std::string& interface, const char* name, uint64_t& value) {
+        std::ifstream file("/sys/class/net/" + interface + "/statistics/" + name);
+        return static_cast<bool>(file >> value);
+    }
+}
+
+SwitchPortListener::SwitchPortListener()
+{
+}
+
+SwitchPortListener::~SwitchPortListener()
+{
+    stop();
+}
+
+bool SwitchPortListener::parseLldp(const uint8_t* frame, size_t length, Neighbor& neighbor)
+{
+    if (length < ETHER_HEADER || read16(frame + 12) != ETHERTYPE_LLDP) {
+        return false;
+    }
+
+    std::string chassis, port, portDescription, systemName;
+    bool portIsMac = false;
+    size_t pos = ETHER_HEADER;
+    while (pos + 2 <= length) {
+        // 7-bit type, 9-bit length
+        uint16_t header = read16(frame + pos);
+        unsigned int type = header >> 9;
+        size_t size = header & 0x1FF;
+        pos += 2;
+        if (type == 0 || pos + size > length) {
+            break;      // End of LLDPDU
+        }
+        const uint8_t* value = frame + pos;
+
+        switch (type) {
+            case 1:     // Chassis ID: subtype 4 is a MAC address
+                if (size == 7 && value[0] == 4) {
+                    chassis = macText(value + 1);
+                } else if (size > 1) {
+                    chassis = printable(value + 1, size - 1);
+                }
+                break;
+            case 2:     // Port ID: subtype 3 is a MAC address
+                portIsMac = size == 7 && value[0] == 3;
+                if (portIsMac) {
+                    port = macText(value + 1);
+                } else if (size > 1) {
+                    port = printable(value + 1, size - 1);
+                }
+                break;
+            case 3:
+                if (size >= 2) {
+                    neighbor.ttlSec = read16(value);
+                }
+                break;
+            case 4:
+                portDescription = printable(value, size);
+                break;
+            case 5:
+                systemName = printable(value, size);
+                break;
+            case 127:   // IEEE 802.1 Port VLAN ID
+                if (size >= 6 && value[0] == 0x00 && value[1] == 0x80 && value[2] == 0xc2 && value[3] == 1) {
+                    neighbor.vlan = read16(value + 4);
+                }
+                break;
+            default:
+                break;
+        }
+        pos += size;
+    }
+
+    if (chassis.empty() && systemName.empty()) {
+        return false;
+    }
+    neighbor.protocol = "LLDP";
+    neighbor.switchName = systemName.empty() ? chassis : systemName;
+    // A MAC says little on a panel; the description usually names the port
+    neighbor.portId = (portIsMac || port.empty()) && !portDescription.empty() ? portDescription : port;
+    return true;
+}
+
+bool SwitchPortListener::parseCdp(const uint8_t* frame, size_t length, Neighbor& neighbor)
+{
+    // 802.3 length, LLC/SNAP AA AA 03 00 00 0C 20 00, then version, TTL, checksum
+    static const uint8_t SNAP[8] = {0xaa, 0xaa, 0x03, 0x00, 0x00, 0x0c, 0x20, 0x00};
+    if (length < ETHER_HEADER + 12 || std::memcmp(frame, CDP_MULTICAST, 6) != 0 ||
+        std::memcmp(frame + ETHER_HEADER, SNAP, sizeof(SNAP)) != 0) {
+        return false;
+    }
+
+    size_t pos = ETHER_HEADER + sizeof(SNAP);
+    neighbor.ttlSec = frame[pos + 1];
+    pos += 4;
+
+    std::string deviceId, port;
+    while (pos + 4 <= length) {
+        // Type and length, the length including these four bytes
+        uint16_t type = read16(frame + pos);
+        size_t size = read16(frame + pos + 2);
+        if (size < 4 || pos + size > length) {
+            break;
+        }
+        const uint8_t* value = frame + pos + 4;
+        size_t valueSize = size - 4;
+
+        if (type == 0x0001) {
+            deviceId = printable(value, valueSize);
+        } else if (type == 0x0003) {
+            port = printable(value, valueSize);
+        } else if (type == 0x000a && valueSize >= 2) {
+            neighbor.vlan = read16(value);
+        }
+        pos += size;
+    }
+
+    if (deviceId.empty()) {
+        return false;
+    }
+    neighbor.protocol = "CDP";
+    neighbor.switchName = deviceId;
+    neighbor.portId = port;
+    return true;
+}
+
+bool SwitchPortListener::readLinkSettings(const std::string& interface, LinkSettings& settings)
+{
+    settings = LinkSettings();
+    int fd = socket(AF_INET, SOCK_DGRAM | SOCK_CLOEXEC, 0);
+    if (fd < 0) {
+        return false;
+    }
+
+    // ETHTOOL_GSET is enough for speed and duplex and works on every kernel we ship
+    struct ethtool_cmd command;
+    std::memset(&command, 0, sizeof(command));
+    command.cmd = ETHTOOL_GSET;
+    struct ifreq request;
+    std::memset(&request, 0, sizeof(request));
+    std::strncpy(request.ifr_name, interface.c_str(), IFNAMSIZ - 1);
+    request.ifr_data = reinterpret_cast<char*>(&command);
+
+    bool ok = ioctl(fd, SIOCETHTOOL, &request) == 0;
+    ::close(fd);
+    if (!ok) {
+        return false;
+    }
+
+    uint32_t speed = ethtool_cmd_speed(&command);
+    if (speed != 0 && speed != static_cast<uint32_t>(SPEED_UNKNOWN)) {
+        settings.speedMbps = static_cast<int>(speed);
+        settings.fullDuplex = command.duplex == DUPLEX_FULL;
+    }
+    return true;
+}
+
+bool SwitchPortListener::readLinkCounters(const std::string& interface, LinkCounters& counters)
+{
+    counters = LinkCounters();
+    return readCounter(interface, "rx_errors", counters.rxErrors) &&
+           readCounter(interface, "tx_errors", counters.txErrors) &&
+           readCounter(interface, "rx_dropped", counters.rxDropped) &&
+           readCounter(interface, "tx_dropped", counters.txDropped);
+}
+
+bool SwitchPortListener::openRing(Ring& ring)
+{
+    unsigned int index = if_nametoindex(ring.interface.c_str());
+    if (index == 0) {
+        return false;
+    }
+
+    // Protocol 0 receives nothing, so no unfiltered frame gets in before bind()
+    ring.fd = socket(AF_PACKET, SOCK_RAW | SOCK_NONBLOCK | SOCK_CLOEXEC, 0);
+    if (ring.fd < 0) {
+        LOG_DEBUG("SwitchPortListener: packet socket on " + ring.interface + ": " + strerror(errno));
+        return false;
+    }
+
+    struct sock_fprog program;
+    program.len = sizeof(FILTER) / sizeof(FILTER[0]);
+    program.filter = FILTER;
+    int version = TPACKET_V3;
+
+    struct tpacket_req3 request;
+    std::memset(&request, 0, sizeof(request));
+    request.tp_block_size = Config::LLDP_RING_BLOCK_SIZE;
+    request.tp_block_nr = Config::LLDP_RING_BLOCKS;
+    request.tp_frame_size = Config::LLDP_RING_FRAME_SIZE;
+    request.tp_frame_nr = request.tp_block_size / request.tp_frame_size * request.tp_block_nr;
+    request.tp_retire_blk_tov = Config::LLDP_RING_RETIRE_MS;
+
+    if (setsockopt(ring.fd, SOL_SOCKET, SO_ATTACH_FILTER, &program, sizeof(program)) < 0 ||
+        setsockopt(ring.fd, SOL_PACKET, PACKET_VERSION, &version, sizeof(version)) < 0 ||
+        setsockopt(ring.fd, SOL_PACKET, PACKET_RX_RING, &request, sizeof(request)) < 0) {
+        Logger::error("SwitchPortListener: ring setup on " + ring.interface + ": " + strerror(errno));
+        closeRing(ring);
+        return false;
+    }
+
+    ring.mapSize = static_cast<size_t>(request.tp_block_size) * request.tp_block_nr;
+    void* map = mmap(nullptr, ring.mapSize, PROT_READ | PROT_WRITE, MAP_SHARED, ring.fd, 0);
+    if (map == MAP_FAILED) {
+        Logger::error("SwitchPortListener: mmap on " + ring.interface + ": " + strerror(errno));
+        ring.mapSize = 0;
+        closeRing(ring);
+        return false;
+    }
+    ring.map = static_cast<uint8_t*>(map);
+    ring.block = 0;
+
+    struct sockaddr_ll address;
+    std::memset(&address, 0, sizeof(address));
+    address.sll_family = AF_PACKET;
+    address.sll_protocol = htons(ETH_P_ALL);
+    address.sll_ifindex = static_cast<int>(index);
+    if (bind(ring.fd, reinterpret_cast<struct sockaddr*>(&address), sizeof(address)) < 0) {
+        Logger::error("SwitchPortListener: bind on " + ring.interface + ": " + strerror(errno));
+        closeRing(ring);
+        return false;
+    }
+
+    // Some NICs filter link-local multicast unless asked for it
+    for (const uint8_t* mac : {LLDP_MULTICAST, CDP_MULTICAST}) {
+        struct packet_mreq membership;
+        std::memset(&membership, 0, sizeof(membership));
+        membership.mr_ifindex = static_cast<int>(index);
+        membership.mr_type = PACKET_MR_MULTICAST;
+        membership.mr_alen = 6;
+        std::memcpy(membership.mr_address, mac, 6);
+        if (setsockopt(ring.fd, SOL_PACKET, PACKET_ADD_MEMBERSHIP, &membership, sizeof(membership)) < 0) {
+            LOG_DEBUG("SwitchPortListener: multicast membership on " + ring.interface + ": " + strerror(errno));
+        }
+    }
+    return true;
+}
+
+void SwitchPortListener::closeRing(Ring& ring)
+{
+    if (ring.map) {
+        munmap(ring.map, ring.mapSize);
+        ring.map = nullptr;
+        ring.mapSize = 0;
+    }
+    if (ring.fd >= 0) {
+        ::close(ring.fd);
+        ring.fd = -1;
+    }
+}
+
+void SwitchPortListener::start(const std::vector<std::string>& interfaces)
+{
+    stop();
+
+    std::map<std::string, State> states;
+    for (const std::string& interface : interfaces) {
+        Ring ring;
+        ring.interface = interface;
+        if (openRing(ring)) {
+            m_rings.push_back(ring);
+            states[interface] = State::LISTENING;
+        } else {
+            states[interface] = State::UNAVAILABLE;
+        }
+    }
+
+    {
+        // Advertisements of interfaces still listed stay valid
+        std::lock_guard<std::mutex> lock(m_mutex);
+        for (auto it = m_neighbors.begin(); it != m_neighbors.end();) {
+            auto state = states.find(it->first);
+            if (state == states.end() || state->second == State::UNAVAILABLE) {
+                it = m_neighbors.erase(it);
+            } else {
+                state->second = State::HEARD;
+                ++it;
+            }
+        }
+        m_states = states;
+    }
+    m_generation++;
+
+    if (m_rings.empty()) {
+        return;
+    }
+    m_wakeFd = eventfd(0, EFD_NONBLOCK | EFD_CLOEXEC);
+    m_stop = false;
+    m_thread = std::thread(&SwitchPortListener::run, this);
+    LOG_DEBUG("SwitchPortListener: capturing on " + std::to_string(m_rings.size()) + " interfaces");
+}
+
+void SwitchPortListener::stop()
+{
+    if (m_thread.joinable()) {
+        m_stop = true;
+        uint64_t one = 1;
+        if (m_wakeFd >= 0 && write(m_wakeFd, &one, sizeof(one)) < 0) {
+            // Nothing else wakes the thread; a failed write only happens without an eventfd
+        }
+        m_thread.join();
+    }
+    if (m_wakeFd >= 0) {
+        ::close(m_wakeFd);
+        m_wakeFd = -1;
+    }
+    for (Ring& ring : m_rings) {
+        closeRing(ring);
+    }
+    m_rings.clear();
+}
+
+SwitchPortListener::State SwitchPortListener::getNeighbor(const std::string& interface, Neighbor& neighbor) const
+{
+    std::lock_guard<std::mutex> lock(m_mutex);
+    auto state = m_states.find(interface);
+    if (state == m_states.end()) {
+        return State::UNAVAILABLE;
+    }
+    auto found = m_neighbors.find(interface);
+    if (found != m_neighbors.end()) {
+        neighbor = found->second;
+    }
+    return state->second;
+}
+
+void SwitchPortListener::run()
+{
+    std::vector<struct pollfd> fds(m_rings.size() + 1);
+    fds[0] = {m_wakeFd, POLLIN, 0};
+    for (size_t i = 0; i < m_rings.size(); i++) {
+        fds[i + 1] = {m_rings[i].fd, POLLIN | POLLERR, 0};
+    }
+
+    while (!m_stop) {
+        // No timeout: nothing to do until the kernel retires a block
+        int ready = poll(fds.data(), static_cast<nfds_t>(fds.size()), m_wakeFd >= 0 ? -1 : 1000);
+        if (ready < 0 && errno != EINTR) {
+            Logger::error(std::string("SwitchPortListener: poll: ") + strerror(errno));
+            break;
+        }
+        for (size_t i = 0; ready > 0 && i < m_rings.size(); i++) {
+            if (fds[i + 1].revents & POLLERR) {
+                // A link going down leaves ENETDOWN as the socket error; it
+                // stays pending (and poll returns at once) until read
+                int error = 0;
+                socklen_t length = sizeof(error);
+                getsockopt(m_rings[i].fd, SOL_SOCKET, SO_ERROR, &error, &length);
+                LOG_DEBUG("SwitchPortListener: " + m_rings[i].interface + ": " + strerror(error));
+            }
+            if (fds[i + 1].revents) {
+                drainRing(m_rings[i]);
+            }
+        }
+    }
+}
+
+void SwitchPortListener::drainRing(Ring& ring)
+{
+    while (true) {
+        auto* block = reinterpret_cast<struct tpacket_block_desc*>(
+            ring.map + static_cast<size_t>(ring.block) * Config::LLDP_RING_BLOCK_SIZE);
+        if (!(__atomic_load_n(&block->hdr.bh1.block_status, __ATOMIC_ACQUIRE) & TP_STATUS_USER)) {
+            return;
+        }
+
+        auto* packet = reinterpret_cast<struct tpacket3_hdr*>(
+            reinterpret_cast<uint8_t*>(block) + block->hdr.bh1.offset_to_first_pkt);
+        for (uint32_t i = 0; i < block->hdr.bh1.num_pkts; i++) {
+            const uint8_t* frame = reinterpret_cast<const uint8_t*>(packet) + packet->tp_mac;
+            Neighbor neighbor;
+            if (parseLldp(frame, packet->tp_snaplen, neighbor) || parseCdp(frame, packet->tp_snaplen, neighbor)) {
+                neighbor.receivedMs = nowMs();
+                {
+                    std::lock_guard<std::mutex> lock(m_mutex);
+                    m_neighbors[ring.interface] = neighbor;
+                    m_states[ring.interface] = State::HEARD;
+                }
+                m_generation++;
+                LOG_DEBUG("SwitchPortListener: " + neighbor.protocol + " on " + ring.interface + ": " +
+                          neighbor.switchName + " port " + neighbor.portId);
+            }
+            packet = reinterpret_cast<struct tpacket3_hdr*>(reinterpret_cast<uint8_t*>(packet) + packet->tp_next_offset);
+        }
+
+        // Hand the block back to the kernel
+        __atomic_store_n(&block->hdr.bh1.block_status, TP_STATUS_KERNEL, __ATOMIC_RELEASE);
+        ring.block = (ring.block + 1) % Config::LLDP_RING_BLOCKS;
+    }
+}
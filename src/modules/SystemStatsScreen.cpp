@@ -1,18 +1,50 @@
 #include "ScreenModules.h"
+#include "ModuleCatalog.h"
 #include "MenuSystem.h"
 #include "DeviceInterfaces.h"
 #include "Config.h"
+#include "MetricsSampler.h"
+#include "AllocationCounter.h"
+#include "TextLine.h"
 #include <iostream>
-#include <fstream>
-#include <sstream>
+#include <algorithm>
+#include <cmath>
+#include <cstdio>
 #include <unistd.h>
-#include <sys/sysinfo.h>
+
+namespace {
+    using Field = BasicTextLine<8>;
+
+    // Bytes per second in at most 6 characters ("999B", "12.3K", "1.2M")
+    Field formatRate(int32_t bytesPerSecond)
+    {
+        Field text;
+        if (bytesPerSecond < 1000) {
+            text.format("%dB", bytesPerSecond);
+        } else if (bytesPerSecond < 1000000) {
+            text.format("%.1fK", bytesPerSecond / 1000.0);
+        } else {
+            text.format("%.1fM", bytesPerSecond / 1000000.0);
+        }
+        return text;
+    }
+
+    // "42%", or "--" without a sample
+    Field formatPercent(bool valid, int32_t percent)
+    {
+        Field text("--");
+        if (valid) {
+            text.format("%d%%", percent);
+        }
+        return text;
+    }
+}
 
 SystemStatsScreen::SystemStatsScreen(std::shared_ptr<Display> display, std::shared_ptr<InputDevice> input)
     : ScreenModule(display, input)
 {
-    // Initialize last update time to 0
-    m_lastUpdate = {0, 0};
+    // Sample from startup so the screen opens with a minute of history
+    MetricsSampler::getInstance().start();
 }
 
 void SystemStatsScreen::enter()
@@ -29,56 +61,168 @@ void SystemStatsScreen::enter()
     m_display->drawText(0, 8, "----------------");
     usleep(Config::DISPLAY_CMD_DELAY);
     
-    // Reset last update time to force immediate update
-    m_lastUpdate = {0, 0};
+    m_graphEnabled = m_display->supportsBlit();
+    m_core = -1;
+
+    // Force immediate update
+    m_redrawNeeded = true;
     
     // Initial update of stats
     update();
 }
 
 void SystemStatsScreen::update()
+{
+    // The sampler runs on its own clock; redraw once per new sample
+    uint64_t generation = MetricsSampler::getInstance().getGeneration();
+    if (generation == m_drawnGeneration && !m_redrawNeeded) {
+        return;
+    }
+    m_drawnGeneration = generation;
+    m_redrawNeeded = false;
+
+    if (m_graphEnabled) {
+        drawSparklines();
+    } else {
+        drawBars();
+    }
+}
+
+void SystemStatsScreen::drawBars()
 {
     // Configure Y positions for the display elements
     const int CPU_LABEL_Y = 16;
     const int CPU_BAR_Y = 25;
     const int MEM_LABEL_Y = 42;
     const int MEM_BAR_Y = 51;
-    
-    // Update stats every STAT_UPDATE_SEC seconds
-    struct timeval now;
-    gettimeofday(&now, nullptr);
-    long timeDiffSec = (now.tv_sec - m_lastUpdate.tv_sec);
-    
-    if (timeDiffSec >= Config::STAT_UPDATE_SEC || m_lastUpdate.tv_sec == 0) {
-        // Get current system info
-        std::string cpuStr;
-        std::string memTotalStr;
-        std::string memFreeStr;
-        int cpuPercentage = 0;
-        int memPercentage = 0;
-        
-        // Get system info
-        getSystemInfo(cpuStr, memTotalStr, memFreeStr, cpuPercentage, memPercentage);
-        
-        // Update CPU label and value on the same line
-        m_display->drawText(0, CPU_LABEL_Y, "CPU:");
-        m_display->drawText(40, CPU_LABEL_Y, "    ");  // Clear old value
-        m_display->drawText(40, CPU_LABEL_Y, cpuStr);
-        
-        // CPU progress bar on the next line (full width)
-        m_display->drawProgressBar(0, CPU_BAR_Y, 128, 10, cpuPercentage);
-        
-        // Update Memory label and value on the same line
-        m_display->drawText(0, MEM_LABEL_Y, "Memory:");
-        m_display->drawText(55, MEM_LABEL_Y, "    ");  // Clear old value
-        m_display->drawText(55, MEM_LABEL_Y, memTotalStr);
-        
-        // Memory progress bar on the next line (full width)
-        m_display->drawProgressBar(0, MEM_BAR_Y, 128, 10, memPercentage);
-        
-        // Store current time as last update time
-        m_lastUpdate = now;
+
+    MetricsSampler& sampler = MetricsSampler::getInstance();
+    int32_t cpuPercentage = 0;
+    int32_t memPercentage = 0;
+    bool haveCpu = sampler.latest(MetricsSampler::Metric::CPU, cpuPercentage, m_core);
+    bool haveMemory = sampler.latest(MetricsSampler::Metric::MEMORY, memPercentage);
+
+    AllocationGuard guard("SystemStatsScreen::drawBars");
+    Field cpuStr = formatPercent(haveCpu, cpuPercentage);
+    Field memStr = formatPercent(haveMemory, memPercentage);
+    Field cpuLabel("CPU:");
+    if (m_core >= 0) {
+        cpuLabel.format("CPU%d:", m_core);
+    }
+
+    // Update CPU label and value on the same line
+    m_display->drawText(0, CPU_LABEL_Y, "     ");
+    m_display->drawText(0, CPU_LABEL_Y, cpuLabel);
+    m_display->drawText(40, CPU_LABEL_Y, "    ");  // Clear old value
+    m_display->drawText(40, CPU_LABEL_Y, cpuStr);
+
+    // CPU progress bar on the next line (full width)
+    m_display->drawProgressBar(0, CPU_BAR_Y, 128, 10, cpuPercentage);
+
+    // Update Memory label and value on the same line
+    m_display->drawText(0, MEM_LABEL_Y, "Memory:");
+    m_display->drawText(55, MEM_LABEL_Y, "    ");  // Clear old value
+    m_display->drawText(55, MEM_LABEL_Y, memStr);
+
+    // Memory progress bar on the next line (full width)
+    m_display->drawProgressBar(0, MEM_BAR_Y, 128, 10, memPercentage);
+}
+
+void SystemStatsScreen::drawSparklines()
+{
+    // y16 CPU figures, pages 3-4 CPU history, y40 memory/temperature,
+    // y48 network rates, page 7 network history
+    MetricsSampler& sampler = MetricsSampler::getInstance();
+    TextLine line;
+
+    {
+        // Text rows are formatted on the stack; the history copies below are not
+        AllocationGuard guard("SystemStatsScreen::drawSparklines");
+        int32_t cpu = 0;
+        int32_t load = 0;
+        bool haveCpu = sampler.latest(MetricsSampler::Metric::CPU, cpu, m_core);
+        bool haveLoad = sampler.latest(MetricsSampler::Metric::LOAD, load);
+        Field cpuLabel("CPU");
+        if (m_core >= 0) {
+            cpuLabel.format("CPU%d", m_core);
+        }
+        Field cpuValue = formatPercent(haveCpu, cpu);
+        if (haveLoad) {
+            line.format("%-4s %-4s L%d.%02d", cpuLabel.c_str(), cpuValue.c_str(), load / 100, load % 100);
+        } else {
+            line.format("%-4s %s", cpuLabel.c_str(), cpuValue.c_str());
+        }
+        m_display->drawText(0, 16, line.resize(16));
+    }
+    usleep(Config::DISPLAY_CMD_DELAY);
+    drawSparkline(sampler.history(MetricsSampler::Metric::CPU, m_core), 100, 3, 2);
+
+    {
+        AllocationGuard guard("SystemStatsScreen::drawSparklines");
+        int32_t memory = 0;
+        int32_t temperature = 0;
+        bool haveMemory = sampler.latest(MetricsSampler::Metric::MEMORY, memory);
+        Field memValue = formatPercent(haveMemory, memory);
+        if (sampler.latest(MetricsSampler::Metric::TEMPERATURE, temperature)) {
+            line.format("Mem %-4s  %3dC", memValue.c_str(), static_cast<int>(std::lround(temperature / 1000.0)));
+        } else {
+            line.format("Mem %s", memValue.c_str());
+        }
+        m_display->drawText(0, 40, line.resize(16));
+        usleep(Config::DISPLAY_CMD_DELAY);
+
+        int32_t rx = 0;
+        int32_t tx = 0;
+        if (sampler.latest(MetricsSampler::Metric::NET_RX, rx) && sampler.latest(MetricsSampler::Metric::NET_TX, tx)) {
+            line.format("R%-6s T%s", formatRate(rx).c_str(), formatRate(tx).c_str());
+        } else {
+            line.format("Net --");
+        }
+        m_display->drawText(0, 48, line.resize(16));
+    }
+    usleep(Config::DISPLAY_CMD_DELAY);
+
+    // Combined traffic, autoscaled to the busiest second in the window
+    std::vector<int32_t> received = sampler.history(MetricsSampler::Metric::NET_RX);
+    std::vector<int32_t> sent = sampler.history(MetricsSampler::Metric::NET_TX);
+    size_t count = std::min(received.size(), sent.size());
+    std::vector<int32_t> traffic(count);
+    int32_t peak = 0;
+    for (size_t i = 0; i < count; i++) {
+        int64_t total = static_cast<int64_t>(received[received.size() - count + i]) + sent[sent.size() - count + i];
+        traffic[i] = static_cast<int32_t>(std::min<int64_t>(total, 0x7FFFFFFF));
+        peak = std::max(peak, traffic[i]);
+    }
+    drawSparkline(traffic, peak, 7, 1);
+}
+
+void SystemStatsScreen::drawSparkline(const std::vector<int32_t>& values, int32_t scale, int firstPage, int pages)
+{
+    // Newest sample at the right edge, each sample a filled column
+    constexpr int WIDTH = Config::DISPLAY_WIDTH;
+    constexpr int COLUMN = std::max(1, Config::DISPLAY_WIDTH / Config::METRICS_HISTORY);
+    const int height = pages * 8;
+    std::vector<uint8_t> pixels(static_cast<size_t>(pages) * WIDTH, 0);
+
+    int x = WIDTH - static_cast<int>(values.size()) * COLUMN;
+    for (int32_t value : values) {
+        int bar = 0;
+        if (scale > 0 && value > 0) {
+            bar = std::max(1, static_cast<int>(std::lround(static_cast<double>(std::min(value, scale)) / scale * height)));
+        }
+        for (int column = x; column < x + COLUMN; column++) {
+            if (column < 0 || column >= WIDTH) continue;
+            for (int y = 0; y < bar; y++) {
+                int row = height - 1 - y;
+                pixels[(row / 8) * WIDTH + column] |= static_cast<uint8_t>(1 << (row % 8));
+            }
+        }
+        x += COLUMN;
     }
+
+    MonoFrame::Window window = {firstPage, firstPage + pages - 1, 0, WIDTH - 1};
+    m_display->blit(window, pixels.data());
+    usleep(Config::DISPLAY_CMD_DELAY);
 }
 
 void SystemStatsScreen::exit()
@@ -91,10 +235,12 @@ bool SystemStatsScreen::handleInput()
     // Check for button press to exit
     if (m_input->waitForEvents(100) > 0) {
         bool buttonPressed = false;
+        int rotation = 0;
         
         m_input->processEvents(
-            [](int) {
-                // Ignore rotation in this screen
+            [&](int direction) {
+                // Rotation cycles the CPU shown
+                rotation = direction;
             },
             [&]() {
                 // Button press exits
@@ -106,73 +252,33 @@ bool SystemStatsScreen::handleInput()
             m_display->updateActivityTimestamp();
             return false; // Exit module
         }
+        if (rotation != 0) {
+            m_display->updateActivityTimestamp();
+            selectCore(rotation);
+        }
     }
     
     return true; // Continue running
 }
 
-void SystemStatsScreen::getSystemInfo(std::string& cpu, std::string& memTotal, 
-                                     std::string& memFree, int& cpuPercentage, 
-                                     int& memPercentage)
+void SystemStatsScreen::selectCore(int direction)
 {
-    // Get CPU usage - this is a simple approximation from /proc/stat
-    static long prevIdle = 0;
-    static long prevTotal = 0;
-    
-    std::ifstream statFile("/proc/stat");
-    if (statFile) {
-        std::string line;
-        if (std::getline(statFile, line)) {
-            std::istringstream iss(line);
-            std::string cpu_label;
-            long user, nice, system, idle, iowait, irq, softirq;
-            
-            // Read CPU statistics
-            if (iss >> cpu_label >> user >> nice >> system >> idle >> iowait >> irq >> softirq) {
-                long total = user + nice + system + idle + iowait + irq + softirq;
-                long totalDiff = total - prevTotal;
-                long idleDiff = idle - prevIdle;
-                
-                // Calculate CPU usage percentage
-                cpuPercentage = 0;
-                if (totalDiff > 0) {
-                    cpuPercentage = static_cast<int>(100 * (totalDiff - idleDiff) / totalDiff);
-                }
-                
-                // Update previous values for next calculation
-                prevIdle = idle;
-                prevTotal = total;
-                
-                // Format CPU usage string
-                cpu = std::to_string(cpuPercentage) + "%";
-            } else {
-                cpu = "Err";
-                cpuPercentage = 0;
-            }
-        } else {
-            cpu = "Err";
-            cpuPercentage = 0;
-        }
-    } else {
-        cpu = "Err";
-        cpuPercentage = 0;
-    }
-    
-    // Get memory usage from sysinfo
-    struct sysinfo info;
-    if (sysinfo(&info) == 0) {
-        // Calculate memory usage
-        long totalRam = info.totalram * info.mem_unit;
-        long freeRam = info.freeram * info.mem_unit;
-        long usedRam = totalRam - freeRam;
-        memPercentage = static_cast<int>(100 * usedRam / totalRam);
-        
-        // Format strings
-        memTotal = std::to_string(memPercentage) + "%";
-        memFree = std::to_string(100 - memPercentage) + "%";
-    } else {
-        memTotal = "Err";
-        memFree = "Err";
-        memPercentage = 0;
+    // -1 (all), 0 .. cores-1, wrapping
+    int cores = MetricsSampler::getInstance().coreCount();
+    if (cores <= 1) {
+        return;
     }
+    m_core += direction > 0 ? 1 : -1;
+    if (m_core >= cores) m_core = -1;
+    if (m_core < -1) m_core = cores - 1;
+    m_redrawNeeded = true;
+    update();
 }
+
+// GPIO support methods
+void SystemStatsScreen::handleGPIORotation(int direction)
+{
+    selectCore(direction);
+}
+
+MICROPANEL_REGISTER_MODULE("system", SystemStatsScreen);
@@ -1,18 +1,38 @@
 #include "ScreenModules.h"
+#include "ModuleCatalog.h"
 #include "MenuSystem.h"
 #include "DeviceInterfaces.h"
 #include "Config.h"
 #include "Logger.h"
 #include "ModuleDependency.h"
+#include "CommandRunner.h"
+#include "Scheduler.h"
+#include <algorithm>
 #include <iostream>
+#include <cstdio>
+#include <cstdlib>
 #include <unistd.h>
 #include <vector>
-#include <cstdio>
+#include <sstream>
 #include <memory>
 #include <chrono>
 #include <thread>
 #include <map>
 
+namespace {
+    constexpr size_t STREAM_ROWS = 5;       // Lines 16-48; the status line sits at 56
+
+    std::string padLine(const std::string& text)
+    {
+        return text.size() >= 16 ? text.substr(0, 16) : text + std::string(16 - text.size(), ' ');
+    }
+
+    bool isEnabled(const std::string& value)
+    {
+        return value == "true" || value == "1" || value == "yes";
+    }
+}
+
 TextBoxScreen::TextBoxScreen(std::shared_ptr<Display> display, std::shared_ptr<InputDevice> input)
     : ScreenModule(display, input), m_shouldExit(false), m_refreshSeconds(0.0), m_moduleId("textbox")
 {
@@ -20,7 +40,7 @@ TextBoxScreen::TextBoxScreen(std::shared_ptr<Display> display, std::shared_ptr<I
 
 void TextBoxScreen::enter()
 {
-    Logger::debug("TextBoxScreen: Entered");
+    LOG_DEBUG("TextBoxScreen: Entered");
 
     // Reset state
     m_shouldExit = false;
@@ -28,23 +48,67 @@ void TextBoxScreen::enter()
 
     // Get refresh configuration
     m_refreshSeconds = getRefreshSeconds();
-    Logger::debug("TextBoxScreen (" + m_moduleId + "): Configured refresh interval: " + std::to_string(m_refreshSeconds) + " seconds");
-
-    // Initialize timing
-    m_lastExecutionTime = std::chrono::steady_clock::now();
+    LOG_DEBUG("TextBoxScreen (" + m_moduleId + "): Configured refresh interval: " + std::to_string(m_refreshSeconds) + " seconds");
+
+    // The script runs in the background; cached output is shown meanwhile
+    m_scriptPath = getScriptPath();
+    m_cacheTtlMs = getMillisecondsSetting("cache_ttl");
+    m_commandTimeoutMs = getMillisecondsSetting("command_timeout");
+
+    // Streaming screens keep one child running instead of rerunning the script
+    m_streamMode = isEnabled(ModuleDependency::getInstance().getDependencyPath(m_moduleId, "stream"));
+    if (m_streamMode) {
+        enterStream();
+        return;
+    }
 
     // Execute script and display output
     executeAndDisplay();
+
+    // Reruns start from the scheduler and stop while the display is dark;
+    // update() draws the result
+    if (m_refreshSeconds > 0.0) {
+        int intervalMs = std::max(1, static_cast<int>(m_refreshSeconds * 1000));
+        m_refreshJob = Scheduler::getInstance().add(m_moduleId + " refresh", intervalMs, Scheduler::Cost::HEAVY,
+                                                    true, [this]() { updateContentOnly(); });
+    }
 }
 
 void TextBoxScreen::update()
 {
-    // No periodic updates needed
+    if (m_streamMode) {
+        updateStream();
+        return;
+    }
+
+    // Redraw changed lines once a script run finishes
+    if (m_scriptPath.empty()) {
+        return;
+    }
+    CommandRunner::Result result = CommandRunner::getInstance().peek(m_scriptPath);
+    if (!result.available || result.generation == m_outputGeneration) {
+        return;
+    }
+    m_outputGeneration = result.generation;
+
+    std::vector<std::string> newLines = result.failed ? std::vector<std::string>{"Error: Script failed"}
+                                                      : outputLines(result.output);
+    updateChangedLinesOnly(newLines);
+    m_previousContent = newLines;
 }
 
 void TextBoxScreen::exit()
 {
-    Logger::debug("TextBoxScreen: Exiting");
+    LOG_DEBUG("TextBoxScreen: Exiting");
+    if (m_refreshJob >= 0) {
+        Scheduler::getInstance().remove(m_refreshJob);
+        m_refreshJob = -1;
+    }
+    if (m_streamId >= 0) {
+        CommandRunner::getInstance().closeStream(m_streamId);
+        m_streamId = -1;
+    }
+
     // Clear display
     m_display->clear();
     usleep(Config::DISPLAY_CMD_DELAY * 3);
@@ -54,62 +118,146 @@ bool TextBoxScreen::handleInput()
 {
     // Check for user input (with short timeout for responsive input)
     if (m_input->waitForEvents(100) > 0) {
-        bool buttonPressed = false;
-        bool rotationDetected = false;
-
-        m_input->processEvents(
-            [&rotationDetected](int direction) {
-                // Exit on any rotation
-                rotationDetected = true;
-            },
-            [&buttonPressed]() {
-                // Exit on button press
-                buttonPressed = true;
-            }
-        );
+        m_input->processEvents([this](const InputEvent& event) {
+            handleInputEvent(event);
+        });
+    }
 
-        // Exit on any input
-        if (buttonPressed || rotationDetected) {
-            return false; // Exit the screen
-        }
+    return !m_shouldExit; // Continue running unless exit flag is set
+}
+
+bool TextBoxScreen::handleInputEvent(const InputEvent& event)
+{
+    // Streams scroll with the encoder and exit on a press
+    if (m_streamMode) {
+        bool keepRunning = ScreenModule::handleInputEvent(event);
+        m_shouldExit = !keepRunning;
+        return keepRunning;
     }
 
-    // Handle periodic refresh if enabled
-    if (m_refreshSeconds > 0.0) {
-        auto now = std::chrono::steady_clock::now();
-        auto timeSinceLastExecution = std::chrono::duration_cast<std::chrono::milliseconds>(now - m_lastExecutionTime);
-        auto refreshIntervalMs = std::chrono::milliseconds(static_cast<long>(m_refreshSeconds * 1000));
-
-        // Debug timing information (only every 10th check to reduce spam)
-        static int debugCounter = 0;
-        if (++debugCounter % 10 == 0) {
-            Logger::debug("TextBoxScreen (" + m_moduleId + "): Time since last execution: " + std::to_string(timeSinceLastExecution.count()) + "ms, interval: " + std::to_string(refreshIntervalMs.count()) + "ms");
+    // Exit on any input
+    (void)event;
+    m_shouldExit = true;
+    return false;
+}
+
+void TextBoxScreen::handleGPIORotation(int direction)
+{
+    if (!m_streamMode || direction == 0) {
+        return;
+    }
+    // Up goes back in time; reaching the newest line follows again
+    size_t steps = static_cast<size_t>(std::abs(direction));
+    if (direction < 0) {
+        m_scrollOffset += steps;
+    } else {
+        m_scrollOffset = m_scrollOffset > steps ? m_scrollOffset - steps : 0;
+    }
+    m_streamRedraw = true;
+}
+
+void TextBoxScreen::enterStream()
+{
+    m_display->clear();
+    usleep(Config::DISPLAY_CMD_DELAY * 3);
+
+    std::string title = getTitle().empty() ? "Info" : getTitle();
+    int titlePos = std::max(0, (16 - static_cast<int>(title.length())) / 2);
+    m_display->drawText(titlePos, 0, title);
+    usleep(Config::DISPLAY_CMD_DELAY);
+    m_display->drawText(0, 8, "----------------");
+    usleep(Config::DISPLAY_CMD_DELAY);
+
+    int scrollback = Config::TEXTBOX_SCROLLBACK_LINES;
+    std::string value = ModuleDependency::getInstance().getDependencyPath(m_moduleId, "scrollback");
+    if (!value.empty()) {
+        try {
+            scrollback = std::stoi(value);
+        } catch (const std::exception& e) {
+            LOG_DEBUG("Failed to parse scrollback value: " + value);
+        }
+    }
+    scrollback = std::max(static_cast<int>(STREAM_ROWS), std::min(scrollback, Config::TEXTBOX_SCROLLBACK_MAX));
+    m_scrollback.reset(static_cast<size_t>(scrollback));
+
+    m_drawnTotal = 0;
+    m_scrollOffset = 0;
+    m_streamEnded = false;
+    m_streamRows.assign(STREAM_ROWS + 1, std::string());
+
+    // Lines arrive from CommandRunner::poll(), which the main loop runs as the pipe fills
+    CommandRunner& commands = CommandRunner::getInstance();
+    if (m_streamId >= 0) {
+        commands.closeStream(m_streamId);
+    }
+    m_streamId = m_scriptPath.empty() ? -1 : commands.openStream(m_scriptPath, [this](const std::string& line) {
+        m_scrollback.push(replaceUnicodeChars(line));
+        if (m_scrollOffset > 0) {
+            m_scrollOffset++;   // Keep a scrolled-back view on the same lines
         }
+    });
+    if (m_streamId < 0) {
+        m_scrollback.push(m_scriptPath.empty() ? "Error: No script" : "Error: Script failed");
+        m_streamEnded = true;
+    }
+    LOG_DEBUG("TextBoxScreen (" + m_moduleId + "): Streaming with " + std::to_string(scrollback) +
+                  " lines of scrollback");
+
+    m_streamRedraw = true;
+    drawStream();
+}
 
-        // Check if it's time for a refresh
-        if (timeSinceLastExecution >= refreshIntervalMs) {
-            Logger::debug("TextBoxScreen (" + m_moduleId + "): Refreshing content");
+void TextBoxScreen::updateStream()
+{
+    CommandRunner& commands = CommandRunner::getInstance();
+    commands.poll();
+    if (!m_streamEnded && !commands.isStreamRunning(m_streamId)) {
+        m_streamEnded = true;
+        m_streamRedraw = true;
+    }
 
-            // Record start time for script execution
-            auto scriptStartTime = std::chrono::steady_clock::now();
+    // Nothing new and no scrolling: nothing to send
+    if (m_streamRedraw || m_scrollback.total() != m_drawnTotal) {
+        drawStream();
+    }
+}
 
-            // Update content (this executes the script)
-            updateContentOnly();
+void TextBoxScreen::drawStream()
+{
+    m_streamRedraw = false;
+    m_drawnTotal = m_scrollback.total();
 
-            // Calculate script execution time
-            auto scriptEndTime = std::chrono::steady_clock::now();
-            auto scriptExecutionTime = std::chrono::duration_cast<std::chrono::milliseconds>(scriptEndTime - scriptStartTime);
+    size_t size = m_scrollback.size();
+    size_t maxOffset = size > STREAM_ROWS ? size - STREAM_ROWS : 0;
+    m_scrollOffset = std::min(m_scrollOffset, maxOffset);
+    size_t first = size > STREAM_ROWS + m_scrollOffset ? size - STREAM_ROWS - m_scrollOffset : 0;
 
-            // Update last execution time
-            m_lastExecutionTime = scriptStartTime;
+    std::vector<std::string> rows(STREAM_ROWS + 1);
+    for (size_t row = 0; row < STREAM_ROWS && first + row < size; row++) {
+        rows[row] = m_scrollback.at(first + row);
+    }
+    if (size == 0) {
+        rows[0] = m_streamEnded ? "No output" : "Waiting...";
+    }
 
-            Logger::debug("TextBoxScreen (" + m_moduleId + "): Script execution took " + std::to_string(scriptExecutionTime.count()) + "ms");
+    // Status line: state and the line count, or how far back the view is
+    char status[32];
+    const char* state = m_streamEnded ? "Ended" : (m_scrollOffset == 0 ? "Live" : "Back");
+    std::string position = m_scrollOffset == 0 ? std::to_string(m_scrollback.total())
+                                               : "-" + std::to_string(m_scrollOffset);
+    snprintf(status, sizeof(status), "%-6s%10s", state, position.c_str());
+    rows[STREAM_ROWS] = status;
+
+    // Only changed rows go out; following a busy log mostly shifts every row
+    // once per update, however many lines arrived
+    for (size_t row = 0; row < rows.size(); row++) {
+        std::string line = padLine(rows[row]);
+        if (line != m_streamRows[row]) {
+            m_display->drawText(0, 16 + static_cast<int>(row) * 8, line);
+            usleep(Config::DISPLAY_CMD_DELAY);
+            m_streamRows[row] = line;
         }
-    } else {
-        Logger::debug("TextBoxScreen (" + m_moduleId + "): Static mode - no refresh configured");
     }
-
-    return !m_shouldExit; // Continue running unless exit flag is set
 }
 
 void TextBoxScreen::executeAndDisplay()
@@ -128,8 +276,9 @@ void TextBoxScreen::executeAndDisplay()
     m_display->drawText(0, 8, "----------------");
     usleep(Config::DISPLAY_CMD_DELAY);
 
-    // Execute script and get output
-    std::vector<std::string> lines = executeScript();
+    // Last known output right away; a fresh run is picked up by update()
+    bool loading = false;
+    std::vector<std::string> lines = executeScript(m_cacheTtlMs, loading);
 
     // Display up to 4 lines of output (lines 16, 24, 32, 40)
     int yPositions[] = {16, 24, 32, 40};
@@ -154,11 +303,16 @@ void TextBoxScreen::executeAndDisplay()
         usleep(Config::DISPLAY_CMD_DELAY);
     }
 
-    // If no output or error, show message
-    if (lines.empty()) {
+    // Nothing cached yet, or no output at all
+    if (loading) {
+        m_display->drawText(0, 16, "Loading...");
+        usleep(Config::DISPLAY_CMD_DELAY);
+    } else if (lines.empty()) {
         m_display->drawText(0, 16, "No output");
         usleep(Config::DISPLAY_CMD_DELAY);
     }
+    // Lines on screen, so update() only redraws what changes
+    m_previousContent = loading ? std::vector<std::string>{"Loading..."} : lines;
 
     // Draw instruction at bottom
     m_display->drawText(0, 48, "Press to return");
@@ -167,14 +321,10 @@ void TextBoxScreen::executeAndDisplay()
 
 void TextBoxScreen::updateContentOnly()
 {
-    // Execute script and get new output
-    std::vector<std::string> newLines = executeScript();
-
-    // Compare with previous content and update only changed lines
-    updateChangedLinesOnly(newLines);
-
-    // Store current content for next comparison
-    m_previousContent = newLines;
+    // Rerun unless another screen refreshed the same script within the interval
+    bool loading = false;
+    int intervalMs = static_cast<int>(m_refreshSeconds * 1000);
+    executeScript(intervalMs, loading);
 }
 
 void TextBoxScreen::updateChangedLinesOnly(const std::vector<std::string>& newLines)
@@ -190,7 +340,7 @@ void TextBoxScreen::updateChangedLinesOnly(const std::vector<std::string>& newLi
 
         // Only update this line if content changed
         if (newLine != oldLine) {
-            Logger::debug("TextBoxScreen (" + m_moduleId + "): Updating line " + std::to_string(i) + ": '" + newLine + "'");
+            LOG_DEBUG("TextBoxScreen (" + m_moduleId + "): Updating line " + std::to_string(i) + ": '" + newLine + "'");
             updateSingleLine(i, newLine, contentYPositions[i]);
         }
     }
@@ -199,7 +349,7 @@ void TextBoxScreen::updateChangedLinesOnly(const std::vector<std::string>& newLi
     // Clear any leftover lines from previous longer output
     if (newLines.size() < m_previousContent.size()) {
         for (size_t i = newLines.size(); i < m_previousContent.size() && i < maxDisplayLines; ++i) {
-            Logger::debug("TextBoxScreen (" + m_moduleId + "): Clearing line " + std::to_string(i));
+            LOG_DEBUG("TextBoxScreen (" + m_moduleId + "): Clearing line " + std::to_string(i));
             updateSingleLine(i, "", contentYPositions[i]); // Clear line
         }
     }
@@ -211,7 +361,7 @@ void TextBoxScreen::updateChangedLinesOnly(const std::vector<std::string>& newLi
     if (hadContent != hasContent) {
         if (!hasContent) {
             // Show "No output" message
-            Logger::debug("TextBoxScreen (" + m_moduleId + "): Showing 'No output' message");
+            LOG_DEBUG("TextBoxScreen (" + m_moduleId + "): Showing 'No output' message");
             updateSingleLine(0, "No output", contentYPositions[0]);
         }
         // If we now have content, the lines above will be updated naturally
@@ -246,36 +396,39 @@ void TextBoxScreen::updateSingleLine(size_t lineIndex, const std::string& conten
     usleep(Config::DISPLAY_CMD_DELAY);
 }
 
-std::vector<std::string> TextBoxScreen::executeScript()
+std::vector<std::string> TextBoxScreen::executeScript(int ttlMs, bool& loading)
 {
     std::vector<std::string> lines;
+    loading = false;
 
     // Get script path from configuration
-    std::string scriptPath = getScriptPath();
-    if (scriptPath.empty()) {
+    if (m_scriptPath.empty()) {
         lines.push_back("Error: No script");
         return lines;
     }
 
-    // Execute the script and capture output
-    std::unique_ptr<FILE, decltype(&pclose)> pipe(
-        popen(scriptPath.c_str(), "r"), pclose);
-
-    if (!pipe) {
+    // Cached output, with a background run when it is older than ttlMs
+    CommandRunner::Result result = CommandRunner::getInstance().request(m_scriptPath, ttlMs, m_commandTimeoutMs);
+    m_outputGeneration = result.generation;
+    if (!result.available) {
+        loading = true;
+        return lines;
+    }
+    if (result.failed) {
         lines.push_back("Error: Script failed");
         return lines;
     }
+    return outputLines(result.output);
+}
 
-    // Read script output line by line
-    char buffer[128];
-    while (fgets(buffer, sizeof(buffer), pipe.get()) != nullptr) {
-        std::string line(buffer);
-
-        // Remove trailing newline
-        if (!line.empty() && line.back() == '\n') {
-            line.pop_back();
-        }
+std::vector<std::string> TextBoxScreen::outputLines(const std::string& output) const
+{
+    std::vector<std::string> lines;
+    std::istringstream stream(output);
+    std::string line;
 
+    // Read script output line by line
+    while (std::getline(stream, line)) {
         // Skip empty lines
         if (!line.empty()) {
             lines.push_back(line);
@@ -291,14 +444,14 @@ std::string TextBoxScreen::getScriptPath()
     std::string scriptPath = dependencies.getDependencyPath(m_moduleId, "script_path");
 
     if (scriptPath.empty()) {
-        Logger::debug("No script_path dependency found for " + m_moduleId + ", using default");
+        LOG_DEBUG("No script_path dependency found for " + m_moduleId + ", using default");
         return "/usr/bin/micropanel-version.sh";  // fallback default
     }
 
     // Apply runtime parameter substitution
     scriptPath = substituteParameters(scriptPath);
 
-    Logger::debug("TextBoxScreen: Using script path: " + scriptPath);
+    LOG_DEBUG("TextBoxScreen: Using script path: " + scriptPath);
     return scriptPath;
 }
 
@@ -308,7 +461,7 @@ std::string TextBoxScreen::getTitle()
     std::string title = dependencies.getDependencyPath(m_moduleId, "display_title");
 
     if (title.empty()) {
-        Logger::debug("No display_title dependency found for " + m_moduleId + ", using default");
+        LOG_DEBUG("No display_title dependency found for " + m_moduleId + ", using default");
         return "Info";  // fallback default
     }
 
@@ -324,47 +477,52 @@ double TextBoxScreen::getRefreshSeconds()
     std::string refreshStr = dependencies.getDependencyPath(m_moduleId, "refresh_sec");
 
     if (refreshStr.empty()) {
-        Logger::debug("No refresh_sec dependency found for " + m_moduleId + ", using static mode");
+        LOG_DEBUG("No refresh_sec dependency found for " + m_moduleId + ", using static mode");
         return 0.0;  // 0.0 means static mode (no refresh)
     }
 
     try {
         double refreshSeconds = std::stod(refreshStr);
         if (refreshSeconds <= 0.0) {
-            Logger::debug("Invalid refresh_sec value, using static mode");
+            LOG_DEBUG("Invalid refresh_sec value, using static mode");
             return 0.0;
         }
-        Logger::debug("TextBoxScreen: Using refresh interval: " + std::to_string(refreshSeconds) + " seconds");
+        LOG_DEBUG("TextBoxScreen: Using refresh interval: " + std::to_string(refreshSeconds) + " seconds");
         return refreshSeconds;
     } catch (const std::exception& e) {
-        Logger::debug("Failed to parse refresh_sec value: " + refreshStr + ", using static mode");
+        LOG_DEBUG("Failed to parse refresh_sec value: " + refreshStr + ", using static mode");
         return 0.0;
     }
 }
 
-// GPIO support methods
-void TextBoxScreen::handleGPIORotation(int direction) {
-    // Exit on any GPIO rotation
-    m_shouldExit = true;
-}
-
-bool TextBoxScreen::handleGPIOButtonPress() {
-    // Exit on GPIO button press
-    return false;
+int TextBoxScreen::getMillisecondsSetting(const std::string& key)
+{
+    // Seconds in the module's depends block; 0 when missing or invalid
+    std::string value = ModuleDependency::getInstance().getDependencyPath(m_moduleId, key);
+    if (value.empty()) {
+        return 0;
+    }
+    try {
+        return std::max(0, static_cast<int>(std::stod(value) * 1000));
+    } catch (const std::exception& e) {
+        LOG_DEBUG("Failed to parse " + key + " value: " + value);
+        return 0;
+    }
 }
 
+// GPIO support methods
 void TextBoxScreen::setId(const std::string& id) {
     m_moduleId = id;
-    Logger::debug("TextBoxScreen: Set dynamic ID to: " + id);
+    LOG_DEBUG("TextBoxScreen: Set dynamic ID to: " + id);
 }
 
 void TextBoxScreen::setRuntimeParameters(const std::map<std::string, std::string>& params) {
     m_runtimeParams = params;
-    Logger::debug("TextBoxScreen (" + m_moduleId + "): Set " + std::to_string(params.size()) + " runtime parameters");
+    LOG_DEBUG("TextBoxScreen (" + m_moduleId + "): Set " + std::to_string(params.size()) + " runtime parameters");
 
     // Debug: Log all parameters
     for (const auto& param : params) {
-        Logger::debug("  " + param.first + " = " + param.second);
+        LOG_DEBUG("  " + param.first + " = " + param.second);
     }
 }
 
@@ -401,9 +559,11 @@ std::string TextBoxScreen::substituteParameters(const std::string& input) {
             result.replace(pos, placeholder.length(), param.second);
             pos += param.second.length();
 
-            Logger::debug("TextBoxScreen: Substituted " + placeholder + " → " + param.second);
+            LOG_DEBUG("TextBoxScreen: Substituted " + placeholder + " → " + param.second);
         }
     }
 
     return result;
-}
\ No newline at end of file
+}
+
+MICROPANEL_REGISTER_MODULE("textbox", TextBoxScreen);
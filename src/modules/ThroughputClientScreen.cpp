@@ -1,10 +1,16 @@
 #include "ScreenModules.h"
+#include "ModuleCatalog.h"
 #include "MenuSystem.h"
 #include "DeviceInterfaces.h"
 #include "IPSelector.h"
 #include "Logger.h"
 #include "Config.h"
 #include "ModuleDependency.h"
+#include "PerfCounters.h"
+#include "HistoryLog.h"
+#include "IPSuggestions.h"
+#include "AllocationCounter.h"
+#include "TextLine.h"
 #include <iostream>
 #include <unistd.h>
 #include <fcntl.h>
@@ -14,15 +20,70 @@
 #include <thread>
 #include <atomic>
 #include <csignal>
+#include <spawn.h>
 #include <sys/wait.h>
-#include <fstream>
 #include <sstream>
 #include <vector>
 #include <algorithm>
 #include <regex>
-#include <set>
+#include <cerrno>
+#include <cstring>
 #include <iomanip>
 
+using json = nlohmann::json;
+
+namespace {
+    // Bandwidth setting in Mbps: "Auto", "500M", "2.5G"
+    void appendBandwidthSetting(TextLine& line, int value)
+    {
+        if (value == 0) {
+            line.append("Auto");
+        } else if (value >= 1000) {
+            // One decimal, dropped for whole gigabits
+            BasicTextLine<16> gbps;
+            gbps.format("%.1f", value / 1000.0);
+            size_t length = gbps.size();
+            if (length >= 2 && gbps[length - 1] == '0' && gbps[length - 2] == '.') {
+                length -= 2;
+            }
+            line.append(gbps.data(), length).append('G');
+        } else {
+            line.appendf("%dM", value);
+        }
+    }
+
+    // Measured rate in Mbps: "850Kbps", "94.1Mbps", "9.41Gbps"
+    void appendBandwidth(TextLine& line, double value)
+    {
+        if (value < 1.0) {
+            line.appendf("%gKbps", value * 1000.0);
+        } else if (value < 1000.0) {
+            line.appendf("%.1fMbps", value);
+        } else {
+            line.appendf("%.2fGbps", value / 1000.0);
+        }
+    }
+
+    // Dotted quad without leading zeros ("192.168.001.001" -> "192.168.1.1")
+    void appendIp(TextLine& line, const std::string& ip)
+    {
+        const char* cursor = ip.c_str();
+        while (*cursor) {
+            char* end = nullptr;
+            long octet = std::strtol(cursor, &end, 10);
+            if (end == cursor) {
+                break;
+            }
+            line.appendf("%ld", octet);
+            cursor = end;
+            if (*cursor == '.') {
+                line.append('.');
+                cursor++;
+            }
+        }
+    }
+}
+
 ThroughputClientScreen::ThroughputClientScreen(std::shared_ptr<Display> display, std::shared_ptr<InputDevice> input)
     : ScreenModule(display, input),
       m_state(ThroughputClientState::MENU_STATE_START),
@@ -43,8 +104,7 @@ ThroughputClientScreen::ThroughputClientScreen(std::shared_ptr<Display> display,
       m_jitter_result(0.0),
       m_loss_result(0.0),
       m_retransmits_result(0),
-      m_discoveryInProgress(false),
-      m_discoveryPid(-1)
+      m_discoveryInProgress(false)
 {
     // Initialize menu options
     m_protocolOptions = {"TCP", "UDP"};
@@ -58,7 +118,7 @@ ThroughputClientScreen::ThroughputClientScreen(std::shared_ptr<Display> display,
     // Create IP Selector with callback
     auto callback = [this](const std::string& ip) {
         m_serverIp = ip;
-        Logger::debug("ThroughputClientScreen: Server IP changed to: " + ip);
+        LOG_DEBUG("ThroughputClientScreen: Server IP changed to: " + ip);
     };
 
     // Create redraw callback to update menu
@@ -69,18 +129,17 @@ ThroughputClientScreen::ThroughputClientScreen(std::shared_ptr<Display> display,
     };
 
     m_ipSelector = std::make_unique<IPSelector>(m_serverIp, 16, callback, redrawCallback);
+    m_ipSelector->enableSuggestions();
 }
 
 ThroughputClientScreen::~ThroughputClientScreen() {
     // Terminate any ongoing processes
-    if (m_testInProgress && m_testPid > 0) {
-        kill(m_testPid, SIGTERM);
-        waitpid(m_testPid, nullptr, 0);
+    if (m_testInProgress) {
+        stopTest();
     }
 
-    if (m_discoveryInProgress && m_discoveryPid > 0) {
-        kill(m_discoveryPid, SIGTERM);
-        waitpid(m_discoveryPid, nullptr, 0);
+    if (m_discoveryInProgress) {
+        MdnsBrowser::getInstance().cancel();
     }
 }
 
@@ -90,6 +149,23 @@ void ThroughputClientScreen::refreshSettings() {
     // Try to get iperf3 path
     std::string iperf3Path = dependencies.getDependencyPath("throughputclient", "iperf3_path");
 
+    // The built-in client is the default; "iperf3" runs the external binary instead
+    std::string engine = dependencies.getDependencyPath("throughputclient", "client_engine");
+    m_useNativeEngine = engine != "iperf3";
+
+    // Service types for Auto-Discover, comma-separated; iperf3 servers by default
+    std::string services = dependencies.getDependencyPath("throughputclient", "mdns_services");
+    m_discoveryServiceTypes.clear();
+    std::istringstream serviceStream(services.empty() ? "_iperf3._tcp" : services);
+    std::string serviceType;
+    while (std::getline(serviceStream, serviceType, ',')) {
+        serviceType.erase(0, serviceType.find_first_not_of(" \t"));
+        serviceType.erase(serviceType.find_last_not_of(" \t") + 1);
+        if (!serviceType.empty()) {
+            m_discoveryServiceTypes.push_back(serviceType);
+        }
+    }
+
     // Try to get port
     std::string portStr = dependencies.getDependencyPath("throughputclient", "default_port");
     if (!portStr.empty()) {
@@ -97,7 +173,7 @@ void ThroughputClientScreen::refreshSettings() {
             int port = std::stoi(portStr);
             if (port > 0 && port < 65536) {
                 m_serverPort = port;
-                Logger::debug("ThroughputClientScreen: Using configured port: " + std::to_string(m_serverPort));
+                LOG_DEBUG("ThroughputClientScreen: Using configured port: " + std::to_string(m_serverPort));
             }
         } catch (...) {
             Logger::warning("ThroughputClientScreen: Invalid port value in config, using default 5201");
@@ -110,7 +186,7 @@ void ThroughputClientScreen::refreshSettings() {
         std::transform(protocol.begin(), protocol.end(), protocol.begin(), ::toupper);
         if (protocol == "TCP" || protocol == "UDP") {
             m_protocol = protocol;
-            Logger::debug("ThroughputClientScreen: Using configured protocol: " + m_protocol);
+            LOG_DEBUG("ThroughputClientScreen: Using configured protocol: " + m_protocol);
         }
     }
 
@@ -121,7 +197,7 @@ void ThroughputClientScreen::refreshSettings() {
             int duration = std::stoi(durationStr);
             if (duration > 0) {
                 m_duration = duration;
-                Logger::debug("ThroughputClientScreen: Using configured duration: " + std::to_string(m_duration));
+                LOG_DEBUG("ThroughputClientScreen: Using configured duration: " + std::to_string(m_duration));
             }
         } catch (...) {
             Logger::warning("ThroughputClientScreen: Invalid duration value in config, using default 10s");
@@ -135,7 +211,7 @@ void ThroughputClientScreen::refreshSettings() {
             int bandwidth = std::stoi(bandwidthStr);
             if (bandwidth >= 0) {
                 m_bandwidth = bandwidth;
-                Logger::debug("ThroughputClientScreen: Using configured bandwidth: " + std::to_string(m_bandwidth) + " Mbps");
+                LOG_DEBUG("ThroughputClientScreen: Using configured bandwidth: " + std::to_string(m_bandwidth) + " Mbps");
             }
         } catch (...) {
             Logger::warning("ThroughputClientScreen: Invalid bandwidth value in config, using default 0 (Auto)");
@@ -149,7 +225,7 @@ void ThroughputClientScreen::refreshSettings() {
             int parallel = std::stoi(parallelStr);
             if (parallel > 0) {
                 m_parallel = parallel;
-                Logger::debug("ThroughputClientScreen: Using configured parallel: " + std::to_string(m_parallel));
+                LOG_DEBUG("ThroughputClientScreen: Using configured parallel: " + std::to_string(m_parallel));
             }
         } catch (...) {
             Logger::warning("ThroughputClientScreen: Invalid parallel value in config, using default 1");
@@ -167,7 +243,7 @@ void ThroughputClientScreen::refreshSettings() {
             if (m_ipSelector) {
                 m_ipSelector->setIp(m_serverIp);
             }
-            Logger::debug("ThroughputClientScreen: Using configured server IP: " + m_serverIp);
+            LOG_DEBUG("ThroughputClientScreen: Using configured server IP: " + m_serverIp);
         }
       }
       firstLoad=false;
@@ -175,7 +251,7 @@ void ThroughputClientScreen::refreshSettings() {
 }
 
 void ThroughputClientScreen::enter() {
-    Logger::debug("ThroughputClientScreen: Entered");
+    LOG_DEBUG("ThroughputClientScreen: Entered");
 
     // Reset state
     m_state = ThroughputClientState::MENU_STATE_START;
@@ -185,8 +261,8 @@ void ThroughputClientScreen::enter() {
     m_testInProgress = false;
     m_testPid = -1;
     m_testResult = -1;
+    m_intervalCount = 0;
     m_discoveryInProgress = false;
-    m_discoveryPid = -1;
     m_statusMessage.clear();
     m_statusChanged = true;
 
@@ -214,27 +290,18 @@ void ThroughputClientScreen::enter() {
 }
 
 void ThroughputClientScreen::exit() {
-    Logger::debug("ThroughputClientScreen: Exiting");
+    LOG_DEBUG("ThroughputClientScreen: Exiting");
 
     // Terminate any ongoing test or discovery
-    if (m_testInProgress && m_testPid > 0) {
-        kill(m_testPid, SIGTERM);
-        waitpid(m_testPid, nullptr, 0);
-        m_testInProgress = false;
-        m_testPid = -1;
+    if (m_testInProgress) {
+        stopTest();
     }
 
-    if (m_discoveryInProgress && m_discoveryPid > 0) {
-        kill(m_discoveryPid, SIGTERM);
-        waitpid(m_discoveryPid, nullptr, 0);
+    if (m_discoveryInProgress) {
+        MdnsBrowser::getInstance().cancel();
         m_discoveryInProgress = false;
-        m_discoveryPid = -1;
     }
 
-    // Clean up temporary files if they exist
-    unlink("/tmp/micropanel_iperf_result.txt");
-    unlink("/tmp/micropanel_avahi_result.txt");
-
     // Clear display
     m_display->clear();
     usleep(Config::DISPLAY_CMD_DELAY * 3);
@@ -261,48 +328,67 @@ bool ThroughputClientScreen::isIperf3Available() const {
     return (access(iperf3Path.c_str(), X_OK) == 0);
 }
 
-bool ThroughputClientScreen::isAvahiAvailable() const {
-    return (system("which avahi-browse > /dev/null 2>&1") == 0);
-}
+void ThroughputClientScreen::probeIperf3Options() {
+    // One "iperf3 --help" per binary; its flags do not change while we run
+    std::string path = getIperf3Path();
+    if (path == m_probedIperf3) {
+        return;
+    }
+    m_probedIperf3 = path;
+    m_iperf3JsonStream = false;
+    m_iperf3ForceFlush = false;
 
-std::string ThroughputClientScreen::getBandwidthString(int value) const {
-//    if (value <= 0) {
-//        return "Auto";
-//    }
-//    return std::to_string(value) + " Mbps";
-    if (value == 0) {
-        return "Auto";
-    } else if (value >= 1000) {
-        // Format as Gbps with one decimal point if needed
-        double gbps = value / 1000.0;
-        std::ostringstream stream;
-        stream << std::fixed << std::setprecision(1) << gbps;
-        std::string gbpsStr = stream.str();
-        // Remove trailing zeros and decimal point if it's a whole number
-        if (gbpsStr.find('.') != std::string::npos) {
-            gbpsStr = gbpsStr.substr(0, gbpsStr.find_last_not_of('0') + 1);
-            if (gbpsStr.back() == '.') {
-                gbpsStr.pop_back();
-            }
+    int fds[2];
+    if (pipe2(fds, O_CLOEXEC) != 0) {
+        Logger::error("ThroughputClientScreen: Failed to create probe pipe");
+        return;
+    }
+    posix_spawn_file_actions_t actions;
+    posix_spawn_file_actions_init(&actions);
+    posix_spawn_file_actions_adddup2(&actions, fds[1], STDOUT_FILENO);
+    posix_spawn_file_actions_adddup2(&actions, fds[1], STDERR_FILENO);
+    const char* argv[] = {path.c_str(), "--help", nullptr};
+    pid_t pid = -1;
+    int error = posix_spawn(&pid, path.c_str(), &actions, nullptr, const_cast<char* const*>(argv), environ);
+    posix_spawn_file_actions_destroy(&actions);
+    close(fds[1]);
+    if (error != 0) {
+        Logger::warning("ThroughputClientScreen: Failed to run " + path + " --help: " + strerror(error));
+        close(fds[0]);
+        return;
+    }
+    PerfCounters::getInstance().add(PerfCounters::Counter::CHILD_PROCESSES);
+
+    std::string help;
+    char buffer[4096];
+    ssize_t n;
+    while ((n = read(fds[0], buffer, sizeof(buffer))) != 0) {
+        if (n > 0) {
+            help.append(buffer, n);
+        } else if (errno != EINTR) {
+            break;
         }
-        return gbpsStr + "G";
-    } else {
-        return std::to_string(value) + "M";
     }
+    close(fds[0]);
+    while (waitpid(pid, nullptr, 0) < 0 && errno == EINTR) {
+    }
+
+    m_iperf3JsonStream = help.find("--json-stream") != std::string::npos;
+    m_iperf3ForceFlush = help.find("--forceflush") != std::string::npos;
+    LOG_DEBUG("ThroughputClientScreen: " + path + (m_iperf3JsonStream ? " has" : " lacks") + " --json-stream, " +
+              (m_iperf3ForceFlush ? "has" : "lacks") + " --forceflush");
+}
+
+std::string ThroughputClientScreen::getBandwidthString(int value) const {
+    TextLine line;
+    appendBandwidthSetting(line, value);
+    return line.str();
 }
 
 std::string ThroughputClientScreen::formatBandwidth(double value) const {
-    std::ostringstream oss;
-    if (value < 1.0) {
-        oss << value * 1000.0 << "Kbps";
-    } else if (value < 1000.0) {
-        oss.precision(1);
-        oss << std::fixed << value << "Mbps";
-    } else {
-        oss.precision(2);
-        oss << std::fixed << (value / 1000.0) << "Gbps";
-    }
-    return oss.str();
+    TextLine line;
+    appendBandwidth(line, value);
+    return line.str();
 }
 // Menu rendering methods
 
@@ -352,9 +438,10 @@ void ThroughputClientScreen::update() {
 
 void ThroughputClientScreen::renderMainMenu(bool fullRedraw) {
     // Define all menu states in order - ADD THE NEW STATE
-    const std::vector<ThroughputClientState> menuStates = {
+    static const ThroughputClientState menuStates[] = {
         ThroughputClientState::MENU_STATE_START,
         ThroughputClientState::MENU_STATE_START_REVERSE, // Add the new state
+        ThroughputClientState::MENU_STATE_START_LATENCY,
         ThroughputClientState::MENU_STATE_PROTOCOL,
         ThroughputClientState::MENU_STATE_DURATION,
         ThroughputClientState::MENU_STATE_BANDWIDTH,
@@ -368,9 +455,11 @@ void ThroughputClientScreen::renderMainMenu(bool fullRedraw) {
         return;
     }
 
+    const int menuCount = static_cast<int>(sizeof(menuStates) / sizeof(menuStates[0]));
+
     // Find the index of the currently selected item
     int selectedIndex = 0;
-    for (size_t i = 0; i < menuStates.size(); i++) {
+    for (int i = 0; i < menuCount; i++) {
         if (menuStates[i] == m_state) {
             selectedIndex = i;
             break;
@@ -388,14 +477,16 @@ void ThroughputClientScreen::renderMainMenu(bool fullRedraw) {
         firstVisibleItem = selectedIndex - MAX_VISIBLE_ITEMS + 1;
     }
 
+    // Selection moves redraw the rows in place and must not allocate
+    AllocationGuard guard("ThroughputClientScreen::renderMainMenu", !fullRedraw);
+
     // Only do a full menu redraw when necessary
     if (fullRedraw) {
         m_display->clear();
         usleep(Config::DISPLAY_CMD_DELAY * 3);
 
         // Draw header with status
-        std::string headerText = m_testInProgress ? "Client(Running)" : "Client(Ready)";
-        m_display->drawText(0, 0, headerText);
+        m_display->drawText(0, 0, m_testInProgress ? "Client(Running)" : "Client(Ready)");
         usleep(Config::DISPLAY_CMD_DELAY);
 
         // Draw separator
@@ -411,58 +502,52 @@ void ThroughputClientScreen::renderMainMenu(bool fullRedraw) {
     }
 
     // Draw visible menu items using smooth scrolling
-    int lastVisibleItem = std::min(firstVisibleItem + MAX_VISIBLE_ITEMS,
-                                  static_cast<int>(menuStates.size()));
+    int lastVisibleItem = std::min(firstVisibleItem + MAX_VISIBLE_ITEMS, menuCount);
 
     for (int i = firstVisibleItem; i < lastVisibleItem; i++) {
         int displayIndex = i - firstVisibleItem;
         int yPos = 16 + (displayIndex * 8);
             ThroughputClientState itemState = menuStates[i];
-            std::string itemText;
             bool isSelected = (m_state == itemState);
+            TextLine itemText(isSelected ? ">" : " ");
 
             // Generate text for each menu item
             switch (itemState) {
                 case ThroughputClientState::MENU_STATE_START:
-                    itemText = isSelected ? ">Start Test" : " Start Test";
+                    itemText.append("Start Test");
                     break;
 
                 case ThroughputClientState::MENU_STATE_START_REVERSE:
-                    itemText = isSelected ? ">Reverse Test" : " Reverse Test";
+                    itemText.append("Reverse Test");
+                    break;
+
+                case ThroughputClientState::MENU_STATE_START_LATENCY:
+                    itemText.append("Latency Test");
                     break;
 
                 case ThroughputClientState::MENU_STATE_PROTOCOL:
-                    itemText = isSelected ?
-                            ">Proto: " + m_protocol :
-                            " Proto: " + m_protocol;
+                    itemText.append("Proto: ").append(m_protocol);
                     break;
 
                 case ThroughputClientState::MENU_STATE_DURATION:
-                    itemText = isSelected ?
-                            ">Duration: " + std::to_string(m_duration) + "s" :
-                            " Duration: " + std::to_string(m_duration) + "s";
+                    itemText.appendf("Duration: %ds", m_duration);
                     break;
 
                 case ThroughputClientState::MENU_STATE_BANDWIDTH:
-                    itemText = isSelected ?
-                            ">BW: " + getBandwidthString(m_bandwidth) :
-                            " BW: " + getBandwidthString(m_bandwidth);
+                    itemText.append("BW: ");
+                    appendBandwidthSetting(itemText, m_bandwidth);
                     break;
 
                 case ThroughputClientState::MENU_STATE_PARALLEL:
-                    itemText = isSelected ?
-                            ">Parallel: " + std::to_string(m_parallel) :
-                            " Parallel: " + std::to_string(m_parallel);
+                    itemText.appendf("Parallel: %d", m_parallel);
                     break;
 
                 case ThroughputClientState::MENU_STATE_SERVER_IP:
-                    itemText = isSelected ?
-                            ">" + normalizeIp(m_serverIp) :
-                            " " + normalizeIp(m_serverIp);
+                    appendIp(itemText, m_serverIp);
                     break;
 
                 case ThroughputClientState::MENU_STATE_BACK:
-                    itemText = isSelected ? ">Back" : " Back";
+                    itemText.append("Back");
                     break;
 
                 default:
@@ -470,8 +555,8 @@ void ThroughputClientScreen::renderMainMenu(bool fullRedraw) {
             }
 
             // Pad to ensure line is fully overwritten (like GenericListScreen)
-            while (itemText.length() < 16) {
-                itemText += " ";
+            if (itemText.size() < 16) {
+                itemText.resize(16);
             }
 
             m_display->drawText(0, yPos, itemText);
@@ -859,6 +944,12 @@ void ThroughputClientScreen::renderAutoDiscoverScreen(bool fullRedraw) {
             // Draw scanning message
             m_display->drawText(0, 16, "Scanning...");
             usleep(Config::DISPLAY_CMD_DELAY);
+
+            // Cached servers are known before the first answer arrives
+            if (!m_discoveredServers.empty()) {
+                m_display->drawText(0, 26, "Found: " + std::to_string(m_discoveredServers.size()));
+                usleep(Config::DISPLAY_CMD_DELAY);
+            }
         } else if (!m_discoveredServers.empty()) {
             // Discovery completed and servers found
 
@@ -933,7 +1024,7 @@ void ThroughputClientScreen::renderAutoDiscoverScreen(bool fullRedraw) {
 }
 
 void ThroughputClientScreen::updateStatusLine() {
-    std::string statusText;
+    TextLine statusText;
     int yPos = 76; // Position for status line
     //int yPos = 56; // Position for status line
 
@@ -945,17 +1036,15 @@ void ThroughputClientScreen::updateStatusLine() {
     if (m_testInProgress) {
         // Show test progress
         static int dots = 0;
-        statusText = "Testing" + std::string(dots, '.');
+        statusText.append("Testing").resize(7 + dots, '.');
         dots = (dots + 1) % 4;
     } else if (m_testResult != -1) {
         // Show last test result
         if (m_protocol == "TCP") {
-            statusText = formatBandwidth(m_bandwidth_result);
+            appendBandwidth(statusText, m_bandwidth_result);
         } else {
             // For UDP, show jitter and packet loss
-            char buffer[32];
-            snprintf(buffer, sizeof(buffer), "%.1f%% loss", m_loss_result);
-            statusText = buffer;
+            statusText.format("%.1f%% loss", m_loss_result);
         }
     }
 
@@ -1007,6 +1096,12 @@ bool ThroughputClientScreen::handleInput() {
                         renderMainMenu(true);
                     }
                     break;
+                case ThroughputClientState::MENU_STATE_START_LATENCY:
+                    if (!m_testInProgress) {
+                        startLatencyTest();
+                        renderMainMenu(true);
+                    }
+                    break;
 
                 case ThroughputClientState::MENU_STATE_PROTOCOL:
                     // Enter protocol submenu
@@ -1150,15 +1245,10 @@ bool ThroughputClientScreen::handleInput() {
                         redrawNeeded = true;
                     } else if (m_submenuSelection == 1) {
                         // Auto-discover
-                        if (isAvahiAvailable()) {
-                            m_state = ThroughputClientState::SUBMENU_STATE_AUTO_DISCOVER;
-                            m_submenuSelection = 0;
-                            startDiscovery();
-                            renderAutoDiscoverScreen(true);
-                        } else {
-                            m_statusMessage = "Avahi not available";
-                            m_statusChanged = true;
-                        }
+                        m_state = ThroughputClientState::SUBMENU_STATE_AUTO_DISCOVER;
+                        m_submenuSelection = 0;
+                        startDiscovery();
+                        renderAutoDiscoverScreen(true);
                     } else {
                         // Back option selected
                         m_state = ThroughputClientState::MENU_STATE_SERVER_IP;
@@ -1193,7 +1283,7 @@ bool ThroughputClientScreen::handleInput() {
 		        // Return to main menu when any button is pressed
 		        m_waitingForButtonPress = false;
 			m_state = ThroughputClientState::MENU_STATE_START;
-		        Logger::debug("ThroughputClientScreen: Button pressed on results screen, returning to main menu");
+		        LOG_DEBUG("ThroughputClientScreen: Button pressed on results screen, returning to main menu");
 			renderMainMenu(true);
 		    }
 		    break;
@@ -1206,12 +1296,7 @@ bool ThroughputClientScreen::handleInput() {
 		        m_display->drawText(0, 56, "Cancel test? Press again");
 		    } else if (buttonPressed && m_testCancellationPrompt) {
 		        // Cancel the test
-		        if (m_testPid > 0) {
-		            kill(m_testPid, SIGTERM);
-		            waitpid(m_testPid, NULL, 0);
-		            m_testPid = -1;
-		        }
-		        m_testInProgress = false;
+		        stopTest();
 		        m_testCancellationPrompt = false;
 		        m_state = ThroughputClientState::MENU_STATE_START;
 		        renderMainMenu(true);
@@ -1249,6 +1334,7 @@ bool ThroughputClientScreen::handleInput() {
             if (!handled) {
                 if (m_state == ThroughputClientState::MENU_STATE_START ||
                     m_state == ThroughputClientState::MENU_STATE_START_REVERSE ||
+                    m_state == ThroughputClientState::MENU_STATE_START_LATENCY ||
                     m_state == ThroughputClientState::MENU_STATE_PROTOCOL ||
                     m_state == ThroughputClientState::MENU_STATE_DURATION ||
                     m_state == ThroughputClientState::MENU_STATE_BANDWIDTH ||
@@ -1266,9 +1352,12 @@ bool ThroughputClientScreen::handleInput() {
                             case ThroughputClientState::MENU_STATE_START_REVERSE:
                                 m_state = ThroughputClientState::MENU_STATE_START;
                                 break;
-                            case ThroughputClientState::MENU_STATE_PROTOCOL:
+                            case ThroughputClientState::MENU_STATE_START_LATENCY:
                                 m_state = ThroughputClientState::MENU_STATE_START_REVERSE;
                                 break;
+                            case ThroughputClientState::MENU_STATE_PROTOCOL:
+                                m_state = ThroughputClientState::MENU_STATE_START_LATENCY;
+                                break;
                             case ThroughputClientState::MENU_STATE_DURATION:
                                 m_state = ThroughputClientState::MENU_STATE_PROTOCOL;
                                 break;
@@ -1294,6 +1383,9 @@ bool ThroughputClientScreen::handleInput() {
                                 m_state = ThroughputClientState::MENU_STATE_START_REVERSE;
                                 break;
                             case ThroughputClientState::MENU_STATE_START_REVERSE:
+                                m_state = ThroughputClientState::MENU_STATE_START_LATENCY;
+                                break;
+                            case ThroughputClientState::MENU_STATE_START_LATENCY:
                                 m_state = ThroughputClientState::MENU_STATE_PROTOCOL;
                                 break;
                             case ThroughputClientState::MENU_STATE_PROTOCOL:
@@ -1383,18 +1475,15 @@ void ThroughputClientScreen::startTest() {
     // Normalize the IP address (remove leading zeros)
     std::string normalizedIp = normalizeIp(m_serverIp);
     m_serverIp = normalizedIp;
-    Logger::debug("ThroughputClientScreen: Using normalized IP: " + normalizedIp);
-
-    // In startTest() method, add detailed command logging
-    std::string cmdLine = getIperf3Path() + " -c " + m_serverIp + " -p " + std::to_string(m_serverPort) +
-                    " -t " + std::to_string(m_duration) + " -J -l 9000 -w 1M";
-    if (m_protocol == "UDP") cmdLine += " -u";
-    if (m_bandwidth > 0) cmdLine += " -b " + std::to_string(m_bandwidth) + "m";
-    if (m_parallel > 1) cmdLine += " -P " + std::to_string(m_parallel);
-    if (m_reverseMode) cmdLine += " -R";
-    Logger::debug("ThroughputClientScreen: Executing: " + cmdLine);
+    LOG_DEBUG("ThroughputClientScreen: Using normalized IP: " + normalizedIp);
 
     if (m_testInProgress) return;
+    IPSuggestions::getInstance().remember(m_serverIp);
+
+    if (m_useNativeEngine) {
+        startNativeTest();
+        return;
+    }
 
     // Check if iperf3 is available
     if (!isIperf3Available()) {
@@ -1404,12 +1493,39 @@ void ThroughputClientScreen::startTest() {
         return;
     }
 
+    // iperf3 3.17+ emits one JSON object per line; older versions are read
+    // as text, which --forceflush keeps line-buffered on a pipe
+    probeIperf3Options();
+    m_jsonStream = m_iperf3JsonStream;
+    bool forceFlush = !m_jsonStream && m_iperf3ForceFlush;
+
+    // In startTest() method, add detailed command logging
+    std::string cmdLine = getIperf3Path() + " -c " + m_serverIp + " -p " + std::to_string(m_serverPort) +
+                    " -t " + std::to_string(m_duration) +
+                    (m_jsonStream ? " -J --json-stream" : " -f m") + (forceFlush ? " --forceflush" : "");
+    if (m_protocol == "UDP") cmdLine += " -u -l 9000 -w 1M";
+    if (m_bandwidth > 0) cmdLine += " -b " + std::to_string(m_bandwidth) + "m";
+    if (m_parallel > 1) cmdLine += " -P " + std::to_string(m_parallel);
+    if (m_reverseMode) cmdLine += " -R";
+    LOG_DEBUG("ThroughputClientScreen: Executing: " + cmdLine);
+
+    int outputPipe[2];
+    if (pipe2(outputPipe, O_CLOEXEC) != 0) {
+        Logger::error("ThroughputClientScreen: Failed to create output pipe");
+        m_statusMessage = "Failed to start test";
+        m_statusChanged = true;
+        return;
+    }
+
     // Reset test state
     m_testResult = -1;
     m_bandwidth_result = 0.0;
     m_jitter_result = 0.0;
     m_loss_result = 0.0;
     m_retransmits_result = 0;
+    m_testOutput.clear();
+    m_haveSummary = false;
+    m_testLineBuffer.clear();
     m_testInProgress = true;
     m_statusChanged = true;
 
@@ -1417,10 +1533,13 @@ void ThroughputClientScreen::startTest() {
     m_state = ThroughputClientState::MENU_STATE_TESTING;
     renderTestingScreen();
 
-    Logger::debug("ThroughputClientScreen: Starting iperf3 test to " + m_serverIp);
+    LOG_DEBUG("ThroughputClientScreen: Starting iperf3 test to " + m_serverIp);
 
     // Fork to run iperf3 client
     pid_t child_pid = fork();
+    if (child_pid > 0) {
+        PerfCounters::getInstance().add(PerfCounters::Counter::CHILD_PROCESSES);
+    }
     if (child_pid == 0) {
         // Child process - run iperf3 client
         // Prepare command arguments
@@ -1432,7 +1551,16 @@ void ThroughputClientScreen::startTest() {
         args.push_back(std::to_string(m_serverPort));
         args.push_back("-t");
         args.push_back(std::to_string(m_duration));
-        args.push_back("-J"); // JSON output
+        if (m_jsonStream) {
+            args.push_back("-J"); // JSON output, one event per line
+            args.push_back("--json-stream");
+        } else {
+            args.push_back("-f"); // Text output in Mbits/sec
+            args.push_back("m");
+            if (forceFlush) {
+                args.push_back("--forceflush");
+            }
+        }
 
 	// Add protocol flag if UDP
         if (m_protocol == "UDP") {
@@ -1462,12 +1590,8 @@ void ThroughputClientScreen::startTest() {
             c_args.push_back(const_cast<char*>(arg.c_str()));
         }
         c_args.push_back(nullptr);
-        // Redirect stdout to temporary file to capture JSON output
-        int outFile = open("/tmp/micropanel_iperf_result.txt", O_WRONLY | O_CREAT | O_TRUNC, 0644);
-        if (outFile != -1) {
-            dup2(outFile, STDOUT_FILENO);
-            close(outFile);
-        }
+        // Redirect stdout into the pipe the module loop reads from
+        dup2(outputPipe[1], STDOUT_FILENO);
         // Execute iperf3 with the appropriate arguments
         execvp(getIperf3Path().c_str(), c_args.data());
         // If execvp returns, it failed
@@ -1475,10 +1599,15 @@ void ThroughputClientScreen::startTest() {
         std::exit(1);
     } else if (child_pid > 0) {
         // Parent process
+        close(outputPipe[1]);
+        m_testPipe = outputPipe[0];
+        fcntl(m_testPipe, F_SETFL, fcntl(m_testPipe, F_GETFL) | O_NONBLOCK);
         m_testPid = child_pid;
         Logger::info("ThroughputClientScreen: Started iperf3 client with PID " + std::to_string(child_pid));
     } else {
         // Fork failed
+        close(outputPipe[0]);
+        close(outputPipe[1]);
         Logger::error("ThroughputClientScreen: Failed to fork for iperf3 client");
         m_testInProgress = false;
         m_statusMessage = "Failed to start test";
@@ -1489,40 +1618,245 @@ void ThroughputClientScreen::startTest() {
     }
 }
 
+void ThroughputClientScreen::startNativeTest() {
+    Iperf3Client::Options options;
+    options.host = m_serverIp;
+    options.port = m_serverPort;
+    options.udp = m_protocol == "UDP";
+    options.reverse = m_reverseMode;
+    options.durationSec = m_duration;
+    options.bitrate = static_cast<uint64_t>(m_bandwidth) * 1000000ULL;
+    options.parallel = m_parallel;
+    if (options.udp) {
+        // Same datagram size and buffer as the iperf3 command line
+        options.blockSize = 9000;
+        options.window = 1024 * 1024;
+    }
+
+    // Reset test state
+    m_testResult = -1;
+    m_bandwidth_result = 0.0;
+    m_jitter_result = 0.0;
+    m_loss_result = 0.0;
+    m_retransmits_result = 0;
+    m_intervalCount = 0;
+
+    if (!m_engine.start(options)) {
+        Logger::error("ThroughputClientScreen: Failed to start native client");
+        m_statusMessage = "Failed to start test";
+        m_statusChanged = true;
+        return;
+    }
+
+    m_testInProgress = true;
+    m_statusChanged = true;
+    m_state = ThroughputClientState::MENU_STATE_TESTING;
+    renderTestingScreen();
+
+    Logger::info("ThroughputClientScreen: Started native client to " + m_serverIp);
+}
+
+void ThroughputClientScreen::checkNativeTestStatus() {
+    // Live progress for each completed interval
+    std::vector<Iperf3Client::Interval> intervals;
+    size_t total = m_engine.getIntervals(intervals, m_intervalCount);
+    if (total != m_intervalCount && !intervals.empty()) {
+        const Iperf3Client::Interval& last = intervals.back();
+        bool tcpSender = m_protocol == "TCP" && !m_reverseMode;
+        bool udpReceiver = m_protocol == "UDP" && m_reverseMode;
+        drawLiveProgress(last.end, last.bitsPerSecond,
+                         tcpSender ? last.retransmits : -1,
+                         udpReceiver ? last.jitterMs : -1.0);
+    }
+    m_intervalCount = total;
+
+    if (m_engine.isRunning()) {
+        return;
+    }
+
+    m_testInProgress = false;
+    Iperf3Client::Result result = m_engine.getResult();
+
+    if (!result.valid) {
+        m_testResult = 1;
+        if (!result.cancelled) {
+            recordResult(true);
+        }
+        Logger::warning("ThroughputClientScreen: Native client failed: " + result.error);
+        m_statusMessage = result.cancelled ? "Test cancelled" : "Test failed";
+        m_statusChanged = true;
+        m_state = ThroughputClientState::MENU_STATE_START;
+        renderMainMenu(true);
+        return;
+    }
+
+    m_testResult = 0;
+    m_bandwidth_result = result.receiverBitsPerSecond / 1000000.0;
+    m_retransmits_result = result.retransmits;
+    m_jitter_result = result.jitterMs;
+    m_loss_result = result.lostPercent;
+    recordResult(false);
+
+    Logger::info("ThroughputClientScreen: Test results - Bandwidth: " +
+                 std::to_string(m_bandwidth_result) + " Mbps" +
+                 (m_protocol == "TCP" ? ", Retransmits: " + std::to_string(m_retransmits_result) :
+                  ", Jitter: " + std::to_string(m_jitter_result) + " ms, Loss: " +
+                  std::to_string(m_loss_result) + "%"));
+
+    m_state = ThroughputClientState::MENU_STATE_RESULTS;
+    m_waitingForButtonPress = true;
+    showResultsScreen();
+}
+
+void ThroughputClientScreen::startLatencyTest() {
+    m_serverIp = normalizeIp(m_serverIp);
+    if (m_testInProgress) return;
+
+    // "latency_load" picks the loaded directions: both (default), down or up
+    LatencyUnderLoad::Options options;
+    options.host = m_serverIp;
+    options.port = m_serverPort;
+    options.durationSec = m_duration;
+    options.parallel = m_parallel;
+    std::string load = ModuleDependency::getInstance().getDependencyPath("throughputclient", "latency_load");
+    options.download = load != "up";
+    options.upload = load != "down";
+
+    if (!m_latencyTest.start(options)) {
+        m_statusMessage = "Ping failed";
+        m_statusChanged = true;
+        return;
+    }
+    IPSuggestions::getInstance().remember(m_serverIp);
+
+    m_testInProgress = true;
+    m_latencyMode = true;
+    m_latencyLine.clear();
+    m_statusChanged = true;
+    m_state = ThroughputClientState::MENU_STATE_TESTING;
+    renderLatencyTestingScreen();
+
+    Logger::info("ThroughputClientScreen: Started latency test to " + m_serverIp);
+}
+
+void ThroughputClientScreen::checkLatencyTestStatus() {
+    if (m_latencyTest.isRunning()) {
+        // Leave the cancel prompt on screen until it is answered
+        if (m_testCancellationPrompt) return;
+
+        LatencyUnderLoad::Progress progress = m_latencyTest.getProgress();
+        std::string phase = progress.phase == LatencyUnderLoad::Phase::IDLE ? "Idle" :
+                            progress.phase == LatencyUnderLoad::Phase::DOWNLOAD ? "Down" : "Up";
+        std::ostringstream rtt;
+        rtt << std::fixed << std::setprecision(1) << progress.lastRttMs;
+        std::string line = phase + " " + std::to_string(static_cast<int>(progress.elapsed)) + "s " +
+                           rtt.str() + "ms";
+        std::string rate = progress.phase == LatencyUnderLoad::Phase::IDLE ? "" :
+                           formatBandwidth(progress.bitsPerSecond / 1000000.0);
+        line.resize(16, ' ');
+        rate.resize(16, ' ');
+
+        if (line + rate != m_latencyLine) {
+            m_latencyLine = line + rate;
+            m_display->drawText(0, 48, line);
+            usleep(Config::DISPLAY_CMD_DELAY);
+            m_display->drawText(0, 56, rate);
+            usleep(Config::DISPLAY_CMD_DELAY);
+        }
+        return;
+    }
+
+    m_testInProgress = false;
+    m_latencyMode = false;
+    LatencyUnderLoad::Result result = m_latencyTest.getResult();
+
+    if (!result.valid) {
+        Logger::warning("ThroughputClientScreen: Latency test failed: " + result.error);
+        m_statusMessage = result.cancelled ? "Test cancelled" : "Test failed";
+        m_statusChanged = true;
+        m_state = ThroughputClientState::MENU_STATE_START;
+        renderMainMenu(true);
+        return;
+    }
+
+    m_state = ThroughputClientState::MENU_STATE_RESULTS;
+    m_waitingForButtonPress = true;
+    showLatencyResults(result);
+}
+
+void ThroughputClientScreen::stopTest() {
+    // Either engine may be active if the setting changed mid-test
+    m_engine.cancel();
+    m_latencyTest.cancel();
+    m_latencyMode = false;
+    if (m_testPid > 0) {
+        kill(m_testPid, SIGTERM);
+        waitpid(m_testPid, nullptr, 0);
+        m_testPid = -1;
+    }
+    closeTestPipe();
+    m_testInProgress = false;
+}
+
 void ThroughputClientScreen::checkTestStatus() {
     if (!m_testInProgress) return;
 
+    if (m_latencyMode) {
+        checkLatencyTestStatus();
+        return;
+    }
+
+    if (m_useNativeEngine) {
+        checkNativeTestStatus();
+        return;
+    }
+
+    // Consume whatever iperf3 has printed since the last pass
+    readTestOutput();
+
     // Check if the test process has completed
     int status;
     pid_t result = waitpid(m_testPid, &status, WNOHANG);
 
     if (result == m_testPid) {
-        // Test process has completed
+        // Test process has completed; pick up its last lines
         m_testInProgress = false;
         m_testPid = -1;
+        closeTestPipe();
 
         // Determine test result
         if (WIFEXITED(status)) {
             m_testResult = WEXITSTATUS(status);
-            Logger::debug("ThroughputClientScreen: iperf3 test completed with status " +
+            LOG_DEBUG("ThroughputClientScreen: iperf3 test completed with status " +
                          std::to_string(m_testResult));
 
-            // Parse results from the temporary file if test succeeded
-            if (m_testResult == 0) {
-                parseTestResults();
+            // The streamed output has filled in the results; JSON keeps the
+            // end event for parseTestResults(). Without a summary (killed or
+            // cut short after a clean start) there are no figures to report
+            if (m_testResult == 0 && m_haveSummary) {
+                if (m_jsonStream) {
+                    parseTestResults();
+                }
                 Logger::info("ThroughputClientScreen: Test results - Bandwidth: " +
                             std::to_string(m_bandwidth_result) + " Mbps");
+                recordResult(false);
 
                 // Switch to results screen - ONLY change state and render
                 m_state = ThroughputClientState::MENU_STATE_RESULTS;
                 m_waitingForButtonPress = true;  // Add this flag to your class
                 showResultsScreen();  // Renamed to better reflect what it does
-                Logger::debug("ThroughputClientScreen: Waiting for button press on results screen");
+                LOG_DEBUG("ThroughputClientScreen: Waiting for button press on results screen");
 
                 // IMPORTANT: Do NOT call renderMainMenu or anything else here
             } else {
-                Logger::warning("ThroughputClientScreen: iperf3 client exited with error code " +
-                               std::to_string(m_testResult));
+                if (m_testResult == 0) {
+                    Logger::warning("ThroughputClientScreen: iperf3 client exited without a test summary");
+                    m_testResult = 1;
+                } else {
+                    Logger::warning("ThroughputClientScreen: iperf3 client exited with error code " +
+                                   std::to_string(m_testResult));
+                }
+                recordResult(true);
                 m_statusMessage = "Test failed";
                 m_statusChanged = true;
                 m_state = ThroughputClientState::MENU_STATE_START;
@@ -1538,21 +1872,160 @@ void ThroughputClientScreen::checkTestStatus() {
         }
     }
 }
-void ThroughputClientScreen::parseTestResults() {
-    // Read the JSON output file
-    std::ifstream file("/tmp/micropanel_iperf_result.txt");
-    if (!file.is_open()) {
-        Logger::error("ThroughputClientScreen: Failed to open test results file");
+void ThroughputClientScreen::readTestOutput() {
+    if (m_testPipe < 0) return;
+
+    char buffer[4096];
+    while (true) {
+        ssize_t n = read(m_testPipe, buffer, sizeof(buffer));
+        if (n > 0) {
+            m_testLineBuffer.append(buffer, n);
+            continue;
+        }
+        if (n < 0 && errno == EINTR) continue;
+        if (n == 0) {
+            // EOF: iperf3 is gone, flush an unterminated last line
+            m_testLineBuffer += '\n';
+        }
+        break;
+    }
+
+    size_t start = 0;
+    size_t newline;
+    while ((newline = m_testLineBuffer.find('\n', start)) != std::string::npos) {
+        std::string line = m_testLineBuffer.substr(start, newline - start);
+        start = newline + 1;
+        if (!line.empty()) {
+            if (m_jsonStream) {
+                parseJsonStreamLine(line);
+            } else {
+                parseTextLine(line);
+            }
+        }
+    }
+    m_testLineBuffer.erase(0, start);
+}
+
+void ThroughputClientScreen::closeTestPipe() {
+    if (m_testPipe < 0) return;
+
+    // The writer has exited, so this drains to EOF without blocking
+    readTestOutput();
+    close(m_testPipe);
+    m_testPipe = -1;
+    m_testLineBuffer.clear();
+}
+
+void ThroughputClientScreen::parseJsonStreamLine(const std::string& line) {
+    try {
+        json message = json::parse(line);
+        std::string event = message.value("event", "");
+        const json& data = message["data"];
+
+        if (event == "interval") {
+            const json& sum = data.at("sum");
+            double end = sum.value("end", 0.0);
+            double bps = sum.value("bits_per_second", 0.0);
+            int retransmits = sum.contains("retransmits") ? sum["retransmits"].get<int>() : -1;
+            double jitter = sum.contains("jitter_ms") ? sum["jitter_ms"].get<double>() : -1.0;
+            drawLiveProgress(end, bps, retransmits, jitter);
+        } else if (event == "end") {
+            // Keep the summary in the shape the -J result parsers expect
+            m_testOutput = "{\"end\":" + data.dump() + "}";
+            m_haveSummary = true;
+        } else if (event == "error") {
+            Logger::warning("ThroughputClientScreen: iperf3 error: " +
+                            (data.is_string() ? data.get<std::string>() : data.dump()));
+        }
+    } catch (const std::exception& e) {
+        LOG_DEBUG("ThroughputClientScreen: Skipping iperf3 line: " + std::string(e.what()));
+    }
+}
+
+void ThroughputClientScreen::parseTextLine(const std::string& line) {
+    // [  5]   0.00-1.00   sec   112 MBytes   941 Mbits/sec    0    376 KBytes
+    // [SUM]   0.00-10.00  sec  1.25 MBytes  1.05 Mbits/sec  0.011 ms  0/906 (0%)  receiver
+    static const std::regex intervalRe(
+        R"(^\[\s*(\d+|SUM)\]\s+([\d.]+)-([\d.]+)\s+sec\s+[\d.]+\s+\w?Bytes\s+([\d.]+)\s+(\w?)bits/sec(.*)$)");
+    static const std::regex udpRe(R"(([\d.]+)\s+ms\s+(\d+)/(\d+)\s+\(([\d.e+-]+)%\))");
+    static const std::regex retransmitsRe(R"(^\s+(\d+)\b)");
+
+    std::smatch match;
+    if (!std::regex_search(line, match, intervalRe)) {
+        return;
+    }
+
+    // With parallel streams only the [SUM] lines describe the whole test
+    bool isSum = match[1] == "SUM";
+    if (isSum != (m_parallel > 1)) {
+        return;
+    }
+
+    double end = std::stod(match[3]);
+    double rate = std::stod(match[4]);
+    std::string unit = match[5];
+    double bps = rate * (unit == "G" ? 1e9 : unit == "M" ? 1e6 : unit == "K" ? 1e3 : 1.0);
+    std::string tail = match[6];
+
+    bool isSender = tail.find("sender") != std::string::npos;
+    bool isReceiver = tail.find("receiver") != std::string::npos;
+
+    int retransmits = -1;
+    double jitter = -1.0;
+    std::smatch detail;
+    if (m_protocol == "UDP" && std::regex_search(tail, detail, udpRe)) {
+        jitter = std::stod(detail[1]);
+        if (isReceiver) {
+            m_jitter_result = jitter;
+            m_loss_result = std::stod(detail[4]);
+        }
+    } else if (m_protocol == "TCP" && std::regex_search(tail, detail, retransmitsRe)) {
+        retransmits = std::stoi(detail[1]);
+    }
+
+    if (isSender || isReceiver) {
+        // Final summary: sender rate/retransmits for TCP, receiver side for UDP
+        if ((m_protocol == "TCP" && isSender) || (m_protocol == "UDP" && isReceiver)) {
+            m_bandwidth_result = bps / 1000000.0;
+            m_haveSummary = true;
+        }
+        if (isSender && retransmits >= 0) {
+            m_retransmits_result = retransmits;
+        }
         return;
     }
 
-    std::stringstream buffer;
-    buffer << file.rdbuf();
-    std::string output = buffer.str();
-    file.close();
+    drawLiveProgress(end, bps, retransmits, jitter);
+}
+
+void ThroughputClientScreen::drawLiveProgress(double seconds, double bitsPerSecond, int retransmits, double jitterMs) {
+    // Leave the cancel prompt on screen until it is answered
+    if (m_testCancellationPrompt) return;
+
+    // Runs once per interval for the whole test
+    AllocationGuard guard("ThroughputClientScreen::drawLiveProgress");
 
-    // Clean up the file
-    unlink("/tmp/micropanel_iperf_result.txt");
+    TextLine detail;
+    if (m_protocol == "UDP" && jitterMs >= 0.0) {
+        detail.format("Jitter :%.3fms", jitterMs);
+    } else if (m_protocol == "TCP" && retransmits >= 0) {
+        detail.format("Retrns :%d", retransmits);
+    }
+    if (!detail.empty()) {
+        m_display->drawText(0, 48, detail.resize(16));
+        usleep(Config::DISPLAY_CMD_DELAY);
+    }
+
+    TextLine line;
+    line.format("%d/%ds ", static_cast<int>(seconds + 0.5), m_duration);
+    appendBandwidth(line, bitsPerSecond / 1000000.0);
+    m_display->drawText(0, 56, line.resize(16));
+    usleep(Config::DISPLAY_CMD_DELAY);
+}
+
+void ThroughputClientScreen::parseTestResults() {
+    // Summary collected from the "end" event of the JSON stream
+    const std::string& output = m_testOutput;
 
     // Parse the JSON structure to extract result data
     try {
@@ -1570,7 +2043,7 @@ void ThroughputClientScreen::parseTestResults() {
                         // Convert from bits/sec to Mbits/sec
                         double bps = std::stod(bpsStr);
                         m_bandwidth_result = bps / 1000000.0;
-                        Logger::debug("ThroughputClientScreen: Parsed bandwidth: " +
+                        LOG_DEBUG("ThroughputClientScreen: Parsed bandwidth: " +
                                      std::to_string(m_bandwidth_result) + " Mbps");
                     } catch (const std::exception& e) {
                         Logger::error("ThroughputClientScreen: Failed to parse bandwidth: " +
@@ -1589,7 +2062,7 @@ void ThroughputClientScreen::parseTestResults() {
                         std::string retransStr = output.substr(valueStart, valueEnd - valueStart);
                         try {
                             m_retransmits_result = std::stoi(retransStr);
-                            Logger::debug("ThroughputClientScreen: Parsed retransmits: " +
+                            LOG_DEBUG("ThroughputClientScreen: Parsed retransmits: " +
                                          std::to_string(m_retransmits_result));
                         } catch (const std::exception& e) {
                             Logger::error("ThroughputClientScreen: Failed to parse retransmits: " +
@@ -1633,199 +2106,79 @@ void ThroughputClientScreen::parseTestResults() {
 void ThroughputClientScreen::startDiscovery() {
     if (m_discoveryInProgress) return;
 
-    // Check if avahi is available
-    if (!isAvahiAvailable()) {
-        Logger::error("ThroughputClientScreen: avahi-browse not found");
-        m_statusMessage = "Avahi not available";
+    // Show what an earlier browse (from any screen) already knows
+    m_discoveredServers.clear();
+    m_discoveredServerNames.clear();
+    collectDiscoveredServers();
+
+    if (!MdnsBrowser::getInstance().browse(m_discoveryServiceTypes, Config::MDNS_BROWSE_MS)) {
+        Logger::error("ThroughputClientScreen: mDNS discovery unavailable");
+        m_statusMessage = "mDNS unavailable";
         m_statusChanged = true;
         return;
     }
 
-    // Reset discovery state
-    m_discoveredServers.clear();
-    m_discoveredServerNames.clear();
     m_discoveryInProgress = true;
     m_statusChanged = true;
-
-    Logger::debug("ThroughputClientScreen: Starting Avahi discovery");
-
-    // Fork to run avahi-browse
-    pid_t child_pid = fork();
-
-    if (child_pid == 0) {
-        // Child process - run avahi-browse
-
-        // Redirect stdout to temporary file to capture output
-        int outFile = open("/tmp/micropanel_avahi_result.txt", O_WRONLY | O_CREAT | O_TRUNC, 0644);
-        if (outFile != -1) {
-            dup2(outFile, STDOUT_FILENO);
-            close(outFile);
-        }
-
-        // Execute avahi-browse to search for iperf3 services
-        // Add -t to terminate after resolving and ensure -p for parsable output
-        execl("/usr/bin/avahi-browse", "avahi-browse", "-p", "-t", "-r", "_iperf3._tcp", NULL);
-
-        // If execl returns, it failed
-        Logger::error("ThroughputClientScreen: Failed to execute avahi-browse");
-        std::exit(1);
-    } else if (child_pid > 0) {
-        // Parent process
-        m_discoveryPid = child_pid;
-        Logger::info("ThroughputClientScreen: Started avahi-browse with PID " + std::to_string(child_pid));
-    } else {
-        // Fork failed
-        Logger::error("ThroughputClientScreen: Failed to fork for avahi-browse");
-        m_discoveryInProgress = false;
-        m_statusMessage = "Discovery failed";
-        m_statusChanged = true;
-    }
+    LOG_DEBUG("ThroughputClientScreen: Starting mDNS discovery");
 }
 
 void ThroughputClientScreen::checkDiscoveryStatus() {
     if (!m_discoveryInProgress) return;
 
-    // Check if the discovery process has completed
-    int status;
-    pid_t result = waitpid(m_discoveryPid, &status, WNOHANG);
-
-    if (result == m_discoveryPid) {
-        // Discovery process has completed
-        m_discoveryInProgress = false;
-        m_discoveryPid = -1;
-
-        // Determine discovery result
-        if (WIFEXITED(status)) {
-            int exitStatus = WEXITSTATUS(status);
-            Logger::debug("ThroughputClientScreen: avahi-browse completed with status " +
-                         std::to_string(exitStatus));
-
-            // Parse results from the temporary file
-            parseDiscoveryResults();
-
-            if (m_discoveredServers.empty()) {
-                Logger::warning("ThroughputClientScreen: No iperf3 servers found");
-                m_statusMessage = "No servers found";
-                m_statusChanged = true;
-            } else {
-                Logger::info("ThroughputClientScreen: Found " +
-                            std::to_string(m_discoveredServers.size()) + " iperf3 servers");
-            }
-        } else {
-            Logger::warning("ThroughputClientScreen: avahi-browse terminated abnormally");
-            m_statusMessage = "Discovery failed";
-            m_statusChanged = true;
+    // Servers are listed as their answers arrive
+    if (collectDiscoveredServers()) {
+        std::string found = "Found: " + std::to_string(m_discoveredServers.size());
+        while (found.length() < 16) {
+            found += " ";
         }
-
-        // Update display with discovery results
-        renderAutoDiscoverScreen(true);
+        m_display->drawText(0, 26, found);
+        usleep(Config::DISPLAY_CMD_DELAY);
     }
-}
-void ThroughputClientScreen::parseDiscoveryResults() {
-    std::ifstream file("/tmp/micropanel_avahi_result.txt");
-    if (!file.is_open()) {
-        Logger::error("ThroughputClientScreen: Failed to open discovery results file");
+
+    if (MdnsBrowser::getInstance().isBrowsing()) {
         return;
     }
 
-    // Debug: Log the entire file content
-    std::string allContent((std::istreambuf_iterator<char>(file)), std::istreambuf_iterator<char>());
-    Logger::debug("ThroughputClientScreen: Discovery file content:\n" + allContent);
-
-    // Reset file position to beginning
-    file.clear();
-    file.seekg(0);
-
-    // Track IPv4 addresses we've seen to avoid duplicates
-    std::set<std::string> seenIPs;
-
-    // First, find all IPv4 entries
-    std::string line;
-    std::vector<std::string> ipv4Lines;
-
-    while (std::getline(file, line)) {
-        // Look specifically for IPv4 lines (avoid IPv6)
-        if (line.empty()) continue;
+    m_discoveryInProgress = false;
+    collectDiscoveredServers();
 
-        if (line.find(";IPv4;") != std::string::npos) {
-            ipv4Lines.push_back(line);
-        }
+    if (m_discoveredServers.empty()) {
+        Logger::warning("ThroughputClientScreen: No iperf3 servers found");
+        m_statusMessage = "No servers found";
+        m_statusChanged = true;
+    } else {
+        Logger::info("ThroughputClientScreen: Found " +
+                    std::to_string(m_discoveredServers.size()) + " iperf3 servers");
     }
 
-    // Now process each IPv4 line
-    for (const auto& ipv4Line : ipv4Lines) {
-        std::vector<std::string> fields;
-        std::string field;
-        std::istringstream lineStream(ipv4Line);
-
-        while (std::getline(lineStream, field, ';')) {
-            fields.push_back(field);
-        }
-
-        // Must have at least basic fields
-        if (fields.size() < 4) continue;
-
-        // Extract service name
-        std::string serviceName = fields[3];
-        // Unescape special characters
-        serviceName = std::regex_replace(serviceName, std::regex("\\\\032"), " ");
-        //serviceName = std::regex_replace(serviceName, std::regex("\\\\\."), ".");
-	serviceName = std::regex_replace(serviceName, std::regex("\\\\."), ".");
-        // Try to extract IP from service name (common format)
-        std::string ipAddress;
-        size_t lastSpace = serviceName.find_last_of(' ');
-        if (lastSpace != std::string::npos) {
-            std::string possibleIP = serviceName.substr(lastSpace + 1);
-            // Simple IPv4 validation (contains dots, no colons)
-            if (possibleIP.find('.') != std::string::npos &&
-                possibleIP.find(':') == std::string::npos) {
-                ipAddress = possibleIP;
-            }
-        }
+    // Update display with discovery results
+    renderAutoDiscoverScreen(true);
+}
 
-        // If we couldn't extract from service name, look for IP in resolved entries
-        if (ipAddress.empty() && fields[0] == "=") {
-            // In resolved entries, IP should be in field 7
-            if (fields.size() >= 8) {
-                std::string possibleIP = fields[7];
-                if (possibleIP.find('.') != std::string::npos &&
-                    possibleIP.find(':') == std::string::npos) {
-                    ipAddress = possibleIP;
-                }
+// Merge newly resolved services into the list; true if any were added
+bool ThroughputClientScreen::collectDiscoveredServers() {
+    bool added = false;
+    auto& browser = MdnsBrowser::getInstance();
+
+    for (const auto& type : m_discoveryServiceTypes) {
+        for (const auto& service : browser.getServices(type)) {
+            auto entry = std::make_pair(service.address, service.port);
+            if (std::find(m_discoveredServers.begin(), m_discoveredServers.end(), entry) !=
+                m_discoveredServers.end()) {
+                continue;
             }
-        }
+            m_discoveredServers.push_back(entry);
+            m_discoveredServerNames.push_back(service.instance);
+            added = true;
 
-        // Skip if no valid IP found or already processed this IP
-        if (ipAddress.empty() || seenIPs.find(ipAddress) != seenIPs.end()) {
-            continue;
+            LOG_DEBUG("ThroughputClientScreen: Discovered server - " +
+                          service.address + ":" + std::to_string(service.port) + " (" + service.instance + ")");
         }
-
-        // Try to extract port number
-        int port = 5201; // Default iperf3 port
-        if (fields[0] == "=" && fields.size() >= 9) {
-            try {
-                port = std::stoi(fields[8]);
-            } catch (...) {
-                Logger::warning("ThroughputClientScreen: Failed to parse port, using default");
-            }
-        }
-
-        // Record this IP
-        seenIPs.insert(ipAddress);
-
-        // Add to discovered servers
-        m_discoveredServers.push_back(std::make_pair(ipAddress, port));
-        m_discoveredServerNames.push_back(serviceName);
-
-        Logger::debug("ThroughputClientScreen: Discovered server - " +
-                      ipAddress + ":" + std::to_string(port) + " (" + serviceName + ")");
     }
-
-    file.close();
-
-    // Clean up temporary file
-    unlink("/tmp/micropanel_avahi_result.txt");
+    return added;
 }
+
 void ThroughputClientScreen::selectServer(int index) {
     if (index >= 0 && index < static_cast<int>(m_discoveredServers.size())) {
         // Get selected server
@@ -1897,12 +2250,12 @@ void ThroughputClientScreen::showResultsAndWait(){//int durationMs) {
     usleep(Config::DISPLAY_CMD_DELAY);
 
     // Wait for specified duration
-    //Logger::debug("ThroughputClientScreen: Showing results for " + std::to_string(durationMs) + "ms");
+    //LOG_DEBUG("ThroughputClientScreen: Showing results for " + std::to_string(durationMs) + "ms");
 
     // Sleep for the requested duration
     //usleep(durationMs * 1000);
 
-    Logger::debug("ThroughputClientScreen: Done showing results");
+    LOG_DEBUG("ThroughputClientScreen: Done showing results");
 }
 
 UDPTestResult ThroughputClientScreen::parseUDPTestResults(const std::string& output) {
@@ -1932,7 +2285,7 @@ UDPTestResult ThroughputClientScreen::parseUDPTestResults(const std::string& out
                 // Convert from bits/sec to Mbits/sec
                 double bps = std::stod(bpsStr);
                 result.bandwidth_mbps = bps / 1000000.0;
-                Logger::debug("ThroughputClientScreen: Parsed UDP bandwidth: " +
+                LOG_DEBUG("ThroughputClientScreen: Parsed UDP bandwidth: " +
                              std::to_string(result.bandwidth_mbps) + " Mbps");
             }
         }
@@ -1945,7 +2298,7 @@ UDPTestResult ThroughputClientScreen::parseUDPTestResults(const std::string& out
             if (valueEnd != std::string::npos) {
                 std::string jitterStr = output.substr(valueStart, valueEnd - valueStart);
                 result.jitter_ms = std::stod(jitterStr);
-                Logger::debug("ThroughputClientScreen: Parsed jitter: " +
+                LOG_DEBUG("ThroughputClientScreen: Parsed jitter: " +
                              std::to_string(result.jitter_ms) + " ms");
             }
         }
@@ -1958,7 +2311,7 @@ UDPTestResult ThroughputClientScreen::parseUDPTestResults(const std::string& out
             if (valueEnd != std::string::npos) {
                 std::string lostPacketsStr = output.substr(valueStart, valueEnd - valueStart);
                 result.lost_packets = std::stoi(lostPacketsStr);
-                Logger::debug("ThroughputClientScreen: Parsed lost packets: " +
+                LOG_DEBUG("ThroughputClientScreen: Parsed lost packets: " +
                              std::to_string(result.lost_packets));
             }
         }
@@ -1971,7 +2324,7 @@ UDPTestResult ThroughputClientScreen::parseUDPTestResults(const std::string& out
             if (valueEnd != std::string::npos) {
                 std::string lostPercentStr = output.substr(valueStart, valueEnd - valueStart);
                 result.lost_percent = std::stod(lostPercentStr);
-                Logger::debug("ThroughputClientScreen: Parsed packet loss: " +
+                LOG_DEBUG("ThroughputClientScreen: Parsed packet loss: " +
                              std::to_string(result.lost_percent) + "%");
             }
         }
@@ -1984,7 +2337,7 @@ UDPTestResult ThroughputClientScreen::parseUDPTestResults(const std::string& out
             if (valueEnd != std::string::npos) {
                 std::string packetsStr = output.substr(valueStart, valueEnd - valueStart);
                 result.total_packets = std::stoi(packetsStr);
-                Logger::debug("ThroughputClientScreen: Parsed total packets: " +
+                LOG_DEBUG("ThroughputClientScreen: Parsed total packets: " +
                              std::to_string(result.total_packets));
             }
         }
@@ -1998,6 +2351,13 @@ UDPTestResult ThroughputClientScreen::parseUDPTestResults(const std::string& out
 
     return result;
 }
+void ThroughputClientScreen::recordResult(bool failed) {
+    // Reverse mode measures the server sending to us
+    HistoryLog::getInstance().append(
+        m_reverseMode ? HistoryLog::Kind::THROUGHPUT_DOWN : HistoryLog::Kind::THROUGHPUT_UP,
+        failed ? 0.0 : m_bandwidth_result, failed);
+}
+
 void ThroughputClientScreen::showResultsScreen() {
     // Draw the results screen
     m_display->clear();
@@ -2109,12 +2469,80 @@ void ThroughputClientScreen::renderTestingScreen() {
     m_display->drawText(0, 56, "Please wait...");
     usleep(Config::DISPLAY_CMD_DELAY);
 
-    Logger::debug("ThroughputClientScreen: Showing testing screen");
+    LOG_DEBUG("ThroughputClientScreen: Showing testing screen");
+}
+
+void ThroughputClientScreen::renderLatencyTestingScreen() {
+    m_display->clear();
+    usleep(Config::DISPLAY_CMD_DELAY * 3);
+
+    m_display->drawText(0, 0, "  Latency Test");
+    usleep(Config::DISPLAY_CMD_DELAY);
+    m_display->drawText(0, 8, "----------------");
+    usleep(Config::DISPLAY_CMD_DELAY);
+    m_display->drawText(0, 16, "Srv:" + m_serverIp);
+    usleep(Config::DISPLAY_CMD_DELAY);
+    m_display->drawText(0, 24, "Streams:" + std::to_string(std::max(m_parallel, Config::LATENCY_LOAD_MIN_STREAMS)));
+    usleep(Config::DISPLAY_CMD_DELAY);
+    m_display->drawText(0, 32, "Dur    :" + std::to_string(m_duration) + "sec");
+    usleep(Config::DISPLAY_CMD_DELAY);
+    m_display->drawText(0, 56, "Please wait...");
+    usleep(Config::DISPLAY_CMD_DELAY);
+
+    LOG_DEBUG("ThroughputClientScreen: Showing latency testing screen");
+}
+
+void ThroughputClientScreen::showLatencyResults(const LatencyUnderLoad::Result& result) {
+    m_display->clear();
+    usleep(Config::DISPLAY_CMD_DELAY * 3);
+
+    // One row per phase: median/90th percentile, or "-" when it did not run
+    auto phaseRow = [](const std::string& label, const LatencyUnderLoad::Latency& latency, bool ran) {
+        std::string row = label;
+        if (!ran) {
+            row += "-";
+        } else if (!latency.valid) {
+            row += "no reply";
+        } else {
+            row += std::to_string(static_cast<int>(latency.p50Ms + 0.5)) + "/" +
+                   std::to_string(static_cast<int>(latency.p90Ms + 0.5)) + "ms";
+            if (latency.lossPercent > 0) {
+                row += " " + std::to_string(latency.lossPercent) + "%";
+            }
+        }
+        row.resize(16, ' ');
+        return row;
+    };
+    bool download = result.download.valid || result.downloadBitsPerSecond > 0.0;
+    bool upload = result.upload.valid || result.uploadBitsPerSecond > 0.0;
+
+    m_display->drawText(0, 0, "Latency p50/p90");
+    usleep(Config::DISPLAY_CMD_DELAY);
+    m_display->drawText(0, 8, "----------------");
+    usleep(Config::DISPLAY_CMD_DELAY);
+    m_display->drawText(0, 16, phaseRow("Idle  ", result.idle, true));
+    usleep(Config::DISPLAY_CMD_DELAY);
+    m_display->drawText(0, 24, phaseRow("Down  ", result.download, download));
+    usleep(Config::DISPLAY_CMD_DELAY);
+    m_display->drawText(0, 32, phaseRow("Up    ", result.upload, upload));
+    usleep(Config::DISPLAY_CMD_DELAY);
+
+    std::ostringstream rates;
+    rates << std::fixed << std::setprecision(0)
+          << "D " << result.downloadBitsPerSecond / 1000000.0 << "M U "
+          << result.uploadBitsPerSecond / 1000000.0 << "M";
+    m_display->drawText(0, 40, rates.str());
+    usleep(Config::DISPLAY_CMD_DELAY);
+    m_display->drawText(0, 48, "Grade " + result.grade + " RPM " + std::to_string(result.rpm));
+    usleep(Config::DISPLAY_CMD_DELAY);
+
+    m_display->drawText(0, 56, "Enter to continu");
+    usleep(Config::DISPLAY_CMD_DELAY);
 }
 
 // GPIO support methods
 void ThroughputClientScreen::handleGPIORotation(int direction) {
-    Logger::debug("ThroughputClientScreen: handleGPIORotation called with direction: " + std::to_string(direction));
+    LOG_DEBUG("ThroughputClientScreen: handleGPIORotation called with direction: " + std::to_string(direction));
 
     // Skip rotation during testing or when viewing results
     if (m_state == ThroughputClientState::MENU_STATE_TESTING ||
@@ -2139,6 +2567,7 @@ void ThroughputClientScreen::handleGPIORotation(int direction) {
     // Handle menu navigation based on current state
     if (m_state == ThroughputClientState::MENU_STATE_START ||
         m_state == ThroughputClientState::MENU_STATE_START_REVERSE ||
+        m_state == ThroughputClientState::MENU_STATE_START_LATENCY ||
         m_state == ThroughputClientState::MENU_STATE_PROTOCOL ||
         m_state == ThroughputClientState::MENU_STATE_DURATION ||
         m_state == ThroughputClientState::MENU_STATE_BANDWIDTH ||
@@ -2151,6 +2580,7 @@ void ThroughputClientScreen::handleGPIORotation(int direction) {
         const std::vector<ThroughputClientState> menuStates = {
             ThroughputClientState::MENU_STATE_START,
             ThroughputClientState::MENU_STATE_START_REVERSE,
+            ThroughputClientState::MENU_STATE_START_LATENCY,
             ThroughputClientState::MENU_STATE_PROTOCOL,
             ThroughputClientState::MENU_STATE_DURATION,
             ThroughputClientState::MENU_STATE_BANDWIDTH,
@@ -2241,7 +2671,7 @@ void ThroughputClientScreen::handleGPIORotation(int direction) {
 }
 
 bool ThroughputClientScreen::handleGPIOButtonPress() {
-    Logger::debug("ThroughputClientScreen: handleGPIOButtonPress called");
+    LOG_DEBUG("ThroughputClientScreen: handleGPIOButtonPress called");
 
     // Handle button press based on current state
     switch (m_state) {
@@ -2263,6 +2693,13 @@ bool ThroughputClientScreen::handleGPIOButtonPress() {
             }
             break;
 
+        case ThroughputClientState::MENU_STATE_START_LATENCY:
+            if (!m_testInProgress) {
+                startLatencyTest();
+                renderMainMenu(true);
+            }
+            break;
+
         case ThroughputClientState::MENU_STATE_PROTOCOL:
             // Enter protocol submenu
             m_state = ThroughputClientState::SUBMENU_STATE_PROTOCOL;
@@ -2403,15 +2840,10 @@ bool ThroughputClientScreen::handleGPIOButtonPress() {
                 renderServerIPSubmenu(false);
             } else if (m_submenuSelection == 1) {
                 // Auto-discover
-                if (isAvahiAvailable()) {
-                    m_state = ThroughputClientState::SUBMENU_STATE_AUTO_DISCOVER;
-                    m_submenuSelection = 0;
-                    startDiscovery();
-                    renderAutoDiscoverScreen(true);
-                } else {
-                    m_statusMessage = "Avahi not available";
-                    m_statusChanged = true;
-                }
+                m_state = ThroughputClientState::SUBMENU_STATE_AUTO_DISCOVER;
+                m_submenuSelection = 0;
+                startDiscovery();
+                renderAutoDiscoverScreen(true);
             } else {
                 // Back option selected
                 m_state = ThroughputClientState::MENU_STATE_SERVER_IP;
@@ -2447,7 +2879,7 @@ bool ThroughputClientScreen::handleGPIOButtonPress() {
                 // Return to main menu when any button is pressed
                 m_waitingForButtonPress = false;
                 m_state = ThroughputClientState::MENU_STATE_START;
-                Logger::debug("ThroughputClientScreen: Button pressed on results screen, returning to main menu");
+                LOG_DEBUG("ThroughputClientScreen: Button pressed on results screen, returning to main menu");
                 renderMainMenu(true);
             }
             break;
@@ -2463,3 +2895,5 @@ bool ThroughputClientScreen::handleGPIOButtonPress() {
 
     return true; // Continue running
 }
+
+MICROPANEL_REGISTER_MODULE("throughputclient", ThroughputClientScreen);
@@ -0,0 +1,549 @@
+#include "ScreenModules.h"
+#include "ModuleCatalog.h"
+#include "MenuSystem.h"
+#include "DeviceInterfaces.h"
+#include "Logger.h"
+#include "Config.h"
+#include "ModuleDependency.h"
+#include "NetworkState.h"
+#include "Scheduler.h"
+#include <algorithm>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <string>
+#include <memory>
+#include <unistd.h>
+#include <sys/socket.h>
+
+namespace {
+    constexpr int REFRESH_MS = 500;
+    constexpr const char* INSTANCE_PREFIX = "MicroPanel mesh ";
+    const int DURATIONS[] = {5, 10, 20, 30, 60};
+
+    char nodeLabel(size_t index) {
+        return static_cast<char>('A' + index);
+    }
+
+    // Four columns, right-aligned: " 941", " 9.4", "1.2G", "  xx"
+    std::string formatCell(const MeshCoordinator::Result* result) {
+        if (!result) {
+            return "   .";
+        }
+        switch (result->state) {
+            case MeshCoordinator::State::DONE:
+                break;
+            case MeshCoordinator::State::FAILED:
+                return "  xx";
+            default:
+                return "  ..";
+        }
+
+        char cell[16];
+        if (result->mbps < 9.95) {
+            snprintf(cell, sizeof(cell), "%4.1f", result->mbps);
+        } else if (result->mbps < 999.5) {
+            snprintf(cell, sizeof(cell), "%4.0f", result->mbps);
+        } else {
+            snprintf(cell, sizeof(cell), "%3.*fG", result->mbps < 9950.0 ? 1 : 0, result->mbps / 1000.0);
+        }
+        return cell;
+    }
+
+    const MeshCoordinator::Result* findResult(const std::vector<MeshCoordinator::Result>& results, int from, int to) {
+        for (const auto& result : results) {
+            if (result.pair.from == from && result.pair.to == to) {
+                return &result;
+            }
+        }
+        return nullptr;
+    }
+}
+
+ThroughputMeshScreen::ThroughputMeshScreen(std::shared_ptr<Display> display, std::shared_ptr<InputDevice> input)
+    : ScreenModule(display, input)
+    , m_rows(display)
+{
+}
+
+void ThroughputMeshScreen::enter() {
+    LOG_DEBUG("ThroughputMeshScreen: Entered");
+
+    m_view = View::MENU;
+    m_item = Item::COORDINATE;
+    m_shouldExit = false;
+    m_message.clear();
+    refreshSettings();
+    startAgent();
+
+    m_refreshJob = Scheduler::getInstance().add("throughputmesh refresh", REFRESH_MS, Scheduler::Cost::LIGHT, true,
+                                                [this]() {
+        if (m_view == View::PEERS) {
+            mergeDiscovered();
+        }
+        if (m_view != View::MENU && m_view != View::MATRIX) {
+            render();
+        }
+    });
+
+    m_display->clear();
+    usleep(Config::DISPLAY_CMD_DELAY * 3);
+    m_rows.invalidate();
+    render();
+}
+
+void ThroughputMeshScreen::update() {
+    // Live views redraw from the refresh job
+}
+
+void ThroughputMeshScreen::exit() {
+    LOG_DEBUG("ThroughputMeshScreen: Exiting");
+
+    if (m_refreshJob >= 0) {
+        Scheduler::getInstance().remove(m_refreshJob);
+        m_refreshJob = -1;
+    }
+    // Leaving aborts a run on every node; peers stay reachable only while open
+    m_coordinator.cancel();
+    m_agent.stop();
+
+    m_display->clear();
+    usleep(Config::DISPLAY_CMD_DELAY * 3);
+}
+
+bool ThroughputMeshScreen::handleInput() {
+    if (m_input->waitForEvents(100) > 0) {
+        bool buttonPressed = false;
+        int rotationDirection = 0;
+
+        m_input->processEvents(
+            [this, &rotationDirection](int direction) {
+                rotationDirection = direction;
+                m_display->updateActivityTimestamp();
+            },
+            [this, &buttonPressed]() {
+                buttonPressed = true;
+                m_display->updateActivityTimestamp();
+            }
+        );
+
+        if (buttonPressed) {
+            handleButton();
+        }
+        if (rotationDirection != 0) {
+            handleRotation(rotationDirection);
+        }
+    }
+
+    return !m_shouldExit;
+}
+
+void ThroughputMeshScreen::handleGPIORotation(int direction) {
+    LOG_DEBUG("ThroughputMeshScreen::handleGPIORotation(" + std::to_string(direction) + ")");
+    handleRotation(direction);
+    m_display->updateActivityTimestamp();
+}
+
+bool ThroughputMeshScreen::handleGPIOButtonPress() {
+    LOG_DEBUG("ThroughputMeshScreen::handleGPIOButtonPress()");
+    bool keepRunning = handleButton();
+    m_display->updateActivityTimestamp();
+    return keepRunning;
+}
+
+void ThroughputMeshScreen::refreshSettings() {
+    auto& dependencies = ModuleDependency::getInstance();
+
+    std::string exportPath = dependencies.getDependencyPath("throughputmesh", "export");
+    m_options.exportPath = exportPath.empty() ? Config::MESH_EXPORT_PATH : exportPath;
+
+    std::string duration = dependencies.getDependencyPath("throughputmesh", "duration");
+    std::string parallel = dependencies.getDependencyPath("throughputmesh", "parallel");
+    try {
+        if (!duration.empty()) {
+            m_options.durationSec = std::max(1, std::min(std::stoi(duration), 300));
+        }
+        if (!parallel.empty()) {
+            m_options.parallel = std::max(1, std::min(std::stoi(parallel), 16));
+        }
+    } catch (...) {
+        Logger::warning("ThroughputMeshScreen: ignoring invalid duration/parallel setting");
+    }
+
+    m_nodeName = dependencies.getDependencyPath("throughputmesh", "name");
+    if (m_nodeName.empty()) {
+        char hostname[64] = {0};
+        m_nodeName = gethostname(hostname, sizeof(hostname) - 1) == 0 && hostname[0] ? hostname : "micropanel";
+    }
+
+    // First non-loopback IPv4 address, as ThroughputServerScreen announces
+    m_selfAddress.clear();
+    for (const auto& link : NetworkState::getInstance().getInterfaces()) {
+        const NetworkState::Address* address = link.firstAddress(AF_INET);
+        if (address && address->address != "127.0.0.1") {
+            m_selfAddress = address->address;
+            break;
+        }
+    }
+}
+
+void ThroughputMeshScreen::startAgent() {
+    if (m_agent.isRunning()) {
+        return;
+    }
+    if (!m_agent.start(m_nodeName, Config::MESH_CONTROL_PORT, Config::MESH_IPERF_PORT)) {
+        Logger::error("ThroughputMeshScreen: mesh agent did not start, this unit cannot take part");
+    }
+}
+
+void ThroughputMeshScreen::startDiscovery() {
+    m_message.clear();
+    if (!MdnsBrowser::getInstance().browse({Config::MESH_SERVICE_TYPE}, Config::MESH_DISCOVERY_MS)) {
+        m_message = "mDNS failed";
+    }
+    mergeDiscovered();
+}
+
+void ThroughputMeshScreen::mergeDiscovered() {
+    // Cached records show up at once; later answers are appended, and a
+    // cursor on Rescan/Start/Back moves along with its item
+    size_t before = m_peers.size();
+    for (const auto& service : MdnsBrowser::getInstance().getServices(Config::MESH_SERVICE_TYPE)) {
+        if (service.address == m_selfAddress) {
+            continue;
+        }
+        auto known = std::find_if(m_peers.begin(), m_peers.end(),
+                                  [&service](const Peer& peer) { return peer.node.address == service.address; });
+        if (known != m_peers.end() || m_peers.size() + 1 >= static_cast<size_t>(Config::MESH_MAX_NODES)) {
+            continue;
+        }
+
+        Peer peer;
+        peer.node.address = service.address;
+        peer.node.controlPort = service.port;
+        peer.node.iperfPort = Config::MESH_IPERF_PORT;
+        peer.node.name = service.instance;
+        if (peer.node.name.compare(0, strlen(INSTANCE_PREFIX), INSTANCE_PREFIX) == 0) {
+            peer.node.name = peer.node.name.substr(strlen(INSTANCE_PREFIX));
+        }
+        for (const auto& entry : service.txt) {
+            if (entry.compare(0, 6, "iperf=") == 0) {
+                peer.node.iperfPort = atoi(entry.c_str() + 6);
+            }
+        }
+        LOG_DEBUG("ThroughputMeshScreen: peer " + peer.node.name + " at " + peer.node.address);
+        m_peers.push_back(peer);
+    }
+    if (m_selected >= static_cast<int>(before)) {
+        m_selected += static_cast<int>(m_peers.size() - before);
+    }
+}
+
+void ThroughputMeshScreen::startRun() {
+    m_message.clear();
+    if (m_selfAddress.empty()) {
+        m_message = "No IPv4 address";
+        return;
+    }
+
+    std::vector<MeshCoordinator::Node> nodes;
+    nodes.push_back({m_nodeName, m_selfAddress, Config::MESH_CONTROL_PORT, Config::MESH_IPERF_PORT});
+    for (const auto& peer : m_peers) {
+        if (peer.selected) {
+            nodes.push_back(peer.node);
+        }
+    }
+    if (nodes.size() < 2) {
+        m_message = "Select a peer";
+        return;
+    }
+
+    if (!m_coordinator.start(nodes, m_options)) {
+        m_message = "Start failed";
+        return;
+    }
+    m_view = View::RUNNING;
+}
+
+void ThroughputMeshScreen::handleRotation(int direction) {
+    switch (m_view) {
+        case View::MENU: {
+            int count = static_cast<int>(Item::COUNT);
+            int item = static_cast<int>(m_item);
+            item = (item + (direction < 0 ? count - 1 : 1)) % count;
+            m_item = static_cast<Item>(item);
+            break;
+        }
+        case View::PEERS: {
+            int last = static_cast<int>(m_peers.size()) + 2;   // Rescan, Start, Back
+            m_selected = std::max(0, std::min(m_selected + (direction < 0 ? -1 : 1), last));
+            break;
+        }
+        case View::MATRIX: {
+            int nodes = static_cast<int>(m_nodes.size());
+            int pages = (nodes + MATRIX_COLUMNS - 1) / MATRIX_COLUMNS;
+            m_selected = std::max(0, std::min(m_selected + (direction < 0 ? -1 : 1), nodes * pages));
+            break;
+        }
+        case View::RUNNING:
+        case View::STATUS:
+            return;
+    }
+
+    render();
+}
+
+bool ThroughputMeshScreen::handleButton() {
+    switch (m_view) {
+        case View::MENU:
+            switch (m_item) {
+                case Item::COORDINATE:
+                    if (m_coordinator.isRunning()) {
+                        m_view = View::RUNNING;
+                        break;
+                    }
+                    m_view = View::PEERS;
+                    m_selected = static_cast<int>(m_peers.size()) + 1;   // Start
+                    m_scrollOffset = 0;
+                    startDiscovery();
+                    break;
+                case Item::STATUS:
+                    m_view = View::STATUS;
+                    break;
+                case Item::PATTERN:
+                    m_options.pattern = m_options.pattern == MeshCoordinator::Pattern::HUB
+                                            ? MeshCoordinator::Pattern::FULL : MeshCoordinator::Pattern::HUB;
+                    break;
+                case Item::ORDER:
+                    m_options.order = m_options.order == MeshCoordinator::Order::STAGGERED
+                                          ? MeshCoordinator::Order::CONCURRENT : MeshCoordinator::Order::STAGGERED;
+                    break;
+                case Item::DURATION: {
+                    // Next preset up from the current value, wrapping to the first
+                    int next = DURATIONS[0];
+                    for (int duration : DURATIONS) {
+                        if (duration > m_options.durationSec) {
+                            next = duration;
+                            break;
+                        }
+                    }
+                    m_options.durationSec = next;
+                    break;
+                }
+                case Item::BACK:
+                case Item::COUNT:
+                    m_shouldExit = true;
+                    return false;
+            }
+            break;
+
+        case View::PEERS: {
+            int peers = static_cast<int>(m_peers.size());
+            if (m_selected < peers) {
+                m_peers[m_selected].selected = !m_peers[m_selected].selected;
+            } else if (m_selected == peers) {
+                m_peers.clear();
+                m_selected = 1;
+                startDiscovery();
+            } else if (m_selected == peers + 1) {
+                startRun();
+            } else {
+                m_view = View::MENU;
+            }
+            break;
+        }
+
+        case View::RUNNING:
+            // Results gathered so far still make it into the matrix and export
+            m_coordinator.cancel();
+            break;
+
+        case View::MATRIX: {
+            int nodes = static_cast<int>(m_nodes.size());
+            int pages = (nodes + MATRIX_COLUMNS - 1) / MATRIX_COLUMNS;
+            if (m_selected >= nodes * pages) {
+                m_view = View::MENU;
+            }
+            break;
+        }
+
+        case View::STATUS:
+            m_view = View::MENU;
+            break;
+    }
+
+    render();
+    return true;
+}
+
+void ThroughputMeshScreen::render() {
+    switch (m_view) {
+        case View::MENU:
+            renderMenu();
+            break;
+        case View::PEERS:
+            renderPeers();
+            break;
+        case View::RUNNING:
+            renderRunning();
+            break;
+        case View::MATRIX:
+            renderMatrix();
+            break;
+        case View::STATUS:
+            renderStatus();
+            break;
+    }
+}
+
+void ThroughputMeshScreen::renderMenu() {
+    auto marker = [this](Item item) { return std::string(m_item == item ? ">" : " "); };
+
+    m_rows.draw(0, " Throughput Mesh");
+    m_rows.draw(1, Config::MENU_SEPARATOR);
+    m_rows.draw(2, marker(Item::COORDINATE) + (m_coordinator.isRunning() ? "Progress" : "Coordinate"));
+    m_rows.draw(3, marker(Item::STATUS) + "Node status");
+    m_rows.draw(4, marker(Item::PATTERN) + "Mode: " +
+                (m_options.pattern == MeshCoordinator::Pattern::HUB ? "Hub" : "Full"));
+    m_rows.draw(5, marker(Item::ORDER) + "Order: " +
+                (m_options.order == MeshCoordinator::Order::STAGGERED ? "Stagger" : "Concur"));
+    m_rows.draw(6, marker(Item::DURATION) + "Time: " + std::to_string(m_options.durationSec) + "s");
+    m_rows.draw(7, marker(Item::BACK) + "Back");
+}
+
+void ThroughputMeshScreen::renderPeers() {
+    std::string header = m_message;
+    if (header.empty()) {
+        header = "Peers: " + std::to_string(m_peers.size());
+        if (MdnsBrowser::getInstance().isBrowsing()) {
+            header += " ...";
+        }
+    }
+    m_rows.draw(0, header);
+    m_rows.draw(1, Config::MENU_SEPARATOR);
+
+    // Peers ('*' = in the test), then Rescan, Start and Back
+    int peers = static_cast<int>(m_peers.size());
+    int itemCount = peers + 3;
+    if (m_selected < m_scrollOffset) {
+        m_scrollOffset = m_selected;
+    } else if (m_selected >= m_scrollOffset + VISIBLE_ROWS) {
+        m_scrollOffset = m_selected - VISIBLE_ROWS + 1;
+    }
+    m_scrollOffset = std::max(0, std::min(m_scrollOffset, itemCount - VISIBLE_ROWS));
+
+    static const char* const ACTIONS[] = {"Rescan", "Start", "Back"};
+    for (int row = 0; row < VISIBLE_ROWS; row++) {
+        int item = m_scrollOffset + row;
+        std::string line;
+        if (item < peers) {
+            line = std::string(item == m_selected ? ">" : " ") + (m_peers[item].selected ? "*" : " ") +
+                   m_peers[item].node.name.substr(0, 13);
+        } else if (item < itemCount) {
+            line = std::string(item == m_selected ? ">" : " ") + ACTIONS[item - peers];
+        }
+
+        if (line.size() < 16) line.resize(16, ' ');
+        if (row == 0 && m_scrollOffset > 0) line[15] = '^';
+        if (row == VISIBLE_ROWS - 1 && m_scrollOffset + VISIBLE_ROWS < itemCount) line[15] = 'v';
+
+        m_rows.draw(2 + row, line);
+    }
+}
+
+void ThroughputMeshScreen::renderRunning() {
+    MeshCoordinator::Progress progress = m_coordinator.getProgress();
+    if (!progress.running) {
+        m_nodes = m_coordinator.getNodes();
+        m_results = m_coordinator.getResults();
+        m_view = View::MATRIX;
+        m_selected = 0;
+        renderMatrix();
+        return;
+    }
+
+    m_rows.draw(0, "   Mesh Test");
+    m_rows.draw(1, Config::MENU_SEPARATOR);
+    m_rows.draw(2, progress.phase);
+    m_rows.draw(3, "Tests " + std::to_string(progress.finished) + "/" + std::to_string(progress.total));
+    m_rows.draw(4, progress.secondsLeft > 0.0 ? "Left " + std::to_string(static_cast<int>(progress.secondsLeft + 0.5)) + "s"
+                                           : "");
+    m_rows.draw(5, "");
+    m_rows.draw(6, "");
+    m_rows.draw(7, ">Cancel");
+}
+
+void ThroughputMeshScreen::renderMatrix() {
+    // Rows send, columns receive; the cursor walks the rows of one column
+    // page after the other, then lands on Back
+    int nodes = static_cast<int>(m_nodes.size());
+    int pages = (nodes + MATRIX_COLUMNS - 1) / MATRIX_COLUMNS;
+    bool back = m_selected >= nodes * pages;
+    int row = back ? 0 : m_selected % nodes;
+    int page = back ? 0 : m_selected / nodes;
+    int firstColumn = page * MATRIX_COLUMNS;
+    int top = std::max(0, std::min(row - MATRIX_ROWS + 1, nodes - MATRIX_ROWS));
+    if (row < top) top = row;
+
+    std::string header = "Mb";
+    for (int column = firstColumn; column < std::min(nodes, firstColumn + MATRIX_COLUMNS); column++) {
+        header += "   ";
+        header += nodeLabel(column);
+    }
+    header.resize(16, ' ');
+    if (page + 1 < pages) header[15] = '>';
+    m_rows.draw(0, header);
+
+    for (int line = 0; line < MATRIX_ROWS; line++) {
+        int from = top + line;
+        std::string text;
+        if (from < nodes) {
+            text += (!back && from == row) ? '>' : ' ';
+            text += nodeLabel(from);
+            for (int to = firstColumn; to < std::min(nodes, firstColumn + MATRIX_COLUMNS); to++) {
+                text += from == to ? "   -" : formatCell(findResult(m_results, from, to));
+            }
+        }
+        text.resize(16, ' ');
+        if (line == 0 && top > 0) text[15] = '^';
+        if (line == MATRIX_ROWS - 1 && top + MATRIX_ROWS < nodes) text[15] = 'v';
+        m_rows.draw(1 + line, text);
+    }
+
+    // Footer: the selected node, or the outcome on Back
+    std::string footer;
+    if (!back && row < nodes) {
+        footer = std::string(1, nodeLabel(row)) + " " + m_nodes[row].address;
+    } else {
+        int done = 0, failed = 0;
+        for (const auto& result : m_results) {
+            if (result.state == MeshCoordinator::State::DONE) done++;
+            else failed++;
+        }
+        footer = "Ok " + std::to_string(done) + " Fail " + std::to_string(failed);
+    }
+    m_rows.draw(6, footer);
+    m_rows.draw(7, back ? ">Back" : " Back");
+}
+
+void ThroughputMeshScreen::renderStatus() {
+    MeshAgent::Status status = m_agent.getStatus();
+
+    m_rows.draw(0, "   Mesh Node");
+    m_rows.draw(1, Config::MENU_SEPARATOR);
+    m_rows.draw(2, status.running ? status.name : "Agent stopped");
+    m_rows.draw(3, m_selfAddress.empty() ? "No IPv4 address" : m_selfAddress);
+    m_rows.draw(4, std::string(status.announced ? "Announced" : "Not announced"));
+    m_rows.draw(5, "Tests run " + std::to_string(status.testsRun));
+
+    std::string activity = "Idle";
+    if (status.testsActive > 0) {
+        activity = "Tx " + status.activity;
+    } else if (status.serverClients > 0) {
+        activity = "Serving " + std::to_string(status.serverClients);
+    }
+    m_rows.draw(6, activity);
+    m_rows.draw(7, ">Back");
+}
+
+MICROPANEL_REGISTER_MODULE("throughputmesh", ThroughputMeshScreen);
@@ -1,17 +1,21 @@
 #include "ScreenModules.h"
+#include "ModuleCatalog.h"
 #include "MenuSystem.h"
 #include "DeviceInterfaces.h"
 #include "Config.h"
 #include "Logger.h"
 #include "ModuleDependency.h"
+#include "NetworkState.h"
+#include "PerfCounters.h"
 #include <iostream>
 #include <unistd.h>
 #include <cstdlib>   // For std::exit
 #include <sstream>
-#include <ifaddrs.h>
 #include <netinet/in.h>
 #include <arpa/inet.h>
 #include <cstring>
+#include <cstdio>
+#include <ctime>
 #include <signal.h>
 #include <sys/types.h>
 #include <sys/wait.h>
@@ -31,21 +35,21 @@ ThroughputServerScreen::ThroughputServerScreen(std::shared_ptr<Display> display,
     auto& dependencies = ModuleDependency::getInstance();
 
     // First try to get port from the server-specific config
-    Logger::debug("ThroughputServerScreen: Attempting to read port from 'throughputserver/default_port'");
+    LOG_DEBUG("ThroughputServerScreen: Attempting to read port from 'throughputserver/default_port'");
     std::string portStr = dependencies.getDependencyPath("throughputserver", "default_port");
-    Logger::debug("ThroughputServerScreen: Got value: '" + portStr + "'");
+    LOG_DEBUG("ThroughputServerScreen: Got value: '" + portStr + "'");
 
     // If not found, try the general throughput config
     if (portStr.empty()) {
-        Logger::debug("ThroughputServerScreen: Falling back to 'throughputtest/default_port'");
+        LOG_DEBUG("ThroughputServerScreen: Falling back to 'throughputtest/default_port'");
         portStr = dependencies.getDependencyPath("throughputtest", "default_port");
-        Logger::debug("ThroughputServerScreen: Got value: '" + portStr + "'");
+        LOG_DEBUG("ThroughputServerScreen: Got value: '" + portStr + "'");
     }
 
     // Parse port value
     if (!portStr.empty()) {
         try {
-            Logger::debug("ThroughputServerScreen: Converting port string '" + portStr + "' to integer");
+            LOG_DEBUG("ThroughputServerScreen: Converting port string '" + portStr + "' to integer");
             int portValue = std::stoi(portStr);
 
             // Only update m_port if a valid value was found
@@ -65,7 +69,13 @@ ThroughputServerScreen::ThroughputServerScreen(std::shared_ptr<Display> display,
     }
 
     // Print the final port value being used
-    Logger::debug("ThroughputServerScreen: Final configured port is: " + std::to_string(m_port));
+    LOG_DEBUG("ThroughputServerScreen: Final configured port is: " + std::to_string(m_port));
+
+    // The built-in server is the default; "iperf3" forks the external binary instead
+    std::string engine = dependencies.getDependencyPath("throughputserver", "server_engine");
+    m_useNativeEngine = engine != "iperf3";
+    LOG_DEBUG("ThroughputServerScreen: Using " + std::string(m_useNativeEngine ? "built-in" : "iperf3") +
+                  " server engine");
 
     // Get local IP address
     getLocalIpAddress();
@@ -87,7 +97,7 @@ ThroughputServerScreen::~ThroughputServerScreen() {
 }
 
 void ThroughputServerScreen::enter() {
-    Logger::debug("ThroughputServerScreen: Entered");
+    LOG_DEBUG("ThroughputServerScreen: Entered");
     m_running = true;
     refreshSettings();
     // Reset selection
@@ -113,11 +123,12 @@ void ThroughputServerScreen::enter() {
 }
 
 void ThroughputServerScreen::update() {
-    // Nothing to update periodically
+    // Live per-client throughput from the built-in server
+    drawClientStatus(false);
 }
 
 void ThroughputServerScreen::exit() {
-    Logger::debug("ThroughputServerScreen: Exiting");
+    LOG_DEBUG("ThroughputServerScreen: Exiting");
 
     // Note: We deliberately do NOT stop the server here
     // to allow it to continue running in the background
@@ -159,7 +170,7 @@ bool ThroughputServerScreen::handleInput() {
                 // Handle button press
                 buttonPressed = true;
                 m_display->updateActivityTimestamp();
-                Logger::debug("ThroughputServerScreen: Button pressed");
+                LOG_DEBUG("ThroughputServerScreen: Button pressed");
             }
         );
 
@@ -210,14 +221,8 @@ void ThroughputServerScreen::renderOptions(bool fullRedraw) {
         m_display->drawText(0, 8, "----------------");
         usleep(Config::DISPLAY_CMD_DELAY);
 
-        // Draw IP address at position 48
-        m_display->drawText(0, 48, m_localIp);
-        usleep(Config::DISPLAY_CMD_DELAY);
-
-        // Show port information at position 56
-        std::string portInfo = "Port:" + std::to_string(m_port);
-        m_display->drawText(0, 56, portInfo);
-        usleep(Config::DISPLAY_CMD_DELAY);
+        // IP address and port at 48/56, or connected clients
+        drawClientStatus(true);
     } else {
         // Just clear selection markers for minimal update
         for (size_t i = 0; i < m_options.size(); i++) {
@@ -260,20 +265,86 @@ void ThroughputServerScreen::renderOptions(bool fullRedraw) {
     }
 }
 
+void ThroughputServerScreen::drawClientStatus(bool force) {
+    time_t now = time(nullptr);
+    if (!force && now == m_lastStatusUpdate) {
+        return;
+    }
+    m_lastStatusUpdate = now;
+
+    std::vector<Iperf3Server::ClientInfo> clients;
+    if (m_useNativeEngine && m_server.isRunning()) {
+        clients = m_server.getClients();
+    }
+
+    // Pick up an address change without waiting for the screen to be re-entered
+    if (NetworkState::getInstance().getGeneration() != m_networkGeneration) {
+        getLocalIpAddress();
+    }
+
+    std::string lines[2];
+    if (clients.empty()) {
+        lines[0] = m_localIp;
+        lines[1] = "Port:" + std::to_string(m_port);
+        m_clientIndex = 0;
+    } else {
+        // Cycle through clients every two seconds when several are connected
+        if (!force && now % 2 == 0) {
+            m_clientIndex++;
+        }
+        size_t index = m_clientIndex % clients.size();
+        const Iperf3Server::ClientInfo& client = clients[index];
+
+        lines[0] = client.address.substr(0, 16);
+
+        char rate[16];
+        double mbps = client.finished ? client.averageMbps : client.mbps;
+        if (mbps >= 10000.0) {
+            snprintf(rate, sizeof(rate), "%.2fGbps", mbps / 1000.0);
+        } else {
+            snprintf(rate, sizeof(rate), "%.1fMbps", mbps);
+        }
+
+        char detail[48];
+        if (clients.size() > 1) {
+            snprintf(detail, sizeof(detail), " %zu/%zu", index + 1, clients.size());
+        } else if (client.finished) {
+            snprintf(detail, sizeof(detail), " done");
+        } else {
+            snprintf(detail, sizeof(detail), " %d/%ds", static_cast<int>(client.elapsed), client.durationSec);
+        }
+        lines[1] = std::string(rate) + detail;
+    }
+
+    for (int i = 0; i < 2; i++) {
+        std::string text = lines[i].substr(0, 16);
+        while (text.length() < 16) {
+            text += " ";
+        }
+        // Skip I2C traffic when nothing changed
+        if (!force && text == m_statusLines[i]) {
+            continue;
+        }
+        m_statusLines[i] = text;
+        m_display->drawText(0, 48 + i * 8, text);
+        usleep(Config::DISPLAY_CMD_DELAY);
+    }
+}
+
 std::string ThroughputServerScreen::getIperf3Path() {
     auto& dependencies = ModuleDependency::getInstance();
 
     // Debug iperf3 path lookup
-    Logger::debug("ThroughputServerScreen: Looking for iperf3 path");
+    LOG_DEBUG("ThroughputServerScreen: Looking for iperf3 path");
 
     // First check server-specific iperf3 path, then fall back to general throughput config
     std::string path = dependencies.getDependencyPath("throughputserver", "iperf3_path");
-    Logger::debug("ThroughputServerScreen: 'throughputserver/iperf3_path' value: '" + path + "'");
+    LOG_DEBUG("ThroughputServerScreen: 'throughputserver/iperf3_path' value: '" + path + "'");
 
     if (path.empty()) {
-        Logger::debug("ThroughputServerScreen: Falling back to 'throughputtest'");
+        LOG_DEBUG("ThroughputServerScreen: Falling back to 'throughputtest'");
         path = dependencies.getDependencyPath("throughputtest", "iperf3_path");
-        Logger::debug("ThroughputServerScreen: 'throughputtest/iperf3_path' value: '" + path + "'");
+        LOG_DEBUG("ThroughputServerScreen: 'throughputtest/iperf3_path' value: '" + path + "'");
     }
     if (path.empty()) {
         return "/usr/bin/iperf3";
@@ -282,42 +353,22 @@ std::string ThroughputServerScreen::getIperf3Path() {
 }
 
 void ThroughputServerScreen::getLocalIpAddress() {
-    struct ifaddrs *ifaddr, *ifa;
-    int family;
-    char host[128];  // Fixed size buffer for IP address
-
-    if (getifaddrs(&ifaddr) == -1) {
-        Logger::error("ThroughputServerScreen: Failed to get network interfaces");
-        m_localIp = "Unknown";
-        return;
-    }
+    NetworkState& network = NetworkState::getInstance();
+    m_networkGeneration = network.getGeneration();
+    m_localIp.clear();
 
     // Look for the first non-loopback IPv4 address
-    for (ifa = ifaddr; ifa != nullptr; ifa = ifa->ifa_next) {
-        if (ifa->ifa_addr == nullptr) {
+    for (const auto& link : network.getInterfaces()) {
+        const NetworkState::Address* address = link.firstAddress(AF_INET);
+        if (!address || address->address == "127.0.0.1") {
             continue;
         }
 
-        family = ifa->ifa_addr->sa_family;
-
-        // Only consider IPv4 addresses
-        if (family == AF_INET) {
-            struct sockaddr_in *sa = (struct sockaddr_in *)ifa->ifa_addr;
-            inet_ntop(AF_INET, &(sa->sin_addr), host, sizeof(host));
-
-            // Skip loopback addresses
-            if (strcmp(host, "127.0.0.1") == 0) {
-                continue;
-            }
-
-            m_localIp = host;
-            Logger::debug("ThroughputServerScreen: Local IP address: " + m_localIp);
-            break;
-        }
+        m_localIp = address->address;
+        LOG_DEBUG("ThroughputServerScreen: Local IP address: " + m_localIp);
+        break;
     }
 
-    freeifaddrs(ifaddr);
-
     if (m_localIp.empty()) {
         m_localIp = "Unknown";
         Logger::warning("ThroughputServerScreen: Could not determine local IP address");
@@ -325,6 +376,19 @@ void ThroughputServerScreen::getLocalIpAddress() {
 }
 
 void ThroughputServerScreen::startServer() {
+    if (m_useNativeEngine) {
+        stopServer();
+
+        Logger::info("ThroughputServerScreen: Starting built-in server on port: " + std::to_string(m_port));
+        if (!m_server.start(m_port)) {
+            Logger::error("ThroughputServerScreen: Built-in server failed to start on port " +
+                          std::to_string(m_port));
+            return;
+        }
+        startAnnouncement();
+        return;
+    }
+
     // Check if iperf3 is available
     std::string iperf3Path = getIperf3Path();
     if (access(iperf3Path.c_str(), X_OK) != 0) {
@@ -350,10 +414,13 @@ void ThroughputServerScreen::startServer() {
     m_serverThread = std::thread([this, iperf3Path, serverPort]() {
         // Create the port string in this scope
         std::string portStr = std::to_string(serverPort);
-        Logger::debug("ThroughputServerScreen: Thread using port: " + portStr);
+        LOG_DEBUG("ThroughputServerScreen: Thread using port: " + portStr);
 
         // Fork a child process to run iperf3
         pid_t pid = fork();
+        if (pid > 0) {
+            PerfCounters::getInstance().add(PerfCounters::Counter::CHILD_PROCESSES);
+        }
 
         if (pid == 0) {
             // We are in the child process
@@ -398,10 +465,10 @@ void ThroughputServerScreen::startServer() {
 
             // Check exit status
             if (WIFEXITED(status)) {
-                Logger::debug("ThroughputServerScreen: iperf3 server exited with status " +
+                LOG_DEBUG("ThroughputServerScreen: iperf3 server exited with status " +
                               std::to_string(WEXITSTATUS(status)));
             } else if (WIFSIGNALED(status)) {
-                Logger::debug("ThroughputServerScreen: iperf3 server terminated by signal " +
+                LOG_DEBUG("ThroughputServerScreen: iperf3 server terminated by signal " +
                               std::to_string(WTERMSIG(status)));
             }
 
@@ -420,9 +487,16 @@ void ThroughputServerScreen::startServer() {
     usleep(100000); // 100ms
 
     // Start Avahi service announcement after iperf3 is running
+    startAnnouncement();
+}
+
+void ThroughputServerScreen::startAnnouncement() {
     if (isAvahiAvailable()) {
         // Fork process to run avahi-publish
         pid_t avahi_pid = fork();
+        if (avahi_pid > 0) {
+            PerfCounters::getInstance().add(PerfCounters::Counter::CHILD_PROCESSES);
+        }
 
         if (avahi_pid == 0) {
             // Child process - run avahi-publish
@@ -455,7 +529,7 @@ void ThroughputServerScreen::startServer() {
 void ThroughputServerScreen::stopServer() {
     // First, stop the Avahi announcement
     if (m_avahiPid > 0) {
-        Logger::debug("ThroughputServerScreen: Stopping Avahi announcement with PID " +
+        LOG_DEBUG("ThroughputServerScreen: Stopping Avahi announcement with PID " +
                      std::to_string(m_avahiPid));
         // Send SIGTERM to the process
         if (kill(m_avahiPid, SIGTERM) == 0) {
@@ -473,9 +547,12 @@ void ThroughputServerScreen::stopServer() {
         m_avahiPid = -1;
     }
 
+    // Stop the built-in server; no-op when it isn't running
+    m_server.stop();
+
     // Kill the server process if it's running
     if (m_serverPid > 0) {
-        Logger::debug("ThroughputServerScreen: Stopping iperf3 server with PID " + std::to_string(m_serverPid));
+        LOG_DEBUG("ThroughputServerScreen: Stopping iperf3 server with PID " + std::to_string(m_serverPid));
 
         // Send SIGTERM to the process
         if (kill(m_serverPid, SIGTERM) == 0) {
@@ -499,6 +576,10 @@ void ThroughputServerScreen::stopServer() {
 }
 
 bool ThroughputServerScreen::isServerRunning() const {
+    if (m_useNativeEngine) {
+        return m_server.isRunning();
+    }
+
     if (m_serverPid <= 0) {
         return false;
     }
@@ -539,7 +620,7 @@ void ThroughputServerScreen::refreshSettings() {
 
 // GPIO support methods
 void ThroughputServerScreen::handleGPIORotation(int direction) {
-    Logger::debug("ThroughputServerScreen: handleGPIORotation called with direction: " + std::to_string(direction));
+    LOG_DEBUG("ThroughputServerScreen: handleGPIORotation called with direction: " + std::to_string(direction));
 
     // Handle menu navigation
     int oldSelection = m_selectedOption;
@@ -567,7 +648,7 @@ void ThroughputServerScreen::handleGPIORotation(int direction) {
 }
 
 bool ThroughputServerScreen::handleGPIOButtonPress() {
-    Logger::debug("ThroughputServerScreen: handleGPIOButtonPress called");
+    LOG_DEBUG("ThroughputServerScreen: handleGPIOButtonPress called");
 
     // Handle button press based on selected option
     switch (m_selectedOption) {
@@ -591,3 +672,5 @@ bool ThroughputServerScreen::handleGPIOButtonPress() {
 
     return true; // Continue running
 }
+
+MICROPANEL_REGISTER_MODULE("throughputserver", ThroughputServerScreen);
@@ -0,0 +1,339 @@
+#include "ScreenModules.h"
+#include "ModuleCatalog.h"
+#include "MenuSystem.h"
+#include "DeviceInterfaces.h"
+#include "HistoryLog.h"
+#include "Logger.h"
+#include "Config.h"
+#include "Scheduler.h"
+#include <algorithm>
+#include <cstdio>
+#include <string>
+#include <memory>
+#include <vector>
+#include <unistd.h>
+
+namespace {
+    constexpr int REFRESH_MS = 1000;
+    constexpr int GRAPH_FIRST_PAGE = 1;
+    constexpr int GRAPH_PAGES = 5;
+    constexpr int WINDOW_COUNT = sizeof(Config::TREND_WINDOWS) / sizeof(Config::TREND_WINDOWS[0]);
+
+    HistoryLog::Kind kindAt(int index) {
+        return static_cast<HistoryLog::Kind>(index + 1);
+    }
+
+    // At most four characters: "9.4", " 941", "1.2k"
+    std::string formatValue(double value) {
+        char buffer[16];
+        if (value < 9.95) {
+            snprintf(buffer, sizeof(buffer), "%.1f", value);
+        } else if (value < 999.5) {
+            snprintf(buffer, sizeof(buffer), "%.0f", value);
+        } else {
+            snprintf(buffer, sizeof(buffer), "%.*fk", value < 9950.0 ? 1 : 0, value / 1000.0);
+        }
+        return buffer;
+    }
+
+    // At most three characters for counts up to the history capacity: "128", "16k"
+    std::string formatCount(unsigned int count) {
+        char buffer[16];
+        if (count < 1000) {
+            snprintf(buffer, sizeof(buffer), "%u", count);
+        } else {
+            snprintf(buffer, sizeof(buffer), "%uk", count / 1000);
+        }
+        return buffer;
+    }
+
+    std::string formatSpan(uint32_t seconds) {
+        char buffer[16];
+        if (seconds < 120) {
+            snprintf(buffer, sizeof(buffer), "%us", seconds);
+        } else if (seconds < 2 * 3600) {
+            snprintf(buffer, sizeof(buffer), "%um", seconds / 60);
+        } else if (seconds < 2 * 86400) {
+            snprintf(buffer, sizeof(buffer), "%uh", seconds / 3600);
+        } else {
+            snprintf(buffer, sizeof(buffer), "%ud", seconds / 86400);
+        }
+        return buffer;
+    }
+}
+
+TrendScreen::TrendScreen(std::shared_ptr<Display> display, std::shared_ptr<InputDevice> input)
+    : ScreenModule(display, input)
+    , m_rows(display)
+{
+}
+
+void TrendScreen::enter() {
+    LOG_DEBUG("TrendScreen: Entered");
+
+    m_view = View::LIST;
+    m_selected = 0;
+    m_scrollOffset = 0;
+    m_shouldExit = false;
+    countRecords();
+
+    // Results land in the ring from other screens' background work too
+    m_refreshJob = Scheduler::getInstance().add("trends refresh", REFRESH_MS, Scheduler::Cost::LIGHT, true,
+                                                [this]() {
+        if (HistoryLog::getInstance().end() == m_shownEnd) {
+            return;
+        }
+        if (m_view == View::LIST) {
+            countRecords();
+        }
+        render();
+    });
+
+    m_display->clear();
+    usleep(Config::DISPLAY_CMD_DELAY * 3);
+    m_rows.invalidate();
+    render();
+}
+
+void TrendScreen::update() {
+    // Redrawn from the refresh job when the ring grows
+}
+
+void TrendScreen::exit() {
+    LOG_DEBUG("TrendScreen: Exiting");
+
+    if (m_refreshJob >= 0) {
+        Scheduler::getInstance().remove(m_refreshJob);
+        m_refreshJob = -1;
+    }
+
+    m_display->clear();
+    usleep(Config::DISPLAY_CMD_DELAY * 3);
+}
+
+bool TrendScreen::handleInput() {
+    if (m_input->waitForEvents(100) > 0) {
+        bool buttonPressed = false;
+        int rotationDirection = 0;
+
+        m_input->processEvents(
+            [this, &rotationDirection](int direction) {
+                rotationDirection = direction;
+                m_display->updateActivityTimestamp();
+            },
+            [this, &buttonPressed]() {
+                buttonPressed = true;
+                m_display->updateActivityTimestamp();
+            }
+        );
+
+        if (buttonPressed) {
+            handleButton();
+        }
+        if (rotationDirection != 0) {
+            handleRotation(rotationDirection);
+        }
+    }
+
+    return !m_shouldExit;
+}
+
+void TrendScreen::handleGPIORotation(int direction) {
+    LOG_DEBUG("TrendScreen::handleGPIORotation(" + std::to_string(direction) + ")");
+    handleRotation(direction);
+    m_display->updateActivityTimestamp();
+}
+
+bool TrendScreen::handleGPIOButtonPress() {
+    LOG_DEBUG("TrendScreen::handleGPIOButtonPress()");
+    bool keepRunning = handleButton();
+    m_display->updateActivityTimestamp();
+    return keepRunning;
+}
+
+void TrendScreen::countRecords() {
+    std::fill(std::begin(m_counts), std::end(m_counts), 0);
+
+    HistoryLog& history = HistoryLog::getInstance();
+    uint64_t last = history.end();
+    uint64_t first = last > history.capacity() ? last - history.capacity() : 1;
+    HistoryLog::Record record;
+    for (uint64_t number = first; number < last; number++) {
+        if (history.load(number, record) && record.kind >= 1 && record.kind <= HistoryLog::KIND_COUNT) {
+            m_counts[record.kind - 1]++;
+        }
+    }
+}
+
+void TrendScreen::handleRotation(int direction) {
+    if (m_view == View::GRAPH) {
+        // Cycle how many of the newest results are graphed
+        m_window = (m_window + (direction > 0 ? 1 : WINDOW_COUNT - 1)) % WINDOW_COUNT;
+        render();
+        return;
+    }
+
+    m_selected = std::max(0, std::min(m_selected + (direction > 0 ? 1 : -1), static_cast<int>(HistoryLog::KIND_COUNT)));
+    if (m_selected < m_scrollOffset) {
+        m_scrollOffset = m_selected;
+    } else if (m_selected >= m_scrollOffset + VISIBLE_ROWS) {
+        m_scrollOffset = m_selected - VISIBLE_ROWS + 1;
+    }
+    render();
+}
+
+bool TrendScreen::handleButton() {
+    if (m_view == View::GRAPH) {
+        m_view = View::LIST;
+        countRecords();
+    } else if (m_selected == HistoryLog::KIND_COUNT) {
+        m_shouldExit = true;
+        return false;
+    } else {
+        m_view = View::GRAPH;
+    }
+
+    // The graph blits over text rows, so switching views starts clean
+    m_display->clear();
+    usleep(Config::DISPLAY_CMD_DELAY * 3);
+    m_rows.invalidate();
+    render();
+    return true;
+}
+
+void TrendScreen::render() {
+    m_shownEnd = HistoryLog::getInstance().end();
+    if (m_view == View::GRAPH) {
+        renderGraph();
+    } else {
+        renderList();
+    }
+}
+
+void TrendScreen::renderList() {
+    m_rows.draw(0, HistoryLog::getInstance().isOpen() ? " Trends" : " Trends (off)");
+    m_rows.draw(1, Config::MENU_SEPARATOR);
+
+    for (int row = 0; row < VISIBLE_ROWS; row++) {
+        int index = m_scrollOffset + row;
+        std::string line;
+        if (index < HistoryLog::KIND_COUNT) {
+            char text[32];
+            snprintf(text, sizeof(text), "%c%-10s%5zu", index == m_selected ? '>' : ' ',
+                     HistoryLog::kindLabel(kindAt(index)), m_counts[index]);
+            line = text;
+        } else if (index == HistoryLog::KIND_COUNT) {
+            line = std::string(index == m_selected ? ">" : " ") + "Back";
+        }
+        m_rows.draw(2 + row, line);
+    }
+}
+
+void TrendScreen::renderGraph() {
+    HistoryLog::Kind kind = kindAt(m_selected);
+    size_t limit = static_cast<size_t>(Config::TREND_WINDOWS[m_window]);
+
+    // Newest first out of the mapping, graphed oldest to newest
+    std::vector<HistoryLog::Record> records;
+    records.reserve(std::min(limit, HistoryLog::getInstance().capacity()));
+    HistoryLog::getInstance().forEachNewest(kind, limit, [&records](const HistoryLog::Record& record) {
+        records.push_back(record);
+        return true;
+    });
+    std::reverse(records.begin(), records.end());
+
+    double low = 0.0;
+    double high = 0.0;
+    double sum = 0.0;
+    unsigned int succeeded = 0;
+    for (const auto& record : records) {
+        if (record.failed()) {
+            continue;
+        }
+        low = succeeded == 0 ? record.value : std::min(low, static_cast<double>(record.value));
+        high = std::max(high, static_cast<double>(record.value));
+        sum += record.value;
+        succeeded++;
+    }
+    unsigned int failed = static_cast<unsigned int>(records.size()) - succeeded;
+
+    std::string span = records.empty() ? "" : formatSpan(records.back().time - records.front().time);
+    char text[32];
+    snprintf(text, sizeof(text), "%-11s%5s", HistoryLog::kindLabel(kind), span.c_str());
+    m_rows.draw(0, text);
+
+    if (records.empty()) {
+        m_rows.draw(3, "No results yet");
+        m_rows.draw(6, "");
+        m_rows.draw(7, "");
+        return;
+    }
+
+    if (m_display->supportsBlit()) {
+        drawGraph(records, high);
+    } else {
+        snprintf(text, sizeof(text), "Last %s", records.back().failed() ? "fail" : formatValue(records.back().value).c_str());
+        m_rows.draw(2, text);
+        snprintf(text, sizeof(text), "of %zu newest", records.size());
+        m_rows.draw(3, text);
+    }
+
+    // Both rows fit 16 columns at the widest values: "lo 1.2k hi 1.2k"
+    // and "av 1.2k x16k/16k" (failures of total)
+    std::string counts = "x" + formatCount(failed) + "/" + formatCount(static_cast<unsigned int>(records.size()));
+    if (succeeded > 0) {
+        snprintf(text, sizeof(text), "lo %-4s hi %s", formatValue(low).c_str(), formatValue(high).c_str());
+        m_rows.draw(6, text);
+        snprintf(text, sizeof(text), "av %-4s %s", formatValue(sum / succeeded).c_str(), counts.c_str());
+        m_rows.draw(7, text);
+    } else {
+        m_rows.draw(6, "All failed");
+        m_rows.draw(7, counts);
+    }
+}
+
+void TrendScreen::drawGraph(const std::vector<HistoryLog::Record>& records, double peak) {
+    // One column per result up to the display width, newest at the right
+    // edge; beyond that each column averages a bin of results. A bin with a
+    // failure gets a tick at the top.
+    constexpr int WIDTH = Config::DISPLAY_WIDTH;
+    constexpr int HEIGHT = GRAPH_PAGES * 8;
+    uint8_t pixels[GRAPH_PAGES * WIDTH] = {0};
+
+    size_t count = records.size();
+    int columns = static_cast<int>(std::min<size_t>(count, WIDTH));
+    for (int column = 0; column < columns; column++) {
+        size_t begin = count * column / columns;
+        size_t end = count * (column + 1) / columns;
+        double sum = 0.0;
+        int succeeded = 0;
+        bool anyFailed = false;
+        for (size_t i = begin; i < end; i++) {
+            if (records[i].failed()) {
+                anyFailed = true;
+            } else {
+                sum += records[i].value;
+                succeeded++;
+            }
+        }
+
+        int x = WIDTH - columns + column;
+        int bar = 0;
+        if (succeeded > 0 && peak > 0.0 && sum > 0.0) {
+            bar = std::max(1, static_cast<int>(sum / succeeded / peak * (HEIGHT - 3) + 0.5));
+        }
+        for (int y = 0; y < bar; y++) {
+            int row = HEIGHT - 1 - y;
+            pixels[(row / 8) * WIDTH + x] |= static_cast<uint8_t>(1 << (row % 8));
+        }
+        if (anyFailed) {
+            pixels[x] |= 0x03;
+        }
+    }
+
+    MonoFrame::Window window = {GRAPH_FIRST_PAGE, GRAPH_FIRST_PAGE + GRAPH_PAGES - 1, 0, WIDTH - 1};
+    m_display->blit(window, pixels);
+    usleep(Config::DISPLAY_CMD_DELAY);
+}
+
+MICROPANEL_REGISTER_MODULE("trends", TrendScreen);
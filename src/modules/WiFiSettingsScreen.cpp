@@ -1,213 +1,398 @@
 #include "ScreenModules.h"
+#include "ModuleCatalog.h"
+#include "ModuleDependency.h"
 #include "MenuSystem.h"
 #include "DeviceInterfaces.h"
+#include "WirelessState.h"
+#include "Logger.h"
 #include "Config.h"
-#include <iostream>
+#include "Scheduler.h"
+#include <algorithm>
+#include <cstdio>
+#include <string>
 #include <unistd.h>
 
+namespace {
+    constexpr int AGE_REFRESH_MS = 1000;    // "seen 3s" texts tick without a new snapshot
+    constexpr int BAR_FLOOR_DBM = -90;
+    constexpr int BAR_CEILING_DBM = -30;
+
+    std::string bssidKey(const uint8_t* bssid) {
+        char buffer[13];
+        snprintf(buffer, sizeof(buffer), "%02X%02X%02X%02X%02X%02X",
+                 bssid[0], bssid[1], bssid[2], bssid[3], bssid[4], bssid[5]);
+        return buffer;
+    }
+
+    std::string ssidLabel(const std::string& ssid) {
+        return ssid.empty() ? "<hidden>" : ssid;
+    }
+
+    // 16 cells from BAR_FLOOR_DBM (empty) to BAR_CEILING_DBM (full)
+    std::string signalBar(int dbm) {
+        int cells = (dbm - BAR_FLOOR_DBM) * 16 / (BAR_CEILING_DBM - BAR_FLOOR_DBM);
+        cells = std::max(0, std::min(cells, 16));
+        return std::string(cells, '#') + std::string(16 - cells, '.');
+    }
+
+    std::string formatAge(int64_t ms) {
+        char buffer[24];
+        int64_t seconds = std::max<int64_t>(0, ms / 1000);
+        if (seconds < 120) {
+            snprintf(buffer, sizeof(buffer), "%llds", static_cast<long long>(seconds));
+        } else {
+            snprintf(buffer, sizeof(buffer), "%lldm", static_cast<long long>(seconds / 60));
+        }
+        return buffer;
+    }
+
+    std::string formatChannel(int channel, int frequency) {
+        char buffer[24];
+        snprintf(buffer, sizeof(buffer), "Ch %-4d %5dMHz", channel, frequency);
+        return buffer;
+    }
+
+    std::string formatBitrate(const char* label, int bitrate) {
+        // nl80211 reports 100 kbit/s units
+        char buffer[24];
+        snprintf(buffer, sizeof(buffer), "%s %6.1f Mbit/s", label, bitrate / 10.0);
+        return buffer;
+    }
+}
+
 WiFiSettingsScreen::WiFiSettingsScreen(std::shared_ptr<Display> display, std::shared_ptr<InputDevice> input)
-    : ScreenModule(display, input),
-      m_selectedOption(0)
+    : ScreenModule(display, input)
+    , m_rows(display)
 {
 }
 
 void WiFiSettingsScreen::enter()
 {
-    // Get current WiFi state
-    m_currentWiFiState = getWiFiStatus();
-    
-    // Clear display and show submenu
+    LOG_DEBUG("WiFiSettingsScreen: Entered");
+
+    WirelessState& wireless = WirelessState::getInstance();
+    std::string interface = ModuleDependency::getInstance().getDependencyPath("wifi", "iface_name");
+    if (!interface.empty()) {
+        wireless.setInterface(interface);
+    }
+    // Station figures are requested only while a link is connected
+    wireless.setMonitoring(true);
+    m_radio = WirelessState::getRadio();
+
+    m_view = View::MENU;
+    m_selected = 0;
+    m_scrollOffset = 0;
+    m_selectedBssid.clear();
+    m_shouldExit = false;
+
+    // Everything shown comes from the netlink thread's snapshot; this only
+    // notices that it changed
+    m_refreshJob = Scheduler::getInstance().add("wifi refresh", Config::WIFI_REFRESH_MS, Scheduler::Cost::LIGHT, true,
+                                                [this]() {
+        if (WirelessState::getInstance().getGeneration() == m_shownGeneration &&
+            WirelessState::nowMs() - m_renderedMs < AGE_REFRESH_MS) {
+            return;
+        }
+        render();
+    });
+
     m_display->clear();
     usleep(Config::DISPLAY_CMD_DELAY * 3);
-    
-    // Draw title
-    m_display->drawText(0, 0, " WiFi Settings");
-    usleep(Config::DISPLAY_CMD_DELAY);
-    
-    // Draw separator
-    m_display->drawText(0, 8, "----------------");
-    usleep(Config::DISPLAY_CMD_DELAY);
-    
-    // Draw menu options
-    renderOptions();
+    m_rows.invalidate();
+    render();
 }
 
 void WiFiSettingsScreen::update()
 {
-    // Nothing to update periodically
+    // Redrawn from the refresh job when the snapshot changes
 }
 
 void WiFiSettingsScreen::exit()
 {
-    // Nothing to clean up
+    LOG_DEBUG("WiFiSettingsScreen: Exiting");
+
+    if (m_refreshJob >= 0) {
+        Scheduler::getInstance().remove(m_refreshJob);
+        m_refreshJob = -1;
+    }
+    WirelessState& wireless = WirelessState::getInstance();
+    wireless.setSurvey(false);
+    wireless.setMonitoring(false);
+
+    m_display->clear();
+    usleep(Config::DISPLAY_CMD_DELAY * 3);
 }
 
 bool WiFiSettingsScreen::handleInput()
 {
     if (m_input->waitForEvents(100) > 0) {
         bool buttonPressed = false;
-        
+        int rotationDirection = 0;
+
         m_input->processEvents(
-            [this](int direction) {
-                // Handle rotation - move selection up or down
-                int oldSelection = m_selectedOption;
-                
-                if (direction < 0) {
-                    // Move up
-                    if (m_selectedOption > 0) {
-                        m_selectedOption--;
-                    }
-                } else {
-                    // Move down
-                    if (m_selectedOption < static_cast<int>(m_options.size() - 1)) {
-                        m_selectedOption++;
-                    }
-                }
-                
-                // Only redraw if selection changed
-                if (oldSelection != m_selectedOption) {
-                    renderOptions();
-                }
-                
+            [this, &rotationDirection](int direction) {
+                rotationDirection = direction;
                 m_display->updateActivityTimestamp();
             },
-            [&]() {
-                // Handle button press
+            [this, &buttonPressed]() {
                 buttonPressed = true;
                 m_display->updateActivityTimestamp();
             }
         );
-        
+
         if (buttonPressed) {
-            // Handle button press based on selected option
-            if (m_selectedOption == 2) {
-                return false; // Exit the screen
-            } else {
-                // Try to change WiFi state
-                bool newState = (m_selectedOption == 0); // Option 0 = "Turn On", Option 1 = "Turn Off"
-                
-                // Only act if state would change
-                if (newState != m_currentWiFiState) {
-                    // Update the state
-                    setWiFiStatus(newState);
-                    m_currentWiFiState = newState;
-                    
-                    // Redraw options to update state indicators
-                    renderOptions();
-                }
-            }
+            handleButton();
+        }
+        if (rotationDirection != 0) {
+            handleRotation(rotationDirection);
         }
     }
-    
-    return true; // Continue
+
+    return !m_shouldExit;
+}
+
+// GPIO support methods
+void WiFiSettingsScreen::handleGPIORotation(int direction)
+{
+    LOG_DEBUG("WiFiSettingsScreen::handleGPIORotation(" + std::to_string(direction) + ")");
+    handleRotation(direction);
+    m_display->updateActivityTimestamp();
+}
+
+bool WiFiSettingsScreen::handleGPIOButtonPress()
+{
+    LOG_DEBUG("WiFiSettingsScreen::handleGPIOButtonPress()");
+    bool keepRunning = handleButton();
+    m_display->updateActivityTimestamp();
+    return keepRunning;
 }
 
-void WiFiSettingsScreen::renderOptions()
+void WiFiSettingsScreen::handleRotation(int direction)
 {
-    // Draw the options with selection indicator
-    for (size_t i = 0; i < m_options.size(); i++) {
-        // Determine if this option represents current state
-        bool isCurrentState = (i == 0 && m_currentWiFiState) ||
-                             (i == 1 && !m_currentWiFiState);
-        
-        std::string buffer;
-        int yPos = 16 + (i * 10);  // Start at y=16 with 10px spacing
-        
-        // Clear the line first to avoid display artifacts
-        m_display->drawText(0, yPos, "                ");
-        usleep(Config::DISPLAY_CMD_DELAY);
-        
-        // Format with selection indicator and/or state highlight
-        if (static_cast<int>(i) == m_selectedOption) {
-            if (isCurrentState) {
-                buffer = ">[" + m_options[i] + "]";
+    int step = direction > 0 ? 1 : -1;
+    if (m_view == View::MENU) {
+        m_selected = std::max(0, std::min(m_selected + step, MENU_OPTIONS - 1));
+    } else if (m_view == View::NETWORKS) {
+        int last = static_cast<int>(m_networks.size());
+        m_selected = std::max(0, std::min(m_selected + step, last));
+        m_selectedBssid = m_selected < last ? bssidKey(m_networks[m_selected].bssid) : "";
+    } else {
+        return;
+    }
+    render();
+}
+
+bool WiFiSettingsScreen::handleButton()
+{
+    switch (m_view) {
+        case View::MENU:
+            if (m_selected == 0) {
+                showView(View::NETWORKS);
+            } else if (m_selected == 1) {
+                showView(View::LINK);
+            } else if (m_selected == 2) {
+                if (m_radio != WirelessState::Radio::UNKNOWN && m_radio != WirelessState::Radio::HARD_BLOCKED) {
+                    WirelessState::setRadio(m_radio != WirelessState::Radio::ON);
+                    m_radio = WirelessState::getRadio();
+                    render();
+                }
             } else {
-                buffer = ">" + m_options[i];
+                m_shouldExit = true;
+                return false;
             }
-        } else {
-            if (isCurrentState) {
-                buffer = " [" + m_options[i] + "]";
+            break;
+        case View::NETWORKS:
+            if (m_selected >= static_cast<int>(m_networks.size())) {
+                m_selected = 0;
+                showView(View::MENU);
             } else {
-                buffer = " " + m_options[i];
+                m_selectedBssid = bssidKey(m_networks[m_selected].bssid);
+                showView(View::DETAIL);
             }
-        }
-        
-        m_display->drawText(0, yPos, buffer);
-        usleep(Config::DISPLAY_CMD_DELAY);
+            break;
+        case View::DETAIL:
+            showView(View::NETWORKS);
+            break;
+        case View::LINK:
+            m_selected = 1;
+            showView(View::MENU);
+            break;
     }
+    return true;
 }
 
-bool WiFiSettingsScreen::getWiFiStatus() const
+void WiFiSettingsScreen::showView(View view)
 {
-    // This is a mock function that should be implemented to check the actual WiFi state
-    // For this example we just return a stored value
-    static bool wifiState = false;
-    return wifiState;
+    // A site survey scans back to back while the list or a BSS is on screen
+    WirelessState::getInstance().setSurvey(view == View::NETWORKS || view == View::DETAIL);
+    if (view == View::NETWORKS && m_view == View::MENU) {
+        m_selected = 0;
+        m_scrollOffset = 0;
+        m_selectedBssid.clear();
+    }
+    m_view = view;
+    render();
 }
 
-void WiFiSettingsScreen::setWiFiStatus(bool enabled)
+void WiFiSettingsScreen::render()
 {
-    // This is a mock function that should be implemented to control the actual WiFi
-    static bool wifiState = false;
-    
-    if (enabled != wifiState) {
-        wifiState = enabled;
-        std::cout << "WiFi state changed to " << (enabled ? "ON" : "OFF") << std::endl;
-        
-        // In a real implementation, you would control the WiFi hardware here:
-        // Example:
-        // if (enabled) {
-        //     system("systemctl start wpa_supplicant");
-        // } else {
-        //     system("systemctl stop wpa_supplicant");
-        // }
+    WirelessState& wireless = WirelessState::getInstance();
+    m_shownGeneration = wireless.getGeneration();
+    m_renderedMs = WirelessState::nowMs();
+    m_networks = wireless.getNetworks();
+
+    switch (m_view) {
+        case View::MENU: renderMenu(); break;
+        case View::NETWORKS: renderNetworks(); break;
+        case View::DETAIL: renderDetail(); break;
+        case View::LINK: renderLink(); break;
     }
 }
 
-// GPIO support methods
-void WiFiSettingsScreen::handleGPIORotation(int direction) {
-    // Use the same navigation logic as handleInput()
-    int oldSelection = m_selectedOption;
-
-    if (direction < 0) {
-        // Move up
-        if (m_selectedOption > 0) {
-            m_selectedOption--;
-        }
+void WiFiSettingsScreen::renderMenu()
+{
+    WirelessState& wireless = WirelessState::getInstance();
+    WirelessState::Link link = wireless.getLink();
+
+    m_rows.draw(0, wireless.isAvailable() ? " WiFi " + wireless.getInterfaceName() : " WiFi (none)");
+
+    char buffer[24];
+    if (m_radio == WirelessState::Radio::SOFT_BLOCKED || m_radio == WirelessState::Radio::HARD_BLOCKED) {
+        m_rows.draw(1, "Radio off");
+    } else if (!link.connected) {
+        m_rows.draw(1, wireless.isAvailable() ? "Not connected" : "No interface");
     } else {
-        // Move down
-        if (m_selectedOption < static_cast<int>(m_options.size() - 1)) {
-            m_selectedOption++;
+        snprintf(buffer, sizeof(buffer), "%-10.10s%4ddB", link.ssid.c_str(), link.signalDbm);
+        m_rows.draw(1, buffer);
+    }
+    m_rows.draw(2, Config::MENU_SEPARATOR);
+
+    const char* radio = "n/a";
+    if (m_radio == WirelessState::Radio::ON) radio = "on";
+    if (m_radio == WirelessState::Radio::SOFT_BLOCKED) radio = "off";
+    if (m_radio == WirelessState::Radio::HARD_BLOCKED) radio = "off (hw)";
+
+    snprintf(buffer, sizeof(buffer), "Networks (%d)", static_cast<int>(m_networks.size()));
+    std::string options[MENU_OPTIONS] = {buffer, "Link", std::string("Radio: ") + radio, "Back"};
+    for (int i = 0; i < MENU_OPTIONS; i++) {
+        m_rows.draw(3 + i, (i == m_selected ? ">" : " ") + options[i]);
+    }
+    m_rows.draw(7, "");
+}
+
+void WiFiSettingsScreen::renderNetworks()
+{
+    WirelessState& wireless = WirelessState::getInstance();
+    int count = static_cast<int>(m_networks.size());
+
+    // Follow the selected BSS through resorts; if it vanished, stay in place
+    if (!m_selectedBssid.empty()) {
+        for (int i = 0; i < count; i++) {
+            if (bssidKey(m_networks[i].bssid) == m_selectedBssid) {
+                m_selected = i;
+                break;
+            }
         }
     }
+    m_selected = std::min(m_selected, count);
+    if (m_selected < m_scrollOffset) {
+        m_scrollOffset = m_selected;
+    } else if (m_selected >= m_scrollOffset + VISIBLE_ROWS) {
+        m_scrollOffset = m_selected - VISIBLE_ROWS + 1;
+    }
+    m_scrollOffset = std::max(0, std::min(m_scrollOffset, std::max(0, count + 1 - VISIBLE_ROWS)));
 
-    // Only redraw if selection changed
-    if (oldSelection != m_selectedOption) {
-        renderOptions();
+    char buffer[24];
+    std::string age = wireless.isScanning() ? "scan" : "-";
+    if (!wireless.isScanning() && wireless.getLastScanMs() > 0) {
+        age = formatAge(WirelessState::nowMs() - wireless.getLastScanMs());
     }
+    snprintf(buffer, sizeof(buffer), " %d nets", count);
+    std::string title = buffer;
+    title.resize(16 - std::min<size_t>(age.size(), 6), ' ');
+    m_rows.draw(0, title + age);
+    m_rows.draw(1, " SSID     dBm Ch");
 
-    m_display->updateActivityTimestamp();
+    for (int row = 0; row < VISIBLE_ROWS; row++) {
+        int index = m_scrollOffset + row;
+        char marker = index == m_selected ? '>' : ' ';
+        if (index < count) {
+            const WirelessState::Network& network = m_networks[index];
+            if (marker == ' ' && network.associated) {
+                marker = '*';
+            }
+            snprintf(buffer, sizeof(buffer), "%c%-8.8s%4d%3d", marker, ssidLabel(network.ssid).c_str(),
+                     network.signalDbm, network.channel);
+            m_rows.draw(2 + row, buffer);
+        } else if (index == count) {
+            m_rows.draw(2 + row, std::string(1, marker) + "Back");
+        } else {
+            m_rows.draw(2 + row, "");
+        }
+    }
 }
 
-bool WiFiSettingsScreen::handleGPIOButtonPress() {
-    // Use the same selection logic as handleInput()
-    if (m_selectedOption == 2) {
-        return false; // Exit the screen
-    } else {
-        // Try to change WiFi state
-        bool newState = (m_selectedOption == 0); // Option 0 = "Turn On", Option 1 = "Turn Off"
+void WiFiSettingsScreen::renderDetail()
+{
+    const WirelessState::Network* network = nullptr;
+    for (const auto& candidate : m_networks) {
+        if (bssidKey(candidate.bssid) == m_selectedBssid) {
+            network = &candidate;
+            break;
+        }
+    }
+
+    if (!network) {
+        m_rows.draw(0, m_selectedBssid);
+        for (int row = 1; row < 7; row++) {
+            m_rows.draw(row, row == 3 ? "Not seen lately" : "");
+        }
+        m_rows.draw(7, ">Back");
+        return;
+    }
 
-        // Only act if state would change
-        if (newState != m_currentWiFiState) {
-            // Update the state
-            setWiFiStatus(newState);
-            m_currentWiFiState = newState;
+    char buffer[24];
+    m_rows.draw(0, ssidLabel(network->ssid));
+    m_rows.draw(1, bssidKey(network->bssid));
+    m_rows.draw(2, formatChannel(network->channel, network->frequency));
+    snprintf(buffer, sizeof(buffer), "Signal %4d dBm", network->signalDbm);
+    m_rows.draw(3, buffer);
+    m_rows.draw(4, signalBar(network->signalDbm));
+    m_rows.draw(5, "Seen " + formatAge(WirelessState::nowMs() - network->seenMs) + " ago");
+    m_rows.draw(6, network->associated ? "Connected" : "");
+    m_rows.draw(7, ">Back");
+}
 
-            // Redraw options to update state indicators
-            renderOptions();
+void WiFiSettingsScreen::renderLink()
+{
+    WirelessState& wireless = WirelessState::getInstance();
+    WirelessState::Link link = wireless.getLink();
+
+    if (!link.connected) {
+        m_rows.draw(0, " Link");
+        m_rows.draw(1, Config::MENU_SEPARATOR);
+        m_rows.draw(2, wireless.isAvailable() ? "Not connected" : "No interface");
+        for (int row = 3; row < 7; row++) {
+            m_rows.draw(row, "");
         }
+        m_rows.draw(7, ">Back");
+        return;
     }
 
-    m_display->updateActivityTimestamp();
-    return true; // Continue running
+    char buffer[24];
+    m_rows.draw(0, ssidLabel(link.ssid));
+    m_rows.draw(1, bssidKey(link.bssid));
+    m_rows.draw(2, formatChannel(link.channel, link.frequency));
+    if (link.hasStation) {
+        snprintf(buffer, sizeof(buffer), "%4d dBm avg%4d", link.signalDbm, link.signalAvgDbm);
+    } else {
+        snprintf(buffer, sizeof(buffer), "%4d dBm", link.signalDbm);
+    }
+    m_rows.draw(3, buffer);
+    m_rows.draw(4, signalBar(link.signalDbm));
+    m_rows.draw(5, link.hasStation ? formatBitrate("Tx", link.txBitrate) : "");
+    m_rows.draw(6, link.hasStation ? formatBitrate("Rx", link.rxBitrate) : "");
+    m_rows.draw(7, ">Back");
 }
+
+MICROPANEL_REGISTER_MODULE("wifi", WiFiSettingsScreen);
@@ -0,0 +1,765 @@
+#include "WirelessState.h"
+#include "Config.h"
+#include "Logger.h"
+#include <algorithm>
+#include <cerrno>
+#include <cstring>
+#include <ctime>
+#include <fcntl.h>
+#include <linux/genetlink.h>
+#include <linux/netlink.h>
+#include <linux/nl80211.h>
+#include <linux/rfkill.h>
+#include <poll.h>
+#include <sys/eventfd.h>
+#include <sys/socket.h>
+#include <unistd.h>
+
+#ifndef SOL_NETLINK
+#define SOL_NETLINK 270
+#endif
+
+namespace {
+    constexpr size_t RECEIVE_BUFFER = 32 * 1024;
+    constexpr int EVENT_POLL_MS = 1000;     // Longest sleep with nothing due
+    constexpr const char* GROUPS[] = {"config", "scan", "mlme"};
+
+    struct Attribute {
+        const uint8_t* data = nullptr;
+        size_t length = 0;
+    };
+    using AttributeTable = std::vector<Attribute>;
+
+    template <typename Visit>
+    void forEachAttribute(const void* data, size_t length, Visit visit) {
+        const uint8_t* cursor = static_cast<const uint8_t*>(data);
+        while (length >= NLA_HDRLEN) {
+            struct nlattr header;
+            std::memcpy(&header, cursor, sizeof(header));
+            if (header.nla_len < NLA_HDRLEN || header.nla_len > length) {
+                return;
+            }
+            visit(header.nla_type & NLA_TYPE_MASK, cursor + NLA_HDRLEN, header.nla_len - NLA_HDRLEN);
+            size_t step = NLA_ALIGN(header.nla_len);
+            if (step >= length) {
+                return;
+            }
+            cursor += step;
+            length -= step;
+        }
+    }
+
+    AttributeTable parseAttributes(const void* data, size_t length, int maxType) {
+        AttributeTable table(maxType + 1);
+        forEachAttribute(data, length, [&table, maxType](int type, const uint8_t* value, size_t size) {
+            if (type <= maxType) {
+                table[type].data = value;
+                table[type].length = size;
+            }
+        });
+        return table;
+    }
+
+    // Attributes of a generic netlink message, after its genlmsghdr
+    AttributeTable parseMessage(const void* message, size_t length, int maxType) {
+        if (length < GENL_HDRLEN) {
+            return AttributeTable(maxType + 1);
+        }
+        return parseAttributes(static_cast<const uint8_t*>(message) + GENL_HDRLEN, length - GENL_HDRLEN, maxType);
+    }
+
+    AttributeTable parseNested(const Attribute& attribute, int maxType) {
+        return parseAttributes(attribute.data, attribute.length, maxType);
+    }
+
+    template <typename T>
+    T readValue(const Attribute& attribute, T fallback = 0) {
+        T value = fallback;
+        if (attribute.data && attribute.length >= sizeof(T)) {
+            std::memcpy(&value, attribute.data, sizeof(T));
+        }
+        return value;
+    }
+
+    std::string readString(const Attribute& attribute) {
+        if (!attribute.data) {
+            return "";
+        }
+        return std::string(reinterpret_cast<const char*>(attribute.data),
+                           strnlen(reinterpret_cast<const char*>(attribute.data), attribute.length));
+    }
+
+    void putAttribute(std::vector<char>& out, uint16_t type, const void* data, size_t length) {
+        struct nlattr header;
+        header.nla_len = static_cast<uint16_t>(NLA_HDRLEN + length);
+        header.nla_type = type;
+        size_t start = out.size();
+        out.resize(start + NLA_ALIGN(header.nla_len), 0);
+        std::memcpy(&out[start], &header, sizeof(header));
+        if (length > 0) {
+            std::memcpy(&out[start + NLA_HDRLEN], data, length);
+        }
+    }
+
+    void putU32(std::vector<char>& out, uint16_t type, uint32_t value) {
+        putAttribute(out, type, &value, sizeof(value));
+    }
+
+    // SSID element (id 0) of a beacon/probe response; unprintable bytes as '?'
+    std::string ssidFromElements(const Attribute& elements) {
+        size_t offset = 0;
+        while (elements.data && offset + 2 <= elements.length) {
+            uint8_t id = elements.data[offset];
+            uint8_t size = elements.data[offset + 1];
+            if (offset + 2 + size > elements.length) {
+                break;
+            }
+            if (id == 0) {
+                std::string ssid;
+                bool blank = true;
+                for (uint8_t i = 0; i < size; i++) {
+                    char c = static_cast<char>(elements.data[offset + 2 + i]);
+                    ssid += (c >= 0x20 && c < 0x7F) ? c : '?';
+                    blank = blank && c == 0;
+                }
+                // Some hidden networks send a run of NULs instead of nothing
+                return blank ? "" : ssid;
+            }
+            offset += 2 + size;
+        }
+        return "";
+    }
+
+    // Bitrate of a nested NL80211_RATE_INFO, 100 kbit/s
+    int readBitrate(const Attribute& attribute) {
+        AttributeTable rate = parseNested(attribute, NL80211_RATE_INFO_MAX);
+        uint32_t wide = readValue<uint32_t>(rate[NL80211_RATE_INFO_BITRATE32]);
+        if (wide > 0) {
+            return static_cast<int>(wide);
+        }
+        return readValue<uint16_t>(rate[NL80211_RATE_INFO_BITRATE]);
+    }
+}
+
+WirelessState& WirelessState::getInstance()
+{
+    static WirelessState instance;
+    return instance;
+}
+
+int64_t WirelessState::nowMs()
+{
+    struct timespec now;
+    clock_gettime(CLOCK_MONOTONIC, &now);
+    return static_cast<int64_t>(now.tv_sec) * 1000 + now.tv_nsec / 1000000;
+}
+
+int WirelessState::channelFromFrequency(int frequency)
+{
+    if (frequency == 2484) return 14;
+    if (frequency >= 2412 && frequency <= 2472) return (frequency - 2407) / 5;
+    if (frequency >= 5955 && frequency <= 7115) return (frequency - 5950) / 5;
+    if (frequency >= 4910 && frequency <= 5895) return (frequency - 5000) / 5;
+    if (frequency >= 58320 && frequency <= 70200) return (frequency - 56160) / 2160;
+    return 0;
+}
+
+WirelessState::WirelessState()
+{
+    m_eventFd = socket(AF_NETLINK, SOCK_RAW | SOCK_CLOEXEC, NETLINK_GENERIC);
+    m_requestFd = socket(AF_NETLINK, SOCK_RAW | SOCK_CLOEXEC, NETLINK_GENERIC);
+    m_wakeFd = eventfd(0, EFD_NONBLOCK | EFD_CLOEXEC);
+    if (m_eventFd < 0 || m_requestFd < 0 || m_wakeFd < 0) {
+        Logger::error(std::string("WirelessState: generic netlink socket: ") + strerror(errno));
+        return;
+    }
+
+    int size = Config::NETLINK_RCVBUF_BYTES;
+    setsockopt(m_eventFd, SOL_SOCKET, SO_RCVBUF, &size, sizeof(size));
+
+    struct sockaddr_nl local;
+    std::memset(&local, 0, sizeof(local));
+    local.nl_family = AF_NETLINK;
+    if (bind(m_eventFd, reinterpret_cast<struct sockaddr*>(&local), sizeof(local)) < 0 ||
+        bind(m_requestFd, reinterpret_cast<struct sockaddr*>(&local), sizeof(local)) < 0) {
+        Logger::error(std::string("WirelessState: netlink bind: ") + strerror(errno));
+        return;
+    }
+
+    if (!resolveFamily()) {
+        Logger::info("WirelessState: nl80211 not available, no Wi-Fi");
+        return;
+    }
+    for (const char* name : GROUPS) {
+        for (const auto& group : m_groups) {
+            if (group.first == name) {
+                joinGroup(group.first, group.second);
+            }
+        }
+    }
+
+    // Populate synchronously so the first reader sees the cached scan
+    findInterface();
+    m_needInterface = false;
+    fetchScan();
+    m_needFetch = false;
+    m_thread = std::thread(&WirelessState::run, this);
+}
+
+WirelessState::~WirelessState()
+{
+    m_stop = true;
+    wake();
+    if (m_thread.joinable()) {
+        m_thread.join();
+    }
+    for (int fd : {m_eventFd, m_requestFd, m_wakeFd}) {
+        if (fd >= 0) {
+            close(fd);
+        }
+    }
+}
+
+bool WirelessState::resolveFamily()
+{
+    std::vector<char> attributes;
+    const char name[] = NL80211_GENL_NAME;
+    putAttribute(attributes, CTRL_ATTR_FAMILY_NAME, name, sizeof(name));
+    return transact(GENL_ID_CTRL, CTRL_CMD_GETFAMILY, false, attributes, &WirelessState::handleFamily) == 0 &&
+           m_family != 0;
+}
+
+void WirelessState::handleFamily(const void* message, size_t length)
+{
+    AttributeTable table = parseMessage(message, length, CTRL_ATTR_MAX);
+    m_family = readValue<uint16_t>(table[CTRL_ATTR_FAMILY_ID]);
+    m_groups.clear();
+    if (!table[CTRL_ATTR_MCAST_GROUPS].data) {
+        return;
+    }
+    const Attribute& groups = table[CTRL_ATTR_MCAST_GROUPS];
+    forEachAttribute(groups.data, groups.length, [this](int, const uint8_t* data, size_t size) {
+        AttributeTable group = parseAttributes(data, size, CTRL_ATTR_MCAST_GRP_MAX);
+        std::string name = readString(group[CTRL_ATTR_MCAST_GRP_NAME]);
+        uint32_t id = readValue<uint32_t>(group[CTRL_ATTR_MCAST_GRP_ID]);
+        if (!name.empty() && id != 0) {
+            m_groups.emplace_back(name, id);
+        }
+    });
+}
+
+bool WirelessState::joinGroup(const std::string& name, uint32_t id)
+{
+    if (setsockopt(m_eventFd, SOL_NETLINK, NETLINK_ADD_MEMBERSHIP, &id, sizeof(id)) < 0) {
+        Logger::warning("WirelessState: joining nl80211 " + name + " events: " + strerror(errno));
+        return false;
+    }
+    return true;
+}
+
+int WirelessState::transact(uint16_t family, uint8_t command, bool dump, const std::vector<char>& attributes,
+                            Handler handler)
+{
+    std::vector<char> request(NLMSG_HDRLEN + GENL_HDRLEN, 0);
+    request.insert(request.end(), attributes.begin(), attributes.end());
+
+    struct nlmsghdr header;
+    std::memset(&header, 0, sizeof(header));
+    header.nlmsg_len = static_cast<uint32_t>(request.size());
+    header.nlmsg_type = family;
+    header.nlmsg_flags = NLM_F_REQUEST | NLM_F_ACK | (dump ? NLM_F_DUMP : 0);
+    header.nlmsg_seq = ++m_seq;
+    struct genlmsghdr genl;
+    std::memset(&genl, 0, sizeof(genl));
+    genl.cmd = command;
+    genl.version = 1;
+    std::memcpy(&request[0], &header, sizeof(header));
+    std::memcpy(&request[NLMSG_HDRLEN], &genl, sizeof(genl));
+
+    if (send(m_requestFd, request.data(), request.size(), 0) < 0) {
+        return -errno;
+    }
+
+    // Replies to earlier requests that timed out carry an older seq and are skipped
+    static thread_local char buffer[RECEIVE_BUFFER];
+    int64_t deadline = nowMs() + Config::WIFI_REQUEST_TIMEOUT_MS;
+    for (;;) {
+        int64_t remainingMs = deadline - nowMs();
+        if (remainingMs <= 0) {
+            Logger::warning("WirelessState: nl80211 request " + std::to_string(command) + " timed out");
+            return -ETIMEDOUT;
+        }
+        struct pollfd pfd = {m_requestFd, POLLIN, 0};
+        if (::poll(&pfd, 1, static_cast<int>(remainingMs)) <= 0) {
+            continue;
+        }
+
+        ssize_t length = recv(m_requestFd, buffer, sizeof(buffer), MSG_DONTWAIT);
+        if (length < 0) {
+            if (errno == EINTR || errno == EAGAIN || errno == EWOULDBLOCK) continue;
+            return -errno;
+        }
+
+        size_t remaining = static_cast<size_t>(length);
+        for (struct nlmsghdr* reply = reinterpret_cast<struct nlmsghdr*>(buffer);
+             NLMSG_OK(reply, remaining); reply = NLMSG_NEXT(reply, remaining)) {
+            if (reply->nlmsg_seq != header.nlmsg_seq) {
+                continue;
+            }
+            if (reply->nlmsg_type == NLMSG_DONE) {
+                return 0;
+            }
+            if (reply->nlmsg_type == NLMSG_ERROR) {
+                // error 0 is the acknowledgement
+                const struct nlmsgerr* error = static_cast<const struct nlmsgerr*>(NLMSG_DATA(reply));
+                return error->error;
+            }
+            if (handler) {
+                (this->*handler)(NLMSG_DATA(reply), reply->nlmsg_len - NLMSG_HDRLEN);
+            }
+        }
+    }
+}
+
+void WirelessState::findInterface()
+{
+    m_stations.clear();
+    transact(m_family, NL80211_CMD_GET_INTERFACE, true, {}, &WirelessState::handleInterface);
+
+    std::string preferred;
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        preferred = m_preferred;
+    }
+    int ifindex = 0;
+    std::string ifname;
+    for (const auto& station : m_stations) {
+        if (ifindex == 0 || station.second == preferred) {
+            ifindex = station.first;
+            ifname = station.second;
+        }
+    }
+
+    if (ifindex == m_ifindex.load()) {
+        return;
+    }
+    if (ifindex > 0) {
+        Logger::info("WirelessState: using " + ifname);
+    }
+
+    // A different radio: nothing cached is about it
+    m_scan.clear();
+    m_link = Link();
+    m_scanning = false;
+    m_lastScanMs = 0;
+    m_nextScanMs = 0;
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        m_ifname = ifname;
+    }
+    m_ifindex = ifindex;
+    publish();
+}
+
+void WirelessState::handleInterface(const void* message, size_t length)
+{
+    AttributeTable table = parseMessage(message, length, NL80211_ATTR_MAX);
+    if (readValue<uint32_t>(table[NL80211_ATTR_IFTYPE]) != NL80211_IFTYPE_STATION) {
+        return;
+    }
+    int ifindex = static_cast<int>(readValue<uint32_t>(table[NL80211_ATTR_IFINDEX]));
+    std::string ifname = readString(table[NL80211_ATTR_IFNAME]);
+    if (ifindex > 0 && !ifname.empty()) {
+        m_stations.emplace_back(ifindex, ifname);
+    }
+}
+
+void WirelessState::triggerScan()
+{
+    std::vector<char> attributes;
+    putU32(attributes, NL80211_ATTR_IFINDEX, static_cast<uint32_t>(m_ifindex.load()));
+    // One wildcard SSID makes the scan active, so it also finds hidden networks
+    std::vector<char> ssids;
+    putAttribute(ssids, 1, nullptr, 0);
+    putAttribute(attributes, NL80211_ATTR_SCAN_SSIDS | NLA_F_NESTED, ssids.data(), ssids.size());
+
+    int result = transact(m_family, NL80211_CMD_TRIGGER_SCAN, false, attributes, nullptr);
+    int64_t now = nowMs();
+    if (result == 0 || result == -EBUSY) {
+        // Busy: someone else's scan is running; its results arrive the same way
+        m_scanning = true;
+        m_scanStartedMs = now;
+        m_scanErrorLogged = false;
+        publish();
+        return;
+    }
+
+    // Down interface, blocked radio or no CAP_NET_ADMIN; try again later
+    if (!m_scanErrorLogged) {
+        Logger::warning(std::string("WirelessState: scan trigger: ") + strerror(-result));
+        m_scanErrorLogged = true;
+    }
+    m_nextScanMs = now + Config::WIFI_SCAN_RETRY_MS;
+}
+
+void WirelessState::fetchScan()
+{
+    if (m_ifindex.load() <= 0) {
+        return;
+    }
+
+    std::vector<char> attributes;
+    putU32(attributes, NL80211_ATTR_IFINDEX, static_cast<uint32_t>(m_ifindex.load()));
+    m_scan.clear();
+    if (transact(m_family, NL80211_CMD_GET_SCAN, true, attributes, &WirelessState::handleBss) != 0) {
+        return;
+    }
+
+    std::stable_sort(m_scan.begin(), m_scan.end(),
+                     [](const Network& a, const Network& b) { return a.signalDbm > b.signalDbm; });
+    if (m_scan.size() > static_cast<size_t>(Config::WIFI_SCAN_MAX_NETWORKS)) {
+        m_scan.resize(Config::WIFI_SCAN_MAX_NETWORKS);
+    }
+
+    // The associated BSS is the link; station figures survive while it is unchanged
+    auto current = std::find_if(m_scan.begin(), m_scan.end(), [](const Network& network) { return network.associated; });
+    if (current == m_scan.end()) {
+        m_link = Link();
+    } else {
+        if (!m_link.connected || std::memcmp(m_link.bssid, current->bssid, sizeof(m_link.bssid)) != 0) {
+            m_link = Link();
+            m_nextStationMs = 0;
+        }
+        m_link.connected = true;
+        m_link.ssid = current->ssid;
+        std::memcpy(m_link.bssid, current->bssid, sizeof(m_link.bssid));
+        m_link.frequency = current->frequency;
+        m_link.channel = current->channel;
+        if (!m_link.hasStation) {
+            m_link.signalDbm = current->signalDbm;
+        }
+    }
+    publish();
+}
+
+void WirelessState::handleBss(const void* message, size_t length)
+{
+    AttributeTable table = parseMessage(message, length, NL80211_ATTR_MAX);
+    if (!table[NL80211_ATTR_BSS].data) {
+        return;
+    }
+    AttributeTable bss = parseNested(table[NL80211_ATTR_BSS], NL80211_BSS_MAX);
+    if (bss[NL80211_BSS_BSSID].length < 6) {
+        return;
+    }
+
+    Network network;
+    std::memcpy(network.bssid, bss[NL80211_BSS_BSSID].data, sizeof(network.bssid));
+    network.frequency = static_cast<int>(readValue<uint32_t>(bss[NL80211_BSS_FREQUENCY]));
+    network.channel = channelFromFrequency(network.frequency);
+    if (bss[NL80211_BSS_SIGNAL_MBM].data) {
+        network.signalDbm = readValue<int32_t>(bss[NL80211_BSS_SIGNAL_MBM]) / 100;
+    } else {
+        // 0..100 on drivers without dBm; mapped onto -100..-50
+        network.signalDbm = readValue<uint8_t>(bss[NL80211_BSS_SIGNAL_UNSPEC]) / 2 - 100;
+    }
+    network.ssid = ssidFromElements(bss[NL80211_BSS_INFORMATION_ELEMENTS].data ? bss[NL80211_BSS_INFORMATION_ELEMENTS]
+                                                                               : bss[NL80211_BSS_BEACON_IES]);
+    uint32_t status = readValue<uint32_t>(bss[NL80211_BSS_STATUS], UINT32_MAX);
+    network.associated = status == NL80211_BSS_STATUS_ASSOCIATED || status == NL80211_BSS_STATUS_IBSS_JOINED;
+
+    // The kernel keeps BSSes around for a while after they go quiet
+    uint32_t ago = readValue<uint32_t>(bss[NL80211_BSS_SEEN_MS_AGO]);
+    if (!network.associated && ago > static_cast<uint32_t>(Config::WIFI_SCAN_MAX_AGE_MS)) {
+        return;
+    }
+    network.seenMs = nowMs() - ago;
+    m_scan.push_back(network);
+}
+
+void WirelessState::fetchStation()
+{
+    std::vector<char> attributes;
+    putU32(attributes, NL80211_ATTR_IFINDEX, static_cast<uint32_t>(m_ifindex.load()));
+    m_stationSeen = false;
+    if (transact(m_family, NL80211_CMD_GET_STATION, true, attributes, &WirelessState::handleStation) != 0) {
+        return;
+    }
+    if (!m_stationSeen && m_link.hasStation) {
+        // Gone between events; the disconnect event refreshes the rest
+        m_link.hasStation = false;
+        publish();
+    }
+}
+
+void WirelessState::handleStation(const void* message, size_t length)
+{
+    AttributeTable table = parseMessage(message, length, NL80211_ATTR_MAX);
+    if (table[NL80211_ATTR_MAC].length < 6 || !table[NL80211_ATTR_STA_INFO].data ||
+        std::memcmp(table[NL80211_ATTR_MAC].data, m_link.bssid, sizeof(m_link.bssid)) != 0) {
+        return;
+    }
+    AttributeTable info = parseNested(table[NL80211_ATTR_STA_INFO], NL80211_STA_INFO_MAX);
+
+    Link link = m_link;
+    link.hasStation = true;
+    if (info[NL80211_STA_INFO_SIGNAL].data) {
+        link.signalDbm = readValue<int8_t>(info[NL80211_STA_INFO_SIGNAL]);
+    }
+    link.signalAvgDbm = info[NL80211_STA_INFO_SIGNAL_AVG].data ? readValue<int8_t>(info[NL80211_STA_INFO_SIGNAL_AVG])
+                                                               : link.signalDbm;
+    link.txBitrate = info[NL80211_STA_INFO_TX_BITRATE].data ? readBitrate(info[NL80211_STA_INFO_TX_BITRATE]) : 0;
+    link.rxBitrate = info[NL80211_STA_INFO_RX_BITRATE].data ? readBitrate(info[NL80211_STA_INFO_RX_BITRATE]) : 0;
+    m_stationSeen = true;
+
+    // Only a changed figure bumps the generation, so idle links redraw nothing
+    bool changed = !m_link.hasStation || link.signalDbm != m_link.signalDbm ||
+                   link.signalAvgDbm != m_link.signalAvgDbm || link.txBitrate != m_link.txBitrate ||
+                   link.rxBitrate != m_link.rxBitrate;
+    link.updatedMs = nowMs();
+    m_link = link;
+    if (changed) {
+        publish();
+    }
+}
+
+void WirelessState::handleEvent(const void* message, size_t length)
+{
+    if (length < GENL_HDRLEN) {
+        return;
+    }
+    uint8_t command = static_cast<const struct genlmsghdr*>(message)->cmd;
+    AttributeTable table = parseMessage(message, length, NL80211_ATTR_IFINDEX);
+
+    switch (command) {
+        case NL80211_CMD_NEW_INTERFACE:
+        case NL80211_CMD_DEL_INTERFACE:
+        case NL80211_CMD_SET_INTERFACE:
+            m_needInterface = true;
+            return;
+        default:
+            break;
+    }
+
+    int ifindex = static_cast<int>(readValue<uint32_t>(table[NL80211_ATTR_IFINDEX]));
+    if (ifindex == 0 || ifindex != m_ifindex.load()) {
+        return;
+    }
+
+    int64_t now = nowMs();
+    switch (command) {
+        case NL80211_CMD_TRIGGER_SCAN:
+            m_scanning = true;
+            m_scanStartedMs = now;
+            publish();
+            break;
+        case NL80211_CMD_NEW_SCAN_RESULTS:
+            m_scanning = false;
+            m_lastScanMs = now;
+            m_nextScanMs = now;
+            m_needFetch = true;
+            break;
+        case NL80211_CMD_SCAN_ABORTED:
+            // Usually a connect attempt took the radio; survey again shortly
+            m_scanning = false;
+            m_nextScanMs = now + Config::WIFI_SCAN_RETRY_MS;
+            publish();
+            break;
+        case NL80211_CMD_CONNECT:
+        case NL80211_CMD_ROAM:
+        case NL80211_CMD_DISCONNECT:
+        case NL80211_CMD_DEAUTHENTICATE:
+        case NL80211_CMD_DISASSOCIATE:
+            m_needFetch = true;
+            m_nextStationMs = now;
+            break;
+        default:
+            break;
+    }
+}
+
+void WirelessState::publish()
+{
+    std::lock_guard<std::mutex> lock(m_mutex);
+    m_networks = m_scan;
+    m_linkSnapshot = m_link;
+    m_generation++;
+}
+
+void WirelessState::wake()
+{
+    if (m_wakeFd >= 0) {
+        uint64_t one = 1;
+        ssize_t written = write(m_wakeFd, &one, sizeof(one));
+        (void)written;
+    }
+}
+
+void WirelessState::run()
+{
+    static thread_local char buffer[RECEIVE_BUFFER];
+    while (!m_stop) {
+        if (m_needInterface.exchange(false)) {
+            findInterface();
+            m_needFetch = true;
+        }
+        if (m_needFetch) {
+            m_needFetch = false;
+            fetchScan();
+        }
+
+        int64_t now = nowMs();
+        int64_t due = now + EVENT_POLL_MS;
+        if (m_ifindex.load() > 0) {
+            if (m_scanning && now - m_scanStartedMs >= Config::WIFI_SCAN_TIMEOUT_MS) {
+                // The completion event never came (driver reset, lost event)
+                m_scanning = false;
+                publish();
+            }
+            if (m_survey && !m_scanning) {
+                if (now >= m_nextScanMs) {
+                    triggerScan();
+                }
+                if (!m_scanning) {
+                    due = std::min(due, m_nextScanMs);
+                }
+            }
+            if (m_scanning) {
+                due = std::min(due, m_scanStartedMs + Config::WIFI_SCAN_TIMEOUT_MS);
+            }
+            if (m_monitoring && m_link.connected) {
+                if (now >= m_nextStationMs) {
+                    fetchStation();
+                    m_nextStationMs = now + Config::WIFI_STATION_POLL_MS;
+                }
+                due = std::min(due, m_nextStationMs);
+            }
+        }
+
+        struct pollfd fds[2] = {{m_eventFd, POLLIN, 0}, {m_wakeFd, POLLIN, 0}};
+        int timeoutMs = static_cast<int>(std::max<int64_t>(0, due - nowMs()));
+        if (::poll(fds, 2, timeoutMs) <= 0) {
+            continue;
+        }
+        if (fds[1].revents & POLLIN) {
+            uint64_t count;
+            ssize_t drained = read(m_wakeFd, &count, sizeof(count));
+            (void)drained;
+        }
+        if (!(fds[0].revents & POLLIN)) {
+            continue;
+        }
+
+        for (;;) {
+            ssize_t length = recv(m_eventFd, buffer, sizeof(buffer), MSG_DONTWAIT);
+            if (length < 0) {
+                if (errno == EINTR) continue;
+                if (errno == ENOBUFS) {
+                    // Events were dropped; start over from fresh dumps
+                    Logger::warning("WirelessState: netlink buffer overrun, resynchronising");
+                    m_needInterface = true;
+                    continue;
+                }
+                break;
+            }
+            size_t remaining = static_cast<size_t>(length);
+            for (struct nlmsghdr* header = reinterpret_cast<struct nlmsghdr*>(buffer);
+                 NLMSG_OK(header, remaining); header = NLMSG_NEXT(header, remaining)) {
+                if (header->nlmsg_type == m_family) {
+                    handleEvent(NLMSG_DATA(header), header->nlmsg_len - NLMSG_HDRLEN);
+                }
+            }
+        }
+    }
+}
+
+std::string WirelessState::getInterfaceName() const
+{
+    std::lock_guard<std::mutex> lock(m_mutex);
+    return m_ifname;
+}
+
+void WirelessState::setInterface(const std::string& name)
+{
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        if (m_preferred == name) {
+            return;
+        }
+        m_preferred = name;
+    }
+    m_needInterface = true;
+    wake();
+}
+
+void WirelessState::setSurvey(bool enabled)
+{
+    m_survey = enabled;
+    wake();
+}
+
+void WirelessState::setMonitoring(bool enabled)
+{
+    m_monitoring = enabled;
+    wake();
+}
+
+std::vector<WirelessState::Network> WirelessState::getNetworks() const
+{
+    std::lock_guard<std::mutex> lock(m_mutex);
+    return m_networks;
+}
+
+WirelessState::Link WirelessState::getLink() const
+{
+    std::lock_guard<std::mutex> lock(m_mutex);
+    return m_linkSnapshot;
+}
+
+WirelessState::Radio WirelessState::getRadio()
+{
+    // Opening /dev/rfkill replays one ADD event per switch: the current state
+    int fd = open("/dev/rfkill", O_RDONLY | O_NONBLOCK | O_CLOEXEC);
+    if (fd < 0) {
+        return Radio::UNKNOWN;
+    }
+    bool found = false;
+    bool soft = false;
+    bool hard = false;
+    struct rfkill_event event;
+    while (read(fd, &event, sizeof(event)) >= static_cast<ssize_t>(RFKILL_EVENT_SIZE_V1)) {
+        if (event.op != RFKILL_OP_ADD || event.type != RFKILL_TYPE_WLAN) {
+            continue;
+        }
+        found = true;
+        soft = soft || event.soft;
+        hard = hard || event.hard;
+    }
+    close(fd);
+
+    if (!found) return Radio::UNKNOWN;
+    if (hard) return Radio::HARD_BLOCKED;
+    return soft ? Radio::SOFT_BLOCKED : Radio::ON;
+}
+
+bool WirelessState::setRadio(bool enabled)
+{
+    int fd = open("/dev/rfkill", O_WRONLY | O_CLOEXEC);
+    if (fd < 0) {
+        Logger::warning(std::string("WirelessState: /dev/rfkill: ") + strerror(errno));
+        return false;
+    }
+    struct rfkill_event event;
+    std::memset(&event, 0, sizeof(event));
+    event.op = RFKILL_OP_CHANGE_ALL;
+    event.type = RFKILL_TYPE_WLAN;
+    event.soft = enabled ? 0 : 1;
+    bool ok = write(fd, &event, RFKILL_EVENT_SIZE_V1) == static_cast<ssize_t>(RFKILL_EVENT_SIZE_V1);
+    if (ok) {
+        Logger::info(std::string("WirelessState: Wi-Fi radio ") + (enabled ? "unblocked" : "blocked"));
+    } else {
+        Logger::warning(std::string("WirelessState: rfkill write: ") + strerror(errno));
+    }
+    close(fd);
+    return ok;
+}
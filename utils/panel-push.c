@@ -0,0 +1,169 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <getopt.h>
+#include <sys/socket.h>
+#include <sys/time.h>
+#include <sys/un.h>
+#include <errno.h>
+
+// Exit codes
+#define EXIT_SUCCESS        0
+#define EXIT_ARGS_ERROR     1
+#define EXIT_CONNECT_ERROR  2
+#define EXIT_SEND_ERROR     3
+
+// Default values; must match Config::PUSH_SOCKET_PATH and PUSH_MAX_DATAGRAM
+#define DEFAULT_SOCKET      "/tmp/micropanel-push.sock"
+#define DEFAULT_TIMEOUT_SEC 2
+#define BUFFER_SIZE         2048
+
+void print_usage(const char* program_name) {
+    printf("Usage: %s [-s SOCKET] [-t N] [-q] SCREEN COMMAND [ARGS...]\n\n", program_name);
+    printf("Options:\n");
+    printf("  -s SOCKET   micropanel push socket (default: %s)\n", DEFAULT_SOCKET);
+    printf("  -t N        Wait at most N seconds while the panel is backed up (default: %d)\n", DEFAULT_TIMEOUT_SEC);
+    printf("  -q          Quiet: no error messages (for hooks in scripts)\n");
+    printf("  -h          Show this help message\n\n");
+    printf("Commands:\n");
+    printf("  title TEXT              Set the screen title\n");
+    printf("  line N TEXT             Set body line N (0-5)\n");
+    printf("  lines                   Replace the body with lines read from stdin\n");
+    printf("  items                   Replace the scrollable list with lines read from stdin\n");
+    printf("  progress PCT [LABEL]    Show a progress bar (0-100), -1 hides it\n");
+    printf("  frame                   Show a 1024-byte 1bpp frame read from stdin\n");
+    printf("  clear                   Forget everything pushed to SCREEN\n\n");
+    printf("Examples:\n");
+    printf("  %s video title \"Playing\"\n", program_name);
+    printf("  %s video progress 42 \"00:42 / 01:40\"\n", program_name);
+    printf("  df -h | %s disks items\n", program_name);
+    printf("\nExit code 0 on success, non-zero on error\n");
+}
+
+// Appends the rest of stdin after the header; -1 if it does not fit
+int read_payload(char* buffer, int length, int capacity) {
+    while (length < capacity) {
+        ssize_t count = read(STDIN_FILENO, buffer + length, capacity - length);
+        if (count < 0) {
+            if (errno == EINTR) {
+                continue;
+            }
+            return -1;
+        }
+        if (count == 0) {
+            return length;
+        }
+        length += count;
+    }
+
+    // Full: only fine if stdin has nothing more
+    char extra;
+    return read(STDIN_FILENO, &extra, 1) == 0 ? length : -1;
+}
+
+int main(int argc, char* argv[]) {
+    const char* socket_path = DEFAULT_SOCKET;
+    int timeout_sec = DEFAULT_TIMEOUT_SEC;
+    int quiet = 0;
+    int opt;
+
+    while ((opt = getopt(argc, argv, "s:t:qh")) != -1) {
+        switch (opt) {
+            case 's':
+                socket_path = optarg;
+                break;
+            case 't':
+                timeout_sec = atoi(optarg);
+                break;
+            case 'q':
+                quiet = 1;
+                break;
+            case 'h':
+                print_usage(argv[0]);
+                return EXIT_SUCCESS;
+            default:
+                print_usage(argv[0]);
+                return EXIT_ARGS_ERROR;
+        }
+    }
+
+    if (argc - optind < 2) {
+        if (!quiet) {
+            fprintf(stderr, "Error: SCREEN and COMMAND are required\n");
+            print_usage(argv[0]);
+        }
+        return EXIT_ARGS_ERROR;
+    }
+
+    // Header line: the arguments joined by spaces
+    char buffer[BUFFER_SIZE];
+    int length = 0;
+    for (int i = optind; i < argc; i++) {
+        int written = snprintf(buffer + length, sizeof(buffer) - length, "%s%s",
+                               i > optind ? " " : "", argv[i]);
+        if (written < 0 || written >= (int)sizeof(buffer) - length) {
+            if (!quiet) {
+                fprintf(stderr, "Error: Message too long\n");
+            }
+            return EXIT_ARGS_ERROR;
+        }
+        length += written;
+    }
+
+    const char* command = argv[optind + 1];
+    if (strcmp(command, "lines") == 0 || strcmp(command, "items") == 0 || strcmp(command, "frame") == 0) {
+        buffer[length++] = '\n';
+        length = read_payload(buffer, length, sizeof(buffer));
+        if (length < 0) {
+            if (!quiet) {
+                fprintf(stderr, "Error: Payload larger than %d bytes\n", BUFFER_SIZE);
+            }
+            return EXIT_ARGS_ERROR;
+        }
+    }
+
+    struct sockaddr_un address;
+    memset(&address, 0, sizeof(address));
+    address.sun_family = AF_UNIX;
+    if (strlen(socket_path) >= sizeof(address.sun_path)) {
+        if (!quiet) {
+            fprintf(stderr, "Error: Socket path too long\n");
+        }
+        return EXIT_ARGS_ERROR;
+    }
+    strcpy(address.sun_path, socket_path);
+
+    int sockfd = socket(AF_UNIX, SOCK_DGRAM, 0);
+    if (sockfd < 0) {
+        if (!quiet) {
+            fprintf(stderr, "Error: Failed to create socket: %s\n", strerror(errno));
+        }
+        return EXIT_CONNECT_ERROR;
+    }
+
+    // A full receive queue blocks send(); bound how long we wait for the panel
+    struct timeval timeout;
+    timeout.tv_sec = timeout_sec;
+    timeout.tv_usec = 0;
+    setsockopt(sockfd, SOL_SOCKET, SO_SNDTIMEO, &timeout, sizeof(timeout));
+
+    if (connect(sockfd, (struct sockaddr*)&address, sizeof(address)) < 0) {
+        if (!quiet) {
+            fprintf(stderr, "Error: Cannot reach %s: %s\n", socket_path, strerror(errno));
+        }
+        close(sockfd);
+        return EXIT_CONNECT_ERROR;
+    }
+
+    if (send(sockfd, buffer, length, 0) != length) {
+        if (!quiet) {
+            fprintf(stderr, "Error: Failed to send: %s\n", strerror(errno));
+        }
+        close(sockfd);
+        return EXIT_SEND_ERROR;
+    }
+
+    close(sockfd);
+    return EXIT_SUCCESS;
+}
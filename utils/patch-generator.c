@@ -12,6 +12,15 @@
 #include <linux/vt.h>
 #include <termios.h>
 #include <sys/types.h>
+#include <sys/wait.h>
+#include <stdint.h>
+#include <errno.h>
+#include <time.h>
+#include <poll.h>
+#include <sys/socket.h>
+#include <sys/time.h>
+#include <netinet/in.h>
+#include <arpa/inet.h>
 
 // Constants
 #define EXIT_SUCCESS        0
@@ -19,6 +28,15 @@
 #define EXIT_COLOR_ERROR    2
 #define EXIT_GENERAL_ERROR  3
 
+// Resident server (--serve)
+#define DEFAULT_SERVER_ADDR  "127.0.0.1:8083"
+#define SERVER_TIMEOUT_SEC   2
+#define SERVER_START_TRIES   40         // 25 ms apart
+#define MAX_CLIENTS          8
+#define REQUEST_MAX          256
+#define DEFAULT_CHECKER_CELL 64
+#define PATTERN_LIST         "red,green,blue,cyan,magenta,yellow,white,black,colorbars,gradient,checkerboard"
+
 // Color definitions structure
 typedef struct {
     unsigned int r;
@@ -26,11 +44,34 @@ typedef struct {
     unsigned int b;
 } rgb_color;
 
+typedef enum {
+    PATTERN_SOLID,
+    PATTERN_COLORBARS,      // Seven 75% bars, SMPTE order
+    PATTERN_GRADIENT,       // Black to color, left to right
+    PATTERN_CHECKER         // Color/black cells
+} pattern_kind;
+
+// What to draw; colors are in `depth` bits per channel
+typedef struct {
+    pattern_kind kind;
+    rgb_color color;
+    unsigned int cell;      // Checkerboard cell size in pixels
+    int depth;
+    char name[64];
+} test_pattern;
+
 // Function prototypes
 void print_usage(const char* program_name);
 int parse_color(const char* color_str, rgb_color* color, int color_depth);
 int open_framebuffer(struct fb_var_screeninfo* vinfo, struct fb_fix_screeninfo* finfo);
-void fill_screen(int fbfd, struct fb_var_screeninfo* vinfo, struct fb_fix_screeninfo* finfo, rgb_color* color);
+int parse_pattern(const char* name, test_pattern* pattern, int color_depth);
+int draw_pattern(char* fbp, const struct fb_var_screeninfo* vinfo, const struct fb_fix_screeninfo* finfo,
+                 unsigned int first_line, const test_pattern* pattern);
+void fill_screen(int fbfd, struct fb_var_screeninfo* vinfo, struct fb_fix_screeninfo* finfo, const test_pattern* pattern);
+int serve_patterns(const char* address, int color_depth);
+int forward_to_server(const char* address, const char* request, char* reply, size_t reply_size);
+int start_server(const char* address, int color_depth);
+void hide_vt_cursor();
 int detect_color_depth(struct fb_var_screeninfo* vinfo);
 void cleanup_and_exit(int sig);
 int clear_active_display();
@@ -348,7 +389,8 @@ int clear_active_display() {
         struct fb_fix_screeninfo finfo;
         int fb = open_framebuffer(&vinfo, &finfo);
         if (fb >= 0) {
-            rgb_color black = {0};
+            test_pattern black;
+            parse_pattern("black", &black, 8);
             fill_screen(fb, &vinfo, &finfo, &black);
             close(fb);
             return EXIT_SUCCESS;
@@ -428,19 +470,32 @@ void print_usage(const char* program_name) {
     printf("  -o, --off            Turn off currently active color patch\n");
     printf("  -n, --non-interactive  Non-interactive mode (for use by other services)\n");
     printf("  -r, --read           Read current display color\n");
+    printf("  -S, --serve          Stay resident with the framebuffer mapped and take\n");
+    printf("                       pattern changes over TCP (see Server below)\n");
+    printf("  -a, --address=IP:PORT  Resident server address (default: %s)\n", DEFAULT_SERVER_ADDR);
     printf("  -v, --verbose        Output more information\n");
     printf("  -h, --help           Show this help message\n\n");
     printf("COLOR can be:\n");
     printf("  - Standard colors: red, green, blue, cyan, magenta, yellow, white, black\n");
     printf("  - RGB values in decimal: rgb:R,G,B (values depend on color depth)\n");
     printf("    For 8-bit: 0-255 per channel\n");
-    printf("    For 10-bit: 0-1023 per channel\n\n");
+    printf("    For 10-bit: 0-1023 per channel\n");
+    printf("  - Test patterns: colorbars (75%% bars), gradient[:COLOR] (black to white\n");
+    printf("    or COLOR, left to right), checkerboard[:SIZE] (default %d pixel cells)\n\n", DEFAULT_CHECKER_CELL);
+    printf("Server:\n");
+    printf("  With --serve, lines in the launcher-client protocol are answered one per\n");
+    printf("  line on the same connection: 'pattern COLOR' (OK), 'off' (OK),\n");
+    printf("  'get-pattern' and 'list-patterns'. While a server runs, COLOR, --off and\n");
+    printf("  --read are passed to it instead of drawing over it. --daemon COLOR starts\n");
+    printf("  one in the background when none answers.\n\n");
     printf("Examples:\n");
     printf("  %s red\n", program_name);
     printf("  %s -d 10 -t 5 blue\n", program_name);
     printf("  %s --detach rgb:128,64,255\n", program_name);
     printf("  %s --off\n", program_name);
     printf("  %s --non-interactive red\n", program_name);
+    printf("  %s --daemon checkerboard:32\n", program_name);
+    printf("  %s --serve --detach\n", program_name);
 }
 
 int parse_color(const char* color_str, rgb_color* color, int color_depth) {
@@ -550,7 +605,163 @@ int open_framebuffer(struct fb_var_screeninfo* vinfo, struct fb_fix_screeninfo*
     return fbfd;
 }
 
-void fill_screen(int fbfd, struct fb_var_screeninfo* vinfo, struct fb_fix_screeninfo* finfo, rgb_color* color) {
+int parse_pattern(const char* name, test_pattern* pattern, int color_depth) {
+    unsigned int max_val = (color_depth == 10) ? 1023 : 255;
+
+    memset(pattern, 0, sizeof(*pattern));
+    pattern->depth = color_depth;
+    snprintf(pattern->name, sizeof(pattern->name), "%s", name);
+
+    // "colorbar" and "grayscale-ramp" are the pattern-generator app's names
+    if (strcmp(name, "colorbars") == 0 || strcmp(name, "colorbar") == 0) {
+        pattern->kind = PATTERN_COLORBARS;
+        pattern->color.r = pattern->color.g = pattern->color.b = max_val * 3 / 4;
+        return 0;
+    }
+    if (strcmp(name, "gradient") == 0 || strcmp(name, "grayscale-ramp") == 0) {
+        pattern->kind = PATTERN_GRADIENT;
+        pattern->color.r = pattern->color.g = pattern->color.b = max_val;
+        return 0;
+    }
+    if (strncmp(name, "gradient:", 9) == 0) {
+        pattern->kind = PATTERN_GRADIENT;
+        return parse_color(name + 9, &pattern->color, color_depth);
+    }
+    if (strcmp(name, "checkerboard") == 0 || strncmp(name, "checkerboard:", 13) == 0) {
+        pattern->kind = PATTERN_CHECKER;
+        pattern->cell = DEFAULT_CHECKER_CELL;
+        pattern->color.r = pattern->color.g = pattern->color.b = max_val;
+        if (name[12] == ':' && (sscanf(name + 13, "%u", &pattern->cell) != 1 || pattern->cell == 0)) {
+            if (verbose) {
+                fprintf(stderr, "Error: Invalid checkerboard size '%s'\n", name + 13);
+            }
+            return -1;
+        }
+        return 0;
+    }
+
+    pattern->kind = PATTERN_SOLID;
+    return parse_color(name, &pattern->color, color_depth);
+}
+
+// Channel value from `depth` bits to the framebuffer's field width
+static unsigned int scale_channel(unsigned int value, int depth, unsigned int length) {
+    if (length == 0) {
+        return 0;
+    }
+    return length <= (unsigned int)depth ? value >> (depth - length) : value << (length - depth);
+}
+
+static uint32_t pack_pixel(const struct fb_var_screeninfo* vinfo, unsigned int r, unsigned int g, unsigned int b,
+                           int depth) {
+    return (scale_channel(r, depth, vinfo->red.length) << vinfo->red.offset) |
+           (scale_channel(g, depth, vinfo->green.length) << vinfo->green.offset) |
+           (scale_channel(b, depth, vinfo->blue.length) << vinfo->blue.offset);
+}
+
+static void store_pixel(uint8_t* row, unsigned int x, uint32_t pixel, int bytes) {
+    if (bytes == 4) {
+        memcpy(row + (size_t)x * 4, &pixel, 4);
+    } else if (bytes == 2) {
+        uint16_t value = (uint16_t)pixel;
+        memcpy(row + (size_t)x * 2, &value, 2);
+    } else {
+        row[x * 3 + 0] = pixel & 0xff;
+        row[x * 3 + 1] = (pixel >> 8) & 0xff;
+        row[x * 3 + 2] = (pixel >> 16) & 0xff;
+    }
+}
+
+// Pixels [from, to) of a row template, two or four at a time in 64-bit stores
+static void fill_span(uint8_t* row, unsigned int from, unsigned int to, uint32_t pixel, int bytes) {
+    unsigned int x = from;
+    if (bytes == 4 || bytes == 2) {
+        uint64_t wide = (bytes == 4) ? ((uint64_t)pixel << 32) | pixel
+                                     : (uint64_t)(pixel & 0xffff) * 0x0001000100010001ULL;
+        unsigned int per_store = 8 / bytes;
+        for (; x + per_store <= to; x += per_store) {
+            memcpy(row + (size_t)x * bytes, &wide, 8);
+        }
+    }
+    for (; x < to; x++) {
+        store_pixel(row, x, pixel, bytes);
+    }
+}
+
+// Render one screen into the yres lines starting at first_line. Each
+// distinct row is built once as a template (a checkerboard needs two) and
+// copied down the screen with one memcpy per scanline, so the per-pixel
+// work is a single row however large the output
+int draw_pattern(char* fbp, const struct fb_var_screeninfo* vinfo, const struct fb_fix_screeninfo* finfo,
+                 unsigned int first_line, const test_pattern* pattern) {
+    int bytes = vinfo->bits_per_pixel / 8;
+    if (vinfo->bits_per_pixel % 8 != 0 || bytes < 2 || bytes > 4) {
+        if (verbose) {
+            fprintf(stderr, "Warning: Unsupported bit depth: %d\n", vinfo->bits_per_pixel);
+        }
+        return -1;
+    }
+
+    unsigned int width = vinfo->xres;
+    unsigned int height = vinfo->yres;
+    size_t row_bytes = (size_t)width * bytes;
+    uint8_t* templates = malloc(row_bytes * 2);
+    if (!templates) {
+        if (verbose) {
+            perror("Error: failed to allocate row templates");
+        }
+        return -1;
+    }
+    uint8_t* even = templates;
+    uint8_t* odd = templates + row_bytes;
+
+    const rgb_color* c = &pattern->color;
+    int depth = pattern->depth;
+    switch (pattern->kind) {
+        case PATTERN_SOLID:
+            fill_span(even, 0, width, pack_pixel(vinfo, c->r, c->g, c->b, depth), bytes);
+            break;
+        case PATTERN_COLORBARS: {
+            // White, yellow, cyan, green, magenta, red, blue as RGB bits
+            static const unsigned char bars[7] = {7, 6, 3, 2, 5, 4, 1};
+            for (unsigned int bar = 0; bar < 7; bar++) {
+                uint32_t pixel = pack_pixel(vinfo, (bars[bar] & 4) ? c->r : 0, (bars[bar] & 2) ? c->g : 0,
+                                            (bars[bar] & 1) ? c->b : 0, depth);
+                fill_span(even, width * bar / 7, width * (bar + 1) / 7, pixel, bytes);
+            }
+            break;
+        }
+        case PATTERN_GRADIENT: {
+            unsigned int span = width > 1 ? width - 1 : 1;
+            for (unsigned int x = 0; x < width; x++) {
+                store_pixel(even, x, pack_pixel(vinfo, c->r * x / span, c->g * x / span, c->b * x / span, depth),
+                            bytes);
+            }
+            break;
+        }
+        case PATTERN_CHECKER: {
+            uint32_t lit = pack_pixel(vinfo, c->r, c->g, c->b, depth);
+            for (unsigned int from = 0; from < width; from += pattern->cell) {
+                unsigned int to = (width - from > pattern->cell) ? from + pattern->cell : width;
+                int on = (from / pattern->cell) % 2 == 0;
+                fill_span(even, from, to, on ? lit : 0, bytes);
+                fill_span(odd, from, to, on ? 0 : lit, bytes);
+            }
+            break;
+        }
+    }
+
+    char* origin = fbp + (size_t)vinfo->xoffset * bytes;
+    for (unsigned int y = 0; y < height; y++) {
+        const uint8_t* row = (pattern->kind == PATTERN_CHECKER && (y / pattern->cell) % 2) ? odd : even;
+        memcpy(origin + (size_t)(first_line + y) * finfo->line_length, row, row_bytes);
+    }
+
+    free(templates);
+    return 0;
+}
+
+void fill_screen(int fbfd, struct fb_var_screeninfo* vinfo, struct fb_fix_screeninfo* finfo, const test_pattern* pattern) {
     screensize = vinfo->yres_virtual * finfo->line_length;
     char *fbp = mmap(0, screensize, PROT_READ | PROT_WRITE, MAP_SHARED, fbfd, 0);
 
@@ -571,36 +782,384 @@ void fill_screen(int fbfd, struct fb_var_screeninfo* vinfo, struct fb_fix_screen
         }
     }
 
-    long int location;
-    unsigned int pixel_value;
+    draw_pattern(fbp, vinfo, finfo, vinfo->yoffset, pattern);
 
-    for (int y = 0; y < vinfo->yres; y++) {
-        for (int x = 0; x < vinfo->xres; x++) {
-            location = (x + vinfo->xoffset) * (vinfo->bits_per_pixel / 8) +
-                       (y + vinfo->yoffset) * finfo->line_length;
+    munmap(fbp, screensize);
+}
 
-            // Handle different bit depths
-            if (vinfo->bits_per_pixel == 32) {
-                *(fbp + location + 0) = color->b >> (vinfo->blue.length - 8);  // Blue
-                *(fbp + location + 1) = color->g >> (vinfo->green.length - 8); // Green
-                *(fbp + location + 2) = color->r >> (vinfo->red.length - 8);   // Red
-                *(fbp + location + 3) = 0;                                     // Alpha/padding
-            } else if (vinfo->bits_per_pixel == 16) {
-                // 16-bit color (RGB565 usually)
-                pixel_value = ((color->r >> 3) << vinfo->red.offset) |
-                              ((color->g >> 2) << vinfo->green.offset) |
-                              ((color->b >> 3) << vinfo->blue.offset);
-                *((unsigned short*)(fbp + location)) = pixel_value;
-            } else {
-                // Handle other bit depths if needed
-                if (verbose) {
-                    fprintf(stderr, "Warning: Unsupported bit depth: %d\n", vinfo->bits_per_pixel);
-                }
+void hide_vt_cursor() {
+    // If we're in daemon mode, try more aggressive cursor hiding
+    int vt_console;
+
+    // Try various console devices
+    const char* console_devices[] = {
+        "/dev/tty0",
+        "/dev/tty1",
+        "/dev/console",
+        "/dev/vc/0",
+        NULL
+    };
+
+    for (int i = 0; console_devices[i] != NULL; i++) {
+        vt_console = open(console_devices[i], O_RDWR);
+        if (vt_console >= 0) {
+            // Try various cursor hiding methods
+            ioctl(vt_console, KDSETMODE, KD_GRAPHICS);
+            write(vt_console, "\033[?25l", 6); // ANSI hide cursor
+
+            // Try to blank the screen first (may help with cursor)
+            ioctl(vt_console, FBIOBLANK, FB_BLANK_NORMAL);
+            usleep(100000); // 100ms
+            ioctl(vt_console, FBIOBLANK, FB_BLANK_UNBLANK);
+
+            close(vt_console);
+            break;
+        }
+    }
+}
+
+static int parse_server_address(const char* address, struct sockaddr_in* server) {
+    char host[64];
+    const char* colon = strrchr(address, ':');
+    if (!colon || colon == address || (size_t)(colon - address) >= sizeof(host)) {
+        return -1;
+    }
+    memcpy(host, address, colon - address);
+    host[colon - address] = '\0';
+
+    char* end = NULL;
+    long port = strtol(colon + 1, &end, 10);
+    if (*end != '\0' || port <= 0 || port > 65535) {
+        return -1;
+    }
+
+    memset(server, 0, sizeof(*server));
+    server->sin_family = AF_INET;
+    server->sin_port = htons((uint16_t)port);
+    return inet_pton(AF_INET, host, &server->sin_addr) == 1 ? 0 : -1;
+}
+
+// A running --serve instance owns the framebuffer, so requests go to it
+// rather than drawing over it. -1 if none answers.
+int forward_to_server(const char* address, const char* request, char* reply, size_t reply_size) {
+    struct sockaddr_in server;
+    if (parse_server_address(address, &server) != 0) {
+        return -1;
+    }
+    int fd = socket(AF_INET, SOCK_STREAM | SOCK_CLOEXEC, 0);
+    if (fd < 0) {
+        return -1;
+    }
+    struct timeval timeout = {SERVER_TIMEOUT_SEC, 0};
+    setsockopt(fd, SOL_SOCKET, SO_RCVTIMEO, &timeout, sizeof(timeout));
+    setsockopt(fd, SOL_SOCKET, SO_SNDTIMEO, &timeout, sizeof(timeout));
+    if (connect(fd, (struct sockaddr*)&server, sizeof(server)) != 0) {
+        close(fd);
+        return -1;
+    }
+
+    char line[REQUEST_MAX];
+    int length = snprintf(line, sizeof(line), "%s\n", request);
+    if (length >= (int)sizeof(line) || send(fd, line, length, MSG_NOSIGNAL) != length) {
+        close(fd);
+        return -1;
+    }
+
+    size_t used = 0;
+    while (used + 1 < reply_size) {
+        ssize_t n = recv(fd, reply + used, reply_size - used - 1, 0);
+        if (n <= 0) {
+            break;
+        }
+        used += n;
+        if (memchr(reply + used - n, '\n', n)) {
+            break;
+        }
+    }
+    close(fd);
+    if (used == 0) {
+        return -1;
+    }
+    reply[used] = '\0';
+    reply[strcspn(reply, "\r\n")] = '\0';
+    return 0;
+}
+
+// Fork a detached --serve instance and wait until it accepts connections.
+// Its stdio goes to /dev/null so a caller reading our output is not held
+// open by it. -1 if it does not come up, e.g. no framebuffer.
+int start_server(const char* address, int color_depth) {
+    struct sockaddr_in server;
+    if (parse_server_address(address, &server) != 0) {
+        return -1;
+    }
+    pid_t pid = fork();
+    if (pid < 0) {
+        return -1;
+    }
+    if (pid == 0) {
+        setsid();
+        int null_fd = open("/dev/null", O_RDWR);
+        if (null_fd >= 0) {
+            dup2(null_fd, STDIN_FILENO);
+            dup2(null_fd, STDOUT_FILENO);
+            dup2(null_fd, STDERR_FILENO);
+            if (null_fd > STDERR_FILENO) {
+                close(null_fd);
             }
         }
+        _exit(serve_patterns(address, color_depth));
     }
 
-    munmap(fbp, screensize);
+    for (int i = 0; i < SERVER_START_TRIES; i++) {
+        struct timespec delay = {0, 25 * 1000000L};
+        nanosleep(&delay, NULL);
+        int fd = socket(AF_INET, SOCK_STREAM | SOCK_CLOEXEC, 0);
+        if (fd < 0) {
+            return -1;
+        }
+        int connected = connect(fd, (struct sockaddr*)&server, sizeof(server)) == 0;
+        close(fd);
+        if (connected) {
+            return 0;
+        }
+        // Reap a server that gave up, e.g. on a missing framebuffer
+        if (waitpid(pid, NULL, WNOHANG) == pid) {
+            return -1;
+        }
+    }
+    return -1;
+}
+
+// --serve state: the mapping outlives pattern changes
+struct fb_var_screeninfo serve_vinfo;
+struct fb_fix_screeninfo serve_finfo;
+char *serve_fbp = NULL;
+size_t serve_mapped = 0;
+unsigned int serve_page = 0;        // First line of the page on screen
+test_pattern serve_pattern;         // Named "off" while blanked
+
+// (Re)map when the mode changed, e.g. after an HDMI hotplug
+static int serve_map() {
+    struct fb_var_screeninfo vinfo;
+    struct fb_fix_screeninfo finfo;
+    if (ioctl(fbfd, FBIOGET_VSCREENINFO, &vinfo) == -1 || ioctl(fbfd, FBIOGET_FSCREENINFO, &finfo) == -1) {
+        return -1;
+    }
+    size_t size = (size_t)vinfo.yres_virtual * finfo.line_length;
+    if (serve_fbp && size == serve_mapped && vinfo.xres == serve_vinfo.xres && vinfo.yres == serve_vinfo.yres &&
+        vinfo.bits_per_pixel == serve_vinfo.bits_per_pixel && finfo.line_length == serve_finfo.line_length) {
+        return 0;
+    }
+
+    if (serve_fbp) {
+        munmap(serve_fbp, serve_mapped);
+    }
+    serve_fbp = mmap(0, size, PROT_READ | PROT_WRITE, MAP_SHARED, fbfd, 0);
+    if ((long)serve_fbp == -1) {
+        if (verbose) {
+            perror("Error: failed to map framebuffer device to memory");
+        }
+        serve_fbp = NULL;
+        serve_mapped = 0;
+        return -1;
+    }
+    serve_mapped = size;
+    serve_vinfo = vinfo;
+    serve_finfo = finfo;
+    serve_page = vinfo.yoffset;
+    if (verbose) {
+        printf("Mapped %ux%u at %u bpp, %s\n", vinfo.xres, vinfo.yres, vinfo.bits_per_pixel,
+               vinfo.yres_virtual >= 2 * vinfo.yres ? "page flipping" : "single page");
+    }
+    return 0;
+}
+
+// With a second page in the virtual framebuffer the pattern is drawn off
+// screen and panned to, so it appears at once instead of sweeping down
+static int serve_show(const test_pattern* pattern) {
+    if (serve_map() != 0) {
+        return -1;
+    }
+    struct timespec start, end;
+    clock_gettime(CLOCK_MONOTONIC, &start);
+
+    int flip = serve_vinfo.yres_virtual >= 2 * serve_vinfo.yres;
+    unsigned int target = flip ? (serve_page == 0 ? serve_vinfo.yres : 0) : serve_page;
+    if (draw_pattern(serve_fbp, &serve_vinfo, &serve_finfo, target, pattern) != 0) {
+        return -1;
+    }
+    if (flip) {
+        struct fb_var_screeninfo pan = serve_vinfo;
+        pan.yoffset = target;
+        if (ioctl(fbfd, FBIOPAN_DISPLAY, &pan) == 0) {
+            serve_page = target;
+        } else if (draw_pattern(serve_fbp, &serve_vinfo, &serve_finfo, serve_page, pattern) != 0) {
+            return -1;
+        }
+    }
+
+    clock_gettime(CLOCK_MONOTONIC, &end);
+    if (verbose) {
+        printf("Showing %s (%ld ms)\n", pattern->name,
+               (long)((end.tv_sec - start.tv_sec) * 1000 + (end.tv_nsec - start.tv_nsec) / 1000000));
+    }
+    serve_pattern = *pattern;
+    return 0;
+}
+
+static void serve_command(char* line, char* reply, size_t reply_size, int color_depth) {
+    char* arg = strchr(line, ' ');
+    if (arg) {
+        *arg++ = '\0';
+        arg += strspn(arg, " ");
+    }
+
+    if (strcmp(line, "get-pattern") == 0) {
+        snprintf(reply, reply_size, "%s", serve_pattern.name);
+    } else if (strcmp(line, "list-patterns") == 0) {
+        snprintf(reply, reply_size, "%s", PATTERN_LIST);
+    } else if (strcmp(line, "off") == 0 || (strcmp(line, "pattern") == 0 && arg && strcmp(arg, "off") == 0)) {
+        test_pattern black;
+        parse_pattern("black", &black, 8);
+        if (serve_show(&black) != 0) {
+            snprintf(reply, reply_size, "error: framebuffer unavailable");
+            return;
+        }
+        snprintf(serve_pattern.name, sizeof(serve_pattern.name), "off");
+        snprintf(reply, reply_size, "OK");
+    } else if (strcmp(line, "pattern") == 0 && arg && *arg) {
+        test_pattern pattern;
+        if (serve_map() != 0) {
+            snprintf(reply, reply_size, "error: framebuffer unavailable");
+        } else if (parse_pattern(arg, &pattern, color_depth ? color_depth : detect_color_depth(&serve_vinfo)) != 0) {
+            snprintf(reply, reply_size, "error: unknown pattern %s", arg);
+        } else if (serve_show(&pattern) != 0) {
+            snprintf(reply, reply_size, "error: cannot draw %s", arg);
+        } else {
+            snprintf(reply, reply_size, "OK");
+        }
+    } else {
+        snprintf(reply, reply_size, "error: unknown command %s", line);
+    }
+}
+
+// Answer requests until killed; each line gets one reply line, so clients
+// may keep the connection open and send the next one right away
+int serve_patterns(const char* address, int color_depth) {
+    struct sockaddr_in server;
+    if (parse_server_address(address, &server) != 0) {
+        fprintf(stderr, "Error: Invalid server address '%s'. Expected IP:PORT\n", address);
+        return EXIT_GENERAL_ERROR;
+    }
+
+    fbfd = open_framebuffer(&serve_vinfo, &serve_finfo);
+    if (fbfd == -1 || serve_map() != 0) {
+        fprintf(stderr, "Error: Could not map framebuffer device\n");
+        return EXIT_FB_ERROR;
+    }
+    snprintf(serve_pattern.name, sizeof(serve_pattern.name), "off");
+    hide_vt_cursor();
+
+    int listen_fd = socket(AF_INET, SOCK_STREAM | SOCK_CLOEXEC, 0);
+    int one = 1;
+    if (listen_fd >= 0) {
+        setsockopt(listen_fd, SOL_SOCKET, SO_REUSEADDR, &one, sizeof(one));
+    }
+    if (listen_fd < 0 || bind(listen_fd, (struct sockaddr*)&server, sizeof(server)) != 0 ||
+        listen(listen_fd, MAX_CLIENTS) != 0) {
+        fprintf(stderr, "Error: Cannot listen on %s: %s\n", address, strerror(errno));
+        return EXIT_GENERAL_ERROR;
+    }
+    signal(SIGPIPE, SIG_IGN);
+    if (verbose) {
+        printf("Serving patterns on %s\n", address);
+    }
+
+    struct {
+        int fd;
+        size_t used;
+        char buffer[REQUEST_MAX];
+    } clients[MAX_CLIENTS];
+    for (int i = 0; i < MAX_CLIENTS; i++) {
+        clients[i].fd = -1;
+    }
+
+    while (1) {
+        struct pollfd fds[MAX_CLIENTS + 1];
+        int slot_of[MAX_CLIENTS + 1];
+        nfds_t count = 0;
+        fds[count].fd = listen_fd;
+        fds[count].events = POLLIN;
+        slot_of[count++] = -1;
+        for (int i = 0; i < MAX_CLIENTS; i++) {
+            if (clients[i].fd >= 0) {
+                fds[count].fd = clients[i].fd;
+                fds[count].events = POLLIN;
+                slot_of[count++] = i;
+            }
+        }
+
+        if (poll(fds, count, -1) < 0) {
+            if (errno == EINTR) {
+                continue;
+            }
+            perror("Error: poll");
+            return EXIT_GENERAL_ERROR;
+        }
+
+        if (fds[0].revents & POLLIN) {
+            int fd = accept(listen_fd, NULL, NULL);
+            int slot = -1;
+            for (int i = 0; fd >= 0 && i < MAX_CLIENTS && slot < 0; i++) {
+                if (clients[i].fd < 0) {
+                    slot = i;
+                }
+            }
+            if (slot >= 0) {
+                clients[slot].fd = fd;
+                clients[slot].used = 0;
+            } else if (fd >= 0) {
+                close(fd);
+            }
+        }
+
+        for (nfds_t n = 1; n < count; n++) {
+            if (!fds[n].revents) {
+                continue;
+            }
+            int i = slot_of[n];
+            ssize_t got = recv(clients[i].fd, clients[i].buffer + clients[i].used,
+                               sizeof(clients[i].buffer) - clients[i].used, 0);
+            if (got <= 0) {
+                close(clients[i].fd);
+                clients[i].fd = -1;
+                continue;
+            }
+            clients[i].used += got;
+
+            // Every complete line, in order
+            char* line = clients[i].buffer;
+            char* newline;
+            while ((newline = memchr(line, '\n', clients[i].buffer + clients[i].used - line)) != NULL) {
+                *newline = '\0';
+                line[strcspn(line, "\r")] = '\0';
+                char reply[REQUEST_MAX];
+                serve_command(line, reply, sizeof(reply) - 1, color_depth);
+                strcat(reply, "\n");
+                send(clients[i].fd, reply, strlen(reply), MSG_NOSIGNAL);
+                line = newline + 1;
+            }
+            size_t rest = clients[i].buffer + clients[i].used - line;
+            if (rest == sizeof(clients[i].buffer)) {
+                const char* error = "error: request too long\n";
+                send(clients[i].fd, error, strlen(error), MSG_NOSIGNAL);
+                rest = 0;
+            }
+            memmove(clients[i].buffer, line, rest);
+            clients[i].used = rest;
+        }
+    }
 }
 
 int main(int argc, char* argv[]) {
@@ -608,7 +1167,10 @@ int main(int argc, char* argv[]) {
     int display_time = 0; // 0 = indefinite
     int detach_mode = 0;
     int off_mode = 0;
-    rgb_color color = {0};
+    int serve_mode = 0;
+    const char* server_address = DEFAULT_SERVER_ADDR;
+    char reply[REQUEST_MAX];
+    test_pattern pattern;
     struct fb_var_screeninfo vinfo;
     struct fb_fix_screeninfo finfo;
     int ssh_session = is_ssh_session();
@@ -622,6 +1184,8 @@ int main(int argc, char* argv[]) {
         {"daemon",  no_argument, 0, 'D'},
         {"non-interactive", no_argument, 0, 'n'},
         {"read", no_argument, 0, 'r'},
+        {"serve", no_argument, 0, 'S'},
+        {"address", required_argument, 0, 'a'},
         {"verbose", no_argument, 0, 'v'},
         {"help",  no_argument, 0, 'h'},
         {0, 0, 0, 0}
@@ -635,7 +1199,7 @@ int main(int argc, char* argv[]) {
     int opt;
     int option_index = 0;
 
-    while ((opt = getopt_long(argc, argv, "d:t:hxonvrD", long_options, &option_index)) != -1) {
+    while ((opt = getopt_long(argc, argv, "d:t:hxonvrDSa:", long_options, &option_index)) != -1) {
         switch (opt) {
             case 'd':
                 if (strcmp(optarg, "auto") == 0) {
@@ -677,21 +1241,53 @@ int main(int argc, char* argv[]) {
             case 'r':
                 read_mode = 1;
                 break;
+            case 'S':
+                serve_mode = 1;
+                non_interactive = 1;
+                break;
+            case 'a':
+                server_address = optarg;
+                break;
             default:
                 print_usage(argv[0]);
                 return EXIT_GENERAL_ERROR;
         }
     }
 
+    // Resident mode; --detach puts it in the background
+    if (serve_mode) {
+        if (detach_mode) {
+            pid_t pid = fork();
+            if (pid < 0) {
+                perror("Failed to fork process");
+                return EXIT_GENERAL_ERROR;
+            }
+            if (pid > 0) {
+                return EXIT_SUCCESS;
+            }
+            setsid();
+        }
+        return serve_patterns(server_address, color_depth);
+    }
+
     // Handle the "off" mode early
     if (off_mode) {
+        if (forward_to_server(server_address, "off", reply, sizeof(reply)) == 0) {
+            if (verbose) {
+                printf("Color patch cleared.\n");
+            }
+            return EXIT_SUCCESS;
+        }
         return clear_active_display();
     }
 
 // After handling off_mode, add read_mode handling
 if (read_mode) {
-    struct fb_var_screeninfo vinfo;
-    struct fb_fix_screeninfo finfo;
+    // The server knows the pattern by name; otherwise sample the screen
+    if (forward_to_server(server_address, "get-pattern", reply, sizeof(reply)) == 0) {
+        printf("%s\n", reply);
+        return EXIT_SUCCESS;
+    }
     // No need to open the framebuffer explicitly, the read_current_color function will do that
     read_current_color(NULL, NULL);
     return EXIT_SUCCESS;
@@ -710,6 +1306,32 @@ if (!read_mode && !off_mode && optind >= argc) {
         return EXIT_GENERAL_ERROR;
     }
 
+    // Hand the pattern to a resident server if one is running
+    char request[REQUEST_MAX];
+    snprintf(request, sizeof(request), "pattern %s", argv[optind]);
+    if (forward_to_server(server_address, request, reply, sizeof(reply)) == 0) {
+        if (strcmp(reply, "OK") == 0) {
+            if (verbose) {
+                printf("Displaying %s via %s\n", argv[optind], server_address);
+            }
+            return EXIT_SUCCESS;
+        }
+        if (verbose) {
+            fprintf(stderr, "%s\n", reply);
+        }
+        return EXIT_COLOR_ERROR;
+    }
+
+    // --daemon actions keep a server resident for the next change, unless
+    // the patch is timed and has to clear itself
+    if (from_daemon && display_time == 0 && !detach_mode && start_server(server_address, color_depth) == 0 &&
+        forward_to_server(server_address, request, reply, sizeof(reply)) == 0) {
+        if (verbose) {
+            printf("Started server on %s\n", server_address);
+        }
+        return strcmp(reply, "OK") == 0 ? EXIT_SUCCESS : EXIT_COLOR_ERROR;
+    }
+
     // In non-interactive mode, don't bother with console handling
     if (!non_interactive) {
         // Open the console for cursor control
@@ -748,34 +1370,7 @@ if (!read_mode && !off_mode && optind >= argc) {
     }
 // Try direct console cursor control if in daemon mode
 if (non_interactive || from_daemon) {
-    // If we're in daemon mode, try more aggressive cursor hiding
-    int vt_console;
-    
-    // Try various console devices
-    const char* console_devices[] = {
-        "/dev/tty0",
-        "/dev/tty1",
-        "/dev/console",
-        "/dev/vc/0",
-        NULL
-    };
-    
-    for (int i = 0; console_devices[i] != NULL; i++) {
-        vt_console = open(console_devices[i], O_RDWR);
-        if (vt_console >= 0) {
-            // Try various cursor hiding methods
-            ioctl(vt_console, KDSETMODE, KD_GRAPHICS);
-            write(vt_console, "\033[?25l", 6); // ANSI hide cursor
-            
-            // Try to blank the screen first (may help with cursor)
-            ioctl(vt_console, FBIOBLANK, FB_BLANK_NORMAL);
-            usleep(100000); // 100ms
-            ioctl(vt_console, FBIOBLANK, FB_BLANK_UNBLANK);
-            
-            close(vt_console);
-            break;
-        }
-    }
+    hide_vt_cursor();
 }
 
     // Detect color depth if not specified
@@ -786,8 +1381,8 @@ if (non_interactive || from_daemon) {
         }
     }
 
-    // Parse color
-    if (parse_color(argv[optind], &color, color_depth) != 0) {
+    // Parse color or test pattern
+    if (parse_pattern(argv[optind], &pattern, color_depth) != 0) {
         if (!non_interactive) {
             cleanup_and_exit(1);
         }
@@ -805,7 +1400,7 @@ if (non_interactive || from_daemon) {
     }
 
     // Fill screen with the specified color
-    fill_screen(fbfd, &vinfo, &finfo, &color);
+    fill_screen(fbfd, &vinfo, &finfo, &pattern);
 
     // Handle detach mode
     if (detach_mode) {
@@ -850,7 +1445,8 @@ if (non_interactive || from_daemon) {
         if (display_time > 0) {
             sleep(display_time);
             // Clear screen and exit
-            rgb_color black = {0};
+            test_pattern black;
+            parse_pattern("black", &black, 8);
             fill_screen(fbfd, &vinfo, &finfo, &black);
             if (console_fd >= 0) {
                 ioctl(console_fd, KDSETMODE, KD_TEXT);